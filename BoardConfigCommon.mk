@@ -146,6 +146,7 @@ BOARD_SEPOLICY_UNION += \
     netd.te \
     pvrsrvinit.te \
     rild.te \
+    surfaceflinger.te \
     system.te \
     tee.te \
     vold.te
@@ -60,7 +60,8 @@ LOCAL_MODULE := audio.hdmi.$(TARGET_BOOTLOADER_BOARD_NAME)
 
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/hw
 LOCAL_SRC_FILES := hdmi_audio_hw.c \
-	hdmi_audio_utils.c
+	hdmi_audio_utils.c \
+	hdmi_audio_iec61937.c
 
 LOCAL_C_INCLUDES += \
 	external/tinyalsa/include \
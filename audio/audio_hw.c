@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 
 #include <errno.h>
+#include <math.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -40,6 +41,7 @@
 #include <audio_effects/effect_aec.h>
 
 #include "audio_route.h"
+#include "audio_stats.h"
 
 #define PCM_CARD 0
 #define PCM_CARD_HDMI 1
@@ -67,6 +69,8 @@
 
 #define SHORT_PERIOD_MULTIPLIER	40  /* 20 ms */
 #define LONG_PERIOD_MULTIPLIER	2 /* 40 ms */
+#define LL_PERIOD_MULTIPLIER	10  /* 5 ms */
+#define DEEP_PERIOD_MULTIPLIER	200 /* 100 ms */
 
 #define OUT_SHORT_PERIOD_SIZE	(ABE_BASE_FRAME_COUNT * SHORT_PERIOD_MULTIPLIER)
 #define OUT_SHORT_PERIOD_COUNT	4
@@ -74,6 +78,18 @@
 #define OUT_LONG_PERIOD_SIZE	(OUT_SHORT_PERIOD_SIZE * LONG_PERIOD_MULTIPLIER)
 #define OUT_LONG_PERIOD_COUNT	4
 
+/* AUDIO_OUTPUT_FLAG_FAST streams, on the MM port so they don't share LP's buffering */
+#define OUT_LL_PERIOD_SIZE	(ABE_BASE_FRAME_COUNT * LL_PERIOD_MULTIPLIER)
+#define OUT_LL_PERIOD_COUNT	2
+/* underruns tolerated before a fast stream falls back to the normal config */
+#define OUT_LL_MAX_XRUNS	3
+/* writes without an underrun after which the count above starts over */
+#define OUT_LL_XRUN_WINDOW	400
+
+/* AUDIO_OUTPUT_FLAG_DEEP_BUFFER streams, one wakeup per 100 ms whatever the screen state */
+#define OUT_DEEP_PERIOD_SIZE	(ABE_BASE_FRAME_COUNT * DEEP_PERIOD_MULTIPLIER)
+#define OUT_DEEP_PERIOD_COUNT	4
+
 #ifndef OUT_SAMPLING_RATE
 #define OUT_SAMPLING_RATE	48000
 #endif
@@ -81,10 +97,25 @@
 #define IN_PERIOD_SIZE		OUT_SHORT_PERIOD_SIZE
 #define IN_PERIOD_COUNT		2
 #define IN_SAMPLING_RATE	44100
+/* ABE native rate, used for 8k/16k/24k/48k clients so no resampler is needed */
+#define IN_NATIVE_SAMPLING_RATE	48000
+
+/* integer ratio capture rates go through a fused left channel + FIR decimator */
+#define DECIM_MAX_FACTOR	6
+#define DECIM_TAPS_PER_PHASE	8
+#define DECIM_MAX_TAPS		(DECIM_MAX_FACTOR * DECIM_TAPS_PER_PHASE + 1)
 
-#define SCO_PERIOD_SIZE		256
+/* 16 ms periods, about two eSCO packets, for both narrow and wide band */
+#define SCO_PERIOD_SIZE		128
 #define SCO_PERIOD_COUNT	4
 #define SCO_SAMPLING_RATE	8000
+#define SCO_WB_PERIOD_SIZE	256
+#define SCO_WB_SAMPLING_RATE	16000
+
+/* an output left in standby keeps its PCM open, stopped and prepared, this long */
+#define OUT_STANDBY_DELAY_MS	3000
+/* outputs tracked by the delayed standby thread */
+#define OUT_MAX_STREAMS		4
 
 /* minimum sleep time in out_write() when write threshold is not reached */
 #define MIN_WRITE_SLEEP_US 5000
@@ -107,6 +138,26 @@ struct pcm_config pcm_config_out = {
     .avail_min = OUT_SHORT_PERIOD_SIZE,
 };
 
+struct pcm_config pcm_config_out_ll = {
+    .channels = 2,
+    .rate = OUT_SAMPLING_RATE,
+    .period_size = OUT_LL_PERIOD_SIZE,
+    .period_count = OUT_LL_PERIOD_COUNT,
+    .format = PCM_FORMAT_S16_LE,
+    .start_threshold = OUT_LL_PERIOD_SIZE,
+    .avail_min = OUT_LL_PERIOD_SIZE,
+};
+
+struct pcm_config pcm_config_out_deep = {
+    .channels = 2,
+    .rate = OUT_SAMPLING_RATE,
+    .period_size = OUT_DEEP_PERIOD_SIZE,
+    .period_count = OUT_DEEP_PERIOD_COUNT,
+    .format = PCM_FORMAT_S16_LE,
+    .start_threshold = OUT_DEEP_PERIOD_SIZE * 2,
+    .avail_min = OUT_DEEP_PERIOD_SIZE,
+};
+
 struct pcm_config pcm_config_in = {
     .channels = 2,
     .rate = IN_SAMPLING_RATE,
@@ -117,6 +168,16 @@ struct pcm_config pcm_config_in = {
     .stop_threshold = (IN_PERIOD_SIZE * IN_PERIOD_COUNT),
 };
 
+struct pcm_config pcm_config_in_native = {
+    .channels = 2,
+    .rate = IN_NATIVE_SAMPLING_RATE,
+    .period_size = IN_PERIOD_SIZE,
+    .period_count = IN_PERIOD_COUNT,
+    .format = PCM_FORMAT_S16_LE,
+    .start_threshold = 1,
+    .stop_threshold = (IN_PERIOD_SIZE * IN_PERIOD_COUNT),
+};
+
 struct pcm_config pcm_config_sco = {
     .channels = 1,
     .rate = SCO_SAMPLING_RATE,
@@ -125,6 +186,15 @@ struct pcm_config pcm_config_sco = {
     .format = PCM_FORMAT_S16_LE,
 };
 
+/* mSBC headsets, selected with the "bt_wbs" parameter */
+struct pcm_config pcm_config_sco_wb = {
+    .channels = 1,
+    .rate = SCO_WB_SAMPLING_RATE,
+    .period_size = SCO_WB_PERIOD_SIZE,
+    .period_count = SCO_PERIOD_COUNT,
+    .format = PCM_FORMAT_S16_LE,
+};
+
 struct pcm_config pcm_config_hdmi = {
     .channels = 2,
     .rate = 48000,
@@ -147,9 +217,16 @@ struct audio_device {
     int orientation;
     bool screen_off;
     bool low_power;
+    bool bt_wb_sco;     /* the SCO link runs mSBC at 16 kHz */
 
     struct stream_out *active_out;
+    struct stream_out *lp_out;      /* output holding the LP port, if any */
     struct stream_in *active_in;
+
+    struct stream_out *outputs[OUT_MAX_STREAMS];
+    pthread_t standby_thread;
+    pthread_cond_t standby_cond;    /* signalled when a delayed standby is queued */
+    bool standby_thread_exit;
 };
 
 struct stream_out {
@@ -168,6 +245,19 @@ struct stream_out {
     int cur_write_threshold;
     int buffer_type;
 
+    bool fast;          /* opened with AUDIO_OUTPUT_FLAG_FAST */
+    bool low_latency;   /* still using pcm_config_out_ll, cleared on fallback */
+    bool deep_buffer;   /* opened with AUDIO_OUTPUT_FLAG_DEEP_BUFFER */
+    int ll_xruns;
+    int ll_good_writes;
+
+    uint64_t written;   /* frames handed to the mmap buffer since leaving standby */
+
+    bool standby_pending;           /* PCM kept warm, closed at standby_time */
+    struct timespec standby_time;
+
+    struct audio_stream_stats stats;
+
     struct audio_device *dev;
 };
 
@@ -180,12 +270,23 @@ struct stream_in {
     bool standby;
 
     unsigned int requested_rate;
+    struct decimator {
+        unsigned int factor;        /* 0 when not decimating */
+        unsigned int ntaps;
+        int16_t taps[DECIM_MAX_TAPS];
+        int16_t *line;              /* ntaps - 1 samples of history, then one period */
+        int16_t *out;               /* one period worth of decimated frames */
+    } decimator;
     struct resampler_itfe *resampler;
     struct resampler_buffer_provider buf_provider;
     int16_t *buffer;
     size_t buffer_size;
     size_t frames_in;
     int read_status;
+    bool running;       /* a read completed since the PCM was started */
+
+    struct audio_stream_stats stats;
+    int64_t provider_read_us;   /* pcm_read() time within the current resample */
 
     struct audio_device *dev;
 };
@@ -277,6 +378,8 @@ static void do_out_standby(struct stream_out *out)
         pcm_close(out->pcm);
         out->pcm = NULL;
         adev->active_out = NULL;
+        if (adev->lp_out == out)
+            adev->lp_out = NULL;
         if (out->resampler) {
             release_resampler(out->resampler);
             out->resampler = NULL;
@@ -285,10 +388,118 @@ static void do_out_standby(struct stream_out *out)
             free(out->buffer);
             out->buffer = NULL;
         }
+        out->written = 0;
+        out->standby_pending = false;
         out->standby = true;
+        out->stats.standbys++;
     }
 }
 
+/*
+ * Standby requested by AudioFlinger: stop the PCM now but leave it open and
+ * prepared, so a write within OUT_STANDBY_DELAY_MS restarts it without
+ * pcm_open() and resampler setup. The standby thread closes it afterwards.
+ * Must be called with hw device and output stream mutexes locked.
+ */
+static void out_request_standby(struct stream_out *out)
+{
+    struct audio_device *adev = out->dev;
+    unsigned int i;
+
+    if (out->standby || out->standby_pending)
+        return;
+
+    for (i = 0; i < OUT_MAX_STREAMS; i++)
+        if (adev->outputs[i] == out)
+            break;
+
+    pcm_stop(out->pcm);
+    if ((i == OUT_MAX_STREAMS) || (pcm_prepare(out->pcm) != 0)) {
+        do_out_standby(out);
+        return;
+    }
+
+    /* the stop dropped whatever was queued, count from zero like a cold start */
+    out->written = 0;
+
+    clock_gettime(CLOCK_REALTIME, &out->standby_time);
+    out->standby_time.tv_sec += OUT_STANDBY_DELAY_MS / 1000;
+    out->standby_time.tv_nsec += (OUT_STANDBY_DELAY_MS % 1000) * 1000000;
+    if (out->standby_time.tv_nsec >= 1000000000) {
+        out->standby_time.tv_sec++;
+        out->standby_time.tv_nsec -= 1000000000;
+    }
+    out->standby_pending = true;
+    pthread_cond_signal(&adev->standby_cond);
+}
+
+/* must be called with hw device mutex locked */
+static void flush_pending_standby(struct audio_device *adev, struct stream_out *except)
+{
+    unsigned int i;
+
+    for (i = 0; i < OUT_MAX_STREAMS; i++) {
+        struct stream_out *out = adev->outputs[i];
+
+        if (out && (out != except) && out->standby_pending) {
+            pthread_mutex_lock(&out->lock);
+            do_out_standby(out);
+            pthread_mutex_unlock(&out->lock);
+        }
+    }
+}
+
+static bool timespec_before(const struct timespec *a, const struct timespec *b)
+{
+    return (a->tv_sec < b->tv_sec) ||
+           ((a->tv_sec == b->tv_sec) && (a->tv_nsec < b->tv_nsec));
+}
+
+/*
+ * Closes outputs whose keep-warm window has expired. standby_pending only
+ * changes with the hw device mutex held, so the outputs are scanned under
+ * that alone; an output mutex is only taken for an idle, pending stream.
+ */
+static void *standby_thread_loop(void *context)
+{
+    struct audio_device *adev = context;
+    struct timespec now;
+    struct timespec next;
+    bool waiting;
+    unsigned int i;
+
+    pthread_mutex_lock(&adev->lock);
+    while (!adev->standby_thread_exit) {
+        clock_gettime(CLOCK_REALTIME, &now);
+        waiting = false;
+
+        for (i = 0; i < OUT_MAX_STREAMS; i++) {
+            struct stream_out *out = adev->outputs[i];
+
+            if (!out || !out->standby_pending)
+                continue;
+
+            if (!timespec_before(&now, &out->standby_time)) {
+                ALOGV("standby_thread_loop() closing idle output %p", out);
+                pthread_mutex_lock(&out->lock);
+                do_out_standby(out);
+                pthread_mutex_unlock(&out->lock);
+            } else if (!waiting || timespec_before(&out->standby_time, &next)) {
+                next = out->standby_time;
+                waiting = true;
+            }
+        }
+
+        if (waiting)
+            pthread_cond_timedwait(&adev->standby_cond, &adev->lock, &next);
+        else
+            pthread_cond_wait(&adev->standby_cond, &adev->lock);
+    }
+    pthread_mutex_unlock(&adev->lock);
+
+    return NULL;
+}
+
 /* must be called with hw device and input stream mutexes locked */
 static void do_in_standby(struct stream_in *in)
 {
@@ -306,7 +517,13 @@ static void do_in_standby(struct stream_in *in)
             free(in->buffer);
             in->buffer = NULL;
         }
+        free(in->decimator.line);
+        free(in->decimator.out);
+        in->decimator.line = NULL;
+        in->decimator.out = NULL;
+        in->decimator.factor = 0;
         in->standby = true;
+        in->stats.standbys++;
     }
 }
 
@@ -316,8 +533,12 @@ static int start_output_stream(struct stream_out *out)
     struct audio_device *adev = out->dev;
     unsigned int device = PCM_DEVICE_DEFAULT_OUT;
     unsigned int card = PCM_CARD_DEFAULT;
+    bool deep_buffer = out->deep_buffer;
     int ret;
 
+    /* an output parked in its keep-warm window may be holding our PCM */
+    flush_pending_standby(adev, out);
+
     /*
      * Due to the lack of sample rate converters in the SoC,
      * it greatly simplifies things to have only the main
@@ -330,11 +551,22 @@ static int start_output_stream(struct stream_out *out)
         out->pcm_config = &pcm_config_sco;
     } else {
 #endif
+retry:
     if (adev->out_device & AUDIO_DEVICE_OUT_AUX_DIGITAL) {
         card = PCM_CARD_HDMI;
         out->pcm_config = &pcm_config_hdmi;
+    } else if (out->low_latency) {
+        device = PCM_DEVICE_MM;
+        out->pcm_config = &pcm_config_out_ll;
+        out->buffer_type = OUT_BUFFER_TYPE_UNKNOWN; /* thresholds set on first write */
+    } else if (deep_buffer) {
+        device = PCM_DEVICE_MM_LP;
+        out->pcm_config = &pcm_config_out_deep;
+        out->buffer_type = OUT_BUFFER_TYPE_UNKNOWN;
     } else {
-        device = PCM_DEVICE_DEFAULT_OUT;
+        /* leave the LP port to whoever holds it, e.g. a deep buffer stream */
+        device = (adev->lp_out && (adev->lp_out != out)) ?
+                PCM_DEVICE_MM : PCM_DEVICE_DEFAULT_OUT;
         out->pcm_config = &pcm_config_out;
         out->buffer_type = OUT_BUFFER_TYPE_LONG; // LP mode
     }
@@ -363,6 +595,16 @@ static int start_output_stream(struct stream_out *out)
     if (out->pcm && !pcm_is_ready(out->pcm)) {
         ALOGE("pcm_open(out) failed: %s", pcm_get_error(out->pcm));
         pcm_close(out->pcm);
+        if (out->low_latency && (card == PCM_CARD_DEFAULT)) {
+            ALOGW("low latency port unavailable, using the normal output config");
+            out->low_latency = false;
+            goto retry;
+        }
+        if (deep_buffer && (card == PCM_CARD_DEFAULT)) {
+            ALOGW("deep buffer port unavailable, using the normal output config");
+            deep_buffer = false;
+            goto retry;
+        }
         return -ENOMEM;
     }
 
@@ -377,17 +619,71 @@ static int start_output_stream(struct stream_out *out)
                                RESAMPLER_QUALITY_DEFAULT,
                                NULL,
                                &out->resampler);
-        out->buffer_frames = (pcm_config_out.period_size * out->pcm_config->rate) /
+        /* sized for what AudioFlinger writes, which may not be this config's period */
+        out->buffer_frames = (out_get_buffer_size(&out->stream.common) /
+                audio_stream_frame_size(&out->stream.common) * out->pcm_config->rate) /
                 out_get_sample_rate(&out->stream.common) + 1;
 
         out->buffer = malloc(pcm_frames_to_bytes(out->pcm, out->buffer_frames));
     }
 
     adev->active_out = out;
+    if ((card == PCM_CARD_DEFAULT) && (device == PCM_DEVICE_MM_LP))
+        adev->lp_out = out;
 
     return 0;
 }
 
+/* Windowed sinc low pass at 0.9x the output Nyquist rate, in Q15 */
+static void decimator_init(struct decimator *d, unsigned int factor)
+{
+    unsigned int ntaps = factor * DECIM_TAPS_PER_PHASE + 1;
+    double cutoff = 0.45 / factor;
+    double h[DECIM_MAX_TAPS];
+    double sum = 0;
+    unsigned int k;
+
+    for (k = 0; k < ntaps; k++) {
+        int n = (int)k - (int)(ntaps - 1) / 2;
+        double sinc = (n == 0) ? 2 * cutoff : sin(2 * M_PI * cutoff * n) / (M_PI * n);
+        double window = 0.54 - 0.46 * cos(2 * M_PI * k / (ntaps - 1));
+        h[k] = sinc * window;
+        sum += h[k];
+    }
+    for (k = 0; k < ntaps; k++)
+        d->taps[k] = (int16_t)lrint(h[k] / sum * 32767);
+
+    d->factor = factor;
+    d->ntaps = ntaps;
+}
+
+/*
+ * Keeps the left channel (what the other paths do with stereo captures too)
+ * and decimates it in the same pass. frames must be a multiple of the factor.
+ */
+static void decimate(struct decimator *d, const int16_t *src, unsigned int channels,
+                     unsigned int frames, int16_t *dst)
+{
+    unsigned int hist = d->ntaps - 1;
+    int16_t *line = d->line;
+    unsigned int i, k;
+
+    for (i = 0; i < frames; i++)
+        line[hist + i] = src[i * channels];
+
+    for (i = 0; i < frames; i += d->factor) {
+        const int16_t *x = line + i + d->factor - 1;
+        int32_t acc = 1 << 14;
+
+        for (k = 0; k < d->ntaps; k++)
+            acc += (int32_t)d->taps[k] * x[k];
+        acc >>= 15;
+        *dst++ = (acc > 32767) ? 32767 : (acc < -32768) ? -32768 : acc;
+    }
+
+    memmove(line, line + frames, hist * sizeof(int16_t));
+}
+
 /* must be called with hw device and input stream mutexes locked */
 static int start_input_stream(struct stream_in *in)
 {
@@ -403,10 +699,12 @@ static int start_input_stream(struct stream_in *in)
      */
     if ((adev->in_device - AUDIO_DEVICE_BIT_IN) & (AUDIO_DEVICE_IN_ALL_SCO - AUDIO_DEVICE_BIT_IN)) {
         device = PCM_DEVICE_SCO_IN;
-        in->pcm_config = &pcm_config_sco;
+        in->pcm_config = adev->bt_wb_sco ? &pcm_config_sco_wb : &pcm_config_sco;
     } else {
         device = PCM_DEVICE_DEFAULT_IN;
-        in->pcm_config = &pcm_config_in;
+        /* capture from the matching rate group, integer ratios need no resampler */
+        in->pcm_config = ((IN_NATIVE_SAMPLING_RATE % in->requested_rate) == 0) ?
+                &pcm_config_in_native : &pcm_config_in;
     }
 
     /*
@@ -438,9 +736,30 @@ static int start_input_stream(struct stream_in *in)
 
     /*
      * If the stream rate differs from the PCM rate, we need to
-     * create a resampler.
+     * create a resampler, unless a plain decimator does the job
+     * (an 8 kHz client on a wide band SCO link, for one).
      */
-    if (in_get_sample_rate(&in->stream.common) != in->pcm_config->rate) {
+    if ((in_get_sample_rate(&in->stream.common) != in->pcm_config->rate) &&
+            ((in->pcm_config->rate % in_get_sample_rate(&in->stream.common)) == 0) &&
+            ((in->pcm_config->rate / in_get_sample_rate(&in->stream.common)) <= DECIM_MAX_FACTOR) &&
+            ((in->pcm_config->period_size %
+              (in->pcm_config->rate / in_get_sample_rate(&in->stream.common))) == 0)) {
+        struct decimator *d = &in->decimator;
+
+        decimator_init(d, in->pcm_config->rate / in_get_sample_rate(&in->stream.common));
+        d->line = calloc(d->ntaps - 1 + in->pcm_config->period_size, sizeof(int16_t));
+        d->out = malloc(in->pcm_config->period_size / d->factor * sizeof(int16_t));
+        if (!d->line || !d->out) {
+            free(d->line);
+            free(d->out);
+            d->line = NULL;
+            d->out = NULL;
+            d->factor = 0;
+        }
+    }
+
+    if ((in->decimator.factor == 0) &&
+            (in_get_sample_rate(&in->stream.common) != in->pcm_config->rate)) {
         in->buf_provider.get_next_buffer = get_next_buffer;
         in->buf_provider.release_buffer = release_buffer;
 
@@ -480,9 +799,12 @@ static int get_next_buffer(struct resampler_buffer_provider *buffer_provider,
     }
 
     if (in->frames_in == 0) {
+        int64_t read_us = audio_stats_now_us();
+
         in->read_status = pcm_read(in->pcm,
                                    (void*)in->buffer,
                                    in->buffer_size);
+        in->provider_read_us += audio_stats_now_us() - read_us;
         if (in->read_status != 0) {
             ALOGE("get_next_buffer() pcm_read error %d", in->read_status);
             buffer->raw = NULL;
@@ -521,6 +843,41 @@ static void release_buffer(struct resampler_buffer_provider *buffer_provider,
     in->frames_in -= buffer->frame_count;
 }
 
+/* read_frames_decimated() is read_frames() for integer rate ratios */
+static ssize_t read_frames_decimated(struct stream_in *in, int16_t *buffer, ssize_t frames)
+{
+    struct decimator *d = &in->decimator;
+    size_t period_out = in->pcm_config->period_size / d->factor;
+    ssize_t frames_wr = 0;
+    int64_t process_us;
+
+    while (frames_wr < frames) {
+        size_t frames_rd;
+
+        if (in->frames_in == 0) {
+            in->read_status = pcm_read(in->pcm, (void *)in->buffer, in->buffer_size);
+            if (in->read_status != 0) {
+                ALOGE("read_frames_decimated() pcm_read error %d", in->read_status);
+                return in->read_status;
+            }
+            process_us = audio_stats_now_us();
+            decimate(d, in->buffer, in->pcm_config->channels,
+                     in->pcm_config->period_size, d->out);
+            in->stats.process_us += audio_stats_now_us() - process_us;
+            in->frames_in = period_out;
+        }
+
+        frames_rd = frames - frames_wr;
+        if (frames_rd > in->frames_in)
+            frames_rd = in->frames_in;
+        memcpy(buffer + frames_wr, d->out + (period_out - in->frames_in),
+               frames_rd * sizeof(int16_t));
+        in->frames_in -= frames_rd;
+        frames_wr += frames_rd;
+    }
+    return frames_wr;
+}
+
 /* read_frames() reads frames from kernel driver, down samples to capture rate
  * if necessary and output the number of frames requested to the buffer specified */
 static ssize_t read_frames(struct stream_in *in, void *buffer, ssize_t frames)
@@ -530,10 +887,16 @@ static ssize_t read_frames(struct stream_in *in, void *buffer, ssize_t frames)
     while (frames_wr < frames) {
         size_t frames_rd = frames - frames_wr;
         if (in->resampler != NULL) {
+            /* the provider reads the PCM from inside the resampler, keep that out */
+            int64_t process_us = audio_stats_now_us();
+
+            in->provider_read_us = 0;
             in->resampler->resample_from_provider(in->resampler,
                     (int16_t *)((char *)buffer +
                             frames_wr * audio_stream_frame_size(&in->stream.common)),
                     &frames_rd);
+            in->stats.process_us += audio_stats_now_us() - process_us -
+                    in->provider_read_us;
         } else {
             struct resampler_buffer buf = {
                     { raw : NULL, },
@@ -573,7 +936,10 @@ static int out_set_sample_rate(struct audio_stream *stream, uint32_t rate)
 
 static size_t out_get_buffer_size(const struct audio_stream *stream)
 {
-    size_t size = pcm_config_out.period_size * audio_stream_frame_size((struct audio_stream *)stream);
+    struct stream_out *out = (struct stream_out *)stream;
+    size_t period_size = out->fast ? OUT_LL_PERIOD_SIZE :
+                         out->deep_buffer ? OUT_DEEP_PERIOD_SIZE : pcm_config_out.period_size;
+    size_t size = period_size * audio_stream_frame_size((struct audio_stream *)stream);
     ALOGD("out_get_buffer_size::size == %u", size);
     return size;
 }
@@ -599,7 +965,7 @@ static int out_standby(struct audio_stream *stream)
 
     pthread_mutex_lock(&out->dev->lock);
     pthread_mutex_lock(&out->lock);
-    do_out_standby(out);
+    out_request_standby(out);
     pthread_mutex_unlock(&out->lock);
     pthread_mutex_unlock(&out->dev->lock);
 
@@ -608,6 +974,10 @@ static int out_standby(struct audio_stream *stream)
 
 static int out_dump(const struct audio_stream *stream, int fd)
 {
+    struct stream_out *out = (struct stream_out *)stream;
+
+    audio_stats_dump(&out->stats, fd, out->fast ? "fast output" :
+                     out->deep_buffer ? "deep buffer output" : "primary output");
     return 0;
 }
 
@@ -639,6 +1009,9 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
                 do_out_standby(out);
                 pthread_mutex_unlock(&out->lock);
             }
+            /* a PCM kept warm would be on the wrong card for the new route */
+            if ((val ^ adev->out_device) & AUDIO_DEVICE_OUT_AUX_DIGITAL)
+                flush_pending_standby(adev, NULL);
 
             ALOGD("out_set_parameters::adev->out_device == 0x%8x", val);
             adev->out_device = val;
@@ -662,6 +1035,11 @@ static uint32_t out_get_latency(const struct audio_stream_out *stream)
     struct audio_device *adev = out->dev;
     size_t period_count;
 
+    if (out->low_latency)
+        return (OUT_LL_PERIOD_SIZE * OUT_LL_PERIOD_COUNT * 1000) / pcm_config_out_ll.rate;
+    if (out->deep_buffer)
+        return (OUT_DEEP_PERIOD_SIZE * OUT_DEEP_PERIOD_COUNT * 1000) / pcm_config_out_deep.rate;
+
     pthread_mutex_lock(&adev->lock);
 
     if (adev->screen_off && !adev->active_in && !(adev->out_device & AUDIO_DEVICE_OUT_ALL_SCO))
@@ -693,6 +1071,9 @@ static ssize_t out_write(struct audio_stream_out *stream, const void* buffer,
     int buffer_type;
     int kernel_frames;
     bool sco_on;
+    bool xrun = false;
+    int64_t start_us = audio_stats_now_us();
+    int64_t process_us;
 
 do_over:
     /*
@@ -703,16 +1084,28 @@ do_over:
      */
     pthread_mutex_lock(&adev->lock);
     pthread_mutex_lock(&out->lock);
-    if (out->standby) {
+    if (out->standby_pending) {
+        /* warm start: the PCM is still open and prepared */
+        out->standby_pending = false;
+        out->stats.warm_starts++;
+    } else if (out->standby) {
         ret = start_output_stream(out);
         if (ret != 0) {
             pthread_mutex_unlock(&adev->lock);
             goto exit;
         }
         out->standby = false;
+        out->stats.cold_starts++;
     }
-    buffer_type = ((adev->screen_off || adev->low_power) && !adev->active_in) ?
-            OUT_BUFFER_TYPE_LONG : OUT_BUFFER_TYPE_SHORT;
+    /* written is reset on every (re)start, so this only looks at a running PCM */
+    xrun = audio_stats_check_xrun(&out->stats, out->pcm,
+                                  (out->written > 0) &&
+                                  (out->written >= out->pcm_config->start_threshold));
+    buffer_type = ((adev->screen_off || adev->low_power) && !adev->active_in &&
+                   !out->low_latency) ? OUT_BUFFER_TYPE_LONG : OUT_BUFFER_TYPE_SHORT;
+    /* a deep buffer keeps its full buffer whatever the screen does */
+    if (out->pcm_config == &pcm_config_out_deep)
+        buffer_type = OUT_BUFFER_TYPE_LONG;
     sco_on = (adev->out_device & AUDIO_DEVICE_OUT_ALL_SCO);
     pthread_mutex_unlock(&adev->lock);
 
@@ -721,7 +1114,11 @@ do_over:
     if (!sco_on && (buffer_type != out->buffer_type)) {
         size_t period_count;
 
-        if (buffer_type == OUT_BUFFER_TYPE_LONG)
+        if (out->low_latency)
+            period_count = OUT_LL_PERIOD_COUNT;
+        else if (out->pcm_config == &pcm_config_out_deep)
+            period_count = OUT_DEEP_PERIOD_COUNT;
+        else if (buffer_type == OUT_BUFFER_TYPE_LONG)
             period_count = OUT_LONG_PERIOD_COUNT;
         else
             period_count = OUT_SHORT_PERIOD_COUNT;
@@ -749,9 +1146,11 @@ do_over:
     /* Change sample rate, if necessary */
     if (out_get_sample_rate(&stream->common) != out->pcm_config->rate) {
         out_frames = out->buffer_frames;
+        process_us = audio_stats_now_us();
         out->resampler->resample_from_input(out->resampler,
                                             in_buffer, &in_frames,
                                             out->buffer, &out_frames);
+        out->stats.process_us += audio_stats_now_us() - process_us;
         in_buffer = out->buffer;
     } else {
         out_frames = in_frames;
@@ -794,6 +1193,7 @@ do_over:
         } while ((kernel_frames > out->cur_write_threshold) &&
                 (total_sleep_time_us <= MAX_WRITE_SLEEP_US));
 #endif
+        out->stats.sleep_us += total_sleep_time_us;
 
         /* do not allow abrupt changes on buffer size. Increasing/decreasing
          * the threshold by steps of 1/4th of the buffer size keeps the write
@@ -821,11 +1221,22 @@ do_over:
     }
 
     ret = pcm_mmap_write(out->pcm, buffer, out_frames * frame_size);
+    if (ret == 0)
+        out->written += out_frames;
+
+    if ((ret == 0) && out->low_latency && (++out->ll_good_writes >= OUT_LL_XRUN_WINDOW)) {
+        out->ll_good_writes = 0;
+        out->ll_xruns = 0;
+    }
 
 exit:
 
     if (ret != 0) {
 	ALOGE("out_write(%p) failed: %d\n", stream, ret);
+        if (ret != -EPIPE)
+            out->stats.errors++;
+        else if (!xrun)
+            out->stats.xruns++;
         unsigned int usecs = bytes * 1000000 / audio_stream_frame_size(&stream->common) / out_get_sample_rate(&stream->common);
         ALOGD("usecs delay == %u", usecs);
         if (usecs >= 1000000L)
@@ -840,19 +1251,43 @@ exit:
         ALOGE("XRUN detected\n");
         pthread_mutex_lock(&adev->lock);
         pthread_mutex_lock(&out->lock);
+        if (out->low_latency && (++out->ll_xruns >= OUT_LL_MAX_XRUNS)) {
+            ALOGW("low latency output can't keep up, using the normal output config");
+            out->low_latency = false;
+            out->buffer_type = OUT_BUFFER_TYPE_UNKNOWN;
+        }
+        out->ll_good_writes = 0;
         do_out_standby(out);
         pthread_mutex_unlock(&out->lock);
         pthread_mutex_unlock(&adev->lock);
         goto do_over;
     }
 
+    audio_stats_transfer(&out->stats, start_us);
+
     return bytes;
 }
 
 static int out_get_render_position(const struct audio_stream_out *stream,
                                    uint32_t *dsp_frames)
 {
-    return -EINVAL;
+    struct stream_out *out = (struct stream_out *)stream;
+    unsigned int avail;
+    struct timespec time_stamp;
+    uint64_t queued;
+    int ret = -EINVAL;
+
+    pthread_mutex_lock(&out->lock);
+    /* read back from the mmap hw pointer: committed frames less those still queued */
+    if (!out->standby && out->pcm &&
+            (pcm_get_htimestamp(out->pcm, &avail, &time_stamp) == 0)) {
+        queued = pcm_get_buffer_size(out->pcm) - avail;
+        *dsp_frames = (uint32_t)((out->written > queued) ? (out->written - queued) : 0);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&out->lock);
+
+    return ret;
 }
 
 static int out_add_audio_effect(const struct audio_stream *stream, effect_handle_t effect)
@@ -932,6 +1367,9 @@ static int in_standby(struct audio_stream *stream)
 
 static int in_dump(const struct audio_stream *stream, int fd)
 {
+    struct stream_in *in = (struct stream_in *)stream;
+
+    audio_stats_dump(&in->stats, fd, "input");
     return 0;
 }
 
@@ -994,6 +1432,7 @@ static ssize_t in_read(struct audio_stream_in *stream, void* buffer,
     struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
     size_t frames_rq = bytes / audio_stream_frame_size(&stream->common);
+    int64_t start_us = audio_stats_now_us();
 
     /*
      * acquiring hw device mutex systematically is useful if a low
@@ -1005,17 +1444,25 @@ static ssize_t in_read(struct audio_stream_in *stream, void* buffer,
     pthread_mutex_lock(&in->lock);
     if (in->standby) {
         ret = start_input_stream(in);
-        if (ret == 0)
+        if (ret == 0) {
             in->standby = 0;
+            in->running = false;
+            in->stats.cold_starts++;
+        }
     }
     pthread_mutex_unlock(&adev->lock);
 
+    if (ret == 0)
+        audio_stats_check_xrun(&in->stats, in->pcm, in->running);
+
     if (ret < 0)
         goto exit;
 
     /*if (in->num_preprocessors != 0) {
         ret = process_frames(in, buffer, frames_rq);
-    } else */if (in->resampler != NULL) {
+    } else */if (in->decimator.factor != 0) {
+        ret = read_frames_decimated(in, (int16_t *)buffer, frames_rq);
+    } else if (in->resampler != NULL) {
         ret = read_frames(in, buffer, frames_rq);
     } else if (in->pcm_config->channels == 2) {
         /*
@@ -1044,11 +1491,16 @@ static ssize_t in_read(struct audio_stream_in *stream, void* buffer,
     if (ret == 0 && adev->mic_mute)
         memset(buffer, 0, bytes);
 
+    in->running = (ret == 0);
+
 exit:
-    if (ret < 0)
+    if (ret < 0) {
+        in->stats.errors++;
         usleep(bytes * 1000000 / audio_stream_frame_size(&stream->common) /
                in_get_sample_rate(&stream->common));
+    }
 
+    audio_stats_transfer(&in->stats, start_us);
     pthread_mutex_unlock(&in->lock);
     return bytes;
 }
@@ -1080,6 +1532,7 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
 {
     struct audio_device *adev = (struct audio_device *)dev;
     struct stream_out *out;
+    unsigned int i;
     int ret;
 
     ALOGD("%s(%p, 0x%04x, 0x%04x, %d, %p)", __FUNCTION__, dev, devices,
@@ -1108,11 +1561,21 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     out->stream.get_next_write_timestamp = out_get_next_write_timestamp;
 
     out->dev = adev;
+    out->fast = (flags & AUDIO_OUTPUT_FLAG_FAST) != 0;
+    out->low_latency = out->fast;
+    out->deep_buffer = !out->fast && ((flags & AUDIO_OUTPUT_FLAG_DEEP_BUFFER) != 0);
 
     pthread_mutex_lock(&adev->lock);
     adev->out_device &= ~AUDIO_DEVICE_OUT_ALL;
     adev->out_device |= devices;
     select_devices(adev);
+    /* untracked outputs still work, they just go to standby immediately */
+    for (i = 0; i < OUT_MAX_STREAMS; i++) {
+        if (!adev->outputs[i]) {
+            adev->outputs[i] = out;
+            break;
+        }
+    }
     pthread_mutex_unlock(&adev->lock);
 
     config->format = out_get_format(&out->stream.common);
@@ -1133,7 +1596,20 @@ err_open:
 static void adev_close_output_stream(struct audio_hw_device *dev,
                                      struct audio_stream_out *stream)
 {
-    out_standby(&stream->common);
+    struct audio_device *adev = (struct audio_device *)dev;
+    struct stream_out *out = (struct stream_out *)stream;
+    unsigned int i;
+
+    /* no keep-warm window for a stream that is going away */
+    pthread_mutex_lock(&adev->lock);
+    pthread_mutex_lock(&out->lock);
+    do_out_standby(out);
+    pthread_mutex_unlock(&out->lock);
+    for (i = 0; i < OUT_MAX_STREAMS; i++)
+        if (adev->outputs[i] == out)
+            adev->outputs[i] = NULL;
+    pthread_mutex_unlock(&adev->lock);
+
     free(stream);
 }
 
@@ -1184,6 +1660,26 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
             adev->screen_off = true;
     }
 
+    ret = str_parms_get_str(parms, "bt_wbs", value, sizeof(value));
+    if (ret >= 0) {
+        bool wb = (strcmp(value, AUDIO_PARAMETER_VALUE_ON) == 0);
+
+        pthread_mutex_lock(&adev->lock);
+        if (wb != adev->bt_wb_sco) {
+            struct stream_in *in = adev->active_in;
+
+            adev->bt_wb_sco = wb;
+            /* an open SCO capture has to reopen at the new rate */
+            if (in && ((in->pcm_config == &pcm_config_sco) ||
+                       (in->pcm_config == &pcm_config_sco_wb))) {
+                pthread_mutex_lock(&in->lock);
+                do_in_standby(in);
+                pthread_mutex_unlock(&in->lock);
+            }
+        }
+        pthread_mutex_unlock(&adev->lock);
+    }
+
     str_parms_destroy(parms);
     return ret;
 }
@@ -1340,6 +1836,13 @@ static int adev_close(hw_device_t *device)
 {
     struct audio_device *adev = (struct audio_device *)device;
 
+    pthread_mutex_lock(&adev->lock);
+    adev->standby_thread_exit = true;
+    pthread_cond_signal(&adev->standby_cond);
+    pthread_mutex_unlock(&adev->lock);
+    pthread_join(adev->standby_thread, NULL);
+    pthread_cond_destroy(&adev->standby_cond);
+
     audio_route_free(adev->ar);
     mixer_close(adev->mixer);
 
@@ -1395,6 +1898,17 @@ static int adev_open(const hw_module_t* module, const char* name,
     adev->out_device = AUDIO_DEVICE_OUT_SPEAKER;
     adev->in_device = AUDIO_DEVICE_IN_BUILTIN_MIC & ~AUDIO_DEVICE_BIT_IN;
 
+    pthread_cond_init(&adev->standby_cond, NULL);
+    ret = pthread_create(&adev->standby_thread, NULL, standby_thread_loop, adev);
+    if (ret != 0) {
+        ALOGE("Unable to create the standby thread: %d", ret);
+        pthread_cond_destroy(&adev->standby_cond);
+        audio_route_free(adev->ar);
+        mixer_close(adev->mixer);
+        free(adev);
+        return -ret;
+    }
+
     *device = &adev->hw_device.common;
 
     return 0;
@@ -141,6 +141,7 @@ static int path_add_setting(struct mixer_path *path,
     /* initialise the new path setting */
     ALOGV("INIT [%s] ctl %s -> %d", path->name, mixer_ctl_get_name(setting->ctl), setting->value);
     path->setting[path->length].ctl = setting->ctl;
+    path->setting[path->length].ctl_index = setting->ctl_index;
     path->setting[path->length].value = setting->value;
     path->length++;
 
@@ -168,30 +169,42 @@ static void path_print(struct mixer_path *path)
               path->setting[i].value);
 }
 
+/* stages a new value for a control, queueing it for the next update */
+static void mixer_state_set(struct audio_route *ar, unsigned int index,
+                            int value)
+{
+    struct mixer_state *ms = &ar->mixer_state[index];
+
+    ms->new_value = value;
+    if (!ms->dirty && ms->new_value != ms->old_value) {
+        ms->dirty = true;
+        ar->dirty_ctls[ar->num_dirty_ctls++] = index;
+    }
+}
+
 static int path_apply(struct audio_route *ar, struct mixer_path *path)
 {
     unsigned int i;
-    unsigned int j;
 
-    for (i = 0; i < path->length; i++) {
-        struct mixer_ctl *ctl = path->setting[i].ctl;
+    /* settings carry their mixer_state index, resolved at parse time */
+    for (i = 0; i < path->length; i++)
+        mixer_state_set(ar, path->setting[i].ctl_index, path->setting[i].value);
 
-        /* locate the mixer ctl in the list */
-        for (j = 0; j < ar->num_mixer_ctls; j++) {
-            if (ar->mixer_state[j].ctl == ctl)
-                break;
-        }
+    return 0;
+}
 
-        /* apply the new value */
-//        ALOGD("PRESET [%s] '%s' to '%d'\n", path->name,
-//                mixer_ctl_get_name(ar->mixer_state[j].ctl), path->setting[i].value);
-        ar->mixer_state[j].new_value = path->setting[i].value;
-    }
+/* mixer helper functions */
+static int mixer_state_find(struct audio_route *ar, struct mixer_ctl *ctl)
+{
+    unsigned int i;
 
-    return 0;
+    for (i = 0; i < ar->num_mixer_ctls; i++)
+        if (ar->mixer_state[i].ctl == ctl)
+            return i;
+
+    return -1;
 }
 
-/* mixer helper function */
 static int mixer_enum_string_to_value(struct mixer_ctl *ctl, const char *string)
 {
     unsigned int i;
@@ -218,6 +231,7 @@ static void start_tag(void *data, const XML_Char *tag_name,
     struct audio_route *ar = state->ar;
     unsigned int i;
     struct mixer_ctl *ctl;
+    int ctl_index;
     int value;
     struct mixer_setting mixer_setting;
 
@@ -248,6 +262,12 @@ static void start_tag(void *data, const XML_Char *tag_name,
     else if (strcmp(tag_name, "ctl") == 0) {
         /* Obtain the mixer ctl and value */
         ctl = mixer_get_ctl_by_name(audio_mixer, attr_name);
+        ctl_index = ctl ? mixer_state_find(ar, ctl) : -1;
+        if (ctl_index < 0) {
+            ALOGE("Unknown mixer ctl '%s'", attr_name ? attr_name : "");
+            goto done;
+        }
+
         switch (mixer_ctl_get_type(ctl)) {
         case MIXER_CTL_TYPE_BOOL:
         case MIXER_CTL_TYPE_INT:
@@ -263,24 +283,18 @@ static void start_tag(void *data, const XML_Char *tag_name,
 
         if (state->level == 1) {
             /* top level ctl (initial setting) */
-
-            /* locate the mixer ctl in the list */
-            for (i = 0; i < ar->num_mixer_ctls; i++) {
-                if (ar->mixer_state[i].ctl == ctl)
-                    break;
-            }
-
-            /* apply the new value */
-            ALOGV("INIT [default] ctl %s -> %d", mixer_ctl_get_name(ar->mixer_state[i].ctl), value);
-            ar->mixer_state[i].new_value = value;
+            ALOGV("INIT [default] ctl %s -> %d", mixer_ctl_get_name(ctl), value);
+            mixer_state_set(ar, ctl_index, value);
         } else {
             /* nested ctl (within a path) */
             mixer_setting.ctl = ctl;
+            mixer_setting.ctl_index = ctl_index;
             mixer_setting.value = value;
             path_add_setting(state->path, &mixer_setting);
         }
     }
 
+done:
     state->level++;
 }
 
@@ -300,11 +314,21 @@ static int alloc_mixer_state(struct audio_route *ar)
     if (!ar->mixer_state)
         return -1;
 
+    /* each control is queued at most once, so this never needs to grow */
+    ar->num_dirty_ctls = 0;
+    ar->dirty_ctls = malloc(ar->num_mixer_ctls * sizeof(unsigned int));
+    if (!ar->dirty_ctls) {
+        free(ar->mixer_state);
+        ar->mixer_state = NULL;
+        return -1;
+    }
+
     for (i = 0; i < ar->num_mixer_ctls; i++) {
         ar->mixer_state[i].ctl = mixer_get_ctl(audio_mixer, i);
         /* only get value 0, assume multiple ctl values are the same */
         ar->mixer_state[i].old_value = mixer_ctl_get_value(ar->mixer_state[i].ctl, 0);
         ar->mixer_state[i].new_value = ar->mixer_state[i].old_value;
+        ar->mixer_state[i].dirty = false;
     }
 
     return 0;
@@ -314,29 +338,36 @@ static void free_mixer_state(struct audio_route *ar)
 {
     free(ar->mixer_state);
     ar->mixer_state = NULL;
+    free(ar->dirty_ctls);
+    ar->dirty_ctls = NULL;
+    ar->num_dirty_ctls = 0;
 }
 
 void update_mixer_state(struct audio_route *ar)
 {
     unsigned int i;
     unsigned int j;
-    int ret;
-
-    for (i = 0; i < ar->num_mixer_ctls; i++) {
-        /* if the value has changed, update the mixer */
-        if (ar->mixer_state[i].old_value != ar->mixer_state[i].new_value) {
-            /* set all ctl values the same */
-            for (j = 0; j < mixer_ctl_get_num_values(ar->mixer_state[i].ctl); j++) {
-                ret = mixer_ctl_set_value(ar->mixer_state[i].ctl, j, ar->mixer_state[i].new_value);
-                ALOGD("SET '%s'.%d from '%d' to '%d'\n",
-                        mixer_ctl_get_name(ar->mixer_state[i].ctl),
-                        j,
-                        ar->mixer_state[i].old_value,
-                        ar->mixer_state[i].new_value);
-            }
-            ar->mixer_state[i].old_value = ar->mixer_state[i].new_value;
-        }
+    unsigned int num_values;
+    struct mixer_state *ms;
+
+    /* only controls touched since the last update are considered; a control
+       that was changed and then set back to its old value is skipped */
+    for (i = 0; i < ar->num_dirty_ctls; i++) {
+        ms = &ar->mixer_state[ar->dirty_ctls[i]];
+        ms->dirty = false;
+        if (ms->old_value == ms->new_value)
+            continue;
+
+        /* set all ctl values the same */
+        num_values = mixer_ctl_get_num_values(ms->ctl);
+        for (j = 0; j < num_values; j++)
+            mixer_ctl_set_value(ms->ctl, j, ms->new_value);
+        ALOGV("SET '%s' from '%d' to '%d' (%u values)",
+              mixer_ctl_get_name(ms->ctl), ms->old_value, ms->new_value,
+              num_values);
+        ms->old_value = ms->new_value;
     }
+    ar->num_dirty_ctls = 0;
 }
 
 /* saves the current state of the mixer, for resetting all controls */
@@ -357,7 +388,7 @@ void reset_mixer_state(struct audio_route *ar)
 
     /* load all of the saved values */
     for (i = 0; i < ar->num_mixer_ctls; i++)
-        ar->mixer_state[i].new_value = ar->mixer_state[i].reset_value;
+        mixer_state_set(ar, i, ar->mixer_state[i].reset_value);
 }
 
 void audio_route_apply_path(struct audio_route *ar, const char *name)
@@ -17,15 +17,19 @@
 #ifndef AUDIO_ROUTE_H
 #define AUDIO_ROUTE_H
 
+#include <stdbool.h>
+
 struct mixer_state {
     struct mixer_ctl *ctl;
     int old_value;
     int new_value;
     int reset_value;
+    bool dirty;
 };
 
 struct mixer_setting {
     struct mixer_ctl *ctl;
+    unsigned int ctl_index;     /* index into audio_route.mixer_state */
     int value;
 };
 
@@ -40,6 +44,10 @@ struct audio_route {
     unsigned int num_mixer_ctls;
     struct mixer_state *mixer_state;
 
+    /* indices of mixer_state entries whose new_value differs from old_value */
+    unsigned int num_dirty_ctls;
+    unsigned int *dirty_ctls;
+
     unsigned int mixer_path_size;
     unsigned int num_mixer_paths;
     struct mixer_path *mixer_path;
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_STATS_H
+#define AUDIO_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tinyalsa/asoundlib.h>
+
+/*
+ * Per-stream counters shared by the primary and HDMI HALs, printed by the
+ * stream dump() hook (dumpsys media.audio_flinger). They are updated by the
+ * stream's own thread and read without locking, so a dump may be one
+ * transfer behind.
+ */
+
+#define AUDIO_STATS_HIST_BUCKETS 8
+
+/* upper bound (ms) of each transfer time bucket, the last one is open ended */
+static const unsigned int audio_stats_hist_ms[AUDIO_STATS_HIST_BUCKETS - 1] = {
+    1, 2, 5, 10, 20, 50, 100
+};
+
+struct audio_stream_stats {
+    uint32_t xruns;             /* underruns (out) or overruns (in) from ALSA */
+    uint32_t errors;            /* other failed transfers */
+    uint32_t standbys;          /* PCM closed */
+    uint32_t cold_starts;       /* PCM opened */
+    uint32_t warm_starts;       /* restarted on a PCM kept open */
+    uint32_t transfers;
+    uint32_t hist[AUDIO_STATS_HIST_BUCKETS];
+    uint64_t transfer_us;
+    uint64_t max_transfer_us;
+    uint64_t sleep_us;          /* throttling sleeps inside write() */
+    uint64_t process_us;        /* resampling or decimation */
+};
+
+static inline int64_t audio_stats_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline void audio_stats_transfer(struct audio_stream_stats *s, int64_t start_us)
+{
+    uint64_t us = audio_stats_now_us() - start_us;
+    unsigned int i;
+
+    for (i = 0; i < AUDIO_STATS_HIST_BUCKETS - 1; i++)
+        if (us < audio_stats_hist_ms[i] * 1000)
+            break;
+
+    s->hist[i]++;
+    s->transfers++;
+    s->transfer_us += us;
+    if (us > s->max_transfer_us)
+        s->max_transfer_us = us;
+}
+
+/*
+ * tinyalsa restarts the PCM itself after EPIPE and returns 0, so xruns are
+ * looked for before each transfer instead: a PCM that was already running
+ * and is now stopped (the kernel stops it on xrun), or whose ring ran dry
+ * (playback) or full (capture), has had one since the last transfer.
+ */
+static inline bool audio_stats_check_xrun(struct audio_stream_stats *s, struct pcm *pcm,
+                                          bool running)
+{
+    unsigned int avail;
+    struct timespec ts;
+
+    if (!running || !pcm)
+        return false;
+
+    if ((pcm_get_htimestamp(pcm, &avail, &ts) == 0) && (avail < pcm_get_buffer_size(pcm)))
+        return false;
+
+    s->xruns++;
+    return true;
+}
+
+static inline void audio_stats_dump(const struct audio_stream_stats *s, int fd,
+                                    const char *name)
+{
+    char buf[512];
+    int len;
+    unsigned int i;
+
+    len = snprintf(buf, sizeof(buf),
+                   "  %s: transfers %u, avg %llu us, max %llu us\n"
+                   "    xruns %u, errors %u, standby %u, cold starts %u, warm starts %u\n"
+                   "    throttle sleep %llu ms, processing %llu ms\n"
+                   "    transfer time:",
+                   name, s->transfers,
+                   s->transfers ? (unsigned long long)(s->transfer_us / s->transfers) : 0ULL,
+                   (unsigned long long)s->max_transfer_us,
+                   s->xruns, s->errors, s->standbys, s->cold_starts, s->warm_starts,
+                   (unsigned long long)(s->sleep_us / 1000),
+                   (unsigned long long)(s->process_us / 1000));
+
+    for (i = 0; (i < AUDIO_STATS_HIST_BUCKETS) && (len < (int)sizeof(buf)); i++) {
+        if (i < AUDIO_STATS_HIST_BUCKETS - 1)
+            len += snprintf(buf + len, sizeof(buf) - len, " <%ums %u",
+                            audio_stats_hist_ms[i], s->hist[i]);
+        else
+            len += snprintf(buf + len, sizeof(buf) - len, " >=%ums %u\n",
+                            audio_stats_hist_ms[i - 1], s->hist[i]);
+    }
+
+    if (len > (int)sizeof(buf) - 1)
+        len = sizeof(buf) - 1;
+    write(fd, buf, len);
+}
+
+#endif
@@ -17,11 +17,19 @@
 #ifndef TI_HDMI_AUDIO_HAL
 #define TI_HDMI_AUDIO_HAL
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct _hdmi_audio_caps {
     int has_audio;
     int speaker_alloc;
+    int bitstream;      /* HDMI_BITSTREAM_* formats listed in the sink's SADs */
 } hdmi_audio_caps_t;
 
+/* Compressed formats the sink decodes (CEA Short Audio Descriptor codes) */
+#define HDMI_BITSTREAM_AC3 (1 << 0)
+#define HDMI_BITSTREAM_DTS (1 << 1)
+
 /* Speaker allocation bits */
 #define CEA_SPKR_FLFR   (1 << 0)
 #define CEA_SPKR_LFE    (1 << 1)
@@ -34,4 +42,27 @@ typedef struct _hdmi_audio_caps {
 /* Defined in file hdmi_audio_utils.c */
 int hdmi_query_audio_caps(const char* edid_path, hdmi_audio_caps_t *caps);
 
+/*
+ * IEC 61937 framing for compressed passthrough. Codec bytes are fed in
+ * arbitrary chunks; each complete codec frame becomes one data burst
+ * on a 2 channel, 16-bit PCM stream at the codec's sample rate.
+ */
+#define IEC61937_MAX_FRAME_BYTES 8184     /* largest payload of a 2048 frame burst */
+#define IEC61937_MAX_BURST_FRAMES 2048
+
+typedef struct _hdmi_iec61937 {
+    int type;                   /* HDMI_BITSTREAM_AC3 or HDMI_BITSTREAM_DTS */
+    uint8_t frame[IEC61937_MAX_FRAME_BYTES];
+    size_t fill;                /* bytes of the current codec frame staged */
+    size_t frame_bytes;         /* length of the current codec frame, 0 until known */
+    uint16_t pc;                /* burst info for the current frame */
+    unsigned int period;        /* burst repetition period in frames */
+} hdmi_iec61937_t;
+
+/* Defined in file hdmi_audio_iec61937.c */
+void hdmi_iec61937_init(hdmi_iec61937_t *s, int type);
+size_t hdmi_iec61937_feed(hdmi_iec61937_t *s, const uint8_t *src, size_t len);
+int hdmi_iec61937_ready(const hdmi_iec61937_t *s);
+unsigned int hdmi_iec61937_burst(hdmi_iec61937_t *s, int16_t *dst);
+
 #endif /* TI_HDMI_AUDIO_HAL */
@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include <cutils/atomic.h>
 #include <cutils/log.h>
 #include <cutils/str_parms.h>
 #include <cutils/properties.h>
@@ -47,7 +48,12 @@
 
 #include <OMX_Audio.h>
 
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
 #include "hdmi_audio_hal.h"
+#include "audio_stats.h"
 
 #define UNUSED(x) (void)(x)
 
@@ -61,9 +67,16 @@
 #define HDMI_PERIOD_SIZE 1920
 #define HDMI_PERIOD_COUNT 4
 #define HDMI_MAX_CHANNELS 8
+/* longest wait for room in the DMA buffer before giving up on a write */
+#define HDMI_WAIT_TIMEOUT_MS 500
 
 #define HDMI_EDID_PATH "/sys/devices/omapdss/display1/edid"
 
+/* Compressed formats for passthrough. audio_format_t has no codes for these
+ * yet; these are the values later system/audio.h releases assign. */
+#define HDMI_AUDIO_FORMAT_AC3 ((audio_format_t)0x09000000UL)
+#define HDMI_AUDIO_FORMAT_DTS ((audio_format_t)0x0B000000UL)
+
 typedef audio_hw_device_t hdmi_device_t;
 
 struct hdmi_device_t {
@@ -71,6 +84,11 @@ struct hdmi_device_t {
     bool CEAMap;
 };
 
+/* Bumped whenever the channel map changes, streams rebuild their remap table */
+static volatile int32_t hdmi_map_generation = 1;
+
+#define HDMI_REMAP_NONE (-1)
+
 int cea_channel_map[HDMI_MAX_CHANNELS] = {OMX_AUDIO_ChannelLF,OMX_AUDIO_ChannelRF,OMX_AUDIO_ChannelLFE,
         OMX_AUDIO_ChannelCF,OMX_AUDIO_ChannelLS,OMX_AUDIO_ChannelRS,
         OMX_AUDIO_ChannelLR,OMX_AUDIO_ChannelRR};  /*Using OMX_AUDIO_CHANNELTYPE mapping*/
@@ -82,7 +100,18 @@ typedef struct _hdmi_out {
     struct pcm *pcm;
     audio_config_t android_config;
     int up;
-    void *buffcpy;
+    int running;
+    uint64_t written; /* frames committed to the DMA buffer since leaving standby */
+    /* remap[y] is the source channel of CEA channel y, or HDMI_REMAP_NONE */
+    int remap[HDMI_MAX_CHANNELS];
+    int32_t remap_generation;
+#ifdef __ARM_NEON__
+    uint8x8x2_t remap_bytes;
+#endif
+    struct audio_stream_stats stats;
+    /* compressed passthrough, NULL for PCM streams */
+    hdmi_iec61937_t *iec;
+    int16_t *burst;
 } hdmi_out_t;
 
 #define S16_SIZE sizeof(int16_t)
@@ -120,7 +149,11 @@ size_t hdmi_out_get_buffer_size(const struct audio_stream *stream)
     struct pcm_config *config = &out->config;
     size_t ans;
 
-    ans = audio_stream_frame_size((struct audio_stream*)stream) * config->period_size;
+    if (out->iec)
+        /* codec bytes, sized like one period of the bursts they become */
+        ans = config->period_size * config->channels * S16_SIZE;
+    else
+        ans = audio_stream_frame_size((struct audio_stream*)stream) * config->period_size;
 
     TRACEM("stream=%p returning %u", stream, ans);
 
@@ -158,6 +191,7 @@ int hdmi_out_standby(struct audio_stream *stream)
         out->up = 0;
         pcm_close(out->pcm);
         out->pcm = 0;
+        out->stats.standbys++;
     }
 
     return 0;
@@ -165,7 +199,11 @@ int hdmi_out_standby(struct audio_stream *stream)
 
 int hdmi_out_dump(const struct audio_stream *stream, int fd)
 {
+    hdmi_out_t *out = (hdmi_out_t*)stream;
+
     TRACE();
+
+    audio_stats_dump(&out->stats, fd, "hdmi output");
     return 0;
 }
 
@@ -320,10 +358,13 @@ static int hdmi_out_open_pcm(hdmi_out_t *out)
         return 0;
     }
 
-    out->pcm = pcm_open(card, dev, PCM_OUT, &out->config);
+    out->pcm = pcm_open(card, dev, PCM_OUT | PCM_MMAP, &out->config);
 
     if(out->pcm && pcm_is_ready(out->pcm)) {
         out->up = 1;
+        out->running = 0;
+        out->written = 0;
+        out->stats.cold_starts++;
         ret = 0;
     } else {
         ALOGE("cannot open HDMI pcm card %d dev %d error: %s",
@@ -337,59 +378,204 @@ static int hdmi_out_open_pcm(hdmi_out_t *out)
     return ret;
 }
 
-void channel_remap(struct audio_stream_out *stream, const void *buffer,
-                    size_t bytes)
+/* Resolve the channel map into a per-stream permutation, once per map change */
+static void channel_remap_update(hdmi_out_t *out)
 {
-        hdmi_out_t *out = (hdmi_out_t*)stream;
         struct hdmi_device_t *adev = (struct hdmi_device_t *)out->dev;
-        int x, y, frames;
-        int16_t *buf = (int16_t *)buffer;
-        int16_t *tmp_buf = (int16_t *)out->buffcpy;
+        int channels = (int)out->config.channels;
+        /* before reading the map: a change made meanwhile must look newer */
+        int32_t generation = android_atomic_acquire_load(&hdmi_map_generation);
+        int x, y;
+
+        for (y = 0; y < HDMI_MAX_CHANNELS; y++) {
+            out->remap[y] = HDMI_REMAP_NONE;
+            for (x = 0; (y < channels) && (x < channels); x++) {
+                if (cea_channel_map[y] == adev->map[x]) {
+                    out->remap[y] = x;
+                    break;
+                }
+            }
+        }
+
+#ifdef __ARM_NEON__
+        /* Byte shuffle for one 8 channel frame, out of range indices give silence */
+        {
+            uint8_t idx[2 * HDMI_MAX_CHANNELS];
+            for (y = 0; y < HDMI_MAX_CHANNELS; y++) {
+                idx[2 * y] = (out->remap[y] == HDMI_REMAP_NONE) ? 0xFF : 2 * out->remap[y];
+                idx[2 * y + 1] = (out->remap[y] == HDMI_REMAP_NONE) ? 0xFF : 2 * out->remap[y] + 1;
+            }
+            out->remap_bytes.val[0] = vld1_u8(idx);
+            out->remap_bytes.val[1] = vld1_u8(idx + HDMI_MAX_CHANNELS);
+        }
+#endif
+
+        out->remap_generation = generation;
+}
+
+static void channel_remap(hdmi_out_t *out, const int16_t *buf, int16_t *tmp_buf,
+                          int frames)
+{
+        int y;
+        int channels = (int)out->config.channels;
+        const int *remap = out->remap;
+
+        if (channels == HDMI_MAX_CHANNELS) {
+#ifdef __ARM_NEON__
+            while (frames--) {
+                uint8x8x2_t in;
+                in.val[0] = vld1_u8((const uint8_t *)buf);
+                in.val[1] = vld1_u8((const uint8_t *)(buf + 4));
+                vst1_u8((uint8_t *)tmp_buf, vtbl2_u8(in, out->remap_bytes.val[0]));
+                vst1_u8((uint8_t *)(tmp_buf + 4), vtbl2_u8(in, out->remap_bytes.val[1]));
+                tmp_buf += HDMI_MAX_CHANNELS;
+                buf += HDMI_MAX_CHANNELS;
+            }
+#else
+            /* src[HDMI_MAX_CHANNELS] stays 0 and stands in for unmapped channels */
+            int16_t src[HDMI_MAX_CHANNELS + 1];
+            const int *r = remap;
+            int i0 = (r[0] < 0) ? HDMI_MAX_CHANNELS : r[0], i1 = (r[1] < 0) ? HDMI_MAX_CHANNELS : r[1];
+            int i2 = (r[2] < 0) ? HDMI_MAX_CHANNELS : r[2], i3 = (r[3] < 0) ? HDMI_MAX_CHANNELS : r[3];
+            int i4 = (r[4] < 0) ? HDMI_MAX_CHANNELS : r[4], i5 = (r[5] < 0) ? HDMI_MAX_CHANNELS : r[5];
+            int i6 = (r[6] < 0) ? HDMI_MAX_CHANNELS : r[6], i7 = (r[7] < 0) ? HDMI_MAX_CHANNELS : r[7];
+
+            src[HDMI_MAX_CHANNELS] = 0;
+            while (frames--) {
+                memcpy(src, buf, HDMI_MAX_CHANNELS * S16_SIZE);
+                tmp_buf[0] = src[i0];
+                tmp_buf[1] = src[i1];
+                tmp_buf[2] = src[i2];
+                tmp_buf[3] = src[i3];
+                tmp_buf[4] = src[i4];
+                tmp_buf[5] = src[i5];
+                tmp_buf[6] = src[i6];
+                tmp_buf[7] = src[i7];
+                tmp_buf += HDMI_MAX_CHANNELS;
+                buf += HDMI_MAX_CHANNELS;
+            }
+#endif
+            return;
+        }
 
-        frames = (bytes/audio_stream_frame_size(&out->stream_out.common));
         while (frames--){
-            for(y = 0; y < (int)out->config.channels; y++){
-                for(x = 0; x < (int)out->config.channels; x++){
-                    if (cea_channel_map[y] == adev->map[x]){
-                        tmp_buf[y] = buf[x];
-                        break;
-                    }
-                }
+            for(y = 0; y < channels; y++){
+                tmp_buf[y] = (remap[y] == HDMI_REMAP_NONE) ? 0 : buf[remap[y]];
             }
-            tmp_buf += (int)out->config.channels;
-            buf += (int)out->config.channels;
+            tmp_buf += channels;
+            buf += channels;
         }
 }
 
+/*
+ * Copy (or remap) straight into the DMA buffer. This is the loop
+ * pcm_mmap_write() runs, minus its intermediate copy for the remap case.
+ */
+static int hdmi_out_mmap_write(hdmi_out_t *out, const int16_t *src,
+                               unsigned int frames, bool remap)
+{
+    unsigned int channels = out->config.channels;
+    unsigned int buffer_size = pcm_get_buffer_size(out->pcm);
+    unsigned int start_threshold = out->config.start_threshold ? out->config.start_threshold :
+            (out->config.period_count * out->config.period_size / 2);
+
+    while (frames > 0) {
+        void *areas;
+        unsigned int offset, chunk;
+        int avail = pcm_avail_update(out->pcm);
+
+        if (avail < 0)
+            return avail;
+
+        if (!out->running && ((buffer_size - avail) >= start_threshold || avail == 0)) {
+            if (pcm_start(out->pcm) < 0)
+                return -EIO;
+            out->running = 1;
+        }
+
+        if (avail == 0) {
+            int ret = pcm_wait(out->pcm, HDMI_WAIT_TIMEOUT_MS);
+            if (ret < 0)
+                return ret;
+            if (ret == 0)
+                return -ETIMEDOUT;
+            continue;
+        }
+
+        chunk = ((unsigned int)avail < frames) ? (unsigned int)avail : frames;
+        if (pcm_mmap_begin(out->pcm, &areas, &offset, &chunk) < 0)
+            return -EIO;
+
+        if (remap)
+            channel_remap(out, src, (int16_t *)areas + offset * channels, chunk);
+        else
+            memcpy((int16_t *)areas + offset * channels, src, chunk * channels * S16_SIZE);
+
+        if (pcm_mmap_commit(out->pcm, offset, chunk) < 0)
+            return -EIO;
+
+        src += chunk * channels;
+        frames -= chunk;
+        out->written += chunk;
+    }
+
+    return 0;
+}
+
 ssize_t hdmi_out_write(struct audio_stream_out *stream, const void* buffer,
 		 size_t bytes)
 {
     hdmi_out_t *out = (hdmi_out_t*)stream;
     struct hdmi_device_t *adev = (struct hdmi_device_t *)out->dev;
+    unsigned int frames = bytes / audio_stream_frame_size(&out->stream_out.common);
+    bool remap = out->config.channels > 2 && !adev->CEAMap;
+    int64_t start_us = audio_stats_now_us();
     ssize_t ret;
 
     TRACEM("stream=%p buffer=%p bytes=%d", stream, buffer, bytes);
 
+    /* the DMA stopped since the last write: restart rather than write into it */
+    if (out->up && audio_stats_check_xrun(&out->stats, out->pcm, out->running))
+        hdmi_out_standby((struct audio_stream*)stream);
+
     if (!out->up) {
         if(hdmi_out_open_pcm(out)) {
             return -ENOSYS;
         }
     }
 
-    if (out->config.channels > 2 && !adev->CEAMap){
-        channel_remap(stream, buffer, bytes);
-        ret = pcm_write(out->pcm, out->buffcpy, bytes);
+    if (out->iec) {
+        /* passthrough: wrap each codec frame in a burst, no decode or remap */
+        const uint8_t *src = buffer;
+        size_t used = 0;
+
+        ret = 0;
+        while (!ret && (used < bytes)) {
+            used += hdmi_iec61937_feed(out->iec, src + used, bytes - used);
+            if (hdmi_iec61937_ready(out->iec)) {
+                frames = hdmi_iec61937_burst(out->iec, out->burst);
+                ret = hdmi_out_mmap_write(out, out->burst, frames, false);
+            }
+        }
     } else {
-       ret = pcm_write(out->pcm, buffer, bytes);
+        if (remap && (out->remap_generation != android_atomic_acquire_load(&hdmi_map_generation)))
+            channel_remap_update(out);
+
+        ret = hdmi_out_mmap_write(out, (const int16_t *)buffer, frames, remap);
     }
     if (ret) {
         ALOGE("Error writing to HDMI pcm: %s", pcm_get_error(out->pcm));
         ret = (ret < 0) ? ret : -ret;
+        if (ret == -EPIPE)
+            out->stats.xruns++;
+        else
+            out->stats.errors++;
         hdmi_out_standby((struct audio_stream*)stream);
     } else {
         ret = bytes;
     }
 
+    audio_stats_transfer(&out->stats, start_us);
     return ret;
 }
 
@@ -397,8 +583,24 @@ ssize_t hdmi_out_write(struct audio_stream_out *stream, const void* buffer,
 int hdmi_out_get_render_position(const struct audio_stream_out *stream,
 			   uint32_t *dsp_frames)
 {
+    hdmi_out_t *out = (hdmi_out_t*)stream;
+    unsigned int avail;
+    struct timespec timestamp;
+    uint64_t queued;
+
     TRACE();
-    return -EINVAL;
+
+    if (!out->up || !out->pcm)
+        return -EINVAL;
+
+    /* hw pointer of the mmap buffer: what was committed less what is still queued */
+    if (pcm_get_htimestamp(out->pcm, &avail, &timestamp) < 0)
+        return -EINVAL;
+
+    queued = pcm_get_buffer_size(out->pcm) - avail;
+    *dsp_frames = (uint32_t)((out->written > queued) ? (out->written - queued) : 0);
+
+    return 0;
 }
 
 int hdmi_out_get_next_write_timestamp(const struct audio_stream_out *stream,
@@ -517,6 +719,7 @@ static int hdmi_adev_set_parameters(audio_hw_device_t *dev, const char *kv_pairs
             adev->CEAMap = true;
         else
             adev->CEAMap = false;
+        android_atomic_inc(&hdmi_map_generation);
     }
     return 0;
 }
@@ -598,12 +801,42 @@ static int hdmi_adev_open_output_stream(audio_hw_device_t *dev,
     case AUDIO_FORMAT_PCM_16_BIT:
         pcm_config->format = PCM_FORMAT_S16_LE;
         break;
+    case HDMI_AUDIO_FORMAT_AC3:
+    case HDMI_AUDIO_FORMAT_DTS:
+    {
+        hdmi_audio_caps_t caps;
+        int type = (a_config->format == HDMI_AUDIO_FORMAT_AC3) ?
+            HDMI_BITSTREAM_AC3 : HDMI_BITSTREAM_DTS;
+
+        /* only offer passthrough to a sink that decodes the format */
+        if (hdmi_query_audio_caps(HDMI_EDID_PATH, &caps) || !(caps.bitstream & type)) {
+            ALOGE("HDMI sink can't decode format %x", config->format);
+            goto fail;
+        }
+
+        out->iec = malloc(sizeof(hdmi_iec61937_t));
+        out->burst = malloc(IEC61937_MAX_BURST_FRAMES * 2 * S16_SIZE);
+        if (!out->iec || !out->burst) {
+            goto fail;
+        }
+        hdmi_iec61937_init(out->iec, type);
+
+        /* bursts go out as 2 channel PCM at the codec's rate */
+        pcm_config->format = PCM_FORMAT_S16_LE;
+        pcm_config->channels = 2;
+        ALOGV("HDMI passthrough of format %x at %d Hz", config->format, pcm_config->rate);
+        break;
+    }
     default:
         ALOGE("HDMI rejecting format %x", config->format);
         goto fail;
     }
 
     a_config->channel_mask = config->channel_mask;
+    if (out->iec) {
+        /* the burst carries the codec's own channel layout */
+        goto done;
+    }
     switch (config->channel_mask) {
     case AUDIO_CHANNEL_OUT_STEREO:
         pcm_config->channels = 2;
@@ -625,19 +858,17 @@ static int hdmi_adev_open_output_stream(audio_hw_device_t *dev,
         pcm_config->channels = 8;
     }
 
-    //Allocating buffer for at most 8 channels
-    out->buffcpy = malloc(pcm_config->period_size * sizeof(int16_t) * HDMI_MAX_CHANNELS);
-    if (!out->buffcpy){
-        ALOGE("Could not allocate memory");
-        goto fail;
-    }
+    channel_remap_update(out);
 
+done:
     ALOGV("stream = %p", out);
     *stream_out = &out->stream_out;
 
     return 0;
 
 fail:
+    free(out->iec);
+    free(out->burst);
     free(out);
     return -ENOSYS;
 }
@@ -650,8 +881,8 @@ static void hdmi_adev_close_output_stream(audio_hw_device_t *dev,
     TRACEM("dev=%p stream_out=%p", dev, stream_out);
 
     stream_out->common.standby((audio_stream_t*)stream_out);
-    free(out->buffcpy);
-    out->buffcpy = NULL;
+    free(out->iec);
+    free(out->burst);
     free(stream_out);
 }
 
@@ -0,0 +1,232 @@
+/* -*- mode: C; c-file-style: "stroustrup"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (C) 2012 Texas Instruments
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "hdmi_audio_iec61937"
+/* #define LOG_NDEBUG 0 */
+
+#include <string.h>
+
+#include <cutils/log.h>
+
+#include "hdmi_audio_hal.h"
+
+/*****************************************************************
+ * IEC 61937 DATA BURSTS
+ *
+ * References:
+ *
+ *   - IEC 61937-1, Digital audio - Interface for non-linear PCM
+ *     encoded audio bitstreams applying IEC 60958 (General)
+ *
+ *   - IEC 61937-3 (AC-3) and IEC 61937-5 (DTS)
+ *
+ *   - ATSC A/52, Digital Audio Compression (AC-3) Standard
+ *     (Section 5.4.1 "syncinfo", Table 5.18 frame sizes)
+ *
+ * Summary: a burst is the preamble Pa, Pb (sync), Pc (data type) and
+ * Pd (payload length in bits), followed by the codec frame as 16-bit
+ * big-endian words, zero padded to the repetition period: the frame's
+ * sample count, in 2 channel frames. The sink finds the preamble in
+ * what otherwise looks like a PCM stream.
+ *
+ *****************************************************************
+ */
+
+#define IEC61937_PA 0xF872
+#define IEC61937_PB 0x4E1F
+#define IEC61937_HEADER_BYTES 8
+
+#define IEC61937_TYPE_AC3      0x01
+#define IEC61937_TYPE_DTS_512  0x0B
+#define IEC61937_TYPE_DTS_1024 0x0C
+#define IEC61937_TYPE_DTS_2048 0x0D
+
+#define AC3_SAMPLES 1536
+#define AC3_HEADER_BYTES 6
+#define DTS_HEADER_BYTES 10
+
+/* A/52 Table 5.18 nominal bit rates (kbps), indexed by frmsizecod / 2 */
+static const unsigned int ac3_bitrates[] = {
+    32, 40, 48, 56, 64, 80, 96, 112, 128, 160,
+    192, 224, 256, 320, 384, 448, 512, 576, 640,
+};
+
+void hdmi_iec61937_init(hdmi_iec61937_t *s, int type)
+{
+    memset(s, 0, sizeof(*s));
+    s->type = type;
+}
+
+static size_t header_bytes(const hdmi_iec61937_t *s)
+{
+    return (s->type == HDMI_BITSTREAM_AC3) ? AC3_HEADER_BYTES : DTS_HEADER_BYTES;
+}
+
+/* offset of the first sync word in src, or len when there is none */
+static size_t find_sync(const hdmi_iec61937_t *s, const uint8_t *src, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < len; i++) {
+        if (s->type == HDMI_BITSTREAM_AC3) {
+            if (src[i] == 0x0B && src[i + 1] == 0x77)
+                return i;
+        } else if (src[i] == 0x7F && src[i + 1] == 0xFE) {
+            /* 16-bit big-endian core sync, 0x7FFE8001 */
+            if (i + 3 >= len || (src[i + 2] == 0x80 && src[i + 3] == 0x01))
+                return i;
+        }
+    }
+
+    /* a trailing first sync byte may pair with the next chunk */
+    if (len && src[len - 1] == ((s->type == HDMI_BITSTREAM_AC3) ? 0x0B : 0x7F))
+        return len - 1;
+
+    return len;
+}
+
+/* Sets frame_bytes, pc and period from the staged header, 0 on success */
+static int parse_header(hdmi_iec61937_t *s)
+{
+    const uint8_t *h = s->frame;
+
+    if (s->type == HDMI_BITSTREAM_AC3) {
+        unsigned int fscod = h[4] >> 6;
+        unsigned int frmsizecod = h[4] & 0x3F;
+        unsigned int kbps, words;
+
+        if ((fscod == 3) || (frmsizecod / 2 >= sizeof(ac3_bitrates) / sizeof(ac3_bitrates[0])))
+            return -1;
+
+        kbps = ac3_bitrates[frmsizecod / 2];
+        if (fscod == 0)         /* 48 kHz */
+            words = kbps * 2;
+        else if (fscod == 1)    /* 44.1 kHz, odd codes carry one more word */
+            words = (kbps * 1000 * AC3_SAMPLES) / (44100 * 16) + (frmsizecod & 1);
+        else                    /* 32 kHz */
+            words = kbps * 3;
+
+        s->frame_bytes = words * 2;
+        s->period = AC3_SAMPLES;
+        /* bsmod goes in the data type dependent bits */
+        s->pc = IEC61937_TYPE_AC3 | ((h[5] & 0x07) << 8);
+    } else {
+        unsigned int nblks = ((h[4] & 0x01) << 6) | (h[5] >> 2);
+        unsigned int fsize = (((h[5] & 0x03) << 12) | (h[6] << 4) | (h[7] >> 4)) + 1;
+
+        /* find_sync() may have stopped on a 0x7FFE at the end of a chunk */
+        if (h[2] != 0x80 || h[3] != 0x01)
+            return -1;
+
+        s->period = (nblks + 1) * 32;
+        switch (s->period) {
+        case 512:
+            s->pc = IEC61937_TYPE_DTS_512;
+            break;
+        case 1024:
+            s->pc = IEC61937_TYPE_DTS_1024;
+            break;
+        case 2048:
+            s->pc = IEC61937_TYPE_DTS_2048;
+            break;
+        default:
+            return -1;
+        }
+        s->frame_bytes = fsize;
+    }
+
+    if ((s->frame_bytes < header_bytes(s)) ||
+        (s->frame_bytes > s->period * 4 - IEC61937_HEADER_BYTES)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Stages codec bytes until one full frame is held, returns the number of
+ * bytes consumed. Garbage before a sync word and frames with a bad header
+ * are dropped.
+ */
+size_t hdmi_iec61937_feed(hdmi_iec61937_t *s, const uint8_t *src, size_t len)
+{
+    size_t used = 0;
+    size_t n;
+
+    while (used < len && !hdmi_iec61937_ready(s)) {
+        if (s->fill == 0) {
+            n = find_sync(s, src + used, len - used);
+            if (n)
+                ALOGV("skipping %u bytes before sync", (unsigned int)n);
+            used += n;
+            if (used == len)
+                break;
+        }
+
+        n = s->frame_bytes ? (s->frame_bytes - s->fill) : (header_bytes(s) - s->fill);
+        if (n > len - used)
+            n = len - used;
+        memcpy(s->frame + s->fill, src + used, n);
+        s->fill += n;
+        used += n;
+
+        if (!s->frame_bytes && (s->fill == header_bytes(s)) && parse_header(s)) {
+            ALOGW("dropping frame with a bad header");
+            s->fill = 0;
+            s->frame_bytes = 0;
+        }
+    }
+
+    return used;
+}
+
+int hdmi_iec61937_ready(const hdmi_iec61937_t *s)
+{
+    return s->frame_bytes && (s->fill == s->frame_bytes);
+}
+
+/*
+ * Writes the burst for the staged frame to dst (period * 2 samples) and
+ * returns its length in 2 channel frames, 0 when no frame is staged.
+ */
+unsigned int hdmi_iec61937_burst(hdmi_iec61937_t *s, int16_t *dst)
+{
+    unsigned int words = (s->frame_bytes + 1) / 2;
+    unsigned int period = s->period;
+    unsigned int i;
+    const uint8_t *p = s->frame;
+
+    if (!hdmi_iec61937_ready(s))
+        return 0;
+
+    /* an odd length frame is padded with a zero byte */
+    if (s->frame_bytes & 1)
+        s->frame[s->frame_bytes] = 0;
+
+    dst[0] = (int16_t)IEC61937_PA;
+    dst[1] = (int16_t)IEC61937_PB;
+    dst[2] = (int16_t)s->pc;
+    dst[3] = (int16_t)(s->frame_bytes * 8);
+    for (i = 0; i < words; i++, p += 2)
+        dst[4 + i] = (int16_t)((p[0] << 8) | p[1]);
+    memset(dst + 4 + words, 0, (period * 2 - 4 - words) * sizeof(int16_t));
+
+    s->fill = 0;
+    s->frame_bytes = 0;
+
+    return period;
+}
@@ -89,6 +89,27 @@
 #define CEA_TAG_SPKRS (4 << 5)
 #define CEA_BIT_AUDIO (1 << 6)
 
+/* Returns the HDMI_BITSTREAM_* formats listed in a CEA audio data block */
+static int hdmi_parse_short_audio_descriptor_block(unsigned char *mem)
+{
+    int size = *mem & CEA_SIZE_MASK;
+    unsigned char *p, *end = mem + 1 + size;
+    int formats = 0;
+
+    for (p = mem + 1 ; p + 3 <= end ; p += 3) {
+        switch ((p[0] & 0x78) >> 3) {
+        case 2:
+            formats |= HDMI_BITSTREAM_AC3;
+            break;
+        case 7:
+            formats |= HDMI_BITSTREAM_DTS;
+            break;
+        }
+    }
+
+    return formats;
+}
+
 static void hdmi_dump_short_audio_descriptor_block(unsigned char *mem)
 {
     const unsigned char FORMAT_MASK = 0x78;
@@ -154,6 +175,7 @@ int hdmi_query_audio_caps(const char* edid_path, hdmi_audio_caps_t *caps)
 
     int has_audio = 0;
     int speaker_alloc = 0;
+    int bitstream = 0;
     int done = 0;
 
     memset(edid, 0, sizeof(edid));
@@ -207,8 +229,8 @@ int hdmi_query_audio_caps(const char* edid_path, hdmi_audio_caps_t *caps)
 
                 switch (tag) {
                 case CEA_TAG_AUDIO:
-                    /* ignore for now, needed for bitstream. */
                     hdmi_dump_short_audio_descriptor_block(&edid[index + n - 1]);
+                    bitstream |= hdmi_parse_short_audio_descriptor_block(&edid[index + n - 1]);
                     break;
                 case CEA_TAG_SPKRS: /* I think this fails... not sure why */
                     ALOGE_IF(size != 3, "CEA Speaker Allocation Block is wrong size "
@@ -228,6 +250,7 @@ int hdmi_query_audio_caps(const char* edid_path, hdmi_audio_caps_t *caps)
 
     caps->has_audio = has_audio;
     caps->speaker_alloc = speaker_alloc;
+    caps->bitstream = bitstream;
 
     return 0;
 }
@@ -259,6 +282,7 @@ int main(int argc, char* argv[])
     printf("caps = {\n");
     printf("  .has_audio = %d\n", caps.has_audio);
     printf("  .speaker_alloc = 0x%02x\n", caps.speaker_alloc);
+    printf("  .bitstream = 0x%02x\n", caps.bitstream);
     printf("}\n");
 
     return 0;
@@ -84,3 +84,12 @@ ALL_DEFAULT_INSTALLED_MODULES += $(SYMLINKS) $(SYMLINKS1)
 # for mm/mmm
 all_modules: $(SYMLINKS) $(SYMLINKS1)
 
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := bvbench.c
+LOCAL_C_INCLUDES := \
+	$(COMMON_FOLDER)/bltsville/bltsville/include \
+	$(COMMON_FOLDER)/bltsville/ocd/include
+LOCAL_SHARED_LIBRARIES := libdl
+LOCAL_MODULE := bvbench
+LOCAL_MODULE_TAGS := optional tests
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2012,
+ * Texas Instruments, Inc. and Vivante Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Texas Instruments, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL TEXAS INSTRUMENTS, INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Throughput benchmark for a BLTsville implementation.
+ *
+ * The implementation is loaded the way its clients load it, so the GC320
+ * (libbltsville_hw2d.so, the default) and the CPU one
+ * (libbltsville_cpu.so) can be compared on the same blits. Every config
+ * blits a square source into a quarter of the destination, cycling the
+ * quadrant so consecutive blits never share a destination rectangle, and
+ * reports:
+ *
+ *   Mpix/s  destination pixels written per second, with the blits queued
+ *           asynchronously and a synchronous one at the end to drain
+ *   cpu     thread CPU time spent inside bv_blt() per blit
+ *   submit  wall time of the asynchronous bv_blt() calls (p50/p99)
+ *   sync    wall time of a synchronous blit, submission to completion
+ */
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <bltsville.h>
+#include <bventry.h>
+
+#define BENCH_SYNC_SAMPLES 16
+#define BENCH_BATCH_ALL 0x7FFFFFFF /* every BVBATCH_* but BVBATCH_ENDNOP */
+
+static const char *libname = "libbltsville_hw2d.so";
+static unsigned int width = 1280, height = 800;
+static int iterations = 200;
+
+static BVFN_MAP bv_map;
+static BVFN_BLT bv_blt;
+static BVFN_UNMAP bv_unmap;
+
+struct format {
+	const char *name;
+	enum ocdformat format;
+	unsigned int bpp;		/* bits per pixel of the first plane */
+	unsigned int planesize;		/* whole buffer, in eighths of plane 0 */
+};
+
+static const struct format formats[] = {
+	{ "RGB565",   OCDFMT_RGB16,  16, 8 },
+	{ "ARGB8888", OCDFMT_BGRA24, 32, 8 },
+	{ "NV12",     OCDFMT_NV12,    8, 12 },
+	{ "UYVY",     OCDFMT_UYVY,   16, 8 },
+};
+#define FORMAT_COUNT (sizeof(formats) / sizeof(formats[0]))
+#define FORMAT_ARGB (&formats[1])
+
+struct config {
+	const struct format *src;
+	unsigned int num, den;		/* source size / destination size */
+	int rotation;			/* destination orientation */
+	int blend;			/* SRC1OVER onto the destination */
+	int batch;			/* blits per batch */
+};
+
+struct surface {
+	struct bvbuffdesc desc;
+	struct bvsurfgeom geom;
+	void *buffer;
+};
+
+static int64_t clock_us(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int load_bltsville(void)
+{
+	void *lib = dlopen(libname, RTLD_NOW);
+
+	if (!lib) {
+		printf("unable to load %s: %s\n", libname, dlerror());
+		return -1;
+	}
+
+	bv_map = (BVFN_MAP)dlsym(lib, "bv_map");
+	bv_blt = (BVFN_BLT)dlsym(lib, "bv_blt");
+	bv_unmap = (BVFN_UNMAP)dlsym(lib, "bv_unmap");
+	if (!bv_map || !bv_blt || !bv_unmap) {
+		printf("%s does not export the BLTsville entry points\n",
+		       libname);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int surface_alloc(struct surface *s, const struct format *f,
+			 unsigned int w, unsigned int h)
+{
+	/* strides the GC320 accepts for every format */
+	unsigned int stride = ((w * f->bpp / 8) + 63) & ~63;
+	unsigned long length = (unsigned long)stride * h * f->planesize / 8;
+
+	memset(s, 0, sizeof(*s));
+	if (posix_memalign(&s->buffer, getpagesize(), length))
+		return -1;
+	memset(s->buffer, 0x80, length);
+
+	s->desc.structsize = sizeof(s->desc);
+	s->desc.virtaddr = s->buffer;
+	s->desc.length = length;
+	s->desc.auxtype = BVAT_NONE;
+
+	s->geom.structsize = sizeof(s->geom);
+	s->geom.format = f->format;
+	s->geom.width = w;
+	s->geom.height = h;
+	s->geom.virtstride = stride;
+
+	if (bv_map(&s->desc) != BVERR_NONE) {
+		free(s->buffer);
+		s->buffer = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void surface_free(struct surface *s)
+{
+	if (!s->buffer)
+		return;
+	bv_unmap(&s->desc);
+	free(s->buffer);
+	s->buffer = NULL;
+}
+
+static void config_name(const struct config *c, char *name, size_t size)
+{
+	snprintf(name, size, "%s %u:%u rot%d%s b%d", c->src->name, c->num,
+		 c->den, c->rotation, c->blend ? " blend" : "", c->batch);
+}
+
+static void setup_blit(const struct config *c, struct bvbltparams *bp,
+		       struct surface *src, struct surface *dst,
+		       unsigned int size)
+{
+	memset(bp, 0, sizeof(*bp));
+	bp->structsize = sizeof(*bp);
+
+	if (c->blend) {
+		bp->flags = BVFLAG_BLEND;
+		bp->op.blend = BVBLEND_SRC1OVER;
+		bp->src2.desc = &dst->desc;
+		bp->src2geom = &dst->geom;
+	} else {
+		bp->flags = BVFLAG_ROP;
+		bp->op.rop = 0xCCCC; /* SRCCOPY */
+	}
+	bp->flags |= BVFLAG_CLIP;
+	bp->scalemode = (c->src->format == OCDFMT_NV12) ?
+			BVSCALE_9x9_TAP : BVSCALE_BILINEAR;
+
+	bp->dstdesc = &dst->desc;
+	bp->dstgeom = &dst->geom;
+	bp->dstrect.width = bp->dstrect.height = size;
+	bp->cliprect.width = bp->cliprect.height = size;
+
+	bp->src1.desc = &src->desc;
+	bp->src1geom = &src->geom;
+	bp->src1rect.width = src->geom.width;
+	bp->src1rect.height = src->geom.height;
+}
+
+/* Points the blit at the quadrant for its index and sets the batch flags */
+static void place_blit(const struct config *c, struct bvbltparams *bp,
+		       unsigned int size, int index, struct bvbatch *batch)
+{
+	int pos = index % c->batch;
+
+	bp->dstrect.left = bp->cliprect.left = (index & 1) ? size : 0;
+	bp->dstrect.top = bp->cliprect.top = (index & 2) ? size : 0;
+	if (c->blend)
+		bp->src2rect = bp->dstrect;
+
+	bp->flags &= ~BVFLAG_BATCH_MASK;
+	bp->batchflags = 0;
+	if (c->batch == 1)
+		return;
+
+	if (pos == 0) {
+		bp->flags |= BVFLAG_BATCH_BEGIN;
+		bp->batchflags = BENCH_BATCH_ALL;
+	} else {
+		bp->flags |= (pos == c->batch - 1) ?
+			     BVFLAG_BATCH_END : BVFLAG_BATCH_CONTINUE;
+		bp->batchflags = BVBATCH_DSTRECT_ORIGIN |
+				 BVBATCH_CLIPRECT_ORIGIN |
+				 (c->blend ? BVBATCH_SRC2RECT_ORIGIN : 0);
+		bp->batch = batch;
+	}
+}
+
+static void run_config(const struct config *c)
+{
+	struct surface src, dst;
+	struct bvbltparams bp;
+	struct bvbatch *batch = NULL;
+	unsigned int size = (width < height ? width : height) / 2;
+	unsigned int srcsize = ((size * c->num / c->den) + 15) & ~15;
+	unsigned int *submit = NULL;
+	unsigned int sync[BENCH_SYNC_SAMPLES];
+	unsigned int blits, i, n = 0, errors = 0;
+	int64_t start, wall, cpu = 0, t, tc;
+	char name[48];
+
+	config_name(c, name, sizeof(name));
+
+	/* whole batches only, so the last one is ended */
+	blits = ((iterations + c->batch - 1) / c->batch) * c->batch;
+
+	if (surface_alloc(&dst, FORMAT_ARGB, width, height)) {
+		printf("%-34s destination allocation failed\n", name);
+		return;
+	}
+	dst.geom.orientation = c->rotation;
+	if (c->rotation % 180) {
+		dst.geom.width = height;
+		dst.geom.height = width;
+	}
+	if (surface_alloc(&src, c->src, srcsize, srcsize)) {
+		printf("%-34s source allocation failed\n", name);
+		surface_free(&dst);
+		return;
+	}
+
+	submit = malloc(blits * sizeof(*submit));
+	if (!submit)
+		goto out;
+
+	setup_blit(c, &bp, &src, &dst, size);
+
+	/* warm up the implementation's caches and the mappings */
+	place_blit(c, &bp, size, 0, NULL);
+	bp.flags &= ~BVFLAG_BATCH_MASK;
+	if (bv_blt(&bp) != BVERR_NONE) {
+		printf("%-34s not supported: %s\n", name,
+		       bp.errdesc ? bp.errdesc : "no description");
+		goto out;
+	}
+
+	start = clock_us(CLOCK_MONOTONIC);
+	for (i = 0; i < blits; i++) {
+		place_blit(c, &bp, size, i, batch);
+		bp.flags |= BVFLAG_ASYNC;
+
+		tc = clock_us(CLOCK_THREAD_CPUTIME_ID);
+		t = clock_us(CLOCK_MONOTONIC);
+		if (bv_blt(&bp) != BVERR_NONE) {
+			errors++;
+			continue;
+		}
+		submit[n++] = (unsigned int)(clock_us(CLOCK_MONOTONIC) - t);
+		cpu += clock_us(CLOCK_THREAD_CPUTIME_ID) - tc;
+
+		if (bp.flags & BVFLAG_BATCH_BEGIN)
+			batch = bp.batch;
+	}
+
+	/* a synchronous blit completes after everything queued before it */
+	place_blit(c, &bp, size, 0, NULL);
+	bp.flags &= ~(BVFLAG_BATCH_MASK | BVFLAG_ASYNC);
+	bv_blt(&bp);
+	wall = clock_us(CLOCK_MONOTONIC) - start;
+
+	for (i = 0; i < BENCH_SYNC_SAMPLES; i++) {
+		place_blit(c, &bp, size, i, NULL);
+		bp.flags &= ~(BVFLAG_BATCH_MASK | BVFLAG_ASYNC);
+		t = clock_us(CLOCK_MONOTONIC);
+		bv_blt(&bp);
+		sync[i] = (unsigned int)(clock_us(CLOCK_MONOTONIC) - t);
+	}
+
+	if (!n) {
+		printf("%-34s every blit failed\n", name);
+		goto out;
+	}
+
+	qsort(submit, n, sizeof(*submit), cmp_uint);
+	qsort(sync, BENCH_SYNC_SAMPLES, sizeof(*sync), cmp_uint);
+	printf("%-34s %8.1f Mpix/s  cpu %6lld us  submit %6u/%6u us  "
+	       "sync %6u us  err %u\n", name,
+	       wall ? (double)size * size * (n + 1) / wall : 0.0,
+	       (long long)(cpu / n), submit[n / 2], submit[n * 99 / 100],
+	       sync[BENCH_SYNC_SAMPLES / 2], errors);
+
+out:
+	free(submit);
+	surface_free(&src);
+	surface_free(&dst);
+}
+
+static void run_all(void)
+{
+	static const unsigned int scales[][2] = {
+		{ 1, 1 }, { 2, 1 }, { 3, 2 }, { 1, 2 },
+	};
+	static const int batches[] = { 1, 4, 16 };
+	struct config c;
+	unsigned int f, s;
+
+	printf("\n== formats and scaling, %d blits per config ==\n",
+	       iterations);
+	memset(&c, 0, sizeof(c));
+	c.batch = 1;
+	for (f = 0; f < FORMAT_COUNT; f++) {
+		for (s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+			c.src = &formats[f];
+			c.num = scales[s][0];
+			c.den = scales[s][1];
+			run_config(&c);
+		}
+	}
+
+	printf("\n== rotation ==\n");
+	c.num = c.den = 1;
+	for (f = 0; f < FORMAT_COUNT; f++) {
+		c.src = &formats[f];
+		for (c.rotation = 90; c.rotation < 360; c.rotation += 90)
+			run_config(&c);
+	}
+	c.rotation = 0;
+
+	printf("\n== blending ==\n");
+	c.blend = 1;
+	c.src = FORMAT_ARGB;
+	run_config(&c);
+	c.num = 2;
+	run_config(&c);
+	c.num = 1;
+	c.blend = 0;
+
+	printf("\n== batching ==\n");
+	for (s = 0; s < sizeof(batches) / sizeof(batches[0]); s++) {
+		c.batch = batches[s];
+		c.blend = 0;
+		run_config(&c);
+		c.blend = 1;
+		run_config(&c);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+
+	while (1) {
+		static struct option opts[] = {
+			{"lib", required_argument, 0, 'l'},
+			{"width", required_argument, 0, 'w'},
+			{"height", required_argument, 0, 'h'},
+			{"iteration", required_argument, 0, 'i'},
+			{"help", no_argument, 0, '?'},
+			{0, 0, 0, 0},
+		};
+		int i = 0;
+
+		c = getopt_long(argc, argv, "l:w:h:i:?", opts, &i);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'l':
+			libname = optarg;
+			break;
+		case 'w':
+			width = atoi(optarg);
+			break;
+		case 'h':
+			height = atoi(optarg);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			if (iterations < 1)
+				iterations = 1;
+			break;
+		default:
+			printf("usage: %s [--lib libbltsville_xxx.so] "
+			       "[--width w] [--height h] [--iteration n]\n",
+			       argv[0]);
+			return 1;
+		}
+	}
+
+	if (width < 32 || height < 32) {
+		printf("destination must be at least 32x32\n");
+		return 1;
+	}
+
+	if (load_bltsville())
+		return 1;
+
+	printf("%s, destination %ux%u ARGB8888\n", libname, width, height);
+	run_all();
+
+	return 0;
+}
@@ -243,7 +243,7 @@ static void callback_stop(struct gccallbackinfo *gccallbackinfo)
 		gccallbackinfo->handle = 0;
 	}
 
-	gccallbackinfo->status == UNINIT;
+	gccallbackinfo->status = UNINIT;
 
 	pthread_mutex_unlock(&gccallbackinfo->mutex);
 
@@ -164,6 +164,7 @@ enum bverror do_blit(struct bvbltparams *bvbltparams,
 	unsigned int physwidth, physheight;
 	int orthogonal;
 	int multisrc;
+	bool samerect;
 
 	GCENTER(GCZONE_BLIT);
 
@@ -529,14 +530,27 @@ enum bverror do_blit(struct bvbltparams *bvbltparams,
 		batch->batchflags |= BVBATCH_DST;
 	}
 
+	/* Clients flag the clip and destination rectangles as changed
+	 * whenever they might have; a layer blended over the same region
+	 * can still join the current multi-source operation. */
+	samerect = (batch->batchend == do_blit_end) &&
+		   (batch->op.blit.dstrect.left
+			== batch->dstadjusted.left - dstoffsetX) &&
+		   (batch->op.blit.dstrect.top
+			== batch->dstadjusted.top - dstoffsetY) &&
+		   (batch->op.blit.dstrect.right
+			== batch->dstadjusted.right - dstoffsetX) &&
+		   (batch->op.blit.dstrect.bottom
+			== batch->dstadjusted.bottom - dstoffsetY);
+
 	/* Check if we need to finalize existing batch. */
 	if ((batch->batchend != do_blit_end) ||
-	    (batch->op.blit.srccount == 4) ||
+	    (batch->op.blit.srccount == countof(gcmosrc_config_ldst)) ||
 	    (batch->op.blit.multisrc == 0) ||
 	    (multisrc == 0) ||
-	    ((batch->batchflags & (BVBATCH_DST |
-				   BVBATCH_CLIPRECT |
-				   BVBATCH_DESTRECT)) != 0)) {
+	    ((batch->batchflags & BVBATCH_DST) != 0) ||
+	    (((batch->batchflags & (BVBATCH_CLIPRECT |
+				    BVBATCH_DESTRECT)) != 0) && !samerect)) {
 		/* Finalize existing batch if any. */
 		bverror = batch->batchend(bvbltparams, batch);
 		if (bverror != BVERR_NONE)
@@ -577,6 +591,13 @@ enum bverror do_blit(struct bvbltparams *bvbltparams,
 		batch->batchflags &= ~(BVBATCH_DST |
 				       BVBATCH_CLIPRECT |
 				       BVBATCH_DESTRECT);
+	} else {
+		GCDBG(GCZONE_BLIT, "adding source %d to the operation.\n",
+		      batch->op.blit.srccount);
+
+		/* Same rectangles, nothing to reprogram. */
+		batch->batchflags &= ~(BVBATCH_CLIPRECT |
+				       BVBATCH_DESTRECT);
 	}
 
 	/* Map the source. */
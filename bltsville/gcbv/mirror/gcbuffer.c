@@ -41,7 +41,7 @@
 
 GCDBG_FILTERDEF(buffer, GCZONE_NONE,
 		"batchalloc",
-		"bufferalloc"
+		"bufferalloc",
 		"fixupalloc",
 		"fixup")
 
@@ -65,6 +65,80 @@ GCDBG_FILTERDEF(buffer, GCZONE_NONE,
 )
 
 
+/*******************************************************************************
+ * Structure cache management.
+ */
+
+static void pool_take(struct gcpoolstats *gcpoolstats, bool reused)
+{
+	if (reused)
+		gcpoolstats->reused += 1;
+	else
+		gcpoolstats->allocated += 1;
+
+	gcpoolstats->inuse += 1;
+	if (gcpoolstats->inuse > gcpoolstats->peak)
+		gcpoolstats->peak = gcpoolstats->inuse;
+}
+
+static void pool_return(struct gcpoolstats *gcpoolstats, unsigned int count)
+{
+	gcpoolstats->inuse -= count;
+}
+
+void init_buffer_pools(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcbatch *gcbatch;
+	struct gcbuffer *gcbuffer;
+	struct gcfixup *gcfixup;
+	int i;
+
+	/* Preallocation is best effort, the caches grow on demand anyway. */
+	for (i = 0; i < GC_BATCH_PREALLOC; i += 1) {
+		gcbatch = gcalloc(struct gcbatch, sizeof(struct gcbatch));
+		if (gcbatch == NULL)
+			break;
+		list_add(&gcbatch->link, &gccontext->batchvac);
+		gccontext->batchstats.allocated += 1;
+	}
+
+	for (i = 0; i < GC_BUFFER_PREALLOC; i += 1) {
+		gcbuffer = gcalloc(struct gcbuffer, GC_BUFFER_SIZE);
+		if (gcbuffer == NULL)
+			break;
+		list_add(&gcbuffer->link, &gccontext->buffervac);
+		gccontext->bufferstats.allocated += 1;
+	}
+
+	for (i = 0; i < GC_FIXUP_PREALLOC; i += 1) {
+		gcfixup = gcalloc(struct gcfixup, sizeof(struct gcfixup));
+		if (gcfixup == NULL)
+			break;
+		list_add(&gcfixup->link, &gccontext->fixupvac);
+		gccontext->fixupstats.allocated += 1;
+	}
+}
+
+void dump_buffer_pools(void)
+{
+	struct gccontext *gccontext = get_context();
+
+	GCDBG(GCZONE_BATCH_ALLOC,
+	      "batches: allocated %d, reused %d, in use %d, peak %d\n",
+	      gccontext->batchstats.allocated, gccontext->batchstats.reused,
+	      gccontext->batchstats.inuse, gccontext->batchstats.peak);
+	GCDBG(GCZONE_BUFFER_ALLOC,
+	      "buffers: allocated %d, reused %d, in use %d, peak %d\n",
+	      gccontext->bufferstats.allocated, gccontext->bufferstats.reused,
+	      gccontext->bufferstats.inuse, gccontext->bufferstats.peak);
+	GCDBG(GCZONE_FIXUP_ALLOC,
+	      "fixups: allocated %d, reused %d, in use %d, peak %d\n",
+	      gccontext->fixupstats.allocated, gccontext->fixupstats.reused,
+	      gccontext->fixupstats.inuse, gccontext->fixupstats.peak);
+}
+
+
 /*******************************************************************************
  * Batch/command buffer management.
  */
@@ -96,6 +170,8 @@ enum bverror allocate_batch(struct bvbltparams *bvbltparams,
 			goto exit;
 		}
 
+		pool_take(&gccontext->batchstats, false);
+
 		GCDBG(GCZONE_BATCH_ALLOC, "allocated new batch = 0x%08X\n",
 		      (unsigned int) temp);
 	} else {
@@ -103,6 +179,7 @@ enum bverror allocate_batch(struct bvbltparams *bvbltparams,
 		head = gccontext->batchvac.next;
 		temp = list_entry(head, struct gcbatch, link);
 		list_del(head);
+		pool_take(&gccontext->batchstats, true);
 
 		GCDBG(GCZONE_BATCH_ALLOC, "reusing batch = 0x%08X\n",
 		      (unsigned int) temp);
@@ -140,6 +217,8 @@ void free_batch(struct gcbatch *gcbatch)
 	struct list_head *head;
 	struct gccontext *gccontext = get_context();
 	struct gcbuffer *gcbuffer;
+	struct list_head *fixup;
+	unsigned int fixupcount;
 
 	GCENTERARG(GCZONE_BATCH_ALLOC, "batch = 0x%08X\n",
 		   (unsigned int) gcbatch);
@@ -159,14 +238,20 @@ void free_batch(struct gcbatch *gcbatch)
 		gcbuffer = list_entry(head, struct gcbuffer, link);
 
 		/* Free fixups. */
+		fixupcount = 0;
+		list_for_each(fixup, &gcbuffer->fixup)
+			fixupcount += 1;
+		pool_return(&gccontext->fixupstats, fixupcount);
 		list_splice_init(&gcbuffer->fixup, &gccontext->fixupvac);
 
 		/* Free the command buffer. */
 		list_move(&gcbuffer->link, &gccontext->buffervac);
+		pool_return(&gccontext->bufferstats, 1);
 	}
 
 	/* Free the batch. */
 	list_add(&gcbatch->link, &gccontext->batchvac);
+	pool_return(&gccontext->batchstats, 1);
 
 	/* Unlock access. */
 	GCUNLOCK(&gccontext->maplock);
@@ -200,6 +285,7 @@ enum bverror append_buffer(struct bvbltparams *bvbltparams,
 		}
 
 		list_add_tail(&temp->link, &gcbatch->buffer);
+		pool_take(&gccontext->bufferstats, false);
 
 		GCDBG(GCZONE_BUFFER_ALLOC, "allocated new buffer = 0x%08X\n",
 		      (unsigned int) temp);
@@ -209,6 +295,7 @@ enum bverror append_buffer(struct bvbltparams *bvbltparams,
 		temp = list_entry(head, struct gcbuffer, link);
 
 		list_move_tail(&temp->link, &gcbatch->buffer);
+		pool_take(&gccontext->bufferstats, true);
 
 		GCDBG(GCZONE_BUFFER_ALLOC, "reusing buffer = 0x%08X\n",
 		      (unsigned int) temp);
@@ -250,6 +337,7 @@ static enum bverror allocate_fixup(struct bvbltparams *bvbltparams,
 		}
 
 		list_add_tail(&temp->link, &gcbuffer->fixup);
+		pool_take(&gccontext->fixupstats, false);
 
 		GCDBG(GCZONE_FIXUP_ALLOC,
 		      "new fixup struct allocated = 0x%08X\n",
@@ -260,6 +348,7 @@ static enum bverror allocate_fixup(struct bvbltparams *bvbltparams,
 		temp = list_entry(head, struct gcfixup, link);
 
 		list_move_tail(&temp->link, &gcbuffer->fixup);
+		pool_take(&gccontext->fixupstats, true);
 
 		GCDBG(GCZONE_FIXUP_ALLOC, "fixup struct reused = 0x%08X\n",
 			(unsigned int) temp);
@@ -531,15 +531,25 @@ enum bverror set_blending(struct bvbltparams *bvbltparams,
 			  struct surfaceinfo *srcinfo)
 {
 	enum bverror bverror = BVERR_NONE;
+	struct gcshadow *shadow = &batch->shadow;
 	struct gcmoalphaoff *gcmoalphaoff;
 	struct gcmoalpha *gcmoalpha;
 	struct gcmoglobal *gcmoglobal;
 	struct gcalpha *gca;
+	union {
+		struct gcregalphamodes reg;
+		unsigned int raw;
+	} mode;
 
 	GCENTER(GCZONE_BLEND);
 
 	gca = srcinfo->gca;
 	if (gca == NULL) {
+		if (shadow->blendvalid && !shadow->blendon) {
+			GCDBG(GCZONE_BLEND, "blending already disabled.\n");
+			goto exit;
+		}
+
 		bverror = claim_buffer(bvbltparams, batch,
 				       sizeof(struct gcmoalphaoff),
 				       (void **) &gcmoalphaoff);
@@ -549,49 +559,57 @@ enum bverror set_blending(struct bvbltparams *bvbltparams,
 		gcmoalphaoff->control_ldst = gcmoalphaoff_control_ldst[0];
 		gcmoalphaoff->control.reg = gcregalpha_off;
 
+		shadow->blendvalid = true;
+		shadow->blendon = false;
+
 		GCDBG(GCZONE_BLEND, "blending disabled.\n");
 	} else {
-		bverror = claim_buffer(bvbltparams, batch,
-				       sizeof(struct gcmoalpha),
-				       (void **) &gcmoalpha);
-		if (bverror != BVERR_NONE)
-			goto exit;
-
-		gcmoalpha->config_ldst = gcmoalpha_config_ldst;
-		gcmoalpha->control.reg = gcregalpha_on;
-
-		gcmoalpha->mode.raw = 0;
-		gcmoalpha->mode.reg.src_global_alpha_mode
-			= gca->src_global_alpha_mode;
-		gcmoalpha->mode.reg.dst_global_alpha_mode
-			= gca->dst_global_alpha_mode;
-
-		gcmoalpha->mode.reg.src_blend
-			= gca->srcconfig->factor_mode;
-		gcmoalpha->mode.reg.src_color_reverse
-			= gca->srcconfig->color_reverse;
-
-		gcmoalpha->mode.reg.dst_blend
-			= gca->dstconfig->factor_mode;
-		gcmoalpha->mode.reg.dst_color_reverse
-			= gca->dstconfig->color_reverse;
+		mode.raw = 0;
+		mode.reg.src_global_alpha_mode = gca->src_global_alpha_mode;
+		mode.reg.dst_global_alpha_mode = gca->dst_global_alpha_mode;
+		mode.reg.src_blend = gca->srcconfig->factor_mode;
+		mode.reg.src_color_reverse = gca->srcconfig->color_reverse;
+		mode.reg.dst_blend = gca->dstconfig->factor_mode;
+		mode.reg.dst_color_reverse = gca->dstconfig->color_reverse;
 
 		GCDBG(GCZONE_BLEND, "dst blend:\n");
 		GCDBG(GCZONE_BLEND, "  factor = %d\n",
-			gcmoalpha->mode.reg.dst_blend);
+			mode.reg.dst_blend);
 		GCDBG(GCZONE_BLEND, "  inverse = %d\n",
-			gcmoalpha->mode.reg.dst_color_reverse);
+			mode.reg.dst_color_reverse);
 
 		GCDBG(GCZONE_BLEND, "src blend:\n");
 		GCDBG(GCZONE_BLEND, "  factor = %d\n",
-			gcmoalpha->mode.reg.src_blend);
+			mode.reg.src_blend);
 		GCDBG(GCZONE_BLEND, "  inverse = %d\n",
-			gcmoalpha->mode.reg.src_color_reverse);
+			mode.reg.src_color_reverse);
 
-		if ((gca->src_global_alpha_mode
+		if (shadow->blendvalid && shadow->blendon &&
+		    (shadow->blendmode == mode.raw)) {
+			GCDBG(GCZONE_BLEND, "blending already set.\n");
+		} else {
+			bverror = claim_buffer(bvbltparams, batch,
+					       sizeof(struct gcmoalpha),
+					       (void **) &gcmoalpha);
+			if (bverror != BVERR_NONE)
+				goto exit;
+
+			gcmoalpha->config_ldst = gcmoalpha_config_ldst;
+			gcmoalpha->control.reg = gcregalpha_on;
+			gcmoalpha->mode.raw = mode.raw;
+
+			shadow->blendvalid = true;
+			shadow->blendon = true;
+			shadow->blendmode = mode.raw;
+		}
+
+		if (((gca->src_global_alpha_mode
 			!= GCREG_GLOBAL_ALPHA_MODE_NORMAL) ||
-		    (gca->dst_global_alpha_mode
-			!= GCREG_GLOBAL_ALPHA_MODE_NORMAL)) {
+		     (gca->dst_global_alpha_mode
+			!= GCREG_GLOBAL_ALPHA_MODE_NORMAL)) &&
+		    (!shadow->globalvalid ||
+		     (shadow->srcglobal != gca->src_global_color) ||
+		     (shadow->dstglobal != gca->dst_global_color))) {
 			bverror = claim_buffer(bvbltparams, batch,
 					       sizeof(struct gcmoglobal),
 					       (void **) &gcmoglobal);
@@ -601,6 +619,10 @@ enum bverror set_blending(struct bvbltparams *bvbltparams,
 			gcmoglobal->color_ldst = gcmoglobal_color_ldst;
 			gcmoglobal->srcglobal.raw = gca->src_global_color;
 			gcmoglobal->dstglobal.raw = gca->dst_global_color;
+
+			shadow->globalvalid = true;
+			shadow->srcglobal = gca->src_global_color;
+			shadow->dstglobal = gca->dst_global_color;
 		}
 	}
 
@@ -623,6 +645,12 @@ enum bverror set_blending_index(struct bvbltparams *bvbltparams,
 
 	GCENTER(GCZONE_BLEND);
 
+	/* Source 0 shares its registers with single source blending. */
+	if (index == 0) {
+		batch->shadow.blendvalid = false;
+		batch->shadow.globalvalid = false;
+	}
+
 	gca = srcinfo->gca;
 	if (gca == NULL) {
 		bverror = claim_buffer(bvbltparams, batch,
@@ -1120,19 +1148,28 @@ void bv_init(void)
 	GCLOCK_INIT(&gccontext->fixuplock);
 	GCLOCK_INIT(&gccontext->maplock);
 	GCLOCK_INIT(&gccontext->callbacklock);
+	GCLOCK_INIT(&gccontext->formatlock);
 
 	INIT_LIST_HEAD(&gccontext->unmapvac);
+	INIT_LIST_HEAD(&gccontext->mapcache);
+	INIT_LIST_HEAD(&gccontext->mapcachevac);
 	INIT_LIST_HEAD(&gccontext->buffervac);
 	INIT_LIST_HEAD(&gccontext->fixupvac);
 	INIT_LIST_HEAD(&gccontext->batchvac);
 	INIT_LIST_HEAD(&gccontext->callbacklist);
 	INIT_LIST_HEAD(&gccontext->callbackvac);
 
+	/* Fill the batch, buffer and fixup caches. */
+	init_buffer_pools();
+
 	/* Initialize the filter cache. */
 	for (i = 0; i < GC_FILTER_COUNT; i += 1)
-		for (j = 0; j < GC_TAP_COUNT; j += 1)
+		for (j = 0; j <= GC_TAP_COUNT; j += 1)
 			INIT_LIST_HEAD(&gccontext->filtercache[i][j].list);
 
+	/* Precompute the most common kernels. */
+	init_filter_cache();
+
 	/* Query hardware caps. */
 	gc_getcaps_wrapper(&gcicaps);
 	if (gcicaps.gcerror == GCERR_NONE) {
@@ -1159,6 +1196,10 @@ void bv_exit(void)
 	struct gcbatch *gcbatch;
 	struct gccallbackinfo *gccallbackinfo;
 
+	dump_buffer_pools();
+
+	free_map_cache();
+
 	while (gccontext->buffmapvac != NULL) {
 		bvbuffmap = gccontext->buffmapvac;
 		gccontext->buffmapvac = bvbuffmap->nextmap;
@@ -1205,6 +1246,7 @@ void bv_exit(void)
 		gcfree(gccallbackinfo);
 	}
 
+	free_filter_cache();
 	free_temp(false);
 }
 
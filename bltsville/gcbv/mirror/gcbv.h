@@ -124,9 +124,7 @@ enum gcfiltertype {
 struct gcfilterkernel {
 	enum gcfiltertype type;
 	unsigned int kernelsize;
-	unsigned int srcsize;
-	unsigned int dstsize;
-	unsigned int scalefactor;
+	unsigned int scale;		/* 1.31 dst/src, at most 1. */
 	short kernelarray[GC_COEFFICIENT_COUNT];
 	struct list_head link;
 };
@@ -137,10 +135,75 @@ struct gcfiltercache {
 };
 
 
+/*******************************************************************************
+ * Color format.
+ */
+
+#define BVFMT_RGB	1
+#define BVFMT_YUV	2
+
+struct bvcomponent {
+	unsigned int shift;
+	unsigned int size;
+	unsigned int mask;
+};
+
+struct bvcsrgb {
+	struct bvcomponent r;
+	struct bvcomponent g;
+	struct bvcomponent b;
+	struct bvcomponent a;
+};
+
+struct bvformatxlate {
+	unsigned int type;
+	unsigned int bitspp;
+	unsigned int allocbitspp;
+	unsigned int format;
+	unsigned int swizzle;
+	bool premultiplied;
+
+	union {
+		struct {
+			const struct bvcsrgb *comp;
+		} rgb;
+
+		struct {
+			unsigned int std;
+			unsigned int planecount;
+			unsigned int xsample;
+			unsigned int ysample;
+		} yuv;
+	} cs;
+};
+
+
 /*******************************************************************************
  * Global data structure.
  */
 
+/* Successfully parsed format, looked up by its ocdformat value. */
+#define GC_FORMAT_CACHE_SIZE	16
+
+struct gcformatcache {
+	bool valid;
+	enum ocdformat ocdformat;
+	struct bvformatxlate format;
+};
+
+/* Number of structures put in the caches by bv_init. */
+#define GC_BATCH_PREALLOC	2
+#define GC_BUFFER_PREALLOC	4
+#define GC_FIXUP_PREALLOC	2
+
+/* Usage of one of the structure caches. */
+struct gcpoolstats {
+	unsigned int allocated;		/* Structures allocated in total. */
+	unsigned int reused;		/* Requests served from the cache. */
+	unsigned int inuse;		/* Structures held by batches. */
+	unsigned int peak;		/* Highest inuse so far. */
+};
+
 struct gccontext {
 	/* Last generated error message. */
 	char bverrorstr[128];
@@ -163,20 +226,35 @@ struct gccontext {
 	struct list_head fixupvac;		/* gcfixup */
 	struct list_head batchvac;		/* gcbatch */
 
+	/* Structure cache statistics. */
+	struct gcpoolstats batchstats;
+	struct gcpoolstats bufferstats;
+	struct gcpoolstats fixupstats;
+
 	/* Callback lists. */
 	struct list_head callbacklist;		/* gccallbackinfo */
 	struct list_head callbackvac;		/* gccallbackinfo */
 
+	/* Parsed surface formats. */
+	struct gcformatcache formatcache[GC_FORMAT_CACHE_SIZE];
+
+	/* Implicit mappings kept after their last batch, most recently
+	 * used first; protected by maplock. */
+	struct list_head mapcache;		/* gcmapcache */
+	struct list_head mapcachevac;		/* gcmapcache */
+	unsigned int mapcachecount;
+
 	/* Access locks. */
 	GCLOCK_TYPE batchlock;
 	GCLOCK_TYPE bufferlock;
 	GCLOCK_TYPE fixuplock;
 	GCLOCK_TYPE maplock;
 	GCLOCK_TYPE callbacklock;
+	GCLOCK_TYPE formatlock;
 
-	/* Kernel table cache. */
+	/* Kernel table cache, indexed by filter type and kernel size. */
 	struct gcfilterkernel *loadedfilter;	/* gcfilterkernel */
-	struct gcfiltercache filtercache[GC_FILTER_COUNT][GC_TAP_COUNT];
+	struct gcfiltercache filtercache[GC_FILTER_COUNT][GC_TAP_COUNT + 1];
 
 	/* Temporary buffer descriptor. */
 	struct bvbuffdesc *tmpbuffdesc;
@@ -200,47 +278,29 @@ struct bvbuffmapinfo {
 	int automap;
 };
 
+/* Number of implicit mappings kept alive for reuse; enough for a few
+ * layers cycling through triple buffered swap chains. */
+#define GC_MAP_CACHE_SIZE	8
 
-/*******************************************************************************
- * Color format.
- */
-
-#define BVFMT_RGB	1
-#define BVFMT_YUV	2
+/* Cached gccore mapping of a physically described buffer. The record is
+ * detached from the bvbuffdesc, which the client may free at any time;
+ * it is found again by comparing the page list. */
+struct gcmapcache {
+	/* Mapped handle for the pages. */
+	unsigned long handle;
 
-struct bvcomponent {
-	unsigned int shift;
+	/* Physical layout the mapping was created for. */
+	unsigned long pagesize;
+	unsigned long pageoffset;
 	unsigned int size;
-	unsigned int mask;
-};
+	unsigned int pagecount;
+	unsigned long *pagearray;
 
-struct bvcsrgb {
-	struct bvcomponent r;
-	struct bvcomponent g;
-	struct bvcomponent b;
-	struct bvcomponent a;
-};
+	/* Number of entries allocated in pagearray. */
+	unsigned int pagecapacity;
 
-struct bvformatxlate {
-	unsigned int type;
-	unsigned int bitspp;
-	unsigned int allocbitspp;
-	unsigned int format;
-	unsigned int swizzle;
-	bool premultiplied;
-
-	union {
-		struct {
-			const struct bvcsrgb *comp;
-		} rgb;
-
-		struct {
-			unsigned int std;
-			unsigned int planecount;
-			unsigned int xsample;
-			unsigned int ysample;
-		} yuv;
-	} cs;
+	/* Previous/next cached mapping (gcmapcache). */
+	struct list_head link;
 };
 
 
@@ -378,6 +438,18 @@ struct gcblit {
 	unsigned int swizzle;
 };
 
+/* Fill states. */
+struct gcfill {
+	/* Fill command of the current operation and its last rectangle;
+	 * further rectangles are appended right after it. */
+	struct gcmofill *gcmofill;
+	struct gccmdstartderect *lastrect;
+
+	/* Clear color and ROP the command was set up with. */
+	unsigned int color;
+	unsigned char rop;
+};
+
 /* Filter states. */
 struct gcfilter {
 	/* Kernel size. */
@@ -411,6 +483,37 @@ struct gcfilter {
 };
 
 /* Batch header. */
+/* Filter kernel array programmed in a batch. */
+struct gcshadowkernel {
+	/* Kernel array register address, 0 if not programmed. */
+	unsigned int address;
+
+	/* Kernel loaded at that address. */
+	enum gcfiltertype type;
+	unsigned int kernelsize;
+	unsigned int scale;
+};
+
+#define GC_SHADOW_KERNEL_COUNT 2
+
+/* Register state already programmed in a batch. Commands run in order,
+ * so while the batch is being built the last values written are what
+ * the hardware will use; on that basis repeated writes are skipped. */
+struct gcshadow {
+	/* Alpha control and mode (mode is valid when blending is on). */
+	bool blendvalid;
+	bool blendon;
+	unsigned int blendmode;
+
+	/* Global source and destination colors. */
+	bool globalvalid;
+	unsigned int srcglobal;
+	unsigned int dstglobal;
+
+	/* Horizontal and vertical filter kernels. */
+	struct gcshadowkernel kernel[GC_SHADOW_KERNEL_COUNT];
+};
+
 struct gcbatch {
 	/* Used to ID structure version. */
 	unsigned int structsize;
@@ -424,6 +527,7 @@ struct gcbatch {
 	/* State of the current operation. */
 	struct {
 		struct gcblit blit;
+		struct gcfill fill;
 		struct gcfilter filter;
 	} op;
 
@@ -451,6 +555,13 @@ struct gcbatch {
 	unsigned int dstwidth;
 	unsigned int dstheight;
 
+	/* Origin offset of the destination rectangles at the destination
+	 * angle; with the sizes above it only changes with the surface,
+	 * unless process_rotation() replaced them (dstsizevalid). */
+	int dstoriginX;
+	int dstoriginY;
+	bool dstsizevalid;
+
 	/* Physical size of the source and destination surfaces. */
 	unsigned int srcphyswidth;
 	unsigned int srcphysheight;
@@ -466,6 +577,9 @@ struct gcbatch {
 	int dstoffsetX;
 	int dstoffsetY;
 
+	/* Programmed state; cleared with the batch. */
+	struct gcshadow shadow;
+
 #if GCDEBUG_ENABLE
 	/* Rectangle validation storage. */
 	struct bvrect prevdstrect;
@@ -525,8 +639,11 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 		    struct gcbatch *gcbatch,
 		    struct bvbuffmap **map);
 void do_unmap_implicit(struct gcbatch *gcbatch);
+void free_map_cache(void);
 
 /* Batch/command buffer management. */
+void init_buffer_pools(void);
+void dump_buffer_pools(void);
 enum bverror do_end(struct bvbltparams *bvbltparams,
 		    struct gcbatch *gcbatch);
 enum bverror allocate_batch(struct bvbltparams *bvbltparams,
@@ -587,4 +704,8 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		       struct gcbatch *gcbatch,
 		       struct surfaceinfo *srcinfo);
 
+/* Filter kernel cache. */
+void init_filter_cache(void);
+void free_filter_cache(void);
+
 #endif
@@ -122,6 +122,52 @@ static unsigned int getinternalcolor(void *ptr, struct bvformatxlate *format)
 	return dstpixel;
 }
 
+static enum bverror do_fill_end(struct bvbltparams *bvbltparams,
+				struct gcbatch *batch)
+{
+	/* The fill command is complete as soon as it is written. */
+	batch->batchend = do_end;
+	return BVERR_NONE;
+}
+
+/* Append the destination rectangle to the fill in progress; possible
+ * while nothing else was written to the command buffer after it. */
+static bool extend_fill(struct bvbltparams *bvbltparams,
+			struct gcbatch *batch,
+			unsigned int color)
+{
+	struct gcfill *gcfill = &batch->op.fill;
+	struct gcbuffer *gcbuffer;
+	struct gccmdstartderect *rect;
+
+	if ((gcfill->color != color) ||
+	    (gcfill->rop != (unsigned char) bvbltparams->op.rop) ||
+	    (gcfill->gcmofill->startde.cmd.fld.rectcount == 255))
+		return false;
+
+	gcbuffer = list_entry(batch->buffer.prev, struct gcbuffer, link);
+	if ((gcbuffer->tail != (unsigned int *) (gcfill->lastrect + 1)) ||
+	    (gcbuffer->available < sizeof(struct gccmdstartderect)))
+		return false;
+
+	if (claim_buffer(bvbltparams, batch, sizeof(struct gccmdstartderect),
+			 (void **) &rect) != BVERR_NONE)
+		return false;
+
+	rect->left = batch->dstadjusted.left;
+	rect->top = batch->dstadjusted.top;
+	rect->right = batch->dstadjusted.right;
+	rect->bottom = batch->dstadjusted.bottom;
+
+	gcfill->gcmofill->startde.cmd.fld.rectcount += 1;
+	gcfill->lastrect = rect;
+
+	GCDBG(GCZONE_FILL, "extended the fill to %d rectangles.\n",
+	      gcfill->gcmofill->startde.cmd.fld.rectcount);
+
+	return true;
+}
+
 enum bverror do_fill(struct bvbltparams *bvbltparams,
 		     struct gcbatch *batch,
 		     struct surfaceinfo *srcinfo)
@@ -131,10 +177,15 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 	struct surfaceinfo *dstinfo;
 	struct gcmofill *gcmofill;
 	unsigned char *fillcolorptr;
+	unsigned int color;
 	struct bvbuffmap *dstmap = NULL;
+	bool prevfill;
 
 	GCENTER(GCZONE_FILL);
 
+	/* Clears of several uncovered regions usually come in a row. */
+	prevfill = (batch->batchend == do_fill_end);
+
 	/* Finish previous batch if any. */
 	bverror = batch->batchend(bvbltparams, batch);
 	if (bverror != BVERR_NONE)
@@ -171,6 +222,22 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 		goto exit;
 	}
 
+	/* Get the fill color. */
+	fillcolorptr
+		= (unsigned char *) srcinfo->buf.desc->virtaddr
+		+ srcinfo->rect.top * srcinfo->geom->virtstride
+		+ srcinfo->rect.left * srcinfo->format.bitspp / 8;
+	color = getinternalcolor(fillcolorptr, &srcinfo->format);
+
+	/* Same destination, color and ROP: one more rectangle only. */
+	if (prevfill && ((batch->batchflags & BVBATCH_DST) == 0) &&
+	    extend_fill(bvbltparams, batch, color)) {
+		batch->batchflags &= ~(BVBATCH_CLIPRECT |
+				       BVBATCH_DESTRECT);
+		batch->batchend = do_fill_end;
+		goto exit;
+	}
+
 	/* Set the new destination. */
 	bverror = set_dst(bvbltparams, batch, dstmap);
 	if (bverror != BVERR_NONE)
@@ -216,14 +283,8 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 	** Set fill color.
 	*/
 
-	fillcolorptr
-		= (unsigned char *) srcinfo->buf.desc->virtaddr
-		+ srcinfo->rect.top * srcinfo->geom->virtstride
-		+ srcinfo->rect.left * srcinfo->format.bitspp / 8;
-
 	gcmofill->clearcolor_ldst = gcmofill_clearcolor_ldst;
-	gcmofill->clearcolor.raw = getinternalcolor(fillcolorptr,
-						    &srcinfo->format);
+	gcmofill->clearcolor.raw = color;
 
 	/***********************************************************************
 	** Configure and start fill.
@@ -251,6 +312,13 @@ enum bverror do_fill(struct bvbltparams *bvbltparams,
 	gcmofill->rect.right = batch->dstadjusted.right;
 	gcmofill->rect.bottom = batch->dstadjusted.bottom;
 
+	/* Let the next fill extend this one. */
+	batch->op.fill.gcmofill = gcmofill;
+	batch->op.fill.lastrect = &gcmofill->rect;
+	batch->op.fill.color = color;
+	batch->op.fill.rop = (unsigned char) bvbltparams->op.rop;
+	batch->batchend = do_fill_end;
+
 exit:
 	GCEXITARG(GCZONE_FILL, "bv%s = %d\n",
 		  (bverror == BVERR_NONE) ? "result" : "error", bverror);
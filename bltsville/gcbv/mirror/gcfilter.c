@@ -351,10 +351,8 @@ static void calculate_sync_filter(struct gcfilterkernel *gcfilterkernel)
 	short count, adjustfrom, adjustment;
 	int index;
 
-	/* Compute the scale factor. */
-	scale = (gcfilterkernel->dstsize >= gcfilterkernel->srcsize)
-	      ? GC_SCALE_ONE
-	      : computescale(gcfilterkernel->dstsize, gcfilterkernel->srcsize);
+	/* Get the scale factor. */
+	scale = gcfilterkernel->scale;
 
 	/* Calculate the kernel half. */
 	kernelhalf = (int) (gcfilterkernel->kernelsize >> 1);
@@ -460,17 +458,24 @@ static void calculate_sync_filter(struct gcfilterkernel *gcfilterkernel)
 
 
 /*******************************************************************************
- * Loads a filter into the GPU.
+ * Filter kernel cache.
  */
 
-static enum bverror load_filter(struct bvbltparams *bvbltparams,
-				struct gcbatch *batch,
-				enum gcfiltertype type,
-				unsigned int kernelsize,
-				unsigned int scalefactor,
-				unsigned int srcsize,
-				unsigned int dstsize,
-				struct gccmdldstate arraystate)
+/* Scale a kernel is computed for; all upscales use the same kernel. */
+static inline GC_SCALE_TYPE get_filter_scale(unsigned int kernelsize,
+					     unsigned int srcsize,
+					     unsigned int dstsize)
+{
+	if ((kernelsize == 1) || (dstsize >= srcsize))
+		return GC_SCALE_ONE;
+
+	return computescale(dstsize, srcsize);
+}
+
+static enum bverror get_filter(enum gcfiltertype type,
+			       unsigned int kernelsize,
+			       GC_SCALE_TYPE scale,
+			       struct gcfilterkernel **filter)
 {
 	enum bverror bverror = BVERR_NONE;
 	struct gccontext *gccontext = get_context();
@@ -478,21 +483,15 @@ static enum bverror load_filter(struct bvbltparams *bvbltparams,
 	struct list_head *filterlist;
 	struct list_head *filterhead;
 	struct gcfilterkernel *gcfilterkernel;
-	struct gcmofilterkernel *gcmofilterkernel;
-
-	GCDBG(GCZONE_KERNEL, "kernelsize = %d\n", kernelsize);
-	GCDBG(GCZONE_KERNEL, "srcsize = %d\n", srcsize);
-	GCDBG(GCZONE_KERNEL, "dstsize = %d\n", dstsize);
-	GCDBG(GCZONE_KERNEL, "scalefactor = 0x%08X\n", scalefactor);
 
 	/* Is the filter already loaded? */
 	if ((gccontext->loadedfilter != NULL) &&
 	    (gccontext->loadedfilter->type == type) &&
 	    (gccontext->loadedfilter->kernelsize == kernelsize) &&
-	    (gccontext->loadedfilter->scalefactor == scalefactor)) {
+	    (gccontext->loadedfilter->scale == scale)) {
 		GCDBG(GCZONE_KERNEL, "filter already computed.\n");
-		gcfilterkernel = gccontext->loadedfilter;
-		goto load;
+		*filter = gccontext->loadedfilter;
+		goto exit;
 	}
 
 	/* Get the proper filter cache. */
@@ -505,7 +504,7 @@ static enum bverror load_filter(struct bvbltparams *bvbltparams,
 		gcfilterkernel = list_entry(filterhead,
 					    struct gcfilterkernel,
 					    link);
-		if (gcfilterkernel->scalefactor == scalefactor) {
+		if (gcfilterkernel->scale == scale) {
 			GCDBG(GCZONE_KERNEL, "filter found @ 0x%08X.\n",
 			      (unsigned int) gcfilterkernel);
 			break;
@@ -535,29 +534,128 @@ static enum bverror load_filter(struct bvbltparams *bvbltparams,
 			gcfilterkernel = gcalloc(struct gcfilterkernel,
 						 sizeof(struct gcfilterkernel));
 			if (gcfilterkernel == NULL) {
-				BVSETBLTERROR(BVERR_OOM,
-					      "filter allocation failed");
+				bverror = BVERR_OOM;
 				goto exit;
 			}
 
 			list_add(&gcfilterkernel->link, filterlist);
-		}
 
-		/* Update the number of filters. */
-		filtercache->count += 1;
+			/* Update the number of filters. */
+			filtercache->count += 1;
+		}
 
 		/* Initialize the filter. */
 		gcfilterkernel->type = type;
 		gcfilterkernel->kernelsize = kernelsize;
-		gcfilterkernel->srcsize = srcsize;
-		gcfilterkernel->dstsize = dstsize;
-		gcfilterkernel->scalefactor = scalefactor;
+		gcfilterkernel->scale = scale;
 
 		/* Compute the coefficients. */
 		calculate_sync_filter(gcfilterkernel);
 	}
 
-load:
+	*filter = gcfilterkernel;
+
+exit:
+	return bverror;
+}
+
+void init_filter_cache(void)
+{
+	/* Kernels for FASTEST and GOOD quality at 1:1 (and any upscale),
+	 * 2:1 and 3:2 (1080p to 720p) downscaling. */
+	static const unsigned int kernelsize[] = { 3, 5 };
+	static const unsigned int ratio[][2] = {
+		{ 1, 1 }, { 2, 1 }, { 3, 2 }
+	};
+
+	struct gcfilterkernel *gcfilterkernel;
+	unsigned int i, j;
+
+	for (i = 0; i < countof(kernelsize); i += 1)
+		for (j = 0; j < countof(ratio); j += 1)
+			if (get_filter(GC_FILTER_SYNC, kernelsize[i],
+				       get_filter_scale(kernelsize[i],
+							ratio[j][0],
+							ratio[j][1]),
+				       &gcfilterkernel) != BVERR_NONE)
+				return;
+}
+
+void free_filter_cache(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct gcfiltercache *filtercache;
+	struct gcfilterkernel *gcfilterkernel;
+	unsigned int i, j;
+
+	for (i = 0; i < GC_FILTER_COUNT; i += 1)
+		for (j = 0; j <= GC_TAP_COUNT; j += 1) {
+			filtercache = &gccontext->filtercache[i][j];
+			while (!list_empty(&filtercache->list)) {
+				gcfilterkernel = list_entry(
+					filtercache->list.next,
+					struct gcfilterkernel, link);
+				list_del(&gcfilterkernel->link);
+				gcfree(gcfilterkernel);
+			}
+			filtercache->count = 0;
+		}
+
+	gccontext->loadedfilter = NULL;
+}
+
+
+/*******************************************************************************
+ * Loads a filter into the GPU.
+ */
+
+static enum bverror load_filter(struct bvbltparams *bvbltparams,
+				struct gcbatch *batch,
+				enum gcfiltertype type,
+				unsigned int kernelsize,
+				unsigned int srcsize,
+				unsigned int dstsize,
+				struct gccmdldstate arraystate)
+{
+	enum bverror bverror = BVERR_NONE;
+	struct gccontext *gccontext = get_context();
+	struct gcfilterkernel *gcfilterkernel;
+	struct gcmofilterkernel *gcmofilterkernel;
+	struct gcshadowkernel *shadow = NULL;
+	GC_SCALE_TYPE scale;
+	int i;
+
+	scale = get_filter_scale(kernelsize, srcsize, dstsize);
+
+	GCDBG(GCZONE_KERNEL, "kernelsize = %d\n", kernelsize);
+	GCDBG(GCZONE_KERNEL, "srcsize = %d\n", srcsize);
+	GCDBG(GCZONE_KERNEL, "dstsize = %d\n", dstsize);
+	GCDBG(GCZONE_KERNEL, "scale = 0x%08X\n", scale);
+
+	/* Has this batch already programmed the same kernel array? */
+	for (i = 0; i < GC_SHADOW_KERNEL_COUNT; i += 1) {
+		shadow = &batch->shadow.kernel[i];
+		if ((shadow->address == arraystate.address) ||
+		    (shadow->address == 0))
+			break;
+	}
+
+	if (i == GC_SHADOW_KERNEL_COUNT) {
+		shadow = NULL;
+	} else if ((shadow->address == arraystate.address) &&
+		   (shadow->type == type) &&
+		   (shadow->kernelsize == kernelsize) &&
+		   (shadow->scale == scale)) {
+		GCDBG(GCZONE_KERNEL, "filter already loaded.\n");
+		goto exit;
+	}
+
+	if (get_filter(type, kernelsize, scale, &gcfilterkernel)
+	    != BVERR_NONE) {
+		BVSETBLTERROR(BVERR_OOM, "filter allocation failed");
+		goto exit;
+	}
+
 	GCDBG(GCZONE_KERNEL, "loading filter.\n");
 
 	/* Load the filter. */
@@ -575,6 +673,13 @@ load:
 	/* Set the filter. */
 	gccontext->loadedfilter = gcfilterkernel;
 
+	if (shadow != NULL) {
+		shadow->address = arraystate.address;
+		shadow->type = type;
+		shadow->kernelsize = kernelsize;
+		shadow->scale = scale;
+	}
+
 exit:
 	return bverror;
 }
@@ -710,6 +815,10 @@ void process_rotation(struct bvbltparams *bvbltparams,
 			= (dstinfo->angle + (4 - srcinfo->angle)) % 4;
 		GCDBG(GCZONE_DEST, "dstangle = %d\n", gcfilter->dstangle);
 
+		/* The sizes computed below are for the rotated destination,
+		 * make process_dest_rotation() compute its own again. */
+		batch->dstsizevalid = false;
+
 		/* Determine whether the new and the old destination angles
 		 * are orthogonal to each other. */
 		orthogonal = (gcfilter->dstangle % 2) != (dstinfo->angle % 2);
@@ -801,7 +910,7 @@ void process_rotation(struct bvbltparams *bvbltparams,
 			if (orthogonal) {
 				/* Determine geometry size. */
 				batch->dstwidth  = dstinfo->geom->height
-						 = dstinfo->ypixalign;
+						 - dstinfo->ypixalign;
 				batch->dstheight = dstinfo->geom->width
 						 - dstinfo->xpixalign;
 
@@ -1437,7 +1546,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->horkernelsize,
-				      gcfilter->horscalefactor,
 				      srcwidth, dstwidth,
 				      gcmofilterkernel_horizontal_ldst);
 		if (bverror != BVERR_NONE)
@@ -1447,7 +1555,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->verkernelsize,
-				      gcfilter->verscalefactor,
 				      srcheight, dstheight,
 				      gcmofilterkernel_vertical_ldst);
 		if (bverror != BVERR_NONE)
@@ -1641,7 +1748,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->verkernelsize,
-				      gcfilter->verscalefactor,
 				      srcheight, dstheight,
 				      gcmofilterkernel_shared_ldst);
 		if (bverror != BVERR_NONE)
@@ -1714,7 +1820,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 		bverror = load_filter(bvbltparams, batch,
 				      GC_FILTER_SYNC,
 				      gcfilter->horkernelsize,
-				      gcfilter->horscalefactor,
 				      srcwidth, dstwidth,
 				      gcmofilterkernel_shared_ldst);
 		if (bverror != BVERR_NONE)
@@ -1745,7 +1850,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 			bverror = load_filter(bvbltparams, batch,
 					      GC_FILTER_SYNC,
 					      gcfilter->horkernelsize,
-					      gcfilter->horscalefactor,
 					      srcwidth, dstwidth,
 					      gcmofilterkernel_shared_ldst);
 			if (bverror != BVERR_NONE)
@@ -1764,7 +1868,6 @@ enum bverror do_filter(struct bvbltparams *bvbltparams,
 			bverror = load_filter(bvbltparams, batch,
 					      GC_FILTER_SYNC,
 					      gcfilter->verkernelsize,
-					      gcfilter->verscalefactor,
 					      srcheight, dstheight,
 					      gcmofilterkernel_shared_ldst);
 			if (bverror != BVERR_NONE)
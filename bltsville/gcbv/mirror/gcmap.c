@@ -40,6 +40,167 @@ GCDBG_FILTERDEF(map, GCZONE_NONE,
 		"mapping")
 
 
+/*******************************************************************************
+ * Mapping cache.
+ */
+
+/* Return the handle of a cached mapping of the same pages and drop it from
+ * the cache, or 0 if there is none. Must be called with maplock held. */
+static unsigned long find_cached_map(struct gccontext *gccontext,
+				     struct bvphysdesc *bvphysdesc,
+				     unsigned int size)
+{
+	struct list_head *head;
+	struct gcmapcache *gcmapcache;
+
+	if (bvphysdesc->pagearray == NULL)
+		return 0;
+
+	list_for_each(head, &gccontext->mapcache) {
+		gcmapcache = list_entry(head, struct gcmapcache, link);
+
+		if ((gcmapcache->pagesize != bvphysdesc->pagesize) ||
+		    (gcmapcache->pageoffset != bvphysdesc->pageoffset) ||
+		    (gcmapcache->size != size) ||
+		    (gcmapcache->pagecount != bvphysdesc->pagecount))
+			continue;
+
+		if (memcmp(gcmapcache->pagearray, bvphysdesc->pagearray,
+			   gcmapcache->pagecount * sizeof(unsigned long)) != 0)
+			continue;
+
+		GCDBG(GCZONE_MAPPING, "reusing cached mapping 0x%08X.\n",
+		      gcmapcache->handle);
+
+		list_move(head, &gccontext->mapcachevac);
+		gccontext->mapcachecount -= 1;
+		return gcmapcache->handle;
+	}
+
+	return 0;
+}
+
+/* Try to keep the mapping of a buffer that is no longer referenced. Returns
+ * the handle that has to be unmapped now: the buffer's own if it could not
+ * be cached, the least recently used one if the cache was full, or 0.
+ * Must be called with maplock held. */
+static unsigned long cache_map(struct gccontext *gccontext,
+			       struct bvbuffdesc *bvbuffdesc,
+			       unsigned long handle)
+{
+	struct bvphysdesc *bvphysdesc;
+	struct gcmapcache *gcmapcache;
+	unsigned long *pagearray;
+	unsigned long unmaphandle = 0;
+
+	/* Virtual addresses can be recycled by the client without notice,
+	 * only physically described buffers can be matched safely. */
+	if (bvbuffdesc->auxtype != BVAT_PHYSDESC)
+		return handle;
+
+	bvphysdesc = (struct bvphysdesc *) bvbuffdesc->auxptr;
+	if ((bvphysdesc->structsize < STRUCTSIZE(bvphysdesc, pageoffset)) ||
+	    (bvphysdesc->pagearray == NULL) ||
+	    (bvphysdesc->pagecount == 0))
+		return handle;
+
+	/* Get a record: a vacant one, a new one or the oldest one. */
+	if (!list_empty(&gccontext->mapcachevac)) {
+		gcmapcache = list_entry(gccontext->mapcachevac.next,
+					struct gcmapcache, link);
+	} else if (gccontext->mapcachecount < GC_MAP_CACHE_SIZE) {
+		gcmapcache = gcalloc(struct gcmapcache,
+				     sizeof(struct gcmapcache));
+		if (gcmapcache == NULL)
+			return handle;
+
+		gcmapcache->pagearray = NULL;
+		gcmapcache->pagecapacity = 0;
+		list_add(&gcmapcache->link, &gccontext->mapcachevac);
+	} else {
+		gcmapcache = list_entry(gccontext->mapcache.prev,
+					struct gcmapcache, link);
+
+		GCDBG(GCZONE_MAPPING, "evicting cached mapping 0x%08X.\n",
+		      gcmapcache->handle);
+
+		unmaphandle = gcmapcache->handle;
+		list_move(&gcmapcache->link, &gccontext->mapcachevac);
+		gccontext->mapcachecount -= 1;
+	}
+
+	/* Make room for the page list. */
+	if (gcmapcache->pagecapacity < bvphysdesc->pagecount) {
+		pagearray = gcalloc(unsigned long,
+				    bvphysdesc->pagecount
+				    * sizeof(unsigned long));
+		if (pagearray == NULL) {
+			/* Keep the evicted mapping rather than failing. */
+			if (unmaphandle != 0) {
+				list_move(&gcmapcache->link,
+					  &gccontext->mapcache);
+				gccontext->mapcachecount += 1;
+			}
+			return handle;
+		}
+
+		gcfree(gcmapcache->pagearray);
+		gcmapcache->pagearray = pagearray;
+		gcmapcache->pagecapacity = bvphysdesc->pagecount;
+	}
+
+	gcmapcache->handle = handle;
+	gcmapcache->pagesize = bvphysdesc->pagesize;
+	gcmapcache->pageoffset = bvphysdesc->pageoffset;
+	gcmapcache->size = bvbuffdesc->length;
+	gcmapcache->pagecount = bvphysdesc->pagecount;
+	memcpy(gcmapcache->pagearray, bvphysdesc->pagearray,
+	       bvphysdesc->pagecount * sizeof(unsigned long));
+
+	list_move(&gcmapcache->link, &gccontext->mapcache);
+	gccontext->mapcachecount += 1;
+
+	GCDBG(GCZONE_MAPPING, "cached mapping 0x%08X.\n", handle);
+
+	return unmaphandle;
+}
+
+void free_map_cache(void)
+{
+	struct gccontext *gccontext = get_context();
+	struct list_head *head;
+	struct gcmapcache *gcmapcache;
+	struct gcimap gcimap;
+
+	GCLOCK(&gccontext->maplock);
+
+	while (!list_empty(&gccontext->mapcache)) {
+		head = gccontext->mapcache.next;
+		gcmapcache = list_entry(head, struct gcmapcache, link);
+
+		memset(&gcimap, 0, sizeof(gcimap));
+		gcimap.handle = gcmapcache->handle;
+		gc_unmap_wrapper(&gcimap);
+		if (gcimap.gcerror != GCERR_NONE)
+			GCERR("failed to unmap cached mapping 0x%08X.\n",
+			      gcmapcache->handle);
+
+		list_move(head, &gccontext->mapcachevac);
+	}
+	gccontext->mapcachecount = 0;
+
+	while (!list_empty(&gccontext->mapcachevac)) {
+		head = gccontext->mapcachevac.next;
+		gcmapcache = list_entry(head, struct gcmapcache, link);
+		list_del(head);
+		gcfree(gcmapcache->pagearray);
+		gcfree(gcmapcache);
+	}
+
+	GCUNLOCK(&gccontext->maplock);
+}
+
+
 /*******************************************************************************
  * Memory management.
  */
@@ -126,6 +287,11 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 			      bvphysdesc->pageoffset);
 			GCDBG(GCZONE_MAPPING, "mapping size = %d\n",
 			      gcimap.size);
+
+			/* Swap chain buffers come back every frame; reuse
+			 * the mapping they had last time. */
+			gcimap.handle = find_cached_map(gccontext, bvphysdesc,
+							gcimap.size);
 		} else {
 			gcimap.buf.logical = bvbuffdesc->virtaddr;
 			gcimap.pagesize = 0;
@@ -142,11 +308,13 @@ enum bverror do_map(struct bvbuffdesc *bvbuffdesc,
 			      gcimap.size);
 		}
 
-		gc_map_wrapper(&gcimap);
-		if (gcimap.gcerror != GCERR_NONE) {
-			BVSETERROR(BVERR_OOM,
-				   "unable to allocate gccore memory");
-			goto fail;
+		if (gcimap.handle == 0) {
+			gc_map_wrapper(&gcimap);
+			if (gcimap.gcerror != GCERR_NONE) {
+				BVSETERROR(BVERR_OOM,
+					   "unable to allocate gccore memory");
+				goto fail;
+			}
 		}
 
 		/* Set map handle. */
@@ -321,8 +489,12 @@ void do_unmap_implicit(struct gcbatch *batch)
 
 		GCDBG(GCZONE_MAPPING, "  ready for unmapping.\n");
 
-		/* Set the handle. */
-		gcschedunmap->handle = bvbuffmapinfo->handle;
+		/* Set the handle; cached mappings are not unmapped, but
+		 * may push an older one out. */
+		gcschedunmap->handle = cache_map(gccontext, bvbuffdesc,
+						 bvbuffmapinfo->handle);
+		if (gcschedunmap->handle == 0)
+			list_move(head, &gccontext->unmapvac);
 
 		/* Remove from the buffer descriptor. */
 		if (prev == NULL)
@@ -170,10 +170,21 @@ static const unsigned int container[] = {
 	 64	/* OCDFMTDEF_CONTAINER_64BIT */
 };
 
+static inline unsigned int format_cache_index(enum ocdformat ocdformat)
+{
+	unsigned int hash = (unsigned int) ocdformat;
+
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+	return hash & (GC_FORMAT_CACHE_SIZE - 1);
+}
+
 enum bverror parse_format(struct bvbltparams *bvbltparams,
 			  struct surfaceinfo *surfaceinfo)
 {
 	enum bverror bverror = BVERR_NONE;
+	struct gccontext *gccontext = get_context();
+	struct gcformatcache *gcformatcache;
 	struct bvformatxlate *format;
 	enum ocdformat ocdformat;
 	unsigned int cs, std, alpha, subsample, layout;
@@ -183,6 +194,20 @@ enum bverror parse_format(struct bvbltparams *bvbltparams,
 	ocdformat = surfaceinfo->geom->format;
 	GCENTERARG(GCZONE_FORMAT, "ocdformat = 0x%08X\n", ocdformat);
 
+	/* Parsed before? Only valid formats are cached, so that errors
+	 * are still reported with their description. */
+	gcformatcache = &gccontext->formatcache[format_cache_index(ocdformat)];
+
+	GCLOCK(&gccontext->formatlock);
+	if (gcformatcache->valid && (gcformatcache->ocdformat == ocdformat)) {
+		*format = gcformatcache->format;
+		GCUNLOCK(&gccontext->formatlock);
+
+		GCDBG(GCZONE_FORMAT, "cached format.\n");
+		goto exit;
+	}
+	GCUNLOCK(&gccontext->formatlock);
+
 	cs = (ocdformat & OCDFMTDEF_CS_MASK)
 		>> OCDFMTDEF_CS_SHIFT;
 	std = (ocdformat & OCDFMTDEF_STD_MASK)
@@ -485,6 +510,12 @@ enum bverror parse_format(struct bvbltparams *bvbltparams,
 	GCDBG(GCZONE_FORMAT, "gcformat = %d\n", format->format);
 	GCDBG(GCZONE_FORMAT, "gcswizzle = %d\n", format->swizzle);
 
+	GCLOCK(&gccontext->formatlock);
+	gcformatcache->valid = true;
+	gcformatcache->ocdformat = ocdformat;
+	gcformatcache->format = *format;
+	GCUNLOCK(&gccontext->formatlock);
+
 	bverror = BVERR_NONE;
 
 exit:
@@ -1652,23 +1683,22 @@ exit:
 void process_dest_rotation(struct bvbltparams *bvbltparams,
 			   struct gcbatch *batch)
 {
-	GCENTER(GCZONE_DEST);
+	struct surfaceinfo *dstinfo;
 
-	/* Did clipping/destination rects change? */
-	if ((batch->batchflags & (BVBATCH_CLIPRECT |
-				  BVBATCH_DESTRECT |
-				  BVBATCH_DST)) != 0) {
-		struct surfaceinfo *dstinfo;
-		int dstoffsetX, dstoffsetY;
+	GCENTER(GCZONE_DEST);
 
-		/* Initialize the destination descriptor. */
-		dstinfo = &batch->dstinfo;
+	/* Initialize the destination descriptor. */
+	dstinfo = &batch->dstinfo;
 
+	/* The sizes and the origin offset only depend on the destination
+	 * surface and its angle. */
+	if (((batch->batchflags & BVBATCH_DST) != 0) ||
+	    !batch->dstsizevalid) {
 		switch (dstinfo->angle) {
 		case ROT_ANGLE_0:
 			/* Determine the origin offset. */
-			dstoffsetX = dstinfo->xpixalign;
-			dstoffsetY = dstinfo->ypixalign;
+			batch->dstoriginX = dstinfo->xpixalign;
+			batch->dstoriginY = dstinfo->ypixalign;
 
 			/* Determine geometry size. */
 			batch->dstwidth  = dstinfo->geom->width
@@ -1683,8 +1713,8 @@ void process_dest_rotation(struct bvbltparams *bvbltparams,
 
 		case ROT_ANGLE_90:
 			/* Determine the origin offset. */
-			dstoffsetX = dstinfo->ypixalign;
-			dstoffsetY = dstinfo->xpixalign;
+			batch->dstoriginX = dstinfo->ypixalign;
+			batch->dstoriginY = dstinfo->xpixalign;
 
 			/* Determine geometry size. */
 			batch->dstwidth  = dstinfo->geom->width
@@ -1701,8 +1731,8 @@ void process_dest_rotation(struct bvbltparams *bvbltparams,
 
 		case ROT_ANGLE_180:
 			/* Determine the origin offset. */
-			dstoffsetX = 0;
-			dstoffsetY = 0;
+			batch->dstoriginX = 0;
+			batch->dstoriginY = 0;
 
 			/* Determine geometry size. */
 			batch->dstwidth  = dstinfo->geom->width
@@ -1717,8 +1747,8 @@ void process_dest_rotation(struct bvbltparams *bvbltparams,
 
 		case ROT_ANGLE_270:
 			/* Determine the origin offset. */
-			dstoffsetX = 0;
-			dstoffsetY = 0;
+			batch->dstoriginX = 0;
+			batch->dstoriginY = 0;
 
 			/* Determine geometry size. */
 			batch->dstwidth  = dstinfo->geom->width
@@ -1734,33 +1764,40 @@ void process_dest_rotation(struct bvbltparams *bvbltparams,
 			break;
 
 		default:
-			dstoffsetX = 0;
-			dstoffsetY = 0;
+			batch->dstoriginX = 0;
+			batch->dstoriginY = 0;
 		}
 
+		batch->dstsizevalid = true;
+
+		GCDBG(GCZONE_DEST, "aligned geometry size = %dx%d\n",
+		      batch->dstwidth, batch->dstheight);
+		GCDBG(GCZONE_DEST, "aligned physical size = %dx%d\n",
+		      dstinfo->physwidth, dstinfo->physheight);
+		GCDBG(GCZONE_DEST, "origin offset (pixels) = %d,%d\n",
+		      batch->dstoriginX, batch->dstoriginY);
+	}
+
+	/* Did clipping/destination rects change? */
+	if ((batch->batchflags & (BVBATCH_CLIPRECT |
+				  BVBATCH_DESTRECT |
+				  BVBATCH_DST)) != 0) {
 		/* Compute adjusted destination rectangles. */
 		batch->dstadjusted.left
 			= batch->dstclipped.left
-			- dstoffsetX;
+			- batch->dstoriginX;
 		batch->dstadjusted.top
 			= batch->dstclipped.top
-			- dstoffsetY;
+			- batch->dstoriginY;
 		batch->dstadjusted.right
 			= batch->dstclipped.right
-			- dstoffsetX;
+			- batch->dstoriginX;
 		batch->dstadjusted.bottom
 			= batch->dstclipped.bottom
-			- dstoffsetY;
+			- batch->dstoriginY;
 
 		GCPRINT_RECT(GCZONE_DEST, "adjusted dest",
 			     &batch->dstadjusted);
-
-		GCDBG(GCZONE_DEST, "aligned geometry size = %dx%d\n",
-		      batch->dstwidth, batch->dstheight);
-		GCDBG(GCZONE_DEST, "aligned physical size = %dx%d\n",
-		      dstinfo->physwidth, dstinfo->physheight);
-		GCDBG(GCZONE_DEST, "origin offset (pixels) = %d,%d\n",
-		      dstoffsetX, dstoffsetY);
 	}
 
 	GCEXIT(GCZONE_DEST);
@@ -19,6 +19,7 @@
 #include <ui/GraphicBuffer.h>
 #include <ui/GraphicBufferMapper.h>
 #include <hal_public.h>
+#include <cutils/properties.h>
 
 namespace Ti {
 namespace Camera {
@@ -30,6 +31,11 @@ const int ANativeWindowDisplayAdapter::DISPLAY_TIMEOUT = 1000;  // seconds
 //Suspends buffers after given amount of failed dq's
 const int ANativeWindowDisplayAdapter::FAILED_DQS_TO_SUSPEND = 3;
 
+//Display refresh assumed for pacing unless debug.camera.display_refresh says otherwise
+const int ANativeWindowDisplayAdapter::DEFAULT_REFRESH_RATE = 60;
+///Q16 fixed point 1.0x, as used by CameraFrame::mDisplayZoom
+const uint32_t ANativeWindowDisplayAdapter::ZOOM_UNITY = 65536;
+
 
 OMX_COLOR_FORMATTYPE toOMXPixFormat(const char* parameters_format)
 {
@@ -99,6 +105,10 @@ ANativeWindowDisplayAdapter::ANativeWindowDisplayAdapter():mDisplayThread(NULL),
     mFrameProvider = NULL;
     mANativeWindow = NULL;
 
+    mAllocWindow = NULL;
+    mAllocWidth = 0;
+    mAllocHeight = 0;
+
     mFrameWidth = 0;
     mFrameHeight = 0;
     mPreviewWidth = 0;
@@ -107,9 +117,18 @@ ANativeWindowDisplayAdapter::ANativeWindowDisplayAdapter():mDisplayThread(NULL),
     mSuspend = false;
     mFailedDQs = 0;
 
+    mPacing = false;
+    mRefreshPeriod = 1000000000LL / DEFAULT_REFRESH_RATE;
+    mBaseLatency = 0;
+    mBaseLatencyValid = false;
+    mLastPostedSlot = -1;
+    mFramesDropped = 0;
+    mFramesLate = 0;
+
     mPaused = false;
     mXOff = -1;
     mYOff = -1;
+    mCropZoom = 0;
     mFirstInit = false;
 
     mFD = -1;
@@ -327,6 +346,27 @@ int ANativeWindowDisplayAdapter::enableDisplay(int width, int height, struct tim
     mFrameProvider->enableFrameNotification(CameraFrame::PREVIEW_FRAME_SYNC);
     mFrameProvider->enableFrameNotification(CameraFrame::SNAPSHOT_FRAME);
 
+    {
+        char value[PROPERTY_VALUE_MAX];
+        int refresh;
+
+        android::AutoMutex lock(mLock);
+
+        property_get("debug.camera.display_pacing", value, "0");
+        mPacing = ( 0 != atoi(value) );
+
+        property_get("debug.camera.display_refresh", value, "0");
+        refresh = atoi(value);
+        if ( 0 >= refresh ) {
+            refresh = DEFAULT_REFRESH_RATE;
+        }
+        mRefreshPeriod = 1000000000LL / refresh;
+
+        // Sensor clock offset is learned again for every preview session
+        mBaseLatencyValid = false;
+        mLastPostedSlot = -1;
+    }
+
     mDisplayEnabled = true;
     mPreviewWidth = width;
     mPreviewHeight = height;
@@ -389,6 +429,7 @@ int ANativeWindowDisplayAdapter::disableDisplay(bool cancel_buffer)
         ///Reset the offset values
         mXOff = -1;
         mYOff = -1;
+        mCropZoom = 0;
 
         ///Reset the frame width and height values
         mFrameWidth =0;
@@ -453,11 +494,7 @@ CameraBuffer* ANativeWindowDisplayAdapter::allocateBufferList(int width, int hei
 {
     LOG_FUNCTION_NAME;
     status_t err;
-    int i = -1;
     const int lnumBufs = numBufs;
-    int undequeued = 0;
-    android::GraphicBufferMapper &mapper = android::GraphicBufferMapper::get();
-    android::Rect bounds;
 
     mBuffers = new CameraBuffer [lnumBufs];
     memset (mBuffers, 0, sizeof(CameraBuffer) * lnumBufs);
@@ -526,8 +563,65 @@ CameraBuffer* ANativeWindowDisplayAdapter::allocateBufferList(int width, int hei
         return NULL;
     }
 
-    mANativeWindow->get_min_undequeued_buffer_count(mANativeWindow, &undequeued);
     mPixelFormat = CameraHal::getPixelFormatConstant(format);
+    mAllocWindow = mANativeWindow;
+    mAllocWidth = width;
+    mAllocHeight = height;
+
+    LOG_FUNCTION_NAME_EXIT;
+    return dequeueBufferList(width, height, format, bytes);
+}
+
+/**
+   @brief Hands the buffers of the window to the camera again without
+          reconfiguring the window, so the window keeps its gralloc buffers.
+          Falls back to a fresh allocation when anything the window was
+          configured with has changed. buflist is consumed either way.
+ */
+CameraBuffer* ANativeWindowDisplayAdapter::reallocateBufferList(CameraBuffer *buflist, int width, int height,
+                                                                const char* format, int &bytes, int numBufs)
+{
+    LOG_FUNCTION_NAME;
+
+    if ( ( NULL == buflist ) || ( buflist != mBuffers ) ||
+         ( NULL == mANativeWindow ) || ( mANativeWindow != mAllocWindow ) ||
+         ( numBufs != mBufferCount ) || ( width != mAllocWidth ) || ( height != mAllocHeight ) ||
+         ( CameraHal::getPixelFormatConstant(format) != mPixelFormat ) ||
+         !mFramesWithCameraAdapterMap.isEmpty() ) {
+        CAMHAL_LOGDA("Preview buffers can't be reused, allocating new ones");
+        freeBufferList(buflist);
+        LOG_FUNCTION_NAME_EXIT;
+        return allocateBufferList(width, height, format, bytes, numBufs);
+    }
+
+    CAMHAL_LOGDB("Reusing %d preview buffers %dx%d", numBufs, width, height);
+
+    mFramesType.clear();
+
+    // The handle order may change, don't keep a descriptor of the old first buffer
+    if ( -1 != mFD ) {
+        close(mFD);
+        mFD = -1;
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+    return dequeueBufferList(width, height, format, bytes);
+}
+
+/**
+   @brief Dequeues all mBufferCount buffers of the configured window into
+          mBuffers, keeps the queueable ones and cancels the rest back
+ */
+CameraBuffer* ANativeWindowDisplayAdapter::dequeueBufferList(int width, int height, const char* format, int &bytes)
+{
+    LOG_FUNCTION_NAME;
+    status_t err;
+    int i = -1;
+    int undequeued = 0;
+    android::GraphicBufferMapper &mapper = android::GraphicBufferMapper::get();
+    android::Rect bounds;
+
+    mANativeWindow->get_min_undequeued_buffer_count(mANativeWindow, &undequeued);
 
     for ( i=0; i < mBufferCount; i++ )
     {
@@ -1001,8 +1095,70 @@ bool ANativeWindowDisplayAdapter::processHalMsg()
 }
 
 
+void ANativeWindowDisplayAdapter::getFrameStats(unsigned int &dropped, unsigned int &late) const
+{
+    android::AutoMutex lock(mLock);
+
+    dropped = mFramesDropped;
+    late = mFramesLate;
+}
+
+/**
+   @brief Decides whether a preview frame should reach the display.
+
+   Sensor timestamps run on the Ducati clock, so the smallest
+   arrival-minus-sensor delta seen so far is taken as the pipeline base
+   latency. Frames exceeding it by more than a refresh period are counted
+   as late. With pacing enabled, a frame that falls into the same display
+   refresh as the previously posted one would never be seen and only keeps
+   a buffer away from the camera, so it is dropped instead.
+
+   Must be called with mLock held.
+
+   @param[in] dispFrame  Frame about to be posted
+   @return true if the frame should be enqueued, false to return it
+ */
+bool ANativeWindowDisplayAdapter::paceFrame(const DisplayFrame &dispFrame)
+{
+    nsecs_t now, latency;
+    int64_t slot;
+
+    if ( ( CameraFrame::PREVIEW_FRAME_SYNC != dispFrame.mType ) ||
+         ( 0 >= dispFrame.mTimestamp ) ) {
+        return true;
+    }
+
+    now = systemTime(SYSTEM_TIME_MONOTONIC);
+    latency = now - dispFrame.mTimestamp;
+    if ( !mBaseLatencyValid || ( latency < mBaseLatency ) ) {
+        mBaseLatency = latency;
+        mBaseLatencyValid = true;
+    }
+
+    if ( ( latency - mBaseLatency ) > mRefreshPeriod ) {
+        mFramesLate++;
+    }
+
+    if ( !mPacing ) {
+        return true;
+    }
+
+    slot = ( dispFrame.mTimestamp + mBaseLatency ) / mRefreshPeriod;
+    if ( slot == mLastPostedSlot ) {
+        mFramesDropped++;
+        CAMHAL_LOGVB("Pacing drops frame %p, refresh slot %lld already taken",
+                     dispFrame.mBuffer, ( long long ) slot);
+        return false;
+    }
+
+    mLastPostedSlot = slot;
+
+    return true;
+}
+
 status_t ANativeWindowDisplayAdapter::PostFrame(ANativeWindowDisplayAdapter::DisplayFrame &dispFrame)
 {
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_DISPLAY);
     status_t ret = NO_ERROR;
     uint32_t actualFramesWithDisplay = 0;
     android_native_buffer_t *buffer = NULL;
@@ -1052,26 +1208,43 @@ status_t ANativeWindowDisplayAdapter::PostFrame(ANativeWindowDisplayAdapter::Dis
 
     if ( mDisplayState == ANativeWindowDisplayAdapter::DISPLAY_STARTED &&
                 (!mPaused ||  CameraFrame::CameraFrame::SNAPSHOT_FRAME == dispFrame.mType) &&
-                !mSuspend)
+                !mSuspend &&
+                paceFrame(dispFrame))
     {
         uint32_t xOff, yOff;
 
         CameraHal::getXYFromOffset(&xOff, &yOff, dispFrame.mOffset, PAGE_SIZE, mPixelFormat);
 
-        // Set crop only if current x and y offsets do not match with frame offsets
-        if ((mXOff != xOff) || (mYOff != yOff)) {
+        // Set crop only if current x and y offsets or the smooth zoom
+        // crop do not match with the frame
+        if ((mXOff != xOff) || (mYOff != yOff) || (mCropZoom != dispFrame.mZoom)) {
+            uint32_t cropWidth = mPreviewWidth;
+            uint32_t cropHeight = mPreviewHeight;
+
+            // Smooth zoom steps within the sensor output margin are shown
+            // by cropping the centre of the frame instead of waiting for
+            // the OMX digital zoom to be reconfigured
+            if ( ZOOM_UNITY < dispFrame.mZoom ) {
+                cropWidth = ((uint64_t) mPreviewWidth * ZOOM_UNITY / dispFrame.mZoom) & ~1;
+                cropHeight = ((uint64_t) mPreviewHeight * ZOOM_UNITY / dispFrame.mZoom) & ~1;
+            }
+
+            uint32_t left = xOff + ((mPreviewWidth - cropWidth) / 2 & ~1);
+            uint32_t top = yOff + ((mPreviewHeight - cropHeight) / 2 & ~1);
+
             CAMHAL_LOGDB("offset = %u left = %d top = %d right = %d bottom = %d",
-                          dispFrame.mOffset, xOff, yOff ,
-                          xOff + mPreviewWidth, yOff + mPreviewHeight);
+                          dispFrame.mOffset, left, top,
+                          left + cropWidth, top + cropHeight);
 
             // We'll ignore any errors here, if the surface is
             // already invalid, we'll know soon enough.
-            mANativeWindow->set_crop(mANativeWindow, xOff, yOff,
-                                     xOff + mPreviewWidth, yOff + mPreviewHeight);
+            mANativeWindow->set_crop(mANativeWindow, left, top,
+                                     left + cropWidth, top + cropHeight);
 
             // Update the current x and y offsets
             mXOff = xOff;
             mYOff = yOff;
+            mCropZoom = dispFrame.mZoom;
         }
 
         {
@@ -1080,10 +1253,17 @@ status_t ANativeWindowDisplayAdapter::PostFrame(ANativeWindowDisplayAdapter::Dis
                 // unlock buffer before sending to display
                 mapper.unlock(*handle);
             }
+            camera_buffer_trace(&mBuffers[i], FRAME_TRACE_CAM_POST);
             ret = mANativeWindow->enqueue_buffer(mANativeWindow, handle);
         }
         if ( NO_ERROR != ret ) {
             CAMHAL_LOGE("Surface::queueBuffer returned error %d", ret);
+        } else {
+            CameraPerfCounters::event(CameraPerfCounters::EVENT_DISPLAY_POSTED);
+            if ( 0 < dispFrame.mFillTime ) {
+                CameraPerfCounters::latency(CameraPerfCounters::LATENCY_FILL_TO_DISPLAY,
+                                            systemTime(SYSTEM_TIME_MONOTONIC) - dispFrame.mFillTime);
+            }
         }
 
         mFramesWithCameraAdapterMap.removeItem((buffer_handle_t *) dispFrame.mBuffer->opaque);
@@ -1122,6 +1302,7 @@ status_t ANativeWindowDisplayAdapter::PostFrame(ANativeWindowDisplayAdapter::Dis
 
 bool ANativeWindowDisplayAdapter::handleFrameReturn()
 {
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_DISPLAY);
     status_t err;
     buffer_handle_t *buf;
     int i = 0;
@@ -1142,6 +1323,7 @@ bool ANativeWindowDisplayAdapter::handleFrameReturn()
     err = mANativeWindow->dequeue_buffer(mANativeWindow, &buf, &stride);
     if (err != 0) {
         CAMHAL_LOGE("Surface::dequeueBuffer failed: %s (%d)", strerror(-err), -err);
+        CameraPerfCounters::event(CameraPerfCounters::EVENT_DISPLAY_STARVED);
 
         if ( NO_INIT == err ) {
             CAMHAL_LOGEA("Preview surface abandoned!");
@@ -1249,6 +1431,9 @@ void ANativeWindowDisplayAdapter::frameCallback(CameraFrame* caFrame)
     df.mLength = caFrame->mLength;
     df.mWidth = caFrame->mWidth;
     df.mHeight = caFrame->mHeight;
+    df.mTimestamp = caFrame->mTimestamp;
+    df.mZoom = caFrame->mDisplayZoom;
+    df.mFillTime = caFrame->mFillTime;
     PostFrame(df);
 }
 
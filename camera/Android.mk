@@ -21,6 +21,11 @@ ifdef TI_CAMERAHAL_DEBUG_FUNCTION_NAMES
     CAMERAHAL_CFLAGS += -DTI_UTILS_FUNCTION_LOGGER_ENABLE
 endif
 
+# Systrace zones built into release builds, see TI_UTILS_TRACE_ZONE_* in
+# DebugUtils.h: HAL, adapter and display frame paths by default
+TI_CAMERAHAL_TRACE_ZONES ?= 0x7
+CAMERAHAL_CFLAGS += -DTI_UTILS_TRACE_ZONES=$(TI_CAMERAHAL_TRACE_ZONES)
+
 ifdef TI_CAMERAHAL_DEBUG_TIMESTAMPS
     # Enable timestamp logging
     CAMERAHAL_CFLAGS += -DTI_UTILS_DEBUG_USE_TIMESTAMPS
@@ -52,6 +57,7 @@ CAMERAHAL_CFLAGS += -DLOG_TAG=\"CameraHal\"
 
 TI_CAMERAHAL_COMMON_INCLUDES := \
     $(COMMON_FOLDER)/hwc \
+    $(COMMON_FOLDER)/include/trace \
     external/jpeg \
     external/jhead \
     $(LOCAL_PATH)/../libtiutils \
@@ -74,6 +80,7 @@ TI_CAMERAHAL_COMMON_SRC := \
     Decoder_libjpeg.cpp \
     SensorListener.cpp  \
     NV12_resize.cpp \
+    NV12_convert.cpp \
     CameraParameters.cpp \
     TICameraParameters.cpp \
     CameraHalCommon.cpp \
@@ -158,3 +165,12 @@ LOCAL_MODULE_TAGS:= optional
 
 include $(BUILD_SHARED_LIBRARY)
 
+
+# Preview callback conversion benchmark, C against NEON kernels
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := NV12_convert_bench.cpp NV12_convert.cpp
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/inc
+LOCAL_CFLAGS := $(CAMERAHAL_CFLAGS)
+LOCAL_MODULE := nv12_convert_bench
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
@@ -20,7 +20,9 @@
 #include <MetadataBufferType.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/GraphicBufferMapper.h>
+#include <cutils/properties.h>
 #include "NV12_resize.h"
+#include "NV12_convert.h"
 #include "TICameraParameters.h"
 
 namespace Ti {
@@ -138,6 +140,8 @@ void AppCallbackNotifier::EncoderDoneCb(void* main_jpeg, void* thumb_jpeg, Camer
         {
             mDataCb(CAMERA_MSG_COMPRESSED_IMAGE, picture, 0, NULL, mCallbackCookie);
         }
+
+        CameraPerfCounters::shotDelivered();
     }
 
  exit:
@@ -174,6 +178,14 @@ status_t AppCallbackNotifier::initialize()
     LOG_FUNCTION_NAME;
 
     mPreviewMemory = 0;
+    mSparePreviewMemory = 0;
+    mPreviewMemoryAllocs = 0;
+    mPreviewMemoryReuses = 0;
+    mMetadataMemory = 0;
+    mVideoSourceBuffers = NULL;
+    mVideoTargetBuffers = NULL;
+    mVideoBufferCount = 0;
+    mVideoMetadataMemory = NULL;
 
     mMeasurementEnabled = false;
 
@@ -203,6 +215,13 @@ status_t AppCallbackNotifier::initialize()
     mPreviewing = false;
     mExternalLocking = false;
 
+    // preview callback conversion kernels, 0 selects the portable C ones
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.camera.preview_neon", value, "1");
+    if (!NV12_setConvertImpl(atoi(value) ? NV12_CONVERT_NEON : NV12_CONVERT_C)) {
+        NV12_setConvertImpl(NV12_CONVERT_C);
+    }
+
     LOG_FUNCTION_NAME_EXIT;
 
     return ret;
@@ -425,21 +444,19 @@ void AppCallbackNotifier::notifyEvent()
                          ( NULL != mNotifyCb) &&
                          ( mCameraHal->msgTypeEnabled(CAMERA_MSG_PREVIEW_METADATA) ) )
                         {
-                        // WA for an issue inside CameraService
-                        camera_memory_t *tmpBuffer = mRequestMemory(-1, 1, 1, NULL);
+                        // WA for an issue inside CameraService, the buffer content is never used
+                        if ( NULL == mMetadataMemory ) {
+                            mMetadataMemory = mRequestMemory(-1, 1, 1, NULL);
+                        }
 
                         mDataCb(CAMERA_MSG_PREVIEW_METADATA,
-                                tmpBuffer,
+                                mMetadataMemory,
                                 0,
                                 metaEvtData->getMetadataResult(),
                                 mCallbackCookie);
 
                         metaEvtData.clear();
 
-                        if ( NULL != tmpBuffer ) {
-                            tmpBuffer->release(tmpBuffer);
-                        }
-
                         }
 
                     break;
@@ -491,7 +508,6 @@ static void copy2Dto1D(void *dst,
     unsigned int alignedRow, row;
     unsigned char *bufferDst, *bufferSrc;
     unsigned char *bufferDstEnd, *bufferSrcEnd;
-    uint16_t *bufferSrc_UV;
 
     unsigned int *y_uv = (unsigned int *)src;
 
@@ -552,8 +568,6 @@ static void copy2Dto1D(void *dst,
             bufferSrc = ( unsigned char * ) y_uv[0] + offset;
             bufferSrcEnd = ( unsigned char * ) ( ( size_t ) y_uv[0] + length + offset);
             row = width*bytesPerPixel;
-            alignedRow = stride-width;
-            int stride_bytes = stride / 8;
             uint32_t xOff = offset % stride;
             uint32_t yOff = offset / stride;
 
@@ -568,66 +582,13 @@ static void copy2Dto1D(void *dst,
                 }
             }
 
-            bufferSrc_UV = ( uint16_t * ) ((uint8_t*)y_uv[1] + (stride/2)*yOff + xOff);
+            const uint8_t *bufferSrcUV = (uint8_t*)y_uv[1] + (stride/2)*yOff + xOff;
 
             if (strcmp(pixelFormat, android::CameraParameters::PIXEL_FORMAT_YUV420SP) == 0) {
-                 uint16_t *bufferDst_UV;
-
                 // Step 2: UV plane: convert NV12 to NV21 by swapping U & V
-                bufferDst_UV = (uint16_t *) (((uint8_t*)dst)+row*height);
-
-#ifdef ARCH_ARM_HAVE_NEON
-                for (int i = 0 ; i < height/2 ; i++, bufferSrc_UV += alignedRow/2) {
-                    int n = width;
-                    asm volatile (
-                    "   pld [%[src], %[src_stride], lsl #2]                         \n\t"
-                    "   cmp %[n], #32                                               \n\t"
-                    "   blt 1f                                                      \n\t"
-                    "0: @ 32 byte swap                                              \n\t"
-                    "   sub %[n], %[n], #32                                         \n\t"
-                    "   vld2.8  {q0, q1} , [%[src]]!                                \n\t"
-                    "   vswp q0, q1                                                 \n\t"
-                    "   cmp %[n], #32                                               \n\t"
-                    "   vst2.8  {q0,q1},[%[dst]]!                                   \n\t"
-                    "   bge 0b                                                      \n\t"
-                    "1: @ Is there enough data?                                     \n\t"
-                    "   cmp %[n], #16                                               \n\t"
-                    "   blt 3f                                                      \n\t"
-                    "2: @ 16 byte swap                                              \n\t"
-                    "   sub %[n], %[n], #16                                         \n\t"
-                    "   vld2.8  {d0, d1} , [%[src]]!                                \n\t"
-                    "   vswp d0, d1                                                 \n\t"
-                    "   cmp %[n], #16                                               \n\t"
-                    "   vst2.8  {d0,d1},[%[dst]]!                                   \n\t"
-                    "   bge 2b                                                      \n\t"
-                    "3: @ Is there enough data?                                     \n\t"
-                    "   cmp %[n], #8                                                \n\t"
-                    "   blt 5f                                                      \n\t"
-                    "4: @ 8 byte swap                                               \n\t"
-                    "   sub %[n], %[n], #8                                          \n\t"
-                    "   vld2.8  {d0, d1} , [%[src]]!                                \n\t"
-                    "   vswp d0, d1                                                 \n\t"
-                    "   cmp %[n], #8                                                \n\t"
-                    "   vst2.8  {d0[0],d1[0]},[%[dst]]!                             \n\t"
-                    "   bge 4b                                                      \n\t"
-                    "5: @ end                                                       \n\t"
-#ifdef NEEDS_ARM_ERRATA_754319_754320
-                    "   vmov s0,s0  @ add noop for errata item                      \n\t"
-#endif
-                    : [dst] "+r" (bufferDst_UV), [src] "+r" (bufferSrc_UV), [n] "+r" (n)
-                    : [src_stride] "r" (stride_bytes)
-                    : "cc", "memory", "q0", "q1"
-                    );
-                }
-#else
-                for ( int i = 0; i < height/2; ++i ) {
-                    for ( int j = 0; j < width/2; ++j ) {
-                        bufferDst_UV[j] = (bufferSrc_UV[j] >> 8) | (bufferSrc_UV[j] << 8);
-                    }
-                    bufferSrc_UV += stride/bytesPerPixel/2;
-                    bufferDst_UV += width/2;
-                }
-#endif
+                NV12_convertUVtoVU(bufferSrcUV, stride,
+                                   ((uint8_t*)dst) + row*height, width,
+                                   width, height/2);
             } else if (strcmp(pixelFormat, android::CameraParameters::PIXEL_FORMAT_YUV420P) == 0) {
                 // Step 2: UV plane: convert NV12 to YV12 by de-interleaving U & V
                 // TODO(XXX): This version of CameraHal assumes NV12 format it set at
@@ -637,72 +598,9 @@ static void copy2Dto1D(void *dst,
                 size_t yStride, uvStride, ySize, uvSize, size;
                 alignYV12(width, height, yStride, uvStride, ySize, uvSize, size);
 
-                uint16_t *bufferDst_V = (uint16_t *) (((uint8_t*)dst) + ySize);
-                uint16_t *bufferDst_U = (uint16_t *) (((uint8_t*)dst) + ySize + uvSize);
-
-#ifdef ARCH_ARM_HAVE_NEON
-                int inc = (uvStride - width/2)/2;
-
-                for (int i = 0 ; i < height/2 ; i++, bufferSrc_UV += alignedRow/2) {
-                    int n = width;
-                    asm volatile (
-                    "   pld [%[src], %[src_stride], lsl #2]                         \n\t"
-                    "   cmp %[n], #32                                               \n\t"
-                    "   blt 1f                                                      \n\t"
-                    "0: @ 32 byte swap                                              \n\t"
-                    "   sub %[n], %[n], #32                                         \n\t"
-                    "   vld2.8  {q0, q1} , [%[src]]!                                \n\t"
-                    "   cmp %[n], #32                                               \n\t"
-                    "   vst1.8  {q1},[%[dst_v]]!                                    \n\t"
-                    "   vst1.8  {q0},[%[dst_u]]!                                    \n\t"
-                    "   bge 0b                                                      \n\t"
-                    "1: @ Is there enough data?                                     \n\t"
-                    "   cmp %[n], #16                                               \n\t"
-                    "   blt 3f                                                      \n\t"
-                    "2: @ 16 byte swap                                              \n\t"
-                    "   sub %[n], %[n], #16                                         \n\t"
-                    "   vld2.8  {d0, d1} , [%[src]]!                                \n\t"
-                    "   cmp %[n], #16                                               \n\t"
-                    "   vst1.8  {d1},[%[dst_v]]!                                    \n\t"
-                    "   vst1.8  {d0},[%[dst_u]]!                                    \n\t"
-                    "   bge 2b                                                      \n\t"
-                    "3: @ Is there enough data?                                     \n\t"
-                    "   cmp %[n], #8                                                \n\t"
-                    "   blt 5f                                                      \n\t"
-                    "4: @ 8 byte swap                                               \n\t"
-                    "   sub %[n], %[n], #8                                          \n\t"
-                    "   vld2.8  {d0, d1} , [%[src]]!                                \n\t"
-                    "   cmp %[n], #8                                                \n\t"
-                    "   vst1.8  {d1[0]},[%[dst_v]]!                                 \n\t"
-                    "   vst1.8  {d0[0]},[%[dst_u]]!                                 \n\t"
-                    "   bge 4b                                                      \n\t"
-                    "5: @ end                                                       \n\t"
-#ifdef NEEDS_ARM_ERRATA_754319_754320
-                    "   vmov s0,s0  @ add noop for errata item                      \n\t"
-#endif
-                    : [dst_u] "+r" (bufferDst_U), [dst_v] "+r" (bufferDst_V),
-                      [src] "+r" (bufferSrc_UV), [n] "+r" (n)
-                    : [src_stride] "r" (stride_bytes)
-                    : "cc", "memory", "q0", "q1"
-                    );
-
-                    bufferDst_U += inc;
-                    bufferDst_V += inc;
-                }
-#else
-                uint8_t * udst = reinterpret_cast<uint8_t*>(bufferDst_V);
-                uint8_t * vdst = reinterpret_cast<uint8_t*>(bufferDst_U);
-
-                for ( int i = 0; i < height/2; ++i ) {
-                    for ( int j = 0; j < width/2; ++j ) {
-                        udst[j] = bufferSrc_UV[j] >> 8;
-                        vdst[j] = bufferSrc_UV[j] & 0x00ff;
-                    }
-                    bufferSrc_UV += stride/bytesPerPixel/2;
-                    udst += width/2;
-                    vdst += width/2;
-                }
-#endif
+                NV12_convertUVtoYV12(bufferSrcUV, stride,
+                                     ((uint8_t*)dst) + ySize, ((uint8_t*)dst) + ySize + uvSize, uvStride,
+                                     width, height/2);
             }
             return ;
 
@@ -782,6 +680,7 @@ void AppCallbackNotifier::copyAndSendPictureFrame(CameraFrame* frame, int32_t ms
             size = CameraHal::calculateBufferSize(frame->mBuffer->format, frame->mWidth, frame->mHeight);
             picture = mRequestMemory(-1, size, 1, NULL);
             if (picture && picture->data) {
+                camera_buffer_sync_for_cpu(frame->mBuffer, 0, frame->mBuffer->size);
                 copyCroppedNV12(frame, (unsigned char*) picture->data);
             }
         } else {
@@ -790,6 +689,7 @@ void AppCallbackNotifier::copyAndSendPictureFrame(CameraFrame* frame, int32_t ms
             if (NULL != picture) {
                 dest = picture->data;
                 if (NULL != dest) {
+                    camera_buffer_sync_for_cpu(frame->mBuffer, frame->mOffset, frame->mLength);
                     src = (void *) ((unsigned int) frame->mBuffer->mapped + frame->mOffset);
                     memcpy(dest, src, frame->mLength);
                 }
@@ -958,6 +858,7 @@ status_t AppCallbackNotifier::dummyRaw()
 
 void AppCallbackNotifier::notifyFrame()
 {
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_HAL);
     ///Receive and send the frame notifications to app
     Utils::Message msg;
     CameraFrame *frame;
@@ -1063,6 +964,7 @@ void AppCallbackNotifier::notifyFrame()
                     CAMHAL_LOGDB("Video snapshot offset = %d", frame->mOffset);
 
                     if (main_jpeg) {
+                        camera_buffer_sync_for_cpu(frame->mBuffer, frame->mOffset, frame->mLength);
                         main_jpeg->src = (uint8_t *)frame->mBuffer->mapped;
                         main_jpeg->src_size = frame->mLength;
                         main_jpeg->dst = (uint8_t*) buf;
@@ -1173,19 +1075,20 @@ void AppCallbackNotifier::notifyFrame()
                         {
                         if(mUseMetaDataBufferMode)
                             {
-                            camera_memory_t *videoMedatadaBufferMemory =
-                                             mVideoMetadataBufferMemoryMap.valueFor(frame->mBuffer->opaque);
-                            video_metadata_t *videoMetadataBuffer = (video_metadata_t *) videoMedatadaBufferMemory->data;
+                            ssize_t slot = (NULL != frame->mBuffer) && (NULL != mVideoSourceBuffers) ?
+                                           frame->mBuffer - mVideoSourceBuffers : -1;
 
-                            if( (NULL == videoMedatadaBufferMemory) || (NULL == videoMetadataBuffer) || (NULL == frame->mBuffer) )
+                            if( (NULL == mVideoMetadataMemory) || (0 > slot) || ((size_t) slot >= mVideoBufferCount) )
                                 {
                                 CAMHAL_LOGEA("Error! One of the video buffers is NULL");
                                 break;
                                 }
 
+                            video_metadata_t *videoMetadataBuffer = (video_metadata_t *) mVideoMetadataMemory->data + slot;
+
                             if ( mUseVideoBuffers )
                               {
-                                CameraBuffer *vBuf = mVideoMap.valueFor(frame->mBuffer->opaque);
+                                CameraBuffer *vBuf = &mVideoTargetBuffers[slot];
                                 android::GraphicBufferMapper &mapper = android::GraphicBufferMapper::get();
                                 android::Rect bounds;
                                 bounds.left = 0;
@@ -1232,11 +1135,11 @@ void AppCallbackNotifier::notifyFrame()
                                 videoMetadataBuffer->offset = frame->mOffset;
                               }
 
-                            CAMHAL_LOGVB("mDataCbTimestamp : frame->mBuffer=0x%x, videoMetadataBuffer=0x%x, videoMedatadaBufferMemory=0x%x",
-                                            frame->mBuffer->opaque, videoMetadataBuffer, videoMedatadaBufferMemory);
+                            CAMHAL_LOGVB("mDataCbTimestamp : frame->mBuffer=0x%x, videoMetadataBuffer=0x%x, slot=%d",
+                                            frame->mBuffer->opaque, videoMetadataBuffer, slot);
 
                             mDataCbTimestamp(frame->mTimestamp, CAMERA_MSG_VIDEO_FRAME,
-                                                videoMedatadaBufferMemory, 0, mCallbackCookie);
+                                                mVideoMetadataMemory, slot, mCallbackCookie);
                             }
                         else
                             {
@@ -1507,6 +1410,16 @@ AppCallbackNotifier::~AppCallbackNotifier()
 
     releaseSharedVideoBuffers();
 
+    if ( NULL != mSparePreviewMemory ) {
+        mSparePreviewMemory->release(mSparePreviewMemory);
+        mSparePreviewMemory = NULL;
+    }
+
+    if ( NULL != mMetadataMemory ) {
+        mMetadataMemory->release(mMetadataMemory);
+        mMetadataMemory = NULL;
+    }
+
     LOG_FUNCTION_NAME_EXIT;
 }
 
@@ -1517,23 +1430,16 @@ void AppCallbackNotifier::releaseSharedVideoBuffers()
 
     if(mUseMetaDataBufferMode)
     {
-        camera_memory_t* videoMedatadaBufferMemory;
-        for (unsigned int i = 0; i < mVideoMetadataBufferMemoryMap.size();  i++)
+        if(NULL != mVideoMetadataMemory)
             {
-            videoMedatadaBufferMemory = mVideoMetadataBufferMemoryMap.valueAt(i);
-            if(NULL != videoMedatadaBufferMemory)
-                {
-                videoMedatadaBufferMemory->release(videoMedatadaBufferMemory);
-                CAMHAL_LOGDB("Released  videoMedatadaBufferMemory=%p", videoMedatadaBufferMemory);
-                }
+            mVideoMetadataMemory->release(mVideoMetadataMemory);
+            CAMHAL_LOGDB("Released  mVideoMetadataMemory=%p", mVideoMetadataMemory);
+            mVideoMetadataMemory = NULL;
             }
 
-        mVideoMetadataBufferMemoryMap.clear();
-        mVideoMetadataBufferReverseMap.clear();
-        if (mUseVideoBuffers)
-            {
-            mVideoMap.clear();
-            }
+        mVideoSourceBuffers = NULL;
+        mVideoTargetBuffers = NULL;
+        mVideoBufferCount = 0;
     }
 
     LOG_FUNCTION_NAME_EXIT;
@@ -1613,7 +1519,19 @@ status_t AppCallbackNotifier::startPreviewCallbacks(android::CameraParameters &p
     mPreviewPixelFormat = CameraHal::getPixelFormatConstant(params.getPreviewFormat());
     size = CameraHal::calculateBufferSize(mPreviewPixelFormat, w, h);
 
-    mPreviewMemory = mRequestMemory(-1, size, AppCallbackNotifier::MAX_BUFFERS, NULL);
+    // restarting the preview with the same size reuses the previous callback buffers
+    if ( mSparePreviewMemory &&
+         ( mSparePreviewMemory->size == (size_t) size * AppCallbackNotifier::MAX_BUFFERS ) ) {
+        mPreviewMemory = mSparePreviewMemory;
+        mPreviewMemoryReuses++;
+    } else {
+        if ( mSparePreviewMemory ) {
+            mSparePreviewMemory->release(mSparePreviewMemory);
+        }
+        mPreviewMemory = mRequestMemory(-1, size, AppCallbackNotifier::MAX_BUFFERS, NULL);
+        mPreviewMemoryAllocs++;
+    }
+    mSparePreviewMemory = 0;
     if (!mPreviewMemory) {
         return NO_MEMORY;
     }
@@ -1696,8 +1614,10 @@ status_t AppCallbackNotifier::stopPreviewCallbacks()
 
     {
     android::AutoMutex lock(mLock);
-    mPreviewMemory->release(mPreviewMemory);
+    mSparePreviewMemory = mPreviewMemory;
     mPreviewMemory = 0;
+    CAMHAL_LOGDB("preview callback buffers: %u allocations, %u reuses",
+                 mPreviewMemoryAllocs, mPreviewMemoryReuses);
     }
 
     mPreviewing = false;
@@ -1755,37 +1675,38 @@ status_t AppCallbackNotifier::initSharedVideoBuffers(CameraBuffer *buffers, uint
 
     if(mUseMetaDataBufferMode)
         {
-        camera_memory_t* videoMedatadaBufferMemory = NULL;
-
         if(NULL == buffers)
             {
             CAMHAL_LOGEA("Error! Video buffers are NULL");
             return BAD_VALUE;
             }
 
-        for (uint32_t i = 0; i < count; i++)
+        if ( mUseVideoBuffers && (NULL == vidBufs) )
+            {
+            CAMHAL_LOGEA("Error! Video target buffers are NULL");
+            return BAD_VALUE;
+            }
+
+        // One allocation with a slot per buffer, the slot index is passed
+        // with every video frame and comes back in releaseRecordingFrame()
+        mVideoMetadataMemory = mRequestMemory(-1, sizeof(video_metadata_t), count, NULL);
+        if((NULL == mVideoMetadataMemory) || (NULL == mVideoMetadataMemory->data))
             {
-            videoMedatadaBufferMemory = mRequestMemory(-1, sizeof(video_metadata_t), 1, NULL);
-            if((NULL == videoMedatadaBufferMemory) || (NULL == videoMedatadaBufferMemory->data))
+            CAMHAL_LOGEA("Error! Could not allocate memory for Video Metadata Buffers");
+            if (NULL != mVideoMetadataMemory)
                 {
-                CAMHAL_LOGEA("Error! Could not allocate memory for Video Metadata Buffers");
-                return NO_MEMORY;
+                mVideoMetadataMemory->release(mVideoMetadataMemory);
+                mVideoMetadataMemory = NULL;
                 }
-
-            // FIXME remove cast
-            mVideoMetadataBufferMemoryMap.add((void *)buffers[i].opaque, videoMedatadaBufferMemory);
-            mVideoMetadataBufferReverseMap.add(videoMedatadaBufferMemory->data, &buffers[i]);
-            CAMHAL_LOGDB("buffers[%d]=%p, videoMedatadaBufferMemory=%p, videoMedatadaBufferMemory->data=%p",
-                    i, &buffers[i], videoMedatadaBufferMemory, videoMedatadaBufferMemory->data);
-
-            if (vidBufs != NULL)
-              {
-                //ASSERT(buffers[i].type == CAMERA_BUFFER_GRALLOC);
-                // FIXME remove cast
-                mVideoMap.add((void *)buffers[i].opaque, &vidBufs[i]);
-                CAMHAL_LOGVB("buffers[%d]=%p, vBuffArr[%d]=%p", i, &buffers[i], i, &vidBufs[i]);
-              }
+            return NO_MEMORY;
             }
+
+        mVideoSourceBuffers = buffers;
+        mVideoTargetBuffers = vidBufs;
+        mVideoBufferCount = count;
+
+        CAMHAL_LOGDB("%d video metadata slots at %p, buffers=%p, vidBufs=%p",
+                     count, mVideoMetadataMemory->data, buffers, vidBufs);
         }
 
 exit:
@@ -1854,8 +1775,20 @@ status_t AppCallbackNotifier::releaseRecordingFrame(const void* mem)
     if(mUseMetaDataBufferMode)
         {
         video_metadata_t *videoMetadataBuffer = (video_metadata_t *) mem ;
-        /* FIXME remove cast */
-        frame = mVideoMetadataBufferReverseMap.valueFor(videoMetadataBuffer);
+        ssize_t slot = -1;
+
+        if ( NULL != mVideoMetadataMemory )
+            {
+            slot = videoMetadataBuffer - (video_metadata_t *) mVideoMetadataMemory->data;
+            }
+
+        if ( (0 > slot) || ((size_t) slot >= mVideoBufferCount) )
+            {
+            CAMHAL_LOGEB("Released video metadata buffer %p is not ours", mem);
+            return BAD_VALUE;
+            }
+
+        frame = &mVideoSourceBuffers[slot];
         CAMHAL_LOGVB("Releasing frame with videoMetadataBuffer=0x%x, videoMetadataBuffer->handle=0x%x & frame handle=0x%x\n",
                        videoMetadataBuffer, videoMetadataBuffer->handle, frame);
         }
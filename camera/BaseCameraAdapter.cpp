@@ -16,6 +16,8 @@
 
 #include "BaseCameraAdapter.h"
 
+#include <pthread.h>
+
 const int EVENT_MASK = 0xffff;
 
 namespace Ti {
@@ -343,12 +345,10 @@ void BaseCameraAdapter::returnFrame(CameraBuffer * frameBuf, CameraFrame::FrameT
         return;
         }
 
+    CameraPerfCounters::frameReturned(frameType);
+
     if ( NO_ERROR == res)
         {
-        android::AutoMutex lock(mReturnFrameLock);
-
-        refCount = getFrameRefCount(frameBuf,  frameType);
-
         if(frameType == CameraFrame::PREVIEW_FRAME_SYNC)
             {
             mFramesWithDisplay--;
@@ -358,13 +358,24 @@ void BaseCameraAdapter::returnFrame(CameraBuffer * frameBuf, CameraFrame::FrameT
             mFramesWithEncoder--;
             }
 
-        if ( 0 < refCount )
+        // While recording the same buffer is shared between the preview,
+        // snapshot and video consumers, so the decrement and the check of
+        // the other consumer's count must be one step. Otherwise a single
+        // locked decrement is all a return needs and it never waits on
+        // other returns.
+        android::Mutex *sharedLock = NULL;
+        if ( mRecording && ((CameraFrame::VIDEO_FRAME_SYNC == frameType) ||
+                            (CameraFrame::PREVIEW_FRAME_SYNC == frameType) ||
+                            (CameraFrame::SNAPSHOT_FRAME == frameType)) )
             {
+            sharedLock = &mReturnFrameLock;
+            sharedLock->lock();
+            }
 
-            refCount--;
-            setFrameRefCount(frameBuf, frameType, refCount);
-
+        refCount = decFrameRefCount(frameBuf, frameType);
 
+        if ( 0 <= refCount )
+            {
             if ( mRecording && (CameraFrame::VIDEO_FRAME_SYNC == frameType) ) {
                 refCount += getFrameRefCount(frameBuf, CameraFrame::PREVIEW_FRAME_SYNC);
             } else if ( mRecording && (CameraFrame::PREVIEW_FRAME_SYNC == frameType) ) {
@@ -372,10 +383,14 @@ void BaseCameraAdapter::returnFrame(CameraBuffer * frameBuf, CameraFrame::FrameT
             } else if ( mRecording && (CameraFrame::SNAPSHOT_FRAME == frameType) ) {
                 refCount += getFrameRefCount(frameBuf, CameraFrame::VIDEO_FRAME_SYNC);
             }
+            }
 
-
+        if ( NULL != sharedLock )
+            {
+            sharedLock->unlock();
             }
-        else
+
+        if ( 0 > refCount )
             {
             CAMHAL_LOGDA("Frame returned when ref count is already zero!!");
             return;
@@ -1287,6 +1302,7 @@ status_t BaseCameraAdapter::notifyMetadataSubscribers(android::sp<CameraMetadata
 
 status_t BaseCameraAdapter::sendFrameToSubscribers(CameraFrame *frame)
 {
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_ADAPTER);
     status_t ret = NO_ERROR;
     unsigned int mask;
 
@@ -1407,6 +1423,8 @@ status_t BaseCameraAdapter::__sendFrameToSubscribers(CameraFrame* frame,
 
             callback(frame);
         }
+
+        CameraPerfCounters::frameSent(frameType, refCount);
     } else {
         CAMHAL_LOGEA("Subscribers is null??");
         return -EINVAL;
@@ -1581,6 +1599,91 @@ void BaseCameraAdapter::setFrameRefCount(CameraBuffer * frameBuf, CameraFrame::F
 
 }
 
+int BaseCameraAdapter::decFrameRefCount(CameraBuffer * frameBuf, CameraFrame::FrameType frameType)
+{
+    android::Mutex *lock = NULL;
+    int *count = NULL;
+    int res = -1;
+    ssize_t index;
+
+    LOG_FUNCTION_NAME;
+
+    switch ( frameType )
+        {
+        case CameraFrame::IMAGE_FRAME:
+        case CameraFrame::RAW_FRAME:
+            lock = &mCaptureBufferLock;
+            lock->lock();
+            index = mCaptureBuffersAvailable.indexOfKey(frameBuf);
+            if ( 0 <= index )
+                {
+                count = &mCaptureBuffersAvailable.editValueAt(index);
+                }
+            break;
+        case CameraFrame::SNAPSHOT_FRAME:
+            lock = &mSnapshotBufferLock;
+            lock->lock();
+            index = mSnapshotBuffersAvailable.indexOfKey( ( unsigned int ) frameBuf );
+            if ( 0 <= index )
+                {
+                count = &mSnapshotBuffersAvailable.editValueAt(index);
+                }
+            break;
+        case CameraFrame::PREVIEW_FRAME_SYNC:
+            lock = &mPreviewBufferLock;
+            lock->lock();
+            index = mPreviewBuffersAvailable.indexOfKey(frameBuf);
+            if ( 0 <= index )
+                {
+                count = &mPreviewBuffersAvailable.editValueAt(index);
+                }
+            break;
+        case CameraFrame::FRAME_DATA_SYNC:
+            lock = &mPreviewDataBufferLock;
+            lock->lock();
+            index = mPreviewDataBuffersAvailable.indexOfKey(frameBuf);
+            if ( 0 <= index )
+                {
+                count = &mPreviewDataBuffersAvailable.editValueAt(index);
+                }
+            break;
+        case CameraFrame::VIDEO_FRAME_SYNC:
+            lock = &mVideoBufferLock;
+            lock->lock();
+            index = mVideoBuffersAvailable.indexOfKey(frameBuf);
+            if ( 0 <= index )
+                {
+                count = &mVideoBuffersAvailable.editValueAt(index);
+                }
+            break;
+        case CameraFrame::REPROCESS_INPUT_FRAME:
+            lock = &mVideoInBufferLock;
+            lock->lock();
+            index = mVideoInBuffersAvailable.indexOfKey(frameBuf);
+            if ( 0 <= index )
+                {
+                count = &mVideoInBuffersAvailable.editValueAt(index);
+                }
+            break;
+        default:
+            break;
+        };
+
+    if ( ( NULL != count ) && ( 0 < *count ) )
+        {
+        res = --(*count);
+        }
+
+    if ( NULL != lock )
+        {
+        lock->unlock();
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+
+    return res;
+}
+
 status_t BaseCameraAdapter::startVideoCapture()
 {
     status_t ret = NO_ERROR;
@@ -2649,6 +2752,26 @@ extern "C" status_t V4LCameraAdapter_Capabilities(
         CameraProperties::Properties * const properties_array,
         const int starting_camera, const int max_camera, int & supportedCameras);
 
+#if defined(OMX_CAMERA_ADAPTER) && defined(V4L_CAMERA_ADAPTER)
+// V4L cameras are probed on a helper thread while OMX probes the sensors,
+// into a scratch array since their indices follow the OMX cameras
+struct V4LCapabilitiesProbe
+{
+    CameraProperties::Properties properties[MAX_CAMERAS_SUPPORTED];
+    int maxCamera;
+    int supportedCameras;
+    status_t err;
+};
+
+static void *v4lCapabilitiesThread(void *data)
+{
+    V4LCapabilitiesProbe * const probe = static_cast<V4LCapabilitiesProbe *>(data);
+    probe->err = V4LCameraAdapter_Capabilities(probe->properties, 0, probe->maxCamera,
+                                               probe->supportedCameras);
+    return NULL;
+}
+#endif
+
 extern "C" status_t CameraAdapter_Capabilities(
         CameraProperties::Properties * const properties_array,
         const int starting_camera, const int max_camera, int & supportedCameras)
@@ -2661,6 +2784,16 @@ extern "C" status_t CameraAdapter_Capabilities(
     LOG_FUNCTION_NAME;
 
     supportedCameras = 0;
+#if defined(OMX_CAMERA_ADAPTER) && defined(V4L_CAMERA_ADAPTER)
+    V4LCapabilitiesProbe * const v4lProbe = new V4LCapabilitiesProbe;
+    pthread_t v4lThread;
+    bool v4lThreaded = false;
+
+    v4lProbe->maxCamera = max_camera - starting_camera;
+    v4lProbe->supportedCameras = 0;
+    v4lProbe->err = NO_ERROR;
+    v4lThreaded = pthread_create(&v4lThread, NULL, v4lCapabilitiesThread, v4lProbe) == 0;
+#endif
 #ifdef OMX_CAMERA_ADAPTER
     //Query OMX cameras
     err = OMXCameraAdapter_Capabilities( properties_array, starting_camera,
@@ -2670,7 +2803,27 @@ extern "C" status_t CameraAdapter_Capabilities(
         ret = UNKNOWN_ERROR;
     }
 #endif
-#ifdef V4L_CAMERA_ADAPTER
+#if defined(OMX_CAMERA_ADAPTER) && defined(V4L_CAMERA_ADAPTER)
+    if ( v4lThreaded ) {
+        pthread_join(v4lThread, NULL);
+        err = v4lProbe->err;
+        //V4L cameras take the indices after the OMX ones
+        for ( int i = 0; i < v4lProbe->supportedCameras &&
+                         (starting_camera + supportedCameras + i) < max_camera; i++ ) {
+            properties_array[starting_camera + supportedCameras + i] = v4lProbe->properties[i];
+            num_cameras_supported++;
+        }
+    } else {
+        err = V4LCameraAdapter_Capabilities( properties_array, starting_camera + supportedCameras,
+                                             max_camera, num_cameras_supported);
+    }
+    delete v4lProbe;
+
+    if(err != NO_ERROR) {
+        CAMHAL_LOGEA("error while getting V4LCameraAdapter capabilities");
+        ret = UNKNOWN_ERROR;
+    }
+#elif defined(V4L_CAMERA_ADAPTER)
     //Query V4L cameras
     err = V4LCameraAdapter_Capabilities( properties_array, (const int) supportedCameras,
                                          max_camera, num_cameras_supported);
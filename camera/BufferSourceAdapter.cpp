@@ -138,6 +138,8 @@ BufferSourceAdapter::BufferSourceAdapter() : mBufferCount(0)
     mPreviewWidth = 0;
     mPreviewHeight = 0;
 
+    resetWindowConfig();
+
     LOG_FUNCTION_NAME_EXIT;
 }
 
@@ -230,6 +232,7 @@ int BufferSourceAdapter::setPreviewWindow(preview_stream_ops_t *source)
 
     // Move to new source obj
     mBufferSource = source;
+    resetWindowConfig();
 
     LOG_FUNCTION_NAME_EXIT;
 
@@ -337,6 +340,23 @@ status_t BufferSourceAdapter::pauseDisplay(bool pause)
 }
 
 
+void BufferSourceAdapter::resetWindowConfig()
+{
+    mConfiguredSource = NULL;
+    mConfiguredCount = 0;
+    mConfiguredWidth = 0;
+    mConfiguredHeight = 0;
+    mConfiguredFormat = 0;
+    mConfiguredUsage = 0;
+    mMappedCache.clear();
+}
+
+int BufferSourceAdapter::indexOfHandle(buffer_handle_t *handle) const
+{
+    const ssize_t index = mBufferIndex.indexOfKey(handle);
+    return (index < 0) ? -1 : mBufferIndex.valueAt(index);
+}
+
 void BufferSourceAdapter::destroy()
 {
     LOG_FUNCTION_NAME;
@@ -367,51 +387,70 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
     int usage = getUsageFromANW(pixFormat);
     mPixelFormat = CameraHal::getPixelFormatConstant(format);
 
-    // Set gralloc usage bits for window.
-    err = mBufferSource->set_usage(mBufferSource, usage);
-    if (err != 0) {
-        CAMHAL_LOGE("native_window_set_usage failed: %s (%d)", strerror(-err), -err);
+    // re-calculate height depending on stride and size
+    int height = getHeightFromFormat(format, width, bytes);
 
-        if ( ENODEV == err ) {
-            CAMHAL_LOGEA("Preview surface abandoned!");
-            mBufferSource = NULL;
-        }
+    mBufferCount = numBufs;
+    mBufferIndex.clear();
+
+    // A reprocess session with the same setup as the last one keeps the
+    // window's buffers instead of having them all reallocated
+    if ( (mConfiguredSource == mBufferSource) && (mConfiguredCount == numBufs) &&
+         (mConfiguredWidth == width) && (mConfiguredHeight == height) &&
+         (mConfiguredFormat == pixFormat) && (mConfiguredUsage == usage) ) {
+        CAMHAL_LOGDB("Reusing %d buffers of the previous session", numBufs);
+    } else {
+        resetWindowConfig();
 
-        return NULL;
-    }
+        // Set gralloc usage bits for window.
+        err = mBufferSource->set_usage(mBufferSource, usage);
+        if (err != 0) {
+            CAMHAL_LOGE("native_window_set_usage failed: %s (%d)", strerror(-err), -err);
 
-    CAMHAL_LOGDB("Number of buffers set to BufferSourceAdapter %d", numBufs);
-    // Set the number of buffers needed for this buffer source
-    err = mBufferSource->set_buffer_count(mBufferSource, numBufs);
-    if (err != 0) {
-        CAMHAL_LOGE("native_window_set_buffer_count failed: %s (%d)", strerror(-err), -err);
+            if ( ENODEV == err ) {
+                CAMHAL_LOGEA("Preview surface abandoned!");
+                mBufferSource = NULL;
+            }
 
-        if ( ENODEV == err ) {
-            CAMHAL_LOGEA("Preview surface abandoned!");
-            mBufferSource = NULL;
+            return NULL;
         }
 
-        return NULL;
-    }
+        CAMHAL_LOGDB("Number of buffers set to BufferSourceAdapter %d", numBufs);
+        // Set the number of buffers needed for this buffer source
+        err = mBufferSource->set_buffer_count(mBufferSource, numBufs);
+        if (err != 0) {
+            CAMHAL_LOGE("native_window_set_buffer_count failed: %s (%d)", strerror(-err), -err);
 
-    CAMHAL_LOGDB("Configuring %d buffers for ANativeWindow", numBufs);
-    mBufferCount = numBufs;
+            if ( ENODEV == err ) {
+                CAMHAL_LOGEA("Preview surface abandoned!");
+                mBufferSource = NULL;
+            }
 
-    // re-calculate height depending on stride and size
-    int height = getHeightFromFormat(format, width, bytes);
+            return NULL;
+        }
 
-    // Set window geometry
-    err = mBufferSource->set_buffers_geometry(mBufferSource,
-                                              width, height,
-                                              pixFormat);
+        CAMHAL_LOGDB("Configuring %d buffers for ANativeWindow", numBufs);
 
-    if (err != 0) {
-        CAMHAL_LOGE("native_window_set_buffers_geometry failed: %s (%d)", strerror(-err), -err);
-        if ( ENODEV == err ) {
-            CAMHAL_LOGEA("Preview surface abandoned!");
-            mBufferSource = NULL;
+        // Set window geometry
+        err = mBufferSource->set_buffers_geometry(mBufferSource,
+                                                  width, height,
+                                                  pixFormat);
+
+        if (err != 0) {
+            CAMHAL_LOGE("native_window_set_buffers_geometry failed: %s (%d)", strerror(-err), -err);
+            if ( ENODEV == err ) {
+                CAMHAL_LOGEA("Preview surface abandoned!");
+                mBufferSource = NULL;
+            }
+            return NULL;
         }
-        return NULL;
+
+        mConfiguredSource = mBufferSource;
+        mConfiguredCount = numBufs;
+        mConfiguredWidth = width;
+        mConfiguredHeight = height;
+        mConfiguredFormat = pixFormat;
+        mConfiguredUsage = usage;
     }
 
     if ( mBuffers == NULL ) {
@@ -443,6 +482,7 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
         mBuffers[i].type = CAMERA_BUFFER_ANW;
         mBuffers[i].format = mPixelFormat;
         mFramesWithCameraAdapterMap.add(handle, i);
+        mBufferIndex.add(handle, i);
 
         bytes = CameraHal::calculateBufferSize(format, width, height);
     }
@@ -455,17 +495,27 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
         mBufferSource->lock_buffer(mBufferSource, handle);
         mapper.lock(*handle, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
         mBuffers[i].mapped = y_uv[0];
+        mMappedCache.add(handle, y_uv[0]);
     }
 
     // return the rest of the buffers back to ANativeWindow
     for(i = (mBufferCount-undequeued); i >= 0 && i < mBufferCount; i++) {
         buffer_handle_t *handle = (buffer_handle_t *) mBuffers[i].opaque;
-        void *y_uv[2];
-        android::Rect bounds(width, height);
+        const ssize_t cached = mMappedCache.indexOfKey(handle);
 
-        mapper.lock(*handle, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
-        mBuffers[i].mapped = y_uv[0];
-        mapper.unlock(*handle);
+        // these are only locked to learn their address, which a buffer
+        // kept from the previous session already has
+        if ( cached >= 0 ) {
+            mBuffers[i].mapped = mMappedCache.valueAt(cached);
+        } else {
+            void *y_uv[2];
+            android::Rect bounds(width, height);
+
+            mapper.lock(*handle, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
+            mBuffers[i].mapped = y_uv[0];
+            mapper.unlock(*handle);
+            mMappedCache.add(handle, y_uv[0]);
+        }
 
         err = mBufferSource->cancel_buffer(mBufferSource, handle);
         if (err != 0) {
@@ -497,6 +547,7 @@ CameraBuffer* BufferSourceAdapter::allocateBufferList(int width, int dummyHeight
         mFramesWithCameraAdapterMap.removeItem((buffer_handle_t *) mBuffers[start].opaque);
     }
 
+    resetWindowConfig();
     freeBufferList(mBuffers);
 
     CAMHAL_LOGEA("Error occurred, performing cleanup");
@@ -578,6 +629,9 @@ CameraBuffer *BufferSourceAdapter::getBuffers(bool reset) {
             mBufferSource->lock_buffer(mBufferSource, handle);
             mapper.lock(*handle, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
             newBuffers[index].mapped = y_uv[0];
+            if (mMappedCache.indexOfKey(handle) < 0) {
+                mMappedCache.add(handle, y_uv[0]);
+            }
             CAMHAL_LOGDB("got handle %p", handle);
 
             missingIndices.removeItem(newBuffers[index].opaque);
@@ -601,6 +655,13 @@ CameraBuffer *BufferSourceAdapter::getBuffers(bool reset) {
 
         delete [] mBuffers;
         mBuffers = newBuffers;
+
+        mBufferIndex.clear();
+        for (int i = 0; i < mBufferCount; i++) {
+            if (mBuffers[i].opaque) {
+                mBufferIndex.add((buffer_handle_t *) mBuffers[i].opaque, i);
+            }
+        }
     }
 
     return mBuffers;
@@ -657,6 +718,8 @@ CameraBuffer* BufferSourceAdapter::getBufferList(int *num) {
     mBuffers[0].opaque = (void *)handle;
     mBuffers[0].type = CAMERA_BUFFER_ANW;
     mFramesWithCameraAdapterMap.add(handle, 0);
+    mBufferIndex.clear();
+    mBufferIndex.add(handle, 0);
 
     err = extendedOps()->get_buffer_dimension(mBufferSource, &mBuffers[0].width, &mBuffers[0].height);
     err = extendedOps()->get_buffer_format(mBufferSource, &formatSource);
@@ -826,6 +889,7 @@ int BufferSourceAdapter::freeBufferList(CameraBuffer * buflist)
         delete [] mBuffers;
         mBuffers = NULL;
     }
+    mBufferIndex.clear();
 
     return NO_ERROR;
 }
@@ -858,13 +922,10 @@ void BufferSourceAdapter::handleFrameCallback(CameraFrame* frame)
         return;
     }
 
-    for ( i = 0; i < mBufferCount; i++ ) {
-        if (frame->mBuffer == &mBuffers[i]) {
-            break;
-        }
-    }
+    // frames carry a pointer into mBuffers
+    i = frame->mBuffer - mBuffers;
 
-    if (i >= mBufferCount) {
+    if ((i < 0) || (i >= mBufferCount)) {
         CAMHAL_LOGD("Can't find frame in buffer list");
         if (frame->mFrameType != CameraFrame::REPROCESS_INPUT_FRAME) {
             mFrameProvider->returnFrame(frame->mBuffer,
@@ -969,17 +1030,16 @@ bool BufferSourceAdapter::handleFrameReturn()
         return false;
     }
 
-    mapper.lock(*buf, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
-
-    for(i = 0; i < mBufferCount; i++) {
-        if (mBuffers[i].opaque == buf)
-            break;
-    }
-
-    if (i >= mBufferCount) {
+    i = indexOfHandle(buf);
+    if (i < 0) {
+        // not one of ours, don't hand the window's buffer to the camera
         CAMHAL_LOGEB("Failed to find handle %p", buf);
+        mBufferSource->cancel_buffer(mBufferSource, buf);
+        return false;
     }
 
+    mapper.lock(*buf, CAMHAL_GRALLOC_USAGE, bounds, y_uv);
+
     mFramesWithCameraAdapterMap.add((buffer_handle_t *) mBuffers[i].opaque, i);
 
     CAMHAL_LOGVB("handleFrameReturn: found graphic buffer %d of %d", i, mBufferCount - 1);
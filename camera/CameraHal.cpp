@@ -29,7 +29,9 @@
 #include <cutils/properties.h>
 
 #include <poll.h>
+#include <pthread.h>
 #include <math.h>
+#include <sys/sysinfo.h>
 
 namespace Ti {
 namespace Camera {
@@ -37,6 +39,39 @@ namespace Camera {
 extern "C" CameraAdapter* OMXCameraAdapter_Factory(size_t);
 extern "C" CameraAdapter* V4LCameraAdapter_Factory(size_t, CameraHal*);
 
+// Adapter creation, including the OMX handle, runs on a helper thread
+// while initialize() sets up the rest of the HAL
+struct CameraAdapterInit
+{
+    CameraHal *hal;
+    bool v4l;
+    int sensorIndex;
+    CameraProperties::Properties *properties;
+    CameraAdapter *adapter;
+};
+
+static void *cameraAdapterInitThread(void *data)
+{
+    CameraAdapterInit * const init = static_cast<CameraAdapterInit *>(data);
+
+    init->adapter = NULL;
+    if ( init->v4l ) {
+#ifdef V4L_CAMERA_ADAPTER
+        init->adapter = V4LCameraAdapter_Factory(init->sensorIndex, init->hal);
+#endif
+    } else {
+#ifdef OMX_CAMERA_ADAPTER
+        init->adapter = OMXCameraAdapter_Factory(init->sensorIndex);
+#endif
+    }
+
+    if ( ( NULL != init->adapter ) && ( init->adapter->initialize(init->properties) != NO_ERROR ) ) {
+        init->adapter = NULL;
+    }
+
+    return NULL;
+}
+
 /*****************************************************************************/
 
 ////Constant definitions and declarations
@@ -402,11 +437,14 @@ int CameraHal::setParameters(const android::CameraParameters& params)
     {
         android::AutoMutex lock(mLock);
 
+        trimVideoPool(false);
+
         ///Ensure that preview is not enabled when the below parameters are changed.
         if(!previewEnabled())
             {
             if ((valstr = params.getPreviewFormat()) != NULL) {
-                if ( isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_PREVIEW_FORMATS))) {
+                if ( isParameterUnchanged(android::CameraParameters::KEY_PREVIEW_FORMAT, valstr) ||
+                     isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_PREVIEW_FORMATS))) {
                     mParameters.setPreviewFormat(valstr);
                     CAMHAL_LOGDB("PreviewFormat set %s", valstr);
                 } else {
@@ -490,7 +528,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
         }
 
         if ((valstr = params.get(TICameraParameters::KEY_IPP)) != NULL) {
-            if (isParameterValid(valstr,mCameraProperties->get(CameraProperties::SUPPORTED_IPP_MODES))) {
+            if (isParameterUnchanged(TICameraParameters::KEY_IPP, valstr) ||
+                    isParameterValid(valstr,mCameraProperties->get(CameraProperties::SUPPORTED_IPP_MODES))) {
                 if ((mParameters.get(TICameraParameters::KEY_IPP) == NULL) ||
                         (strcmp(valstr, mParameters.get(TICameraParameters::KEY_IPP)))) {
                     CAMHAL_LOGDB("IPP mode set %s", params.get(TICameraParameters::KEY_IPP));
@@ -593,7 +632,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
         CAMHAL_LOGDB("Preview Resolution: %d x %d", w, h);
 
         if ((valstr = params.get(android::CameraParameters::KEY_FOCUS_MODE)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_FOCUS_MODES))) {
+            if (isParameterUnchanged(android::CameraParameters::KEY_FOCUS_MODE, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_FOCUS_MODES))) {
                 CAMHAL_LOGDB("Focus mode set %s", valstr);
 
                 // we need to take a decision on the capture mode based on whether CAF picture or
@@ -641,7 +681,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
         CAMHAL_LOGDB("Picture Size by App %d x %d", w, h);
 
         if ( (valstr = params.getPictureFormat()) != NULL ) {
-            if (isParameterValid(valstr,mCameraProperties->get(CameraProperties::SUPPORTED_PICTURE_FORMATS))) {
+            if (isParameterUnchanged(android::CameraParameters::KEY_PICTURE_FORMAT, valstr) ||
+                isParameterValid(valstr,mCameraProperties->get(CameraProperties::SUPPORTED_PICTURE_FORMATS))) {
                 if ((strcmp(valstr, android::CameraParameters::PIXEL_FORMAT_BAYER_RGGB) == 0) &&
                     mCameraProperties->get(CameraProperties::MAX_PICTURE_WIDTH) &&
                     mCameraProperties->get(CameraProperties::MAX_PICTURE_HEIGHT)) {
@@ -791,7 +832,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
         }
 
         if ((valstr = params.get(TICameraParameters::KEY_EXPOSURE_MODE)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_EXPOSURE_MODES))) {
+            if (isParameterUnchanged(TICameraParameters::KEY_EXPOSURE_MODE, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_EXPOSURE_MODES))) {
                 CAMHAL_LOGDB("Exposure mode set = %s", valstr);
                 mParameters.set(TICameraParameters::KEY_EXPOSURE_MODE, valstr);
                 if (!strcmp(valstr, TICameraParameters::EXPOSURE_MODE_MANUAL)) {
@@ -849,7 +891,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
 #endif
 
         if ((valstr = params.get(android::CameraParameters::KEY_WHITE_BALANCE)) != NULL) {
-           if ( isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_WHITE_BALANCE))) {
+           if ( isParameterUnchanged(android::CameraParameters::KEY_WHITE_BALANCE, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_WHITE_BALANCE))) {
                CAMHAL_LOGDB("White balance set %s", valstr);
                mParameters.set(android::CameraParameters::KEY_WHITE_BALANCE, valstr);
             } else {
@@ -901,7 +944,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
 #endif
 
         if ((valstr = params.get(android::CameraParameters::KEY_ANTIBANDING)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_ANTIBANDING))) {
+            if (isParameterUnchanged(android::CameraParameters::KEY_ANTIBANDING, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_ANTIBANDING))) {
                 CAMHAL_LOGDB("Antibanding set %s", valstr);
                 mParameters.set(android::CameraParameters::KEY_ANTIBANDING, valstr);
              } else {
@@ -912,7 +956,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
 
 #ifdef OMAP_ENHANCEMENT
         if ((valstr = params.get(TICameraParameters::KEY_ISO)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_ISO_VALUES))) {
+            if (isParameterUnchanged(TICameraParameters::KEY_ISO, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_ISO_VALUES))) {
                 CAMHAL_LOGDB("ISO set %s", valstr);
                 mParameters.set(TICameraParameters::KEY_ISO, valstr);
             } else {
@@ -948,6 +993,18 @@ int CameraHal::setParameters(const android::CameraParameters& params)
                 }
 
             }
+
+        if( (valstr = params.get(TICameraParameters::KEY_FACE_DETECTION_RATE)) != NULL )
+            {
+            CAMHAL_LOGDB("Face detection rate set %s", valstr);
+            mParameters.set(TICameraParameters::KEY_FACE_DETECTION_RATE, valstr);
+            }
+
+        if( (valstr = params.get(TICameraParameters::KEY_FACE_DETECTION_SMOOTHING)) != NULL )
+            {
+            CAMHAL_LOGDB("Face detection smoothing set %s", valstr);
+            mParameters.set(TICameraParameters::KEY_FACE_DETECTION_SMOOTHING, valstr);
+            }
 #endif
 
         if( (valstr = params.get(android::CameraParameters::KEY_EXPOSURE_COMPENSATION)) != NULL)
@@ -957,7 +1014,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
             }
 
         if ((valstr = params.get(android::CameraParameters::KEY_SCENE_MODE)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_SCENE_MODES))) {
+            if (isParameterUnchanged(android::CameraParameters::KEY_SCENE_MODE, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_SCENE_MODES))) {
                 CAMHAL_LOGDB("Scene mode set %s", valstr);
                 doesSetParameterNeedUpdate(valstr,
                                            mParameters.get(android::CameraParameters::KEY_SCENE_MODE),
@@ -970,7 +1028,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
         }
 
         if ((valstr = params.get(android::CameraParameters::KEY_FLASH_MODE)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_FLASH_MODES))) {
+            if (isParameterUnchanged(android::CameraParameters::KEY_FLASH_MODE, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_FLASH_MODES))) {
                 CAMHAL_LOGDB("Flash mode set %s", valstr);
                 mParameters.set(android::CameraParameters::KEY_FLASH_MODE, valstr);
             } else {
@@ -980,7 +1039,8 @@ int CameraHal::setParameters(const android::CameraParameters& params)
         }
 
         if ((valstr = params.get(android::CameraParameters::KEY_EFFECT)) != NULL) {
-            if (isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_EFFECTS))) {
+            if (isParameterUnchanged(android::CameraParameters::KEY_EFFECT, valstr) ||
+                isParameterValid(valstr, mCameraProperties->get(CameraProperties::SUPPORTED_EFFECTS))) {
                 CAMHAL_LOGDB("Effect set %s", valstr);
                 mParameters.set(android::CameraParameters::KEY_EFFECT, valstr);
              } else {
@@ -1258,6 +1318,34 @@ int CameraHal::setParameters(const android::CameraParameters& params)
             adapterParams.remove(TICameraParameters::KEY_TEMP_BRACKETING);
             mParameters.remove(TICameraParameters::KEY_TEMP_BRACKETING);
         }
+
+        // ZSL ring is temporal bracketing with no positive range, the
+        // adapter then sends only the ring frame nearest the shutter
+        if( NULL != params.get(TICameraParameters::KEY_ZSL_RING_FRAMES) )
+            {
+            int zslFrames = params.getInt(TICameraParameters::KEY_ZSL_RING_FRAMES);
+            if ( ( 0 < zslFrames ) && ( zslFrames <= NO_BUFFERS_IMAGE_CAPTURE ) )
+                {
+                CAMHAL_LOGDB("Enabling ZSL ring of %d frames", zslFrames);
+                mBracketRangeNegative = zslFrames - 1;
+                mBracketRangePositive = 0;
+                mBracketingEnabled = true;
+                mZslRingFrames = zslFrames;
+                adapterParams.set(TICameraParameters::KEY_ZSL_RING_FRAMES, zslFrames);
+                mParameters.set(TICameraParameters::KEY_ZSL_RING_FRAMES, zslFrames);
+                }
+            else if ( 0 < mZslRingFrames )
+                {
+                CAMHAL_LOGDA("Disabling ZSL ring");
+                mZslRingFrames = 0;
+                mBracketingEnabled = false;
+                if ( mBracketingRunning ) {
+                    stopImageBracketing();
+                }
+                adapterParams.remove(TICameraParameters::KEY_ZSL_RING_FRAMES);
+                mParameters.remove(TICameraParameters::KEY_ZSL_RING_FRAMES);
+                }
+            }
 #endif
 
 #ifdef OMAP_ENHANCEMENT_VTC
@@ -1361,7 +1449,35 @@ status_t CameraHal::allocPreviewBufs(int width, int height, const char* previewF
         return NO_MEMORY;
     }
 
-    if(!mPreviewBuffers)
+    if(mPreviewBuffers && mPreviewBufsKept)
+    {
+        // Preview restart, let the display hand the same buffers out again
+        mPreviewBufsKept = false;
+        mPreviewLength = 0;
+        mPreviewBuffers = mDisplayAdapter->reallocateBufferList(mPreviewBuffers,
+                                                                width, height,
+                                                                previewFormat,
+                                                                mPreviewLength,
+                                                                buffercount);
+        if (NULL == mPreviewBuffers ) {
+            CAMHAL_LOGEA("Couldn't allocate preview buffers");
+            return NO_MEMORY;
+        }
+
+        mPreviewOffsets = (uint32_t *) mDisplayAdapter->getOffsets();
+        if ( NULL == mPreviewOffsets ) {
+            CAMHAL_LOGEA("Buffer mapping failed");
+            return BAD_VALUE;
+        }
+
+        mBufProvider = (BufferProvider*) mDisplayAdapter.get();
+
+        ret = mDisplayAdapter->maxQueueableBuffers(max_queueable);
+        if (ret != NO_ERROR) {
+            return ret;
+        }
+    }
+    else if(!mPreviewBuffers)
     {
         mPreviewLength = 0;
         mPreviewBuffers = mDisplayAdapter->allocateBufferList(width, height,
@@ -1398,6 +1514,16 @@ status_t CameraHal::freePreviewBufs()
     LOG_FUNCTION_NAME;
 
     CAMHAL_LOGDB("mPreviewBuffers = %p", mPreviewBuffers);
+    if(mPreviewBuffers && mKeepPreviewBufs && (mBufProvider == (BufferProvider*) mDisplayAdapter.get()))
+        {
+        // The display already took the buffers back, only the list is kept
+        CAMHAL_LOGDA("Keeping preview buffers for restart");
+        mPreviewBufsKept = true;
+        LOG_FUNCTION_NAME_EXIT;
+        return ret;
+        }
+
+    mPreviewBufsKept = false;
     if(mPreviewBuffers)
         {
         ret = mBufProvider->freeBufferList(mPreviewBuffers);
@@ -1485,8 +1611,57 @@ status_t CameraHal::freePreviewDataBufs()
     return ret;
 }
 
+/**
+   @brief Maximum bytes of image capture buffers kept between shots
+
+   Set through debug.camera.capture_pool_mb, 0 disables the pool.
+ */
+static size_t imagePoolCap()
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.camera.capture_pool_mb", value, "96");
+
+    return (size_t) atoi(value) * 1024 * 1024;
+}
+
+/**
+   @brief Whether the system can spare bytes more for a capture pool
+
+   Don't sit on capture buffers when the rest of the system is short of memory.
+ */
+static bool imagePoolAffordable(size_t bytes)
+{
+    struct sysinfo info;
+
+    if ( 0 != sysinfo(&info) ) {
+        return false;
+    }
+
+    const uint64_t available = ( (uint64_t) info.freeram + info.bufferram ) * info.mem_unit;
+
+    return available > ( (uint64_t) bytes * 2 );
+}
+
+/**
+   @brief Whether capture buffers get a cacheable CPU mapping
+
+   Only Ducati writes them, while the CPU copies or encodes the result, so
+   invalidating the part that is read beats reading uncached memory.
+   Set debug.camera.cached_capture to 0 to map them uncached.
+ */
+static bool cachedCaptureBuffers()
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.camera.cached_capture", value, "1");
+
+    return 0 != atoi(value);
+}
+
 status_t CameraHal::allocImageBufs(unsigned int width, unsigned int height, size_t size,
-                                   const char* previewFormat, unsigned int bufferCount)
+                                   const char* previewFormat, unsigned int bufferCount,
+                                   unsigned int minBufferCount)
 {
     status_t ret = NO_ERROR;
     int bytes = size;
@@ -1498,18 +1673,47 @@ status_t CameraHal::allocImageBufs(unsigned int width, unsigned int height, size
         return NO_ERROR;
     }
 
-    if ( NO_ERROR == ret ) {
-        bytes = ((bytes+4095)/4096)*4096;
-        mImageBuffers = mMemoryManager->allocateBufferList(0, 0, previewFormat, bytes, bufferCount);
+    bytes = ((bytes+4095)/4096)*4096;
+
+    {
+        android::AutoMutex lock(mImagePoolLock);
+
+        // Take the buffers of the last shot if they fit and are not much bigger
+        if ( ( NULL != mImagePool ) &&
+             ( mImagePoolCount >= bufferCount ) &&
+             ( mImagePoolSize >= (size_t) bytes ) &&
+             ( ( mImagePoolSize * mImagePoolCount ) <= ( (size_t) bytes * bufferCount * 3 / 2 ) ) ) {
+            CAMHAL_LOGDB("Reusing %u image buffers of %u bytes", mImagePoolCount, (unsigned int) mImagePoolSize);
+            mImageBuffers = mImagePool;
+            mImageAllocatedCount = mImagePoolCount;
+            mImageAllocatedSize = mImagePoolSize;
+            mImagePool = NULL;
+            mImagePoolCount = 0;
+            mImagePoolSize = 0;
+        }
+    }
+
+    if ( NULL == mImageBuffers ) {
+        trimImagePool();
+
+        int count = bufferCount;
+        mImageBuffers = mMemoryManager->allocateBufferList(0, 0, previewFormat, bytes,
+                                                           count, minBufferCount,
+                                                           cachedCaptureBuffers());
         CAMHAL_LOGDB("Size of Image cap buffer = %d", bytes);
         if( NULL == mImageBuffers ) {
             CAMHAL_LOGEA("Couldn't allocate image buffers using memory manager");
             ret = -NO_MEMORY;
         } else {
-            bytes = size;
+            mImageAllocatedCount = count;
+            mImageAllocatedSize = bytes;
+            bufferCount = count;
         }
     }
 
+    mImageBuffersAllocated = mImageBuffers;
+    bytes = size;
+
     if ( NO_ERROR == ret ) {
         mImageFd = mMemoryManager->getFd();
         mImageLength = bytes;
@@ -1532,6 +1736,18 @@ status_t CameraHal::allocVideoBufs(uint32_t width, uint32_t height, uint32_t buf
   status_t ret = NO_ERROR;
   LOG_FUNCTION_NAME;
 
+  // Take the buffers of the last recording if they are of the same size
+  if ( mVideoBufsPooled ) {
+    if ( ( mVideoBufsWidth == width ) && ( mVideoBufsHeight == height ) &&
+         ( mVideoBufsCount == bufferCount ) ) {
+      CAMHAL_LOGDB("Reusing %u video buffers of %ux%u", bufferCount, width, height);
+      mVideoBufsPooled = false;
+      LOG_FUNCTION_NAME_EXIT;
+      return NO_ERROR;
+    }
+    trimVideoPool(true);
+  }
+
   if( NULL != mVideoBuffers ){
     ret = freeVideoBufs(mVideoBuffers);
     mVideoBuffers = NULL;
@@ -1564,6 +1780,9 @@ status_t CameraHal::allocVideoBufs(uint32_t width, uint32_t height, uint32_t buf
       }
 
       mVideoBuffers = buffers;
+      mVideoBufsWidth = width;
+      mVideoBufsHeight = height;
+      mVideoBufsCount = bufferCount;
     }
     else{
       CAMHAL_LOGEA("Couldn't allocate video buffers ");
@@ -1584,6 +1803,9 @@ status_t CameraHal::allocRawBufs(int width, int height, const char* previewForma
     LOG_FUNCTION_NAME
 
 
+    // Gralloc buffers kept from a recording are no use for RAW capture
+    trimVideoPool(true);
+
     ///@todo Enhance this method allocImageBufs() to take in a flag for burst capture
     ///Always allocate the buffers for image capture using MemoryManager
     if (NO_ERROR == ret) {
@@ -1597,7 +1819,8 @@ status_t CameraHal::allocRawBufs(int width, int height, const char* previewForma
         mVideoLength = 0;
         mVideoLength = (((width * height * 2) + 4095)/4096)*4096;
         mVideoBuffers = mMemoryManager->allocateBufferList(width, height, previewFormat,
-                                                           mVideoLength, bufferCount);
+                                                           mVideoLength, bufferCount, bufferCount,
+                                                           cachedCaptureBuffers());
 
         CAMHAL_LOGDB("Size of Video cap buffer (used for RAW capture) %d", mVideoLength);
         if( NULL == mVideoBuffers ) {
@@ -1683,24 +1906,85 @@ status_t CameraHal::freeImageBufs()
 
     if (mBufferSourceAdapter_Out.get()) {
         mBufferSourceAdapter_Out = 0;
+    } else if ( mImageBuffers == mImageBuffersAllocated ) {
+        android::AutoMutex lock(mImagePoolLock);
+
+        const size_t bytes = mImageAllocatedSize * mImageAllocatedCount;
+
+        // Keep them for the next shot, unless they are too much to sit on
+        if ( ( NULL == mImagePool ) && ( bytes <= imagePoolCap() ) && imagePoolAffordable(bytes) ) {
+            mImagePool = mImageBuffers;
+            mImagePoolCount = mImageAllocatedCount;
+            mImagePoolSize = mImageAllocatedSize;
+        } else {
+            ret = mMemoryManager->freeBufferList(mImageBuffers);
+        }
     } else {
         ret = mMemoryManager->freeBufferList(mImageBuffers);
     }
 
     mImageBuffers = NULL;
+    mImageBuffersAllocated = NULL;
 
     LOG_FUNCTION_NAME_EXIT;
 
     return ret;
 }
 
+/**
+   @brief Seconds video buffers are kept after stopRecording()
+
+   Set through debug.camera.video_pool_s, 0 frees them on every stop.
+ */
+static nsecs_t videoPoolTimeout()
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.camera.video_pool_s", value, "90");
+
+    return seconds_to_nanoseconds(atoi(value));
+}
+
+void CameraHal::trimVideoPool(bool force)
+{
+    LOG_FUNCTION_NAME;
+
+    if ( mVideoBufsPooled &&
+         ( force || ( ( systemTime() - mVideoBufsPoolTime ) >= videoPoolTimeout() ) ) ) {
+        CAMHAL_LOGDB("Freeing %u pooled video buffers", mVideoBufsCount);
+        freeVideoBufs(mVideoBuffers);
+        delete [] mVideoBuffers;
+        mVideoBuffers = NULL;
+        mVideoBufsPooled = false;
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+void CameraHal::trimImagePool()
+{
+    android::AutoMutex lock(mImagePoolLock);
+
+    LOG_FUNCTION_NAME;
+
+    if ( NULL != mImagePool ) {
+        CAMHAL_LOGDB("Freeing %u pooled image buffers", mImagePoolCount);
+        mMemoryManager->freeBufferList(mImagePool);
+        mImagePool = NULL;
+        mImagePoolCount = 0;
+        mImagePoolSize = 0;
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
 status_t CameraHal::freeVideoBufs(CameraBuffer *bufs)
 {
   status_t ret = NO_ERROR;
 
   LOG_FUNCTION_NAME;
 
-  int count = atoi(mCameraProperties->get(CameraProperties::REQUIRED_PREVIEW_BUFS));
+  int count = mVideoBufsCount;
   if(bufs == NULL)
     {
       CAMHAL_LOGEA("NULL pointer passed to freeVideoBuffer");
@@ -2066,6 +2350,9 @@ status_t CameraHal::setPreviewWindow(struct preview_stream_ops *window)
         {
             ///NULL window passed, destroy the display adapter if present
             CAMHAL_LOGD("NULL window passed, destroying display adapter");
+            if ( mPreviewBufsKept ) {
+                freePreviewBufs();
+            }
             mDisplayAdapter.clear();
             ///@remarks If there was a window previously existing, we usually expect another valid window to be passed by the client
             ///@remarks so, we will wait until it passes a valid window to begin the preview again
@@ -2837,7 +3124,10 @@ status_t CameraHal::restartPreview()
 
     // Retain CAPTURE_MODE before calling stopPreview(), since it is reset in stopPreview().
 
+    // Same window and most likely the same geometry, don't churn the gralloc buffers
+    mKeepPreviewBufs = true;
     forceStopPreview();
+    mKeepPreviewBufs = false;
 
     {
         android::AutoMutex lock(mLock);
@@ -2887,13 +3177,11 @@ void CameraHal::stopRecording()
 
     mRecordingEnabled = false;
 
-    if ( mAppCallbackNotifier->getUesVideoBuffers() ){
-      freeVideoBufs(mVideoBuffers);
-      if (mVideoBuffers){
-        CAMHAL_LOGVB(" FREEING mVideoBuffers %p", mVideoBuffers);
-        delete [] mVideoBuffers;
-      }
-      mVideoBuffers = NULL;
+    if ( mAppCallbackNotifier->getUesVideoBuffers() && mVideoBuffers ){
+      // Keep them for the next segment, released once they sit unused
+      mVideoBufsPooled = true;
+      mVideoBufsPoolTime = systemTime();
+      trimVideoPool(0 == videoPoolTimeout());
     }
 
     // reset internal recording hint in case camera adapter needs to make some
@@ -3146,6 +3434,7 @@ status_t CameraHal::startImageBracketing()
                                  frame.mHeight,
                                  frame.mLength,
                                  mParameters.getPictureFormat(),
+                                 ( mBracketRangeNegative + 1 ),
                                  ( mBracketRangeNegative + 1 ));
             if ( NO_ERROR != ret )
               {
@@ -3217,6 +3506,7 @@ status_t CameraHal::stopImageBracketing()
 status_t CameraHal::takePicture(const char *params)
 {
     android::AutoMutex lock(mLock);
+    CameraPerfCounters::shotRequested();
     return __takePicture(params);
 }
 
@@ -3491,13 +3781,18 @@ status_t CameraHal::__takePicture(const char *params, struct timeval *captureSta
             // allocImageBufs will only allocate new buffers if mImageBuffers is NULL
             if ( NO_ERROR == ret ) {
                 max_queueable = bufferCount;
+                // A burst can cycle through fewer buffers, bracketing needs them all
                 ret = allocImageBufs(frame.mAlignment / getBPP(mParameters.getPictureFormat()),
                                      frame.mHeight,
                                      frame.mLength,
                                      mParameters.getPictureFormat(),
-                                     bufferCount);
+                                     bufferCount,
+                                     mBracketingEnabled ? bufferCount : 1);
                 if ( NO_ERROR != ret ) {
                     CAMHAL_LOGEB("allocImageBufs returned error 0x%x", ret);
+                } else if ( mImageCount < bufferCount ) {
+                    bufferCount = mImageCount;
+                    max_queueable = bufferCount;
                 }
             }
         }
@@ -3944,7 +4239,21 @@ void CameraHal::release()
 status_t  CameraHal::dump(int fd) const
 {
     LOG_FUNCTION_NAME;
-    ///Implement this method when the h/w dump function is supported on Ducati side
+
+    if ( NULL != mDisplayAdapter.get() ) {
+        char buffer[128];
+        unsigned int dropped = 0, late = 0;
+
+        mDisplayAdapter->getFrameStats(dropped, late);
+        snprintf(buffer, sizeof(buffer),
+                 "  Display: %u preview frames dropped by pacing, %u late\n",
+                 dropped, late);
+        write(fd, buffer, strlen(buffer));
+    }
+
+    CameraPerfCounters::dump(fd);
+
+    ///Implement the rest of this method when the h/w dump function is supported on Ducati side
     return NO_ERROR;
 }
 
@@ -3970,6 +4279,8 @@ CameraHal::CameraHal(int cameraId)
     ///Initialize all the member variables to their defaults
     mPreviewEnabled = false;
     mPreviewBuffers = NULL;
+    mKeepPreviewBufs = false;
+    mPreviewBufsKept = false;
     mImageBuffers = NULL;
     mBufProvider = NULL;
     mPreviewStartInProgress = false;
@@ -3984,6 +4295,7 @@ CameraHal::CameraHal(int cameraId)
     mCameraAdapter = NULL;
     mBracketingEnabled = false;
     mBracketingRunning = false;
+    mZslRingFrames = 0;
     mEventProvider = NULL;
     mBracketRangePositive = 1;
     mBracketRangeNegative = 1;
@@ -3998,6 +4310,12 @@ CameraHal::CameraHal(int cameraId)
     mImageLength = 0;
     mImageFd = 0;
     mImageCount = 0;
+    mImageBuffersAllocated = NULL;
+    mImageAllocatedCount = 0;
+    mImageAllocatedSize = 0;
+    mImagePool = NULL;
+    mImagePoolCount = 0;
+    mImagePoolSize = 0;
     mVideoOffsets = NULL;
     mVideoFd = 0;
     mVideoLength = 0;
@@ -4016,6 +4334,11 @@ CameraHal::CameraHal(int cameraId)
     mSensorListener = NULL;
     mVideoWidth = 0;
     mVideoHeight = 0;
+    mVideoBufsWidth = 0;
+    mVideoBufsHeight = 0;
+    mVideoBufsCount = 0;
+    mVideoBufsPooled = false;
+    mVideoBufsPoolTime = 0;
 #ifdef OMAP_ENHANCEMENT_VTC
     mVTCUseCase = false;
     mTunnelSetup = false;
@@ -4080,6 +4403,8 @@ CameraHal::~CameraHal()
     }
 
     freeImageBufs();
+    trimImagePool();
+    trimVideoPool(true);
     freeRawBufs();
 
     /// Free the memory manager
@@ -4111,9 +4436,16 @@ status_t CameraHal::initialize(CameraProperties::Properties* properties)
     ///Currently, registering all events as to be coming from CameraAdapter
     int32_t eventMask = CameraHalEvent::ALL_EVENTS;
 
+    CameraAdapterInit adapterInit;
+    pthread_t adapterThread;
+    bool adapterThreaded = false;
+    bool failed = false;
+
     // Get my camera properties
     mCameraProperties = properties;
 
+    CameraPerfCounters::reset();
+
     if(!mCameraProperties)
     {
         goto fail_loop;
@@ -4133,30 +4465,16 @@ status_t CameraHal::initialize(CameraProperties::Properties* properties)
     }
     CAMHAL_LOGDB("Sensor index= %d; Sensor name= %s", sensor_index, sensor_name);
 
-CAMHAL_LOGEA("1");
-    if (strcmp(sensor_name, V4L_CAMERA_NAME_USB) == 0) {
-#ifdef V4L_CAMERA_ADAPTER
-        mCameraAdapter = V4LCameraAdapter_Factory(sensor_index, this);
-#endif
-    }
-    else {
-#ifdef OMX_CAMERA_ADAPTER
-        mCameraAdapter = OMXCameraAdapter_Factory(sensor_index);
-#endif
-    }
-CAMHAL_LOGEA("2");
-
-    if ( ( NULL == mCameraAdapter ) || (mCameraAdapter->initialize(properties)!=NO_ERROR))
-        {
-        CAMHAL_LOGEA("Unable to create or initialize CameraAdapter");
-        mCameraAdapter = NULL;
-        goto fail_loop;
-        }
-CAMHAL_LOGEA("3");
+    adapterInit.hal = this;
+    adapterInit.v4l = strcmp(sensor_name, V4L_CAMERA_NAME_USB) == 0;
+    adapterInit.sensorIndex = sensor_index;
+    adapterInit.properties = properties;
+    adapterInit.adapter = NULL;
 
-    mCameraAdapter->incStrong(mCameraAdapter);
-    mCameraAdapter->registerImageReleaseCallback(releaseImageBuffers, (void *) this);
-    mCameraAdapter->registerEndCaptureCallback(endImageCapture, (void *)this);
+    adapterThreaded = pthread_create(&adapterThread, NULL, cameraAdapterInitThread, &adapterInit) == 0;
+    if ( !adapterThreaded ) {
+        cameraAdapterInitThread(&adapterInit);
+    }
 
     if(!mAppCallbackNotifier.get())
         {
@@ -4165,21 +4483,50 @@ CAMHAL_LOGEA("3");
         if( ( NULL == mAppCallbackNotifier.get() ) || ( mAppCallbackNotifier->initialize() != NO_ERROR))
             {
             CAMHAL_LOGEA("Unable to create or initialize AppCallbackNotifier");
-            goto fail_loop;
+            failed = true;
             }
         }
 
-    if(!mMemoryManager.get())
+    if( !failed && !mMemoryManager.get())
         {
         /// Create Memory Manager
         mMemoryManager = new MemoryManager();
         if( ( NULL == mMemoryManager.get() ) || ( mMemoryManager->initialize() != NO_ERROR))
             {
             CAMHAL_LOGEA("Unable to create or initialize MemoryManager");
-            goto fail_loop;
+            failed = true;
             }
         }
 
+    // register for sensor events, the callbacks are set once the adapter exists
+    if ( !failed ) {
+        mSensorListener = new SensorListener();
+        if (mSensorListener.get() && (mSensorListener->initialize() != NO_ERROR)) {
+            CAMHAL_LOGEA("Error initializing SensorListener. not fatal, continuing");
+            mSensorListener.clear();
+            mSensorListener = NULL;
+        }
+    }
+
+    if ( adapterThreaded ) {
+        pthread_join(adapterThread, NULL);
+    }
+
+    if ( NULL == adapterInit.adapter )
+        {
+        CAMHAL_LOGEA("Unable to create or initialize CameraAdapter");
+        goto fail_loop;
+        }
+
+    mCameraAdapter = adapterInit.adapter;
+    mCameraAdapter->incStrong(mCameraAdapter);
+    mCameraAdapter->registerImageReleaseCallback(releaseImageBuffers, (void *) this);
+    mCameraAdapter->registerEndCaptureCallback(endImageCapture, (void *)this);
+
+    if ( failed ) {
+        goto fail_loop;
+    }
+
     ///Setup the class dependencies...
 
     ///AppCallbackNotifier has to know where to get the Camera frames and the events like auto focus lock etc from.
@@ -4215,17 +4562,9 @@ CAMHAL_LOGEA("3");
         CAMHAL_LOGEA("Failed to set default parameters?!");
         }
 
-    // register for sensor events
-    mSensorListener = new SensorListener();
     if (mSensorListener.get()) {
-        if (mSensorListener->initialize() == NO_ERROR) {
-            mSensorListener->setCallbacks(orientation_cb, this);
-            mSensorListener->enableSensor(SensorListener::SENSOR_ORIENTATION);
-        } else {
-            CAMHAL_LOGEA("Error initializing SensorListener. not fatal, continuing");
-            mSensorListener.clear();
-            mSensorListener = NULL;
-        }
+        mSensorListener->setCallbacks(orientation_cb, this);
+        mSensorListener->enableSensor(SensorListener::SENSOR_ORIENTATION);
     }
 
     LOG_FUNCTION_NAME_EXIT;
@@ -4311,8 +4650,6 @@ bool CameraHal::isFpsRangeValid(int fpsMin, int fpsMax, const char *supportedFps
 bool CameraHal::isParameterValid(const char *param, const char *supportedParams)
 {
     bool ret = false;
-    char *pos;
-    char supported[MAX_PROP_VALUE_LENGTH];
 
     LOG_FUNCTION_NAME;
 
@@ -4326,16 +4663,7 @@ bool CameraHal::isParameterValid(const char *param, const char *supportedParams)
         goto exit;
     }
 
-    strncpy(supported, supportedParams, MAX_PROP_VALUE_LENGTH - 1);
-
-    pos = strtok(supported, ",");
-    while (pos != NULL) {
-        if (!strcmp(pos, param)) {
-            ret = true;
-            break;
-        }
-        pos = strtok(NULL, ",");
-    }
+    ret = ( 0 <= getSupportedValues(supportedParams).indexOf(android::String8(param)) );
 
 exit:
     LOG_FUNCTION_NAME_EXIT;
@@ -4343,6 +4671,46 @@ exit:
     return ret;
 }
 
+const android::SortedVector<android::String8> & CameraHal::getSupportedValues(const char *supportedParams)
+{
+    android::String8 key(supportedParams);
+    ssize_t index = mSupportedValues.indexOfKey(key);
+
+    if ( 0 > index ) {
+        android::SortedVector<android::String8> values;
+        char supported[MAX_PROP_VALUE_LENGTH];
+        char *ctx = NULL;
+        char *pos;
+
+        // The supported lists come from the capabilities and do not change
+        // while the camera is open, the bound only guards against a caller
+        // feeding us ever-changing strings.
+        if ( MAX_SUPPORTED_VALUE_SETS <= mSupportedValues.size() ) {
+            mSupportedValues.clear();
+        }
+
+        strncpy(supported, supportedParams, MAX_PROP_VALUE_LENGTH - 1);
+        supported[MAX_PROP_VALUE_LENGTH - 1] = '\0';
+
+        pos = strtok_r(supported, ",", &ctx);
+        while (pos != NULL) {
+            values.add(android::String8(pos));
+            pos = strtok_r(NULL, ",", &ctx);
+        }
+
+        index = mSupportedValues.add(key, values);
+    }
+
+    return mSupportedValues.valueAt(index);
+}
+
+bool CameraHal::isParameterUnchanged(const char *key, const char *value) const
+{
+    const char *current = mParameters.get(key);
+
+    return ( (NULL != current) && (NULL != value) && (0 == strcmp(current, value)) );
+}
+
 bool CameraHal::isParameterValid(int param, const char *supportedParams)
 {
     bool ret = false;
@@ -4665,6 +5033,12 @@ void CameraHal::forceStopPreview()
     freePreviewBufs();
     freePreviewDataBufs();
 
+    // Capture buffers are only kept warm while preview runs, a restart keeps them
+    if ( !mKeepPreviewBufs ) {
+        trimImagePool();
+        trimVideoPool(true);
+    }
+
     mPreviewEnabled = false;
     mDisplayPaused = false;
     mPreviewStartInProgress = false;
@@ -4690,6 +5064,11 @@ void CameraHal::deinitialize()
         forceStopPreview();
     }
 
+    // Buffers kept by a preview restart that never started again
+    if ( mPreviewBufsKept ) {
+        freePreviewBufs();
+    }
+
     mSetPreviewWindowCalled = false;
 
     if (mSensorListener.get()) {
@@ -4749,5 +5128,42 @@ camera_buffer_get_omx_ptr (CameraBuffer *buffer)
     }
 }
 
+void
+camera_buffer_sync_for_cpu (CameraBuffer *buffer, size_t offset, size_t length)
+{
+    if ( ( NULL == buffer ) || ( buffer->type != CAMERA_BUFFER_ION ) || !buffer->cached ) {
+        return;
+    }
+
+    if ( ( offset >= buffer->size ) || ( 0 == length ) ) {
+        return;
+    }
+
+    length = ( length > ( buffer->size - offset ) ) ? ( buffer->size - offset ) : length;
+
+    // Drop stale lines for the part about to be read, leave the rest alone
+    if ( ion_inval_cached_range(buffer->ion_fd, buffer->ion_handle,
+                                (unsigned char *) buffer->mapped, offset, length) < 0 ) {
+        CAMHAL_LOGE("Cache invalidate failed for buffer %p", buffer);
+    }
+}
+
+// Marks a window buffer on the frame timeline shared with hwc, see frame_trace.h
+void
+camera_buffer_trace (CameraBuffer *buffer, const char *stage)
+{
+#ifdef ATRACE_TAG_CAMERA
+    if ( ( NULL == buffer ) || ( buffer->type != CAMERA_BUFFER_ANW ) || ( NULL == buffer->opaque ) ) {
+        return;
+    }
+
+    frame_trace(ATRACE_TAG_CAMERA, stage,
+                (const IMG_native_handle_t *) *(buffer_handle_t *) buffer->opaque);
+#else
+    CAMHAL_UNUSED(buffer);
+    CAMHAL_UNUSED(stage);
+#endif
+}
+
 } // namespace Camera
 } // namespace Ti
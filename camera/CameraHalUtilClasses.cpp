@@ -357,5 +357,284 @@ bool CameraArea::compare(const android::sp<CameraArea> &area) {
 
 /*--------------------CameraArea Class ENDS here-----------------------------*/
 
+/*--------------------CameraPerfCounters Class STARTS here-----------------------------*/
+
+volatile int32_t CameraPerfCounters::sFramesSent[CameraPerfCounters::STREAM_MAX];
+volatile int32_t CameraPerfCounters::sFramesDelivered[CameraPerfCounters::STREAM_MAX];
+volatile int32_t CameraPerfCounters::sFramesReturned[CameraPerfCounters::STREAM_MAX];
+volatile int32_t CameraPerfCounters::sEvents[CameraPerfCounters::EVENT_MAX];
+android::Mutex CameraPerfCounters::sLock;
+CameraPerfCounters::Histogram CameraPerfCounters::sLatency[CameraPerfCounters::LATENCY_MAX];
+nsecs_t CameraPerfCounters::sSessionStart = 0;
+nsecs_t CameraPerfCounters::sLastShotRequest = 0;
+nsecs_t CameraPerfCounters::sLastShotDelivery = 0;
+
+static const char * const gStreamNames[] = {
+    "preview", "video", "image", "raw", "snapshot", "other"
+};
+
+static const char * const gLatencyNames[] = {
+    "fill to display", "jpeg encode", "shot to shot", "frame decode"
+};
+
+void CameraPerfCounters::reset()
+{
+    android::AutoMutex lock(sLock);
+
+    for ( int i = 0 ; i < STREAM_MAX ; i++ ) {
+        android_atomic_release_store(0, &sFramesSent[i]);
+        android_atomic_release_store(0, &sFramesDelivered[i]);
+        android_atomic_release_store(0, &sFramesReturned[i]);
+    }
+
+    for ( int i = 0 ; i < EVENT_MAX ; i++ ) {
+        android_atomic_release_store(0, &sEvents[i]);
+    }
+
+    memset(sLatency, 0, sizeof(sLatency));
+    sSessionStart = systemTime(SYSTEM_TIME_MONOTONIC);
+    sLastShotRequest = 0;
+    sLastShotDelivery = 0;
+}
+
+CameraPerfCounters::Stream CameraPerfCounters::streamOf(int frameType)
+{
+    switch ( frameType ) {
+        case CameraFrame::PREVIEW_FRAME_SYNC:
+        case CameraFrame::PREVIEW_FRAME:
+            return STREAM_PREVIEW;
+        case CameraFrame::VIDEO_FRAME_SYNC:
+        case CameraFrame::VIDEO_FRAME:
+            return STREAM_VIDEO;
+        case CameraFrame::IMAGE_FRAME_SYNC:
+        case CameraFrame::IMAGE_FRAME:
+            return STREAM_IMAGE;
+        case CameraFrame::RAW_FRAME:
+            return STREAM_RAW;
+        case CameraFrame::SNAPSHOT_FRAME:
+            return STREAM_SNAPSHOT;
+        default:
+            return STREAM_OTHER;
+    }
+}
+
+void CameraPerfCounters::frameSent(int frameType, size_t subscribers)
+{
+    Stream stream = streamOf(frameType);
+
+    android_atomic_inc(&sFramesSent[stream]);
+    android_atomic_add(subscribers, &sFramesDelivered[stream]);
+}
+
+void CameraPerfCounters::frameReturned(int frameType)
+{
+    android_atomic_inc(&sFramesReturned[streamOf(frameType)]);
+}
+
+void CameraPerfCounters::event(Event event)
+{
+    if ( ( 0 <= event ) && ( EVENT_MAX > event ) ) {
+        android_atomic_inc(&sEvents[event]);
+    }
+}
+
+int CameraPerfCounters::bucketOf(nsecs_t value)
+{
+    uint64_t us = ( 0 < value ) ? ( value / 1000 ) : 0;
+    int msb;
+    int bucket;
+
+    if ( HISTOGRAM_SUB_BUCKETS > us ) {
+        return us;
+    }
+
+    msb = 63 - __builtin_clzll(us);
+    bucket = ( msb - 2 ) * HISTOGRAM_SUB_BUCKETS + ( ( us >> ( msb - 3 ) ) & ( HISTOGRAM_SUB_BUCKETS - 1 ) );
+
+    return ( HISTOGRAM_BUCKETS > bucket ) ? bucket : ( HISTOGRAM_BUCKETS - 1 );
+}
+
+nsecs_t CameraPerfCounters::bucketLimit(int bucket)
+{
+    int msb;
+    int sub;
+
+    if ( HISTOGRAM_SUB_BUCKETS > bucket ) {
+        return ( bucket + 1 ) * 1000LL;
+    }
+
+    msb = bucket / HISTOGRAM_SUB_BUCKETS + 2;
+    sub = bucket % HISTOGRAM_SUB_BUCKETS;
+
+    return ( (nsecs_t) ( HISTOGRAM_SUB_BUCKETS + 1 + sub ) << ( msb - 3 ) ) * 1000LL;
+}
+
+void CameraPerfCounters::latency(Latency latency, nsecs_t value)
+{
+    if ( ( 0 > latency ) || ( LATENCY_MAX <= latency ) || ( 0 > value ) ) {
+        return;
+    }
+
+    android::AutoMutex lock(sLock);
+    Histogram &histogram = sLatency[latency];
+
+    histogram.mBuckets[bucketOf(value)]++;
+    histogram.mCount++;
+    histogram.mSum += value;
+    if ( histogram.mMax < value ) {
+        histogram.mMax = value;
+    }
+}
+
+void CameraPerfCounters::shotRequested()
+{
+    android::AutoMutex lock(sLock);
+    sLastShotRequest = systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+void CameraPerfCounters::shotDelivered()
+{
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t from;
+
+    {
+        android::AutoMutex lock(sLock);
+        // A shot is timed from its request, or from the previous delivery
+        // when the pipeline was still busy with that one (bursts)
+        from = ( sLastShotDelivery > sLastShotRequest ) ? sLastShotDelivery : sLastShotRequest;
+        sLastShotDelivery = now;
+    }
+
+    if ( 0 < from ) {
+        latency(LATENCY_SHOT_TO_SHOT, now - from);
+    }
+}
+
+nsecs_t CameraPerfCounters::percentile(const Histogram &histogram, unsigned int percent)
+{
+    uint32_t target = ( (uint64_t) histogram.mCount * percent + 99 ) / 100;
+    uint32_t total = 0;
+
+    for ( int i = 0 ; i < HISTOGRAM_BUCKETS ; i++ ) {
+        total += histogram.mBuckets[i];
+        if ( total >= target ) {
+            nsecs_t limit = bucketLimit(i);
+            return ( limit < histogram.mMax ) ? limit : histogram.mMax;
+        }
+    }
+
+    return histogram.mMax;
+}
+
+void CameraPerfCounters::dump(int fd)
+{
+    char buffer[256];
+    Histogram latencies[LATENCY_MAX];
+    nsecs_t start;
+
+    {
+        android::AutoMutex lock(sLock);
+        memcpy(latencies, sLatency, sizeof(latencies));
+        start = sSessionStart;
+    }
+
+    snprintf(buffer, sizeof(buffer), "  Performance counters (%.1f s session):\n",
+             ( systemTime(SYSTEM_TIME_MONOTONIC) - start ) / 1000000000.0);
+    write(fd, buffer, strlen(buffer));
+
+    for ( int i = 0 ; i < STREAM_MAX ; i++ ) {
+        if ( 0 == sFramesSent[i] ) {
+            continue;
+        }
+        snprintf(buffer, sizeof(buffer),
+                 "    %-8s frames: %d in, %d delivered to subscribers, %d returned\n",
+                 gStreamNames[i], sFramesSent[i], sFramesDelivered[i], sFramesReturned[i]);
+        write(fd, buffer, strlen(buffer));
+    }
+
+    snprintf(buffer, sizeof(buffer),
+             "    display: %d posted, starvation: %d camera, %d display\n",
+             sEvents[EVENT_DISPLAY_POSTED], sEvents[EVENT_CAMERA_STARVED],
+             sEvents[EVENT_DISPLAY_STARVED]);
+    write(fd, buffer, strlen(buffer));
+
+    for ( int i = 0 ; i < LATENCY_MAX ; i++ ) {
+        const Histogram &histogram = latencies[i];
+
+        if ( 0 == histogram.mCount ) {
+            continue;
+        }
+        snprintf(buffer, sizeof(buffer),
+                 "    %-16s %u samples, mean %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                 gLatencyNames[i], histogram.mCount,
+                 histogram.mSum / (double) histogram.mCount / 1000000.0,
+                 percentile(histogram, 99) / 1000000.0,
+                 histogram.mMax / 1000000.0);
+        write(fd, buffer, strlen(buffer));
+    }
+}
+
+/*--------------------CameraPerfCounters Class ENDS here-----------------------------*/
+
+#ifdef OMAP_ENHANCEMENT_CPCAM
+
+/*--------------------CameraMetadataPool Class STARTS here-----------------------------*/
+
+CameraMetadataPool::CameraMetadataPool(camera_request_memory allocator,
+                                       size_t bufferSize,
+                                       unsigned int maxFree)
+    : mAllocator(allocator), mBufferSize(bufferSize), mMaxFree(maxFree)
+{
+}
+
+CameraMetadataPool::~CameraMetadataPool()
+{
+    for ( size_t i = 0 ; i < mFree.size() ; i++ ) {
+        mFree[i]->release(mFree[i]);
+    }
+    mFree.clear();
+}
+
+camera_memory_t *CameraMetadataPool::acquire()
+{
+    {
+        android::AutoMutex lock(mLock);
+        if ( !mFree.isEmpty() ) {
+            camera_memory_t *mem = mFree.top();
+            mFree.pop();
+            return mem;
+        }
+    }
+
+    // Pool is dry, the buffer joins it when it comes back
+    camera_memory_t *mem = mAllocator(-1, mBufferSize, 1, NULL);
+    if ( NULL == mem ) {
+        CAMHAL_LOGEB("Failed to allocate %u bytes of metadata", mBufferSize);
+    }
+
+    return mem;
+}
+
+void CameraMetadataPool::recycle(camera_memory_t *mem)
+{
+    if ( NULL == mem ) {
+        return;
+    }
+
+    {
+        android::AutoMutex lock(mLock);
+        if ( mFree.size() < mMaxFree ) {
+            mFree.push(mem);
+            return;
+        }
+    }
+
+    mem->release(mem);
+}
+
+/*--------------------CameraMetadataPool Class ENDS here-----------------------------*/
+
+#endif
+
 } // namespace Camera
 } // namespace Ti
@@ -54,6 +54,21 @@ FrameDecoder* DecoderFactory::createDecoderByType(DecoderType type, bool forceSw
     return decoder;
 }
 
+FrameDecoder* DecoderFactory::createFallbackDecoder(DecoderType type, bool externalLocking) {
+    FrameDecoder* decoder = NULL;
+
+    if (DecoderType_MJPEG == type) {
+        // The buffers were set up for the HW decoder and stay unlocked
+        // by the display in that case, so libjpeg has to map them itself
+        decoder = new SwFrameDecoder(externalLocking);
+        CAMHAL_LOGD("Using SW Decoder as MJPEG fallback");
+    } else {
+        CAMHAL_LOGE("No fallback decoder for type %d", type);
+    }
+
+    return decoder;
+}
+
 }  // namespace Camera
 }  // namespace Ti
 
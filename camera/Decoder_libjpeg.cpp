@@ -134,6 +134,8 @@ Decoder_libjpeg::Decoder_libjpeg()
     U_Plane = NULL;
     V_Plane = NULL;
     UV_Plane = NULL;
+    Pad_Row = NULL;
+    mRows = 0;
 }
 
 Decoder_libjpeg::~Decoder_libjpeg()
@@ -159,6 +161,11 @@ void Decoder_libjpeg::release()
         free(UV_Plane);
         UV_Plane = NULL;
     }
+    if (Pad_Row) {
+        free(Pad_Row);
+        Pad_Row = NULL;
+    }
+    mRows = 0;
 }
 
 int Decoder_libjpeg::readDHTSize()
@@ -200,7 +207,27 @@ int Decoder_libjpeg::appendDHT(unsigned char *jpeg_src, int filled_len, unsigned
 }
 
 
-bool Decoder_libjpeg::decode(unsigned char *jpeg_src, int filled_len, unsigned char *nv12_buffer, int stride)
+// Smallest of 1/1, 1/2, 1/4 and 1/8 that brings the image within width x height
+static unsigned int pickScaleDenom(unsigned int imageWidth, unsigned int imageHeight,
+                                   unsigned int width, unsigned int height)
+{
+    unsigned int denom = 1;
+
+    if ((width == 0) || (height == 0)) {
+        return denom;
+    }
+
+    while ((denom < 8) &&
+           (((imageWidth + denom - 1) / denom > width) ||
+            ((imageHeight + denom - 1) / denom > height))) {
+        denom <<= 1;
+    }
+
+    return denom;
+}
+
+bool Decoder_libjpeg::decode(unsigned char *jpeg_src, int filled_len, unsigned char *nv12_buffer, int stride,
+                             unsigned int width, unsigned int height)
 {
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_mgr jerr;
@@ -216,35 +243,66 @@ bool Decoder_libjpeg::decode(unsigned char *jpeg_src, int filled_len, unsigned c
     int status = jpeg_read_header(&cinfo, true);
     if (status != JPEG_HEADER_OK) {
         CAMHAL_LOGEA("jpeg header corrupted");
+        jpeg_destroy_decompress(&cinfo);
         return false;
     }
 
     cinfo.out_color_space = JCS_YCbCr;
     cinfo.raw_data_out = true;
+
+    // Cheaper than decoding at full size and throwing most of it away
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = pickScaleDenom(cinfo.image_width, cinfo.image_height, width, height);
+
     status = jpeg_start_decompress(&cinfo);
     if (!status){
         CAMHAL_LOGEA("jpeg_start_decompress failed");
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    if (((width != 0) && (cinfo.output_width > width)) ||
+        ((height != 0) && (cinfo.output_height > height))) {
+        CAMHAL_LOGEB("JPEG %dx%d does not fit %dx%d even at 1/8",
+                     cinfo.image_width, cinfo.image_height, width, height);
+        jpeg_destroy_decompress(&cinfo);
         return false;
     }
 
+    if (cinfo.scale_denom > 1) {
+        CAMHAL_LOGVB("Decoding %dx%d at 1/%d", cinfo.image_width, cinfo.image_height,
+                     cinfo.scale_denom);
+    }
+
+    // jpeg_read_raw_data() hands out whole iMCU rows, which get smaller with the scale
+#if JPEG_LIB_VERSION >= 70
+    const unsigned int lines = cinfo.max_v_samp_factor * cinfo.min_DCT_v_scaled_size;
+#else
+    const unsigned int lines = cinfo.max_v_samp_factor * cinfo.min_DCT_scaled_size;
+#endif
+    const unsigned int rows = (cinfo.output_height + lines - 1) / lines * lines;
+
     if (mWidth == 0){
         mWidth = cinfo.output_width;
         mHeight = cinfo.output_height;
+        mRows = rows;
         CAMHAL_LOGEA("w x h = %d x %d. stride=%d", cinfo.output_width, cinfo.output_height, stride);
     }
-    else if ((cinfo.output_width > mWidth) || (cinfo.output_height > mHeight)) {
+    else if ((cinfo.output_width > mWidth) || (cinfo.output_height > mHeight) || (rows > mRows)) {
         CAMHAL_LOGEA(" Free the existing buffers so that they are reallocated for new w x h. Old WxH = %dx%d. New WxH = %dx%d",
         mWidth, mHeight, cinfo.output_width, cinfo.output_height);
         release();
         mWidth = cinfo.output_width;
         mHeight = cinfo.output_height;
+        mRows = rows;
     }
 
-    unsigned int decoded_uv_buffer_size = cinfo.output_width * cinfo.output_height / 2;
-    if (Y_Plane == NULL)Y_Plane = (unsigned char **)malloc(cinfo.output_height * sizeof(unsigned char *));
-    if (U_Plane == NULL)U_Plane = (unsigned char **)malloc(cinfo.output_height * sizeof(unsigned char *));
-    if (V_Plane == NULL)V_Plane = (unsigned char **)malloc(cinfo.output_height * sizeof(unsigned char *));
+    unsigned int decoded_uv_buffer_size = cinfo.output_width * rows / 2;
+    if (Y_Plane == NULL)Y_Plane = (unsigned char **)malloc(rows * sizeof(unsigned char *));
+    if (U_Plane == NULL)U_Plane = (unsigned char **)malloc(rows * sizeof(unsigned char *));
+    if (V_Plane == NULL)V_Plane = (unsigned char **)malloc(rows * sizeof(unsigned char *));
     if (UV_Plane == NULL) UV_Plane = (unsigned char *)malloc(decoded_uv_buffer_size);
+    if (Pad_Row == NULL) Pad_Row = (unsigned char *)malloc(cinfo.output_width);
 
     unsigned char **YUV_Planes[NUM_COMPONENTS_IN_YUV];
     YUV_Planes[0] = Y_Plane;
@@ -253,33 +311,34 @@ bool Decoder_libjpeg::decode(unsigned char *jpeg_src, int filled_len, unsigned c
 
     unsigned char *row = &nv12_buffer[0];
 
-    // Y Component
-    for (unsigned int j = 0; j < cinfo.output_height; j++, row += stride)
-        YUV_Planes[0][j] = row;
+    // Y Component, rows past the image land in a scratch row, not past the buffer
+    for (unsigned int j = 0; j < rows; j++, row += stride)
+        YUV_Planes[0][j] = (j < cinfo.output_height) ? row : Pad_Row;
 
     row = &UV_Plane[0];
 
     // U Component
-    for (unsigned int j = 0; j < cinfo.output_height; j+=2, row += cinfo.output_width / 2){
+    for (unsigned int j = 0; j < rows; j+=2, row += cinfo.output_width / 2){
         YUV_Planes[1][j+0] = row;
         YUV_Planes[1][j+1] = row;
     }
 
     // V Component
-    for (unsigned int j = 0; j < cinfo.output_height; j+=2, row += cinfo.output_width / 2){
+    for (unsigned int j = 0; j < rows; j+=2, row += cinfo.output_width / 2){
         YUV_Planes[2][j+0] = row;
         YUV_Planes[2][j+1] = row;
     }
 
     // Interleaving U and V
-    for (unsigned int i = 0; i < cinfo.output_height; i += 8) {
-        jpeg_read_raw_data(&cinfo, YUV_Planes, 8);
-        YUV_Planes[0] += 8;
-        YUV_Planes[1] += 8;
-        YUV_Planes[2] += 8;
+    for (unsigned int i = 0; i < rows; i += lines) {
+        jpeg_read_raw_data(&cinfo, YUV_Planes, lines);
+        YUV_Planes[0] += lines;
+        YUV_Planes[1] += lines;
+        YUV_Planes[2] += lines;
     }
 
-    unsigned char *uv_ptr = nv12_buffer + (stride * cinfo.output_height);
+    // The chroma plane starts after the output buffer's luma, however tall the image
+    unsigned char *uv_ptr = nv12_buffer + (stride * (height ? height : cinfo.output_height));
     unsigned char *u_ptr = UV_Plane;
     unsigned char *v_ptr = UV_Plane + (decoded_uv_buffer_size / 2);
     for(unsigned int i = 0; i < cinfo.output_height / 2; i++){
@@ -41,6 +41,10 @@ extern "C" {
     #include "jerror.h"
 }
 
+#ifdef ARCH_ARM_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
 #define ARRAY_SIZE(array) (sizeof((array)) / sizeof((array)[0]))
 #define MIN(x,y) ((x < y) ? x : y)
 
@@ -59,12 +63,23 @@ static integer_string_pair degress_to_exif_lut [] = {
     {180, "3"},
     {270, "8"},
 };
+// Number of rows converted and handed to libjpeg per jpeg_write_scanlines()
+// call, one MCU row for 2x2 subsampled output
+#define ENCODE_STRIP_ROWS 16
+
+enum encoder_input_format {
+    FORMAT_YUYV,
+    FORMAT_UYVY,
+    FORMAT_NV12,
+};
+
 struct libjpeg_destination_mgr : jpeg_destination_mgr {
     libjpeg_destination_mgr(uint8_t* input, int size);
 
     uint8_t* buf;
     int bufsize;
     size_t jpegsize;
+    bool overflow;
 };
 
 static void libjpeg_init_destination (j_compress_ptr cinfo) {
@@ -73,19 +88,28 @@ static void libjpeg_init_destination (j_compress_ptr cinfo) {
     dest->next_output_byte = dest->buf;
     dest->free_in_buffer = dest->bufsize;
     dest->jpegsize = 0;
+    dest->overflow = false;
 }
 
 static boolean libjpeg_empty_output_buffer(j_compress_ptr cinfo) {
     libjpeg_destination_mgr* dest = (libjpeg_destination_mgr*)cinfo->dest;
 
+    // The output buffer is filled in place, so running out of it means the
+    // jpeg does not fit. Keep libjpeg going over the same buffer so it can
+    // unwind normally, but report no data at the end instead of a jpeg
+    // whose head has been overwritten.
+    if (!dest->overflow) {
+        CAMHAL_LOGEB("Encoder: jpeg bigger than output buffer (%d bytes)", dest->bufsize);
+        dest->overflow = true;
+    }
     dest->next_output_byte = dest->buf;
     dest->free_in_buffer = dest->bufsize;
-    return TRUE; // ?
+    return TRUE;
 }
 
 static void libjpeg_term_destination (j_compress_ptr cinfo) {
     libjpeg_destination_mgr* dest = (libjpeg_destination_mgr*)cinfo->dest;
-    dest->jpegsize = dest->bufsize - dest->free_in_buffer;
+    dest->jpegsize = dest->overflow ? 0 : dest->bufsize - dest->free_in_buffer;
 }
 
 libjpeg_destination_mgr::libjpeg_destination_mgr(uint8_t* input, int size) {
@@ -97,6 +121,7 @@ libjpeg_destination_mgr::libjpeg_destination_mgr(uint8_t* input, int size) {
     this->bufsize = size;
 
     jpegsize = 0;
+    overflow = false;
 }
 
 /* private static functions */
@@ -262,6 +287,163 @@ static void resize_nv12(Encoder_libjpeg::params* params, uint8_t* dst_buffer) {
     VT_resizeFrame_Video_opt2_lp(&i_img_ptr, &o_img_ptr, NULL, 0);
 }
 
+/*
+ * Raw data path: libjpeg takes planar 4:2:0 input one iMCU row (16 luma
+ * rows) at a time, so packed rows only need to be split apart instead of
+ * expanded to yuv444 and downsampled again inside libjpeg.
+ */
+#define RAW_MCU_ROWS (2 * DCTSIZE)
+
+static void pad_row(uint8_t* row, int width, int padded) {
+    if (width > 0 && padded > width) {
+        memset(row + width, row[width - 1], padded - width);
+    }
+}
+
+// Split two packed 4:2:2 rows into two luma rows and one chroma row pair,
+// averaging the chroma of both rows
+static void yuv422i_to_planar(const uint8_t* src0, const uint8_t* src1,
+                              uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                              int pairs, bool uyvy) {
+    const int yo = uyvy ? 1 : 0; // first luma byte of each pixel pair
+    const int uo = uyvy ? 0 : 1; // cb byte, cr follows two bytes later
+    int i = 0;
+
+#ifdef ARCH_ARM_HAVE_NEON
+    for (; i + 8 <= pairs; i += 8) {
+        uint8x8x4_t a = vld4_u8(src0 + 4 * i);
+        uint8x8x4_t b = vld4_u8(src1 + 4 * i);
+        uint8x8x2_t ya, yb;
+
+        ya.val[0] = a.val[yo];
+        ya.val[1] = a.val[yo + 2];
+        yb.val[0] = b.val[yo];
+        yb.val[1] = b.val[yo + 2];
+        vst2_u8(y0 + 2 * i, ya);
+        vst2_u8(y1 + 2 * i, yb);
+        vst1_u8(u + i, vrhadd_u8(a.val[uo], b.val[uo]));
+        vst1_u8(v + i, vrhadd_u8(a.val[uo + 2], b.val[uo + 2]));
+    }
+#endif
+
+    for (; i < pairs; i++) {
+        const uint8_t* a = src0 + 4 * i;
+        const uint8_t* b = src1 + 4 * i;
+
+        y0[2 * i] = a[yo];
+        y0[2 * i + 1] = a[yo + 2];
+        y1[2 * i] = b[yo];
+        y1[2 * i + 1] = b[yo + 2];
+        u[i] = (a[uo] + b[uo] + 1) >> 1;
+        v[i] = (a[uo + 2] + b[uo + 2] + 1) >> 1;
+    }
+}
+
+// Split an interleaved crcb row into cb and cr rows
+static void nv21_to_planar(const uint8_t* vu, uint8_t* u, uint8_t* v, int pairs) {
+    int i = 0;
+
+#ifdef ARCH_ARM_HAVE_NEON
+    for (; i + 16 <= pairs; i += 16) {
+        uint8x16x2_t c = vld2q_u8(vu + 2 * i);
+        vst1q_u8(v + i, c.val[0]);
+        vst1q_u8(u + i, c.val[1]);
+    }
+#endif
+
+    for (; i < pairs; i++) {
+        v[i] = vu[2 * i];
+        u[i] = vu[2 * i + 1];
+    }
+}
+
+// Feeds the whole image through jpeg_write_raw_data(). Rows past the right
+// and bottom edges are padded with edge pixels up to whole MCUs, as libjpeg
+// reads full blocks in raw mode.
+static bool encode_raw(j_compress_ptr cinfo, encoder_input_format format,
+                       uint8_t* row_src, uint8_t* row_uv, int src_stride,
+                       bool* cancel) {
+    const int width = cinfo->image_width;
+    const int height = cinfo->image_height;
+    const int pairs = (width + 1) / 2;
+    const int y_padded = (width + 15) & ~15;
+    const int c_padded = y_padded / 2;
+    // nv12 luma rows that are already whole MCUs wide are handed over as is
+    const bool y_direct = (format == FORMAT_NV12) && (y_padded == width);
+    JSAMPROW y_buf[RAW_MCU_ROWS], u_buf[DCTSIZE], v_buf[DCTSIZE];
+    JSAMPROW y_rows[RAW_MCU_ROWS], u_rows[DCTSIZE], v_rows[DCTSIZE];
+    JSAMPARRAY planes[3] = { y_rows, u_rows, v_rows };
+
+    uint8_t* buf = (uint8_t*) malloc(RAW_MCU_ROWS * y_padded + 2 * DCTSIZE * c_padded);
+    if (!buf) {
+        CAMHAL_LOGEA("Encoder: out of memory for raw row buffers");
+        return false;
+    }
+
+    for (int i = 0; i < RAW_MCU_ROWS; i++) {
+        y_buf[i] = buf + i * y_padded;
+    }
+    for (int i = 0; i < DCTSIZE; i++) {
+        u_buf[i] = buf + RAW_MCU_ROWS * y_padded + i * c_padded;
+        v_buf[i] = u_buf[i] + DCTSIZE * c_padded;
+    }
+
+    while ((cinfo->next_scanline < (unsigned int) height) && !*cancel) {
+        const int line = cinfo->next_scanline;
+        const int count = MIN(height - line, RAW_MCU_ROWS);
+        const int c_count = (count + 1) / 2;
+
+        for (int i = 0; i < count; i += 2) {
+            const int row = line + i;
+            const bool last = (i + 1 == count);
+            uint8_t* src0 = row_src + row * src_stride;
+
+            if (format == FORMAT_NV12) {
+                if (y_direct) {
+                    y_rows[i] = src0;
+                    y_rows[i + 1] = last ? src0 : src0 + src_stride;
+                } else {
+                    memcpy(y_buf[i], src0, width);
+                    pad_row(y_buf[i], width, y_padded);
+                    if (!last) {
+                        memcpy(y_buf[i + 1], src0 + src_stride, width);
+                        pad_row(y_buf[i + 1], width, y_padded);
+                    }
+                    y_rows[i] = y_buf[i];
+                    y_rows[i + 1] = last ? y_buf[i] : y_buf[i + 1];
+                }
+                nv21_to_planar(row_uv + (row / 2) * src_stride, u_buf[i / 2], v_buf[i / 2], pairs);
+            } else {
+                yuv422i_to_planar(src0, last ? src0 : src0 + src_stride,
+                                  y_buf[i], y_buf[i + 1], u_buf[i / 2], v_buf[i / 2],
+                                  pairs, format == FORMAT_UYVY);
+                pad_row(y_buf[i], width, y_padded);
+                pad_row(y_buf[i + 1], width, y_padded);
+                y_rows[i] = y_buf[i];
+                y_rows[i + 1] = y_buf[i + 1];
+            }
+            pad_row(u_buf[i / 2], pairs, c_padded);
+            pad_row(v_buf[i / 2], pairs, c_padded);
+            u_rows[i / 2] = u_buf[i / 2];
+            v_rows[i / 2] = v_buf[i / 2];
+        }
+
+        // bottom edge, repeat the last row of each plane
+        for (int i = count; i < RAW_MCU_ROWS; i++) {
+            y_rows[i] = y_rows[count - 1];
+        }
+        for (int i = c_count; i < DCTSIZE; i++) {
+            u_rows[i] = u_rows[c_count - 1];
+            v_rows[i] = v_rows[c_count - 1];
+        }
+
+        jpeg_write_raw_data(cinfo, planes, RAW_MCU_ROWS);
+    }
+
+    free(buf);
+    return true;
+}
+
 /* public static functions */
 const char* ExifElementsTable::degreesToExifOrientation(unsigned int degrees) {
     for (unsigned int i = 0; i < ARRAY_SIZE(degress_to_exif_lut); i++) {
@@ -357,21 +539,88 @@ void ExifElementsTable::saveJpeg(unsigned char* jpeg, size_t jpeg_size) {
     }
 }
 
-/* public functions */
-ExifElementsTable::~ExifElementsTable() {
-    int num_elements = gps_tag_count + exif_tag_count;
+/* private member functions */
+char* ExifElementsTable::allocValue(size_t size) {
+    if (size <= (EXIF_VALUE_POOL_SIZE - value_pool_used)) {
+        char* value = value_pool + value_pool_used;
+        value_pool_used += size;
+        return value;
+    }
+
+    return (char*) malloc(sizeof(char) * size);
+}
 
-    for (int i = 0; i < num_elements; i++) {
-        if (table[i].Value) {
-            free(table[i].Value);
+void ExifElementsTable::freeValues() {
+    for (unsigned int i = 0; i < position; i++) {
+        char* value = table[i].Value;
+        if (value && ((value < value_pool) || (value >= value_pool + EXIF_VALUE_POOL_SIZE))) {
+            free(value);
         }
+        table[i].Value = NULL;
     }
+}
+
+/* public functions */
+ExifElementsTable::~ExifElementsTable() {
+    freeValues();
 
     if (jpeg_opened) {
         DiscardData();
     }
 }
 
+void ExifElementsTable::reset() {
+    freeValues();
+
+    gps_tag_count = 0;
+    exif_tag_count = 0;
+    position = 0;
+    value_pool_used = 0;
+#ifdef ANDROID_API_JB_OR_LATER
+    has_datetime_tag = false;
+#endif
+}
+
+status_t ExifElementsTable::insertElements(const ExifElementsTable& other) {
+    if ((position + other.position) > MAX_EXIF_TAGS_SUPPORTED) {
+        CAMHAL_LOGEA("Max number of EXIF elements already inserted");
+        return NO_MEMORY;
+    }
+
+    // Tag names are already resolved in the source table, so this is
+    // just a copy of the values
+    for (unsigned int i = 0; i < other.position; i++) {
+        const ExifElement_t& src = other.table[i];
+
+        table[position].GpsTag = src.GpsTag;
+        table[position].Tag = src.Tag;
+        table[position].DataLength = 0;
+        table[position].Value = NULL;
+
+        if (src.Value) {
+            table[position].Value = allocValue(src.DataLength);
+            if (table[position].Value) {
+                memcpy(table[position].Value, src.Value, src.DataLength);
+                table[position].DataLength = src.DataLength;
+            }
+        }
+
+        if (src.GpsTag) {
+            gps_tag_count++;
+        } else {
+            exif_tag_count++;
+        }
+
+        position++;
+    }
+
+#ifdef ANDROID_API_JB_OR_LATER
+    has_datetime_tag |= other.has_datetime_tag;
+#endif
+
+    return NO_ERROR;
+}
+
 status_t ExifElementsTable::insertElement(const char* tag, const char* value) {
     unsigned int value_length = 0;
     status_t ret = NO_ERROR;
@@ -413,7 +662,7 @@ status_t ExifElementsTable::insertElement(const char* tag, const char* value) {
     }
 
     table[position].DataLength = 0;
-    table[position].Value = (char*) malloc(sizeof(char) * (value_length + 1));
+    table[position].Value = allocValue(value_length + 1);
 
     if (table[position].Value) {
         memcpy(table[position].Value, value, value_length + 1);
@@ -437,6 +686,8 @@ size_t Encoder_libjpeg::encode(params* input) {
     int out_height = 0, in_height = 0;
     int bpp = 2; // for uyvy
     int right_crop = 0, start_offset = 0;
+    encoder_input_format format = FORMAT_YUYV;
+    bool raw = false;
 
     if (!input) {
         return 0;
@@ -461,6 +712,7 @@ size_t Encoder_libjpeg::encode(params* input) {
     }
 
     if (strcmp(input->format, android::CameraParameters::PIXEL_FORMAT_YUV420SP) == 0) {
+        format = FORMAT_NV12;
         bpp = 1;
         if ((in_width != out_width) || (in_height != out_height)) {
             resize_src = (uint8_t*) malloc(input->dst_size);
@@ -472,7 +724,11 @@ size_t Encoder_libjpeg::encode(params* input) {
         // we currently only support yuv422i and yuv420sp
         CAMHAL_LOGEB("Encoder: format not supported: %s", input->format);
         goto exit;
-    } else if ((in_width != out_width) || (in_height != out_height)) {
+    } else if (strcmp(input->format, TICameraParameters::PIXEL_FORMAT_YUV422I_UYVY) == 0) {
+        format = FORMAT_UYVY;
+    }
+
+    if ((format != FORMAT_NV12) && ((in_width != out_width) || (in_height != out_height))) {
         CAMHAL_LOGEB("Encoder: resizing is not supported for this format: %s", input->format);
         goto exit;
     }
@@ -502,38 +758,69 @@ size_t Encoder_libjpeg::encode(params* input) {
     jpeg_set_quality(&cinfo, input->quality, TRUE);
     cinfo.dct_method = JDCT_IFAST;
 
+    // planar input needs every chroma sample pair to be there in the source
+    raw = !(out_width % 2);
+    if (raw) {
+        cinfo.raw_data_in = TRUE;
+        cinfo.comp_info[0].h_samp_factor = 2;
+        cinfo.comp_info[0].v_samp_factor = 2;
+        cinfo.comp_info[1].h_samp_factor = 1;
+        cinfo.comp_info[1].v_samp_factor = 1;
+        cinfo.comp_info[2].h_samp_factor = 1;
+        cinfo.comp_info[2].v_samp_factor = 1;
+    }
+
     jpeg_start_compress(&cinfo, TRUE);
 
-    row_tmp = (uint8_t*)malloc((out_width - right_crop) * 3);
     row_src = src + start_offset;
     row_uv = src + out_width * out_height * bpp;
 
-    while ((cinfo.next_scanline < cinfo.image_height) && !mCancelEncoding) {
-        JSAMPROW row[1];    /* pointer to JSAMPLE row[s] */
-
-        // convert input yuv format to yuv444
-        if (strcmp(input->format, android::CameraParameters::PIXEL_FORMAT_YUV420SP) == 0) {
-            nv21_to_yuv(row_tmp, row_src, row_uv, out_width - right_crop);
-        } else if (strcmp(input->format, TICameraParameters::PIXEL_FORMAT_YUV422I_UYVY) == 0) {
-            uyvy_to_yuv(row_tmp, (uint32_t*)row_src, out_width - right_crop);
-        } else if (strcmp(input->format, android::CameraParameters::PIXEL_FORMAT_YUV422I) == 0) {
-            yuyv_to_yuv(row_tmp, (uint32_t*)row_src, out_width - right_crop);
+    if (raw) {
+        if (encode_raw(&cinfo, format, row_src, row_uv, out_width * bpp, &mCancelEncoding) &&
+            !mCancelEncoding) {
+            jpeg_finish_compress(&cinfo);
         }
+        jpeg_destroy_compress(&cinfo);
+        if (resize_src) free(resize_src);
+        goto exit;
+    }
 
-        row[0] = row_tmp;
-        jpeg_write_scanlines(&cinfo, row, 1);
-        row_src = row_src + out_width*bpp;
+    row_tmp = (uint8_t*)malloc((out_width - right_crop) * 3 * ENCODE_STRIP_ROWS);
+    if (!row_tmp) {
+        CAMHAL_LOGEA("Encoder: out of memory for row buffer");
+    }
 
-        // move uv row if input format needs it
-        if (strcmp(input->format, android::CameraParameters::PIXEL_FORMAT_YUV420SP) == 0) {
-            if (!(cinfo.next_scanline % 2))
+    // convert a strip of rows to yuv444 at a time and hand them to libjpeg
+    // together, it would buffer them up to a full MCU row anyway
+    while (row_tmp && (cinfo.next_scanline < cinfo.image_height) && !mCancelEncoding) {
+        JSAMPROW rows[ENCODE_STRIP_ROWS];    /* pointers to JSAMPLE row[s] */
+        unsigned int line = cinfo.next_scanline;
+        unsigned int count = MIN(cinfo.image_height - line, (unsigned int) ENCODE_STRIP_ROWS);
+
+        for (unsigned int i = 0; i < count; i++, line++) {
+            rows[i] = row_tmp + i * (out_width - right_crop) * 3;
+
+            // convert input yuv format to yuv444
+            if (format == FORMAT_NV12) {
+                nv21_to_yuv(rows[i], row_src, row_uv, out_width - right_crop);
+            } else if (format == FORMAT_UYVY) {
+                uyvy_to_yuv(rows[i], (uint32_t*)row_src, out_width - right_crop);
+            } else {
+                yuyv_to_yuv(rows[i], (uint32_t*)row_src, out_width - right_crop);
+            }
+            row_src = row_src + out_width*bpp;
+
+            // move uv row if input format needs it
+            if ((format == FORMAT_NV12) && (line % 2))
                 row_uv = row_uv +  out_width * bpp;
         }
+
+        jpeg_write_scanlines(&cinfo, rows, count);
     }
 
     // no need to finish encoding routine if we are prematurely stopping
     // we will end up crashing in dest_mgr since data is incomplete
-    if (!mCancelEncoding)
+    if (!mCancelEncoding && row_tmp)
         jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
 
@@ -22,7 +22,7 @@ namespace Ti {
 namespace Camera {
 
 FrameDecoder::FrameDecoder()
-: mCameraHal(NULL), mState(DecoderState_Uninitialized) {
+: mInBuffers(NULL), mOutBuffers(NULL), mCameraHal(NULL), mState(DecoderState_Uninitialized) {
 }
 
 FrameDecoder::~FrameDecoder() {
@@ -166,10 +166,17 @@ status_t FrameDecoder::queueOutputBuffer(int index) {
         return INVALID_OPERATION;
     }
 
-    android::sp<MediaBuffer>& out = mOutBuffers->editItemAt(index);
-    android::AutoMutex bufferLock(out->getLock());
-    out->setStatus(BufferStatus_OutQueued);
-    mOutQueue.push_back(index);
+    {
+        android::sp<MediaBuffer>& out = mOutBuffers->editItemAt(index);
+        android::AutoMutex bufferLock(out->getLock());
+        out->setStatus(BufferStatus_OutQueued);
+        mOutQueue.push_back(index);
+    }
+
+    // Don't let the buffer wait for the next input frame
+    if (mState == DecoderState_Running) {
+        doQueueOutputBuffer(index);
+    }
 
     LOG_FUNCTION_NAME_EXIT;
     return NO_ERROR;
@@ -34,20 +34,109 @@ namespace Camera {
 
 #define ALLOCATION_2D 2
 
+///Freed lists up to this size are kept for the next request of the same geometry.
+///Larger ones (capture buffers) are pooled by CameraHal, which knows when they are needed.
+#define PARKED_LIST_MAX_BYTES (256 * 1024)
+
 ///Utility Macro Declarations
 
+android::Mutex MemoryManager::sBudgetLock;
+size_t MemoryManager::sAllocatedBytes = 0;
+
 /*--------------------MemoryManager Class STARTS here-----------------------------*/
 MemoryManager::MemoryManager() {
     mIonFd = -1;
+    mParkedBuffers = NULL;
+    mParkedCount = 0;
+    mParkedSize = 0;
 }
 
 MemoryManager::~MemoryManager() {
+    releaseParkedList();
+
     if ( mIonFd >= 0 ) {
         ion_close(mIonFd);
         mIonFd = -1;
     }
 }
 
+/**
+   @brief Accounts bytes against the camera memory budget
+
+   The budget is shared by every MemoryManager instance and set through
+   debug.camera.mem_budget_mb, 0 meaning no limit.
+ */
+bool MemoryManager::reserveBudget(size_t bytes)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.camera.mem_budget_mb", value, "0");
+    const size_t budget = (size_t) atoi(value) * 1024 * 1024;
+
+    android::AutoMutex lock(sBudgetLock);
+
+    if ( ( 0 != budget ) && ( ( sAllocatedBytes + bytes ) > budget ) ) {
+        CAMHAL_LOGDB("Camera memory budget exceeded, %u of %u bytes in use, %u requested",
+                     (unsigned int) sAllocatedBytes, (unsigned int) budget, (unsigned int) bytes);
+        return false;
+    }
+
+    sAllocatedBytes += bytes;
+
+    return true;
+}
+
+void MemoryManager::releaseBudget(size_t bytes)
+{
+    android::AutoMutex lock(sBudgetLock);
+
+    sAllocatedBytes = ( sAllocatedBytes > bytes ) ? ( sAllocatedBytes - bytes ) : 0;
+}
+
+CameraBuffer* MemoryManager::takeParkedList(const char* format, int bytes, int numBufs, bool cached)
+{
+    android::AutoMutex lock(mParkedLock);
+
+    if ( ( NULL == mParkedBuffers ) || ( mParkedCount != numBufs ) ||
+         ( mParkedSize != bytes ) || ( mParkedBuffers[0].cached != cached ) ) {
+        return NULL;
+    }
+
+    CameraBuffer *buffers = mParkedBuffers;
+    mParkedBuffers = NULL;
+    mParkedCount = 0;
+    mParkedSize = 0;
+
+    ///Callers expect the contents a fresh ION allocation would have
+    for ( int i = 0 ; i < numBufs ; i++ ) {
+        memset(buffers[i].mapped, 0, buffers[i].size);
+        if ( buffers[i].cached ) {
+            ion_flush_cached(mIonFd, buffers[i].ion_handle, buffers[i].size,
+                             (unsigned char *) buffers[i].mapped);
+        }
+        buffers[i].format = CameraHal::getPixelFormatConstant(format);
+    }
+
+    return buffers;
+}
+
+void MemoryManager::releaseParkedList()
+{
+    CameraBuffer *buffers;
+
+    {
+        android::AutoMutex lock(mParkedLock);
+        buffers = mParkedBuffers;
+        mParkedBuffers = NULL;
+        mParkedCount = 0;
+        mParkedSize = 0;
+    }
+
+    if ( NULL != buffers ) {
+        releaseBuffers(buffers);
+    }
+}
+
 status_t MemoryManager::initialize() {
     if ( mIonFd == -1 ) {
         mIonFd = ion_open();
@@ -62,17 +151,36 @@ status_t MemoryManager::initialize() {
 }
 
 CameraBuffer* MemoryManager::allocateBufferList(int width, int height, const char* format, int &size, int numBufs)
+{
+    return allocateBufferList(width, height, format, size, numBufs, numBufs, false);
+}
+
+CameraBuffer* MemoryManager::allocateBufferList(int width, int height, const char* format, int &size,
+                                                int &numBufs, int minBufs, bool cached)
 {
     LOG_FUNCTION_NAME;
 
     CAMHAL_ASSERT(mIonFd != -1);
 
+    CameraBuffer *buffers = takeParkedList(format, size, numBufs, cached);
+    if ( NULL != buffers ) {
+        CAMHAL_LOGDB("Reusing %d parked buffers of %d bytes", numBufs, size);
+        LOG_FUNCTION_NAME_EXIT;
+        return buffers;
+    }
+
+    ///Pixel data goes to Ducati and DSS, where TILER page mode suits it and
+    ///keeps the carveout for the small parameter blobs the CPU fills in
+    const unsigned int firstHeap = ( NULL != format ) ? OMAP_ION_HEAP_TILER_MASK :
+                                                        ( 1 << ION_HEAP_TYPE_CARVEOUT );
+
     ///We allocate numBufs+1 because the last entry will be marked NULL to indicate end of array, which is used when freeing
     ///the buffers
     const uint numArrayEntriesC = (uint)(numBufs+1);
+    int allocated = 0;
 
     ///Allocate a buffer array
-    CameraBuffer *buffers = new CameraBuffer [numArrayEntriesC];
+    buffers = new CameraBuffer [numArrayEntriesC];
     if(!buffers) {
         CAMHAL_LOGEB("Allocation failed when creating buffers array of %d CameraBuffer elements", numArrayEntriesC);
         goto error;
@@ -91,24 +199,49 @@ CameraBuffer* MemoryManager::allocateBufferList(int width, int height, const cha
         ///1D buffers
         for (int i = 0; i < numBufs; i++) {
             unsigned char *data;
-            int ret = ion_alloc(mIonFd, size, 0, 1 << ION_HEAP_TYPE_CARVEOUT,
-                    &handle);
-            if((ret < 0) || ((int)handle == -ENOMEM)) {
+            int ret = -ENOMEM;
+
+            if ( !reserveBudget(size) ) {
+                ///Parked memory is the first thing to give back
+                releaseParkedList();
+                if ( !reserveBudget(size) ) {
+                    goto degrade;
+                }
+            }
+
+            if ( OMAP_ION_HEAP_TILER_MASK == firstHeap ) {
                 ret = ion_alloc_tiler(mIonFd, (size_t)size, 1, TILER_PIXEL_FMT_PAGE,
-                OMAP_ION_HEAP_TILER_MASK, &handle, &stride);
+                        OMAP_ION_HEAP_TILER_MASK, &handle, &stride);
+                if((ret < 0) || ((int)handle == -ENOMEM)) {
+                    ret = ion_alloc(mIonFd, size, 0, 1 << ION_HEAP_TYPE_CARVEOUT, &handle);
+                }
+            } else {
+                ret = ion_alloc(mIonFd, size, 0, 1 << ION_HEAP_TYPE_CARVEOUT, &handle);
+                if((ret < 0) || ((int)handle == -ENOMEM)) {
+                    ret = ion_alloc_tiler(mIonFd, (size_t)size, 1, TILER_PIXEL_FMT_PAGE,
+                            OMAP_ION_HEAP_TILER_MASK, &handle, &stride);
+                }
             }
 
             if((ret < 0) || ((int)handle == -ENOMEM)) {
                 CAMHAL_LOGEB("FAILED to allocate ion buffer of size=%d. ret=%d(0x%x)", size, ret, ret);
-                goto error;
+                releaseBudget(size);
+                goto degrade;
             }
 
             CAMHAL_LOGDB("Before mapping, handle = %p, nSize = %d", handle, size);
-            if ((ret = ion_map(mIonFd, handle, size, PROT_READ | PROT_WRITE, MAP_SHARED, 0,
-                          &data, &mmap_fd)) < 0) {
+            if ( cached ) {
+                ret = ion_map_cacheable(mIonFd, handle, size, PROT_READ | PROT_WRITE, MAP_SHARED, 0,
+                                        &data, &mmap_fd);
+            } else {
+                ret = ion_map(mIonFd, handle, size, PROT_READ | PROT_WRITE, MAP_SHARED, 0,
+                              &data, &mmap_fd);
+            }
+            if (ret < 0) {
                 CAMHAL_LOGEB("Userspace mapping of ION buffers returned error %d", ret);
                 ion_free(mIonFd, handle);
-                goto error;
+                releaseBudget(size);
+                goto degrade;
             }
 
             buffers[i].type = CAMERA_BUFFER_ION;
@@ -118,7 +251,9 @@ CameraBuffer* MemoryManager::allocateBufferList(int width, int height, const cha
             buffers[i].ion_fd = mIonFd;
             buffers[i].fd = mmap_fd;
             buffers[i].size = size;
+            buffers[i].cached = cached;
             buffers[i].format = CameraHal::getPixelFormatConstant(format);
+            allocated++;
 
         }
     }
@@ -127,11 +262,21 @@ CameraBuffer* MemoryManager::allocateBufferList(int width, int height, const cha
 
     return buffers;
 
+degrade:
+
+    ///Running with fewer buffers beats failing the use case altogether
+    if ( ( allocated > 0 ) && ( allocated >= minBufs ) ) {
+        CAMHAL_LOGIB("Short of memory, got %d of %d buffers of %d bytes", allocated, numBufs, size);
+        numBufs = allocated;
+        LOG_FUNCTION_NAME_EXIT;
+        return buffers;
+    }
+
 error:
 
     CAMHAL_LOGE("Freeing buffers already allocated after error occurred");
     if(buffers)
-        freeBufferList(buffers);
+        releaseBuffers(buffers);
 
     if ( NULL != mErrorNotifier.get() )
         mErrorNotifier->errorNotify(-ENOMEM);
@@ -182,6 +327,38 @@ int MemoryManager::freeBufferList(CameraBuffer *buffers)
         }
 
     i = 0;
+    while( ( buffers[i].type == CAMERA_BUFFER_ION ) && ( buffers[i].size == buffers[0].size ) )
+        {
+        i++;
+        }
+
+    if ( ( i > 0 ) && ( buffers[i].type != CAMERA_BUFFER_ION ) &&
+         ( ( buffers[0].size * i ) <= PARKED_LIST_MAX_BYTES ) )
+        {
+        android::AutoMutex lock(mParkedLock);
+
+        ///Keep it for the next request of the same geometry, the 3A and focus
+        ///helpers allocate and free the same list on every call
+        if ( NULL == mParkedBuffers )
+            {
+            mParkedBuffers = buffers;
+            mParkedCount = i;
+            mParkedSize = buffers[0].size;
+            LOG_FUNCTION_NAME_EXIT;
+            return ret;
+            }
+        }
+
+    releaseBuffers(buffers);
+
+    LOG_FUNCTION_NAME_EXIT;
+    return ret;
+}
+
+void MemoryManager::releaseBuffers(CameraBuffer *buffers)
+{
+    int i = 0;
+
     while(buffers[i].type == CAMERA_BUFFER_ION)
         {
         if(buffers[i].size)
@@ -189,6 +366,7 @@ int MemoryManager::freeBufferList(CameraBuffer *buffers)
             munmap(buffers[i].opaque, buffers[i].size);
             close(buffers[i].fd);
             ion_free(mIonFd, buffers[i].ion_handle);
+            releaseBudget(buffers[i].size);
             }
         else
             {
@@ -198,9 +376,6 @@ int MemoryManager::freeBufferList(CameraBuffer *buffers)
         }
 
     delete [] buffers;
-
-    LOG_FUNCTION_NAME_EXIT;
-    return ret;
 }
 
 status_t MemoryManager::setErrorHandler(ErrorNotifier *errorNotifier)
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NV12_convert.h"
+
+#ifdef ARCH_ARM_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*SwapRowFn)(const uint8_t *src, uint8_t *dst, int n);
+typedef void (*SplitRowFn)(const uint8_t *src, uint8_t *dstV, uint8_t *dstU, int n);
+
+static void swapRow_c(const uint8_t *src, uint8_t *dst, int n)
+{
+    for (int i = 0; i < n; i += 2) {
+        dst[i] = src[i + 1];
+        dst[i + 1] = src[i];
+    }
+}
+
+static void splitRow_c(const uint8_t *src, uint8_t *dstV, uint8_t *dstU, int n)
+{
+    for (int i = 0; i < n; i += 2) {
+        *dstU++ = src[i];
+        *dstV++ = src[i + 1];
+    }
+}
+
+#ifdef ARCH_ARM_HAVE_NEON
+static void swapRow_neon(const uint8_t *src, uint8_t *dst, int n)
+{
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __builtin_prefetch(src + i + 128);
+        uint8x16x2_t uv = vld2q_u8(src + i);
+        uint8x16x2_t vu;
+        vu.val[0] = uv.val[1];
+        vu.val[1] = uv.val[0];
+        vst2q_u8(dst + i, vu);
+    }
+    for (; i + 16 <= n; i += 16) {
+        uint8x8x2_t uv = vld2_u8(src + i);
+        uint8x8x2_t vu;
+        vu.val[0] = uv.val[1];
+        vu.val[1] = uv.val[0];
+        vst2_u8(dst + i, vu);
+    }
+    swapRow_c(src + i, dst + i, n - i);
+}
+
+static void splitRow_neon(const uint8_t *src, uint8_t *dstV, uint8_t *dstU, int n)
+{
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __builtin_prefetch(src + i + 128);
+        uint8x16x2_t uv = vld2q_u8(src + i);
+        vst1q_u8(dstU + i / 2, uv.val[0]);
+        vst1q_u8(dstV + i / 2, uv.val[1]);
+    }
+    for (; i + 16 <= n; i += 16) {
+        uint8x8x2_t uv = vld2_u8(src + i);
+        vst1_u8(dstU + i / 2, uv.val[0]);
+        vst1_u8(dstV + i / 2, uv.val[1]);
+    }
+    splitRow_c(src + i, dstV + i / 2, dstU + i / 2, n - i);
+}
+#endif
+
+#ifdef ARCH_ARM_HAVE_NEON
+static NV12ConvertImpl gImpl = NV12_CONVERT_NEON;
+#else
+static NV12ConvertImpl gImpl = NV12_CONVERT_C;
+#endif
+
+bool NV12_setConvertImpl(NV12ConvertImpl impl)
+{
+#ifndef ARCH_ARM_HAVE_NEON
+    if (impl == NV12_CONVERT_NEON)
+        return false;
+#endif
+    gImpl = impl;
+    return true;
+}
+
+NV12ConvertImpl NV12_getConvertImpl()
+{
+    return gImpl;
+}
+
+void NV12_convertUVtoVU(const uint8_t *src, size_t srcStride,
+                        uint8_t *dst, size_t dstStride,
+                        int width, int rows)
+{
+    SwapRowFn swapRow = swapRow_c;
+#ifdef ARCH_ARM_HAVE_NEON
+    if (gImpl == NV12_CONVERT_NEON)
+        swapRow = swapRow_neon;
+#endif
+
+    width &= ~1;
+    for (int i = 0; i < rows; i++, src += srcStride, dst += dstStride)
+        swapRow(src, dst, width);
+}
+
+void NV12_convertUVtoYV12(const uint8_t *src, size_t srcStride,
+                          uint8_t *dstV, uint8_t *dstU, size_t dstStride,
+                          int width, int rows)
+{
+    SplitRowFn splitRow = splitRow_c;
+#ifdef ARCH_ARM_HAVE_NEON
+    if (gImpl == NV12_CONVERT_NEON)
+        splitRow = splitRow_neon;
+#endif
+
+    width &= ~1;
+    for (int i = 0; i < rows; i++, src += srcStride, dstV += dstStride, dstU += dstStride)
+        splitRow(src, dstV, dstU, width);
+}
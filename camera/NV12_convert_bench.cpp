@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares the C and NEON preview callback chroma conversions.
+ *
+ * usage: nv12_convert_bench [width height [iterations]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NV12_convert.h"
+
+static const char *implName(NV12ConvertImpl impl)
+{
+    return impl == NV12_CONVERT_NEON ? "neon" : "c";
+}
+
+static double nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char *argv[])
+{
+    int width = argc > 2 ? atoi(argv[1]) : 1920;
+    int height = argc > 2 ? atoi(argv[2]) : 1080;
+    int iterations = argc > 3 ? atoi(argv[3]) : 100;
+    /* camera buffers are 4K wide TILER containers */
+    size_t stride = 4096;
+    int rows = height / 2;
+
+    if (width <= 0 || height <= 0 || width > (int) stride || iterations <= 0) {
+        fprintf(stderr, "usage: %s [width height [iterations]]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t *src = (uint8_t *) malloc(stride * rows);
+    uint8_t *dst[2];
+    size_t dstSize = (size_t) width * rows;
+    dst[0] = (uint8_t *) malloc(dstSize);
+    dst[1] = (uint8_t *) malloc(dstSize);
+    if (!src || !dst[0] || !dst[1]) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < stride * rows; i++)
+        src[i] = (uint8_t) (i * 7 + (i >> 12));
+
+    NV12ConvertImpl impls[] = { NV12_CONVERT_C, NV12_CONVERT_NEON };
+
+    printf("%dx%d, %d iterations\n", width, height, iterations);
+    for (int k = 0; k < 2; k++) {
+        bool yv12 = k == 1;
+
+        for (int j = 0; j < 2; j++) {
+            if (!NV12_setConvertImpl(impls[j])) {
+                printf("  %s %s: not built in\n", yv12 ? "YV12" : "NV21", implName(impls[j]));
+                continue;
+            }
+
+            double start = nowUs();
+            for (int i = 0; i < iterations; i++) {
+                if (yv12)
+                    NV12_convertUVtoYV12(src, stride, dst[j], dst[j] + dstSize / 2, width / 2,
+                                         width, rows);
+                else
+                    NV12_convertUVtoVU(src, stride, dst[j], width, width, rows);
+            }
+            double us = (nowUs() - start) / iterations;
+
+            printf("  %s %s: %.1f us/frame, %.1f MB/s\n", yv12 ? "YV12" : "NV21",
+                   implName(impls[j]), us, dstSize / us);
+        }
+
+        if (NV12_setConvertImpl(NV12_CONVERT_NEON) && memcmp(dst[0], dst[1], dstSize))
+            printf("  %s: outputs differ!\n", yv12 ? "YV12" : "NV21");
+    }
+
+    free(src);
+    free(dst[0]);
+    free(dst[1]);
+    return 0;
+}
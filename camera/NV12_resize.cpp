@@ -16,6 +16,14 @@
 
 #include "NV12_resize.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef ARCH_ARM_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
 #ifdef LOG_TAG
 #undef LOG_TAG
 #endif
@@ -23,6 +31,343 @@
 
 #define STRIDE 4096
 
+/* Upper bound on the threads (caller included) a single resize is split across */
+#define RESIZE_MAX_THREADS 4
+
+/* Frames with fewer output pixels than this are not worth waking the pool for */
+#define RESIZE_MIN_PARALLEL_PIXELS (320 * 240)
+
+typedef struct {
+    const mmUchar *srcY;
+    const mmUchar *srcUV;
+    mmUint32 srcStride;
+    mmUchar *dstY;
+    mmUchar *dstUV;
+    mmUint32 dstStride;
+    mmUint32 width;             /* output luma width                     */
+    mmUint32 height;            /* output luma height                    */
+    mmUint32 resizeFactorY;     /* 23.9 fixed point source rows per row  */
+    const mmUint16 *xTab;       /* source column for every output column */
+    const mmUchar *xfTab;       /* horizontal 1/8 weight for every column */
+    mmUint32 srcSpan;           /* widest row either bilinear pass reads */
+    mmUint32 decimate;          /* 2 or 4 for exact box decimation, or 0 */
+} ResizeContext;
+
+/*
+ * The bilinear weights in bWeights are the products of a horizontal and a
+ * vertical 1/8 weight, so the filter is done as two separable passes: the
+ * two source rows are blended into a 16-bit row first (vectorizable), then
+ * the columns are picked out of it. Intermediate values stay exact, so the
+ * output matches the original per-pixel 2x2 loop bit for bit.
+ */
+static void blendRows(const mmUchar *r1, const mmUchar *r2, mmUint32 w1, mmUint32 w2,
+                      mmUint16 *dst, mmUint32 n)
+{
+    mmUint32 i = 0;
+
+#ifdef ARCH_ARM_HAVE_NEON
+    const uint8x8_t vw1 = vdup_n_u8(w1);
+    const uint8x8_t vw2 = vdup_n_u8(w2);
+
+    for ( ; i + 16 <= n; i += 16 ) {
+        uint8x16_t a = vld1q_u8(r1 + i);
+        uint8x16_t b = vld1q_u8(r2 + i);
+        uint16x8_t lo = vmull_u8(vget_low_u8(a), vw1);
+        uint16x8_t hi = vmull_u8(vget_high_u8(a), vw1);
+        lo = vmlal_u8(lo, vget_low_u8(b), vw2);
+        hi = vmlal_u8(hi, vget_high_u8(b), vw2);
+        vst1q_u16(dst + i, lo);
+        vst1q_u16(dst + i + 8, hi);
+    }
+#endif
+
+    for ( ; i < n; i++ ) {
+        dst[i] = (mmUint16) (r1[i] * w1 + r2[i] * w2);
+    }
+}
+
+static void resizeRowsY(const ResizeContext *c, mmUint32 rowStart, mmUint32 rowEnd, mmUint16 *tmp)
+{
+    const mmUint32 span = c->xTab[c->width - 1] + 2;
+
+    for ( mmUint32 row = rowStart; row < rowEnd; row++ ) {
+        mmUint32 fy = row * c->resizeFactorY;
+        mmUint32 y = (mmUint16) (fy >> 9);
+        mmUint32 yf = (fy >> 6) & 0x7;
+        const mmUchar *r1 = c->srcY + y * c->srcStride;
+        mmUchar *dst = c->dstY + row * c->dstStride;
+
+        blendRows(r1, r1 + c->srcStride, 8 - yf, yf, tmp, span);
+
+        for ( mmUint32 col = 0; col < c->width; col++ ) {
+            mmUint32 x = c->xTab[col];
+            mmUint32 xf = c->xfTab[col];
+            dst[col] = (mmUchar) ((tmp[x] * (8 - xf) + tmp[x + 1] * xf) >> 6);
+        }
+    }
+}
+
+static void resizeRowsUV(const ResizeContext *c, mmUint32 rowStart, mmUint32 rowEnd, mmUint16 *tmp)
+{
+    const mmUint32 cols = c->width >> 1;
+
+    if ( !cols ) {
+        return;
+    }
+
+    /* interleaved CbCr, U at even and V at odd bytes */
+    const mmUint32 span = 2 * c->xTab[cols - 1] + 4;
+
+    for ( mmUint32 row = rowStart; row < rowEnd; row++ ) {
+        mmUint32 fy = row * c->resizeFactorY;
+        mmUint32 y = (mmUint16) (fy >> 9);
+        mmUint32 yf = (fy >> 6) & 0x7;
+        const mmUchar *r1 = c->srcUV + y * c->srcStride;
+        mmUchar *dst = c->dstUV + row * c->dstStride;
+
+        blendRows(r1, r1 + c->srcStride, 8 - yf, yf, tmp, span);
+
+        for ( mmUint32 col = 0; col < cols; col++ ) {
+            const mmUint16 *t = tmp + 2 * c->xTab[col];
+            mmUint32 xf = c->xfTab[col];
+            dst[2 * col] = (mmUchar) ((t[0] * (8 - xf) + t[2] * xf) >> 6);
+            dst[2 * col + 1] = (mmUchar) ((t[1] * (8 - xf) + t[3] * xf) >> 6);
+        }
+    }
+}
+
+/*
+ * Exact 2x and 4x downscales are box filtered instead: every output sample
+ * is the rounded mean of the NxN source block it covers.
+ */
+static void decimateRowY(const mmUchar *src, mmUint32 stride, mmUchar *dst,
+                         mmUint32 width, mmUint32 n)
+{
+    const mmUint32 shift = n == 4 ? 4 : 2;
+    mmUint32 col = 0;
+
+#ifdef ARCH_ARM_HAVE_NEON
+    if ( n == 2 ) {
+        for ( ; col + 8 <= width; col += 8 ) {
+            uint16x8_t sum = vpaddlq_u8(vld1q_u8(src + 2 * col));
+            sum = vpadalq_u8(sum, vld1q_u8(src + stride + 2 * col));
+            vst1_u8(dst + col, vrshrn_n_u16(sum, 2));
+        }
+    } else {
+        for ( ; col + 8 <= width; col += 8 ) {
+            uint16x8_t lo = vdupq_n_u16(0);
+            uint16x8_t hi = vdupq_n_u16(0);
+
+            for ( mmUint32 k = 0; k < 4; k++ ) {
+                const mmUchar *s = src + k * stride + 4 * col;
+                lo = vpadalq_u8(lo, vld1q_u8(s));
+                hi = vpadalq_u8(hi, vld1q_u8(s + 16));
+            }
+            uint16x8_t sum = vcombine_u16(vpadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+                                          vpadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+            vst1_u8(dst + col, vrshrn_n_u16(sum, 4));
+        }
+    }
+#endif
+
+    for ( ; col < width; col++ ) {
+        mmUint32 sum = 0;
+
+        for ( mmUint32 k = 0; k < n; k++ ) {
+            const mmUchar *s = src + k * stride + n * col;
+            for ( mmUint32 j = 0; j < n; j++ ) {
+                sum += s[j];
+            }
+        }
+        dst[col] = (mmUchar) ((sum + (1 << (shift - 1))) >> shift);
+    }
+}
+
+static void decimateRowUV(const mmUchar *src, mmUint32 stride, mmUchar *dst,
+                          mmUint32 cols, mmUint32 n)
+{
+    const mmUint32 shift = n == 4 ? 4 : 2;
+    mmUint32 col = 0;
+
+#ifdef ARCH_ARM_HAVE_NEON
+    if ( n == 2 ) {
+        for ( ; col + 8 <= cols; col += 8 ) {
+            uint8x8x4_t a = vld4_u8(src + 4 * col);
+            uint8x8x4_t b = vld4_u8(src + stride + 4 * col);
+            uint16x8_t u = vaddl_u8(a.val[0], a.val[2]);
+            uint16x8_t v = vaddl_u8(a.val[1], a.val[3]);
+            uint8x8x2_t out;
+            u = vaddq_u16(u, vaddl_u8(b.val[0], b.val[2]));
+            v = vaddq_u16(v, vaddl_u8(b.val[1], b.val[3]));
+            out.val[0] = vrshrn_n_u16(u, 2);
+            out.val[1] = vrshrn_n_u16(v, 2);
+            vst2_u8(dst + 2 * col, out);
+        }
+    }
+#endif
+
+    for ( ; col < cols; col++ ) {
+        mmUint32 sumU = 0, sumV = 0;
+
+        for ( mmUint32 k = 0; k < n; k++ ) {
+            const mmUchar *s = src + k * stride + 2 * n * col;
+            for ( mmUint32 j = 0; j < n; j++ ) {
+                sumU += s[2 * j];
+                sumV += s[2 * j + 1];
+            }
+        }
+        dst[2 * col] = (mmUchar) ((sumU + (1 << (shift - 1))) >> shift);
+        dst[2 * col + 1] = (mmUchar) ((sumV + (1 << (shift - 1))) >> shift);
+    }
+}
+
+/*
+ * A band is a run of even-aligned luma rows together with the chroma rows
+ * under them, so bands never share an output row.
+ */
+static void resizeBand(const ResizeContext *c, mmUint32 band, mmUint32 bands)
+{
+    mmUint32 rowStart = ((c->height * band / bands) + 1) & ~1;
+    mmUint32 rowEnd = band + 1 == bands ? c->height : ((c->height * (band + 1) / bands) + 1) & ~1;
+    mmUint32 uvStart = rowStart >> 1;
+    mmUint32 uvEnd = band + 1 == bands ? c->height >> 1 : rowEnd >> 1;
+
+    if ( c->decimate ) {
+        const mmUint32 n = c->decimate;
+
+        for ( mmUint32 row = rowStart; row < rowEnd; row++ ) {
+            decimateRowY(c->srcY + row * n * c->srcStride, c->srcStride,
+                         c->dstY + row * c->dstStride, c->width, n);
+        }
+        for ( mmUint32 row = uvStart; row < uvEnd; row++ ) {
+            decimateRowUV(c->srcUV + row * n * c->srcStride, c->srcStride,
+                          c->dstUV + row * c->dstStride, c->width >> 1, n);
+        }
+        return;
+    }
+
+    mmUint16 *tmp = (mmUint16 *) malloc((c->srcSpan + 4) * sizeof(mmUint16));
+    if ( !tmp ) {
+        CAMHAL_LOGE("Out of memory for resize row buffer");
+        return;
+    }
+    resizeRowsY(c, rowStart, rowEnd, tmp);
+    resizeRowsUV(c, uvStart, uvEnd, tmp);
+    free(tmp);
+}
+
+/*
+ * Small pool of resize workers shared by every caller. One resize owns the
+ * pool at a time; a caller that finds it busy just does the work itself.
+ */
+static pthread_once_t gPoolOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t gPoolCallLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gPoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gPoolWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gPoolDone = PTHREAD_COND_INITIALIZER;
+static mmUint32 gPoolThreads = 1;
+static const ResizeContext *gPoolJob = NULL;
+static mmUint32 gPoolSeq = 0;
+static mmUint32 gPoolActive = 0;
+static volatile mmInt32 gPoolNextBand = 0;
+static volatile mmInt32 gPoolBandsDone = 0;
+static mmInt32 gPoolBands = 0;
+
+static void runPoolBands(const ResizeContext *c)
+{
+    mmInt32 band;
+
+    while ( (band = __sync_fetch_and_add(&gPoolNextBand, 1)) < gPoolBands ) {
+        resizeBand(c, band, gPoolBands);
+        __sync_fetch_and_add(&gPoolBandsDone, 1);
+    }
+}
+
+static void *resizeWorker(void *)
+{
+    mmUint32 seen = 0;
+
+    pthread_mutex_lock(&gPoolLock);
+    for ( ;; ) {
+        while ( seen == gPoolSeq ) {
+            pthread_cond_wait(&gPoolWork, &gPoolLock);
+        }
+        seen = gPoolSeq;
+
+        const ResizeContext *job = gPoolJob;
+        if ( !job ) {
+            continue;
+        }
+
+        gPoolActive++;
+        pthread_mutex_unlock(&gPoolLock);
+        runPoolBands(job);
+        pthread_mutex_lock(&gPoolLock);
+        if ( --gPoolActive == 0 ) {
+            pthread_cond_signal(&gPoolDone);
+        }
+    }
+
+    return NULL;
+}
+
+static void initResizePool()
+{
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    mmUint32 threads = cpus > 1 ? (mmUint32) cpus : 1;
+
+    if ( threads > RESIZE_MAX_THREADS ) {
+        threads = RESIZE_MAX_THREADS;
+    }
+
+    gPoolThreads = 1;
+    for ( mmUint32 i = 1; i < threads; i++ ) {
+        pthread_t thread;
+        pthread_attr_t attr;
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if ( pthread_create(&thread, &attr, resizeWorker, NULL) == 0 ) {
+            gPoolThreads++;
+        } else {
+            CAMHAL_LOGE("Unable to start resize worker %u", i);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    CAMHAL_LOGD("NV12 resize using %u threads", gPoolThreads);
+}
+
+static void runResize(const ResizeContext *c)
+{
+    pthread_once(&gPoolOnce, initResizePool);
+
+    if ( gPoolThreads < 2 || c->width * c->height < RESIZE_MIN_PARALLEL_PIXELS ||
+         c->height < 2 * gPoolThreads || pthread_mutex_trylock(&gPoolCallLock) != 0 ) {
+        resizeBand(c, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&gPoolLock);
+    gPoolJob = c;
+    gPoolBands = gPoolThreads;
+    gPoolNextBand = 0;
+    gPoolBandsDone = 0;
+    gPoolSeq++;
+    pthread_cond_broadcast(&gPoolWork);
+    pthread_mutex_unlock(&gPoolLock);
+
+    runPoolBands(c);
+
+    pthread_mutex_lock(&gPoolLock);
+    while ( gPoolActive || gPoolBandsDone < gPoolBands ) {
+        pthread_cond_wait(&gPoolDone, &gPoolLock);
+    }
+    gPoolJob = NULL;
+    pthread_mutex_unlock(&gPoolLock);
+
+    pthread_mutex_unlock(&gPoolCallLock);
+}
+
 /*==========================================================================
 * Function Name  : VT_resizeFrame_Video_opt2_lp
 *
@@ -35,7 +380,8 @@
 * Value Returned : mmBool               -> FALSE on error TRUE on success
 * NOTE:
 *            Not tested for crop funtionallity.
-*            faster version.
+*            The frame is split into row bands that run on a small worker
+*            pool. Exact 2x and 4x downscales take a box filter fast path.
 ============================================================================*/
 mmBool
 VT_resizeFrame_Video_opt2_lp(
@@ -46,41 +392,17 @@ VT_resizeFrame_Video_opt2_lp(
         ) {
     LOG_FUNCTION_NAME;
 
-    mmUint16 row,col;
     mmUint32 resizeFactorX;
     mmUint32 resizeFactorY;
-
-    mmUint16 x, y;
-
-    mmUchar* ptr8;
-    mmUchar *ptr8Cb, *ptr8Cr;
-
-    mmUint16 xf, yf;
-    mmUchar* inImgPtrY;
-    mmUchar* inImgPtrU;
-    mmUchar* inImgPtrV;
     mmUint32 cox, coy, codx, cody;
-    mmUint16 idx,idy, idxC;
-
-    if ( i_img_ptr->uWidth == o_img_ptr->uWidth ) {
-        if ( i_img_ptr->uHeight == o_img_ptr->uHeight ) {
-            CAMHAL_LOGV("************************f(i_img_ptr->uHeight == o_img_ptr->uHeight) are same *********************\n");
-            CAMHAL_LOGV("************************(i_img_ptr->width == %d" , i_img_ptr->uWidth );
-            CAMHAL_LOGV("************************(i_img_ptr->uHeight == %d" , i_img_ptr->uHeight );
-            CAMHAL_LOGV("************************(o_img_ptr->width == %d" ,o_img_ptr->uWidth );
-            CAMHAL_LOGV("************************(o_img_ptr->uHeight == %d" , o_img_ptr->uHeight );
-        }
-    }
+    mmUint32 idx, idy;
+    ResizeContext ctx;
 
     if ( !i_img_ptr || !i_img_ptr->imgPtr || !o_img_ptr || !o_img_ptr->imgPtr ) {
         CAMHAL_LOGE("Image Point NULL");
         return false;
     }
 
-    inImgPtrY = (mmUchar *) i_img_ptr->imgPtr + i_img_ptr->uOffset;
-    inImgPtrU = (mmUchar *) i_img_ptr->clrPtr + i_img_ptr->uOffset/2;
-    inImgPtrV = (mmUchar*)inImgPtrU + 1;
-
     if ( !cropout ) {
         cox = 0;
         coy = 0;
@@ -92,8 +414,8 @@ VT_resizeFrame_Video_opt2_lp(
         codx = cropout->uWidth;
         cody = cropout->uHeight;
     }
-    idx = i_img_ptr->uWidth;
-    idy = i_img_ptr->uHeight;
+    idx = (mmUint16) i_img_ptr->uWidth;
+    idy = (mmUint16) i_img_ptr->uHeight;
 
     /* make sure valid input size */
     if ( idx < 1 || idy < 1 || i_img_ptr->uStride < 1 ) {
@@ -101,8 +423,10 @@ VT_resizeFrame_Video_opt2_lp(
         return false;
     }
 
-    resizeFactorX = ((idx-1)<<9) / codx;
-    resizeFactorY = ((idy-1)<<9) / cody;
+    if ( codx < 1 || cody < 1 ) {
+        CAMHAL_LOGE("Output size less then 1 codx = %d cody = %d", codx, cody);
+        return false;
+    }
 
     if( i_img_ptr->eFormat != IC_FORMAT_YCbCr420_lp ||
             o_img_ptr->eFormat != IC_FORMAT_YCbCr420_lp ) {
@@ -110,180 +434,60 @@ VT_resizeFrame_Video_opt2_lp(
         return false;
     }
 
-    ptr8 = (mmUchar*)o_img_ptr->imgPtr + cox + coy*o_img_ptr->uWidth;
-
-    ////////////////////////////for Y//////////////////////////
-    for ( row = 0; row < cody; row++ ) {
-        mmUchar *pu8Yrow1 = NULL;
-        mmUchar *pu8Yrow2 = NULL;
-        y  = (mmUint16) ((mmUint32) (row*resizeFactorY) >> 9);
-        yf = (mmUchar)  ((mmUint32)((row*resizeFactorY) >> 6) & 0x7);
-        pu8Yrow1 = inImgPtrY + (y) * i_img_ptr->uStride;
-        pu8Yrow2 = pu8Yrow1 + i_img_ptr->uStride;
-
-        for ( col = 0; col < codx; col++ ) {
-            mmUchar in11, in12, in21, in22;
-            mmUchar *pu8ptr1 = NULL;
-            mmUchar *pu8ptr2 = NULL;
-            mmUchar w;
-            mmUint16 accum_1;
-            //mmUint32 accum_W;
-
-            x  = (mmUint16) ((mmUint32)  (col*resizeFactorX) >> 9);
-            xf = (mmUchar)  ((mmUint32) ((col*resizeFactorX) >> 6) & 0x7);
-
-            //accum_W = 0;
-            accum_1 =  0;
-
-            pu8ptr1 = pu8Yrow1 + (x);
-            pu8ptr2 = pu8Yrow2 + (x);
-
-            /* A pixel */
-            //in = *(inImgPtrY + (y)*idx + (x));
-            in11 = *(pu8ptr1);
-
-            w = bWeights[xf][yf][0];
-            accum_1 = (w * in11);
-            //accum_W += (w);
-
-            /* B pixel */
-            //in = *(inImgPtrY + (y)*idx + (x+1));
-            in12 = *(pu8ptr1+1);
-            w = bWeights[xf][yf][1];
-            accum_1 += (w * in12);
-            //accum_W += (w);
-
-            /* C pixel */
-            //in = *(inImgPtrY + (y+1)*idx + (x));
-            in21 = *(pu8ptr2);
-            w = bWeights[xf][yf][3];
-            accum_1 += (w * in21);
-            //accum_W += (w);
-
-            /* D pixel */
-            //in = *(inImgPtrY + (y+1)*idx + (x+1));
-            in22 = *(pu8ptr2+1);
-            w = bWeights[xf][yf][2];
-            accum_1 += (w * in22);
-            //accum_W += (w);
-
-            /* divide by sum of the weights */
-            //accum_1 /= (accum_W);
-            //accum_1 = (accum_1/64);
-            accum_1 = (accum_1>>6);
-            *ptr8 = (mmUchar)accum_1 ;
-
-            ptr8++;
+    resizeFactorX = ((idx-1)<<9) / codx;
+    resizeFactorY = ((idy-1)<<9) / cody;
+
+    ctx.srcY = (mmUchar *) i_img_ptr->imgPtr + i_img_ptr->uOffset;
+    ctx.srcUV = (mmUchar *) i_img_ptr->clrPtr + i_img_ptr->uOffset/2;
+    ctx.srcStride = i_img_ptr->uStride;
+    ctx.dstY = (mmUchar *) o_img_ptr->imgPtr + cox + coy*o_img_ptr->uWidth;
+    ctx.dstUV = (mmUchar *) o_img_ptr->clrPtr + cox + coy*o_img_ptr->uWidth;
+    ctx.dstStride = o_img_ptr->uStride;
+    ctx.width = codx;
+    ctx.height = cody;
+    ctx.resizeFactorY = resizeFactorY;
+    ctx.xTab = NULL;
+    ctx.xfTab = NULL;
+    ctx.srcSpan = 0;
+    ctx.decimate = 0;
+
+    if ( !(codx & 1) && !(cody & 1) ) {
+        if ( idx == 2 * codx && idy == 2 * cody ) {
+            ctx.decimate = 2;
+        } else if ( idx == 4 * codx && idy == 4 * cody ) {
+            ctx.decimate = 4;
         }
-        ptr8 = ptr8 + (o_img_ptr->uStride - codx);
     }
-    ////////////////////////////for Y//////////////////////////
-
-    ///////////////////////////////for Cb-Cr//////////////////////
-
-    ptr8Cb = (mmUchar*)o_img_ptr->clrPtr + cox + coy*o_img_ptr->uWidth;
-
-    ptr8Cr = (mmUchar*)(ptr8Cb+1);
-
-    idxC = (idx>>1);
-    for ( row = 0; row < (((cody)>>1)); row++ ) {
-        mmUchar *pu8Cbr1 = NULL;
-        mmUchar *pu8Cbr2 = NULL;
-        mmUchar *pu8Crr1 = NULL;
-        mmUchar *pu8Crr2 = NULL;
-
-        y  = (mmUint16) ((mmUint32) (row*resizeFactorY) >> 9);
-        yf = (mmUchar)  ((mmUint32)((row*resizeFactorY) >> 6) & 0x7);
-
-        pu8Cbr1 = inImgPtrU + (y) * i_img_ptr->uStride;
-        pu8Cbr2 = pu8Cbr1 + i_img_ptr->uStride;
-        pu8Crr1 = inImgPtrV + (y) * i_img_ptr->uStride;
-        pu8Crr2 = pu8Crr1 + i_img_ptr->uStride;
-
-        for ( col = 0; col < (((codx)>>1)); col++ ) {
-            mmUchar in11, in12, in21, in22;
-            mmUchar *pu8Cbc1 = NULL;
-            mmUchar *pu8Cbc2 = NULL;
-            mmUchar *pu8Crc1 = NULL;
-            mmUchar *pu8Crc2 = NULL;
-
-            mmUchar w;
-            mmUint16 accum_1Cb, accum_1Cr;
-            //mmUint32 accum_WCb, accum_WCr;
-
-            x  = (mmUint16) ((mmUint32)  (col*resizeFactorX) >> 9);
-            xf = (mmUchar)  ((mmUint32) ((col*resizeFactorX) >> 6) & 0x7);
-
-            //accum_WCb = accum_WCr =  0;
-            accum_1Cb = accum_1Cr =  0;
-
-            pu8Cbc1 = pu8Cbr1 + (x*2);
-            pu8Cbc2 = pu8Cbr2 + (x*2);
-            pu8Crc1 = pu8Crr1 + (x*2);
-            pu8Crc2 = pu8Crr2 + (x*2);
-
-            /* A pixel */
-            w = bWeights[xf][yf][0];
 
-            in11 = *(pu8Cbc1);
-            accum_1Cb = (w * in11);
-            //    accum_WCb += (w);
-
-            in11 = *(pu8Crc1);
-            accum_1Cr = (w * in11);
-            //accum_WCr += (w);
-
-            /* B pixel */
-            w = bWeights[xf][yf][1];
-
-            in12 = *(pu8Cbc1+2);
-            accum_1Cb += (w * in12);
-            //accum_WCb += (w);
-
-            in12 = *(pu8Crc1+2);
-            accum_1Cr += (w * in12);
-            //accum_WCr += (w);
-
-            /* C pixel */
-            w = bWeights[xf][yf][3];
-
-            in21 = *(pu8Cbc2);
-            accum_1Cb += (w * in21);
-            //accum_WCb += (w);
-
-            in21 = *(pu8Crc2);
-            accum_1Cr += (w * in21);
-            //accum_WCr += (w);
-
-            /* D pixel */
-            w = bWeights[xf][yf][2];
-
-            in22 = *(pu8Cbc2+2);
-            accum_1Cb += (w * in22);
-            //accum_WCb += (w);
+    if ( ctx.decimate ) {
+        runResize(&ctx);
+        CAMHAL_LOGV("success");
+        return true;
+    }
 
-            in22 = *(pu8Crc2+2);
-            accum_1Cr += (w * in22);
-            //accum_WCr += (w);
+    mmUint16 *xTab = (mmUint16 *) malloc(codx * (sizeof(mmUint16) + sizeof(mmUchar)));
+    if ( !xTab ) {
+        CAMHAL_LOGE("Out of memory for resize tables");
+        return false;
+    }
+    mmUchar *xfTab = (mmUchar *) (xTab + codx);
 
-            /* divide by sum of the weights */
-            //accum_1Cb /= (accum_WCb);
-            accum_1Cb = (accum_1Cb>>6);
-            *ptr8Cb = (mmUchar)accum_1Cb ;
+    for ( mmUint32 col = 0; col < codx; col++ ) {
+        xTab[col] = (mmUint16) ((col*resizeFactorX) >> 9);
+        xfTab[col] = (mmUchar) (((col*resizeFactorX) >> 6) & 0x7);
+    }
 
-            accum_1Cr = (accum_1Cr >> 6);
-            *ptr8Cr = (mmUchar)accum_1Cr ;
+    ctx.xTab = xTab;
+    ctx.xfTab = xfTab;
+    /* the luma filter reads up to x + 1, the chroma one up to 2 * x + 3 */
+    ctx.srcSpan = xTab[codx - 1] + 2;
+    if ( codx > 1 && 2 * xTab[(codx >> 1) - 1] + 4u > ctx.srcSpan ) {
+        ctx.srcSpan = 2 * xTab[(codx >> 1) - 1] + 4;
+    }
 
-            ptr8Cb++;
-            ptr8Cr++;
+    runResize(&ctx);
 
-            ptr8Cb++;
-            ptr8Cr++;
-        }
-        ptr8Cb = ptr8Cb + (o_img_ptr->uStride-codx);
-        ptr8Cr = ptr8Cr + (o_img_ptr->uStride-codx);
-    }
-    ///////////////////For Cb- Cr////////////////////////////////////////
+    free(xTab);
 
     CAMHAL_LOGV("success");
     return true;
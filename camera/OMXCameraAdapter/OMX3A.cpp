@@ -573,6 +573,10 @@ status_t OMXCameraAdapter::setExposureMode(Gen3A_settings& Gen3A)
     exp.nPortIndex = OMX_ALL;
     exp.eExposureControl = (OMX_EXPOSURECONTROLTYPE)Gen3A.Exposure;
 
+    // The exposure mode drives the auto flags in the exposure values,
+    // flush what is batched and read them back after the switch
+    invalidateExposureValues();
+
     eError =  OMX_SetConfig(mCameraAdapterParameters.mHandleComp,
                             OMX_IndexConfigCommonExposure,
                             &exp);
@@ -613,9 +617,7 @@ static bool isFlashDisabled() {
 }
 
 status_t OMXCameraAdapter::setManualExposureVal(Gen3A_settings& Gen3A) {
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_CONFIG_EXPOSUREVALUETYPE expVal;
-    OMX_TI_CONFIG_EXPOSUREVALUERIGHTTYPE expValRight;
+    status_t ret = NO_ERROR;
 
     LOG_FUNCTION_NAME;
 
@@ -624,60 +626,122 @@ status_t OMXCameraAdapter::setManualExposureVal(Gen3A_settings& Gen3A) {
         return NO_INIT;
     }
 
-    OMX_INIT_STRUCT_PTR (&expVal, OMX_CONFIG_EXPOSUREVALUETYPE);
-    OMX_INIT_STRUCT_PTR (&expValRight, OMX_TI_CONFIG_EXPOSUREVALUERIGHTTYPE);
-    expVal.nPortIndex = OMX_ALL;
-    expValRight.nPortIndex = OMX_ALL;
+    android::AutoMutex lock(mExposureValuesLock);
+
+    ret = getExposureValues();
+    if ( NO_ERROR != ret ) {
+        CAMHAL_LOGEB("Error 0x%x while reading manual exposure values", ret);
+        return ret;
+    }
+
+    if ( Gen3A.Exposure != OMX_ExposureControlOff ) {
+        mExposureValues.bAutoShutterSpeed = OMX_TRUE;
+        mExposureValues.bAutoSensitivity = OMX_TRUE;
+    } else {
+        mExposureValues.bAutoShutterSpeed = OMX_FALSE;
+        mExposureValues.nShutterSpeedMsec = Gen3A.ManualExposure;
+        mExposureValuesRight.nShutterSpeedMsec = Gen3A.ManualExposureRight;
+        if ( Gen3A.ManualGain <= 0 || Gen3A.ManualGainRight <= 0 ) {
+            mExposureValues.bAutoSensitivity = OMX_TRUE;
+        } else {
+            mExposureValues.bAutoSensitivity = OMX_FALSE;
+            mExposureValues.nSensitivity = Gen3A.ManualGain;
+            mExposureValuesRight.nSensitivity = Gen3A.ManualGainRight;
+        }
+    }
+
+    mExposureValuesDirty = true;
+    ret = commitExposureValues();
+
+    if ( NO_ERROR != ret ) {
+        CAMHAL_LOGEB("Error 0x%x while configuring manual exposure values", ret);
+    } else {
+        CAMHAL_LOGDA("Camera manual exposure values configured successfully");
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+
+    return ret;
+}
+
+status_t OMXCameraAdapter::getExposureValues()
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+
+    // mExposureValuesLock held by the caller
+    if ( mExposureValuesValid ) {
+        return NO_ERROR;
+    }
+
+    OMX_INIT_STRUCT_PTR (&mExposureValues, OMX_CONFIG_EXPOSUREVALUETYPE);
+    OMX_INIT_STRUCT_PTR (&mExposureValuesRight, OMX_TI_CONFIG_EXPOSUREVALUERIGHTTYPE);
+    mExposureValues.nPortIndex = OMX_ALL;
+    mExposureValuesRight.nPortIndex = OMX_ALL;
 
     eError = OMX_GetConfig(mCameraAdapterParameters.mHandleComp,
                    OMX_IndexConfigCommonExposureValue,
-                   &expVal);
+                   &mExposureValues);
     if ( OMX_ErrorNone == eError ) {
         eError = OMX_GetConfig(mCameraAdapterParameters.mHandleComp,
                        (OMX_INDEXTYPE) OMX_TI_IndexConfigRightExposureValue,
-                       &expValRight);
+                       &mExposureValuesRight);
     }
     if ( OMX_ErrorNone != eError ) {
-        CAMHAL_LOGEB("OMX_GetConfig error 0x%x (manual exposure values)", eError);
+        CAMHAL_LOGEB("OMX_GetConfig error 0x%x (exposure values)", eError);
         return Utils::ErrorUtils::omxToAndroidError(eError);
     }
 
-    if ( Gen3A.Exposure != OMX_ExposureControlOff ) {
-        expVal.bAutoShutterSpeed = OMX_TRUE;
-        expVal.bAutoSensitivity = OMX_TRUE;
-    } else {
-        expVal.bAutoShutterSpeed = OMX_FALSE;
-        expVal.nShutterSpeedMsec = Gen3A.ManualExposure;
-        expValRight.nShutterSpeedMsec = Gen3A.ManualExposureRight;
-        if ( Gen3A.ManualGain <= 0 || Gen3A.ManualGainRight <= 0 ) {
-            expVal.bAutoSensitivity = OMX_TRUE;
-        } else {
-            expVal.bAutoSensitivity = OMX_FALSE;
-            expVal.nSensitivity = Gen3A.ManualGain;
-            expValRight.nSensitivity = Gen3A.ManualGainRight;
-        }
+    mExposureValuesValid = true;
+    mExposureValuesDirty = false;
+
+    return NO_ERROR;
+}
+
+status_t OMXCameraAdapter::commitExposureValues()
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+
+    // mExposureValuesLock held by the caller
+    if ( !mExposureValuesDirty || mExposureValuesBatch ) {
+        return NO_ERROR;
     }
 
     eError = OMX_SetConfig(mCameraAdapterParameters.mHandleComp,
                             OMX_IndexConfigCommonExposureValue,
-                            &expVal);
+                            &mExposureValues);
     if ( OMX_ErrorNone == eError ) {
         eError = OMX_SetConfig(mCameraAdapterParameters.mHandleComp,
                                 (OMX_INDEXTYPE) OMX_TI_IndexConfigRightExposureValue,
-                                &expValRight);
+                                &mExposureValuesRight);
     }
 
+    mExposureValuesDirty = false;
+
+    // Ducati state is unknown after a failed commit, read it back next time
     if ( OMX_ErrorNone != eError ) {
-        CAMHAL_LOGEB("Error 0x%x while configuring manual exposure values", eError);
-    } else {
-        CAMHAL_LOGDA("Camera manual exposure values configured successfully");
+        CAMHAL_LOGEB("OMX_SetConfig error 0x%x (exposure values)", eError);
+        mExposureValuesValid = false;
     }
 
-    LOG_FUNCTION_NAME_EXIT;
-
     return Utils::ErrorUtils::omxToAndroidError(eError);
 }
 
+void OMXCameraAdapter::invalidateExposureValues()
+{
+    android::AutoMutex lock(mExposureValuesLock);
+
+    // Anything still batched has to reach Ducati before the shadow goes
+    if ( mExposureValuesDirty ) {
+        const bool batch = mExposureValuesBatch;
+        mExposureValuesBatch = false;
+        commitExposureValues();
+        mExposureValuesBatch = batch;
+    }
+
+    mExposureValuesValid = false;
+    mExposureValuesDirty = false;
+}
+
 status_t OMXCameraAdapter::setFlashMode(Gen3A_settings& Gen3A)
 {
     status_t ret = NO_ERROR;
@@ -871,6 +935,9 @@ status_t OMXCameraAdapter::setFocusMode(Gen3A_settings& Gen3A)
         focus.nPortIndex = mCameraAdapterParameters.mPrevPortIndex;
         focus.eFocusControl = (OMX_IMAGE_FOCUSCONTROLTYPE)Gen3A.Focus;
 
+        // Status cached in the previous mode no longer applies
+        invalidateFocusStatus();
+
         CAMHAL_LOGDB("Configuring focus mode 0x%x", focus.eFocusControl);
         eError = OMX_SetConfig( mCameraAdapterParameters.mHandleComp, OMX_IndexConfigFocusControl, &focus);
         if ( OMX_ErrorNone != eError )
@@ -945,6 +1012,8 @@ status_t OMXCameraAdapter::setScene(Gen3A_settings& Gen3A)
         CAMHAL_LOGEB("Error while configuring scene mode 0x%x", eError);
     } else {
         CAMHAL_LOGDA("Camera scene configured successfully");
+        // Scene presets rewrite the exposure values on Ducati's side
+        invalidateExposureValues();
         if (Gen3A.SceneMode != OMX_Manual) {
             // Get preset scene mode feedback
             getFocusMode(Gen3A);
@@ -965,8 +1034,7 @@ status_t OMXCameraAdapter::setScene(Gen3A_settings& Gen3A)
 
 status_t OMXCameraAdapter::setEVCompensation(Gen3A_settings& Gen3A)
 {
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_CONFIG_EXPOSUREVALUETYPE expValues;
+    status_t ret = NO_ERROR;
 
     LOG_FUNCTION_NAME;
 
@@ -976,41 +1044,41 @@ status_t OMXCameraAdapter::setEVCompensation(Gen3A_settings& Gen3A)
         return NO_INIT;
         }
 
-    OMX_INIT_STRUCT_PTR (&expValues, OMX_CONFIG_EXPOSUREVALUETYPE);
-    expValues.nPortIndex = mCameraAdapterParameters.mPrevPortIndex;
+    android::AutoMutex lock(mExposureValuesLock);
 
-    OMX_GetConfig( mCameraAdapterParameters.mHandleComp,
-                   OMX_IndexConfigCommonExposureValue,
-                   &expValues);
-    CAMHAL_LOGDB("old EV Compensation for OMX = 0x%x", (int)expValues.xEVCompensation);
+    ret = getExposureValues();
+    if ( NO_ERROR != ret )
+        {
+        return ret;
+        }
+
+    CAMHAL_LOGDB("old EV Compensation for OMX = 0x%x", (int)mExposureValues.xEVCompensation);
     CAMHAL_LOGDB("EV Compensation for HAL = %d", Gen3A.EVCompensation);
 
-    expValues.xEVCompensation = ( Gen3A.EVCompensation * ( 1 << Q16_OFFSET ) )  / 10;
-    eError = OMX_SetConfig( mCameraAdapterParameters.mHandleComp,
-                            OMX_IndexConfigCommonExposureValue,
-                            &expValues);
-    CAMHAL_LOGDB("new EV Compensation for OMX = 0x%x", (int)expValues.xEVCompensation);
-    if ( OMX_ErrorNone != eError )
+    mExposureValues.xEVCompensation = ( Gen3A.EVCompensation * ( 1 << Q16_OFFSET ) )  / 10;
+    mExposureValuesDirty = true;
+    ret = commitExposureValues();
+    CAMHAL_LOGDB("new EV Compensation for OMX = 0x%x", (int)mExposureValues.xEVCompensation);
+    if ( NO_ERROR != ret )
         {
         CAMHAL_LOGEB("Error while configuring EV Compensation 0x%x error = 0x%x",
-                     ( unsigned int ) expValues.xEVCompensation,
-                     eError);
+                     ( unsigned int ) mExposureValues.xEVCompensation,
+                     ret);
         }
     else
         {
         CAMHAL_LOGDB("EV Compensation 0x%x configured successfully",
-                     ( unsigned int ) expValues.xEVCompensation);
+                     ( unsigned int ) mExposureValues.xEVCompensation);
         }
 
     LOG_FUNCTION_NAME_EXIT;
 
-    return Utils::ErrorUtils::omxToAndroidError(eError);
+    return ret;
 }
 
 status_t OMXCameraAdapter::getEVCompensation(Gen3A_settings& Gen3A)
 {
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_CONFIG_EXPOSUREVALUETYPE expValues;
+    status_t ret = NO_ERROR;
 
     LOG_FUNCTION_NAME;
 
@@ -1019,23 +1087,20 @@ status_t OMXCameraAdapter::getEVCompensation(Gen3A_settings& Gen3A)
         return NO_INIT;
     }
 
-    OMX_INIT_STRUCT_PTR (&expValues, OMX_CONFIG_EXPOSUREVALUETYPE);
-    expValues.nPortIndex = mCameraAdapterParameters.mPrevPortIndex;
+    android::AutoMutex lock(mExposureValuesLock);
 
-    OMX_GetConfig(mCameraAdapterParameters.mHandleComp,
-                  OMX_IndexConfigCommonExposureValue,
-                  &expValues);
+    ret = getExposureValues();
 
-    if ( OMX_ErrorNone != eError ) {
-        CAMHAL_LOGEB("Error while getting EV Compensation error = 0x%x", eError);
+    if ( NO_ERROR != ret ) {
+        CAMHAL_LOGEB("Error while getting EV Compensation error = 0x%x", ret);
     } else {
-        Gen3A.EVCompensation = (10 * expValues.xEVCompensation) / (1 << Q16_OFFSET);
+        Gen3A.EVCompensation = (10 * mExposureValues.xEVCompensation) / (1 << Q16_OFFSET);
         CAMHAL_LOGDB("Gen3A.EVCompensation 0x%x", Gen3A.EVCompensation);
     }
 
     LOG_FUNCTION_NAME_EXIT;
 
-    return Utils::ErrorUtils::omxToAndroidError(eError);
+    return ret;
 }
 
 status_t OMXCameraAdapter::setWBMode(Gen3A_settings& Gen3A)
@@ -1368,9 +1433,7 @@ status_t OMXCameraAdapter::getSaturation(Gen3A_settings& Gen3A)
 
 status_t OMXCameraAdapter::setISO(Gen3A_settings& Gen3A)
 {
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_CONFIG_EXPOSUREVALUETYPE expValues;
-    OMX_TI_CONFIG_EXPOSUREVALUERIGHTTYPE expValRight;
+    status_t ret = NO_ERROR;
 
     LOG_FUNCTION_NAME;
 
@@ -1385,55 +1448,37 @@ status_t OMXCameraAdapter::setISO(Gen3A_settings& Gen3A)
         return NO_ERROR;
     }
 
-    OMX_INIT_STRUCT_PTR (&expValues, OMX_CONFIG_EXPOSUREVALUETYPE);
-    OMX_INIT_STRUCT_PTR (&expValRight, OMX_TI_CONFIG_EXPOSUREVALUERIGHTTYPE);
-    expValues.nPortIndex = mCameraAdapterParameters.mPrevPortIndex;
-    expValRight.nPortIndex = mCameraAdapterParameters.mPrevPortIndex;
-
-    eError = OMX_GetConfig( mCameraAdapterParameters.mHandleComp,
-                    OMX_IndexConfigCommonExposureValue,
-                    &expValues);
+    android::AutoMutex lock(mExposureValuesLock);
 
-    if ( OMX_ErrorNone == eError ) {
-        eError = OMX_GetConfig(mCameraAdapterParameters.mHandleComp,
-                        (OMX_INDEXTYPE) OMX_TI_IndexConfigRightExposureValue,
-                        &expValRight);
-    }
-
-    if ( OMX_ErrorNone != eError ) {
-        CAMHAL_LOGEB("OMX_GetConfig error 0x%x (manual exposure values)", eError);
-        return Utils::ErrorUtils::omxToAndroidError(eError);
+    ret = getExposureValues();
+    if ( NO_ERROR != ret ) {
+        CAMHAL_LOGEB("Error 0x%x while reading exposure values", ret);
+        return ret;
     }
 
     if( 0 == Gen3A.ISO ) {
-        expValues.bAutoSensitivity = OMX_TRUE;
+        mExposureValues.bAutoSensitivity = OMX_TRUE;
     } else {
-        expValues.bAutoSensitivity = OMX_FALSE;
-        expValues.nSensitivity = Gen3A.ISO;
-        expValRight.nSensitivity = expValues.nSensitivity;
+        mExposureValues.bAutoSensitivity = OMX_FALSE;
+        mExposureValues.nSensitivity = Gen3A.ISO;
+        mExposureValuesRight.nSensitivity = mExposureValues.nSensitivity;
     }
 
-    eError = OMX_SetConfig( mCameraAdapterParameters.mHandleComp,
-                            OMX_IndexConfigCommonExposureValue,
-                            &expValues);
+    mExposureValuesDirty = true;
+    ret = commitExposureValues();
 
-    if ( OMX_ErrorNone == eError ) {
-        eError = OMX_SetConfig(mCameraAdapterParameters.mHandleComp,
-                            (OMX_INDEXTYPE) OMX_TI_IndexConfigRightExposureValue,
-                            &expValRight);
-    }
-    if ( OMX_ErrorNone != eError ) {
+    if ( NO_ERROR != ret ) {
         CAMHAL_LOGEB("Error while configuring ISO 0x%x error = 0x%x",
-                     ( unsigned int ) expValues.nSensitivity,
-                     eError);
+                     ( unsigned int ) mExposureValues.nSensitivity,
+                     ret);
     } else {
         CAMHAL_LOGDB("ISO 0x%x configured successfully",
-                     ( unsigned int ) expValues.nSensitivity);
+                     ( unsigned int ) mExposureValues.nSensitivity);
     }
 
     LOG_FUNCTION_NAME_EXIT;
 
-    return Utils::ErrorUtils::omxToAndroidError(eError);
+    return ret;
 }
 
 status_t OMXCameraAdapter::getISO(Gen3A_settings& Gen3A)
@@ -1448,10 +1493,11 @@ status_t OMXCameraAdapter::getISO(Gen3A_settings& Gen3A)
         return NO_INIT;
     }
 
+    // Auto ISO moves on its own, so this one is always read from Ducati
     OMX_INIT_STRUCT_PTR (&expValues, OMX_CONFIG_EXPOSUREVALUETYPE);
     expValues.nPortIndex = mCameraAdapterParameters.mPrevPortIndex;
 
-    OMX_GetConfig( mCameraAdapterParameters.mHandleComp,
+    eError = OMX_GetConfig( mCameraAdapterParameters.mHandleComp,
                    OMX_IndexConfigCommonExposureValue,
                    &expValues);
 
@@ -1976,6 +2022,11 @@ status_t OMXCameraAdapter::apply3Asettings( Gen3A_settings& Gen3A )
 
     android::AutoMutex lock(m3ASettingsUpdateLock);
 
+    {
+        android::AutoMutex expLock(mExposureValuesLock);
+        mExposureValuesBatch = true;
+    }
+
     /*
      * Scenes have a priority during the process
      * of applying 3A related parameters.
@@ -1992,12 +2043,12 @@ status_t OMXCameraAdapter::apply3Asettings( Gen3A_settings& Gen3A )
         if(Gen3A.EVCompensation) {
             setEVCompensation(Gen3A);
         }
-        return ret;
+        return ret | endExposureBatch();
     } else if (OMX_Manual != Gen3A.SceneMode) {
         // only certain settings are allowed when scene mode is set
         mPending3Asettings &= (SetEVCompensation | SetFocus | SetWBLock |
                                SetExpLock | SetWhiteBallance | SetFlash);
-        if ( mPending3Asettings == 0 ) return NO_ERROR;
+        if ( mPending3Asettings == 0 ) return endExposureBatch();
     }
 
     for( currSett = 1; currSett < E3aSettingMax; currSett <<= 1)
@@ -2155,10 +2206,23 @@ status_t OMXCameraAdapter::apply3Asettings( Gen3A_settings& Gen3A )
             }
         }
 
+        // EV compensation, ISO and manual exposure share one config,
+        // it goes to Ducati once for all of them
+        ret |= endExposureBatch();
+
         LOG_FUNCTION_NAME_EXIT;
 
         return ret;
 }
 
+status_t OMXCameraAdapter::endExposureBatch()
+{
+    android::AutoMutex lock(mExposureValuesLock);
+
+    mExposureValuesBatch = false;
+
+    return commitExposureValues();
+}
+
 } // namespace Camera
 } // namespace Ti
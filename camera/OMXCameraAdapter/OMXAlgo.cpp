@@ -220,7 +220,7 @@ status_t OMXCameraAdapter::setParametersAlgo(const android::CameraParameters &pa
         }
 
     //A work-around for a failing call to OMX flush buffers
-    if ( ( capMode = OMXCameraAdapter::VIDEO_MODE ) &&
+    if ( ( mCapMode == OMXCameraAdapter::VIDEO_MODE ) &&
          ( mVstabEnabled ) )
         {
         mOMXStateSwitch = true;
@@ -260,6 +260,74 @@ status_t OMXCameraAdapter::setParametersAlgo(const android::CameraParameters &pa
     return ret;
 }
 
+/*
+ * Applies everything setParametersAlgo() left in mPendingPreviewSettings
+ * while the component is in Loaded, so a profile switch (say photo to
+ * video, which changes the capture mode, IPP, VNF and VSTAB at once) costs
+ * the single switchToLoaded() requested through mOMXStateSwitch. Capture
+ * mode goes after LDC/NSF, whose IPP setup it relies on, and VNF/VSTAB
+ * stay pending until a video mode is selected. Only an LDC or NSF failure
+ * is returned, the rest are logged.
+ */
+status_t OMXCameraAdapter::applyPendingPreviewSettings()
+{
+    status_t ret = NO_ERROR;
+    status_t err = NO_ERROR;
+
+    LOG_FUNCTION_NAME;
+
+    if (mPendingPreviewSettings & SetLDC) {
+        mPendingPreviewSettings &= ~SetLDC;
+        err = setLDC(mIPP);
+        if ( NO_ERROR != err ) {
+            CAMHAL_LOGEB("setLDC() failed %d", err);
+            ret = err;
+        }
+    }
+
+    if (mPendingPreviewSettings & SetNSF) {
+        mPendingPreviewSettings &= ~SetNSF;
+        err = setNSF(mIPP);
+        if ( NO_ERROR != err ) {
+            CAMHAL_LOGEB("setNSF() failed %d", err);
+            ret = err;
+        }
+    }
+
+    if (mPendingPreviewSettings & SetCapMode) {
+        mPendingPreviewSettings &= ~SetCapMode;
+        err = setCaptureMode(mCapMode);
+        if ( NO_ERROR != err ) {
+            CAMHAL_LOGEB("setCaptureMode() failed %d", err);
+        }
+    }
+
+    if( (mCapMode == OMXCameraAdapter::VIDEO_MODE) ||
+        (mCapMode == OMXCameraAdapter::VIDEO_MODE_HQ) ) {
+
+        if (mPendingPreviewSettings & SetVNF) {
+            mPendingPreviewSettings &= ~SetVNF;
+            err = enableVideoNoiseFilter(mVnfEnabled);
+            if ( NO_ERROR != err){
+                CAMHAL_LOGEB("Error configuring VNF %x", err);
+            }
+        }
+
+        if (mPendingPreviewSettings & SetVSTAB) {
+            mPendingPreviewSettings &= ~SetVSTAB;
+            err = enableVideoStabilization(mVstabEnabled);
+            if ( NO_ERROR != err) {
+                CAMHAL_LOGEB("Error configuring VSTAB %x", err);
+            }
+        }
+
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+
+    return ret;
+}
+
 // Set AutoConvergence
 status_t OMXCameraAdapter::setAutoConvergence(const char *pValstr, const char *pValManualstr, const android::CameraParameters &params)
 {
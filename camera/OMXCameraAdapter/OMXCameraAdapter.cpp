@@ -27,6 +27,8 @@
 #include "TICameraParameters.h"
 #include <signal.h>
 #include <math.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include <cutils/properties.h>
 #define UNLIKELY( exp ) (__builtin_expect( (exp) != 0, false ))
@@ -47,6 +49,14 @@ const char OMXCameraAdapter::DEFAULT_PROFILE_PATH[] = "/data/dbg/profile_data.bi
 //frames skipped before recalculating the framerate
 #define FPS_PERIOD 30
 
+//Preview FillThisBuffer batching is enabled from this max frame rate on
+const int OMXCameraAdapter::PREVIEW_FILL_BATCH_MIN_FPS = 60;
+const int OMXCameraAdapter::PREVIEW_FILL_BATCH_DEFAULT = 2;
+//Buffers always left queued with Ducati while a batch is collected
+const uint32_t OMXCameraAdapter::PREVIEW_FILL_MIN_QUEUED = 3;
+//Longest a returned preview buffer is held back, one 120fps frame
+const nsecs_t OMXCameraAdapter::PREVIEW_FILL_MAX_LATENCY = 8000000LL;
+
 android::Mutex gAdapterLock;
 /*--------------------Camera Adapter Class STARTS here-----------------------------*/
 
@@ -61,6 +71,10 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     mDebugFps = atoi(value);
     property_get("debug.camera.framecounts", value, "0");
     mDebugFcs = atoi(value);
+    property_get("debug.camera.zoom_crop", value, "1");
+    mSmoothZoomCrop = ( 0 != atoi(value) );
+    property_get("debug.camera.concurrent_capture", value, "1");
+    mConcurrentCapture = ( 0 != atoi(value) );
 
 #ifdef CAMERAHAL_OMX_PROFILING
 
@@ -79,6 +93,7 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     mLocalVersionParam.s.nStep =  0x0;
 
     mPending3Asettings = 0;//E3AsettingsAll;
+    mFocusStatusValid = false;
     mPendingCaptureSettings = 0;
     mPendingPreviewSettings = 0;
     mPendingReprocessSettings = 0;
@@ -200,6 +215,8 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     mBracketingRange = 1;
     mLastBracetingBufferIdx = 0;
     mBracketingBuffersQueued = NULL;
+    mBracketingBuffersTimestamp = NULL;
+    mZslRingFrames = 0;
     mOMXStateSwitch = false;
     mBracketingSet = false;
 #ifdef CAMERAHAL_USE_RAW_IMAGE_SAVING
@@ -210,6 +227,7 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     mCaptureSignalled = false;
     mCaptureConfigured = false;
     mReprocConfigured = false;
+    mReprocNumBufs = 0;
     mRecording = false;
     mWaitingForSnapshot = false;
     mPictureFormatFromClient = NULL;
@@ -243,6 +261,9 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     mCapabilities = caps;
     mZoomUpdating = false;
     mZoomUpdate = false;
+    mDisplayZoom = 0;
+    mPendingPreviewFillTime = 0;
+    mPreviewFillBatch = 1;
     mGBCE = BRIGHTNESS_OFF;
     mGLBCE = BRIGHTNESS_OFF;
     mParameters3A.ExposureLock = OMX_FALSE;
@@ -271,6 +292,17 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     CAMHAL_ASSERT(mountOrientationString);
     mDeviceOrientation = atoi(mountOrientationString);
     mFaceOrientation = atoi(mountOrientationString);
+    mMountOrientation = mDeviceOrientation;
+    android_atomic_release_store(mDeviceOrientation, &mPendingDeviceOrientation);
+
+    // direction is a constant sign for facing, meaning the rotation direction relative to device
+    // +1 (clockwise) for back sensor and -1 (counter-clockwise) for front sensor
+    {
+        const char * const facingString = mCapabilities->get(CameraProperties::FACING_INDEX);
+        const bool isFront = facingString &&
+                ( 0 == strcmp(facingString, TICameraParameters::FACING_FRONT) );
+        mMountDirection = isFront ? -1 : 1;
+    }
 
     if (mSensorIndex != 2) {
         mCapabilities->setMode(MODE_HIGH_SPEED);
@@ -334,6 +366,8 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     //Setting this flag will that the first setParameter call will apply all 3A settings
     //and will not conditionally apply based on current values.
     mFirstTimeInit = true;
+    mExposureValuesBatch = false;
+    invalidateExposureValues();
 
     //Flag to avoid calling setVFramerate() before OMX_SetParameter(OMX_IndexParamPortDefinition)
     //Ducati will return an error otherwise.
@@ -345,6 +379,9 @@ status_t OMXCameraAdapter::initialize(CameraProperties::Properties* caps)
     mFaceDetectionRunning = false;
     mFaceDetectionPaused = false;
     mFDSwitchAlgoPriority = false;
+    mFaceDetectionRate = 0;
+    mFaceDetectionSmoothing = 0;
+    mFaceDetectionLastTime = 0;
 
     metadataLastAnalogGain = -1;
     metadataLastExposureTime = -1;
@@ -496,13 +533,22 @@ status_t OMXCameraAdapter::fillThisBuffer(CameraBuffer * frameBuf, CameraFrame::
                     mBurstFramesQueued++;
                 }
                 port->mStatus[i] = OMXCameraPortParameters::FILL;
-                eError = OMX_FillThisBuffer(mCameraAdapterParameters.mHandleComp, port->mBufferHeader[i]);
+                if ( ( 1 < mPreviewFillBatch ) &&
+                     ( port == &mCameraAdapterParameters.mCameraPortParams[mCameraAdapterParameters.mPrevPortIndex] ) ) {
+                    eError = queuePreviewFill(port, i);
+                } else {
+                    eError = OMX_FillThisBuffer(mCameraAdapterParameters.mHandleComp, port->mBufferHeader[i]);
+                    if ( eError == OMX_ErrorNone ) {
+                        mFramesWithDucati++;
+                    } else {
+                        port->mStatus[i] = OMXCameraPortParameters::IDLE;
+                    }
+                }
                 if ( eError != OMX_ErrorNone )
                 {
                     CAMHAL_LOGEB("OMX_FillThisBuffer 0x%x", eError);
                     goto EXIT;
                 }
-                mFramesWithDucati++;
                 break;
            }
        }
@@ -520,6 +566,65 @@ EXIT:
     return (ret | Utils::ErrorUtils::omxToAndroidError(eError));
 }
 
+OMX_ERRORTYPE OMXCameraAdapter::queuePreviewFill(OMXCameraPortParameters *port, int index)
+{
+    android::AutoMutex lock(mPreviewFillLock);
+
+    if ( mPendingPreviewFills.isEmpty() ) {
+        mPendingPreviewFillTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+    mPendingPreviewFills.add(index);
+
+    // Never let Ducati run dry while waiting for the batch to fill up
+    if ( ( mPendingPreviewFills.size() >= (size_t) mPreviewFillBatch ) ||
+         ( mFramesWithDucati < PREVIEW_FILL_MIN_QUEUED ) ) {
+        return submitPreviewFills(port);
+    }
+
+    return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE OMXCameraAdapter::flushPreviewFills(bool force)
+{
+    android::AutoMutex lock(mPreviewFillLock);
+
+    if ( mPendingPreviewFills.isEmpty() ) {
+        return OMX_ErrorNone;
+    }
+
+    if ( force ||
+         ( mFramesWithDucati < PREVIEW_FILL_MIN_QUEUED ) ||
+         ( ( systemTime(SYSTEM_TIME_MONOTONIC) - mPendingPreviewFillTime ) >= PREVIEW_FILL_MAX_LATENCY ) ) {
+        return submitPreviewFills(&mCameraAdapterParameters.mCameraPortParams[mCameraAdapterParameters.mPrevPortIndex]);
+    }
+
+    return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE OMXCameraAdapter::submitPreviewFills(OMXCameraPortParameters *port)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+
+    // Called with mPreviewFillLock held
+    for ( size_t i = 0 ; i < mPendingPreviewFills.size() ; i++ ) {
+        eError = OMX_FillThisBuffer(mCameraAdapterParameters.mHandleComp,
+                                    port->mBufferHeader[mPendingPreviewFills[i]]);
+        if ( OMX_ErrorNone != eError ) {
+            // Whatever did not reach Ducati is not in FILL state
+            for ( ; i < mPendingPreviewFills.size() ; i++ ) {
+                port->mStatus[mPendingPreviewFills[i]] = OMXCameraPortParameters::IDLE;
+            }
+            break;
+        }
+        mFramesWithDucati++;
+    }
+
+    CAMHAL_LOGVB("Submitted %d preview buffers", mPendingPreviewFills.size());
+    mPendingPreviewFills.clear();
+
+    return eError;
+}
+
 void OMXCameraAdapter::setParamS3D(OMX_U32 port, const char *valstr)
 {
     OMXCameraPortParameters *cap;
@@ -572,6 +677,16 @@ status_t OMXCameraAdapter::setParameters(const android::CameraParameters &params
     BaseCameraAdapter::AdapterState state;
     BaseCameraAdapter::getState(state);
 
+    // Applications re-sending an unchanged parameter set (e.g. per-frame
+    // zoom or torch updates that end up at the same value) would otherwise
+    // go through every LUT lookup and settings module below.
+    android::String8 flattened = params.flatten();
+    if ( !mFirstTimeInit && ( state == mParamsState ) && ( flattened == mParamsFlattened ) ) {
+        CAMHAL_LOGVA("Parameters unchanged, nothing to apply");
+        LOG_FUNCTION_NAME_EXIT;
+        return NO_ERROR;
+    }
+
     ///@todo Include more camera parameters
     if ( (valstr = params.getPreviewFormat()) != NULL ) {
         if(strcmp(valstr, android::CameraParameters::PIXEL_FORMAT_YUV420SP) == 0 ||
@@ -697,6 +812,13 @@ status_t OMXCameraAdapter::setParameters(const android::CameraParameters &params
     mParams = params;
     mFirstTimeInit = false;
 
+    if ( NO_ERROR == ret ) {
+        mParamsFlattened = flattened;
+        mParamsState = state;
+    } else {
+        mParamsFlattened.clear();
+    }
+
     if ( MODE_MAX != mCapabilitiesOpMode ) {
         mCapabilities->setMode(mCapabilitiesOpMode);
     }
@@ -1950,51 +2072,7 @@ status_t OMXCameraAdapter::UseBuffersPreview(CameraBuffer * bufArr, int num)
     mStateSwitchLock.lock();
 
     if ( mComponentState == OMX_StateLoaded ) {
-
-        if (mPendingPreviewSettings & SetLDC) {
-            mPendingPreviewSettings &= ~SetLDC;
-            ret = setLDC(mIPP);
-            if ( NO_ERROR != ret ) {
-                CAMHAL_LOGEB("setLDC() failed %d", ret);
-            }
-        }
-
-        if (mPendingPreviewSettings & SetNSF) {
-            mPendingPreviewSettings &= ~SetNSF;
-            ret = setNSF(mIPP);
-            if ( NO_ERROR != ret ) {
-                CAMHAL_LOGEB("setNSF() failed %d", ret);
-            }
-        }
-
-        if (mPendingPreviewSettings & SetCapMode) {
-            mPendingPreviewSettings &= ~SetCapMode;
-            ret = setCaptureMode(mCapMode);
-            if ( NO_ERROR != ret ) {
-                CAMHAL_LOGEB("setCaptureMode() failed %d", ret);
-            }
-        }
-
-        if( (mCapMode == OMXCameraAdapter::VIDEO_MODE) ||
-            (mCapMode == OMXCameraAdapter::VIDEO_MODE_HQ) ) {
-
-            if (mPendingPreviewSettings & SetVNF) {
-                mPendingPreviewSettings &= ~SetVNF;
-                ret = enableVideoNoiseFilter(mVnfEnabled);
-                if ( NO_ERROR != ret){
-                    CAMHAL_LOGEB("Error configuring VNF %x", ret);
-                }
-            }
-
-            if (mPendingPreviewSettings & SetVSTAB) {
-                mPendingPreviewSettings &= ~SetVSTAB;
-                ret = enableVideoStabilization(mVstabEnabled);
-                if ( NO_ERROR != ret) {
-                    CAMHAL_LOGEB("Error configuring VSTAB %x", ret);
-                }
-            }
-
-        }
+        applyPendingPreviewSettings();
     }
 
     ret = setSensorOrientation(mSensorOrientation);
@@ -2276,6 +2354,25 @@ status_t OMXCameraAdapter::startPreview()
 
     mStateSwitchLock.unlock();
 
+    {
+        // Coalesce returned preview buffers at high frame rates, see
+        // queuePreviewFill(). 0 picks the default, 1 disables batching.
+        char value[PROPERTY_VALUE_MAX];
+        int batch;
+
+        property_get("debug.camera.ftb_batch", value, "0");
+        batch = atoi(value);
+        if ( 0 >= batch ) {
+            batch = ( PREVIEW_FILL_BATCH_MIN_FPS <= (int) mPreviewData->mMaxFrameRate ) ?
+                    PREVIEW_FILL_BATCH_DEFAULT : 1;
+        }
+
+        android::AutoMutex lock(mPreviewFillLock);
+        mPendingPreviewFills.clear();
+        mPreviewFillBatch = batch;
+        CAMHAL_LOGDB("Preview FillThisBuffer batch %d", mPreviewFillBatch);
+    }
+
     //Queue all the buffers on preview port
     for(int index=0;index< mPreviewData->mMaxQueueable;index++)
         {
@@ -2484,15 +2581,31 @@ status_t OMXCameraAdapter::stopPreview() {
 
     mTunnelDestroyed = false;
 
+    {
+        // Buffers still held back belong to the port being torn down
+        OMXCameraPortParameters *previewData =
+            &mCameraAdapterParameters.mCameraPortParams[mCameraAdapterParameters.mPrevPortIndex];
+        android::AutoMutex lock(mPreviewFillLock);
+        for ( size_t i = 0 ; i < mPendingPreviewFills.size() ; i++ ) {
+            previewData->mStatus[mPendingPreviewFills[i]] = OMXCameraPortParameters::IDLE;
+        }
+        mPendingPreviewFills.clear();
+        mPreviewFillBatch = 1;
+    }
+
     {
         android::AutoMutex lock(mPreviewBufferLock);
         ///Clear all the available preview buffers
         mPreviewBuffersAvailable.clear();
     }
 
+    // The reprocess port is kept enabled between captures
+    stopReprocess();
+
     switchToLoaded();
 
     mFirstTimeInit = true;
+    invalidateExposureValues();
     mPendingCaptureSettings = 0;
     mPendingReprocessSettings = 0;
     mFramesWithDucati = 0;
@@ -2801,56 +2914,13 @@ status_t OMXCameraAdapter::getFrameSize(size_t &width, size_t &height)
 
     if ( OMX_StateLoaded == mComponentState )
         {
-
-        if (mPendingPreviewSettings & SetLDC) {
-            mPendingPreviewSettings &= ~SetLDC;
-            ret = setLDC(mIPP);
-            if ( NO_ERROR != ret ) {
-                CAMHAL_LOGEB("setLDC() failed %d", ret);
-                LOG_FUNCTION_NAME_EXIT;
-                goto exit;
-            }
-        }
-
-        if (mPendingPreviewSettings & SetNSF) {
-            mPendingPreviewSettings &= ~SetNSF;
-            ret = setNSF(mIPP);
-            if ( NO_ERROR != ret ) {
-                CAMHAL_LOGEB("setNSF() failed %d", ret);
-                LOG_FUNCTION_NAME_EXIT;
-                goto exit;
-            }
-        }
-
-        if (mPendingPreviewSettings & SetCapMode) {
-            mPendingPreviewSettings &= ~SetCapMode;
-            ret = setCaptureMode(mCapMode);
-            if ( NO_ERROR != ret ) {
-                CAMHAL_LOGEB("setCaptureMode() failed %d", ret);
-            }
-        }
-
-        if((mCapMode == OMXCameraAdapter::VIDEO_MODE) ||
-           (mCapMode == OMXCameraAdapter::VIDEO_MODE_HQ) ) {
-
-            if (mPendingPreviewSettings & SetVNF) {
-                mPendingPreviewSettings &= ~SetVNF;
-                ret = enableVideoNoiseFilter(mVnfEnabled);
-                if ( NO_ERROR != ret){
-                    CAMHAL_LOGEB("Error configuring VNF %x", ret);
-                }
-            }
-
-            if (mPendingPreviewSettings & SetVSTAB) {
-                mPendingPreviewSettings &= ~SetVSTAB;
-                ret = enableVideoStabilization(mVstabEnabled);
-                if ( NO_ERROR != ret) {
-                    CAMHAL_LOGEB("Error configuring VSTAB %x", ret);
-                }
+        ret = applyPendingPreviewSettings();
+        if ( NO_ERROR != ret )
+            {
+            LOG_FUNCTION_NAME_EXIT;
+            goto exit;
             }
-
         }
-    }
 
     ret = setSensorOrientation(mSensorOrientation);
     if ( NO_ERROR != ret )
@@ -2952,40 +3022,32 @@ void OMXCameraAdapter::onOrientationEvent(uint32_t orientation, uint32_t tilt)
         return;
     }
 
-    int mountOrientation = 0;
-    bool isFront = false;
-    if (mCapabilities) {
-        const char * const mountOrientationString =
-                mCapabilities->get(CameraProperties::ORIENTATION_INDEX);
-        if (mountOrientationString) {
-            mountOrientation = atoi(mountOrientationString);
-        }
-
-        const char * const facingString = mCapabilities->get(CameraProperties::FACING_INDEX);
-        if (facingString) {
-            isFront = strcmp(facingString, TICameraParameters::FACING_FRONT) == 0;
-        }
-    }
-
-    // direction is a constant sign for facing, meaning the rotation direction relative to device
-    // +1 (clockwise) for back sensor and -1 (counter-clockwise) for front sensor
-    const int direction = isFront ? -1 : 1;
-
-    int rotation = mountOrientation + direction*orientation;
+    int rotation = mMountOrientation + mMountDirection*orientation;
 
     // crop the calculated value to [0..360) range
     while ( rotation < 0 ) rotation += 360;
     rotation %= 360;
 
+    // Runs on the sensor thread: only publish the latest value, the
+    // preview path picks it up on its next frame. Bursts of events
+    // just overwrite each other and never take adapter locks.
+    android_atomic_release_store(rotation, &mPendingDeviceOrientation);
+
+    CAMHAL_LOGVB("orientation = %d tilt = %d pending device_orientation = %d", orientation, tilt, rotation);
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+void OMXCameraAdapter::applyPendingOrientation()
+{
+    const int rotation = android_atomic_acquire_load(&mPendingDeviceOrientation);
+
     if (rotation != mDeviceOrientation) {
         mDeviceOrientation = rotation;
 
         // restart face detection with new rotation
         setFaceDetectionOrientation(mDeviceOrientation);
     }
-    CAMHAL_LOGVB("orientation = %d tilt = %d device_orientation = %d", orientation, tilt, mDeviceOrientation);
-
-    LOG_FUNCTION_NAME_EXIT;
 }
 
 /* Application callback Functions */
@@ -3180,7 +3242,8 @@ OMX_ERRORTYPE OMXCameraAdapter::SignalEvent(OMX_IN OMX_HANDLETYPE hComponent,
                 msg.command = OMXCallbackHandler::CAMERA_FOCUS_STATUS;
                 msg.arg1 = NULL;
                 msg.arg2 = NULL;
-                mOMXCallbackHandler->put(&msg);
+                // Don't let focus status wait behind queued frames
+                mOMXCallbackHandler->put(&msg, Utils::MessageQueue::PRIORITY_HIGH);
         }
     }
 
@@ -3414,6 +3477,7 @@ status_t OMXCameraAdapter::storeProfilingData(OMX_BUFFERHEADERTYPE* pBuffHeader)
 OMX_ERRORTYPE OMXCameraAdapter::OMXCameraAdapterFillBufferDone(OMX_IN OMX_HANDLETYPE hComponent,
                                    OMX_IN OMX_BUFFERHEADERTYPE* pBuffHeader)
 {
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_ADAPTER);
 
     status_t  stat = NO_ERROR;
     status_t  res1, res2;
@@ -3435,6 +3499,8 @@ OMX_ERRORTYPE OMXCameraAdapter::OMXCameraAdapterFillBufferDone(OMX_IN OMX_HANDLE
         return OMX_ErrorBadParameter;
     }
 
+    cameraFrame.mFillTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
 #ifdef CAMERAHAL_OMX_PROFILING
 
     storeProfilingData(pBuffHeader);
@@ -3465,6 +3531,8 @@ OMX_ERRORTYPE OMXCameraAdapter::OMXCameraAdapterFillBufferDone(OMX_IN OMX_HANDLE
             return OMX_ErrorNone;
             }
 
+        camera_buffer_trace((CameraBuffer *) pBuffHeader->pAppPrivate, FRAME_TRACE_CAM_FILL);
+
         if ( mWaitingForSnapshot ) {
             extraData = getExtradata(pBuffHeader->pPlatformPrivate,
                                      (OMX_EXTRADATATYPE) OMX_AncillaryData);
@@ -3531,6 +3599,12 @@ OMX_ERRORTYPE OMXCameraAdapter::OMXCameraAdapterFillBufferDone(OMX_IN OMX_HANDLE
         mFramesWithDisplay++;
 
         mFramesWithDucati--;
+        if ( 0 == mFramesWithDucati ) {
+            CameraPerfCounters::event(CameraPerfCounters::EVENT_CAMERA_STARVED);
+        }
+
+        // Bounds how long a returned buffer waits for its batch
+        flushPreviewFills(false);
 
 #ifdef CAMERAHAL_DEBUG
         {
@@ -3575,6 +3649,8 @@ OMX_ERRORTYPE OMXCameraAdapter::OMXCameraAdapterFillBufferDone(OMX_IN OMX_HANDLE
 
         stat |= advanceZoom();
 
+        applyPendingOrientation();
+
         // On the fly update to 3A settings not working
         // Do not update 3A here if we are in the middle of a capture
         // or in the middle of transitioning to it
@@ -3664,7 +3740,7 @@ OMX_ERRORTYPE OMXCameraAdapter::OMXCameraAdapterFillBufferDone(OMX_IN OMX_HANDLE
 
 #ifdef OMAP_ENHANCEMENT_CPCAM
         if ( NULL != mSharedAllocator ) {
-            cameraFrame.mMetaData = new CameraMetadataResult(getMetaData(pBuffHeader->pPlatformPrivate, mSharedAllocator));
+            cameraFrame.mMetaData = getMetaData(pBuffHeader->pPlatformPrivate, mSharedAllocator);
         }
 #endif
 
@@ -3859,6 +3935,7 @@ status_t OMXCameraAdapter::sendCallBacks(CameraFrame frame, OMX_IN OMX_BUFFERHEA
   frame.mHeight = port->mHeight;
   frame.mYuv[0] = NULL;
   frame.mYuv[1] = NULL;
+  frame.mDisplayZoom = ( mask & CameraFrame::PREVIEW_FRAME_SYNC ) ? mDisplayZoom : 0;
 
   if ( onlyOnce && mRecording )
     {
@@ -4128,6 +4205,9 @@ OMXCameraAdapter::OMXCameraAdapter(size_t sensor_index)
     mComponentState = OMX_StateInvalid;
     mSensorIndex = sensor_index;
     mPictureRotation = 0;
+    mPendingDeviceOrientation = 0;
+    mMountOrientation = 0;
+    mMountDirection = 1;
     // Initial values
     mTimeSourceDelta = 0;
     onlyOnce = true;
@@ -4159,6 +4239,8 @@ OMXCameraAdapter::OMXCameraAdapter(size_t sensor_index)
     mFramesWithDisplay = 0;
     mFramesWithEncoder = 0;
 
+    mEXIFSharedBuffer = NULL;
+
 #ifdef CAMERAHAL_OMX_PROFILING
 
     mDebugProfile = 0;
@@ -4179,6 +4261,17 @@ OMXCameraAdapter::~OMXCameraAdapter()
     // return to OMX Loaded state
     switchToLoaded();
 
+    // Where the OMX handoffs spent their time
+    mInitSem.DumpStats("mInitSem");
+    mUsePreviewSem.DumpStats("mUsePreviewSem");
+    mStartPreviewSem.DumpStats("mStartPreviewSem");
+    mStopPreviewSem.DumpStats("mStopPreviewSem");
+    mSwitchToLoadedSem.DumpStats("mSwitchToLoadedSem");
+    mSwitchToExecSem.DumpStats("mSwitchToExecSem");
+    mFlushSem.DumpStats("mFlushSem");
+    mStartCaptureSem.DumpStats("mStartCaptureSem");
+    mStopCaptureSem.DumpStats("mStopCaptureSem");
+
     if ( mOmxInitialized ) {
 // FIXME-HASH: REMOVED FOR NOW
 #if 0
@@ -4199,6 +4292,11 @@ OMXCameraAdapter::~OMXCameraAdapter()
         mOmxInitialized = false;
     }
 
+    if ( NULL != mEXIFSharedBuffer ) {
+        mMemMgr.freeBufferList(mEXIFSharedBuffer);
+        mEXIFSharedBuffer = NULL;
+    }
+
     //Remove any unhandled events
     if ( !mEventSignalQ.isEmpty() )
       {
@@ -4291,12 +4389,216 @@ OMX_ERRORTYPE OMXCameraAdapter::OMXCameraGetHandle(OMX_HANDLETYPE *handle, OMX_P
 }
 
 
+// Raw OMX capabilities kept on /data across mediaserver restarts, so the
+// camera component doesn't have to be loaded just to list what it supports.
+// The cache is only trusted for the ducati firmware and build it was probed on.
+class CapabilitiesCache
+{
+public:
+    CapabilitiesCache() : mCameras(0)
+    {
+    }
+
+    static bool enabled()
+    {
+        char value[PROPERTY_VALUE_MAX];
+
+        property_get("debug.camera.capscache", value, "1");
+
+        return 0 != atoi(value);
+    }
+
+    void add(int sensorId, OperatingMode mode, const OMX_TI_CAPTYPE &caps)
+    {
+        Entry entry;
+
+        entry.sensorId = sensorId;
+        entry.mode = mode;
+        memcpy(&entry.caps, &caps, sizeof(OMX_TI_CAPTYPE));
+        mEntries.add(entry);
+    }
+
+    // Also drops anything recorded for a sensor that failed part way
+    void setCameras(int cameras)
+    {
+        mCameras = cameras;
+
+        for ( size_t i = mEntries.size(); i > 0; i-- ) {
+            if ( mEntries[i - 1].sensorId >= cameras ) {
+                mEntries.removeAt(i - 1);
+            }
+        }
+    }
+
+    status_t load()
+    {
+        Header header, expected;
+        status_t ret = NO_ERROR;
+
+        if ( NO_ERROR != makeHeader(expected) ) {
+            return NAME_NOT_FOUND;
+        }
+
+        int fd = open(CACHE_PATH, O_RDONLY);
+        if ( 0 > fd ) {
+            return NAME_NOT_FOUND;
+        }
+
+        if ( ( sizeof(header) != (size_t) read(fd, &header, sizeof(header)) ) ||
+             ( 0 != memcmp(&header, &expected, offsetof(Header, cameras)) ) ||
+             ( 0 >= header.cameras ) || ( MAX_CAMERAS_SUPPORTED < header.cameras ) ||
+             ( 0 >= header.entries ) || ( ( MAX_CAMERAS_SUPPORTED * MODE_MAX ) < header.entries ) ) {
+            CAMHAL_LOGD("Capabilities cache is stale");
+            ret = BAD_VALUE;
+        }
+
+        mEntries.clear();
+        for ( int i = 0; ( NO_ERROR == ret ) && ( i < header.entries ); i++ ) {
+            Entry entry;
+
+            if ( ( sizeof(entry) != (size_t) read(fd, &entry, sizeof(entry)) ) ||
+                 ( 0 > entry.sensorId ) || ( header.cameras <= entry.sensorId ) ||
+                 ( 0 > entry.mode ) || ( MODE_MAX <= entry.mode ) ) {
+                CAMHAL_LOGE("Capabilities cache is corrupted");
+                ret = BAD_VALUE;
+                break;
+            }
+
+            mEntries.add(entry);
+        }
+
+        close(fd);
+
+        if ( NO_ERROR == ret ) {
+            mCameras = header.cameras;
+        } else {
+            mEntries.clear();
+        }
+
+        return ret;
+    }
+
+    status_t save()
+    {
+        Header header;
+        char tmpPath[64];
+        bool ok = true;
+
+        if ( ( 0 >= mCameras ) || mEntries.isEmpty() || ( NO_ERROR != makeHeader(header) ) ) {
+            return BAD_VALUE;
+        }
+
+        header.cameras = mCameras;
+        header.entries = mEntries.size();
+
+        // Write aside and rename, a reader never sees a half written cache
+        snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", CACHE_PATH);
+        int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if ( 0 > fd ) {
+            CAMHAL_LOGD("Can't create %s: %s", tmpPath, strerror(errno));
+            return UNKNOWN_ERROR;
+        }
+
+        ok = ( sizeof(header) == (size_t) write(fd, &header, sizeof(header)) );
+        for ( size_t i = 0; ok && ( i < mEntries.size() ); i++ ) {
+            ok = ( sizeof(Entry) == (size_t) write(fd, &mEntries[i], sizeof(Entry)) );
+        }
+
+        ok = ( 0 == fsync(fd) ) && ok;
+        close(fd);
+
+        if ( !ok || ( 0 != rename(tmpPath, CACHE_PATH) ) ) {
+            CAMHAL_LOGE("Failed to write capabilities cache: %s", strerror(errno));
+            unlink(tmpPath);
+            return UNKNOWN_ERROR;
+        }
+
+        CAMHAL_LOGD("Saved capabilities of %d cameras to %s", mCameras, CACHE_PATH);
+        return NO_ERROR;
+    }
+
+    // Fills the properties from the loaded entries, in the order they were probed
+    int apply(CameraProperties::Properties * const properties_array,
+              const int starting_camera, const int max_camera)
+    {
+        if ( ( starting_camera + mCameras ) > max_camera ) {
+            return 0;
+        }
+
+        for ( size_t i = 0; i < mEntries.size(); i++ ) {
+            Entry &entry = mEntries.editItemAt(i);
+            CameraProperties::Properties * properties = properties_array + starting_camera + entry.sensorId;
+
+            properties->setMode((OperatingMode) entry.mode);
+            OMXCameraAdapter::getCachedCaps(entry.sensorId, properties, entry.caps);
+        }
+
+        return mCameras;
+    }
+
+private:
+    static const char CACHE_PATH[];
+    static const char FIRMWARE_PATH[];
+
+    enum {
+        CACHE_MAGIC = 0x4f434150,
+        CACHE_VERSION = 1
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capsSize;
+        uint32_t reserved;
+        int64_t firmwareSize;
+        int64_t firmwareTime;
+        char build[PROPERTY_VALUE_MAX];
+        int32_t cameras;
+        int32_t entries;
+    };
+
+    struct Entry
+    {
+        int32_t sensorId;
+        int32_t mode;
+        OMX_TI_CAPTYPE caps;
+    };
+
+    static status_t makeHeader(Header &header)
+    {
+        struct stat st;
+
+        memset(&header, 0, sizeof(header));
+
+        if ( 0 != stat(FIRMWARE_PATH, &st) ) {
+            return NAME_NOT_FOUND;
+        }
+
+        header.magic = CACHE_MAGIC;
+        header.version = CACHE_VERSION;
+        header.capsSize = sizeof(OMX_TI_CAPTYPE);
+        header.firmwareSize = st.st_size;
+        header.firmwareTime = st.st_mtime;
+        property_get("ro.build.fingerprint", header.build, "");
+
+        return NO_ERROR;
+    }
+
+    int mCameras;
+    android::Vector<Entry> mEntries;
+};
+
+const char CapabilitiesCache::CACHE_PATH[] = "/data/misc/camera/omx_caps.bin";
+const char CapabilitiesCache::FIRMWARE_PATH[] = "/system/etc/firmware/ducati-m3.bin";
+
 class CapabilitiesHandler
 {
 public:
-    CapabilitiesHandler()
+    CapabilitiesHandler(CapabilitiesCache *cache = NULL)
     {
         mComponent = 0;
+        mCache = cache;
     }
 
     const OMX_HANDLETYPE & component() const
@@ -4328,7 +4630,11 @@ public:
         }
 
         // get and fill capabilities
-        OMXCameraAdapter::getCaps(sensorId, properties, component());
+        OMX_TI_CAPTYPE probed;
+        if ( ( NO_ERROR == OMXCameraAdapter::getCaps(sensorId, properties, component(),
+                                                     mCache ? &probed : NULL) ) && mCache ) {
+            mCache->add(sensorId, properties->getMode(), probed);
+        }
 
         return NO_ERROR;
     }
@@ -4430,6 +4736,7 @@ public:
 private:
     OMX_HANDLETYPE mComponent;
     OMX_STATETYPE mState;
+    CapabilitiesCache *mCache;
 };
 
 extern "C" status_t OMXCameraAdapter_Capabilities(
@@ -4451,13 +4758,26 @@ extern "C" status_t OMXCameraAdapter_Capabilities(
         return BAD_VALUE;
     }
 
+    const bool useCache = CapabilitiesCache::enabled();
+    CapabilitiesCache cache;
+
+    if ( useCache && ( NO_ERROR == cache.load() ) ) {
+        supportedCameras = cache.apply(properties_array, starting_camera, max_camera);
+        if ( 0 < supportedCameras ) {
+            CAMHAL_LOGD("Loaded capabilities of %d OMX cameras from cache", supportedCameras);
+            LOG_FUNCTION_NAME_EXIT;
+            return NO_ERROR;
+        }
+        cache = CapabilitiesCache();
+    }
+
     eError = OMX_Init();
     if (eError != OMX_ErrorNone) {
       CAMHAL_LOGEB("Error OMX_Init -0x%x", eError);
       return Utils::ErrorUtils::omxToAndroidError(eError);
     }
 
-    CapabilitiesHandler handler;
+    CapabilitiesHandler handler(useCache ? &cache : NULL);
     OMX_CALLBACKTYPE callbacks;
     callbacks.EventHandler = 0;
     callbacks.EmptyBufferDone = 0;
@@ -4510,6 +4830,11 @@ extern "C" status_t OMXCameraAdapter_Capabilities(
 
     supportedCameras = num_cameras_supported;
 
+    if ( useCache ) {
+        cache.setCameras(num_cameras_supported);
+        cache.save();
+    }
+
     LOG_FUNCTION_NAME_EXIT;
 
     return NO_ERROR;
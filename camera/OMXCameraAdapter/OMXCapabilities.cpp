@@ -2430,7 +2430,8 @@ bool OMXCameraAdapter::_dumpOmxTiCap(const int sensorId, const OMX_TI_CAPTYPE &
  * public exposed function declarations
  *****************************************/
 
-status_t OMXCameraAdapter::getCaps(const int sensorId, CameraProperties::Properties* params, OMX_HANDLETYPE handle)
+status_t OMXCameraAdapter::getCaps(const int sensorId, CameraProperties::Properties* params, OMX_HANDLETYPE handle,
+                                   OMX_TI_CAPTYPE *probed)
 {
     status_t ret = NO_ERROR;
     int caps_size = 0;
@@ -2490,6 +2491,10 @@ status_t OMXCameraAdapter::getCaps(const int sensorId, CameraProperties::Propert
     CAMHAL_LOGDB("sen mount id=%u", (unsigned int)caps->tSenMounting.nSenId);
     CAMHAL_LOGDB("facing id=%u", (unsigned int)caps->tSenMounting.eFacing);
 
+    if ( ( NO_ERROR == ret ) && probed ) {
+        memcpy(probed, caps, sizeof(OMX_TI_CAPTYPE));
+    }
+
  EXIT:
     if (bufferlist) {
         memMgr.freeBufferList(bufferlist);
@@ -2499,5 +2504,22 @@ status_t OMXCameraAdapter::getCaps(const int sensorId, CameraProperties::Propert
     return ret;
 }
 
+status_t OMXCameraAdapter::getCachedCaps(const int sensorId, CameraProperties::Properties* params,
+                                         OMX_TI_CAPTYPE &caps)
+{
+    status_t ret = NO_ERROR;
+
+    LOG_FUNCTION_NAME;
+
+#ifdef CAMERAHAL_DEBUG
+    _dumpOmxTiCap(sensorId, caps);
+#endif
+
+    ret = insertCapabilities(params, caps);
+
+    LOG_FUNCTION_NAME_EXIT;
+    return ret;
+}
+
 } // namespace Camera
 } // namespace Ti
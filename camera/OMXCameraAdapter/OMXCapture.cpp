@@ -220,6 +220,11 @@ status_t OMXCameraAdapter::setParametersCapture(const android::CameraParameters
 #endif
 #endif
 
+    mZslRingFrames = params.getInt(TICameraParameters::KEY_ZSL_RING_FRAMES);
+    if ( 0 > mZslRingFrames ) {
+        mZslRingFrames = 0;
+    }
+
     // Flush config queue
     // If TRUE: Flush queue and abort processing before enqueing
     valstr = params.get(TICameraParameters::KEY_FLUSH_SHOT_CONFIG_QUEUE);
@@ -380,7 +385,7 @@ status_t OMXCameraAdapter::getPictureBufferSize(CameraFrame &frame, size_t buffe
 
         // If any settings have changed that need to be set with SetParam,
         // we will need to disable the port to set them
-        if ((mPendingCaptureSettings & ECaptureParamSettings)) {
+        if ((mPendingCaptureSettings & capturePortSettings())) {
             disableImagePort();
             if ( NULL != mReleaseImageBuffersCallback ) {
                 mReleaseImageBuffersCallback(mReleaseData);
@@ -938,6 +943,7 @@ status_t OMXCameraAdapter::doBracketing(OMX_BUFFERHEADERTYPE *pBuffHeader,
     if ( NO_ERROR == ret )
         {
         mBracketingBuffersQueued[currentBufferIdx] = false;
+        mBracketingBuffersTimestamp[currentBufferIdx] = systemTime(SYSTEM_TIME_MONOTONIC);
         mBracketingBuffersQueuedCount--;
 
         if ( 0 >= mBracketingBuffersQueuedCount )
@@ -999,6 +1005,71 @@ status_t OMXCameraAdapter::sendBracketFrames(size_t &framesSent)
     return ret;
 }
 
+status_t OMXCameraAdapter::sendZslFrame(nsecs_t shutter, size_t &framesSent)
+{
+    status_t ret = NO_ERROR;
+    int currentBufferIdx, bestBufferIdx = -1;
+    nsecs_t bestDelta = 0;
+    OMXCameraPortParameters * imgCaptureData = NULL;
+
+    LOG_FUNCTION_NAME;
+
+    imgCaptureData = &mCameraAdapterParameters.mCameraPortParams[mCameraAdapterParameters.mImagePortIndex];
+    framesSent = 0;
+
+    if ( OMX_StateExecuting != mComponentState )
+        {
+        CAMHAL_LOGEA("OMX component is not in executing state");
+        ret = -EINVAL;
+        }
+
+    if ( NO_ERROR == ret )
+        {
+        // Only frames held by the ring qualify, pick the one whose
+        // arrival is nearest to the shutter press.
+        for ( currentBufferIdx = 0 ; currentBufferIdx < imgCaptureData->mNumBufs ; currentBufferIdx++ )
+            {
+            if ( mBracketingBuffersQueued[currentBufferIdx] ||
+                 ( 0 == mBracketingBuffersTimestamp[currentBufferIdx] ) )
+                {
+                continue;
+                }
+
+            nsecs_t delta = mBracketingBuffersTimestamp[currentBufferIdx] - shutter;
+            if ( 0 > delta )
+                {
+                delta = -delta;
+                }
+
+            if ( ( 0 > bestBufferIdx ) || ( delta < bestDelta ) )
+                {
+                bestBufferIdx = currentBufferIdx;
+                bestDelta = delta;
+                }
+            }
+
+        if ( 0 > bestBufferIdx )
+            {
+            CAMHAL_LOGDA("ZSL ring is empty, falling back to a live frame");
+            }
+        else
+            {
+            CAMHAL_LOGDB("ZSL frame %d, %lld us from shutter",
+                         bestBufferIdx, ( long long ) ns2us(bestDelta));
+            CameraFrame cameraFrame;
+            sendCallBacks(cameraFrame,
+                          imgCaptureData->mBufferHeader[bestBufferIdx],
+                          imgCaptureData->mImageType,
+                          imgCaptureData);
+            framesSent++;
+            }
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+
+    return ret;
+}
+
 status_t OMXCameraAdapter::startBracketing(int range)
 {
     status_t ret = NO_ERROR;
@@ -1038,7 +1109,9 @@ status_t OMXCameraAdapter::startBracketing(int range)
 
         mBracketingRange = range;
         mBracketingBuffersQueued = new bool[imgCaptureData->mNumBufs];
-        if ( NULL == mBracketingBuffersQueued )
+        mBracketingBuffersTimestamp = new nsecs_t[imgCaptureData->mNumBufs];
+        if ( ( NULL == mBracketingBuffersQueued ) ||
+             ( NULL == mBracketingBuffersTimestamp ) )
             {
             CAMHAL_LOGEA("Unable to allocate bracketing management structures");
             ret = -1;
@@ -1053,6 +1126,7 @@ status_t OMXCameraAdapter::startBracketing(int range)
             for ( int i = 0 ; i  < imgCaptureData->mNumBufs ; i++ )
                 {
                 mBracketingBuffersQueued[i] = true;
+                mBracketingBuffersTimestamp[i] = 0;
                 }
 
             }
@@ -1097,7 +1171,13 @@ status_t OMXCameraAdapter::stopBracketing()
         delete [] mBracketingBuffersQueued;
     }
 
+    if ( NULL != mBracketingBuffersTimestamp )
+    {
+        delete [] mBracketingBuffersTimestamp;
+    }
+
     mBracketingBuffersQueued = NULL;
+    mBracketingBuffersTimestamp = NULL;
     mBracketingEnabled = false;
     mBracketingBuffersQueuedCount = 0;
     mLastBracetingBufferIdx = 0;
@@ -1114,6 +1194,7 @@ status_t OMXCameraAdapter::startImageCapture(bool bracketing, CachedCaptureParam
     OMXCameraPortParameters * capData = NULL;
     OMX_CONFIG_BOOLEANTYPE bOMX;
     size_t bracketingSent = 0;
+    const nsecs_t shutter = systemTime(SYSTEM_TIME_MONOTONIC);
 
     LOG_FUNCTION_NAME;
 
@@ -1153,10 +1234,22 @@ status_t OMXCameraAdapter::startImageCapture(bool bracketing, CachedCaptureParam
         {
         //Stop bracketing, activate normal burst for the remaining images
         mBracketingEnabled = false;
-        ret = sendBracketFrames(bracketingSent);
+        if ( 0 < mZslRingFrames )
+            {
+            ret = sendZslFrame(shutter, bracketingSent);
+            }
+        else
+            {
+            ret = sendBracketFrames(bracketingSent);
+            }
 
         // Check if we accumulated enough buffers
-        if ( bracketingSent < ( mBracketingRange - 1 ) )
+        if ( ( 0 < mZslRingFrames ) && ( 0 < bracketingSent ) )
+            {
+            // The ring frame is the picture, nothing more to capture
+            mCapturedFrames = 0;
+            }
+        else if ( bracketingSent < ( mBracketingRange - 1 ) )
             {
             mCapturedFrames = mBracketingRange + ( ( mBracketingRange - 1 ) - bracketingSent );
             }
@@ -1393,10 +1486,9 @@ status_t OMXCameraAdapter::stopImageCapture()
         goto EXIT;
     }
 
-    // TODO(XXX): Reprocessing is currently piggy-backing capture commands
-    if (mAdapterState == REPROCESS_STATE) {
-        ret = stopReprocess();
-    }
+    // The reprocess port stays enabled with its buffers registered, so the
+    // next reprocess on the same buffers is queued without a port setup.
+    // UseBuffersReprocess() and stopPreview() take it down.
 
     //Disable the callback first
     mWaitingForSnapshot = false;
@@ -1518,6 +1610,18 @@ EXIT:
     return (ret | Utils::ErrorUtils::omxToAndroidError(eError));
 }
 
+unsigned int OMXCameraAdapter::capturePortSettings() const
+{
+    // Burst and bracketing are shot configs and are applied in
+    // startImageCapture() with the port enabled. Only the legacy
+    // behaviour tears the port down for them.
+    if ( mConcurrentCapture ) {
+        return ECaptureParamSettings;
+    }
+
+    return ECaptureParamSettings | SetBurstExpBracket;
+}
+
 status_t OMXCameraAdapter::disableImagePort(){
     status_t ret = NO_ERROR;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
@@ -1760,10 +1864,14 @@ status_t OMXCameraAdapter::UseBuffersCapture(CameraBuffer * bufArr, int num)
 
     // if some setting that requires a SetParameter (including
     // changing buffer types) then we need to disable the port
-    // before being allowed to apply the settings
-    if ((mPendingCaptureSettings & ECaptureParamSettings) ||
+    // before being allowed to apply the settings. The same goes for
+    // a different buffer set, since the port holds headers for the
+    // buffers it was enabled with.
+    if ((mPendingCaptureSettings & capturePortSettings()) ||
             bufArr[0].type != imgCaptureData->mBufferType ||
-            imgCaptureData->mNumBufs != num) {
+            imgCaptureData->mNumBufs != num ||
+            (mCaptureConfigured &&
+             imgCaptureData->mBufferHeader[0]->pAppPrivate != &bufArr[0])) {
         if (mCaptureConfigured) {
             disableImagePort();
             if ( NULL != mReleaseImageBuffersCallback ) {
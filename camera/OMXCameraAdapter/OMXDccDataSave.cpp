@@ -19,6 +19,10 @@
 *
 * This file contains functionality for handling DCC data save
 *
+* NOTE: not built at the moment (see Android.mk). The calls from
+* OMXCameraAdapter initialize(), FillBufferDone and the destructor are
+* compiled out along with mDccData, so camera open/close does no DCC I/O.
+*
 */
 
 #include "CameraHal.h"
@@ -220,6 +220,166 @@ status_t OMXCameraAdapter::setParametersEXIF(const android::CameraParameters &pa
         mEXIFData.mFocalDen = 0;
     }
 
+    // A failure only loses the static tags, not the capture
+    buildStaticEXIF();
+
+    LOG_FUNCTION_NAME_EXIT;
+
+    return ret;
+}
+
+status_t OMXCameraAdapter::buildStaticEXIF()
+{
+    status_t ret = NO_ERROR;
+    ExifElementsTable *exifTable = &mEXIFStaticTags;
+    android::AutoMutex lock(mEXIFLock);
+
+    LOG_FUNCTION_NAME;
+
+    // Everything here only depends on parameters, so it is formatted
+    // once per setParameters() instead of on every shot. The capture
+    // path copies the table and adds the per-shot tags.
+    exifTable->reset();
+
+    if ((NO_ERROR == ret) && (mEXIFData.mModelValid)) {
+        ret = exifTable->insertElement(TAG_MODEL, mEXIFData.mModel);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mMakeValid)) {
+        ret = exifTable->insertElement(TAG_MAKE, mEXIFData.mMake);
+    }
+
+    if ((NO_ERROR == ret)) {
+        if (mEXIFData.mFocalNum || mEXIFData.mFocalDen) {
+            char temp_value[256]; // arbitrarily long string
+            snprintf(temp_value,
+                    sizeof(temp_value)/sizeof(char),
+                    "%u/%u",
+                    mEXIFData.mFocalNum,
+                    mEXIFData.mFocalDen);
+            ret = exifTable->insertElement(TAG_FOCALLENGTH, temp_value);
+
+        }
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLatValid)) {
+        char temp_value[256]; // arbitrarily long string
+        snprintf(temp_value,
+                 sizeof(temp_value)/sizeof(char) - 1,
+                 "%d/%d,%d/%d,%d/%d",
+                 abs(mEXIFData.mGPSData.mLatDeg), 1,
+                 abs(mEXIFData.mGPSData.mLatMin), 1,
+                 abs(mEXIFData.mGPSData.mLatSec), abs(mEXIFData.mGPSData.mLatSecDiv));
+        ret = exifTable->insertElement(TAG_GPS_LAT, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLatValid)) {
+        ret = exifTable->insertElement(TAG_GPS_LAT_REF, mEXIFData.mGPSData.mLatRef);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLongValid)) {
+        char temp_value[256]; // arbitrarily long string
+        snprintf(temp_value,
+                 sizeof(temp_value)/sizeof(char) - 1,
+                 "%d/%d,%d/%d,%d/%d",
+                 abs(mEXIFData.mGPSData.mLongDeg), 1,
+                 abs(mEXIFData.mGPSData.mLongMin), 1,
+                 abs(mEXIFData.mGPSData.mLongSec), abs(mEXIFData.mGPSData.mLongSecDiv));
+        ret = exifTable->insertElement(TAG_GPS_LONG, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLongValid)) {
+        ret = exifTable->insertElement(TAG_GPS_LONG_REF, mEXIFData.mGPSData.mLongRef);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mAltitudeValid)) {
+        char temp_value[256]; // arbitrarily long string
+        snprintf(temp_value,
+                 sizeof(temp_value)/sizeof(char) - 1,
+                 "%d/%d",
+                 abs( mEXIFData.mGPSData.mAltitude), 1);
+        ret = exifTable->insertElement(TAG_GPS_ALT, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mAltitudeValid)) {
+        char temp_value[5];
+        snprintf(temp_value,
+                 sizeof(temp_value)/sizeof(char) - 1,
+                 "%d", mEXIFData.mGPSData.mAltitudeRef);
+        ret = exifTable->insertElement(TAG_GPS_ALT_REF, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mMapDatumValid)) {
+        ret = exifTable->insertElement(TAG_GPS_MAP_DATUM, mEXIFData.mGPSData.mMapDatum);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mProcMethodValid)) {
+        char temp_value[GPS_PROCESSING_SIZE];
+
+        memcpy(temp_value, ExifAsciiPrefix, sizeof(ExifAsciiPrefix));
+        memcpy(temp_value + sizeof(ExifAsciiPrefix),
+                mEXIFData.mGPSData.mProcMethod,
+                (GPS_PROCESSING_SIZE - sizeof(ExifAsciiPrefix)));
+        ret = exifTable->insertElement(TAG_GPS_PROCESSING_METHOD, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mVersionIdValid)) {
+        char temp_value[256]; // arbitrarily long string
+        snprintf(temp_value,
+                 sizeof(temp_value)/sizeof(char) - 1,
+                 "%d,%d,%d,%d",
+                 mEXIFData.mGPSData.mVersionId[0],
+                 mEXIFData.mGPSData.mVersionId[1],
+                 mEXIFData.mGPSData.mVersionId[2],
+                 mEXIFData.mGPSData.mVersionId[3]);
+        ret = exifTable->insertElement(TAG_GPS_VERSION_ID, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mTimeStampValid)) {
+        char temp_value[256]; // arbitrarily long string
+        snprintf(temp_value,
+                 sizeof(temp_value)/sizeof(char) - 1,
+                 "%d/%d,%d/%d,%d/%d",
+                 mEXIFData.mGPSData.mTimeStampHour, 1,
+                 mEXIFData.mGPSData.mTimeStampMin, 1,
+                 mEXIFData.mGPSData.mTimeStampSec, 1);
+        ret = exifTable->insertElement(TAG_GPS_TIMESTAMP, temp_value);
+    }
+
+    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mDatestampValid) ) {
+        ret = exifTable->insertElement(TAG_GPS_DATESTAMP, mEXIFData.mGPSData.mDatestamp);
+    }
+
+    // fill in short and ushort tags
+    if (NO_ERROR == ret) {
+        char temp_value[2];
+        temp_value[1] = '\0';
+
+        // MeteringMode
+        // TODO(XXX): only supporting this metering mode at the moment, may change in future
+        temp_value[0] = '2';
+        exifTable->insertElement(TAG_METERING_MODE, temp_value);
+
+        // ExposureProgram
+        // TODO(XXX): only supporting this exposure program at the moment, may change in future
+        temp_value[0] = '3';
+        exifTable->insertElement(TAG_EXPOSURE_PROGRAM, temp_value);
+
+        // ColorSpace
+        temp_value[0] = '1';
+        exifTable->insertElement(TAG_COLOR_SPACE, temp_value);
+
+        temp_value[0] = '2';
+        exifTable->insertElement(TAG_SENSING_METHOD, temp_value);
+
+        temp_value[0] = '1';
+        exifTable->insertElement(TAG_CUSTOM_RENDERED, temp_value);
+    }
+
+    if (NO_ERROR != ret) {
+        CAMHAL_LOGEB("Error building static EXIF tags %d", ret);
+        exifTable->reset();
+    }
 
     LOG_FUNCTION_NAME_EXIT;
 
@@ -237,7 +397,6 @@ status_t OMXCameraAdapter::setupEXIF()
     struct timeval sTv;
     struct tm *pTime;
     OMXCameraPortParameters * capData = NULL;
-    CameraBuffer *memmgr_buf_array;
     int buf_size = 0;
 
     LOG_FUNCTION_NAME;
@@ -270,9 +429,18 @@ status_t OMXCameraAdapter::setupEXIF()
         buf_size = ((buf_size+4095)/4096)*4096;
         sharedBuffer.nSharedBuffSize = buf_size;
 
-        memmgr_buf_array = mMemMgr.allocateBufferList(0, 0, NULL, buf_size, 1);
-        sharedBuffer.pSharedBuff = (OMX_U8*)camera_buffer_get_omx_ptr(&memmgr_buf_array[0]);
-        startPtr =  ( OMX_U8 * ) memmgr_buf_array[0].opaque;
+        //The size never changes, so the buffer is allocated on the
+        //first shot and reused by the following ones.
+        if ( NULL == mEXIFSharedBuffer )
+            {
+            mEXIFSharedBuffer = mMemMgr.allocateBufferList(0, 0, NULL, buf_size, 1);
+            }
+
+        if ( NULL != mEXIFSharedBuffer )
+            {
+            sharedBuffer.pSharedBuff = (OMX_U8*)camera_buffer_get_omx_ptr(&mEXIFSharedBuffer[0]);
+            startPtr =  ( OMX_U8 * ) mEXIFSharedBuffer[0].opaque;
+            }
 
         if ( NULL == startPtr)
             {
@@ -497,11 +665,6 @@ status_t OMXCameraAdapter::setupEXIF()
             }
         }
 
-    if ( NULL != memmgr_buf_array )
-        {
-        mMemMgr.freeBufferList(memmgr_buf_array);
-        }
-
     LOG_FUNCTION_NAME_EXIT;
 
     // FIXME-HASH: RETURN NO_ERROR REGARDLESS OF EXIF ERROR
@@ -522,25 +685,9 @@ status_t OMXCameraAdapter::setupEXIF_libjpeg(ExifElementsTable* exifTable,
 
     capData = &mCameraAdapterParameters.mCameraPortParams[mCameraAdapterParameters.mImagePortIndex];
 
-    if ((NO_ERROR == ret) && (mEXIFData.mModelValid)) {
-        ret = exifTable->insertElement(TAG_MODEL, mEXIFData.mModel);
-    }
-
-     if ((NO_ERROR == ret) && (mEXIFData.mMakeValid)) {
-        ret = exifTable->insertElement(TAG_MAKE, mEXIFData.mMake);
-     }
-
-    if ((NO_ERROR == ret)) {
-        if (mEXIFData.mFocalNum || mEXIFData.mFocalDen) {
-            char temp_value[256]; // arbitrarily long string
-            snprintf(temp_value,
-                    sizeof(temp_value)/sizeof(char),
-                    "%u/%u",
-                    mEXIFData.mFocalNum,
-                    mEXIFData.mFocalDen);
-            ret = exifTable->insertElement(TAG_FOCALLENGTH, temp_value);
-
-        }
+    {
+        android::AutoMutex lock(mEXIFLock);
+        ret = exifTable->insertElements(mEXIFStaticTags);
     }
 
     if ((NO_ERROR == ret)) {
@@ -572,94 +719,6 @@ status_t OMXCameraAdapter::setupEXIF_libjpeg(ExifElementsTable* exifTable,
         ret = exifTable->insertElement(TAG_IMAGE_LENGTH, temp_value);
      }
 
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLatValid)) {
-        char temp_value[256]; // arbitrarily long string
-        snprintf(temp_value,
-                 sizeof(temp_value)/sizeof(char) - 1,
-                 "%d/%d,%d/%d,%d/%d",
-                 abs(mEXIFData.mGPSData.mLatDeg), 1,
-                 abs(mEXIFData.mGPSData.mLatMin), 1,
-                 abs(mEXIFData.mGPSData.mLatSec), abs(mEXIFData.mGPSData.mLatSecDiv));
-        ret = exifTable->insertElement(TAG_GPS_LAT, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLatValid)) {
-        ret = exifTable->insertElement(TAG_GPS_LAT_REF, mEXIFData.mGPSData.mLatRef);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLongValid)) {
-        char temp_value[256]; // arbitrarily long string
-        snprintf(temp_value,
-                 sizeof(temp_value)/sizeof(char) - 1,
-                 "%d/%d,%d/%d,%d/%d",
-                 abs(mEXIFData.mGPSData.mLongDeg), 1,
-                 abs(mEXIFData.mGPSData.mLongMin), 1,
-                 abs(mEXIFData.mGPSData.mLongSec), abs(mEXIFData.mGPSData.mLongSecDiv));
-        ret = exifTable->insertElement(TAG_GPS_LONG, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mLongValid)) {
-        ret = exifTable->insertElement(TAG_GPS_LONG_REF, mEXIFData.mGPSData.mLongRef);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mAltitudeValid)) {
-        char temp_value[256]; // arbitrarily long string
-        snprintf(temp_value,
-                 sizeof(temp_value)/sizeof(char) - 1,
-                 "%d/%d",
-                 abs( mEXIFData.mGPSData.mAltitude), 1);
-        ret = exifTable->insertElement(TAG_GPS_ALT, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mAltitudeValid)) {
-        char temp_value[5];
-        snprintf(temp_value,
-                 sizeof(temp_value)/sizeof(char) - 1,
-                 "%d", mEXIFData.mGPSData.mAltitudeRef);
-        ret = exifTable->insertElement(TAG_GPS_ALT_REF, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mMapDatumValid)) {
-        ret = exifTable->insertElement(TAG_GPS_MAP_DATUM, mEXIFData.mGPSData.mMapDatum);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mProcMethodValid)) {
-        char temp_value[GPS_PROCESSING_SIZE];
-
-        memcpy(temp_value, ExifAsciiPrefix, sizeof(ExifAsciiPrefix));
-        memcpy(temp_value + sizeof(ExifAsciiPrefix),
-                mEXIFData.mGPSData.mProcMethod,
-                (GPS_PROCESSING_SIZE - sizeof(ExifAsciiPrefix)));
-        ret = exifTable->insertElement(TAG_GPS_PROCESSING_METHOD, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mVersionIdValid)) {
-        char temp_value[256]; // arbitrarily long string
-        snprintf(temp_value,
-                 sizeof(temp_value)/sizeof(char) - 1,
-                 "%d,%d,%d,%d",
-                 mEXIFData.mGPSData.mVersionId[0],
-                 mEXIFData.mGPSData.mVersionId[1],
-                 mEXIFData.mGPSData.mVersionId[2],
-                 mEXIFData.mGPSData.mVersionId[3]);
-        ret = exifTable->insertElement(TAG_GPS_VERSION_ID, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mTimeStampValid)) {
-        char temp_value[256]; // arbitrarily long string
-        snprintf(temp_value,
-                 sizeof(temp_value)/sizeof(char) - 1,
-                 "%d/%d,%d/%d,%d/%d",
-                 mEXIFData.mGPSData.mTimeStampHour, 1,
-                 mEXIFData.mGPSData.mTimeStampMin, 1,
-                 mEXIFData.mGPSData.mTimeStampSec, 1);
-        ret = exifTable->insertElement(TAG_GPS_TIMESTAMP, temp_value);
-    }
-
-    if ((NO_ERROR == ret) && (mEXIFData.mGPSData.mDatestampValid) ) {
-        ret = exifTable->insertElement(TAG_GPS_DATESTAMP, mEXIFData.mGPSData.mDatestamp);
-    }
-
     if (NO_ERROR == ret) {
         const char* exif_orient =
                 ExifElementsTable::degreesToExifOrientation(mPictureRotation);
@@ -681,26 +740,6 @@ status_t OMXCameraAdapter::setupEXIF_libjpeg(ExifElementsTable* exifTable,
             temp_value[0] = '1';
         }
         exifTable->insertElement(TAG_WHITEBALANCE, temp_value);
-
-        // MeteringMode
-        // TODO(XXX): only supporting this metering mode at the moment, may change in future
-        temp_value[0] = '2';
-        exifTable->insertElement(TAG_METERING_MODE, temp_value);
-
-        // ExposureProgram
-        // TODO(XXX): only supporting this exposure program at the moment, may change in future
-        temp_value[0] = '3';
-        exifTable->insertElement(TAG_EXPOSURE_PROGRAM, temp_value);
-
-        // ColorSpace
-        temp_value[0] = '1';
-        exifTable->insertElement(TAG_COLOR_SPACE, temp_value);
-
-        temp_value[0] = '2';
-        exifTable->insertElement(TAG_SENSING_METHOD, temp_value);
-
-        temp_value[0] = '1';
-        exifTable->insertElement(TAG_CUSTOM_RENDERED, temp_value);
     }
 
     if (pAncillaryData && (NO_ERROR == ret)) {
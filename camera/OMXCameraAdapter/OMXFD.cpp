@@ -28,14 +28,30 @@ namespace Ti {
 namespace Camera {
 
 const uint32_t OMXCameraAdapter::FACE_DETECTION_THRESHOLD = 80;
+const uint32_t OMXCameraAdapter::FACE_DETECTION_SMOOTHING_MAX = 90;
 
 status_t OMXCameraAdapter::setParametersFD(const android::CameraParameters &params,
                                            BaseCameraAdapter::AdapterState state)
 {
     status_t ret = NO_ERROR;
+    int value;
 
     LOG_FUNCTION_NAME;
 
+    android::AutoMutex lock(mFaceDetectionLock);
+
+    value = params.getInt(TICameraParameters::KEY_FACE_DETECTION_RATE);
+    mFaceDetectionRate = ( 0 < value ) ? value : 0;
+
+    value = params.getInt(TICameraParameters::KEY_FACE_DETECTION_SMOOTHING);
+    if ( 0 < value ) {
+        mFaceDetectionSmoothing = min((uint32_t) value, FACE_DETECTION_SMOOTHING_MAX);
+    } else {
+        mFaceDetectionSmoothing = 0;
+    }
+
+    CAMHAL_LOGVB("FD rate %u smoothing %u", mFaceDetectionRate, mFaceDetectionSmoothing);
+
     LOG_FUNCTION_NAME_EXIT;
 
     return ret;
@@ -61,6 +77,7 @@ status_t OMXCameraAdapter::startFaceDetection()
     // regions alone.
 
     faceDetectionNumFacesLastOutput = 0;
+    mFaceDetectionLastTime = 0;
  out:
     return ret;
 }
@@ -206,6 +223,7 @@ status_t OMXCameraAdapter::createPreviewMetadata(OMX_BUFFERHEADERTYPE* pBuffHead
     status_t faceRet = NO_ERROR;
     status_t metaRet = NO_ERROR;
     OMX_FACEDETECTIONTYPE *faceData = NULL;
+    bool faceDecimated = false;
 
     LOG_FUNCTION_NAME;
 
@@ -219,7 +237,22 @@ status_t OMXCameraAdapter::createPreviewMetadata(OMX_BUFFERHEADERTYPE* pBuffHead
         return-EINVAL;
     }
 
-    if ( mFaceDetectionRunning && !mFaceDetectionPaused ) {
+    // Face results are produced at the configured FD rate, independent of
+    // the preview frame rate. Frames in between still carry the regular
+    // preview metadata.
+    if ( mFaceDetectionRunning && !mFaceDetectionPaused && ( 0 < mFaceDetectionRate ) ) {
+        nsecs_t now = pBuffHeader->nTimeStamp * 1000;
+        nsecs_t interval = 1000000000LL / mFaceDetectionRate;
+
+        // Allow for preview timestamp jitter around the FD period
+        if ( ( now - mFaceDetectionLastTime ) < ( interval - interval / 8 ) ) {
+            faceDecimated = true;
+        } else {
+            mFaceDetectionLastTime = now;
+        }
+    }
+
+    if ( mFaceDetectionRunning && !mFaceDetectionPaused && !faceDecimated ) {
         OMX_OTHER_EXTRADATATYPE *extraData;
 
         extraData = getExtradata(pBuffHeader->pPlatformPrivate,
@@ -268,8 +301,12 @@ status_t OMXCameraAdapter::createPreviewMetadata(OMX_BUFFERHEADERTYPE* pBuffHead
     }
 
     //Encode face coordinates
-    faceRet = encodeFaceCoordinates(faceData, result->getMetadataResult()
-                                            , previewWidth, previewHeight);
+    if ( faceDecimated ) {
+        faceRet = NOT_ENOUGH_DATA;
+    } else {
+        faceRet = encodeFaceCoordinates(faceData, result->getMetadataResult()
+                                                , previewWidth, previewHeight);
+    }
     if ((NO_ERROR == faceRet) || (NOT_ENOUGH_DATA == faceRet)) {
         // Ignore harmless errors (no error and no update) and go ahead and encode
         // the preview meta data
@@ -437,6 +474,8 @@ status_t OMXCameraAdapter::encodeFaceCoordinates(const OMX_FACEDETECTIONTYPE *fa
         metadataResult->number_of_faces = i;
         metadataResult->faces = faces;
 
+        smoothFaces(faces, i);
+
         for (int i = 0; i  < metadataResult->number_of_faces; i++)
         {
             bool faceChanged = true;
@@ -501,5 +540,43 @@ out:
     return ret;
 }
 
+void OMXCameraAdapter::smoothFaces(camera_face_t *faces, int count)
+{
+    // Called with mFaceDetectionLock held. Each face is blended with the
+    // closest face of the previous output it overlaps, which keeps the
+    // rectangles from jittering between FD results.
+    if ( ( 0 == mFaceDetectionSmoothing ) || ( NULL == faces ) ) {
+        return;
+    }
+
+    for ( int i = 0 ; i < count ; i++ ) {
+        int centerX = ( faces[i].rect[0] + faces[i].rect[2] ) / 2;
+        int centerY = ( faces[i].rect[1] + faces[i].rect[3] ) / 2;
+        int sizeX = abs(faces[i].rect[2] - faces[i].rect[0]);
+        int sizeY = abs(faces[i].rect[3] - faces[i].rect[1]);
+        int best = -1;
+        int bestDistance = 0;
+
+        for ( int j = 0 ; j < faceDetectionNumFacesLastOutput ; j++ ) {
+            int lastX = ( faceDetectionLastOutput[j].rect[0] + faceDetectionLastOutput[j].rect[2] ) / 2;
+            int lastY = ( faceDetectionLastOutput[j].rect[1] + faceDetectionLastOutput[j].rect[3] ) / 2;
+            int distance = abs(lastX - centerX) + abs(lastY - centerY);
+
+            if ( ( abs(lastX - centerX) < sizeX ) && ( abs(lastY - centerY) < sizeY ) &&
+                 ( ( -1 == best ) || ( distance < bestDistance ) ) ) {
+                best = j;
+                bestDistance = distance;
+            }
+        }
+
+        if ( -1 != best ) {
+            for ( int k = 0 ; k < 4 ; k++ ) {
+                faces[i].rect[k] = ( faceDetectionLastOutput[best].rect[k] * (int) mFaceDetectionSmoothing +
+                                     faces[i].rect[k] * ( 100 - (int) mFaceDetectionSmoothing ) ) / 100;
+            }
+        }
+    }
+}
+
 } // namespace Camera
 } // namespace Ti
@@ -145,8 +145,9 @@ status_t OMXCameraAdapter::doAutoFocus()
     } else if ( mParameters3A.Focus == OMX_IMAGE_FocusControlAuto ) {
         // In case we have CAF running we should first check the AF status.
         // If it has managed to lock, then do as usual and return status
-        // immediately.
-        ret = checkFocus(&focusStatus);
+        // immediately. The status pushed by the last focus event is used
+        // when there is one.
+        ret = getFocusStatus(&focusStatus);
         if ( NO_ERROR != ret ) {
             CAMHAL_LOGEB("Focus status check failed 0x%x!", ret);
             return ret;
@@ -174,6 +175,9 @@ status_t OMXCameraAdapter::doAutoFocus()
         {
             android::AutoMutex lock(mDoAFMutex);
 
+            // Only an event for this scan may end the wait below
+            invalidateFocusStatus();
+
         // force AF, Ducati will take care of whether CAF
         // or AF will be performed, depending on light conditions
         if ( focusControl.eFocusControl == OMX_IMAGE_FocusControlAuto &&
@@ -383,6 +387,8 @@ status_t OMXCameraAdapter::setFocusCallback(bool enabled)
         focusRequstCallback.nPortIndex = OMX_ALL;
         focusRequstCallback.nIndex = OMX_IndexConfigCommonFocusStatus;
 
+        invalidateFocusStatus();
+
         if ( enabled )
             {
             focusRequstCallback.bEnable = OMX_TRUE;
@@ -437,7 +443,7 @@ status_t OMXCameraAdapter::returnFocusStatus(bool timeoutReached)
 
         if ( !timeoutReached )
             {
-            ret = checkFocus(&eFocusStatus);
+            ret = getFocusStatus(&eFocusStatus);
 
             if ( NO_ERROR != ret )
                 {
@@ -557,6 +563,28 @@ status_t OMXCameraAdapter::checkFocus(OMX_PARAM_FOCUSSTATUSTYPE *eFocusStatus)
     return ret;
 }
 
+status_t OMXCameraAdapter::getFocusStatus(OMX_PARAM_FOCUSSTATUSTYPE *eFocusStatus)
+{
+    {
+        android::AutoMutex lock(mFocusStatusLock);
+
+        if ( mFocusStatusValid && ( NULL != eFocusStatus ) ) {
+            OMX_INIT_STRUCT_PTR (eFocusStatus, OMX_PARAM_FOCUSSTATUSTYPE);
+            eFocusStatus->eFocusStatus = mFocusStatus;
+            CAMHAL_LOGDB("Cached Focus Status: %d", mFocusStatus);
+            return NO_ERROR;
+        }
+    }
+
+    return checkFocus(eFocusStatus);
+}
+
+void OMXCameraAdapter::invalidateFocusStatus()
+{
+    android::AutoMutex lock(mFocusStatusLock);
+    mFocusStatusValid = false;
+}
+
 status_t OMXCameraAdapter::updateFocusDistances(android::CameraParameters &params)
 {
     OMX_U32 focusNear, focusOptimal, focusFar;
@@ -833,14 +861,19 @@ void OMXCameraAdapter::handleFocusCallback() {
     BaseCameraAdapter::getNextState(nextState);
     BaseCameraAdapter::getState(currentState);
 
-    // Dropping AF callback if it triggered in non AF state
+    // Dropping AF callback if it triggered in non AF state. CAF events are
+    // still read so a later doAutoFocus() can use their status directly.
     if ((currentState != AF_STATE) && (currentState != AF_ZOOM_STATE) &&
         (nextState != AF_STATE) && (nextState != AF_ZOOM_STATE)) {
+        if ((mParameters3A.Focus == (OMX_IMAGE_FOCUSCONTROLTYPE) OMX_IMAGE_FocusControlAuto) &&
+            (checkFocus(&eFocusStatus) == NO_ERROR)) {
+            android::AutoMutex lock(mFocusStatusLock);
+            mFocusStatus = eFocusStatus.eFocusStatus;
+            mFocusStatusValid = true;
+        }
         return;
     }
 
-    OMX_INIT_STRUCT(eFocusStatus, OMX_PARAM_FOCUSSTATUSTYPE);
-
     ret = checkFocus(&eFocusStatus);
 
     if (NO_ERROR != ret) {
@@ -853,6 +886,12 @@ void OMXCameraAdapter::handleFocusCallback() {
         return;
     }
 
+    {
+        android::AutoMutex lock(mFocusStatusLock);
+        mFocusStatus = eFocusStatus.eFocusStatus;
+        mFocusStatusValid = true;
+    }
+
     if ( eFocusStatus.eFocusStatus == OMX_FocusStatusOff ) {
         android::AutoMutex lock(mCancelAFMutex);
         mCancelAFCond.signal();
@@ -32,8 +32,18 @@ namespace Ti {
 namespace Camera {
 
 #ifdef OMAP_ENHANCEMENT_CPCAM
-camera_memory_t * OMXCameraAdapter::getMetaData(const OMX_PTR plat_pvt,
-                                                camera_request_memory allocator) const
+
+// Extended metadata buffers kept around for reuse, about a capture burst
+const unsigned int OMXCameraAdapter::METADATA_POOL_SIZE = 8;
+
+// Room for every field getMetaData() may fill in
+const size_t OMXCameraAdapter::METADATA_BUFFER_SIZE =
+        sizeof(camera_metadata_t) +
+        MAX_NUM_FACES_SUPPORTED * sizeof(camera_metadata_face_t) +
+        OMX_TI_LSC_GAIN_TABLE_SIZE;
+
+android::sp<CameraMetadataResult> OMXCameraAdapter::getMetaData(const OMX_PTR plat_pvt,
+                                                                camera_request_memory allocator)
 {
     camera_memory_t * ret = NULL;
 
@@ -45,12 +55,9 @@ camera_memory_t * OMXCameraAdapter::getMetaData(const OMX_PTR plat_pvt,
     camera_metadata_t *metaData;
     size_t offset = 0;
 
-    size_t metaDataSize = sizeof(camera_metadata_t);
-
     extraData = getExtradata(plat_pvt, (OMX_EXTRADATATYPE) OMX_FaceDetection);
     if ( NULL != extraData ) {
         faceData = ( OMX_FACEDETECTIONTYPE * ) extraData->data;
-        metaDataSize += faceData->ulFaceCount * sizeof(camera_metadata_face_t);
     }
 
     extraData = getExtradata(plat_pvt, (OMX_EXTRADATATYPE) OMX_WhiteBalance);
@@ -66,14 +73,21 @@ camera_memory_t * OMXCameraAdapter::getMetaData(const OMX_PTR plat_pvt,
     extraData = getExtradata(plat_pvt, (OMX_EXTRADATATYPE) OMX_TI_LSCTable);
     if ( NULL != extraData ) {
         lscTbl = ( OMX_TI_LSCTABLETYPE * ) extraData->data;
-        metaDataSize += OMX_TI_LSC_GAIN_TABLE_SIZE;
     }
 
-    ret = allocator(-1, metaDataSize, 1, NULL);
+    // Only the extra data enabled through setExtraData() shows up here,
+    // so every field below is written in place only when it was asked for
+    if ( ( NULL == mMetadataPool.get() ) || ( mMetadataPool->getAllocator() != allocator ) ) {
+        mMetadataPool = new CameraMetadataPool(allocator, METADATA_BUFFER_SIZE, METADATA_POOL_SIZE);
+    }
+
+    ret = mMetadataPool->acquire();
     if ( NULL == ret ) {
         return NULL;
     } else {
         metaData = static_cast<camera_metadata_t *> (ret->data);
+        // A recycled buffer still holds the previous frame's fields
+        memset(metaData, 0, sizeof(camera_metadata_t));
         offset += sizeof(camera_metadata_t);
     }
 
@@ -83,6 +97,9 @@ camera_memory_t * OMXCameraAdapter::getMetaData(const OMX_PTR plat_pvt,
         metaData->faces_offset = offset;
         struct camera_metadata_face *faces = reinterpret_cast<struct camera_metadata_face *> (static_cast<char*>(ret->data) + offset);
         for ( int j = 0; j < faceData->ulFaceCount ; j++ ) {
+            if ( metaData->number_of_faces >= MAX_NUM_FACES_SUPPORTED ) {
+                break;
+            }
             if(faceData->tFacePosition[j].nScore <= FACE_DETECTION_THRESHOLD) {
                 continue;
             }
@@ -137,7 +154,7 @@ camera_memory_t * OMXCameraAdapter::getMetaData(const OMX_PTR plat_pvt,
         metaData->exposure_dev = shotInfo->nDevEV;
     }
 
-    return ret;
+    return new CameraMetadataResult(ret, mMetadataPool);
 }
 #endif
 
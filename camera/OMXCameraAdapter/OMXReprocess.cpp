@@ -162,8 +162,8 @@ status_t OMXCameraAdapter::stopReprocess()
                                 mCameraAdapterParameters.mVideoInPortIndex,
                                 NULL);
     if (portData) {
-        CAMHAL_LOGDB("Freeing buffers on reproc port - num: %d", portData->mNumBufs);
-        for (int index = 0 ; index < portData->mNumBufs ; index++) {
+        CAMHAL_LOGDB("Freeing buffers on reproc port - num: %d", mReprocNumBufs);
+        for (int index = 0 ; index < mReprocNumBufs ; index++) {
             CAMHAL_LOGDB("Freeing buffer on reproc port - 0x%x",
                          ( unsigned int ) portData->mBufferHeader[index]->pBuffer);
             eError = OMX_FreeBuffer(mCameraAdapterParameters.mHandleComp,
@@ -193,6 +193,7 @@ status_t OMXCameraAdapter::stopReprocess()
     deinitInternalBuffers(mCameraAdapterParameters.mVideoInPortIndex);
 
     mReprocConfigured = false;
+    mReprocNumBufs = 0;
 
 EXIT:
     CAMHAL_LOGEB("Exiting function %s because of ret %d eError=%x", __FUNCTION__, ret, eError);
@@ -227,11 +228,11 @@ status_t OMXCameraAdapter::UseBuffersReprocess(CameraBuffer *bufArr, int num)
 
     CAMHAL_ASSERT(num > 0);
 
+    // Buffers of a running reprocess may still be with the component
     if (mAdapterState == REPROCESS_STATE) {
         stopReprocess();
     } else if (mAdapterState == CAPTURE_STATE) {
         stopImageCapture();
-        stopReprocess();
     }
 
 #if PPM_INSTRUMENTATION || PPM_INSTRUMENTATION_ABS
@@ -246,10 +247,20 @@ status_t OMXCameraAdapter::UseBuffersReprocess(CameraBuffer *bufArr, int num)
     ret = setParametersReprocess(mParams, bufArr, mAdapterState);
 
     if (mReprocConfigured) {
-        if (mPendingReprocessSettings & ECaptureParamSettings) {
+        if ( (mPendingReprocessSettings & ECaptureParamSettings) ||
+             !reprocessBuffersRegistered(bufArr, num) ) {
             stopReprocess();
         } else {
-            // Tap in port has been already configured.
+            // Tap in port has been already configured with these buffers,
+            // only the payload of each may have changed. The CameraBuffer
+            // array itself is new on every reprocess() call.
+            for (int index = 0 ; index < num ; index++) {
+                portData->mBufferHeader[index]->pAppPrivate = (OMX_PTR) &bufArr[index];
+                bufArr[index].index = index;
+                portData->mBufferHeader[index]->nOffset = bufArr[index].offset;
+                portData->mBufferHeader[index]->nFilledLen = bufArr[index].actual_size;
+            }
+            CAMHAL_LOGDB("Reusing %d buffers on reprocess port", num);
             return NO_ERROR;
         }
     }
@@ -357,6 +368,7 @@ status_t OMXCameraAdapter::UseBuffersReprocess(CameraBuffer *bufArr, int num)
     }
 
     mReprocConfigured = true;
+    mReprocNumBufs = portData->mNumBufs;
 
 #if PPM_INSTRUMENTATION || PPM_INSTRUMENTATION_ABS
 
@@ -378,5 +390,29 @@ EXIT:
 
 }
 
+bool OMXCameraAdapter::reprocessBuffersRegistered(CameraBuffer *bufArr, int num)
+{
+    OMXCameraPortParameters *portData = NULL;
+
+    portData = &mCameraAdapterParameters.mCameraPortParams[mCameraAdapterParameters.mVideoInPortIndex];
+
+    if (!mReprocConfigured || (num != mReprocNumBufs)) {
+        return false;
+    }
+
+    for (int index = 0 ; index < num ; index++) {
+        OMX_BUFFERHEADERTYPE *pBufferHdr = portData->mBufferHeader[index];
+
+        // Only the OMX buffer identifies the buffer, the CameraBuffer array
+        // is allocated again by the buffer source for every reprocess()
+        if ( (NULL == pBufferHdr) ||
+             (pBufferHdr->pBuffer != (OMX_U8*)camera_buffer_get_omx_ptr(&bufArr[index])) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 } // namespace Camera
 } // namespace Ti
@@ -98,6 +98,9 @@ status_t OMXCameraAdapter::doZoom(int index)
         ret = -EINVAL;
         }
 
+    //Any zoom applied through OMX drops the display crop fast path
+    mDisplayZoom = 0;
+
     if (mPreviousZoomIndx == index )
         {
         return NO_ERROR;
@@ -130,6 +133,47 @@ status_t OMXCameraAdapter::doZoom(int index)
     return ret;
 }
 
+status_t OMXCameraAdapter::doSmoothZoomStep(unsigned int index)
+{
+    status_t ret = NO_ERROR;
+    uint64_t ratio;
+    unsigned int anchor;
+
+    //The encoder gets the full frame, so while recording every step
+    //still has to go through OMX
+    if ( !mSmoothZoomCrop || mRecording || ( ZOOM_STAGES <= index ) ) {
+        return doZoom(index);
+    }
+
+    ratio = ( (uint64_t) ZOOM_STEPS[index] << 16 ) / ZOOM_STEPS[mPreviousZoomIndx];
+
+    // Cropping can only zoom in on top of the sensor output, so
+    // reconfigure OMX once the step leaves the crop margin. When zooming
+    // out pick the widest step towards the target that still keeps the
+    // current one reachable by crop, so the following steps stay cheap.
+    if ( ( ratio < (uint64_t) ZOOM_STEPS[0] ) || ( ratio > ZOOM_CROP_MAX ) ) {
+        anchor = index;
+        while ( ( anchor > mTargetZoomIdx ) &&
+                ( ( ( (uint64_t) ZOOM_STEPS[index] << 16 ) / ZOOM_STEPS[anchor - 1] ) <= ZOOM_CROP_MAX ) ) {
+            anchor--;
+        }
+
+        CAMHAL_LOGDB("Smooth zoom step %u outside crop margin, OMX zoom %u -> %u",
+                     index, mPreviousZoomIndx, anchor);
+
+        ret = doZoom(anchor);
+        if ( NO_ERROR != ret ) {
+            return ret;
+        }
+
+        ratio = ( (uint64_t) ZOOM_STEPS[index] << 16 ) / ZOOM_STEPS[mPreviousZoomIndx];
+    }
+
+    mDisplayZoom = ( ratio > (uint64_t) ZOOM_STEPS[0] ) ? (uint32_t) ratio : 0;
+
+    return ret;
+}
+
 status_t OMXCameraAdapter::advanceZoom()
 {
     status_t ret = NO_ERROR;
@@ -166,7 +210,15 @@ status_t OMXCameraAdapter::advanceZoom()
             mCurrentZoomIdx = mTargetZoomIdx;
             }
 
-        ret = doZoom(mCurrentZoomIdx);
+        if ( ( ZOOM_ACTIVE & state ) && ( mCurrentZoomIdx != mTargetZoomIdx ) )
+            {
+            ret = doSmoothZoomStep(mCurrentZoomIdx);
+            }
+        else
+            {
+            //Final position always lands in OMX so capture and video see it
+            ret = doZoom(mCurrentZoomIdx);
+            }
 
         if ( ZOOM_ACTIVE & state )
             {
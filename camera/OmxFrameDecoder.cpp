@@ -158,8 +158,10 @@ OMX_ERRORTYPE OmxFrameDecoder::fillBufferDoneCallback(OMX_HANDLETYPE hComponent,
 }
 
 OmxFrameDecoder::OmxFrameDecoder(DecoderType type)
-    : mOmxInialized(false), mCurrentState(OmxDecoderState_Unloaded), mPreviousState(OmxDecoderState_Unloaded),
-    mStopping(false), mDecoderType(type), mIsNeedCheckDHT(true), mAlwaysAppendDHT(false) {
+    : mOmxInialized(false), mHandleComp(NULL),
+    mCurrentState(OmxDecoderState_Unloaded), mPreviousState(OmxDecoderState_Unloaded),
+    mStopping(false), mDecoderType(type), mIsNeedCheckDHT(true), mAlwaysAppendDHT(false),
+    mInputBufferSize(0), mInputsInFlight(0) {
 }
 
 OmxFrameDecoder::~OmxFrameDecoder() {
@@ -175,6 +177,7 @@ OMX_ERRORTYPE OmxFrameDecoder::emptyBufferDoneHandler(OMX_BUFFERHEADERTYPE* pBuf
 
     android::AutoMutex itemLock(in->getLock());
     in->setStatus((getOmxState() == OmxDecoderState_Executing) ? BufferStatus_InDecoded : BufferStatus_InQueued);
+    android_atomic_dec(&mInputsInFlight);
 
     return OMX_ErrorNone;
 }
@@ -192,6 +195,13 @@ OMX_ERRORTYPE OmxFrameDecoder::fillBufferDoneHandler(OMX_BUFFERHEADERTYPE* pBuff
     out->setTimestamp(pBuffHead->nTimeStamp);
     out->setStatus((getOmxState() == OmxDecoderState_Executing) ? BufferStatus_OutFilled : BufferStatus_OutQueued);
 
+    // The input timestamp is the V4L dequeue time
+    if (pBuffHead->nFilledLen && pBuffHead->nTimeStamp) {
+        const nsecs_t decodeTime = systemTime(SYSTEM_TIME_MONOTONIC) - pBuffHead->nTimeStamp;
+        CAMHAL_LOGV("Frame %d decoded in %lld us", index, decodeTime / 1000);
+        CameraPerfCounters::latency(CameraPerfCounters::LATENCY_FRAME_DECODE, decodeTime);
+    }
+
     return OMX_ErrorNone;
 }
 
@@ -436,6 +446,28 @@ void OmxFrameDecoder::queueOutputBuffers() {
     LOG_FUNCTION_NAME_EXIT;
 }
 
+void OmxFrameDecoder::doQueueOutputBuffer(int id) {
+
+    LOG_FUNCTION_NAME;
+
+    if (getOmxState() != OmxDecoderState_Executing) {
+        // Picked up by queueOutputBuffers() once we get there
+        return;
+    }
+
+    android::sp<MediaBuffer> &outBuffer = mOutBuffers->editItemAt(id);
+    android::AutoMutex bufferLock(outBuffer->getLock());
+    if (outBuffer->getStatus() == BufferStatus_OutQueued) {
+        outBuffer->setStatus(BufferStatus_OutWaitForFill);
+        OMX_BUFFERHEADERTYPE *pOutBufHdr = mOutBufferHeaders[outBuffer->bufferId];
+        CAMHAL_LOGV("Fill this buffer bh=%p id=%d", pOutBufHdr, outBuffer->bufferId);
+        status_t status = omxFillThisBuffer(pOutBufHdr);
+        CAMHAL_ASSERT(status == NO_ERROR);
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
 void OmxFrameDecoder::doProcessInputBuffer() {
 
     LOG_FUNCTION_NAME;
@@ -457,18 +489,29 @@ void OmxFrameDecoder::doProcessInputBuffer() {
     }
 
     if (getOmxState() == OmxDecoderState_Executing) {
+        // Outputs first, so the decoder has somewhere to put what it gets
+        queueOutputBuffers();
         for (size_t i = 0; i < mInQueue.size(); i++) {
             int index = mInQueue[i];
             CAMHAL_LOGD("Got in inqueue[%d] buffer id=%d", i, index);
             android::sp<MediaBuffer> &inBuffer = mInBuffers->editItemAt(index);
             android::AutoMutex bufferLock(inBuffer->getLock());
             if (inBuffer->getStatus() == BufferStatus_InQueued) {
+                if ((mParams.decodeDepth > 0) &&
+                        (android_atomic_acquire_load(&mInputsInFlight) >= mParams.decodeDepth)) {
+                    // Stays queued until an EmptyBufferDone frees a slot
+                    break;
+                }
+                android_atomic_inc(&mInputsInFlight);
                 OMX_BUFFERHEADERTYPE *pInBufHdr = mInBufferHeaders[index];
                 inBuffer->setStatus(BufferStatus_InWaitForEmpty);
-                omxEmptyThisBuffer(inBuffer, pInBufHdr);
+                if (omxEmptyThisBuffer(inBuffer, pInBufHdr) != NO_ERROR) {
+                    // Hand it back so V4L gets the buffer again
+                    inBuffer->setStatus(BufferStatus_InDecoded);
+                    android_atomic_dec(&mInputsInFlight);
+                }
             }
         }
-        queueOutputBuffers();
     }
 
     LOG_FUNCTION_NAME_EXIT;
@@ -525,15 +568,12 @@ status_t OmxFrameDecoder::omxEmptyThisBuffer(android::sp<MediaBuffer>& inBuffer,
 
     LOG_FUNCTION_NAME;
 
-    OMX_PARAM_PORTDEFINITIONTYPE def;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
 
-    InitOMXParams(&def);
-    def.nPortIndex = PortIndexInput;
-    omxGetParameter(OMX_IndexParamPortDefinition, &def);
+    // Port size is cached at allocation, no need for a round trip per frame
     CAMHAL_LOGD("Founded id for empty is %d ", inBuffer->bufferId);
-    if (inBuffer->filledLen > def.nBufferSize) {
-        CAMHAL_LOGE("Can't copy IN buffer due to it too small %d than needed %d", def.nBufferSize, inBuffer->filledLen);
+    if (inBuffer->filledLen > (int)mInputBufferSize) {
+        CAMHAL_LOGE("Can't copy IN buffer due to it too small %d than needed %d", mInputBufferSize, inBuffer->filledLen);
         return UNKNOWN_ERROR;
     }
 
@@ -628,6 +668,8 @@ status_t OmxFrameDecoder::allocateBuffersInput() {
     omxSetParameter(OMX_IndexParamPortDefinition, &def);
 
     mInBufferHeaders.clear();
+    mInputBufferSize = def.nBufferSize;
+    android_atomic_release_store(0, &mInputsInFlight);
 
     for (size_t i = 0; i < mInBuffers->size(); i++) {
         CAMHAL_LOGD("Will do OMX_AllocateBuffer for input port with size %d id=%d", def.nBufferSize, i);
@@ -668,8 +710,7 @@ status_t OmxFrameDecoder::getAndConfigureDecoder() {
     ret = setComponentRole();
     if (ret != NO_ERROR) {
         CAMHAL_LOGE("setComponentRole returned error 0x%x", ret);
-        OMX_Deinit();
-        mOmxInialized = false;
+        releaseComponent();
         return ret;
     }
     disablePortSync(PortIndexOutput);
@@ -677,11 +718,17 @@ status_t OmxFrameDecoder::getAndConfigureDecoder() {
     enablePortSync(PortIndexOutput);
     if (ret != NO_ERROR) {
         CAMHAL_LOGE("Can't set output format error 0x%x", ret);
-        OMX_Deinit();
-        mOmxInialized = false;
+        releaseComponent();
+        return ret;
+    }
+    // Without native buffers the decoder can't write into the preview
+    // gralloc buffers directly, so don't run at all
+    ret = enableGrallockHandles();
+    if (ret != NO_ERROR) {
+        CAMHAL_LOGE("Can't enable gralloc handles error 0x%x", ret);
+        releaseComponent();
         return ret;
     }
-    enableGrallockHandles();
     return NO_ERROR;
 }
 
@@ -692,8 +739,6 @@ status_t OmxFrameDecoder::switchToIdle() {
     status_t ret = omxSendCommand(OMX_CommandStateSet, OMX_StateIdle);
     if (ret != NO_ERROR) {
         CAMHAL_LOGE("Can't omxSendCommandt error 0x%x", ret);
-        OMX_Deinit();
-        mOmxInialized = false;
         return ret;
     }
 
@@ -725,6 +770,11 @@ status_t OmxFrameDecoder::doStart() {
     OMX_ERRORTYPE eError;
 
     ret = getAndConfigureDecoder();
+    if (ret != NO_ERROR) {
+        // Usually another client holds the component
+        CAMHAL_LOGE("Decoder component unavailable 0x%x", ret);
+        return ret;
+    }
 
 #if 0
     OMX_TI_PARAM_ENHANCEDPORTRECONFIG tParamStruct;
@@ -741,6 +791,12 @@ status_t OmxFrameDecoder::doStart() {
 
     // Transition to IDLE
     ret = switchToIdle();
+    if (ret != NO_ERROR) {
+        CAMHAL_LOGE("Decoder failed to reach IDLE 0x%x", ret);
+        android::AutoMutex lock(mHwLock);
+        releaseComponent();
+        return ret;
+    }
     dumpPortSettings(PortIndexInput);
     dumpPortSettings(PortIndexOutput);
 
@@ -937,12 +993,35 @@ void OmxFrameDecoder::freeBuffersOnInput() {
     LOG_FUNCTION_NAME_EXIT;
 }
 
+void OmxFrameDecoder::releaseComponent() {
+    LOG_FUNCTION_NAME;
+
+    freeBuffersOnOutput();
+    freeBuffersOnInput();
+    if (mHandleComp != NULL) {
+        OMX_FreeHandle(mHandleComp);
+        mHandleComp = NULL;
+    }
+    if (mOmxInialized) {
+        OMX_Deinit();
+        mOmxInialized = false;
+    }
+    commitState(OmxDecoderState_Unloaded);
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
 void OmxFrameDecoder::doStop() {
     LOG_FUNCTION_NAME;
 
     mStopping = true;
     android::AutoMutex lock(mHwLock);
 
+    if (getOmxState() == OmxDecoderState_Unloaded) {
+        // Never got the component, or it has already been released
+        return;
+    }
+
     CAMHAL_LOGD("HwFrameDecoder::doStop state id=%d", getOmxState());
 
     if ((getOmxState() == OmxDecoderState_Executing) || (getOmxState() == OmxDecoderState_Reconfigure)) {
@@ -986,6 +1065,7 @@ void OmxFrameDecoder::doStop() {
 
     CAMHAL_LOGD("Before OMX_FreeHandle ....");
     OMX_FreeHandle(mHandleComp);
+    mHandleComp = NULL;
     CAMHAL_LOGD("After OMX_FreeHandle ....");
 
     LOG_FUNCTION_NAME_EXIT;
@@ -14,68 +14,279 @@
  * limitations under the License.
  */
 
+#include <cutils/properties.h>
 #include "Common.h"
 #include "SwFrameDecoder.h"
 
 namespace Ti {
 namespace Camera {
 
-SwFrameDecoder::SwFrameDecoder()
-: mjpegWithHdrSize(0), mJpegWithHeaderBuffer(NULL) {
+SwFrameDecoder::DecodeWorker::DecodeWorker(SwFrameDecoder *decoder, DecodeContext *context)
+: android::Thread(false), mDecoder(decoder), mContext(context),
+  mBusy(false), mInIndex(-1), mOutIndex(-1) {
+}
+
+bool SwFrameDecoder::DecodeWorker::post(int inIndex, int outIndex) {
+    android::AutoMutex lock(mLock);
+    if (mBusy) {
+        return false;
+    }
+    mBusy = true;
+    mInIndex = inIndex;
+    mOutIndex = outIndex;
+    mCondition.broadcast();
+    return true;
+}
+
+void SwFrameDecoder::DecodeWorker::waitIdle() {
+    android::AutoMutex lock(mLock);
+    while (mBusy) {
+        mCondition.wait(mLock);
+    }
+}
+
+void SwFrameDecoder::DecodeWorker::exit() {
+    {
+        android::AutoMutex lock(mLock);
+        requestExit();
+        mCondition.broadcast();
+    }
+    requestExitAndWait();
+}
+
+bool SwFrameDecoder::DecodeWorker::threadLoop() {
+    int inIndex, outIndex;
+
+    {
+        android::AutoMutex lock(mLock);
+        while (!mBusy && !exitPending()) {
+            mCondition.wait(mLock);
+        }
+        if (!mBusy) {
+            return false;
+        }
+        inIndex = mInIndex;
+        outIndex = mOutIndex;
+    }
+
+    mDecoder->decodeFrame(*mContext, inIndex, outIndex);
+
+    android::AutoMutex lock(mLock);
+    mBusy = false;
+    mCondition.broadcast();
+
+    return true;
+}
+
+SwFrameDecoder::SwFrameDecoder(bool lockOutput)
+: mjpegWithHdrSize(0), mLockOutput(lockOutput), mThreadCount(1) {
+    char value[PROPERTY_VALUE_MAX];
+
+    // Default to one decode thread per online CPU
+    property_get("camera.v4l.jpeg_threads", value, "0");
+    mThreadCount = atoi(value);
+    if (mThreadCount <= 0) {
+        mThreadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (mThreadCount < 1) {
+        mThreadCount = 1;
+    } else if (mThreadCount > MAX_DECODE_THREADS) {
+        mThreadCount = MAX_DECODE_THREADS;
+    }
+    CAMHAL_LOGD("Using %d MJPEG decode thread(s)", mThreadCount);
 }
 
 SwFrameDecoder::~SwFrameDecoder() {
-    delete [] mJpegWithHeaderBuffer;
-    mJpegWithHeaderBuffer = NULL;
+    doStop();
+    for (int i = 0; i < MAX_DECODE_THREADS; i++) {
+        delete [] mContexts[i].jpegWithHeaderBuffer;
+        mContexts[i].jpegWithHeaderBuffer = NULL;
+    }
 }
 
 
 void SwFrameDecoder::doConfigure(const DecoderParameters& params) {
     LOG_FUNCTION_NAME;
 
-    mjpegWithHdrSize = (mParams.width * mParams.height / 2) +
-            mJpgdecoder.readDHTSize();
-    if (mJpegWithHeaderBuffer != NULL) {
-        delete [] mJpegWithHeaderBuffer;
-        mJpegWithHeaderBuffer = NULL;
+    size_t jpegSize = mParams.width * mParams.height / 2;
+    // The camera may deliver a larger size than asked for, see decodeFrame()
+    for (size_t i = 0; (mInBuffers != NULL) && (i < mInBuffers->size()); i++) {
+        if (mInBuffers->itemAt(i)->size > jpegSize) {
+            jpegSize = mInBuffers->itemAt(i)->size;
+        }
+    }
+    mjpegWithHdrSize = jpegSize + Decoder_libjpeg::readDHTSize();
+    for (int i = 0; i < mThreadCount; i++) {
+        if (mContexts[i].jpegWithHeaderBuffer != NULL) {
+            delete [] mContexts[i].jpegWithHeaderBuffer;
+            mContexts[i].jpegWithHeaderBuffer = NULL;
+        }
+        mContexts[i].jpegWithHeaderBuffer = new unsigned char[mjpegWithHdrSize];
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+status_t SwFrameDecoder::doStart() {
+    LOG_FUNCTION_NAME;
+
+    if ((mThreadCount > 1) && mWorkers.isEmpty()) {
+        for (int i = 0; i < mThreadCount; i++) {
+            android::sp<DecodeWorker> worker = new DecodeWorker(this, &mContexts[i]);
+            if (worker->run("SwFrameDecoder", android::PRIORITY_URGENT_DISPLAY) != NO_ERROR) {
+                CAMHAL_LOGE("Couldn't start decode thread %d", i);
+                break;
+            }
+            mWorkers.push_back(worker);
+        }
     }
-    mJpegWithHeaderBuffer = new unsigned char[mjpegWithHdrSize];
 
     LOG_FUNCTION_NAME_EXIT;
+    return NO_ERROR;
 }
 
+void SwFrameDecoder::doStop() {
+    LOG_FUNCTION_NAME;
+
+    // Frames in flight still write to the output buffers, let them finish
+    for (size_t i = 0; i < mWorkers.size(); i++) {
+        mWorkers[i]->waitIdle();
+        mWorkers[i]->exit();
+    }
+    mWorkers.clear();
+
+    LOG_FUNCTION_NAME_EXIT;
+}
 
 void SwFrameDecoder::doProcessInputBuffer() {
     LOG_FUNCTION_NAME;
+
+    for (size_t i = 0; i < mInQueue.size(); i++) {
+        int inIndex = mInQueue[i];
+        int outIndex = -1;
+        android::sp<MediaBuffer>& inBuffer = mInBuffers->editItemAt(inIndex);
+
+        {
+            android::AutoMutex lock(inBuffer->getLock());
+            if (inBuffer->getStatus() != BufferStatus_InQueued) {
+                continue;
+            }
+        }
+
+        for (size_t j = 0; j < mOutQueue.size(); j++) {
+            android::sp<MediaBuffer>& outBuffer = mOutBuffers->editItemAt(mOutQueue[j]);
+            android::AutoMutex lock(outBuffer->getLock());
+            if (outBuffer->getStatus() == BufferStatus_OutQueued) {
+                outBuffer->setStatus(BufferStatus_OutWaitForFill);
+                outIndex = mOutQueue[j];
+                break;
+            }
+        }
+
+        {
+            android::AutoMutex lock(inBuffer->getLock());
+            inBuffer->setStatus((outIndex < 0) ? BufferStatus_InDecoded :
+                                                 BufferStatus_InWaitForEmpty);
+        }
+
+        // Holding the frame would starve V4L of buffers, drop it instead
+        if (outIndex < 0) {
+            CAMHAL_LOGD("No output buffer, dropping MJPEG frame %d", inIndex);
+            continue;
+        }
+
+        if (mWorkers.isEmpty()) {
+            decodeFrame(mContexts[0], inIndex, outIndex);
+            continue;
+        }
+
+        bool posted = false;
+        for (size_t k = 0; k < mWorkers.size() && !posted; k++) {
+            posted = mWorkers[k]->post(inIndex, outIndex);
+        }
+
+        if (!posted) {
+            // All threads busy: keep latency bounded by skipping this frame
+            CAMHAL_LOGD("Decode threads busy, dropping MJPEG frame %d", inIndex);
+            {
+                android::AutoMutex lock(inBuffer->getLock());
+                inBuffer->setStatus(BufferStatus_InDecoded);
+            }
+            android::sp<MediaBuffer>& outBuffer = mOutBuffers->editItemAt(outIndex);
+            android::AutoMutex lock(outBuffer->getLock());
+            outBuffer->setStatus(BufferStatus_OutQueued);
+        }
+    }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+void SwFrameDecoder::decodeFrame(DecodeContext &context, int inIndex, int outIndex) {
+    LOG_FUNCTION_NAME;
     nsecs_t timestamp = 0;
 
     CAMHAL_LOGV("Will add header to MJPEG");
     int final_jpg_sz = 0;
     {
-        int inIndex = mInQueue.itemAt(0);
         android::sp<MediaBuffer>& inBuffer = mInBuffers->editItemAt(inIndex);
         android::AutoMutex lock(inBuffer->getLock());
         timestamp = inBuffer->getTimestamp();
-        final_jpg_sz = mJpgdecoder.appendDHT(
+        final_jpg_sz = context.jpgDecoder.appendDHT(
                 reinterpret_cast<unsigned char*>(inBuffer->buffer),
-                inBuffer->filledLen, mJpegWithHeaderBuffer, mjpegWithHdrSize);
+                inBuffer->filledLen, context.jpegWithHeaderBuffer, mjpegWithHdrSize);
         inBuffer->setStatus(BufferStatus_InDecoded);
     }
     CAMHAL_LOGV("Added header to MJPEG");
+
+    // The buffer is ours while it is OutWaitForFill, only the status change needs
+    // its lock; holding it over the decode would stall the capture thread
+    android::sp<MediaBuffer>& outBuffer = mOutBuffers->editItemAt(outIndex);
+    CameraBuffer* buffer;
     {
-        int outIndex = mOutQueue.itemAt(0);
-        android::sp<MediaBuffer>& outBuffer = mOutBuffers->editItemAt(outIndex);
         android::AutoMutex lock(outBuffer->getLock());
-        CameraBuffer* buffer = reinterpret_cast<CameraBuffer*>(outBuffer->buffer);
-        if (!mJpgdecoder.decode(mJpegWithHeaderBuffer, final_jpg_sz,
-                reinterpret_cast<unsigned char*>(buffer->mapped), 4096)) {
+        buffer = reinterpret_cast<CameraBuffer*>(outBuffer->buffer);
+    }
+
+    unsigned char *dst = reinterpret_cast<unsigned char*>(buffer->mapped);
+    void *y_uv[2];
+    bool decoded;
+
+    if (mLockOutput) {
+        android::GraphicBufferMapper &mapper = android::GraphicBufferMapper::get();
+        android::Rect bounds(mParams.width, mParams.height);
+        if (mapper.lock(*(buffer_handle_t *) buffer->opaque, CAMHAL_GRALLOC_USAGE,
+                        bounds, y_uv) < 0) {
+            CAMHAL_LOGEA("Unable to lock output buffer");
+            android::AutoMutex lock(outBuffer->getLock());
+            outBuffer->setStatus(BufferStatus_OutQueued);
+            return;
+        }
+        dst = reinterpret_cast<unsigned char*>(y_uv[0]);
+    }
+
+    // Cameras that snap to a larger MJPEG size than the preview get a scaled decode
+    decoded = context.jpgDecoder.decode(context.jpegWithHeaderBuffer, final_jpg_sz,
+                                        dst, 4096, mParams.width, mParams.height);
+
+    if (mLockOutput) {
+        android::GraphicBufferMapper::get().unlock(*(buffer_handle_t *) buffer->opaque);
+    }
+
+    {
+        android::AutoMutex lock(outBuffer->getLock());
+        if (!decoded) {
             CAMHAL_LOGEA("Error while decoding JPEG");
+            outBuffer->setStatus(BufferStatus_OutQueued);
             return;
         }
+        outBuffer->setOffset(0);
         outBuffer->setTimestamp(timestamp);
         outBuffer->setStatus(BufferStatus_OutFilled);
     }
-    CAMHAL_LOGV("JPEG decoded!");
+
+    const nsecs_t decodeTime = systemTime(SYSTEM_TIME_MONOTONIC) - timestamp;
+    CAMHAL_LOGV("JPEG decoded! Frame %d took %lld us", inIndex, decodeTime / 1000);
+    CameraPerfCounters::latency(CameraPerfCounters::LATENCY_FRAME_DECODE, decodeTime);
 
     LOG_FUNCTION_NAME_EXIT;
 }
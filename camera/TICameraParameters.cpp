@@ -73,8 +73,11 @@ const char TICameraParameters::KEY_ZOOM_BRACKETING_RANGE[] = "zoom-bracketing-ra
 const char TICameraParameters::KEY_TEMP_BRACKETING[] = "temporal-bracketing";
 const char TICameraParameters::KEY_TEMP_BRACKETING_RANGE_POS[] = "temporal-bracketing-range-positive";
 const char TICameraParameters::KEY_TEMP_BRACKETING_RANGE_NEG[] = "temporal-bracketing-range-negative";
+const char TICameraParameters::KEY_ZSL_RING_FRAMES[] = "zsl-ring-frames";
 const char TICameraParameters::KEY_FLUSH_SHOT_CONFIG_QUEUE[] = "flush-shot-config-queue";
 const char TICameraParameters::KEY_MEASUREMENT_ENABLE[] = "measurement";
+const char TICameraParameters::KEY_FACE_DETECTION_RATE[] = "face-detection-rate";
+const char TICameraParameters::KEY_FACE_DETECTION_SMOOTHING[] = "face-detection-smoothing";
 const char TICameraParameters::KEY_GBCE[] = "gbce";
 const char TICameraParameters::KEY_GBCE_SUPPORTED[] = "gbce-supported";
 const char TICameraParameters::KEY_GLBCE[] = "glbce";
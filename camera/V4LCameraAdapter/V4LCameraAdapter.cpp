@@ -56,6 +56,10 @@ namespace Camera {
 //Proto Types
 static void convertYUV422i_yuyvTouyvy(uint8_t *src, uint8_t *dest, size_t size );
 static void convertYUV422ToNV12Tiler(unsigned char *src, unsigned char *dest, int width, int height );
+static void copyNV12ToTiler(unsigned char *src, unsigned char *dest, int width, int height, int srcStride);
+
+//Line stride of the preview (Tiler) buffers
+static const int PREVIEW_BUFFER_STRIDE = 4096;
 static void convertYUV422ToNV12(unsigned char *src, unsigned char *dest, int width, int height );
 
 android::Mutex gV4LAdapterLock;
@@ -86,7 +90,41 @@ static void debugShowFPS()
 /*--------------------V4L wrapper functions -------------------------------*/
 
 bool V4LCameraAdapter::isNeedToUseDecoder() const {
-    return mPixelFormat != V4L2_PIX_FMT_YUYV;
+    return (mPixelFormat != V4L2_PIX_FMT_YUYV) && (mPixelFormat != V4L2_PIX_FMT_NV12);
+}
+
+status_t V4LCameraAdapter::startDecoder() {
+    status_t ret;
+    FrameDecoder *fallback;
+
+    for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
+       mDecoder->queueOutputBuffer(i);
+       CAMHAL_LOGV("Queued output buffer with id=%d ", i);
+    }
+
+    ret = mDecoder->start();
+    if ((NO_ERROR == ret) || (V4L2_PIX_FMT_MJPEG != mPixelFormat)) {
+        return ret;
+    }
+
+    // The OMX decoder is typically held by another client, decode on the
+    // CPU rather than not showing preview at all
+    fallback = DecoderFactory::createFallbackDecoder(DecoderType_MJPEG, mExternalLocking);
+    if (NULL == fallback) {
+        return ret;
+    }
+    CAMHAL_LOGW("MJPEG HW decoder start failed 0x%x, falling back to SW decoding", ret);
+
+    delete mDecoder;
+    mDecoder = fallback;
+    mDecoder->registerInputBuffers(&mInBuffers);
+    mDecoder->configure(mDecoderParams);
+    mDecoder->registerOutputBuffers(&mOutBuffers);
+    for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
+       mDecoder->queueOutputBuffer(i);
+    }
+
+    return mDecoder->start();
 }
 
 status_t V4LCameraAdapter::v4lIoctl (int fd, int req, void* argp) {
@@ -110,6 +148,7 @@ status_t V4LCameraAdapter::v4lInitMmap(int& count, int width, int height) {
     //First allocate adapter internal buffers at V4L level for USB Cam
     //These are the buffers from which we will copy the data into overlay buffers
     /* Check if camera can handle NB_BUFFER buffers */
+    mMemoryType = V4L2_MEMORY_MMAP;
     mVideoInfo->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     mVideoInfo->rb.memory = V4L2_MEMORY_MMAP;
     mVideoInfo->rb.count = count;
@@ -163,7 +202,9 @@ status_t V4LCameraAdapter::v4lInitMmap(int& count, int width, int height) {
         params.height = height;
         params.inputBufferCount = count;
         params.outputBufferCount = count;
+        params.decodeDepth = mDecodeDepth;
         mDecoder->configure(params);
+        mDecoderParams = params;
     }
 
 
@@ -174,9 +215,19 @@ status_t V4LCameraAdapter::v4lInitMmap(int& count, int width, int height) {
     return ret;
 }
 
-status_t V4LCameraAdapter::v4lInitUsrPtr(int& count) {
+status_t V4LCameraAdapter::v4lInitUsrPtr(int& count, int width, int height) {
     status_t ret = NO_ERROR;
 
+    LOG_FUNCTION_NAME;
+
+    //The driver fills the preview buffers directly, nothing is copied
+    for (int i = 0; i < count; i++) {
+        if ((NULL == mPreviewBufs[i]) || (NULL == mPreviewBufs[i]->mapped)) {
+            CAMHAL_LOGEB("Preview buffer %d is not mapped", i);
+            return BAD_VALUE;
+        }
+    }
+
     mVideoInfo->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     mVideoInfo->rb.memory = V4L2_MEMORY_USERPTR;
     mVideoInfo->rb.count = count;
@@ -188,9 +239,39 @@ status_t V4LCameraAdapter::v4lInitUsrPtr(int& count) {
     }
 
     count = mVideoInfo->rb.count;
+    mMemoryType = V4L2_MEMORY_USERPTR;
+
+    mInBuffers.clear();
+    for (int i = 0; i < count; i++) {
+        mVideoInfo->mem[i] = mPreviewBufs[i]->mapped;
+        MediaBuffer* buffer = new MediaBuffer(i, mVideoInfo->mem[i],
+                                              mVideoInfo->format.fmt.pix.sizeimage);
+        mInBuffers.push_back(buffer);
+    }
+
+    CAMHAL_LOGDB("Streaming %d USERPTR buffers of %dx%d", count, width, height);
+
+    LOG_FUNCTION_NAME_EXIT;
     return ret;
 }
 
+status_t V4LCameraAdapter::v4lInitPreviewBuffers(int& count, int width, int height) {
+    status_t ret;
+
+    //USERPTR only works if the driver took the preview buffer stride
+    if (mUserPtrRequested &&
+        (V4L2_PIX_FMT_NV12 == mVideoInfo->format.fmt.pix.pixelformat) &&
+        (PREVIEW_BUFFER_STRIDE == (int) mVideoInfo->format.fmt.pix.bytesperline)) {
+        ret = v4lInitUsrPtr(count, width, height);
+        if (NO_ERROR == ret) {
+            return ret;
+        }
+        CAMHAL_LOGW("USERPTR streaming unavailable, copying from MMAP buffers");
+    }
+
+    return v4lInitMmap(count, width, height);
+}
+
 status_t V4LCameraAdapter::v4lStartStreaming () {
     status_t ret = NO_ERROR;
     enum v4l2_buf_type bufType;
@@ -243,11 +324,12 @@ status_t V4LCameraAdapter::v4lStopStreaming (int nBufferCount) {
         }
         mVideoInfo->isStreaming = false;
 
-        /* Unmap buffers */
+        /* Unmap buffers, USERPTR ones belong to the display */
         mVideoInfo->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        mVideoInfo->buf.memory = V4L2_MEMORY_MMAP;
+        mVideoInfo->buf.memory = mMemoryType;
         for (int i = 0; i < nBufferCount; i++) {
-            if (munmap(mVideoInfo->mem[i], mVideoInfo->buf.length) < 0) {
+            if ((V4L2_MEMORY_MMAP == mMemoryType) &&
+                (munmap(mVideoInfo->mem[i], mVideoInfo->buf.length) < 0)) {
                 CAMHAL_LOGEA("munmap() failed");
             }
             mVideoInfo->mem[i] = 0;
@@ -255,7 +337,7 @@ status_t V4LCameraAdapter::v4lStopStreaming (int nBufferCount) {
 
         //free the memory allocated during REQBUFS, by setting the count=0
         mVideoInfo->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        mVideoInfo->rb.memory = V4L2_MEMORY_MMAP;
+        mVideoInfo->rb.memory = mMemoryType;
         mVideoInfo->rb.count = 0;
 
         ret = v4lIoctl(mCameraHandle, VIDIOC_REQBUFS, &mVideoInfo->rb);
@@ -289,6 +371,11 @@ status_t V4LCameraAdapter::v4lSetFormat (int width, int height, uint32_t pix_for
     mVideoInfo->format.fmt.pix.width = width;
     mVideoInfo->format.fmt.pix.height = height;
     mVideoInfo->format.fmt.pix.pixelformat = pix_format;
+    mVideoInfo->format.fmt.pix.bytesperline = 0;
+    if (mUserPtrRequested && (V4L2_PIX_FMT_NV12 == pix_format)) {
+        //Ask for the preview buffer layout so frames can land in place
+        mVideoInfo->format.fmt.pix.bytesperline = PREVIEW_BUFFER_STRIDE;
+    }
 
     ret = v4lIoctl(mCameraHandle, VIDIOC_S_FMT, &mVideoInfo->format);
     if (ret < 0) {
@@ -321,33 +408,22 @@ status_t V4LCameraAdapter::restartPreview ()
         goto EXIT;
     }
 
-    ret = v4lInitMmap(mPreviewBufferCount, width, height);
+    ret = v4lInitPreviewBuffers(mPreviewBufferCount, width, height);
     if (ret < 0) {
-        CAMHAL_LOGEB("v4lInitMmap Failed: %s", strerror(errno));
+        CAMHAL_LOGEB("v4lInitPreviewBuffers Failed: %s", strerror(errno));
         goto EXIT;
     }
 
     for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
-
-        v4l2_buffer buf;
-        buf.index = i;
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-
-        ret = v4lIoctl(mCameraHandle, VIDIOC_QBUF, &buf);
+        ret = returnBufferToV4L(i);
         if (ret < 0) {
-            CAMHAL_LOGEA("VIDIOC_QBUF Failed");
             goto EXIT;
         }
         nQueued++;
     }
 
     if (isNeedToUseDecoder()) {
-        for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
-           mDecoder->queueOutputBuffer(i);
-           CAMHAL_LOGV("Queued output buffer with id=%d ", i);
-        }
-        mDecoder->start();
+        startDecoder();
     }
 
     ret = v4lStartStreaming();
@@ -469,14 +545,9 @@ status_t V4LCameraAdapter::fillThisBuffer(CameraBuffer *frameBuf, CameraFrame::F
         }
 
     } else {
-        v4l2_buffer buf;
-        buf.index = idx;
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
         CAMHAL_LOGD("Will return buffer to V4L with id=%d", idx);
-        ret = v4lIoctl(mCameraHandle, VIDIOC_QBUF, &buf);
+        ret = returnBufferToV4L(idx);
         if (ret < 0) {
-           CAMHAL_LOGEA("VIDIOC_QBUF Failed");
            goto EXIT;
         }
 
@@ -641,15 +712,18 @@ status_t V4LCameraAdapter::UseBuffersPreview(CameraBuffer *bufArr, int num)
         goto EXIT;
     }
 
+    for (int i = 0; i < num; i++) {
+        //Associate each Camera internal buffer with the one from Overlay
+        mPreviewBufs[i] = &bufArr[i];
+    }
+
     mParams.getPreviewSize(&width, &height);
-    ret = v4lInitMmap(num, width, height);
+    ret = v4lInitPreviewBuffers(num, width, height);
 
     mOutBuffers.clear();
 
     if (ret == NO_ERROR) {
         for (int i = 0; i < num; i++) {
-            //Associate each Camera internal buffer with the one from Overlay
-            mPreviewBufs[i] = &bufArr[i];
             MediaBuffer* buffer = new MediaBuffer(i, mPreviewBufs[i]);
             mOutBuffers.push_back(buffer);
             CAMHAL_LOGDB("Preview- buff [%d] = 0x%x length=%d",i, mPreviewBufs[i], mFrameQueue.valueFor(mPreviewBufs[i])->mLength);
@@ -862,13 +936,11 @@ status_t V4LCameraAdapter::startPreview()
     }
 
     for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
-        v4l2_buffer buf;
-
         memset (&mVideoInfo->buf, 0, sizeof (struct v4l2_buffer));
 
         mVideoInfo->buf.index = i;
         mVideoInfo->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        mVideoInfo->buf.memory = V4L2_MEMORY_MMAP;
+        mVideoInfo->buf.memory = mMemoryType;
 
         ret = v4lIoctl (mCameraHandle, VIDIOC_QUERYBUF, &mVideoInfo->buf);
         if (ret < 0) {
@@ -876,24 +948,15 @@ status_t V4LCameraAdapter::startPreview()
             return ret;
         }
 
-        buf.index = i;
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-
-        ret = v4lIoctl(mCameraHandle, VIDIOC_QBUF, &buf);
+        ret = returnBufferToV4L(i);
         if (ret < 0) {
-            CAMHAL_LOGEA("VIDIOC_QBUF Failed");
             goto EXIT;
         }
         nQueued++;
     }
 
     if (isNeedToUseDecoder()) {
-        for (int i = 0; i < mPreviewBufferCountQueueable; i++) {
-           mDecoder->queueOutputBuffer(i);
-           CAMHAL_LOGV("Queued output buffer with id=%d ", i);
-        }
-        mDecoder->start();
+        startDecoder();
     }
     ret = v4lStartStreaming();
 
@@ -983,8 +1046,9 @@ char * V4LCameraAdapter::GetFrame(int &index, int &filledLen)
     LOG_FUNCTION_NAME;
 
     v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = mMemoryType;
 
     /* DQ */
     // Some V4L drivers, notably uvc, protect each incoming call with
@@ -1110,7 +1174,8 @@ void V4LCameraAdapter::onOrientationEvent(uint32_t orientation, uint32_t tilt)
 {
     LOG_FUNCTION_NAME;
 
-    android::AutoMutex lock(mLock);
+    // Nothing to do with it yet, and the sensor thread must not take
+    // mLock away from the frame path just to find that out
 
     LOG_FUNCTION_NAME_EXIT;
 }
@@ -1126,10 +1191,13 @@ void V4LCameraAdapter::setupWorkingMode() {
         delete mDecoder;
         mDecoder = NULL;
     }
+    mExternalLocking = false;
+    mUserPtrRequested = false;
 
     switch (v4lMode) {
         case 0 : {
             mPixelFormat = V4L2_PIX_FMT_MJPEG;
+            mExternalLocking = true;
             mCameraHal->setExternalLocking(true);
             mDecoder = DecoderFactory::createDecoderByType(DecoderType_MJPEG, false);
             CAMHAL_LOGI("Using V4L preview format: V4L2_PIX_FMT_MJPEG with HW decoding");
@@ -1146,11 +1214,20 @@ void V4LCameraAdapter::setupWorkingMode() {
 
         case 2 : {
             mPixelFormat = V4L2_PIX_FMT_H264;
+            mExternalLocking = true;
             mCameraHal->setExternalLocking(true);
             mDecoder = DecoderFactory::createDecoderByType(DecoderType_H264, false);
             CAMHAL_LOGI("Using V4L preview format: V4L2_PIX_FMT_H264");
             break;
         }
+        case 4 : {
+            mPixelFormat = V4L2_PIX_FMT_NV12;
+            mUserPtrRequested = true;
+            mCameraHal->setExternalLocking(false);
+            CAMHAL_LOGI("Using V4L preview format: V4L2_PIX_FMT_NV12 with USERPTR streaming");
+            break;
+        }
+
         default:
         case 3 : {
             mCameraHal->setExternalLocking(false);
@@ -1172,6 +1249,7 @@ V4LCameraAdapter::V4LCameraAdapter(size_t sensor_index, CameraHal* hal)
     // Nothing useful to do in the constructor
     mFramesWithEncoder = 0;
     mDecoder = 0;
+    mMemoryType = V4L2_MEMORY_MMAP;
     nQueued = 0;
     nDequeued = 0;
 
@@ -1180,6 +1258,10 @@ V4LCameraAdapter::V4LCameraAdapter(size_t sensor_index, CameraHal* hal)
     property_get("camera.v4l.skipframes", value, "1");
     mSkipFramesCount = atoi(value);
 
+    // Frames the decoder may hold at once, 0 lets it take all queued input
+    property_get("camera.v4l.decode_depth", value, "0");
+    mDecodeDepth = atoi(value);
+
     LOG_FUNCTION_NAME_EXIT;
 }
 
@@ -1225,6 +1307,26 @@ static void convertYUV422i_yuyvTouyvy(uint8_t *src, uint8_t *dest, size_t size )
     LOG_FUNCTION_NAME_EXIT;
 }
 
+static void copyNV12ToTiler(unsigned char *src, unsigned char *dest, int width, int height, int srcStride) {
+    //copies a packed NV12 frame into preview buffers (Tiler memory), only used
+    //when the driver can't fill the preview buffers itself
+    int stride = PREVIEW_BUFFER_STRIDE;
+    unsigned char *dst_uv = dest + (height * stride);
+    unsigned char *src_uv;
+
+    if (srcStride < width) {
+        srcStride = width;
+    }
+    src_uv = src + (height * srcStride);
+
+    for (int i = 0; i < height; i++) {
+        memcpy(dest + (i * stride), src + (i * srcStride), width);
+    }
+    for (int i = 0; i < height / 2; i++) {
+        memcpy(dst_uv + (i * stride), src_uv + (i * srcStride), width);
+    }
+}
+
 static void convertYUV422ToNV12Tiler(unsigned char *src, unsigned char *dest, int width, int height ) {
     //convert YUV422I to YUV420 NV12 format and copies directly to preview buffers (Tiler memory).
     int stride = 4096;
@@ -1427,9 +1529,18 @@ void V4LCameraAdapter::returnOutputBuffer(int index)
 status_t V4LCameraAdapter::returnBufferToV4L(int id) {
     status_t ret = NO_ERROR;
     v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
     buf.index = id;
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = mMemoryType;
+    if (V4L2_MEMORY_USERPTR == mMemoryType) {
+        if (NULL == mVideoInfo->mem[id]) {
+            CAMHAL_LOGEB("No user pointer for buffer %d", id);
+            return BAD_VALUE;
+        }
+        buf.m.userptr = (unsigned long) mVideoInfo->mem[id];
+        buf.length = mVideoInfo->format.fmt.pix.sizeimage;
+    }
 
     ret = v4lIoctl(mCameraHandle, VIDIOC_QBUF, &buf);
     if (ret < 0) {
@@ -1501,9 +1612,26 @@ int V4LCameraAdapter::previewThread()
         }
         CAMHAL_LOGD("GOT IN frame with ID=%d",index);
 
-        CameraBuffer *buffer = mPreviewBufs[index];
+        CameraBuffer *buffer = NULL;
+        if ((index >= 0) && (index < NB_BUFFER)) {
+            buffer = mPreviewBufs[index];
+        }
+        //With USERPTR the frame must be the preview buffer the driver filled
+        if ((NULL == buffer) || (NULL == buffer->mapped) ||
+            ((V4L2_MEMORY_USERPTR == mMemoryType) && (fp != buffer->mapped))) {
+            CAMHAL_LOGEB("No valid preview buffer for frame %d", index);
+            if (NULL != buffer) {
+                returnBufferToV4L(index);
+            }
+            ret = BAD_VALUE;
+            goto EXIT;
+        }
+
         if (mPixelFormat == V4L2_PIX_FMT_YUYV) {
             convertYUV422ToNV12Tiler(reinterpret_cast<unsigned char*>(fp), reinterpret_cast<unsigned char*>(buffer->mapped), width, height);
+        } else if (V4L2_MEMORY_MMAP == mMemoryType) {
+            copyNV12ToTiler(reinterpret_cast<unsigned char*>(fp), reinterpret_cast<unsigned char*>(buffer->mapped),
+                            width, height, mVideoInfo->format.fmt.pix.bytesperline);
         }
         CAMHAL_LOGVB("##...index= %d.;camera buffer= 0x%x; mapped= 0x%x.",index, buffer, buffer->mapped);
 
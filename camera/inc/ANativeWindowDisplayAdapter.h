@@ -42,6 +42,9 @@ public:
         int mHeightStride;
         int mLength;
         CameraFrame::FrameType mType;
+        nsecs_t mTimestamp;
+        uint32_t mZoom;
+        nsecs_t mFillTime;
         } DisplayFrame;
 
     enum DisplayStates
@@ -85,6 +88,9 @@ public:
 
     virtual status_t maxQueueableBuffers(unsigned int& queueable);
     virtual status_t minUndequeueableBuffers(int& unqueueable);
+    virtual CameraBuffer * reallocateBufferList(CameraBuffer *buflist, int width, int height,
+                                                const char* format, int &bytes, int numBufs);
+    virtual void getFrameStats(unsigned int &dropped, unsigned int &late) const;
 
     // If set to true ANativeWindowDisplayAdapter will not lock/unlock graphic buffers
     void setExternalLocking(bool extBuffLocking);
@@ -101,11 +107,15 @@ public:
     status_t PostFrame(ANativeWindowDisplayAdapter::DisplayFrame &dispFrame);
     bool handleFrameReturn();
     status_t returnBuffersToWindow();
+    CameraBuffer * dequeueBufferList(int width, int height, const char* format, int &bytes);
+    bool paceFrame(const DisplayFrame &dispFrame);
 
 public:
 
     static const int DISPLAY_TIMEOUT;
     static const int FAILED_DQS_TO_SUSPEND;
+    static const int DEFAULT_REFRESH_RATE;
+    static const uint32_t ZOOM_UNITY;
 
     class DisplayThread : public android::Thread
         {
@@ -173,9 +183,24 @@ private:
 
     uint32_t mXOff;
     uint32_t mYOff;
+    uint32_t mCropZoom;
 
     const char *mPixelFormat;
 
+    ///Window and geometry the current buffer list was allocated for
+    preview_stream_ops_t *mAllocWindow;
+    int mAllocWidth;
+    int mAllocHeight;
+
+    ///Display pacing state, see paceFrame()
+    bool mPacing;
+    nsecs_t mRefreshPeriod;
+    nsecs_t mBaseLatency;
+    bool mBaseLatencyValid;
+    int64_t mLastPostedSlot;
+    unsigned int mFramesDropped;
+    unsigned int mFramesLate;
+
     //In case if we ,as example, using out buffers in Ducati Decoder
     //DOMX will handle lock/unlock of graphic buffers
     bool mUseExternalBufferLocking;
@@ -178,6 +178,8 @@ protected:
     //A couple of helper functions
     void setFrameRefCount(CameraBuffer* frameBuf, CameraFrame::FrameType frameType, int refCount);
     int getFrameRefCount(CameraBuffer* frameBuf, CameraFrame::FrameType frameType);
+    //Drops one reference and returns what is left, -1 if there was none
+    int decFrameRefCount(CameraBuffer* frameBuf, CameraFrame::FrameType frameType);
     int setInitFrameRefCount(CameraBuffer* buf, unsigned int mask);
     static const char* getLUTvalue_translateHAL(int Value, LUTtypeHAL LUT);
 
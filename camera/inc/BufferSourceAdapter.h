@@ -196,6 +196,8 @@ public:
 private:
     void destroy();
     status_t returnBuffersToWindow();
+    void resetWindowConfig();
+    int indexOfHandle(buffer_handle_t *handle) const;
 
 private:
     preview_stream_ops_t*  mBufferSource;
@@ -206,6 +208,19 @@ private:
     CameraBuffer *mBuffers;
 
     android::KeyedVector<buffer_handle_t *, int> mFramesWithCameraAdapterMap;
+    // mBuffers index of every handle in the current list
+    android::KeyedVector<buffer_handle_t *, int> mBufferIndex;
+
+    // Tap-out window setup of the last session. set_buffer_count() makes the
+    // window reallocate all its buffers, so it is only called on a change,
+    // and while it is unchanged the CPU addresses of its buffers stay valid.
+    preview_stream_ops_t *mConfiguredSource;
+    int mConfiguredCount;
+    int mConfiguredWidth;
+    int mConfiguredHeight;
+    int mConfiguredFormat;
+    int mConfiguredUsage;
+    android::KeyedVector<buffer_handle_t *, void *> mMappedCache;
     android::sp<ErrorNotifier> mErrorNotifier;
     android::sp<ReturnFrame> mReturnFrame;
     android::sp<QueueFrame> mQueueFrame;
@@ -34,6 +34,9 @@
 #include <utils/Log.h>
 #include <utils/threads.h>
 #include <utils/threads.h>
+#include <utils/KeyedVector.h>
+#include <utils/SortedVector.h>
+#include <cutils/atomic.h>
 #include <binder/MemoryBase.h>
 #include <binder/MemoryHeapBase.h>
 #include <camera/CameraParameters.h>
@@ -59,6 +62,7 @@
 #include "Semaphore.h"
 #include "CameraProperties.h"
 #include "SensorListener.h"
+#include "frame_trace.h"
 
 //temporarily define format here
 #define HAL_PIXEL_FORMAT_TI_NV12 0x100
@@ -255,12 +259,41 @@ protected:
     size_t mWeight;
 };
 
+#ifdef OMAP_ENHANCEMENT_CPCAM
+/**
+  * Fixed size camera_memory_t buffers for extended metadata, handed out per
+  * frame and taken back when the CameraMetadataResult holding them goes away.
+  * Buffers still owned by results keep the pool alive through their reference.
+  */
+class CameraMetadataPool : public android::RefBase
+{
+public:
+    CameraMetadataPool(camera_request_memory allocator, size_t bufferSize, unsigned int maxFree);
+    virtual ~CameraMetadataPool();
+
+    camera_memory_t *acquire();
+    void recycle(camera_memory_t *mem);
+
+    camera_request_memory getAllocator() const { return mAllocator; };
+    size_t getBufferSize() const { return mBufferSize; };
+
+private:
+    android::Mutex mLock;
+    android::Vector<camera_memory_t *> mFree;
+    camera_request_memory mAllocator;
+    size_t mBufferSize;
+    unsigned int mMaxFree;
+};
+#endif
+
 class CameraMetadataResult : public android::RefBase
 {
 public:
 
 #ifdef OMAP_ENHANCEMENT_CPCAM
-    CameraMetadataResult(camera_memory_t * extMeta) : mExtendedMetadata(extMeta) {
+    CameraMetadataResult(camera_memory_t * extMeta,
+                         const android::sp<CameraMetadataPool> &pool = NULL)
+        : mExtendedMetadata(extMeta), mPool(pool) {
         mMetadata.faces = NULL;
         mMetadata.number_of_faces = 0;
 #ifdef OMAP_ENHANCEMENT
@@ -289,7 +322,11 @@ public:
         }
 #ifdef OMAP_ENHANCEMENT_CPCAM
         if ( NULL != mExtendedMetadata ) {
-            mExtendedMetadata->release(mExtendedMetadata);
+            if ( NULL != mPool.get() ) {
+                mPool->recycle(mExtendedMetadata);
+            } else {
+                mExtendedMetadata->release(mExtendedMetadata);
+            }
         }
 #endif
     }
@@ -311,6 +348,7 @@ private:
     camera_frame_metadata_t mMetadata;
 #ifdef OMAP_ENHANCEMENT_CPCAM
     camera_memory_t *mExtendedMetadata;
+    android::sp<CameraMetadataPool> mPool;
 #endif
 };
 
@@ -350,6 +388,8 @@ typedef struct _CameraBuffer {
     int fd;
     size_t size;
     int index;
+    /* mapped is cacheable, CPU reads go through camera_buffer_sync_for_cpu() */
+    bool cached;
 
     /* These describe the camera buffer */
     int width;
@@ -370,6 +410,8 @@ typedef struct _CameraBuffer {
 } CameraBuffer;
 
 void * camera_buffer_get_omx_ptr (CameraBuffer *buffer);
+void camera_buffer_sync_for_cpu (CameraBuffer *buffer, size_t offset, size_t length);
+void camera_buffer_trace (CameraBuffer *buffer, const char *stage);
 
 class CameraFrame
 {
@@ -413,7 +455,9 @@ class CameraFrame
     mFd(0),
     mLength(0),
     mFrameMask(0),
-    mQuirks(0)
+    mQuirks(0),
+    mDisplayZoom(0),
+    mFillTime(0)
     {
       mYuv[0] = 0; // NULL is meant for pointers
       mYuv[1] = 0; // NULL is meant for pointers
@@ -436,12 +480,91 @@ class CameraFrame
     unsigned mFrameMask;
     unsigned int mQuirks;
     unsigned int mYuv[2];
+    ///Extra zoom (Q16) the display should apply by cropping, 0 if none
+    uint32_t mDisplayZoom;
+    ///Monotonic time the adapter got the filled buffer back, 0 if unknown
+    nsecs_t mFillTime;
 #ifdef OMAP_ENHANCEMENT_CPCAM
     android::sp<CameraMetadataResult> mMetaData;
 #endif
     ///@todo add other member vars like  stride etc
 };
 
+/**
+  * Session performance counters reported through CameraHal::dump().
+  *
+  * Updated from the adapter, notifier, encoder and display threads, so
+  * the counters are atomic and the latency histograms are kept under a
+  * lock. Latencies are bucketed log-linearly (8 buckets per power of two
+  * of microseconds), which bounds the reported p99 error to 12.5%.
+  */
+class CameraPerfCounters
+{
+public:
+
+    enum Stream {
+        STREAM_PREVIEW = 0,
+        STREAM_VIDEO,
+        STREAM_IMAGE,
+        STREAM_RAW,
+        STREAM_SNAPSHOT,
+        STREAM_OTHER,
+        STREAM_MAX
+    };
+
+    enum Event {
+        EVENT_DISPLAY_POSTED = 0,
+        EVENT_CAMERA_STARVED,   ///Camera got its last buffer back with none left to fill
+        EVENT_DISPLAY_STARVED,  ///No buffer could be dequeued from the preview window
+        EVENT_MAX
+    };
+
+    enum Latency {
+        LATENCY_FILL_TO_DISPLAY = 0,
+        LATENCY_JPEG_ENCODE,
+        LATENCY_SHOT_TO_SHOT,
+        LATENCY_FRAME_DECODE,   ///V4L dequeue to decoded output, USB cameras only
+        LATENCY_MAX
+    };
+
+    static void reset();
+    static void frameSent(int frameType, size_t subscribers);
+    static void frameReturned(int frameType);
+    static void event(Event event);
+    static void latency(Latency latency, nsecs_t value);
+    static void shotRequested();
+    static void shotDelivered();
+    static void dump(int fd);
+
+private:
+
+    static const int HISTOGRAM_SUB_BUCKETS = 8;
+    static const int HISTOGRAM_BUCKETS = 240;
+
+    struct Histogram {
+        uint32_t mBuckets[HISTOGRAM_BUCKETS];
+        uint32_t mCount;
+        nsecs_t mSum;
+        nsecs_t mMax;
+    };
+
+    static Stream streamOf(int frameType);
+    static int bucketOf(nsecs_t value);
+    static nsecs_t bucketLimit(int bucket);
+    static nsecs_t percentile(const Histogram &histogram, unsigned int percent);
+
+    static volatile int32_t sFramesSent[STREAM_MAX];
+    static volatile int32_t sFramesDelivered[STREAM_MAX];
+    static volatile int32_t sFramesReturned[STREAM_MAX];
+    static volatile int32_t sEvents[EVENT_MAX];
+
+    static android::Mutex sLock;
+    static Histogram sLatency[LATENCY_MAX];
+    static nsecs_t sSessionStart;
+    static nsecs_t sLastShotRequest;
+    static nsecs_t sLastShotDelivery;
+};
+
 enum CameraHalError
 {
     CAMERA_ERROR_FATAL = 0x1, //Fatal errors can only be recovered by restarting media server
@@ -786,11 +909,14 @@ private:
     //these objects
     android::KeyedVector<unsigned int, unsigned int> mVideoHeaps;
     android::KeyedVector<unsigned int, unsigned int> mVideoBuffers;
-    android::KeyedVector<void *, CameraBuffer *> mVideoMap;
 
-    //Keeps list of Gralloc handles and associated Video Metadata Buffers
-    android::KeyedVector<void *, camera_memory_t *> mVideoMetadataBufferMemoryMap;
-    android::KeyedVector<void *, CameraBuffer *> mVideoMetadataBufferReverseMap;
+    //Video metadata buffers live in one camera_memory_t, slot i belongs to
+    //mVideoSourceBuffers[i] (and mVideoTargetBuffers[i] when resizing), so
+    //frames and releases map to each other by index arithmetic
+    CameraBuffer *mVideoSourceBuffers;
+    CameraBuffer *mVideoTargetBuffers;
+    size_t mVideoBufferCount;
+    camera_memory_t *mVideoMetadataMemory;
 
     bool mBufferReleased;
 
@@ -803,6 +929,12 @@ private:
 
     bool mPreviewing;
     camera_memory_t* mPreviewMemory;
+    // kept by stopPreviewCallbacks() for the next preview with the same buffer size
+    camera_memory_t* mSparePreviewMemory;
+    uint32_t mPreviewMemoryAllocs;
+    uint32_t mPreviewMemoryReuses;
+    // placeholder buffer for metadata callbacks, allocated on first use
+    camera_memory_t* mMetadataMemory;
     CameraBuffer mPreviewBuffers[MAX_BUFFERS];
     int mPreviewBufCount;
     int mPreviewWidth;
@@ -844,14 +976,34 @@ public:
 
     int setErrorHandler(ErrorNotifier *errorNotifier);
     virtual CameraBuffer * allocateBufferList(int width, int height, const char* format, int &bytes, int numBufs);
+    ///Allocates at least minBufs and up to numBufs buffers, numBufs returns the count obtained.
+    ///Cached lists must only be written by the hardware, see camera_buffer_sync_for_cpu().
+    CameraBuffer * allocateBufferList(int width, int height, const char* format, int &bytes,
+                                      int &numBufs, int minBufs, bool cached);
     virtual CameraBuffer *getBufferList(int *numBufs);
     virtual uint32_t * getOffsets();
     virtual int getFd() ;
     virtual int freeBufferList(CameraBuffer * buflist);
 
 private:
+    bool reserveBudget(size_t bytes);
+    void releaseBudget(size_t bytes);
+    CameraBuffer * takeParkedList(const char* format, int bytes, int numBufs, bool cached);
+    void releaseParkedList();
+    void releaseBuffers(CameraBuffer *buffers);
+
     android::sp<ErrorNotifier> mErrorNotifier;
     int mIonFd;
+
+    ///Last freed small list, handed out again to a request of the same geometry
+    android::Mutex mParkedLock;
+    CameraBuffer *mParkedBuffers;
+    int mParkedCount;
+    int mParkedSize;
+
+    ///ION memory held by all camera memory managers, against debug.camera.mem_budget_mb
+    static android::Mutex sBudgetLock;
+    static size_t sAllocatedBytes;
 };
 
 
@@ -1059,6 +1211,23 @@ public:
     // Get min buffers display needs at any given time
     virtual status_t minUndequeueableBuffers(int& unqueueable) = 0;
 
+    // Allocate a buffer list, reusing buflist when the display can hand the
+    // same buffers out again. buflist is freed if it can't be reused.
+    virtual CameraBuffer * reallocateBufferList(CameraBuffer *buflist, int width, int height,
+                                                const char* format, int &bytes, int numBufs)
+    {
+        freeBufferList(buflist);
+        return allocateBufferList(width, height, format, bytes, numBufs);
+    }
+
+    // Get the number of preview frames dropped by display pacing and
+    // the number that reached the display later than one refresh
+    virtual void getFrameStats(unsigned int &dropped, unsigned int &late) const
+    {
+        dropped = 0;
+        late = 0;
+    }
+
     // Given a vector of DisplayAdapters find the one corresponding to str
     virtual bool match(const char * str) { return false; }
 
@@ -1097,6 +1266,7 @@ public:
     static const int NO_BUFFERS_IMAGE_CAPTURE;
     static const int NO_BUFFERS_IMAGE_CAPTURE_SYSTEM_HEAP;
     static const uint32_t VFR_SCALE = 1000;
+    static const size_t MAX_SUPPORTED_VALUE_SETS = 64;
 
 
     /*--------------------Interface Methods---------------------------------*/
@@ -1347,9 +1517,11 @@ private:
     /** Allocate video buffers */
     status_t allocVideoBufs(uint32_t width, uint32_t height, uint32_t bufferCount);
 
-    /** Allocate image capture buffers */
+    /** Allocate image capture buffers, fewer than bufferCount but at least
+        minBufferCount when memory is short. mImageCount tells how many. */
     status_t allocImageBufs(unsigned int width, unsigned int height, size_t length,
-                            const char* previewFormat, unsigned int bufferCount);
+                            const char* previewFormat, unsigned int bufferCount,
+                            unsigned int minBufferCount);
 
     /** Allocate Raw buffers */
     status_t allocRawBufs(int width, int height, const char* previewFormat, int bufferCount);
@@ -1363,6 +1535,12 @@ private:
     /** Free RAW bufs */
     status_t freeRawBufs();
 
+    /** Free the image capture buffers kept for the next shot */
+    void trimImagePool();
+
+    /** Free the video buffers kept after stopRecording(), if expired or forced */
+    void trimVideoPool(bool force);
+
     //Check if a given resolution is supported by the current camera
     //instance
     bool isResolutionValid(unsigned int width, unsigned int height, const char *supportedResolutions);
@@ -1375,6 +1553,10 @@ private:
     // instance
     bool isParameterValid(const char *param, const char *supportedParams);
     bool isParameterValid(int param, const char *supportedParams);
+    //Pre-parsed supported value set for a comma separated capability list
+    const android::SortedVector<android::String8> & getSupportedValues(const char *supportedParams);
+    //Values already accepted into mParameters do not need validating again
+    bool isParameterUnchanged(const char *key, const char *value) const;
     status_t doesSetParameterNeedUpdate(const char *new_param, const char *old_params, bool &update);
 
     /** Initialize default parameters */
@@ -1498,17 +1680,38 @@ private:
     int mImageFd;
     int mImageLength;
     unsigned int mImageCount;
+    ///Image capture buffers kept between shots, reused by allocImageBufs()
+    android::Mutex mImagePoolLock;
+    CameraBuffer *mImageBuffersAllocated;   ///Memory manager list mImageBuffers came from
+    unsigned int mImageAllocatedCount;
+    size_t mImageAllocatedSize;
+    CameraBuffer *mImagePool;
+    unsigned int mImagePoolCount;
+    size_t mImagePoolSize;
     CameraBuffer *mPreviewBuffers;
     uint32_t *mPreviewOffsets;
     int mPreviewLength;
     int mPreviewFd;
+    ///Keep the preview buffers through freePreviewBufs() for a preview restart
+    bool mKeepPreviewBufs;
+    ///Preview buffers kept on the last stop, to be handed out again
+    bool mPreviewBufsKept;
     CameraBuffer *mVideoBuffers;
+    ///Size of the gralloc video buffers in mVideoBuffers, kept for the next recording
+    uint32_t mVideoBufsWidth;
+    uint32_t mVideoBufsHeight;
+    uint32_t mVideoBufsCount;
+    bool mVideoBufsPooled;
+    nsecs_t mVideoBufsPoolTime;
     uint32_t *mVideoOffsets;
     int mVideoFd;
     int mVideoLength;
 
     int mBracketRangePositive;
     int mBracketRangeNegative;
+    int mZslRingFrames;
+
+    android::KeyedVector<android::String8, android::SortedVector<android::String8> > mSupportedValues;
 
     ///@todo Rename this as preview buffer provider
     BufferProvider *mBufProvider;
@@ -27,6 +27,8 @@ class DecoderFactory {
     ~DecoderFactory();
 public:
     static FrameDecoder* createDecoderByType(DecoderType type, bool forceSwDecoder = false);
+    // SW decoder to use when the HW one can't be started
+    static FrameDecoder* createFallbackDecoder(DecoderType type, bool externalLocking);
 };
 
 }  // namespace Camera
@@ -40,7 +40,10 @@ public:
     static int readDHTSize();
     static bool isDhtExist(unsigned char *jpeg_src,  int filled_len);
     static int appendDHT(unsigned char *jpeg_src, int filled_len, unsigned char *jpeg_with_dht_buffer, int buff_size);
-    bool decode(unsigned char *jpeg_src, int filled_len, unsigned char *nv12_buffer, int stride);
+    // width x height bounds the NV12 output, 0 for the full JPEG size. A
+    // larger JPEG is decoded with a scaled IDCT (1/2, 1/4 or 1/8) to fit.
+    bool decode(unsigned char *jpeg_src, int filled_len, unsigned char *nv12_buffer, int stride,
+                unsigned int width = 0, unsigned int height = 0);
 
 private:
     void release();
@@ -48,7 +51,9 @@ private:
     unsigned char **U_Plane;
     unsigned char **V_Plane;
     unsigned char *UV_Plane;
+    unsigned char *Pad_Row;
     unsigned int mWidth, mHeight;
+    unsigned int mRows;
 };
 
 } // namespace Camera
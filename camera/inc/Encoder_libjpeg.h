@@ -47,6 +47,7 @@ namespace Camera {
  */
 
 #define MAX_EXIF_TAGS_SUPPORTED 30
+#define EXIF_VALUE_POOL_SIZE 1024
 typedef void (*encoder_libjpeg_callback_t) (void* main_jpeg,
                                             void* thumb_jpeg,
                                             CameraFrame::FrameType type,
@@ -95,7 +96,7 @@ class ExifElementsTable {
     public:
         ExifElementsTable() :
            gps_tag_count(0), exif_tag_count(0), position(0),
-           jpeg_opened(false)
+           value_pool_used(0), jpeg_opened(false)
         {
 #ifdef ANDROID_API_JB_OR_LATER
             has_datetime_tag = false;
@@ -104,6 +105,8 @@ class ExifElementsTable {
         ~ExifElementsTable();
 
         status_t insertElement(const char* tag, const char* value);
+        status_t insertElements(const ExifElementsTable& other);
+        void reset();
         void insertExifToJpeg(unsigned char* jpeg, size_t jpeg_size);
         status_t insertExifThumbnailImage(const char*, int);
         void saveJpeg(unsigned char* picture, size_t jpeg_size);
@@ -111,10 +114,16 @@ class ExifElementsTable {
         static void stringToRational(const char*, unsigned int*, unsigned int*);
         static bool isAsciiTag(const char* tag);
     private:
+        char* allocValue(size_t size);
+        void freeValues();
+
         ExifElement_t table[MAX_EXIF_TAGS_SUPPORTED];
         unsigned int gps_tag_count;
         unsigned int exif_tag_count;
         unsigned int position;
+        // tag values are carved from here, the heap is only a fallback
+        char value_pool[EXIF_VALUE_POOL_SIZE];
+        size_t value_pool_used;
         bool jpeg_opened;
 #ifdef ANDROID_API_JB_OR_LATER
         bool has_datetime_tag;
@@ -168,7 +177,12 @@ class Encoder_libjpeg : public android::Thread {
             }
 
             // encode our main image
+            nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
             size = encode(mMainInput);
+            if (mCb) {
+                CameraPerfCounters::latency(CameraPerfCounters::LATENCY_JPEG_ENCODE,
+                                            systemTime(SYSTEM_TIME_MONOTONIC) - start);
+            }
 
             // signal cancel semaphore incase somebody is waiting
             mCancelSem.Signal();
@@ -108,6 +108,8 @@ struct DecoderParameters {
     int height;
     int inputBufferCount;
     int outputBufferCount;
+    // Compressed frames allowed in the decoder at once, 0 for no limit
+    int decodeDepth;
 };
 
 class FrameDecoder {
@@ -147,6 +149,8 @@ public:
 protected:
     virtual void doConfigure(const DecoderParameters& config) = 0;
     virtual void doProcessInputBuffer() = 0;
+    // Output buffer came back while running, decoders may hand it on right away
+    virtual void doQueueOutputBuffer(int id) {}
     virtual status_t doStart() = 0;
     virtual void doStop() = 0;
     virtual void doFlush() = 0;
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NV12_CONVERT_H_
+#define NV12_CONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Chroma conversions out of the interleaved NV12 UV plane, used for preview
+ * callbacks.  width is the image width in pixels (bytes per chroma row),
+ * rows is the number of chroma rows (image height / 2), strides are in bytes.
+ */
+enum NV12ConvertImpl {
+    NV12_CONVERT_C = 0,
+    NV12_CONVERT_NEON,
+};
+
+/* select the kernels used, returns false if the implementation isn't built in */
+bool NV12_setConvertImpl(NV12ConvertImpl impl);
+NV12ConvertImpl NV12_getConvertImpl();
+
+/* NV12 UV to NV21 VU */
+void NV12_convertUVtoVU(const uint8_t *src, size_t srcStride,
+                        uint8_t *dst, size_t dstStride,
+                        int width, int rows);
+
+/* NV12 UV to the separate V and U planes of YV12 */
+void NV12_convertUVtoYV12(const uint8_t *src, size_t srcStride,
+                          uint8_t *dstV, uint8_t *dstU, size_t dstStride,
+                          int width, int rows);
+
+#endif //NV12_CONVERT_H_
@@ -122,7 +122,8 @@ typedef struct IC_crop_struct {
 * Value Returned : mmBool               -> FALSE on error TRUE on success
 * NOTE:
 *            Not tested for crop funtionallity.
-*            faster version.
+*            The work is split into row bands on a small worker pool and
+*            exact 2x and 4x downscales take a box filter fast path.
 ============================================================================*/
 mmBool
 VT_resizeFrame_Video_opt2_lp(
@@ -73,6 +73,7 @@ namespace Camera {
 #define FRAME_RATE_HIGH_HD          60
 
 #define ZOOM_STAGES                 61
+#define ZOOM_CROP_MAX               81920 // 1.25x (Q16) of display crop on top of the OMX zoom
 
 #define FACE_DETECTION_BUFFER_SIZE  0x1000
 #define MAX_NUM_FACES_SUPPORTED     35
@@ -264,7 +265,7 @@ public:
         SetRotation             = 1 << 4,
         ECaptureSettingMax,
         ECapturesettingsAll = ( ((ECaptureSettingMax -1 ) << 1) -1 ), /// all possible flags raised
-        ECaptureParamSettings = SetFormat | SetThumb | SetQuality | SetBurstExpBracket, // Settings set with SetParam
+        ECaptureParamSettings = SetFormat | SetThumb | SetQuality, // Settings set with SetParam
         ECaptureConfigSettings = (ECapturesettingsAll & ~ECaptureParamSettings)
     };
 
@@ -412,8 +413,11 @@ public:
     // API
     virtual status_t setFormat(OMX_U32 port, OMXCameraPortParameters &cap);
 
-    // Function to get and populate caps from handle
-    static status_t getCaps(int sensorId, CameraProperties::Properties* props, OMX_HANDLETYPE handle);
+    // Function to get and populate caps from handle, optionally keeping a copy of the raw caps
+    static status_t getCaps(int sensorId, CameraProperties::Properties* props, OMX_HANDLETYPE handle,
+                            OMX_TI_CAPTYPE *probed = NULL);
+    // Populate caps from a raw copy kept by an earlier getCaps()
+    static status_t getCachedCaps(int sensorId, CameraProperties::Properties* props, OMX_TI_CAPTYPE &caps);
     static const char* getLUTvalue_OMXtoHAL(int OMXValue, LUTtype LUT);
     static int getMultipleLUTvalue_OMXtoHAL(int OMXValue, LUTtype LUT, char * supported);
     static int getLUTvalue_HALtoOMX(const char * HalValue, LUTtype LUT);
@@ -450,6 +454,9 @@ protected:
     virtual status_t stopPreview();
     virtual status_t useBuffers(CameraMode mode, CameraBuffer * bufArr, int num, size_t length, unsigned int queueable);
     virtual status_t fillThisBuffer(CameraBuffer * frameBuf, CameraFrame::FrameType frameType);
+    OMX_ERRORTYPE queuePreviewFill(OMXCameraPortParameters *port, int index);
+    OMX_ERRORTYPE flushPreviewFills(bool force);
+    OMX_ERRORTYPE submitPreviewFills(OMXCameraPortParameters *port);
     virtual status_t getFrameSize(size_t &width, size_t &height);
     virtual status_t getPictureBufferSize(CameraFrame &frame, size_t bufferCount);
     virtual status_t getFrameDataSize(size_t &dataFrameSize, size_t bufferCount);
@@ -509,11 +516,14 @@ private:
     status_t setupEXIF();
     status_t setupEXIF_libjpeg(ExifElementsTable*, OMX_TI_ANCILLARYDATATYPE*,
                                OMX_TI_WHITEBALANCERESULTTYPE*);
+    status_t buildStaticEXIF();
 
     //Focus functionality
     status_t doAutoFocus();
     status_t stopAutoFocus();
     status_t checkFocus(OMX_PARAM_FOCUSSTATUSTYPE *eFocusStatus);
+    status_t getFocusStatus(OMX_PARAM_FOCUSSTATUSTYPE *eFocusStatus);
+    void invalidateFocusStatus();
     status_t returnFocusStatus(bool timeoutReached);
     status_t getFocusMode(OMX_IMAGE_CONFIG_FOCUSCONTROLTYPE &focusMode);
     void handleFocusCallback();
@@ -537,8 +547,12 @@ private:
     status_t setParametersZoom(const android::CameraParameters &params,
                                BaseCameraAdapter::AdapterState state);
     status_t doZoom(int index);
+    status_t doSmoothZoomStep(unsigned int index);
     status_t advanceZoom();
 
+    //Orientation handoff from the sensor thread
+    void applyPendingOrientation();
+
     //3A related parameters
     status_t setParameters3A(const android::CameraParameters &params,
                              BaseCameraAdapter::AdapterState state);
@@ -596,6 +610,12 @@ private:
 
     status_t getEVCompensation(Gen3A_settings& Gen3A);
     status_t getWBMode(Gen3A_settings& Gen3A);
+
+    // Exposure value shadow, shared by EV compensation, ISO and manual exposure
+    status_t getExposureValues();
+    status_t commitExposureValues();
+    void invalidateExposureValues();
+    status_t endExposureBatch();
     status_t getSharpness(Gen3A_settings& Gen3A);
     status_t getSaturation(Gen3A_settings& Gen3A);
     status_t getISO(Gen3A_settings& Gen3A);
@@ -615,6 +635,7 @@ private:
 
     status_t setParametersAlgo(const android::CameraParameters &params,
                                BaseCameraAdapter::AdapterState state);
+    status_t applyPendingPreviewSettings();
 
     //Noise filtering
     status_t setNSF(OMXCameraAdapter::IPPMode mode);
@@ -647,6 +668,7 @@ private:
                                    camera_frame_metadata_t *metadataResult,
                                    size_t previewWidth,
                                    size_t previewHeight);
+    void smoothFaces(camera_face_t *faces, int count);
     status_t encodePreviewMetadata(camera_frame_metadata_t *meta, const OMX_PTR plat_pvt);
 
     void pauseFaceDetection(bool pause);
@@ -745,10 +767,12 @@ private:
     //Temporal Bracketing
     status_t doBracketing(OMX_BUFFERHEADERTYPE *pBuffHeader, CameraFrame::FrameType typeOfFrame);
     status_t sendBracketFrames(size_t &framesSent);
+    status_t sendZslFrame(nsecs_t shutter, size_t &framesSent);
 
     // Image Capture Service
     status_t startImageCapture(bool bracketing, CachedCaptureParameters*);
     status_t disableImagePort();
+    unsigned int capturePortSettings() const;
 
     //Shutter callback notifications
     status_t setShutterCallback(bool enabled);
@@ -775,8 +799,8 @@ private:
 
     // Meta data
 #ifdef OMAP_ENHANCEMENT_CPCAM
-    camera_memory_t * getMetaData(const OMX_PTR plat_pvt,
-                                  camera_request_memory allocator) const;
+    android::sp<CameraMetadataResult> getMetaData(const OMX_PTR plat_pvt,
+                                                  camera_request_memory allocator);
 #endif
 
     // Mechanical Misalignment Correction
@@ -809,6 +833,7 @@ private:
     status_t disableReprocess();
     status_t stopReprocess();
     status_t UseBuffersReprocess(CameraBuffer *bufArr, int num);
+    bool reprocessBuffersRegistered(CameraBuffer *bufArr, int num);
 
     class CommandHandler : public android::Thread {
         public:
@@ -864,10 +889,11 @@ public:
             return ret;
         }
 
-        status_t put(Utils::Message* msg){
+        status_t put(Utils::Message* msg,
+                     Utils::MessageQueue::Priority priority = Utils::MessageQueue::PRIORITY_NORMAL){
             android::AutoMutex lock(mLock);
             mIsProcessed = false;
-            return mCommandMsgQ.put(msg);
+            return mCommandMsgQ.put(msg, priority);
         }
 
         void clearCommandQ()
@@ -938,6 +964,11 @@ private:
     static const int FPS_MAX;
     static const int FPS_MAX_EXTENDED;
 
+    static const int PREVIEW_FILL_BATCH_MIN_FPS;
+    static const int PREVIEW_FILL_BATCH_DEFAULT;
+    static const uint32_t PREVIEW_FILL_MIN_QUEUED;
+    static const nsecs_t PREVIEW_FILL_MAX_LATENCY;
+
     // OMX Camera defaults
     static const char DEFAULT_ANTIBANDING[];
     static const char DEFAULT_BRIGHTNESS[];
@@ -1046,6 +1077,7 @@ private:
     size_t mZoomBracketingValidEntries;
 
     static const uint32_t FACE_DETECTION_THRESHOLD;
+    static const uint32_t FACE_DETECTION_SMOOTHING_MAX;
     mutable android::Mutex mFaceDetectionLock;
     //Face detection status
     bool mFaceDetectionRunning;
@@ -1054,11 +1086,26 @@ private:
 
     camera_face_t  faceDetectionLastOutput[MAX_NUM_FACES_SUPPORTED];
     int faceDetectionNumFacesLastOutput;
+    //Face results per second, 0 for every preview frame
+    unsigned int mFaceDetectionRate;
+    //Weight in percent given to the previous position of a face
+    unsigned int mFaceDetectionSmoothing;
+    nsecs_t mFaceDetectionLastTime;
     int metadataLastAnalogGain;
     int metadataLastExposureTime;
+#ifdef OMAP_ENHANCEMENT_CPCAM
+    static const unsigned int METADATA_POOL_SIZE;
+    static const size_t METADATA_BUFFER_SIZE;
+    android::sp<CameraMetadataPool> mMetadataPool;
+#endif
 
     //Geo-tagging
     EXIFData mEXIFData;
+    //Parameter derived tags, formatted once per setParameters()
+    android::Mutex mEXIFLock;
+    ExifElementsTable mEXIFStaticTags;
+    //OMX EXIF shared buffer, kept across shots
+    CameraBuffer *mEXIFSharedBuffer;
 
     //Image post-processing
     IPPMode mIPP;
@@ -1089,6 +1136,14 @@ private:
     unsigned int mCurrentZoomIdx, mTargetZoomIdx, mPreviousZoomIndx;
     bool mZoomUpdating, mZoomUpdate;
     int mZoomInc;
+    bool mSmoothZoomCrop;
+    uint32_t mDisplayZoom;
+
+    //Returned preview buffers waiting to be handed back to Ducati together
+    android::Mutex mPreviewFillLock;
+    android::Vector<int> mPendingPreviewFills;
+    nsecs_t mPendingPreviewFillTime;
+    int mPreviewFillBatch;
     bool mReturnZoomStatus;
     static const int32_t ZOOM_STEPS [];
 
@@ -1098,6 +1153,15 @@ private:
     unsigned int mPending3Asettings;
     android::Mutex m3ASettingsUpdateLock;
     Gen3A_settings mParameters3A;
+
+    //Last exposure values read from or written to Ducati. Setters update
+    //the shadow and apply3Asettings() commits it once per pass.
+    android::Mutex mExposureValuesLock;
+    OMX_CONFIG_EXPOSUREVALUETYPE mExposureValues;
+    OMX_TI_CONFIG_EXPOSUREVALUERIGHTTYPE mExposureValuesRight;
+    bool mExposureValuesValid;
+    bool mExposureValuesDirty;
+    bool mExposureValuesBatch;
     const char *mPictureFormatFromClient;
 
     BrightnessMode mGBCE;
@@ -1107,16 +1171,21 @@ private:
     OMX_TI_CONFIG_3A_REGION_PRIORITY mRegionPriority;
 
     android::CameraParameters mParams;
+    android::String8 mParamsFlattened;
+    BaseCameraAdapter::AdapterState mParamsState;
     CameraProperties::Properties* mCapabilities;
     unsigned int mPictureRotation;
     bool mWaitingForSnapshot;
     bool mCaptureConfigured;
+    bool mConcurrentCapture;
     unsigned int mPendingCaptureSettings;
     unsigned int mPendingPreviewSettings;
     unsigned int mPendingReprocessSettings;
     OMX_TI_ANCILLARYDATATYPE* mCaptureAncillaryData;
     OMX_TI_WHITEBALANCERESULTTYPE* mWhiteBalanceData;
     bool mReprocConfigured;
+    // Buffers registered on the reprocess port while mReprocConfigured
+    int mReprocNumBufs;
 
     //Temporal bracketing management data
     bool mBracketingSet;
@@ -1124,9 +1193,12 @@ private:
     bool *mBracketingBuffersQueued;
     int mBracketingBuffersQueuedCount;
     int mLastBracetingBufferIdx;
+    nsecs_t *mBracketingBuffersTimestamp;
     bool mBracketingEnabled;
     bool mZoomBracketingEnabled;
     size_t mBracketingRange;
+    //ZSL ring: temporal bracketing ring from which only one frame is sent
+    int mZslRingFrames;
     int mCurrentZoomBracketing;
     android::CameraParameters mParameters;
 
@@ -1169,6 +1241,10 @@ private:
     int mSensorOrientation;
     int mDeviceOrientation;
     int mFaceOrientation;
+    //Latest rotation from the sensor thread, consumed at preview frame boundaries
+    volatile int32_t mPendingDeviceOrientation;
+    int mMountOrientation;
+    int mMountDirection;
     bool mSensorOverclock;
 
     //Indicates if we should leave
@@ -1190,6 +1266,12 @@ private:
     android::Mutex mDoAFMutex;
     android::Condition mDoAFCond;
 
+    // Last focus status read by handleFocusCallback(), valid until a scan
+    // is started or the focus callback is (un)registered
+    android::Mutex mFocusStatusLock;
+    OMX_FOCUSSTATUSTYPE mFocusStatus;
+    bool mFocusStatusValid;
+
     size_t mSensorIndex;
     CodingMode mCodingMode;
 
@@ -133,6 +133,7 @@ public:
 protected:
     virtual void doConfigure (const DecoderParameters& config);
     virtual void doProcessInputBuffer();
+    virtual void doQueueOutputBuffer(int id);
     virtual status_t doStart();
     virtual void doStop();
     virtual void doFlush();
@@ -147,6 +148,7 @@ private:
     status_t doPortReconfigure();
     void dumpPortSettings(PortType port);
     status_t getAndConfigureDecoder();
+    void releaseComponent();
     status_t configureJpegPorts(int width, int height);
     status_t switchToIdle();
     status_t allocateBuffersInput();
@@ -197,6 +199,11 @@ private:
     bool mIsNeedCheckDHT;
     // If true we always append DHT to JPEG buffer
     bool mAlwaysAppendDHT;
+
+    // Input port buffer size, known once the buffers are allocated
+    OMX_U32 mInputBufferSize;
+    // Input buffers currently owned by the component, EBD runs on the dispatcher thread
+    volatile int32_t mInputsInFlight;
 };
 
 } //namespace Camera
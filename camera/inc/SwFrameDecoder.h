@@ -17,6 +17,7 @@
 #ifndef SWFRAMEDECODER_H_
 #define SWFRAMEDECODER_H_
 
+#include <utils/threads.h>
 #include "FrameDecoder.h"
 #include "Decoder_libjpeg.h"
 
@@ -25,21 +26,58 @@ namespace Camera {
 
 class SwFrameDecoder: public FrameDecoder {
 public:
-    SwFrameDecoder();
+    // lockOutput - map the gralloc output buffers around every decode,
+    // needed when the display leaves buffer locking to the decoder
+    SwFrameDecoder(bool lockOutput = false);
     virtual ~SwFrameDecoder();
 
+    static const int MAX_DECODE_THREADS = 4;
+
 protected:
     virtual void doConfigure(const DecoderParameters& config);
     virtual void doProcessInputBuffer();
-    virtual status_t doStart() { return NO_ERROR; }
-    virtual void doStop() { }
+    virtual status_t doStart();
+    virtual void doStop();
     virtual void doFlush() { }
     virtual void doRelease() { }
 
 private:
+    // Everything libjpeg needs to decode one frame
+    struct DecodeContext {
+        DecodeContext() : jpegWithHeaderBuffer(NULL) { }
+        Decoder_libjpeg jpgDecoder;
+        unsigned char* jpegWithHeaderBuffer;
+    };
+
+    // Decodes one frame at a time with its own context, so frames
+    // can be decoded in parallel on multi-core parts
+    class DecodeWorker : public android::Thread {
+    public:
+        DecodeWorker(SwFrameDecoder *decoder, DecodeContext *context);
+
+        bool post(int inIndex, int outIndex);
+        void waitIdle();
+        void exit();
+
+    private:
+        virtual bool threadLoop();
+
+        SwFrameDecoder *mDecoder;
+        DecodeContext *mContext;
+        android::Mutex mLock;
+        android::Condition mCondition;
+        bool mBusy;
+        int mInIndex;
+        int mOutIndex;
+    };
+
+    void decodeFrame(DecodeContext &context, int inIndex, int outIndex);
+
     int mjpegWithHdrSize;
-    Decoder_libjpeg mJpgdecoder;
-    unsigned char* mJpegWithHeaderBuffer;
+    bool mLockOutput;
+    int mThreadCount;
+    DecodeContext mContexts[MAX_DECODE_THREADS];
+    android::Vector< android::sp<DecodeWorker> > mWorkers;
 };
 
 }  // namespace Camera
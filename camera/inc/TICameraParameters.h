@@ -66,9 +66,12 @@ static const char  KEY_ZOOM_BRACKETING_RANGE[];
 static const char  KEY_TEMP_BRACKETING[];
 static const char  KEY_TEMP_BRACKETING_RANGE_POS[];
 static const char  KEY_TEMP_BRACKETING_RANGE_NEG[];
+static const char  KEY_ZSL_RING_FRAMES[];
 static const char  KEY_FLUSH_SHOT_CONFIG_QUEUE[];
 static const char  KEY_SHUTTER_ENABLE[];
 static const char  KEY_MEASUREMENT_ENABLE[];
+static const char  KEY_FACE_DETECTION_RATE[];
+static const char  KEY_FACE_DETECTION_SMOOTHING[];
 static const char  KEY_INITIAL_VALUES[];
 static const char  KEY_GBCE[];
 static const char  KEY_GBCE_SUPPORTED[];
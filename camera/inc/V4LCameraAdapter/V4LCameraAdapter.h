@@ -197,7 +197,8 @@ private:
 
     status_t v4lIoctl(int, int, void*);
     status_t v4lInitMmap(int& count, int width, int height);
-    status_t v4lInitUsrPtr(int&);
+    status_t v4lInitUsrPtr(int& count, int width, int height);
+    status_t v4lInitPreviewBuffers(int& count, int width, int height);
     status_t v4lStartStreaming();
     status_t v4lStopStreaming(int nBufferCount);
     status_t v4lSetFormat(int, int, uint32_t);
@@ -206,6 +207,7 @@ private:
     status_t returnBufferToV4L(int id);
     void returnOutputBuffer(int index);
     bool isNeedToUseDecoder() const;
+    status_t startDecoder();
 
     int mPreviewBufferCount;
     int mPreviewBufferCountQueueable;
@@ -241,6 +243,9 @@ private:
     int mQueuedOutputBuffers;
 
     FrameDecoder* mDecoder;
+    DecoderParameters mDecoderParams;
+    // Display leaves gralloc locking of preview buffers to the decoder
+    bool mExternalLocking;
     android::Vector< android::sp<MediaBuffer> > mInBuffers;
     android::Vector< android::sp<MediaBuffer> > mOutBuffers;
 
@@ -249,11 +254,17 @@ private:
     int mPixelFormat;
     int mFrameRate;
 
+    // USERPTR streaming straight into the preview buffers was asked for,
+    // mMemoryType is what the current V4L buffers actually use
+    bool mUserPtrRequested;
+    enum v4l2_memory mMemoryType;
+
     android::Mutex mStopLock;
     android::Condition mStopCondition;
 
     CameraHal* mCameraHal;
     int mSkipFramesCount;
+    int mDecodeDepth;
 };
 
 } // namespace Camera
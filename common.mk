@@ -73,6 +73,7 @@ PRODUCT_TAGS += dalvik.gc.type-precise
 PRODUCT_COPY_FILES += \
     $(LOCAL_KERNEL):kernel \
     $(COMMON_FOLDER)/default.prop:/root/default.prop \
+    $(COMMON_FOLDER)/init.omap4-common.rc:/root/init.omap4-common.rc \
 
 # Wifi
 PRODUCT_PACKAGES += \
@@ -117,7 +118,8 @@ PRODUCT_PACKAGES += \
 
 # Prebuilts
 PRODUCT_COPY_FILES += \
-    $(COMMON_FOLDER)/prebuilt/etc/gps.conf:/system/etc/gps.conf
+    $(COMMON_FOLDER)/prebuilt/etc/gps.conf:/system/etc/gps.conf \
+    $(COMMON_FOLDER)/prebuilt/etc/power_profiles.conf:/system/etc/power_profiles.conf
 
 $(call inherit-product-if-exists, vendor/amazon/omap4-common/omap4-common-vendor.mk)
 
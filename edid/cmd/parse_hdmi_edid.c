@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <fcntl.h>
 
 #define LOG_TAG "EDID"
@@ -101,11 +102,15 @@ static void print_s3d_format_info(struct edid_t *edid, const struct hdmi_s3d_for
     }
 
 }
-int main()
+int main(int argc, char **argv)
 {
     unsigned int i;
     struct svd_t *svd_list;
     unsigned int num_svds;
+    const struct dtd_t *dtd_list;
+    unsigned int num_dtds;
+    const struct sad_t *sad_list;
+    unsigned int num_sads;
 
     int fd = open(kHdmiEdidPathName, O_RDONLY);
 
@@ -138,6 +143,34 @@ int main()
                 svd_list[i].info.xres, svd_list[i].info.yres, svd_list[i].info.hz);
     }
 
+    edid_get_dtd_list(edid, &dtd_list, &num_dtds);
+    fprintf(stdout, "\n[Detailed Timings]\n");
+    for (i = 0; i < num_dtds; i++) {
+        fprintf(stdout, "----%d: %dx%d%s [pclk:%d kHz, htotal:%d, vtotal:%d]\n",
+                i, dtd_list[i].xres, dtd_list[i].yres, dtd_list[i].interlaced ? "i" : "p",
+                dtd_list[i].pixel_clock_khz, dtd_list[i].htotal, dtd_list[i].vtotal);
+    }
+
+    edid_get_sad_list(edid, &sad_list, &num_sads);
+    fprintf(stdout, "\n[Short Audio Descriptors]\n");
+    for (i = 0; i < num_sads; i++) {
+        fprintf(stdout, "----%d: [format:%d, channels:%d, rates:0x%02x, byte3:0x%02x]\n",
+                i, sad_list[i].format, sad_list[i].max_channels,
+                sad_list[i].sample_rates, sad_list[i].byte3);
+    }
+    fprintf(stdout, "----speaker allocation: 0x%02x\n", edid_get_speaker_allocation(edid));
+
+    //parse_hdmi_edid <xres> <yres> <hz> ranks the SVDs for that source
+    if (argc == 4) {
+        const struct svd_t *ranked[MAX_SVDS];
+        unsigned int num_ranked = edid_get_ranked_svds(edid, atoi(argv[1]), atoi(argv[2]),
+                                                       atoi(argv[3]), ranked, MAX_SVDS);
+        fprintf(stdout, "\n[Ranked for %sx%s@%s]\n", argv[1], argv[2], argv[3]);
+        for (i = 0; i < num_ranked; i++) {
+            fprintf(stdout, "----%d: %s [code:%d]\n", i, ranked[i]->info.name, ranked[i]->code);
+        }
+    }
+
     fprintf(stdout, "\n[S3D Optional Formats]\n");
     print_s3d_format_info(edid, edid_get_s3d_format_info(edid, HDMI_FRAME_PACKING));
     print_s3d_format_info(edid, edid_get_s3d_format_info(edid, HDMI_FIELD_ALTERNATIVE));
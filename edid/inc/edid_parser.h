@@ -19,6 +19,12 @@
 
 #define EDID_SIZE 256
 #define MAX_VIC_CODES_PER_3D_FORMAT 16
+//4 in the base block, up to 6 more in the CEA extension
+#define MAX_DTDS 10
+//A datablock holds up to 31 bytes of 3-byte descriptors
+#define MAX_SADS 10
+//The video datablock length field is 5 bits wide
+#define MAX_SVDS 31
 
 struct edid_t;
 
@@ -89,6 +95,24 @@ struct svd_t {
     struct svd_info_t info;
 };
 
+//Short audio descriptor, CEA-861 Table 45
+struct sad_t {
+    uint8_t format;         //audio format code, 1 = LPCM, 2 = AC-3, 7 = DTS...
+    uint8_t max_channels;
+    uint8_t sample_rates;   //bit 0 = 32kHz ... bit 6 = 192kHz
+    uint8_t byte3;          //LPCM sample sizes or max bit rate / 8kHz
+};
+
+//Detailed timing descriptor
+struct dtd_t {
+    uint32_t pixel_clock_khz;
+    uint32_t xres;
+    uint32_t yres;
+    uint32_t htotal;
+    uint32_t vtotal;
+    bool interlaced;
+};
+
 struct hdmi_s3d_format_vic_info_t {
     uint8_t vic_pos;
     enum hdmi_3d_subsampling subsampling;
@@ -100,9 +124,12 @@ struct hdmi_s3d_format_info_t {
     struct hdmi_s3d_format_vic_info_t vic_info[MAX_VIC_CODES_PER_3D_FORMAT];
 };
 
+//Parsing the EDID that was parsed last hands back the same, shared, result
 int edid_parser_init(struct edid_t **edid, const uint8_t *raw_edid_data);
 void edid_parser_deinit(struct edid_t *edid);
 
+bool edid_has_datablock(struct edid_t *edid, enum datablock_id type);
+
 bool edid_s3d_capable(struct edid_t *edid);
 bool edid_supports_s3d_format(struct edid_t *edid, enum hdmi_3d_format format);
 const struct hdmi_s3d_format_info_t * edid_get_s3d_format_info(struct edid_t *edid, enum hdmi_3d_format format);
@@ -110,4 +137,14 @@ const struct hdmi_s3d_format_info_t * edid_get_s3d_format_info(struct edid_t *ed
 void edid_get_svd_list(struct edid_t *edid, struct svd_t **list, unsigned int *num_elements);
 const struct svd_t *edid_get_svd_descriptor(struct edid_t *edid, uint8_t vic_pos);
 
+//Fills list with up to max_elements SVDs, best match for the source first.
+//hz is the source frame rate, e.g. 24 for film content. Returns the count.
+unsigned int edid_get_ranked_svds(struct edid_t *edid, uint32_t xres, uint32_t yres, uint32_t hz,
+                                  const struct svd_t **list, unsigned int max_elements);
+
+void edid_get_sad_list(struct edid_t *edid, const struct sad_t **list, unsigned int *num_elements);
+uint8_t edid_get_speaker_allocation(struct edid_t *edid);
+
+void edid_get_dtd_list(struct edid_t *edid, const struct dtd_t **list, unsigned int *num_elements);
+
 #endif //_EDID_PARSER_
\ No newline at end of file
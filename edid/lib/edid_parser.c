@@ -17,7 +17,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <inc/edid_parser.h>
 #include "edid_parser_priv.h"
@@ -119,7 +121,7 @@ static void update_s3d_format(struct edid_t *edid, enum hdmi_3d_format format,
                                 uint8_t vic_pos, enum hdmi_3d_subsampling subsamp)
 {
     unsigned int format_ix, vic_pos_ix;
-    if (vic_pos > edid->num_svds) {
+    if (vic_pos >= edid->num_svds) {
         return;
     }
 
@@ -150,37 +152,51 @@ static void update_s3d_format(struct edid_t *edid, enum hdmi_3d_format format,
 }
 
 /* This function was originally written by Mythri pk */
-static int edid_get_datablock_offset(const uint8_t *edid_data, enum datablock_id type, unsigned int *off)
+static void edid_index_datablocks(struct edid_t *edid, const uint8_t *edid_data)
 {
     uint8_t val;
     uint8_t ext_length;
-    uint8_t offset;
+    unsigned int offset;
+    unsigned int type;
 
     //CEA extension signaled? If not, then no datablocks are contained
-    if (edid_data[0x7e] == 0x00) {
-        return 1;
+    if (edid_data[0x7e] == 0x00 || edid_data[0x80] != 0x02) {
+        return;
     }
 
     //18-byte descriptors only? Otherwise, there are datablocks present
     ext_length = edid_data[0x82];
-    if (ext_length == 0x4) {
-        return 1;
+    if (ext_length <= 0x4 || ext_length > 0x7f) {
+        return;
     }
 
-    //Start of first extended data block
+    //Start of first extended data block, every type is recorded in one pass
     offset = 0x84;
-    while (offset < (0x80 + ext_length)) {
+    while (offset < (0x80u + ext_length)) {
         val = edid_data[offset];
         //Upper 3 bits indicate block type
-        if ((val >> 5) == type) {
-            *off = offset;
-            return 0;
-        } else {
-            //lower 5 bits indicate block length
-            offset += (val & 0x1F) + 1;
+        type = val >> 5;
+        if (type <= DATABLOCK_SPEAKERS && !edid->datablock_off[type]) {
+            edid->datablock_off[type] = offset;
+        }
+        //The HDMI VSDB starts with the IEEE OUI 0x000C03, LSB first
+        if (type == DATABLOCK_VENDOR && !edid->hdmi_vsdb_off && (val & 0x1F) >= 5 &&
+            edid_data[offset + 1] == 0x03 && edid_data[offset + 2] == 0x0C &&
+            edid_data[offset + 3] == 0x00) {
+            edid->hdmi_vsdb_off = offset;
         }
+        //lower 5 bits indicate block length
+        offset += (val & 0x1F) + 1;
     }
-    return 1;
+}
+
+static int edid_get_datablock_offset(struct edid_t *edid, enum datablock_id type, unsigned int *off)
+{
+    if (!edid->datablock_off[type]) {
+        return 1;
+    }
+    *off = edid->datablock_off[type];
+    return 0;
 }
 
 static void edid_parse_s3d_support(struct edid_t *edid, const uint8_t *edid_data)
@@ -196,11 +212,14 @@ static void edid_parse_s3d_support(struct edid_t *edid, const uint8_t *edid_data
 
     //memset(edid->s3d_formats, 0, sizeof(edid->s3d_formats));
 
-    //S3D HDMI information is signaled in the Vendor Specific datablock
-    if(edid_get_datablock_offset(edid_data, DATABLOCK_VENDOR, &off))
+    //S3D HDMI information is signaled in the HDMI Vendor Specific datablock
+    off = edid->hdmi_vsdb_off;
+    if (!off)
         return;
 
-    //Skip header and other non-S3D related fields
+    //Skip header and other non-S3D related fields, present only in a long enough VSDB
+    if ((edid_data[off] & 0x1F) < 8)
+        return;
     off += 8;
     val = edid_data[off++];
 
@@ -314,7 +333,7 @@ static void edid_parse_s3d_support(struct edid_t *edid, const uint8_t *edid_data
 
 static void edid_fill_svd_info(uint8_t code, struct svd_info_t *info)
 {
-    if(code > NUM_SVD_ENTRIES)
+    if(code >= NUM_SVD_ENTRIES)
         code = 0;
     memcpy(info, &svd_table[code], sizeof(struct svd_info_t));
 }
@@ -323,7 +342,7 @@ static void edid_parse_svds(struct edid_t *edid, const uint8_t *raw_edid_data)
 {
     unsigned int offset;
     unsigned int i;
-    if (edid_get_datablock_offset(raw_edid_data, DATABLOCK_VIDEO, &offset)) {
+    if (edid_get_datablock_offset(edid, DATABLOCK_VIDEO, &offset)) {
         edid->num_svds = 0;
         edid->svd_list = NULL;
         return ;
@@ -333,12 +352,96 @@ static void edid_parse_svds(struct edid_t *edid, const uint8_t *raw_edid_data)
     edid->svd_list = (struct svd_t *) malloc(edid->num_svds * sizeof(struct svd_t));
     for (i = 0; i < edid->num_svds; i++) {
         struct svd_t *svd = &edid->svd_list[i];
-        svd->code = raw_edid_data[offset + i] & 0x7F;
-        svd->native = (raw_edid_data[offset + i] & 0x80) == 0x80;
+        //Descriptors follow the one byte datablock header
+        svd->code = raw_edid_data[offset + 1 + i] & 0x7F;
+        svd->native = (raw_edid_data[offset + 1 + i] & 0x80) == 0x80;
         edid_fill_svd_info(svd->code, &svd->info);
     }
 }
 
+static void edid_parse_audio(struct edid_t *edid, const uint8_t *raw_edid_data)
+{
+    unsigned int offset;
+    unsigned int i, len;
+
+    if (!edid_get_datablock_offset(edid, DATABLOCK_AUDIO, &offset)) {
+        len = raw_edid_data[offset] & 0x1F;
+        for (i = 0; i + 3 <= len && edid->num_sads < MAX_SADS; i += 3) {
+            const uint8_t *d = &raw_edid_data[offset + 1 + i];
+            struct sad_t *sad = &edid->sad_list[edid->num_sads++];
+            sad->format = (d[0] >> 3) & 0x0F;
+            sad->max_channels = (d[0] & 0x07) + 1;
+            sad->sample_rates = d[1] & 0x7F;
+            sad->byte3 = d[2];
+        }
+    }
+
+    if (!edid_get_datablock_offset(edid, DATABLOCK_SPEAKERS, &offset)) {
+        edid->speaker_alloc = raw_edid_data[offset + 1];
+    }
+}
+
+static void edid_add_dtd(struct edid_t *edid, const uint8_t *d)
+{
+    struct dtd_t *dtd;
+    uint32_t pclk = d[0] | (d[1] << 8);
+
+    //A zero pixel clock marks a display descriptor, not a timing
+    if (pclk == 0 || edid->num_dtds >= MAX_DTDS) {
+        return;
+    }
+
+    dtd = &edid->dtd_list[edid->num_dtds++];
+    dtd->pixel_clock_khz = pclk * 10;
+    dtd->xres = d[2] | ((d[4] & 0xF0) << 4);
+    dtd->htotal = dtd->xres + (d[3] | ((d[4] & 0x0F) << 8));
+    dtd->yres = d[5] | ((d[7] & 0xF0) << 4);
+    dtd->vtotal = dtd->yres + (d[6] | ((d[7] & 0x0F) << 8));
+    dtd->interlaced = (d[17] & 0x80) == 0x80;
+}
+
+static void edid_parse_dtds(struct edid_t *edid, const uint8_t *raw_edid_data)
+{
+    unsigned int offset;
+
+    //Four 18-byte descriptors in the base block
+    for (offset = 0x36; offset + 18 <= 0x7e; offset += 18) {
+        edid_add_dtd(edid, &raw_edid_data[offset]);
+    }
+
+    if (raw_edid_data[0x7e] == 0x00 || raw_edid_data[0x80] != 0x02 ||
+        raw_edid_data[0x82] < 0x04 || raw_edid_data[0x82] > 0x7f) {
+        return;
+    }
+
+    //CEA extension descriptors start where the datablocks end
+    for (offset = 0x80 + raw_edid_data[0x82]; offset + 18 <= 0xff; offset += 18) {
+        edid_add_dtd(edid, &raw_edid_data[offset]);
+    }
+}
+
+/*
+ * hwc parses the same EDID on every hotplug and mode query, so the last
+ * result is kept and handed out again while the raw bytes match.
+ */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct edid_t *cached_edid;
+
+static void edid_free(struct edid_t *edid)
+{
+    free(edid->s3d_format_list);
+    free(edid->svd_list);
+    free(edid);
+}
+
+//Must be called with cache_lock held
+static void edid_put_locked(struct edid_t *edid)
+{
+    if (--edid->refs == 0) {
+        edid_free(edid);
+    }
+}
+
 /*=======================================================*/
 int edid_parser_init(struct edid_t **edid_handle, const uint8_t *raw_edid_data)
 {
@@ -346,14 +449,42 @@ int edid_parser_init(struct edid_t **edid_handle, const uint8_t *raw_edid_data)
         return -1;
     }
 
+    if(raw_edid_data == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    //The checksum bytes reject most different EDIDs before the full compare
+    if (cached_edid && cached_edid->raw[0x7f] == raw_edid_data[0x7f] &&
+        cached_edid->raw[0xff] == raw_edid_data[0xff] &&
+        memcmp(cached_edid->raw, raw_edid_data, EDID_SIZE) == 0) {
+        cached_edid->refs++;
+        *edid_handle = cached_edid;
+        pthread_mutex_unlock(&cache_lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
     struct edid_t *edid = (struct edid_t *) malloc(sizeof(struct edid_t));
     if (edid == NULL) {
         return -1;
     }
 
     memset(edid, 0, sizeof(struct edid_t));
+    memcpy(edid->raw, raw_edid_data, EDID_SIZE);
+    edid_index_datablocks(edid, raw_edid_data);
     edid_parse_svds(edid, raw_edid_data);
     edid_parse_s3d_support(edid, raw_edid_data);
+    edid_parse_audio(edid, raw_edid_data);
+    edid_parse_dtds(edid, raw_edid_data);
+
+    pthread_mutex_lock(&cache_lock);
+    if (cached_edid) {
+        edid_put_locked(cached_edid);
+    }
+    edid->refs = 2;
+    cached_edid = edid;
+    pthread_mutex_unlock(&cache_lock);
 
     *edid_handle = edid;
     return 0;
@@ -361,9 +492,20 @@ int edid_parser_init(struct edid_t **edid_handle, const uint8_t *raw_edid_data)
 
 void edid_parser_deinit(struct edid_t *edid)
 {
-    free(edid->s3d_format_list);
-    free(edid->svd_list);
-    free(edid);
+    if (edid == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    edid_put_locked(edid);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+bool edid_has_datablock(struct edid_t *edid, enum datablock_id type)
+{
+    if (type > DATABLOCK_SPEAKERS)
+        return false;
+    return edid->datablock_off[type] != 0;
 }
 
 bool edid_s3d_capable(struct edid_t *edid)
@@ -404,7 +546,111 @@ void edid_get_svd_list(struct edid_t *edid, struct svd_t **list, unsigned int *n
 
 const struct svd_t *edid_get_svd_descriptor(struct edid_t *edid, uint8_t vic_pos)
 {
-    if(vic_pos > edid->num_svds)
+    if(vic_pos >= edid->num_svds)
         return NULL;
     return &edid->svd_list[vic_pos];
 }
+
+static uint32_t edid_svd_score(const struct svd_info_t *info, uint32_t xres, uint32_t yres,
+                               uint32_t hz, bool native)
+{
+    uint32_t score;
+    uint32_t area = xres * yres;
+    uint32_t mode_area = info->xres * info->yres;
+
+    //same resolution needs no scaling at all
+    score = info->xres == xres && info->yres == yres;
+
+    //a multiple of the source rate shows every frame for the same time (24p on 24/48/120Hz)
+    score = (score << 1) | (info->hz % hz == 0);
+
+    score = (score << 1) | (info->scan_type == HDMI_SCAN_PROGRESSIVE);
+
+    //prefer to upscale
+    score = (score << 1) | (info->xres >= xres && info->yres >= yres);
+
+    //pick minimum scaling [0..16]
+    if (mode_area > area)
+        score = (score << 5) | (16 * area / mode_area);
+    else
+        score = (score << 5) | (16 * mode_area / area);
+
+    //pick closest frame rate [0..240]
+    if (info->hz > hz)
+        score = (score << 8) | (240 * hz / info->hz);
+    else
+        score = (score << 8) | (240 * info->hz / hz);
+
+    return (score << 1) | native;
+}
+
+unsigned int edid_get_ranked_svds(struct edid_t *edid, uint32_t xres, uint32_t yres, uint32_t hz,
+                                  const struct svd_t **list, unsigned int max_elements)
+{
+    unsigned int i, j, count;
+    uint32_t scores[MAX_SVDS];
+
+    if (list == NULL || !xres || !yres || !hz)
+        return 0;
+
+    //The parse result may be shared through the cache
+    pthread_mutex_lock(&cache_lock);
+    if (!edid->rank_valid || edid->rank_xres != xres || edid->rank_yres != yres ||
+        edid->rank_hz != hz) {
+        //Insertion sort, there are at most 31 SVDs
+        for (i = 0, count = 0; i < edid->num_svds; i++) {
+            const struct svd_t *svd = &edid->svd_list[i];
+            uint32_t score;
+
+            //reserved and unknown codes
+            if (!svd->info.xres || !svd->info.yres)
+                continue;
+
+            score = edid_svd_score(&svd->info, xres, yres, hz, svd->native);
+            for (j = count; j > 0 && scores[j - 1] < score; j--) {
+                scores[j] = scores[j - 1];
+                edid->rank_list[j] = edid->rank_list[j - 1];
+            }
+            scores[j] = score;
+            edid->rank_list[j] = i;
+            count++;
+        }
+        //terminate the list for the cached walk below
+        if (count < MAX_SVDS)
+            edid->rank_list[count] = 0xFF;
+
+        edid->rank_xres = xres;
+        edid->rank_yres = yres;
+        edid->rank_hz = hz;
+        edid->rank_valid = true;
+    }
+
+    for (i = 0; i < max_elements && i < MAX_SVDS && edid->rank_list[i] != 0xFF; i++)
+        list[i] = &edid->svd_list[edid->rank_list[i]];
+    pthread_mutex_unlock(&cache_lock);
+
+    return i;
+}
+
+void edid_get_sad_list(struct edid_t *edid, const struct sad_t **list, unsigned int *num_elements)
+{
+    if(list == NULL || num_elements == NULL)
+        return;
+
+    *list = edid->sad_list;
+    *num_elements = edid->num_sads;
+}
+
+uint8_t edid_get_speaker_allocation(struct edid_t *edid)
+{
+    return edid->speaker_alloc;
+}
+
+void edid_get_dtd_list(struct edid_t *edid, const struct dtd_t **list, unsigned int *num_elements)
+{
+    if(list == NULL || num_elements == NULL)
+        return;
+
+    *list = edid->dtd_list;
+    *num_elements = edid->num_dtds;
+}
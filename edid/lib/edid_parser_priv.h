@@ -21,6 +21,15 @@ struct hdmi_s3d_format_t {
 };
 
 struct edid_t {
+    uint8_t raw[EDID_SIZE];
+    //One held by each edid_parser_init() caller and one by the cache
+    unsigned int refs;
+
+    //Offset of the first CEA datablock of each type, 0 if there is none
+    unsigned int datablock_off[DATABLOCK_SPEAKERS + 1];
+    //The vendor block carrying the HDMI OUI, which need not be the first
+    unsigned int hdmi_vsdb_off;
+
     bool s3d_capable;
 
     unsigned int num_s3d_formats;
@@ -28,4 +37,16 @@ struct edid_t {
 
     unsigned int num_svds;
     struct svd_t *svd_list;
+
+    //Last edid_get_ranked_svds() query, hwc repeats it on every mode switch
+    bool rank_valid;
+    uint32_t rank_xres, rank_yres, rank_hz;
+    uint8_t rank_list[MAX_SVDS];
+
+    unsigned int num_sads;
+    struct sad_t sad_list[MAX_SADS];
+    uint8_t speaker_alloc;
+
+    unsigned int num_dtds;
+    struct dtd_t dtd_list[MAX_DTDS];
 };
@@ -34,6 +34,13 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 
 #ifndef EV_SYN
 #define EV_SYN 0
@@ -296,6 +303,269 @@ char **names[EV_MAX + 1] = {
 #define LONG(x) ((x)/BITS_PER_LONG)
 #define test_bit(bit, array)	((array[LONG(bit)] >> OFF(bit)) & 1)
 
+/*
+ * Latency mode (-l): for every SYN_REPORT the kernel timestamp is compared
+ * with the time read() returned it, per device. With -V the omapfb vsync
+ * uevents hwc listens to are read as well, and the time from each report
+ * to the next display vsync is recorded: together that is the input part
+ * of touch-to-display latency. Both need the event clock to be the
+ * monotonic clock the vsync timestamps use (EVIOCSCLOCKID, 3.4+ kernels).
+ */
+
+#define LAT_MAX_DEVS	8
+#define LAT_BUCKETS	9
+#define LAT_PRINT_SEC	10
+
+static const unsigned int lat_bucket_us[LAT_BUCKETS - 1] = {
+	250, 500, 1000, 2000, 4000, 8000, 16000, 33000
+};
+
+struct lat_hist {
+	unsigned int count;
+	unsigned int hist[LAT_BUCKETS];
+	long long sum_us, min_us, max_us;
+};
+
+struct lat_dev {
+	int fd;
+	const char *path;
+	char name[64];
+	struct lat_hist delivery;	/* kernel timestamp to read() */
+	struct lat_hist interval;	/* between reports */
+	struct lat_hist jitter;		/* change of the interval */
+	struct lat_hist to_vsync;	/* report to the next vsync */
+	long long last_report_us;
+	long long last_interval_us;
+	long long pending_us;		/* first report since the last vsync */
+};
+
+static volatile sig_atomic_t lat_stop;
+
+static void lat_sigint(int sig)
+{
+	lat_stop = 1;
+}
+
+static long long lat_now_us(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void lat_add(struct lat_hist *h, long long us)
+{
+	int i;
+
+	for (i = 0; i < LAT_BUCKETS - 1; i++)
+		if (us < lat_bucket_us[i])
+			break;
+	h->hist[i]++;
+	if (!h->count || us < h->min_us)
+		h->min_us = us;
+	if (!h->count || us > h->max_us)
+		h->max_us = us;
+	h->sum_us += us;
+	h->count++;
+}
+
+static void lat_print(const char *what, const struct lat_hist *h)
+{
+	int i;
+
+	if (!h->count)
+		return;
+
+	printf("  %-10s n %u, min %lld, avg %lld, max %lld us\n            ",
+		what, h->count, h->min_us, h->sum_us / h->count, h->max_us);
+	for (i = 0; i < LAT_BUCKETS - 1; i++)
+		printf(" <%u:%u", lat_bucket_us[i], h->hist[i]);
+	printf(" >=%u:%u\n", lat_bucket_us[i - 1], h->hist[i]);
+}
+
+static void lat_report(struct lat_dev *devs, int ndevs, unsigned int vsyncs)
+{
+	int i;
+
+	for (i = 0; i < ndevs; i++) {
+		printf("%s (%s):\n", devs[i].path, devs[i].name);
+		lat_print("delivery", &devs[i].delivery);
+		lat_print("interval", &devs[i].interval);
+		lat_print("jitter", &devs[i].jitter);
+		lat_print("to vsync", &devs[i].to_vsync);
+	}
+	if (vsyncs)
+		printf("%u display vsyncs\n", vsyncs);
+	fflush(stdout);
+}
+
+static int lat_open_uevent(void)
+{
+	struct sockaddr_nl addr;
+	int s;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 0xffffffff;
+
+	s = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT);
+	if (s < 0)
+		return -1;
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+/* VSYNC= of an omapfb vsync uevent in us, 0 for any other uevent */
+static long long lat_parse_vsync(const char *buf, int len)
+{
+	const char *s = buf;
+
+	if (strcmp(s, "change@/devices/platform/omapfb") &&
+	    strcmp(s, "change@/devices/virtual/switch/omapfb-vsync"))
+		return 0;
+
+	for (s += strlen(s) + 1; s - buf < len && *s; s += strlen(s) + 1)
+		if (!strncmp(s, "VSYNC=", strlen("VSYNC=")))
+			return strtoull(s + strlen("VSYNC="), NULL, 0) / 1000;
+
+	return 0;
+}
+
+static void lat_event(struct lat_dev *d, const struct input_event *ev, long long now_us)
+{
+	long long t_us, interval;
+
+	if (ev->type != EV_SYN || ev->code != SYN_REPORT)
+		return;
+
+	t_us = (long long) ev->time.tv_sec * 1000000 + ev->time.tv_usec;
+	lat_add(&d->delivery, now_us > t_us ? now_us - t_us : 0);
+
+	if (d->last_report_us) {
+		interval = t_us - d->last_report_us;
+		lat_add(&d->interval, interval);
+		if (d->last_interval_us)
+			lat_add(&d->jitter, llabs(interval - d->last_interval_us));
+		d->last_interval_us = interval;
+	}
+	d->last_report_us = t_us;
+
+	if (!d->pending_us)
+		d->pending_us = t_us;
+}
+
+static int latency_test(char **paths, int ndevs, int with_vsync)
+{
+	struct lat_dev devs[LAT_MAX_DEVS];
+	struct pollfd fds[LAT_MAX_DEVS + 1];
+	struct input_event ev[64];
+	char buf[1024];
+	clockid_t clk = CLOCK_MONOTONIC;
+	long long next_print;
+	unsigned int vsyncs = 0;
+	int nfds, i, j, rd;
+
+	if (ndevs > LAT_MAX_DEVS)
+		ndevs = LAT_MAX_DEVS;
+
+	memset(devs, 0, sizeof(devs));
+	for (i = 0; i < ndevs; i++) {
+		devs[i].path = paths[i];
+		if ((devs[i].fd = open(paths[i], O_RDONLY)) < 0) {
+			perror(paths[i]);
+			return 1;
+		}
+		strcpy(devs[i].name, "Unknown");
+		ioctl(devs[i].fd, EVIOCGNAME(sizeof(devs[i].name)), devs[i].name);
+#ifdef EVIOCSCLOCKID
+		if (ioctl(devs[i].fd, EVIOCSCLOCKID, &clk))
+#endif
+			clk = CLOCK_REALTIME;
+		fds[i].fd = devs[i].fd;
+		fds[i].events = POLLIN;
+	}
+	nfds = ndevs;
+
+	if (with_vsync) {
+		if (clk != CLOCK_MONOTONIC) {
+			fprintf(stderr, "evtest: no monotonic event clock, not correlating with vsync\n");
+		} else if ((fds[nfds].fd = lat_open_uevent()) < 0) {
+			perror("evtest: uevent socket");
+		} else {
+			fds[nfds++].events = POLLIN;
+			printf("Correlating with display vsync, needs vsync enabled by the compositor\n");
+		}
+	}
+
+#ifdef EVIOCSCLOCKID
+	/* one device without EVIOCSCLOCKID puts them all back on the default clock */
+	if (clk == CLOCK_REALTIME)
+		for (i = 0; i < ndevs; i++)
+			ioctl(devs[i].fd, EVIOCSCLOCKID, &clk);
+#endif
+
+	signal(SIGINT, lat_sigint);
+	printf("Measuring latency ... (interrupt to exit)\n");
+	next_print = lat_now_us(clk) + LAT_PRINT_SEC * 1000000LL;
+
+	while (!lat_stop) {
+		if (poll(fds, nfds, 1000) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("evtest: poll");
+			break;
+		}
+
+		for (i = 0; i < ndevs; i++) {
+			long long now_us;
+
+			if (!(fds[i].revents & POLLIN))
+				continue;
+			rd = read(fds[i].fd, ev, sizeof(ev));
+			/* timestamp the read before anything else */
+			now_us = lat_now_us(clk);
+			if (rd < (int) sizeof(struct input_event)) {
+				perror("\nevtest: error reading");
+				lat_stop = 1;
+				break;
+			}
+			for (j = 0; j < rd / (int) sizeof(struct input_event); j++)
+				lat_event(&devs[i], &ev[j], now_us);
+		}
+
+		if (nfds > ndevs && (fds[ndevs].revents & POLLIN)) {
+			rd = recv(fds[ndevs].fd, buf, sizeof(buf) - 1, 0);
+			if (rd > 0) {
+				long long vsync_us;
+
+				buf[rd] = 0;
+				vsync_us = lat_parse_vsync(buf, rd);
+				if (vsync_us) {
+					vsyncs++;
+					for (i = 0; i < ndevs; i++) {
+						if (devs[i].pending_us && vsync_us >= devs[i].pending_us) {
+							lat_add(&devs[i].to_vsync, vsync_us - devs[i].pending_us);
+							devs[i].pending_us = 0;
+						}
+					}
+				}
+			}
+		}
+
+		if (lat_now_us(clk) >= next_print) {
+			lat_report(devs, ndevs, vsyncs);
+			next_print += LAT_PRINT_SEC * 1000000LL;
+		}
+	}
+
+	lat_report(devs, ndevs, vsyncs);
+	return 0;
+}
+
 int main (int argc, char **argv)
 {
 	int fd, rd, i, j, k;
@@ -308,10 +578,23 @@ int main (int argc, char **argv)
 
 	if (argc < 2) {
 		printf("Usage: evtest /dev/input/eventX\n");
+		printf("       evtest -l [-V] /dev/input/eventX [/dev/input/eventY ...]\n");
 		printf("Where X = input device number\n");
+		printf("  -l  measure event delivery latency and report jitter\n");
+		printf("  -V  also measure report to display vsync time\n");
 		return 1;
 	}
 
+	if (!strcmp(argv[1], "-l")) {
+		int with_vsync = argc > 2 && !strcmp(argv[2], "-V");
+
+		if (argc < 3 + with_vsync) {
+			printf("evtest: no input device\n");
+			return 1;
+		}
+		return latency_test(argv + 2 + with_vsync, argc - 2 - with_vsync, with_vsync);
+	}
+
 	if ((fd = open(argv[argc - 1], O_RDONLY)) < 0) {
 		perror("evtest");
 		return 1;
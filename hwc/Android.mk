@@ -22,7 +22,7 @@ LOCAL_ARM_MODE := arm
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/../vendor/lib/hw
 LOCAL_SHARED_LIBRARIES := liblog libEGL libcutils libutils libhardware libhardware_legacy libz \
                           libion_ti
-LOCAL_SRC_FILES := hwc.c rgz_2d.c dock_image.c sw_vsync.c
+LOCAL_SRC_FILES := hwc.c rgz_2d.c dock_image.c sw_vsync.c hwc_trace.c hwc_record.c hwc_stats.c hwc_policy.c
 LOCAL_STATIC_LIBRARIES := libpng
 
 LOCAL_MODULE_TAGS := optional
@@ -33,9 +33,30 @@ LOCAL_C_INCLUDES += external/libpng external/zlib
 
 LOCAL_C_INCLUDES += \
     $(LOCAL_PATH)/../edid/inc \
-    $(LOCAL_PATH)/../include
+    $(LOCAL_PATH)/../include \
+    $(LOCAL_PATH)/../include/trace
 LOCAL_SHARED_LIBRARIES += libedid
 
 # LOG_NDEBUG=0 means verbose logging enabled
 # LOCAL_CFLAGS += -DLOG_NDEBUG=0
 include $(BUILD_SHARED_LIBRARY)
+
+# Offline regionizer benchmark, replays layer lists recorded with debug.hwc.record
+include $(CLEAR_VARS)
+LOCAL_ARM_MODE := arm
+LOCAL_SRC_FILES := rgz_bench.c rgz_2d.c
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_MODULE_TAGS := optional
+LOCAL_MODULE := rgz_bench
+LOCAL_CFLAGS := -DLOG_TAG=\"rgz_bench\"
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../include
+include $(BUILD_EXECUTABLE)
+
+# Composition feedback test, runs hwc_policy the way hwc_prepare does with the composition cache
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := hwc_policy_test.c hwc_policy.c
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_MODULE_TAGS := optional tests
+LOCAL_MODULE := hwc_policy_test
+LOCAL_CFLAGS := -DLOG_TAG=\"hwc_policy_test\"
+include $(BUILD_EXECUTABLE)
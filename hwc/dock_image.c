@@ -189,8 +189,9 @@ void load_dock_image()
     }
 }
 
+/* NULL until load_dock_image() succeeded */
 image_info_t *get_dock_image()
 {
-    return &dock_image.image;
+    return dock_image.image.rowbytes ? &dock_image.image : NULL;
 }
 
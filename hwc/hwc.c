@@ -46,6 +46,10 @@
 #include "hwc_dev.h"
 #include "dock_image.h"
 #include "sw_vsync.h"
+#include "hwc_trace.h"
+#include "hwc_record.h"
+#include "hwc_stats.h"
+#include "hwc_policy.h"
 
 #define min(a, b) ( { typeof(a) __a = (a), __b = (b); __a < __b ? __a : __b; } )
 #define max(a, b) ( { typeof(a) __a = (a), __b = (b); __a > __b ? __a : __b; } )
@@ -56,10 +60,11 @@
 
 #define DIV_ROUND_UP(a, b) (((a) + (b) - 1) / (b))
 
-#define MAX_HWC_LAYERS 32
 #define MAX_HW_OVERLAYS 4
 #define NUM_NONSCALING_OVERLAYS 1
 #define NUM_EXT_DISPLAY_BACK_BUFFERS 2
+/* number of compositions without FB cloning before the TILER2D buffers are released */
+#define TILER2D_IDLE_FRAMES 120
 #define ASPECT_RATIO_TOLERANCE 0.02f
 
 /* used by property settings */
@@ -248,22 +253,39 @@ static void dump_set_info(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t*
 
 static int sync_id = 0;
 
-static bool is_valid_format(uint32_t format)
+/*
+ * Everything the frame loop needs to know about a pixel format comes from a
+ * single lookup: whether DSS can scan it, its color order and bits per pixel
+ */
+#define FMT_VALID       (1 << 8)
+#define FMT_RGB         (1 << 9)
+#define FMT_BGR         (1 << 10)
+#define FMT_NV12        (1 << 11)
+#define FMT_BPP(c)      ((c) & 0xff)
+
+static uint32_t format_class(uint32_t format)
 {
     switch(format) {
+    case HAL_PIXEL_FORMAT_BGRA_8888:
+    case HAL_PIXEL_FORMAT_BGRX_8888:
+        return FMT_VALID | FMT_RGB | 32;
     case HAL_PIXEL_FORMAT_RGB_565:
+        return FMT_VALID | FMT_RGB | 16;
     case HAL_PIXEL_FORMAT_RGBX_8888:
     case HAL_PIXEL_FORMAT_RGBA_8888:
-    case HAL_PIXEL_FORMAT_BGRA_8888:
-    case HAL_PIXEL_FORMAT_BGRX_8888:
+        return FMT_VALID | FMT_BGR | 32;
     case HAL_PIXEL_FORMAT_TI_NV12:
     case HAL_PIXEL_FORMAT_TI_NV12_1D:
-        return true;
-
+        return FMT_VALID | FMT_NV12 | 8;
     default:
-        return false;
+        return 0;
     }
 }
+
+static inline bool is_valid_format(uint32_t format)
+{
+    return (format_class(format) & FMT_VALID) != 0;
+}
 #ifdef OMAP_ENHANCEMENT_S3D
 static uint32_t get_s3d_layout_type(hwc_layer_1_t *layer)
 {
@@ -274,6 +296,70 @@ static uint32_t get_s3d_layout_order(hwc_layer_1_t *layer)
 {
     return (layer->flags & S3DLayoutOrderMask) >> S3DLayoutOrderShift;
 }
+
+static void setup_s3d_views(omap_hwc_device_t *hwc_dev)
+{
+    s3d_views_t *sv = &hwc_dev->s3d_views;
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
+    int i;
+
+    if (sv->valid &&
+        sv->input_type == hwc_dev->s3d_input_type &&
+        sv->input_order == hwc_dev->s3d_input_order &&
+        sv->output_type == ext->s3d_type &&
+        sv->output_order == ext->s3d_order)
+        return;
+
+    if (hwc_dev->s3d_input_type != eSideBySide && hwc_dev->s3d_input_type != eTopBottom)
+        ALOGE("Unsupported S3D layer type!");
+    if (ext->s3d_type != eSideBySide && ext->s3d_type != eTopBottom)
+        ALOGE("Unsupported S3D display type!");
+
+    for (i = 0; i < 2; i++) {
+        struct s3d_view *v = &sv->view[i];
+        bool left_view = i == 0;
+
+        v->crop_shift_x = hwc_dev->s3d_input_type == eSideBySide;
+        v->crop_shift_y = hwc_dev->s3d_input_type == eTopBottom;
+        v->crop_second = left_view == (hwc_dev->s3d_input_order == eRightViewFirst);
+        v->win_shift_x = ext->s3d_type == eSideBySide;
+        v->win_shift_y = ext->s3d_type == eTopBottom;
+        v->win_second = left_view == (ext->s3d_order == eRightViewFirst);
+    }
+
+    sv->input_type = hwc_dev->s3d_input_type;
+    sv->input_order = hwc_dev->s3d_input_order;
+    sv->output_type = ext->s3d_type;
+    sv->output_order = ext->s3d_order;
+    sv->valid = true;
+}
+
+/*
+ * Send the S3D input in its own layout if the sink accepts it, so a single
+ * pipeline can pass it through untouched.  Otherwise repack it into side by
+ * side (or top bottom) using one pipeline per eye.  HDMI frames always carry
+ * the left view first.
+ */
+static void select_s3d_transport(omap_hwc_device_t *hwc_dev)
+{
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
+
+    if (ext->s3d_formats & (1u << hwc_dev->s3d_input_type))
+        ext->s3d_type = hwc_dev->s3d_input_type;
+    else if (ext->s3d_formats & (1u << eSideBySide))
+        ext->s3d_type = eSideBySide;
+    else
+        ext->s3d_type = eTopBottom;
+    ext->s3d_order = eLeftViewFirst;
+
+    setup_s3d_views(hwc_dev);
+}
+
+static inline bool s3d_needs_split(omap_hwc_device_t *hwc_dev)
+{
+    return hwc_dev->ext.s3d_type != hwc_dev->s3d_input_type ||
+           hwc_dev->ext.s3d_order != hwc_dev->s3d_input_order;
+}
 #endif
 
 static bool scaled(hwc_layer_1_t *layer)
@@ -302,62 +388,29 @@ static bool is_protected(hwc_layer_1_t *layer)
 
 #define is_BLENDED(layer) ((layer)->blending != HWC_BLENDING_NONE)
 
-static bool is_RGB(IMG_native_handle_t *handle)
+static inline bool is_RGB(IMG_native_handle_t *handle)
 {
-    switch(handle->iFormat)
-    {
-    case HAL_PIXEL_FORMAT_BGRA_8888:
-    case HAL_PIXEL_FORMAT_BGRX_8888:
-    case HAL_PIXEL_FORMAT_RGB_565:
-        return true;
-    default:
-        return false;
-    }
+    return (format_class(handle->iFormat) & FMT_RGB) != 0;
 }
-static uint32_t get_format_bpp(uint32_t format)
+
+static inline uint32_t get_format_bpp(uint32_t format)
 {
-    switch(format) {
-    case HAL_PIXEL_FORMAT_BGRA_8888:
-    case HAL_PIXEL_FORMAT_BGRX_8888:
-    case HAL_PIXEL_FORMAT_RGBX_8888:
-    case HAL_PIXEL_FORMAT_RGBA_8888:
-        return 32;
-    case HAL_PIXEL_FORMAT_RGB_565:
-        return 16;
-    case HAL_PIXEL_FORMAT_TI_NV12:
-    case HAL_PIXEL_FORMAT_TI_NV12_1D:
-        return 8;
-    default:
-        return 0;
-    }
+    return FMT_BPP(format_class(format));
 }
 
-static bool is_BGR_format(uint32_t format)
+static inline bool is_BGR_format(uint32_t format)
 {
-    switch (format) {
-    case HAL_PIXEL_FORMAT_RGBX_8888:
-    case HAL_PIXEL_FORMAT_RGBA_8888:
-        return true;
-    default:
-        return false;
-    }
+    return (format_class(format) & FMT_BGR) != 0;
 }
 
-static bool is_BGR(IMG_native_handle_t *handle)
+static inline bool is_BGR(IMG_native_handle_t *handle)
 {
     return is_BGR_format(handle->iFormat);
 }
 
-static bool is_NV12(IMG_native_handle_t *handle)
+static inline bool is_NV12(IMG_native_handle_t *handle)
 {
-    switch(handle->iFormat)
-    {
-    case HAL_PIXEL_FORMAT_TI_NV12:
-    case HAL_PIXEL_FORMAT_TI_NV12_1D:
-        return true;
-    default:
-        return false;
-    }
+    return (format_class(handle->iFormat) & FMT_NV12) != 0;
 }
 
 static bool is_upscaled_NV12(omap_hwc_device_t *hwc_dev, hwc_layer_1_t *layer)
@@ -388,10 +441,14 @@ static bool dockable(hwc_layer_1_t *layer)
 
 static uint32_t mem1d(IMG_native_handle_t *handle)
 {
-    if (handle == NULL || is_NV12(handle))
+    if (handle == NULL)
         return 0;
 
-    int bpp = handle->iFormat == HAL_PIXEL_FORMAT_RGB_565 ? 2 : 4;
+    uint32_t c = format_class(handle->iFormat);
+    if (c & FMT_NV12)
+        return 0;
+
+    int bpp = FMT_BPP(c) == 16 ? 2 : 4;
     int stride = ALIGN(handle->iWidth, HW_ALIGN) * bpp;
     return stride * handle->iHeight;
 }
@@ -526,6 +583,24 @@ static inline int m_round(float x)
     return (int) (x < 0 ? x - 0.5 : x + 0.5);
 }
 
+/* matrices are applied per layer in 16.16 fixed point */
+#define M_FIXED_SHIFT 16
+
+static void m_to_fixed(float m[2][3], int32_t mq[2][3])
+{
+    int i, j;
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 3; j++)
+            mq[i][j] = m_round(m[i][j] * (1 << M_FIXED_SHIFT));
+}
+
+static inline int mq_round(int64_t x)
+{
+    /* round half away from zero like m_round */
+    int64_t half = 1 << (M_FIXED_SHIFT - 1);
+    return (int) (x < 0 ? -((-x + half) >> M_FIXED_SHIFT) : (x + half) >> M_FIXED_SHIFT);
+}
+
 /*
  * assuming xpy (xratio:yratio) original pixel ratio, calculate the adjusted width
  * and height for a screen of xres/yres and physical size of width/height.
@@ -564,6 +639,16 @@ static void set_ext_matrix(omap_hwc_ext_t *ext, struct hwc_rect region)
     int orig_h = HEIGHT(region);
     float xpy = ext->lcd_xpy;
 
+    /* docking sets this up every frame, only recompute on a change */
+    if (ext->m_key.valid &&
+        !memcmp(&ext->m_key.region, &region, sizeof(region)) &&
+        ext->m_key.transform.rotation == ext->current.rotation &&
+        ext->m_key.transform.hflip == ext->current.hflip &&
+        ext->m_key.xres == ext->xres && ext->m_key.yres == ext->yres &&
+        ext->m_key.width == ext->width && ext->m_key.height == ext->height &&
+        ext->m_key.xpy == ext->lcd_xpy)
+        return;
+
     /* reorientation matrix is:
        m = (center-from-target-center) * (scale-to-target) * (mirror) * (rotate) * (center-to-original-center) */
 
@@ -586,6 +671,16 @@ static void set_ext_matrix(omap_hwc_ext_t *ext, struct hwc_rect region)
 
     m_scale(ext->m, orig_w, adj_xres, orig_h, adj_yres);
     m_translate(ext->m, ext->xres >> 1, ext->yres >> 1);
+    m_to_fixed(ext->m, ext->mq);
+
+    ext->m_key.valid = true;
+    ext->m_key.region = region;
+    ext->m_key.transform = ext->current;
+    ext->m_key.xres = ext->xres;
+    ext->m_key.yres = ext->yres;
+    ext->m_key.width = ext->width;
+    ext->m_key.height = ext->height;
+    ext->m_key.xpy = ext->lcd_xpy;
 }
 
 static int
@@ -661,19 +756,19 @@ crop_to_rect(struct dss2_ovl_cfg *cfg, struct hwc_rect vis_rect)
     return 0;
 }
 
-static void apply_transform(float transform[2][3],struct dss2_ovl_cfg *oc)
+static void apply_transform(int32_t transform[2][3],struct dss2_ovl_cfg *oc)
 {
-    float x, y, w, h;
+    int64_t x, y, w, h;
 
     /* display position */
-    x = transform[0][0] * oc->win.x + transform[0][1] * oc->win.y + transform[0][2];
-    y = transform[1][0] * oc->win.x + transform[1][1] * oc->win.y + transform[1][2];
-    w = transform[0][0] * oc->win.w + transform[0][1] * oc->win.h;
-    h = transform[1][0] * oc->win.w + transform[1][1] * oc->win.h;
-    oc->win.x = m_round(w > 0 ? x : x + w);
-    oc->win.y = m_round(h > 0 ? y : y + h);
-    oc->win.w = m_round(w > 0 ? w : -w);
-    oc->win.h = m_round(h > 0 ? h : -h);
+    x = (int64_t) transform[0][0] * oc->win.x + (int64_t) transform[0][1] * oc->win.y + transform[0][2];
+    y = (int64_t) transform[1][0] * oc->win.x + (int64_t) transform[1][1] * oc->win.y + transform[1][2];
+    w = (int64_t) transform[0][0] * oc->win.w + (int64_t) transform[0][1] * oc->win.h;
+    h = (int64_t) transform[1][0] * oc->win.w + (int64_t) transform[1][1] * oc->win.h;
+    oc->win.x = mq_round(w > 0 ? x : x + w);
+    oc->win.y = mq_round(h > 0 ? y : y + h);
+    oc->win.w = mq_round(w > 0 ? w : -w);
+    oc->win.h = mq_round(h > 0 ? h : -h);
 }
 
 static void adjust_ext_layer(omap_hwc_ext_t *ext, struct dss2_ovl_info *ovl)
@@ -687,7 +782,7 @@ static void adjust_ext_layer(omap_hwc_ext_t *ext, struct dss2_ovl_info *ovl)
         return;
     }
 
-    apply_transform(ext->m, oc);
+    apply_transform(ext->mq, oc);
 
     /* combining transformations: F^a*R^b*F^i*R^j = F^(a+b)*R^(j+b*(-1)^i), because F*R = R^(-1)*F */
     oc->rotation += (oc->mirror ? -1 : 1) * ext->current.rotation;
@@ -707,7 +802,7 @@ static void adjust_primary_display_layer(omap_hwc_device_t *hwc_dev, struct dss2
         return;
     }
 
-    apply_transform(hwc_dev->primary_m, oc);
+    apply_transform(hwc_dev->primary_mq, oc);
 
     /* combining transformations: F^a*R^b*F^i*R^j = F^(a+b)*R^(j+b*(-1)^i), because F*R = R^(-1)*F */
     oc->rotation += (oc->mirror ? -1 : 1) * hwc_dev->primary_rotation;
@@ -836,14 +931,93 @@ static uint32_t add_scaling_score(uint32_t score,
     return score;
 }
 
+static hdmi_mode_cache_t *find_hdmi_mode(omap_hwc_ext_t *ext, int dis_ix,
+                                         uint32_t xres, uint32_t yres, float xpy)
+{
+    uint32_t i;
+
+    /* without the EDID we can't tell whether it is still the same display */
+    if (!ext->edid_hash)
+        return NULL;
+
+    for (i = 0; i < HDMI_MODE_CACHE_SIZE; i++) {
+        hdmi_mode_cache_t *c = &ext->mode_cache[i];
+        if (c->valid && c->edid_hash == ext->edid_hash && c->dis_ix == dis_ix &&
+            c->req_xres == xres && c->req_yres == yres && c->req_xpy == xpy &&
+            c->mirror_mode == ext->mirror_mode &&
+            c->avoid_mode_change == ext->avoid_mode_change)
+            return c;
+    }
+    return NULL;
+}
+
+static void store_hdmi_mode(omap_hwc_ext_t *ext, int dis_ix, uint32_t xres, uint32_t yres,
+                            float xpy, uint32_t best, struct dsscomp_videomode *mode, bool on_tv)
+{
+    if (!ext->edid_hash)
+        return;
+
+    hdmi_mode_cache_t *c = &ext->mode_cache[ext->mode_cache_next];
+    ext->mode_cache_next = (ext->mode_cache_next + 1) % HDMI_MODE_CACHE_SIZE;
+
+    c->valid = true;
+    c->edid_hash = ext->edid_hash;
+    c->dis_ix = dis_ix;
+    c->req_xres = xres;
+    c->req_yres = yres;
+    c->req_xpy = xpy;
+    c->mirror_mode = ext->mirror_mode;
+    c->avoid_mode_change = ext->avoid_mode_change;
+    c->best = best;
+    c->mode = *mode;
+    c->width = ext->width;
+    c->height = ext->height;
+    c->xres = ext->xres;
+    c->yres = ext->yres;
+    c->on_tv = on_tv;
+}
+
+static void apply_hdmi_mode(omap_hwc_device_t *hwc_dev, int dis_ix, uint32_t best,
+                            struct dsscomp_videomode *mode)
+{
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
+    struct dsscomp_setup_display_data sdis = { .ix = dis_ix };
+    sdis.mode = *mode;
+    ALOGD("picking #%d", best);
+    /* only reconfigure on change */
+    if (ext->last_mode != ~best)
+        ioctl(hwc_dev->dsscomp_fd, DSSCIOC_SETUP_DISPLAY, &sdis);
+    ext->last_mode = ~best;
+    /* s/w vsync has to follow the TV when it is the primary display */
+    if (hwc_dev->use_sw_vsync && hwc_dev->on_tv)
+        set_sw_vsync_rate(mode->refresh);
+}
+
 static int set_best_hdmi_mode(omap_hwc_device_t *hwc_dev, uint32_t xres, uint32_t yres, float xpy)
 {
     int dis_ix = hwc_dev->on_tv ? 0 : 1;
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
+
+    /* reconnecting the same display with the same input needs no new search */
+    hdmi_mode_cache_t *c = find_hdmi_mode(ext, dis_ix, xres, yres, xpy);
+    if (c) {
+        ext->width = c->width;
+        ext->height = c->height;
+        ext->xres = c->xres;
+        ext->yres = c->yres;
+        apply_hdmi_mode(hwc_dev, dis_ix, c->best, &c->mode);
+        ext->last_xres_used = xres;
+        ext->last_yres_used = yres;
+        ext->last_xpy = xpy;
+        if (c->on_tv)
+            ext->on_tv = 1;
+        return 0;
+    }
+
     struct _qdis {
         struct dsscomp_display_info dis;
         struct dsscomp_videomode modedb[32];
     } d = { .dis = { .ix = dis_ix } };
-    omap_hwc_ext_t *ext = &hwc_dev->ext;
 
     d.dis.modedb_len = sizeof(d.modedb) / sizeof(*d.modedb);
     int ret = ioctl(hwc_dev->dsscomp_fd, DSSCIOC_QUERY_DISPLAY, &d);
@@ -922,13 +1096,9 @@ static int set_best_hdmi_mode(omap_hwc_device_t *hwc_dev, uint32_t xres, uint32_
         }
     }
     if (~best) {
-        struct dsscomp_setup_display_data sdis = { .ix = dis_ix };
-        sdis.mode = d.dis.modedb[best];
-        ALOGD("picking #%d", best);
-        /* only reconfigure on change */
-        if (ext->last_mode != ~best)
-            ioctl(hwc_dev->dsscomp_fd, DSSCIOC_SETUP_DISPLAY, &sdis);
-        ext->last_mode = ~best;
+        apply_hdmi_mode(hwc_dev, dis_ix, best, &d.dis.modedb[best]);
+        store_hdmi_mode(ext, dis_ix, xres, yres, xpy, best, &d.dis.modedb[best],
+                        d.dis.channel == OMAP_DSS_CHANNEL_DIGIT);
     } else {
         uint32_t ext_width = d.dis.width_in_mm;
         uint32_t ext_height = d.dis.height_in_mm;
@@ -974,18 +1144,21 @@ static void gather_layer_statistics(omap_hwc_device_t *hwc_dev, hwc_display_cont
         if (is_valid_layer(hwc_dev, layer, handle)) {
 #ifdef OMAP_ENHANCEMENT_S3D
             if (s3d_layout_type != eMono) {
-                /* For now we can only handle 1 S3D layer, skip any additional ones */
-                if (num->s3d > 0 || !hwc_dev->ext.dock.enabled || !hwc_dev->ext.s3d_capable) {
+                /* All S3D layers must share one layout, skip the ones that differ from the first */
+                if (!hwc_dev->ext.dock.enabled || !hwc_dev->ext.s3d_capable ||
+                    (num->s3d && (s3d_layout_type != hwc_dev->s3d_input_type ||
+                                  get_s3d_layout_order(layer) != hwc_dev->s3d_input_order))) {
                     layer->flags |= HWC_SKIP_LAYER;
                     continue;
-                } else if (num->s3d == 0) {
-                    /* For now, S3D layer is made a dockable layer to trigger docking logic. */
-                    if (!dockable(layer)) {
-                        num->dockable++;
-                    }
-                    num->s3d++;
+                }
+                /* For now, S3D layers are made dockable layers to trigger docking logic. */
+                if (!dockable(layer)) {
+                    num->dockable++;
+                }
+                if (num->s3d++ == 0) {
                     hwc_dev->s3d_input_type = s3d_layout_type;
                     hwc_dev->s3d_input_order = get_s3d_layout_order(layer);
+                    select_s3d_transport(hwc_dev);
                 }
             }
 #endif
@@ -1031,7 +1204,7 @@ static void decide_supported_cloning(omap_hwc_device_t *hwc_dev)
         /* reserve just a video pipeline for HDMI if docking */
         hwc_dev->ext_ovls = (num->dockable || ext->force_dock) ? 1 : 0;
 #ifdef OMAP_ENHANCEMENT_S3D
-        if (num->s3d && (hwc_dev->ext.s3d_type != hwc_dev->s3d_input_type)) {
+        if (num->s3d && s3d_needs_split(hwc_dev)) {
             /* S3D layers are dockable, and they need two overlays */
             hwc_dev->ext_ovls += 1;
         }
@@ -1081,6 +1254,22 @@ static void decide_supported_cloning(omap_hwc_device_t *hwc_dev)
         num->max_scaling_overlays = num->max_hw_overlays - nonscaling_ovls;
 }
 
+/*
+ * Falling back to SGX composition puts a full frame of GPU work right
+ * behind whatever the apps drew; raise the GPU floor before it arrives
+ * rather than waiting for its governor to notice.
+ */
+#define SGX_BOOST_PATH "/sys/devices/platform/omap/pvrsrvkm.0/sgxfreq/boost_pulse"
+#define SGX_BOOST_MS "100"
+
+static void boost_sgx(omap_hwc_device_t *hwc_dev)
+{
+    if (hwc_dev->sgx_boost_fd < 0)
+        return;
+    if (write(hwc_dev->sgx_boost_fd, SGX_BOOST_MS, strlen(SGX_BOOST_MS)) < 0)
+        ALOGW("failed to boost SGX (%d)", errno);
+}
+
 static bool can_dss_render_all(omap_hwc_device_t *hwc_dev)
 {
     omap_hwc_ext_t *ext = &hwc_dev->ext;
@@ -1127,11 +1316,234 @@ static inline bool can_dss_render_layer(omap_hwc_device_t *hwc_dev, hwc_layer_1_
            !(on_tv && is_BGR(handle));
 }
 
+/*
+ * Video mode: a fullscreen NV12 layer at the bottom of the stack always gets a
+ * scaling overlay, even while SGX composition is forced, so playback with UI
+ * on top (subtitles, controls) only composes the UI.  The UI stays in the FB,
+ * which the blitter redraws only where the regionizer finds damage.
+ */
+static hwc_layer_1_t *find_video_layer(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
+{
+    hwc_layer_1_t *layer;
+
+    if (!hwc_dev->video_mode || !list || !list->numHwLayers || hwc_dev->counts.NV12 != 1)
+        return NULL;
+
+    layer = &list->hwLayers[0];
+    if (!can_dss_render_layer(hwc_dev, layer) || !is_NV12((IMG_native_handle_t *)layer->handle))
+        return NULL;
+
+    /* letterboxed playback still fills the screen in one dimension */
+    if (WIDTH(layer->displayFrame) < (int)hwc_dev->fb_dev->base.width &&
+        HEIGHT(layer->displayFrame) < (int)hwc_dev->fb_dev->base.height)
+        return NULL;
+
+    return layer;
+}
+
+static inline bool is_video_layer(omap_hwc_device_t *hwc_dev, hwc_layer_1_t *layer)
+{
+    return hwc_dev->video_layer && layer == hwc_dev->video_layer;
+}
+
+static bool is_overlay_candidate(omap_hwc_device_t *hwc_dev, hwc_layer_1_t *layer)
+{
+    return can_dss_render_layer(hwc_dev, layer) &&
+           (!hwc_dev->force_sgx ||
+            /* render protected and dockable layers via DSS */
+            is_protected(layer) ||
+            is_upscaled_NV12(hwc_dev, layer) ||
+            is_video_layer(hwc_dev, layer) ||
+            (hwc_dev->ext.current.docking && hwc_dev->ext.current.enabled && dockable(layer)));
+}
+
+/*
+ * Composition cost model
+ *
+ * A layer on a DSS overlay costs the DSS fetch of its source crop.  The same
+ * layer composed by SGX costs that fetch as well, plus writing the covered
+ * framebuffer area and the DSS fetching it back.  SGX fill time grows with
+ * the same covered area, so it is used as the saving of moving a layer to DSS.
+ */
+static uint32_t dss_fetch_bytes(hwc_layer_1_t *layer, IMG_native_handle_t *handle)
+{
+    uint32_t w = WIDTH(layer->sourceCrop);
+    uint32_t h = HEIGHT(layer->sourceCrop);
+    /* NV12 carries a half-resolution chroma plane on top of the 8bpp luma */
+    uint32_t bpp = is_NV12(handle) ? 12 : get_format_bpp(handle->iFormat);
+
+    return w * h / 8 * bpp;
+}
+
+static uint32_t sgx_saved_bytes(omap_hwc_device_t *hwc_dev, hwc_layer_1_t *layer)
+{
+    int w = min(layer->displayFrame.right, (int)hwc_dev->fb_dev->base.width) -
+            max(layer->displayFrame.left, 0);
+    int h = min(layer->displayFrame.bottom, (int)hwc_dev->fb_dev->base.height) -
+            max(layer->displayFrame.top, 0);
+
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    /* protected content can never be composed by SGX */
+    if (is_protected(layer))
+        return ~0;
+
+    return 2 * (uint32_t) (w * h) / 8 * get_format_bpp(hwc_dev->fb_dev->base.format);
+}
+
+/*
+ * Pick the layers that go to DSS overlays when SGX composes the rest.  The
+ * layers saving the most DDR traffic win the available pipelines, as long as
+ * the total DSS fetch stays within the bandwidth budget and the 1D buffers
+ * fit in the TILER slot.  A blended layer cannot sit above the framebuffer,
+ * so such picks are dropped and the selection is redone without them.
+ */
+static void select_overlay_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
+{
+    counts_t *num = &hwc_dev->counts;
+    uint32_t saved[MAX_HWC_LAYERS];
+    uint32_t order[MAX_HWC_LAYERS];
+    uint32_t excluded = 0;
+    uint32_t i, j, n = 0;
+
+    hwc_dev->ovl_candidates = ~0;
+    if (!list || !hwc_dev->use_sgx || list->numHwLayers > MAX_HWC_LAYERS)
+        return;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+
+        if (!is_overlay_candidate(hwc_dev, layer))
+            continue;
+
+        /* the video layer keeps its overlay whatever the UI above it costs */
+        saved[i] = is_video_layer(hwc_dev, layer) ? ~0 : sgx_saved_bytes(hwc_dev, layer);
+        if (!saved[i])
+            continue;
+
+        /* insertion sort, most saving first; there are at most a few overlays */
+        for (j = n++; j > 0 && saved[order[j - 1]] < saved[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    for (;;) {
+        /* the framebuffer uses one pipeline and is always fetched */
+        uint32_t ovls = 1;
+        uint32_t bw = hwc_dev->fb_dev->base.width * hwc_dev->fb_dev->base.height / 8 *
+                      get_format_bpp(hwc_dev->fb_dev->base.format);
+        uint32_t mem = 0;
+        uint32_t selected = 0;
+        bool fb_below = false;
+        bool retry = false;
+
+        for (j = 0; j < n && ovls < num->max_hw_overlays; j++) {
+            hwc_layer_1_t *layer = &list->hwLayers[order[j]];
+            IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+            uint32_t fetch = dss_fetch_bytes(layer, handle);
+
+            if (excluded & (1u << order[j]))
+                continue;
+            if (hwc_dev->dss_bw_limit && bw + fetch > hwc_dev->dss_bw_limit &&
+                !is_protected(layer) && !is_video_layer(hwc_dev, layer))
+                continue;
+            if (mem + mem1d(handle) > limits.tiler1d_slot_size)
+                continue;
+
+            selected |= 1u << order[j];
+            bw += fetch;
+            mem += mem1d(handle);
+            ovls++;
+        }
+
+        /* validate z-order: no blended overlay above an SGX composed layer */
+        for (i = 0; i < list->numHwLayers; i++) {
+            hwc_layer_1_t *layer = &list->hwLayers[i];
+
+            if (!(selected & (1u << i)))
+                fb_below = true;
+            else if (fb_below && is_BLENDED(layer)) {
+                excluded |= 1u << i;
+                retry = true;
+            }
+        }
+
+        if (!retry) {
+            hwc_dev->ovl_candidates = selected;
+            return;
+        }
+    }
+}
+
 static inline int display_area(struct dss2_ovl_info *o)
 {
     return o->cfg.win.w * o->cfg.win.h;
 }
 
+static int free_tiler2d_buffers(omap_hwc_device_t *hwc_dev)
+{
+    int i;
+
+    for (i = 0 ; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
+        if (hwc_dev->ion_handles[i])
+            ion_free(hwc_dev->ion_fd, hwc_dev->ion_handles[i]);
+        hwc_dev->ion_handles[i] = NULL;
+    }
+    return 0;
+}
+
+static int allocate_tiler2d_buffers(omap_hwc_device_t *hwc_dev)
+{
+    int ret, i;
+    size_t stride;
+
+    if (hwc_dev->ion_fd < 0) {
+        ALOGE("No ion fd, hence can't allocate tiler2d buffers");
+        return -1;
+    }
+
+    for (i = 0; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
+        if (hwc_dev->ion_handles[i])
+            return 0;
+    }
+
+    /*
+     * Buffers are allocated on demand by the first composition cloning the
+     * FB, the handles are only published once all of them are available.
+     * They always hold a full (rotated) FB, so they are sized to the FB
+     * rather than to the HDMI mode.
+     */
+    struct ion_handle *handles[NUM_EXT_DISPLAY_BACK_BUFFERS] = { NULL };
+    ret = ion_alloc_tiler_batch(hwc_dev->ion_fd, hwc_dev->fb_dev->base.width, hwc_dev->fb_dev->base.height,
+                                TILER_PIXEL_FMT_32BIT, 0, handles, &stride, NUM_EXT_DISPLAY_BACK_BUFFERS);
+    if (ret)
+        return -1;
+
+    for (i = 0 ; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++)
+        ALOGI("ion handle[%d][%p]", i, handles[i]);
+
+    memcpy(hwc_dev->ion_handles, handles, sizeof(handles));
+    for (i = 0 ; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++)
+        hwc_dev->ion_last_used[i] = sync_id;
+    return 0;
+}
+
+/* Give the TILER2D carve-out back when mirroring stopped cloning the FB */
+static void release_idle_tiler2d_buffers(omap_hwc_device_t *hwc_dev)
+{
+    int i;
+
+    for (i = 0; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
+        if (!hwc_dev->ion_handles[i] ||
+            sync_id - hwc_dev->ion_last_used[i] < TILER2D_IDLE_FRAMES)
+            return;
+    }
+
+    ALOGI("releasing idle tiler2d buffers");
+    free_tiler2d_buffers(hwc_dev);
+}
+
 static int clone_layer(omap_hwc_device_t *hwc_dev, int ix) {
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
     omap_hwc_ext_t *ext = &hwc_dev->ext;
@@ -1156,9 +1568,17 @@ static int clone_layer(omap_hwc_device_t *hwc_dev, int ix) {
     * that of primary display, ion_handles would be NULL hence
     * the below logic doesn't execute.
     */
+    if (ix == 0 && hwc_dev->tiler2d_needed && hwc_dev->use_sgx &&
+        !hwc_dev->ion_handles[sync_id%2]) {
+        /* first use since hotplug or since they were released as idle,
+         * don't retry on every frame if ION is out of TILER space */
+        if (allocate_tiler2d_buffers(hwc_dev))
+            hwc_dev->tiler2d_needed = false;
+    }
     if (ix == 0 && hwc_dev->ion_handles[sync_id%2] && hwc_dev->use_sgx) {
         o->addressing = OMAP_DSS_BUFADDR_ION;
         o->ba = (int)hwc_dev->ion_handles[sync_id%2];
+        hwc_dev->ion_last_used[sync_id%2] = sync_id;
     } else {
         o->addressing = OMAP_DSS_BUFADDR_OVL_IX;
         o->ba = ix;
@@ -1223,7 +1643,8 @@ static void enable_s3d_hdmi(omap_hwc_device_t *hwc_dev, bool enable)
     char data;
     int fd;
 
-    if (hwc_dev->ext.s3d_enabled == enable) {
+    if (hwc_dev->ext.s3d_enabled == enable &&
+        (!enable || hwc_dev->ext.s3d_hdmi_type == hwc_dev->ext.s3d_type)) {
         return;
     }
 
@@ -1270,61 +1691,38 @@ static void enable_s3d_hdmi(omap_hwc_device_t *hwc_dev, bool enable)
     }
 
     hwc_dev->ext.s3d_enabled = enable;
+    hwc_dev->ext.s3d_hdmi_type = hwc_dev->ext.s3d_type;
+}
+
+static void crop_s3d_view(struct s3d_view *v, struct dss2_ovl_cfg *oc)
+{
+    oc->crop.w >>= v->crop_shift_x;
+    oc->crop.h >>= v->crop_shift_y;
+    if (v->crop_second) {
+        oc->crop.x += v->crop_shift_x ? oc->crop.w : 0;
+        oc->crop.y += v->crop_shift_y ? oc->crop.h : 0;
+    }
 }
 
 static void adjust_ext_s3d_layer(omap_hwc_device_t *hwc_dev,
                                  struct dss2_ovl_info *ovl, bool left_view)
 {
+    struct s3d_view *v = &hwc_dev->s3d_views.view[left_view ? 0 : 1];
     struct dss2_ovl_cfg *oc = &ovl->cfg;
-    float x, y, w, h;
-
-    switch (hwc_dev->s3d_input_type) {
-        case eSideBySide:
-            oc->crop.w = oc->crop.w/2;
-            if ((left_view && hwc_dev->s3d_input_order == eRightViewFirst) ||
-                (!left_view && hwc_dev->s3d_input_order == eLeftViewFirst)) {
-                oc->crop.x = oc->crop.x + oc->crop.w;
-            }
-            break;
-        case eTopBottom:
-            oc->crop.h = oc->crop.h/2;
-            if ((left_view && hwc_dev->s3d_input_order == eRightViewFirst) ||
-                (!left_view && hwc_dev->s3d_input_order == eLeftViewFirst)) {
-                oc->crop.y = oc->crop.y + oc->crop.h;
-            }
-            break;
-        default:
-            /* Should never fall here! */
-            ALOGE("Unsupported S3D layer type!");
-            break;
-    }
 
-    switch (hwc_dev->ext.s3d_type) {
-        case eSideBySide:
-            oc->win.w = oc->win.w/2;
-            if ((left_view && hwc_dev->ext.s3d_order == eRightViewFirst) ||
-                (!left_view && hwc_dev->ext.s3d_order == eLeftViewFirst)) {
-                oc->win.x = oc->win.x/2 + hwc_dev->ext.xres/2;
-            } else {
-                oc->win.x = oc->win.x/2;
-            }
-            break;
-        case eTopBottom:
-            oc->win.h = oc->win.h/2;
-            if ((left_view && hwc_dev->ext.s3d_order == eRightViewFirst) ||
-                (!left_view && hwc_dev->ext.s3d_order == eLeftViewFirst)) {
-                oc->win.y = oc->win.y/2 + hwc_dev->ext.yres/2;
-            } else {
-                oc->win.y = oc->win.y/2;
-            }
-            break;
-        default:
-            /* Currently unhandled!!! */
-            ALOGE("Unsupported S3D display type!");
-            break;
+    crop_s3d_view(v, oc);
+
+    oc->win.w >>= v->win_shift_x;
+    oc->win.x >>= v->win_shift_x;
+    oc->win.h >>= v->win_shift_y;
+    oc->win.y >>= v->win_shift_y;
+    if (v->win_second) {
+        oc->win.x += v->win_shift_x ? hwc_dev->ext.xres / 2 : 0;
+        oc->win.y += v->win_shift_y ? hwc_dev->ext.yres / 2 : 0;
     }
 }
 
+/* returns the number of overlays used on the external display, or a negative error */
 static int clone_s3d_external_layer(omap_hwc_device_t *hwc_dev, int ix_s3d)
 {
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
@@ -1338,6 +1736,10 @@ static int clone_s3d_external_layer(omap_hwc_device_t *hwc_dev, int ix_s3d)
         return r;
     }
 
+    /* the sink unpacks the layout itself */
+    if (!s3d_needs_split(hwc_dev))
+        return 1;
+
     r = clone_layer(hwc_dev, ix_s3d);
     if (r) {
         ALOGE("Failed to clone s3d layer (%d)", r);
@@ -1352,7 +1754,7 @@ static int clone_s3d_external_layer(omap_hwc_device_t *hwc_dev, int ix_s3d)
     adjust_ext_s3d_layer(hwc_dev, &dsscomp->ovls[dsscomp->num_ovls - 1], true);
     adjust_ext_s3d_layer(hwc_dev, &dsscomp->ovls[dsscomp->num_ovls - 2], false);
 
-    return 0;
+    return 2;
 }
 #endif
 static int setup_mirroring(omap_hwc_device_t *hwc_dev)
@@ -1369,6 +1771,35 @@ static int setup_mirroring(omap_hwc_device_t *hwc_dev)
     return 0;
 }
 
+/*
+ * Neither omaplfb's Post2 nor dsscomp take fences in this tree, buffer reuse
+ * is ordered by the PVR sync objects instead.  Should an acquire fence still
+ * come in, wait for it before posting so the DSS never scans out a buffer
+ * that is still being rendered.
+ */
+#define ACQUIRE_FENCE_TIMEOUT_MS 1000
+
+static void wait_acquire_fences(size_t numDisplays, hwc_display_contents_1_t** displays)
+{
+    unsigned int i, j;
+    for (i = 0; i < numDisplays; i++) {
+        hwc_display_contents_1_t* list = displays[i];
+
+        for (j = 0; list && j < list->numHwLayers; j++) {
+            hwc_layer_1_t* layer = &list->hwLayers[j];
+            struct pollfd fd = { .fd = layer->acquireFenceFd, .events = POLLIN };
+
+            if (layer->acquireFenceFd < 0)
+                continue;
+
+            if (poll(&fd, 1, ACQUIRE_FENCE_TIMEOUT_MS) <= 0)
+                ALOGW("acquireFenceFd[%u][%u] %d not signaled", i, j, layer->acquireFenceFd);
+            close(layer->acquireFenceFd);
+            layer->acquireFenceFd = -1;
+        }
+    }
+}
+
 /*
  * We're using "implicit" synchronization, so make sure we aren't passing any
  * sync object descriptors around.
@@ -1379,6 +1810,8 @@ static void check_sync_fds(size_t numDisplays, hwc_display_contents_1_t** displa
     unsigned int i, j;
     for (i = 0; i < numDisplays; i++) {
         hwc_display_contents_1_t* list = displays[i];
+        if (!list)
+            continue;
         if (list->retireFenceFd >= 0) {
             ALOGW("retireFenceFd[%u] was %d", i, list->retireFenceFd);
             list->retireFenceFd = -1;
@@ -1409,6 +1842,10 @@ static void blit_reset(omap_hwc_device_t *hwc_dev)
 
 static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list, int bufoff)
 {
+    uint32_t id = hwc_dev->comp_data.dsscomp_data.sync_id;
+
+    hwc_trace(HWC_TRACE_BLIT_BEGIN, id, 0);
+
     if (!list || hwc_dev->ext.mirror.enabled)
         goto err_out;
 
@@ -1460,6 +1897,8 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
         }
     };
 
+    hwc_record_frame(list, grgz_ext_layer_list.layers, &gscrngeom);
+
     /*
      * This means if all the layers marked for the FRAMEBUFFER cannot be
      * blitted, do not blit, for e.g. SKIP layers
@@ -1474,10 +1913,13 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
         }
     }
 
+    /* generate the blits in place, right behind the dsscomp data given to Post2 */
     rgz_out_params_t out = {
         .op = rgz_out_op,
         .data = {
             .bvc = {
+                .cmdp = hwc_dev->comp_data.blit_data.rgz_blts,
+                .cmdlen = RGZ_MAX_BLITS,
                 .dstgeom = &gscrngeom,
                 .noblend = 0,
             }
@@ -1500,6 +1942,8 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
 
     hwc_dev->blit_flags |= HWC_BLT_FLAG_USE_FB;
     hwc_dev->blit_num = out.data.bvc.out_blits;
+    hwc_dev->blit_saved_pixels += out.data.bvc.out_saved_pixels;
+    ALOGI_IF(debugblt, "partial update skipped %u pixels", out.data.bvc.out_saved_pixels);
     hwc_dev->post2_blit_buffers = out.data.bvc.out_nhndls;
     for (i = 0; i < hwc_dev->post2_blit_buffers; i++) {
         //ALOGI("blit buffers[%d] = %p", bufoff, out.data.bvc.out_hndls[i]);
@@ -1507,7 +1951,8 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
     }
 
     struct rgz_blt_entry *res_blit_ops = (struct rgz_blt_entry *) out.data.bvc.cmdp;
-    memcpy(hwc_dev->comp_data.blit_data.rgz_blts, res_blit_ops, sizeof(*res_blit_ops) * out.data.bvc.cmdlen);
+    if (res_blit_ops != hwc_dev->comp_data.blit_data.rgz_blts)
+        memcpy(hwc_dev->comp_data.blit_data.rgz_blts, res_blit_ops, sizeof(*res_blit_ops) * out.data.bvc.cmdlen);
     ALOGI_IF(debugblt, "blt struct sz %d", sizeof(*res_blit_ops) * out.data.bvc.cmdlen);
     ALOGE_IF(hwc_dev->blit_num != out.data.bvc.cmdlen,"blit_num != out.data.bvc.cmdlen, %d != %d", hwc_dev->blit_num, out.data.bvc.cmdlen);
 
@@ -1520,10 +1965,12 @@ static bool blit_layers(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *li
         }
         list->hwLayers[i].hints &= ~HWC_HINT_CLEAR_FB;
     }
+    hwc_trace(HWC_TRACE_BLIT_END, id, 0);
     return true;
 
 err_out:
     rgz_release(&grgz);
+    hwc_trace(HWC_TRACE_BLIT_END, id, 0);
     return false;
 }
 
@@ -1541,45 +1988,154 @@ void debug_post2(omap_hwc_device_t *hwc_dev, int nbufs)
     }
 }
 
-static int free_tiler2d_buffers(omap_hwc_device_t *hwc_dev)
+static void get_layer_geom(hwc_layer_1_t *layer, layer_geom_t *geom)
 {
-    int i;
+    IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
 
-    for (i = 0 ; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
-        ion_free(hwc_dev->ion_fd, hwc_dev->ion_handles[i]);
-        hwc_dev->ion_handles[i] = NULL;
+    /* clear padding as well, entries are compared with memcmp */
+    memset(geom, 0, sizeof(*geom));
+    geom->flags = layer->flags;
+    geom->transform = layer->transform;
+    geom->blending = layer->blending;
+    geom->sourceCrop = layer->sourceCrop;
+    geom->displayFrame = layer->displayFrame;
+    if (handle) {
+        geom->has_buffer = true;
+        geom->format = handle->iFormat;
+        geom->width = handle->iWidth;
+        geom->height = handle->iHeight;
+        geom->usage = handle->usage;
     }
-    return 0;
 }
 
-static int allocate_tiler2d_buffers(omap_hwc_device_t *hwc_dev)
+/*
+ * The composition cache only covers the primary display.  Cloning may change
+ * the HDMI mode and alternates the TILER2D back buffers every frame, and the
+ * regionizer keeps its own dirty state, so those compositions are recomputed.
+ */
+static bool comp_cache_usable(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
 {
-    int ret, i;
-    size_t stride;
+    omap_hwc_ext_t *ext = &hwc_dev->ext;
 
-    if (hwc_dev->ion_fd < 0) {
-        ALOGE("No ion fd, hence can't allocate tiler2d buffers");
-        return -1;
+    return list && list->numHwLayers <= MAX_HWC_LAYERS &&
+           !ext->dock.enabled && !ext->mirror.enabled && !ext->current.enabled &&
+           !hwc_dev->last_ext_ovls &&
+           !(hwc_dev->on_tv && ext->last_mode == 0);
+}
+
+static bool comp_cache_lookup(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
+{
+    comp_cache_t *cache = &hwc_dev->comp_cache;
+    uint32_t i;
+
+    if (!comp_cache_usable(hwc_dev, list))
+        return false;
+
+    if (!cache->valid ||
+        cache->num_layers != list->numHwLayers ||
+        cache->force_sgx != hwc_dev->force_sgx)
+        goto miss;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        layer_geom_t geom;
+        get_layer_geom(&list->hwLayers[i], &geom);
+        if (memcmp(&geom, &cache->geom[i], sizeof(geom)))
+            goto miss;
     }
 
-    for (i = 0; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
-        if (hwc_dev->ion_handles[i])
-            return 0;
+    /* a probe frame is composed again, through the other path */
+    if (cache->policy_choice != HWC_POLICY_NONE &&
+        !hwc_policy_reuse(cache->policy_sig, cache->policy_choice)) {
+        cache->valid = false;
+        goto miss;
     }
+    cache->hits++;
+    return true;
 
-    for (i = 0 ; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
-        ret = ion_alloc_tiler(hwc_dev->ion_fd, hwc_dev->fb_dev->base.width, hwc_dev->fb_dev->base.height,
-                                            TILER_PIXEL_FMT_32BIT, 0, &hwc_dev->ion_handles[i], &stride);
-        if (ret)
-            goto handle_error;
+miss:
+    cache->misses++;
+    return false;
+}
+
+/* reuse the previous composition, only the buffer handles may have changed */
+static void comp_cache_apply(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
+{
+    comp_cache_t *cache = &hwc_dev->comp_cache;
+    struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
+    uint32_t i, id = dsscomp->sync_id;
+
+    memcpy(dsscomp, &cache->dsscomp, sizeof(*dsscomp));
+    dsscomp->sync_id = id;
+
+    hwc_dev->counts = cache->counts;
+    hwc_dev->use_sgx = cache->use_sgx;
+    hwc_dev->swap_rb = cache->swap_rb;
+    hwc_dev->post2_layers = cache->post2_layers;
+    hwc_dev->policy_sig = cache->policy_sig;
+    hwc_dev->policy_choice = cache->policy_choice;
+    hwc_dev->policy_path = cache->policy_path;
+    hwc_dev->ext_ovls = hwc_dev->ext_ovls_wanted = 0;
+    blit_reset(hwc_dev);
+
+    if (hwc_dev->use_sgx)
+        hwc_dev->buffers[0] = NULL;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
 
-        ALOGI("ion handle[%d][%p]", i, hwc_dev->ion_handles[i]);
+        layer->compositionType = cache->composition_type[i];
+        layer->hints = cache->hints[i];
+        if (cache->buf_ix[i] >= 0)
+            hwc_dev->buffers[cache->buf_ix[i]] = layer->handle;
     }
-    return 0;
+}
 
-handle_error:
-    free_tiler2d_buffers(hwc_dev);
-    return -1;
+static void comp_cache_store(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list)
+{
+    comp_cache_t *cache = &hwc_dev->comp_cache;
+    uint32_t i;
+
+    cache->valid = comp_cache_usable(hwc_dev, list) && !hwc_dev->policy_probe &&
+                   !hwc_dev->blit_num && !hwc_dev->post2_blit_buffers;
+    if (!cache->valid)
+        return;
+
+    cache->num_layers = list->numHwLayers;
+    cache->force_sgx = hwc_dev->force_sgx;
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+
+        get_layer_geom(layer, &cache->geom[i]);
+        cache->composition_type[i] = layer->compositionType;
+        cache->hints[i] = layer->hints;
+    }
+
+    memcpy(&cache->dsscomp, &hwc_dev->comp_data.dsscomp_data, sizeof(cache->dsscomp));
+    cache->counts = hwc_dev->counts;
+    cache->use_sgx = hwc_dev->use_sgx;
+    cache->swap_rb = hwc_dev->swap_rb;
+    cache->post2_layers = hwc_dev->post2_layers;
+    cache->policy_sig = hwc_dev->policy_sig;
+    cache->policy_choice = hwc_dev->policy_choice;
+    cache->policy_path = hwc_dev->policy_path;
+}
+
+/* FNV-1a over the layer geometries, which stay the same while only buffers change */
+static uint32_t get_list_signature(hwc_display_contents_1_t *list)
+{
+    uint32_t sig = 2166136261u;
+    uint32_t i, j;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        layer_geom_t geom;
+        const uint8_t *p = (const uint8_t *) &geom;
+
+        get_layer_geom(&list->hwLayers[i], &geom);
+        for (j = 0; j < sizeof(geom); j++)
+            sig = (sig ^ p[j]) * 16777619u;
+        sig = (sig ^ list->hwLayers[i].compositionType) * 16777619u;
+    }
+    return sig;
 }
 
 static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
@@ -1595,11 +2151,34 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
     counts_t *num = &hwc_dev->counts;
     uint32_t i, ix;
 
+    nsecs_t prepare_start = systemTime(SYSTEM_TIME_MONOTONIC);
+
     pthread_mutex_lock(&hwc_dev->lock);
     memset(dsscomp, 0x0, sizeof(*dsscomp));
     dsscomp->sync_id = sync_id++;
+    hwc_dev->prepare_start = prepare_start;
+    hwc_dev->policy_path = HWC_POLICY_NONE;
+    hwc_dev->policy_choice = HWC_POLICY_NONE;
+    hwc_dev->policy_probe = false;
+    hwc_trace(HWC_TRACE_PREPARE_BEGIN, dsscomp->sync_id, 0);
+
+    release_idle_tiler2d_buffers(hwc_dev);
+
+    hwc_dev->comp_cache_hit = comp_cache_lookup(hwc_dev, list);
+    if (hwc_dev->comp_cache_hit) {
+        comp_cache_apply(hwc_dev, list);
+        hwc_dev->prepare_ns = systemTime(SYSTEM_TIME_MONOTONIC) - prepare_start;
+        hwc_trace_layers(list);
+        hwc_trace(HWC_TRACE_PREPARE_END, dsscomp->sync_id, 0);
+        pthread_mutex_unlock(&hwc_dev->lock);
+        return 0;
+    }
+
+    for (i = 0; i < MAX_HWC_LAYERS; i++)
+        hwc_dev->comp_cache.buf_ix[i] = -1;
 
     gather_layer_statistics(hwc_dev, list);
+    hwc_dev->video_layer = find_video_layer(hwc_dev, list);
 
     decide_supported_cloning(hwc_dev);
 
@@ -1610,6 +2189,8 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
         hwc_dev->swap_rb = num->BGR != 0;
     } else {
         /* Use SGX for composition plus first 3 layers that are DSS renderable */
+        if (!hwc_dev->use_sgx)
+            boost_sgx(hwc_dev);
         hwc_dev->use_sgx = 1;
         hwc_dev->swap_rb = is_BGR_format(hwc_dev->fb_dev->base.format);
     }
@@ -1620,6 +2201,7 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
     int ix_docking = -1;
 #ifdef OMAP_ENHANCEMENT_S3D
     int ix_s3d = -1;
+    uint32_t s3d_ovls = 0;
 #endif
     bool scaled_gfx = false;
     bool blit_all = false;
@@ -1646,6 +2228,10 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
      */
     dsscomp->num_ovls = needs_fb ? 1 /*VID1*/ : 0 /*GFX*/;
 
+    /* choose which layers get the overlays left next to the framebuffer */
+    if (!blit_all)
+        select_overlay_layers(hwc_dev, list);
+
     /* set up if DSS layers */
     uint32_t mem_used = 0;
     for (i = 0; list && i < list->numHwLayers && !blit_all; i++) {
@@ -1653,12 +2239,8 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
         IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
 
         if (dsscomp->num_ovls < num->max_hw_overlays &&
-            can_dss_render_layer(hwc_dev, layer) &&
-            (!hwc_dev->force_sgx ||
-             /* render protected and dockable layers via DSS */
-             is_protected(layer) ||
-             is_upscaled_NV12(hwc_dev, layer) ||
-             (hwc_dev->ext.current.docking && hwc_dev->ext.current.enabled && dockable(layer))) &&
+            (i >= MAX_HWC_LAYERS || (hwc_dev->ovl_candidates & (1u << i))) &&
+            is_overlay_candidate(hwc_dev, layer) &&
             mem_used + mem1d(handle) <= limits.tiler1d_slot_size &&
             /* can't have a transparent overlay in the middle of the framebuffer stack */
             !(is_BLENDED(layer) && fb_z >= 0)) {
@@ -1679,6 +2261,8 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
 
             hwc_dev->buffers[dsscomp->num_ovls] = layer->handle;
             //ALOGI("dss buffers[%d] = %p", dsscomp->num_ovls, hwc_dev->buffers[dsscomp->num_ovls]);
+            if (i < MAX_HWC_LAYERS)
+                hwc_dev->comp_cache.buf_ix[i] = dsscomp->num_ovls;
 
             setup_layer(hwc_dev,
                         &dsscomp->ovls[dsscomp->num_ovls],
@@ -1708,9 +2292,12 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
                  display_area(&dsscomp->ovls[dsscomp->num_ovls]) > display_area(&dsscomp->ovls[ix_docking])))
                 ix_docking = dsscomp->num_ovls;
 #ifdef OMAP_ENHANCEMENT_S3D
-            /* remember the ix for s3d layer */
+            /* remember the S3D layers, the largest one is docked */
             if (get_s3d_layout_type(layer) != eMono) {
-                ix_s3d = dsscomp->num_ovls;
+                s3d_ovls |= 1u << dsscomp->num_ovls;
+                if (ix_s3d < 0 ||
+                    display_area(&dsscomp->ovls[dsscomp->num_ovls]) > display_area(&dsscomp->ovls[ix_s3d]))
+                    ix_s3d = dsscomp->num_ovls;
             }
 #endif
             dsscomp->num_ovls++;
@@ -1739,9 +2326,13 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
          * we need to reset its state.
          */
         if (hwc_dev->use_sgx) {
-            if (blit_layers(hwc_dev, list, dsscomp->num_ovls == 1 ? 0 : dsscomp->num_ovls)) {
+            hwc_dev->policy_sig = get_list_signature(list);
+            hwc_dev->policy_choice = hwc_policy_choose(hwc_dev->policy_sig, &hwc_dev->policy_probe);
+            if (hwc_dev->policy_choice != HWC_POLICY_BLIT)
+                rgz_release(&grgz);
+            else if (blit_layers(hwc_dev, list, dsscomp->num_ovls == 1 ? 0 : dsscomp->num_ovls))
                 hwc_dev->use_sgx = 0;
-            }
+            hwc_dev->policy_path = hwc_dev->use_sgx ? HWC_POLICY_SGX : HWC_POLICY_BLIT;
         } else
             rgz_release(&grgz);
     }
@@ -1782,21 +2373,15 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
               (hwc_dev->ext_ovls_wanted && hwc_dev->ext_ovls >= hwc_dev->ext_ovls_wanted))) {
 #ifdef OMAP_ENHANCEMENT_S3D
         if (ext->current.docking && ix_s3d >= 0) {
-            if (clone_s3d_external_layer(hwc_dev, ix_s3d) == 0) {
-                dsscomp->ovls[dsscomp->num_ovls - 2].cfg.zorder = z++;
-                dsscomp->ovls[dsscomp->num_ovls - 1].cfg.zorder = z++;
-                /* For now, show only the left view of an S3D layer
+            int n = clone_s3d_external_layer(hwc_dev, ix_s3d);
+            if (n > 0) {
+                for (ix = dsscomp->num_ovls - n; ix < dsscomp->num_ovls; ix++)
+                    dsscomp->ovls[ix].cfg.zorder = z++;
+                /* For now, show only the left view of the S3D layers
                  * in the local display while we have hdmi attached */
-                switch (hwc_dev->s3d_input_type) {
-                    case eSideBySide:
-                        dsscomp->ovls[ix_s3d].cfg.crop.w = dsscomp->ovls[ix_s3d].cfg.crop.w/2;
-                        break;
-                    case eTopBottom:
-                       dsscomp->ovls[ix_s3d].cfg.crop.h = dsscomp->ovls[ix_s3d].cfg.crop.h/2;
-                        break;
-                    default:
-                        ALOGE("Unsupported S3D input type");
-                        break;
+                for (ix = 0; ix < hwc_dev->post2_layers; ix++) {
+                    if (s3d_ovls & (1u << ix))
+                        crop_s3d_view(&hwc_dev->s3d_views.view[0], &dsscomp->ovls[ix].cfg);
                 }
             }
         } else if (ext->current.docking && ix_docking >= 0) {
@@ -1805,7 +2390,14 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
 #endif
             if (clone_external_layer(hwc_dev, ix_docking) == 0)
                 dsscomp->ovls[dsscomp->num_ovls - 1].cfg.zorder = z++;
-        } else if (ext->current.docking && ix_docking < 0 && ext->force_dock) {
+        } else if (ext->current.docking && ix_docking < 0 && ext->force_dock &&
+                   get_dock_image()) {
+            /*
+             * The image was decoded into fb memory once at hotplug, and the
+             * HDMI mode is only re-picked when its size changes, so this
+             * costs no CPU or GC320 work per frame: DSS fetches and scales
+             * it in place.
+             */
             ix_docking = dsscomp->num_ovls;
             struct dss2_ovl_info *oi = &dsscomp->ovls[ix_docking];
             image_info_t *dock_image = get_dock_image();
@@ -1849,6 +2441,7 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
         ALOGE("**** used %d z-layers for %d overlays\n", z, dsscomp->num_ovls);
 
     /* verify all z-orders and overlay indices are distinct */
+    uint32_t mgrs = 0;
     for (i = z = ix = 0; i < dsscomp->num_ovls; i++) {
         struct dss2_ovl_cfg *c = &dsscomp->ovls[i].cfg;
 
@@ -1858,6 +2451,7 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
             ALOGE("**** used ovl index #%d multiple times", c->ix);
         z |= 1 << c->zorder;
         ix |= 1 << c->ix;
+        mgrs |= 1 << c->mgr_ix;
     }
     dsscomp->mode = DSSCOMP_SETUP_DISPLAY;
     dsscomp->mgrs[0].ix = 0;
@@ -1865,7 +2459,14 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
     dsscomp->mgrs[0].swap_rb = hwc_dev->swap_rb;
     dsscomp->num_mgrs = 1;
 
-    if (ext->current.enabled || hwc_dev->last_ext_ovls) {
+    /*
+     * Both displays are configured by this one composition: the external
+     * manager rides along with the LCD one, so a mirrored frame is a single
+     * Post2 with a single sync object and both outputs switch to it together.
+     * The external manager is also sent for the frame after its last overlay
+     * went away so that those get disabled.
+     */
+    if (ext->current.enabled || hwc_dev->last_ext_ovls || (mgrs & (1 << 1))) {
         dsscomp->mgrs[1] = dsscomp->mgrs[0];
         dsscomp->mgrs[1].ix = 1;
         dsscomp->num_mgrs++;
@@ -1894,6 +2495,11 @@ static int hwc_prepare(struct hwc_composer_device_1 *dev, size_t numDisplays,
              hwc_dev->ext_ovls, num->max_hw_overlays, hwc_dev->last_ext_ovls, hwc_dev->last_int_ovls);
     }
 
+    comp_cache_store(hwc_dev, list);
+    hwc_dev->prepare_ns = systemTime(SYSTEM_TIME_MONOTONIC) - prepare_start;
+    hwc_trace_layers(list);
+    hwc_trace(HWC_TRACE_PREPARE_END, dsscomp->sync_id, 0);
+
     pthread_mutex_unlock(&hwc_dev->lock);
     return 0;
 }
@@ -1926,6 +2532,93 @@ static void reset_screen(omap_hwc_device_t *hwc_dev)
     }
 }
 
+/*
+ * Panel self-refresh style idle handling: once the same all-overlay
+ * composition with the same buffers has been seen idle_skip_frames times in
+ * a row, stop posting it, the DSS keeps scanning out what it already has.
+ * Compositions using SGX are always posted as SurfaceFlinger has rendered
+ * into the FB for them.
+ */
+static bool skip_idle_post(omap_hwc_device_t *hwc_dev, uint32_t nbufs)
+{
+    bool same = hwc_dev->comp_cache_hit && !hwc_dev->use_sgx && !hwc_dev->blit_num &&
+                nbufs == hwc_dev->last_posted_bufs &&
+                !memcmp(hwc_dev->last_posted, hwc_dev->buffers, nbufs * sizeof(buffer_handle_t));
+
+    if (!same) {
+        hwc_dev->same_frames = 0;
+        hwc_dev->last_posted_bufs = min(nbufs, MAX_HWC_LAYERS);
+        memcpy(hwc_dev->last_posted, hwc_dev->buffers,
+               hwc_dev->last_posted_bufs * sizeof(buffer_handle_t));
+        return false;
+    }
+
+    if (!hwc_dev->idle_skip_frames || ++hwc_dev->same_frames < hwc_dev->idle_skip_frames)
+        return false;
+
+    hwc_dev->idle_skipped++;
+    return true;
+}
+
+static uint32_t dss_color_bpp(enum omap_color_mode mode)
+{
+    switch (mode) {
+    case OMAP_DSS_COLOR_NV12:
+        return 12;
+    case OMAP_DSS_COLOR_RGB16:
+        return 16;
+    default:
+        return 32;
+    }
+}
+
+/*
+ * Frame statistics for capacity planning.  The DDR estimate counts the DSS
+ * fetch of every posted overlay, and for a composed FB the reads of the
+ * composed layers plus the FB write.  Partial blits are counted in full.
+ */
+static void get_frame_stats(omap_hwc_device_t *hwc_dev, hwc_display_contents_1_t *list,
+                            struct hwc_frame_stats *frame)
+{
+    struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
+    bool composed_fb = hwc_dev->use_sgx || hwc_dev->blit_num || hwc_dev->post2_blit_buffers;
+    uint32_t i;
+
+    memset(frame, 0, sizeof(*frame));
+    if (hwc_dev->use_sgx)
+        frame->comp = hwc_dev->post2_layers > 1 ? HWC_STATS_MIXED : HWC_STATS_ALL_SGX;
+    else
+        frame->comp = composed_fb ? HWC_STATS_BLIT : HWC_STATS_ALL_DSS;
+    frame->ovls = dsscomp->num_ovls;
+    frame->blits = hwc_dev->blit_num;
+    frame->prepare_ns = hwc_dev->prepare_ns;
+
+    for (i = 0; i < dsscomp->num_ovls; i++) {
+        struct dss2_ovl_cfg *oc = &dsscomp->ovls[i].cfg;
+        bool swap = oc->rotation & 1;
+
+        if (oc->crop.w != (swap ? oc->win.h : oc->win.w) ||
+            oc->crop.h != (swap ? oc->win.w : oc->win.h))
+            frame->scaled_ovls++;
+        frame->ddr_bytes += (uint64_t) oc->crop.w * oc->crop.h * dss_color_bpp(oc->color_mode) / 8;
+    }
+
+    if (!composed_fb)
+        return;
+
+    frame->ddr_bytes += (uint64_t) hwc_dev->fb_dev->base.width * hwc_dev->fb_dev->base.height *
+                        get_format_bpp(hwc_dev->fb_dev->base.format) / 8;
+    for (i = 0; list && i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+
+        /* blitted layers are marked as overlays, only real overlays keep the triple buffer hint */
+        if (!layer->handle || (layer->flags & HWC_SKIP_LAYER) ||
+            (layer->compositionType == HWC_OVERLAY && (layer->hints & HWC_HINT_TRIPLE_BUFFER)))
+            continue;
+        frame->ddr_bytes += dss_fetch_bytes(layer, (IMG_native_handle_t *)layer->handle);
+    }
+}
+
 static int hwc_set(struct hwc_composer_device_1 *dev,
         size_t numDisplays, hwc_display_contents_1_t** displays)
 {
@@ -1944,6 +2637,7 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->comp_data.dsscomp_data;
     int err = 0;
     bool invalidate;
+    nsecs_t set_start = systemTime(SYSTEM_TIME_MONOTONIC);
 
     pthread_mutex_lock(&hwc_dev->lock);
 
@@ -1955,6 +2649,8 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
     if (debug)
         dump_set_info(hwc_dev, list);
 
+    wait_acquire_fences(numDisplays, displays);
+
     if (dpy && sur) {
         // list can be NULL which means hwc is temporarily disabled.
         // however, if dpy and sur are null it means we're turning the
@@ -2005,13 +2701,30 @@ static int hwc_set(struct hwc_composer_device_1 *dev,
             hwc_dev->blit_num, hwc_dev->post2_layers, hwc_dev->post2_blit_buffers,
             hwc_dev->use_sgx);
 
+        if (skip_idle_post(hwc_dev, nbufs))
+            goto skip_post;
+
         debug_post2(hwc_dev, nbufs);
+        hwc_trace(HWC_TRACE_POST2_SUBMIT, dsscomp->sync_id, 0);
         err = hwc_dev->fb_dev->Post2((framebuffer_device_t *)hwc_dev->fb_dev,
                                  hwc_dev->buffers,
                                  nbufs,
                                  dsscomp, omaplfb_comp_data_sz);
+        hwc_trace(HWC_TRACE_POST2_RETURN, dsscomp->sync_id, 0);
+        if (!err) {
+            hwc_trace_posted(hwc_dev->buffers, nbufs);
+            if (hwc_dev->policy_path != HWC_POLICY_NONE)
+                hwc_policy_record(hwc_dev->policy_sig, hwc_dev->policy_path,
+                                  systemTime(SYSTEM_TIME_MONOTONIC) - hwc_dev->prepare_start);
+        }
         showfps();
+
+        struct hwc_frame_stats frame;
+        get_frame_stats(hwc_dev, list, &frame);
+        frame.set_ns = systemTime(SYSTEM_TIME_MONOTONIC) - set_start;
+        hwc_stats_frame(&frame);
     }
+skip_post:
     hwc_dev->last_ext_ovls = hwc_dev->ext_ovls;
     hwc_dev->last_int_ovls = hwc_dev->post2_layers;
     if (err)
@@ -2040,6 +2753,11 @@ static void hwc_dump(struct hwc_composer_device_1 *dev, char *buff, int buff_len
 
     dump_printf(&log, "omap_hwc %d:\n", dsscomp->num_ovls);
     dump_printf(&log, "  idle timeout: %dms\n", hwc_dev->idle);
+    dump_printf(&log, "  idle: skip after %d identical frames, %u posts skipped\n",
+                      hwc_dev->idle_skip_frames, hwc_dev->idle_skipped);
+    dump_printf(&log, "  composition cache: %s, %u hits, %u misses\n",
+                      hwc_dev->comp_cache.valid ? "valid" : "invalid",
+                      hwc_dev->comp_cache.hits, hwc_dev->comp_cache.misses);
 
     for (i = 0; i < dsscomp->num_ovls; i++) {
         struct dss2_ovl_cfg *cfg = &dsscomp->ovls[i].cfg;
@@ -2059,7 +2777,19 @@ static void hwc_dump(struct hwc_composer_device_1 *dev, char *buff, int buff_len
             hwc_dev->blt_policy == BLTPOLICY_DEFAULT ? "default" :
                 hwc_dev->blt_policy == BLTPOLICY_ALL ? "all" : "unknown",
                     hwc_dev->blt_mode == BLTMODE_PAINT ? "paint" : "regionize");
+        if (hwc_dev->blt_mode == BLTMODE_REGION)
+            dump_printf(&log, "  blit pixels saved by partial updates: %llu\n",
+                        (unsigned long long)hwc_dev->blit_saved_pixels);
+
+        int blits_hwm, hregions_hwm;
+        rgz_get_arena_usage(&blits_hwm, &hregions_hwm);
+        dump_printf(&log, "  blit arena high-water: %d/%d blits, %d/%d hregions\n",
+                    blits_hwm, RGZ_MAX_BLITS, hregions_hwm, RGZ_SUBREGIONMAX);
     }
+
+    log.len += dump_hwc_stats(log.buf + log.len, log.buf_len - log.len);
+    log.len += dump_hwc_policy(log.buf + log.len, log.buf_len - log.len);
+    log.len += dump_hwc_trace(log.buf + log.len, log.buf_len - log.len);
     dump_printf(&log, "\n");
 }
 
@@ -2076,6 +2806,8 @@ static int hwc_device_close(hw_device_t* device)
             close(hwc_dev->fb_fd);
         if (hwc_dev->ion_fd >= 0)
             ion_close(hwc_dev->ion_fd);
+        if (hwc_dev->sgx_boost_fd >= 0)
+            close(hwc_dev->sgx_boost_fd);
 
         /* pthread will get killed when parent process exits */
         pthread_mutex_destroy(&hwc_dev->lock);
@@ -2141,33 +2873,58 @@ static void set_primary_display_transform_matrix(omap_hwc_device_t *hwc_dev)
          swap(orig_w, orig_h);
     m_scale(hwc_dev->primary_m, orig_w, lcd_w, orig_h, lcd_h);
     m_translate(hwc_dev->primary_m, lcd_w >> 1, lcd_h >> 1);
+    m_to_fixed(hwc_dev->primary_m, hwc_dev->primary_mq);
+}
+
+/* Read the EDID of the HDMI display, returns false if it is not available */
+static bool read_hdmi_edid(uint8_t *edid_data)
+{
+    int fd = open("/sys/devices/platform/omapdss/display1/edid", O_RDONLY);
+    if (fd < 0)
+        return false;
+    ssize_t bytes_read = read(fd, edid_data, EDID_SIZE);
+    close(fd);
+    return bytes_read == EDID_SIZE;
+}
+
+/* FNV-1a, only used to recognize a display we have already seen */
+static uint32_t hash_edid(const uint8_t *edid_data)
+{
+    uint32_t h = 2166136261u;
+    int i;
+    for (i = 0; i < EDID_SIZE; i++) {
+        h ^= edid_data[i];
+        h *= 16777619u;
+    }
+    return h ? : 1;
 }
 
 #ifdef OMAP_ENHANCEMENT_S3D
-static void handle_s3d_hotplug(omap_hwc_ext_t *ext, bool state)
+static void handle_s3d_hotplug(omap_hwc_ext_t *ext, uint8_t *edid_data)
 {
     struct edid_t *edid = NULL;
-    if (state) {
-        int fd = open("/sys/devices/platform/omapdss/display1/edid", O_RDONLY);
-        if (!fd)
-            return;
-        uint8_t edid_data[EDID_SIZE];
-        size_t bytes_read = read(fd, edid_data, EDID_SIZE);
-        close(fd);
-        if (bytes_read < EDID_SIZE)
-            return;
-        if (edid_parser_init(&edid, edid_data))
-            return;
-    }
+    if (edid_data && edid_parser_init(&edid, edid_data))
+        return;
 
     ext->s3d_enabled = false;
     ext->s3d_capable = false;
     ext->s3d_type = eMono;
     ext->s3d_order = eLeftViewFirst;
+    ext->s3d_formats = 0;
 
     if (edid) {
+        const struct hdmi_s3d_format_info_t *info;
+
         ext->s3d_capable = edid_s3d_capable(edid);
+        info = edid_get_s3d_format_info(edid, HDMI_SIDE_BY_SIDE_HALF);
+        if (info && info->num_valid_vic)
+            ext->s3d_formats |= 1u << eSideBySide;
+        info = edid_get_s3d_format_info(edid, HDMI_TOPBOTTOM);
+        if (info && info->num_valid_vic)
+            ext->s3d_formats |= 1u << eTopBottom;
         /* For now assume Side-by-Side half support applies to all modes */
+        if (ext->s3d_capable && !ext->s3d_formats)
+            ext->s3d_formats = 1u << eSideBySide;
         ext->s3d_type = eSideBySide;
         ext->s3d_order = eLeftViewFirst;
         edid_parser_deinit(edid);
@@ -2178,6 +2935,11 @@ static void handle_hotplug(omap_hwc_device_t *hwc_dev)
 {
     omap_hwc_ext_t *ext = &hwc_dev->ext;
     bool state = ext->hdmi_state;
+    uint8_t edid_data[EDID_SIZE];
+    bool have_edid = state && read_hdmi_edid(edid_data);
+
+    /* read once per hotplug, this also keys the HDMI mode cache */
+    ext->edid_hash = have_edid ? hash_edid(edid_data) : 0;
 
     /* Ignore external HDMI logic if the primary display is HDMI */
     if (hwc_dev->on_tv) {
@@ -2190,6 +2952,7 @@ static void handle_hotplug(omap_hwc_device_t *hwc_dev)
                 ALOGE("Failed to set HDMI mode");
             }
             set_primary_display_transform_matrix(hwc_dev);
+            hwc_dev->comp_cache.valid = false;
 
             ioctl(hwc_dev->fb_fd, FBIOBLANK, FB_BLANK_UNBLANK);
 
@@ -2204,8 +2967,9 @@ static void handle_hotplug(omap_hwc_device_t *hwc_dev)
 
     pthread_mutex_lock(&hwc_dev->lock);
 #ifdef OMAP_ENHANCEMENT_S3D
-    handle_s3d_hotplug(ext, state);
+    handle_s3d_hotplug(ext, have_edid ? edid_data : NULL);
 #endif
+    hwc_dev->comp_cache.valid = false;
     ext->dock.enabled = ext->mirror.enabled = 0;
     if (state) {
         /* check whether we can clone and/or dock */
@@ -2246,19 +3010,19 @@ static void handle_hotplug(omap_hwc_device_t *hwc_dev)
             } else
                 ext->mirror.enabled = 0;
         }
-        /* Allocate backup buffers for FB rotation
+        /* Backup buffers for FB rotation are allocated on first use
         * This is required only if the FB tranform is different from that
         * of the external display and the FB is not in TILER2D space
         */
-        if (ext->mirror.rotation && (limits.fbmem_type != DSSCOMP_FBMEM_TILER2D))
-            allocate_tiler2d_buffers(hwc_dev);
+        hwc_dev->tiler2d_needed = ext->mirror.rotation && (limits.fbmem_type != DSSCOMP_FBMEM_TILER2D);
+        if (!hwc_dev->tiler2d_needed)
+            free_tiler2d_buffers(hwc_dev);
 
     } else {
         ext->last_mode = 0;
-        if (ext->mirror.rotation && (limits.fbmem_type != DSSCOMP_FBMEM_TILER2D)) {
-            /* free tiler 2D buffer on detach */
-            free_tiler2d_buffers(hwc_dev);
-        }
+        /* free tiler 2D buffer on detach */
+        hwc_dev->tiler2d_needed = false;
+        free_tiler2d_buffers(hwc_dev);
     }
     ALOGI("external display changed (state=%d, mirror={%s tform=%ddeg%s}, dock={%s tform=%ddeg%s%s}, tv=%d", state,
          ext->mirror.enabled ? "enabled" : "disabled",
@@ -2312,15 +3076,48 @@ static void handle_uevents(omap_hwc_device_t *hwc_dev, const char *buff, int len
     }
 
     if (vsync) {
+        /* With s/w vsync the display events only correct the phase */
+        if (hwc_dev->use_sw_vsync) {
+            sync_sw_vsync(timestamp);
+            return;
+        }
+        hwc_trace(HWC_TRACE_VSYNC, 0, timestamp);
         if (hwc_dev->procs)
             hwc_dev->procs->vsync(hwc_dev->procs, 0, timestamp);
     } else {
+        /*
+         * Hotplug handling reads the EDID and sets up the display, hand it to
+         * the hotplug thread so vsync and idle events are not held up
+         */
+        pthread_mutex_lock(&hwc_dev->hotplug_lock);
         if (dock)
-            hwc_dev->ext.force_dock = state == 1;
+            hwc_dev->hotplug_dock = state == 1;
         else
-            hwc_dev->ext.hdmi_state = state == 1;
+            hwc_dev->hotplug_hdmi = state == 1;
+        hwc_dev->hotplug_pending = true;
+        pthread_cond_signal(&hwc_dev->hotplug_cond);
+        pthread_mutex_unlock(&hwc_dev->hotplug_lock);
+    }
+}
+
+static void *hotplug_thread(void *data)
+{
+    omap_hwc_device_t *hwc_dev = data;
+
+    for (;;) {
+        pthread_mutex_lock(&hwc_dev->hotplug_lock);
+        while (!hwc_dev->hotplug_pending)
+            pthread_cond_wait(&hwc_dev->hotplug_cond, &hwc_dev->hotplug_lock);
+        /* events which arrived meanwhile collapse into the latest state */
+        hwc_dev->hotplug_pending = false;
+        hwc_dev->ext.force_dock = hwc_dev->hotplug_dock;
+        hwc_dev->ext.hdmi_state = hwc_dev->hotplug_hdmi;
+        pthread_mutex_unlock(&hwc_dev->hotplug_lock);
+
         handle_hotplug(hwc_dev);
     }
+
+    return NULL;
 }
 
 static void *hdmi_thread(void *data)
@@ -2483,10 +3280,16 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
         return -ENOMEM;
 
     memset(hwc_dev, 0, sizeof(*hwc_dev));
+    hwc_dev->sgx_boost_fd = -1;
 
     hwc_dev->base.common.tag = HARDWARE_DEVICE_TAG;
     hwc_dev->base.common.version = HWC_DEVICE_API_VERSION_1_0;
 
+    init_hwc_trace();
+    init_hwc_record();
+    init_hwc_stats();
+    init_hwc_policy();
+
     if (use_sw_vsync()) {
         hwc_dev->use_sw_vsync = true;
         init_sw_vsync(hwc_dev);
@@ -2549,6 +3352,9 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
         ALOGE("failed to open ion driver (%d)", errno);
     }
 
+    /* optional, older sgxfreq has no boost */
+    hwc_dev->sgx_boost_fd = open(SGX_BOOST_PATH, O_WRONLY);
+
     int i;
     for (i = 0; i < NUM_EXT_DISPLAY_BACK_BUFFERS; i++) {
         hwc_dev->ion_handles[i] = NULL;
@@ -2587,6 +3393,18 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
         err = -errno;
         goto done;
     }
+    if (pthread_mutex_init(&hwc_dev->hotplug_lock, NULL) ||
+        pthread_cond_init(&hwc_dev->hotplug_cond, NULL)) {
+        ALOGE("failed to create hotplug mutex (%d): %m", errno);
+        err = -errno;
+        goto done;
+    }
+    if (pthread_create(&hwc_dev->hotplug_thread, NULL, hotplug_thread, hwc_dev))
+    {
+        ALOGE("failed to create hotplug thread (%d): %m", errno);
+        err = -errno;
+        goto done;
+    }
     if (pthread_create(&hwc_dev->hdmi_thread, NULL, hdmi_thread, hwc_dev))
     {
         ALOGE("failed to create HDMI listening thread (%d): %m", errno);
@@ -2604,6 +3422,13 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
     hwc_dev->flags_nv12_only = atoi(value);
     property_get("debug.hwc.idle", value, "250");
     hwc_dev->idle = atoi(value);
+    property_get("persist.hwc.idle_skip_frames", value, "3");
+    hwc_dev->idle_skip_frames = atoi(value);
+
+    /* DSS fetch budget in MB/s used by the overlay allocator, 0 for no limit */
+    property_get("persist.hwc.dss_bandwidth", value, "0");
+    if (atoi(value) > 0 && hwc_dev->fb_dev->base.fps > 0)
+        hwc_dev->dss_bw_limit = (uint32_t) (atoi(value) * 1000000.f / hwc_dev->fb_dev->base.fps);
 
     /* get the board specific clone properties */
     /* 0:0:1280:720 */
@@ -2635,6 +3460,10 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
             hwc_dev->ext.force_dock = value == '1';
         close(sw_fd);
     }
+    pthread_mutex_lock(&hwc_dev->hotplug_lock);
+    hwc_dev->hotplug_hdmi = hwc_dev->ext.hdmi_state;
+    hwc_dev->hotplug_dock = hwc_dev->ext.force_dock;
+    pthread_mutex_unlock(&hwc_dev->hotplug_lock);
     handle_hotplug(hwc_dev);
 
     ALOGI("open_device(rgb_order=%d nv12_only=%d)",
@@ -2659,6 +3488,9 @@ static int hwc_device_open(const hw_module_t* module, const char* name, hw_devic
         }
     }
 
+    property_get("persist.hwc.video_mode", value, "1");
+    hwc_dev->video_mode = atoi(value) != 0;
+
     property_get("persist.hwc.upscaled_nv12_limit", value, "2.");
     sscanf(value, "%f", &hwc_dev->upscaled_nv12_limit);
     if (hwc_dev->upscaled_nv12_limit < 0. || hwc_dev->upscaled_nv12_limit > 2048.) {
@@ -2674,6 +3506,8 @@ done:
             close(hwc_dev->hdmi_fb_fd);
         if (hwc_dev->fb_fd >= 0)
             close(hwc_dev->fb_fd);
+        if (hwc_dev->sgx_boost_fd >= 0)
+            close(hwc_dev->sgx_boost_fd);
         pthread_mutex_destroy(&hwc_dev->lock);
         free(hwc_dev->buffers);
         free(hwc_dev);
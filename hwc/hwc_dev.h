@@ -21,6 +21,7 @@
 #include <stdbool.h>
 
 #include <hardware/hwcomposer.h>
+#include <utils/Timers.h>
 #ifdef OMAP_ENHANCEMENT_S3D
 #include <ui/S3DFormat.h>
 #endif
@@ -32,6 +33,8 @@
 #include "hal_public.h"
 #include "rgz_2d.h"
 
+#define MAX_HWC_LAYERS 32
+
 struct ext_transform {
     uint8_t rotation : 3;          /* 90-degree clockwise rotations */
     uint8_t hflip    : 1;          /* flip l-r (after rotation) */
@@ -40,6 +43,27 @@ struct ext_transform {
 };
 typedef struct ext_transform ext_transform_t;
 
+/* result of the HDMI mode search for a given display and input geometry */
+#define HDMI_MODE_CACHE_SIZE 4
+struct hdmi_mode_cache {
+    bool valid;
+    uint32_t edid_hash;                 /* key */
+    int dis_ix;
+    uint32_t req_xres;
+    uint32_t req_yres;
+    float req_xpy;
+    uint32_t mirror_mode;
+    bool avoid_mode_change;
+    uint32_t best;                      /* result */
+    struct dsscomp_videomode mode;
+    uint16_t width;
+    uint16_t height;
+    uint32_t xres;
+    uint32_t yres;
+    bool on_tv;
+};
+typedef struct hdmi_mode_cache hdmi_mode_cache_t;
+
 /* cloning support and state */
 struct omap_hwc_ext {
     /* support */
@@ -66,16 +90,54 @@ struct omap_hwc_ext {
     uint32_t xres;                      /* external screen resolution */
     uint32_t yres;
     float m[2][3];                      /* external transformation matrix */
+    int32_t mq[2][3];                   /* m in 16.16 fixed point, used per layer */
+    struct {                            /* inputs m was last computed from */
+        bool valid;
+        hwc_rect_t region;
+        ext_transform_t transform;
+        uint32_t xres, yres;
+        uint16_t width, height;
+        float xpy;
+    } m_key;
     hwc_rect_t mirror_region;           /* region of screen to mirror */
+
+    uint32_t edid_hash;                 /* hash of the connected EDID, 0 if unknown */
+    hdmi_mode_cache_t mode_cache[HDMI_MODE_CACHE_SIZE];
+    uint32_t mode_cache_next;           /* next entry to replace */
 #ifdef OMAP_ENHANCEMENT_S3D
     bool s3d_enabled;
     bool s3d_capable;
-    enum S3DLayoutType s3d_type;
+    enum S3DLayoutType s3d_type;        /* transport format sent to the sink */
     enum S3DLayoutOrder s3d_order;
+    enum S3DLayoutType s3d_hdmi_type;   /* transport format programmed into HDMI */
+    uint32_t s3d_formats;               /* layouts the sink accepts, 1 << S3DLayoutType */
 #endif
 };
 typedef struct omap_hwc_ext omap_hwc_ext_t;
 
+#ifdef OMAP_ENHANCEMENT_S3D
+/* how one eye of an S3D layer is cut from its buffer and placed on the sink */
+struct s3d_view {
+    uint8_t crop_shift_x;               /* halve the crop of a packed input */
+    uint8_t crop_shift_y;
+    bool crop_second;                   /* view is in the right/bottom half of the buffer */
+    uint8_t win_shift_x;                /* halve the window for the transport format */
+    uint8_t win_shift_y;
+    bool win_second;                    /* view goes to the right/bottom half of the sink */
+};
+
+/* left and right eye configurations, rebuilt only when the layouts change */
+struct s3d_views {
+    bool valid;
+    enum S3DLayoutType input_type;
+    enum S3DLayoutOrder input_order;
+    enum S3DLayoutType output_type;
+    enum S3DLayoutOrder output_order;
+    struct s3d_view view[2];            /* left, right */
+};
+typedef struct s3d_views s3d_views_t;
+#endif
+
 enum bltpolicy {
     BLTPOLICY_DISABLED = 0,
     BLTPOLICY_DEFAULT = 1,    /* Default blit policy */
@@ -113,18 +175,65 @@ struct counts {
 };
 typedef struct counts counts_t;
 
+/* geometry-relevant fields of a layer, used as the composition cache key */
+struct layer_geom {
+    bool has_buffer;
+    uint32_t flags;
+    uint32_t transform;
+    int32_t blending;
+    hwc_rect_t sourceCrop;
+    hwc_rect_t displayFrame;
+    int format;
+    int width;
+    int height;
+    int usage;
+};
+typedef struct layer_geom layer_geom_t;
+
+/* composition decided by the last hwc_prepare, reused if the geometry is unchanged */
+struct comp_cache {
+    bool valid;
+    uint32_t num_layers;
+    int force_sgx;
+    layer_geom_t geom[MAX_HWC_LAYERS];
+    int32_t composition_type[MAX_HWC_LAYERS];
+    uint32_t hints[MAX_HWC_LAYERS];
+    int buf_ix[MAX_HWC_LAYERS];         /* index into buffers[], -1 if not on an overlay */
+
+    struct dsscomp_setup_dispc_data dsscomp;
+    counts_t counts;
+    bool use_sgx;
+    bool swap_rb;
+    uint32_t post2_layers;
+    uint32_t policy_sig;
+    int policy_choice;                  /* hwc_policy_choose result, HWC_POLICY_NONE if not asked */
+    int policy_path;
+
+    uint32_t hits;                      /* statistics */
+    uint32_t misses;
+};
+typedef struct comp_cache comp_cache_t;
+
 struct omap_hwc_device {
     /* static data */
     hwc_composer_device_1_t base;
     hwc_procs_t *procs;
-    pthread_t hdmi_thread;
+    pthread_t hdmi_thread;       /* uevents: vsync and idle, forwards hotplug */
     pthread_mutex_t lock;
 
+    pthread_t hotplug_thread;    /* runs handle_hotplug off the vsync path */
+    pthread_mutex_t hotplug_lock;
+    pthread_cond_t hotplug_cond;
+    bool hotplug_pending;
+    bool hotplug_dock;           /* latest switch states seen by the event thread */
+    bool hotplug_hdmi;
+
     IMG_framebuffer_device_public_t *fb_dev;
     struct dsscomp_display_info fb_dis;
     int fb_fd;                   /* file descriptor for /dev/fb0 */
     int dsscomp_fd;              /* file descriptor for /dev/dsscomp */
     int hdmi_fb_fd;              /* file descriptor for /dev/fb1 */
+    int sgx_boost_fd;            /* sgxfreq boost_pulse, -1 if missing */
     int pipe_fds[2];             /* pipe to event thread */
 
     int img_mem_size;           /* size of fb for hdmi */
@@ -133,13 +242,21 @@ struct omap_hwc_device {
     int flags_rgb_order;
     int flags_nv12_only;
     float upscaled_nv12_limit;
+    bool video_mode;             /* keep fullscreen NV12 on an overlay, UI in the FB */
+    hwc_layer_1_t *video_layer;  /* video mode layer of the current list, or NULL */
 
     bool on_tv;                  /* using a tv */
     int force_sgx;
     omap_hwc_ext_t ext;         /* external mirroring data */
     int idle;
+    int idle_skip_frames;        /* identical frames before posts are skipped, 0 to always post */
+    int same_frames;             /* identical frames posted in a row */
+    uint32_t idle_skipped;       /* statistics */
+    buffer_handle_t last_posted[MAX_HWC_LAYERS];
+    uint32_t last_posted_bufs;
 
     float primary_m[2][3];       /* internal transformation matrix */
+    int32_t primary_mq[2][3];    /* primary_m in 16.16 fixed point */
     int primary_transform;
     int primary_rotation;
     hwc_rect_t primary_region;
@@ -156,19 +273,33 @@ struct omap_hwc_device {
 #ifdef OMAP_ENHANCEMENT_S3D
     enum S3DLayoutType s3d_input_type;
     enum S3DLayoutOrder s3d_input_order;
+    s3d_views_t s3d_views;
 #endif
     enum bltmode blt_mode;
     enum bltpolicy blt_policy;
 
     uint32_t blit_flags;
     int blit_num;
+    uint64_t blit_saved_pixels;  /* framebuffer pixels the regionizer did not need to redraw */
+    nsecs_t prepare_ns;          /* duration of the last hwc_prepare */
+    nsecs_t prepare_start;       /* when the last hwc_prepare began */
+    uint32_t policy_sig;         /* layer configuration given to the composition feedback */
+    int policy_path;             /* enum hwc_policy_path taken for the FB layers */
+    int policy_choice;           /* enum hwc_policy_path the policy asked for */
+    bool policy_probe;           /* this frame measures the path not normally taken */
     struct omap_hwc_data comp_data; /* This is a kernel data structure */
     struct rgz_blt_entry blit_ops[RGZ_MAX_BLITS];
 
     counts_t counts;
+    comp_cache_t comp_cache;
+    bool comp_cache_hit;         /* this frame reuses the previous composition */
+    uint32_t ovl_candidates;     /* layers picked for DSS overlays when also using SGX */
+    uint32_t dss_bw_limit;       /* DSS fetch budget in bytes per frame, 0 if unlimited */
 
     int ion_fd;
     struct ion_handle *ion_handles[2];
+    int ion_last_used[2];        /* sync_id of the last composition using each buffer */
+    bool tiler2d_needed;         /* mirroring needs rotated copies of the FB */
     bool use_sw_vsync;
 
 };
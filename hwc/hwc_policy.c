@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+#include "hwc_policy.h"
+
+/*
+ * Feedback for the blit or SGX choice.  The cost of a frame is the time from
+ * the start of prepare to the return of Post2: it covers the regionizer and
+ * the blit submission on one path, SurfaceFlinger's GLES composition and
+ * eglSwapBuffers on the other.  Costs are averaged per layer configuration,
+ * a configuration starts on the blitter as before, and every so often one
+ * frame goes through the other path to keep its cost current.  The path only
+ * changes when the other one is cheaper by the hysteresis margin, so two
+ * paths of about the same cost do not alternate.
+ */
+
+/* layer configurations remembered, the least recently used one is replaced */
+#define POLICY_ENTRIES 16
+
+/* frames on a path before the first measurement of the other one */
+#define POLICY_WARMUP_FRAMES 8
+
+/* frames between later measurements of the path not taken */
+#define POLICY_PROBE_FRAMES 300
+
+/* percent the other path must save before switching */
+#define POLICY_HYSTERESIS 20
+
+/* cost average weight, 1 / 2^shift for a new frame */
+#define POLICY_AVG_SHIFT 3
+
+struct policy_entry {
+    uint32_t sig;
+    uint32_t last_use;
+    enum hwc_policy_path path;
+    bool probing;
+    uint32_t frames;                            /* on path since the last probe */
+    nsecs_t cost_ns[HWC_POLICY_NUM_PATHS];      /* 0 until measured */
+};
+
+static struct {
+    bool enabled;
+    uint32_t clock;
+    uint32_t probes;
+    uint32_t switches;
+    struct policy_entry e[POLICY_ENTRIES];
+} policy;
+
+static const char *path_names[HWC_POLICY_NUM_PATHS] = {
+    [HWC_POLICY_BLIT] = "blit",
+    [HWC_POLICY_SGX] = "SGX",
+};
+
+void init_hwc_policy()
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("persist.hwc.comp_feedback", value, "1");
+    policy.enabled = atoi(value) != 0;
+    ALOGI("composition feedback %s", policy.enabled ? "enabled" : "disabled");
+}
+
+static struct policy_entry *find_entry(uint32_t sig, bool create)
+{
+    struct policy_entry *lru = &policy.e[0];
+    int i;
+
+    for (i = 0; i < POLICY_ENTRIES; i++) {
+        if (policy.e[i].last_use && policy.e[i].sig == sig)
+            return &policy.e[i];
+        if (policy.e[i].last_use < lru->last_use)
+            lru = &policy.e[i];
+    }
+    if (!create)
+        return NULL;
+
+    memset(lru, 0, sizeof(*lru));
+    lru->sig = sig;
+    lru->path = HWC_POLICY_BLIT;
+    return lru;
+}
+
+enum hwc_policy_path hwc_policy_choose(uint32_t sig, bool *probe)
+{
+    struct policy_entry *e;
+    enum hwc_policy_path other;
+
+    *probe = false;
+    if (!policy.enabled)
+        return HWC_POLICY_BLIT;
+
+    e = find_entry(sig, true);
+    e->last_use = ++policy.clock;
+    other = e->path == HWC_POLICY_BLIT ? HWC_POLICY_SGX : HWC_POLICY_BLIT;
+
+    /* a probe that was not posted is retried */
+    if (!e->probing && e->cost_ns[e->path] &&
+        ++e->frames >= (e->cost_ns[other] ? POLICY_PROBE_FRAMES : POLICY_WARMUP_FRAMES)) {
+        e->probing = true;
+        e->frames = 0;
+        policy.probes++;
+    }
+    if (!e->probing)
+        return e->path;
+
+    *probe = true;
+    return other;
+}
+
+bool hwc_policy_reuse(uint32_t sig, enum hwc_policy_path choice)
+{
+    bool probe;
+
+    /* a pending probe is not counted again by the next hwc_policy_choose() */
+    return hwc_policy_choose(sig, &probe) == choice && !probe;
+}
+
+void hwc_policy_record(uint32_t sig, enum hwc_policy_path path, nsecs_t cost_ns)
+{
+    struct policy_entry *e = find_entry(sig, false);
+    nsecs_t *avg;
+
+    if (!policy.enabled || !e || path < 0 || path >= HWC_POLICY_NUM_PATHS || cost_ns <= 0)
+        return;
+
+    avg = &e->cost_ns[path];
+    if (!*avg || (e->probing && path != e->path))
+        *avg = cost_ns;     /* a probe is one frame, do not blend in a stale cost */
+    else
+        *avg += (cost_ns - *avg) >> POLICY_AVG_SHIFT;
+
+    if (!e->probing)
+        return;
+
+    /* the probe ends here even when the other path could not be taken */
+    e->probing = false;
+    if (path != e->path &&
+        e->cost_ns[path] * 100 < e->cost_ns[e->path] * (100 - POLICY_HYSTERESIS)) {
+        ALOGV("config %08x: %s %lldus -> %s %lldus", sig,
+              path_names[e->path], (long long) ns2us(e->cost_ns[e->path]),
+              path_names[path], (long long) ns2us(e->cost_ns[path]));
+        e->path = path;
+        policy.switches++;
+    }
+}
+
+int dump_hwc_policy(char *buf, int buf_len)
+{
+    int len = 0;
+    int i;
+
+    if (buf_len <= 0)
+        return 0;
+
+    len += snprintf(buf + len, buf_len - len,
+                    "  composition feedback: %s, %u probes, %u switches\n",
+                    policy.enabled ? "enabled" : "disabled", policy.probes, policy.switches);
+    for (i = 0; i < POLICY_ENTRIES && len < buf_len; i++) {
+        struct policy_entry *e = &policy.e[i];
+
+        if (!e->last_use)
+            continue;
+        len += snprintf(buf + len, buf_len - len, "    %08x: %s, blit %lldus, SGX %lldus\n",
+                        e->sig, path_names[e->path],
+                        (long long) ns2us(e->cost_ns[HWC_POLICY_BLIT]),
+                        (long long) ns2us(e->cost_ns[HWC_POLICY_SGX]));
+    }
+
+    return len < buf_len ? len : buf_len - 1;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_POLICY__
+#define __HWC_POLICY__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <utils/Timers.h>
+
+/* how the layers left without an overlay are composed into the FB */
+enum hwc_policy_path {
+    HWC_POLICY_NONE = -1,       /* no FB composition this frame */
+    HWC_POLICY_BLIT = 0,        /* GC320 through the regionizer */
+    HWC_POLICY_SGX,             /* SurfaceFlinger GLES composition */
+    HWC_POLICY_NUM_PATHS,
+};
+
+void init_hwc_policy();
+
+/*
+ * Path to try for the layer configuration sig, *probe is set when this frame
+ * measures the path not normally taken.  Called with hwc_dev->lock held.
+ */
+enum hwc_policy_path hwc_policy_choose(uint32_t sig, bool *probe);
+
+/*
+ * Counts a frame that reuses a composition decided when the policy chose
+ * choice for sig.  Returns false when a probe is due or the choice changed,
+ * the frame must then be composed again and hwc_policy_choose() returns the
+ * path to take.  Called with hwc_dev->lock held.
+ */
+bool hwc_policy_reuse(uint32_t sig, enum hwc_policy_path choice);
+
+/* account the cost of a posted frame composed through path */
+void hwc_policy_record(uint32_t sig, enum hwc_policy_path path, nsecs_t cost_ns);
+
+/* print the remembered configurations, returns the number of characters written */
+int dump_hwc_policy(char *buf, int buf_len);
+
+#endif
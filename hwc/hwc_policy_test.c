@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test case for the blit or SGX composition feedback.  Frames are run the
+ * way hwc_prepare does with the composition cache: once a layer
+ * configuration is composed its composition is reused for as long as
+ * hwc_policy_reuse() allows, and every posted frame is recorded.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hwc_policy.h"
+
+#define TEST_SIG        0x12345678u
+
+/* POLICY_PROBE_FRAMES in hwc_policy.c, plus the probe frame itself */
+#define PROBE_PERIOD    301
+
+struct frame_log {
+    enum hwc_policy_path path;
+    bool probe;
+    bool cached;
+};
+
+static void run_frames(nsecs_t blit_ns, nsecs_t sgx_ns, struct frame_log *log, int frames)
+{
+    bool cached = false;
+    enum hwc_policy_path cached_choice = HWC_POLICY_NONE;
+    int i;
+
+    for (i = 0; i < frames; i++) {
+        enum hwc_policy_path path;
+        bool probe = false;
+
+        /* geometry never changes, the cache only misses on the policy's say */
+        if (cached && !hwc_policy_reuse(TEST_SIG, cached_choice))
+            cached = false;
+
+        if (cached) {
+            path = cached_choice;
+            log[i].cached = true;
+        } else {
+            path = hwc_policy_choose(TEST_SIG, &probe);
+            /* comp_cache_store() skips probe frames */
+            cached = !probe;
+            cached_choice = path;
+            log[i].cached = false;
+        }
+        log[i].path = path;
+        log[i].probe = probe;
+
+        hwc_policy_record(TEST_SIG, path, path == HWC_POLICY_BLIT ? blit_ns : sgx_ns);
+    }
+}
+
+/* SGX is cheaper: the configuration moves to SGX and the blitter keeps being probed */
+static int policy_probe_test(void)
+{
+    enum { FRAMES = 1000 };
+    static struct frame_log log[FRAMES];
+    int i, switched = -1, last_probe = -1, probes = 0, ret = 0;
+
+    run_frames(10000000, 4000000, log, FRAMES);
+
+    for (i = 0; i < FRAMES; i++) {
+        if (switched < 0 && !log[i].probe && log[i].path == HWC_POLICY_SGX)
+            switched = i;
+        if (switched < 0)
+            continue;
+
+        if (log[i].cached && log[i].probe) {
+            printf("%s(): frame %d: probe served from the cache\n", __func__, i);
+            ret = -1;
+        }
+        if (!log[i].probe) {
+            if (log[i].path != HWC_POLICY_SGX) {
+                printf("%s(): frame %d: left SGX without a probe\n", __func__, i);
+                ret = -1;
+            }
+            continue;
+        }
+        if (log[i].path != HWC_POLICY_BLIT) {
+            printf("%s(): frame %d: probe did not go to the blitter\n", __func__, i);
+            ret = -1;
+        }
+        if (i - (last_probe < 0 ? switched : last_probe) > PROBE_PERIOD) {
+            printf("%s(): frame %d: no blitter probe since frame %d\n", __func__, i,
+                   last_probe < 0 ? switched : last_probe);
+            ret = -1;
+        }
+        last_probe = i;
+        probes++;
+    }
+
+    if (switched < 0) {
+        printf("%s(): never moved to SGX\n", __func__);
+        ret = -1;
+    } else if (FRAMES - 1 - (last_probe < 0 ? switched : last_probe) > PROBE_PERIOD) {
+        printf("%s(): no blitter probe after frame %d\n", __func__,
+               last_probe < 0 ? switched : last_probe);
+        ret = -1;
+    }
+
+    printf("\nhwc policy probe test: %s (%d blitter probes over %d cached SGX frames)\n\n",
+           ret ? "FAILED" : "PASSED", probes, switched < 0 ? 0 : FRAMES - switched);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    init_hwc_policy();
+    return policy_probe_test() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
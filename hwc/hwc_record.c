@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+#include "hwc_dev.h"
+#include "hwc_record.h"
+
+static FILE *record_file;
+static int record_frames_left;
+
+void init_hwc_record()
+{
+    char path[PROPERTY_VALUE_MAX];
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.hwc.record", path, "");
+    if (!path[0])
+        return;
+
+    property_get("debug.hwc.record_frames", value, "600");
+    record_frames_left = atoi(value);
+    if (record_frames_left <= 0)
+        return;
+
+    record_file = fopen(path, "wb");
+    if (!record_file) {
+        ALOGE("failed to open %s for recording: %m", path);
+        return;
+    }
+
+    struct hwc_record_header header = {
+        .magic = HWC_RECORD_MAGIC,
+        .version = HWC_RECORD_VERSION,
+    };
+    fwrite(&header, sizeof(header), 1, record_file);
+    ALOGI("recording %d frames to %s", record_frames_left, path);
+}
+
+static void copy_rect(int32_t dst[4], hwc_rect_t *src)
+{
+    dst[0] = src->left;
+    dst[1] = src->top;
+    dst[2] = src->right;
+    dst[3] = src->bottom;
+}
+
+void hwc_record_frame(hwc_display_contents_1_t *list, hwc_layer_extended_t *extlayers,
+                      struct bvsurfgeom *dstgeom)
+{
+    uint32_t i;
+
+    if (!record_file || !list)
+        return;
+
+    struct hwc_record_frame frame = {
+        .magic = HWC_RECORD_FRAME_MAGIC,
+        .num_layers = list->numHwLayers,
+        .dst_format = dstgeom->format,
+        .dst_width = dstgeom->width,
+        .dst_height = dstgeom->height,
+        .dst_stride = dstgeom->virtstride,
+    };
+    fwrite(&frame, sizeof(frame), 1, record_file);
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+        IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+        struct hwc_record_layer r;
+
+        memset(&r, 0, sizeof(r));
+        r.composition_type = layer->compositionType;
+        r.hints = layer->hints;
+        r.flags = layer->flags;
+        r.transform = layer->transform;
+        r.blending = layer->blending;
+        copy_rect(r.source_crop, &layer->sourceCrop);
+        copy_rect(r.display_frame, &layer->displayFrame);
+        r.identity = extlayers ? extlayers[i].identity : 0;
+        if (handle) {
+            r.handle_id = (uintptr_t)handle;
+            r.format = handle->iFormat;
+            r.width = handle->iWidth;
+            r.height = handle->iHeight;
+            r.usage = handle->usage;
+        }
+        fwrite(&r, sizeof(r), 1, record_file);
+    }
+
+    if (--record_frames_left == 0) {
+        fclose(record_file);
+        record_file = NULL;
+        ALOGI("recording complete");
+    }
+}
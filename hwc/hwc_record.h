@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_RECORD__
+#define __HWC_RECORD__
+
+#include <stdint.h>
+
+#include <hardware/hwcomposer.h>
+#include <linux/bltsville.h>
+
+/*
+ * Layer lists handed to the regionizer can be recorded to a file and replayed
+ * offline with rgz_bench. The file is a header followed by frames, each frame
+ * is a hwc_record_frame followed by its layers. Values are stored in the
+ * native byte order of the device.
+ */
+#define HWC_RECORD_MAGIC 0x52435748 /* "HWCR" */
+#define HWC_RECORD_FRAME_MAGIC 0x4d415246 /* "FRAM" */
+#define HWC_RECORD_VERSION 1
+
+struct hwc_record_header {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct hwc_record_frame {
+    uint32_t magic;
+    uint32_t num_layers;
+    /* destination surface geometry */
+    uint32_t dst_format;
+    uint32_t dst_width;
+    uint32_t dst_height;
+    int32_t dst_stride;
+};
+
+struct hwc_record_layer {
+    int32_t composition_type;
+    uint32_t hints;
+    uint32_t flags;
+    uint32_t transform;
+    int32_t blending;
+    int32_t source_crop[4];      /* left, top, right, bottom */
+    int32_t display_frame[4];
+    uint32_t identity;
+    uint64_t handle_id;          /* buffer handle address, 0 if none */
+    int32_t format;
+    int32_t width;
+    int32_t height;
+    int32_t usage;
+};
+
+/* Start recording if debug.hwc.record names a file */
+void init_hwc_record();
+
+/* Append a layer list if recording, stops after debug.hwc.record_frames */
+void hwc_record_frame(hwc_display_contents_1_t *list, hwc_layer_extended_t *extlayers,
+                      struct bvsurfgeom *dstgeom);
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+#include <utils/Timers.h>
+
+#include "hwc_stats.h"
+
+/* frames in the rolling window, also the period of the stats file */
+#define STATS_WINDOW 256
+
+/* latency buckets double from 128us, the last one is open ended */
+#define STATS_LAT_BUCKETS 9
+#define STATS_LAT_FIRST_US 128
+
+struct stats_window {
+    uint32_t frames;
+    uint32_t comp[HWC_STATS_NUM_COMP];
+    uint64_t ovls;
+    uint64_t scaled_ovls;
+    uint64_t blits;
+    uint64_t ddr_bytes;
+};
+
+static struct {
+    uint64_t frames;
+    uint64_t comp[HWC_STATS_NUM_COMP];
+    uint32_t prepare_hist[STATS_LAT_BUCKETS];
+    uint32_t set_hist[STATS_LAT_BUCKETS];
+    struct stats_window cur;    /* window being filled */
+    struct stats_window last;   /* last complete window */
+} stats;
+
+static char stats_path[PROPERTY_VALUE_MAX];
+
+static const char *comp_names[HWC_STATS_NUM_COMP] = {
+    [HWC_STATS_ALL_DSS] = "all-DSS",
+    [HWC_STATS_BLIT] = "blit",
+    [HWC_STATS_MIXED] = "SGX+DSS",
+    [HWC_STATS_ALL_SGX] = "all-SGX",
+};
+
+void init_hwc_stats()
+{
+    property_get("debug.hwc.stats_file", stats_path, "");
+}
+
+static void add_latency(uint32_t hist[STATS_LAT_BUCKETS], nsecs_t ns)
+{
+    nsecs_t limit = us2ns(STATS_LAT_FIRST_US);
+    int i;
+
+    for (i = 0; i < STATS_LAT_BUCKETS - 1 && ns >= limit; i++)
+        limit <<= 1;
+    hist[i]++;
+}
+
+static void write_stats_file()
+{
+    char buf[2048];
+    FILE *f;
+    int len = dump_hwc_stats(buf, sizeof(buf));
+
+    f = fopen(stats_path, "w");
+    if (!f) {
+        ALOGE("failed to open %s: %m", stats_path);
+        stats_path[0] = '\0';
+        return;
+    }
+    fwrite(buf, 1, len, f);
+    fclose(f);
+}
+
+void hwc_stats_frame(const struct hwc_frame_stats *frame)
+{
+    struct stats_window *w = &stats.cur;
+
+    stats.frames++;
+    if (frame->comp < HWC_STATS_NUM_COMP)
+        stats.comp[frame->comp]++;
+    add_latency(stats.prepare_hist, frame->prepare_ns);
+    add_latency(stats.set_hist, frame->set_ns);
+
+    w->frames++;
+    if (frame->comp < HWC_STATS_NUM_COMP)
+        w->comp[frame->comp]++;
+    w->ovls += frame->ovls;
+    w->scaled_ovls += frame->scaled_ovls;
+    w->blits += frame->blits;
+    w->ddr_bytes += frame->ddr_bytes;
+
+    if (w->frames < STATS_WINDOW)
+        return;
+
+    stats.last = *w;
+    memset(w, 0, sizeof(*w));
+    if (stats_path[0])
+        write_stats_file();
+}
+
+static int dump_hist(char *buf, int buf_len, const char *name, uint32_t hist[STATS_LAT_BUCKETS])
+{
+    int len = snprintf(buf, buf_len, "    %s:", name);
+    uint32_t us = STATS_LAT_FIRST_US;
+    int i;
+
+    for (i = 0; i < STATS_LAT_BUCKETS && len < buf_len; i++, us <<= 1) {
+        if (i < STATS_LAT_BUCKETS - 1)
+            len += snprintf(buf + len, buf_len - len, " <%uus:%u", us, hist[i]);
+        else
+            len += snprintf(buf + len, buf_len - len, " >=%uus:%u", us >> 1, hist[i]);
+    }
+    if (len < buf_len)
+        len += snprintf(buf + len, buf_len - len, "\n");
+    return len;
+}
+
+int dump_hwc_stats(char *buf, int buf_len)
+{
+    /* the window being filled is used until the first one completes */
+    struct stats_window *w = stats.last.frames ? &stats.last : &stats.cur;
+    uint32_t n = w->frames ? w->frames : 1;
+    int len = 0;
+    int i;
+
+    if (buf_len <= 0)
+        return 0;
+
+    len += snprintf(buf + len, buf_len - len, "  composition stats (%llu frames):\n",
+                    (unsigned long long) stats.frames);
+    for (i = 0; i < HWC_STATS_NUM_COMP && len < buf_len; i++)
+        len += snprintf(buf + len, buf_len - len, "    %s: %llu total, %u of last %u\n",
+                        comp_names[i], (unsigned long long) stats.comp[i],
+                        w->comp[i], w->frames);
+    if (len < buf_len)
+        len += snprintf(buf + len, buf_len - len,
+                        "    per frame: %llu.%02llu overlays, %llu.%02llu scaled, %llu.%02llu blits, %llu KB DDR\n",
+                        (unsigned long long) (w->ovls / n), (unsigned long long) (w->ovls * 100 / n % 100),
+                        (unsigned long long) (w->scaled_ovls / n), (unsigned long long) (w->scaled_ovls * 100 / n % 100),
+                        (unsigned long long) (w->blits / n), (unsigned long long) (w->blits * 100 / n % 100),
+                        (unsigned long long) (w->ddr_bytes / n / 1024));
+    if (len < buf_len)
+        len += dump_hist(buf + len, buf_len - len, "prepare", stats.prepare_hist);
+    if (len < buf_len)
+        len += dump_hist(buf + len, buf_len - len, "set", stats.set_hist);
+
+    return len < buf_len ? len : buf_len - 1;
+}
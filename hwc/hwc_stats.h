@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_STATS__
+#define __HWC_STATS__
+
+#include <stdint.h>
+#include <utils/Timers.h>
+
+/* how a frame was composed */
+enum hwc_stats_comp {
+    HWC_STATS_ALL_DSS = 0,      /* every layer on an overlay */
+    HWC_STATS_BLIT,             /* FB composed by the blitter, no SGX */
+    HWC_STATS_MIXED,            /* SGX composed FB plus overlays */
+    HWC_STATS_ALL_SGX,          /* SGX composed FB only */
+    HWC_STATS_NUM_COMP,
+};
+
+struct hwc_frame_stats {
+    enum hwc_stats_comp comp;
+    uint32_t ovls;              /* overlays posted, including external clones */
+    uint32_t scaled_ovls;
+    uint32_t blits;
+    uint64_t ddr_bytes;         /* estimated composition and scan-out traffic */
+    nsecs_t prepare_ns;
+    nsecs_t set_ns;
+};
+
+void init_hwc_stats();
+
+/* account a posted frame, called with hwc_dev->lock held */
+void hwc_stats_frame(const struct hwc_frame_stats *frame);
+
+/* print the counters, returns the number of characters written */
+int dump_hwc_stats(char *buf, int buf_len);
+
+#endif
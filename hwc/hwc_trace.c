@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <cutils/atomic.h>
+#include <cutils/properties.h>
+#include <cutils/trace.h>
+#include <utils/Timers.h>
+
+#include "hwc_trace.h"
+#include "frame_trace.h"
+
+/* must be a power of 2 */
+#define TRACE_ENTRIES 256
+#define TRACE_DUMP_ENTRIES 32
+
+struct trace_entry {
+    nsecs_t timestamp;
+    uint32_t sync_id;
+    uint32_t event;
+};
+
+static struct trace_entry trace_ring[TRACE_ENTRIES];
+static volatile int32_t trace_head;
+static bool trace_enabled;
+
+static const char *event_names[HWC_TRACE_NUM_EVENTS] = {
+    [HWC_TRACE_PREPARE_BEGIN] = "prepare",
+    [HWC_TRACE_PREPARE_END] = "prepare-end",
+    [HWC_TRACE_BLIT_BEGIN] = "blit",
+    [HWC_TRACE_BLIT_END] = "blit-end",
+    [HWC_TRACE_POST2_SUBMIT] = "post2",
+    [HWC_TRACE_POST2_RETURN] = "post2-end",
+    [HWC_TRACE_VSYNC] = "vsync",
+};
+
+void init_hwc_trace()
+{
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.hwc.trace", value, "1");
+    trace_enabled = atoi(value) > 0;
+}
+
+void hwc_trace(enum hwc_trace_event event, uint32_t sync_id, nsecs_t timestamp)
+{
+    static int32_t vsync_toggle;
+
+    if (!trace_enabled)
+        return;
+
+    if (!timestamp)
+        timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    /* claim a slot; a reader may see a slot being rewritten, which is harmless */
+    int32_t ix = android_atomic_inc(&trace_head) & (TRACE_ENTRIES - 1);
+    struct trace_entry *e = &trace_ring[ix];
+    e->timestamp = timestamp;
+    e->sync_id = sync_id;
+    e->event = event;
+
+    /* mirror the events as systrace markers */
+    switch (event) {
+    case HWC_TRACE_PREPARE_BEGIN:
+    case HWC_TRACE_BLIT_BEGIN:
+    case HWC_TRACE_POST2_SUBMIT:
+        ATRACE_BEGIN(event_names[event]);
+        break;
+    case HWC_TRACE_PREPARE_END:
+    case HWC_TRACE_BLIT_END:
+    case HWC_TRACE_POST2_RETURN:
+        ATRACE_END();
+        break;
+    case HWC_TRACE_VSYNC:
+        vsync_toggle = !vsync_toggle;
+        ATRACE_INT("hwc-vsync", vsync_toggle);
+        break;
+    default:
+        break;
+    }
+}
+
+void hwc_trace_layers(hwc_display_contents_1_t *list)
+{
+    size_t i;
+
+    if (!list || !atrace_is_tag_enabled(ATRACE_TAG))
+        return;
+
+    for (i = 0; i < list->numHwLayers; i++) {
+        hwc_layer_1_t *layer = &list->hwLayers[i];
+
+        if (layer->compositionType == HWC_OVERLAY)
+            frame_trace(ATRACE_TAG, FRAME_TRACE_HWC_OVL, (IMG_native_handle_t *)layer->handle);
+        else if (layer->compositionType == HWC_FRAMEBUFFER)
+            frame_trace(ATRACE_TAG, FRAME_TRACE_HWC_GL, (IMG_native_handle_t *)layer->handle);
+    }
+}
+
+void hwc_trace_posted(buffer_handle_t *buffers, uint32_t num)
+{
+    uint32_t i;
+
+    if (!atrace_is_tag_enabled(ATRACE_TAG))
+        return;
+
+    for (i = 0; i < num; i++)
+        frame_trace(ATRACE_TAG, FRAME_TRACE_HWC_POST, (IMG_native_handle_t *)buffers[i]);
+}
+
+int dump_hwc_trace(char *buf, int buf_len)
+{
+    int32_t head = trace_head;
+    int32_t n = head < TRACE_DUMP_ENTRIES ? head : TRACE_DUMP_ENTRIES;
+    int32_t i;
+    int len = 0;
+    nsecs_t last = 0;
+
+    if (!trace_enabled || buf_len <= 0)
+        return 0;
+
+    len += snprintf(buf + len, buf_len - len, "  timeline (last %d events):\n", n);
+    for (i = head - n; i < head && len < buf_len; i++) {
+        struct trace_entry *e = &trace_ring[i & (TRACE_ENTRIES - 1)];
+        const char *name = e->event < HWC_TRACE_NUM_EVENTS ? event_names[e->event] : "?";
+
+        len += snprintf(buf + len, buf_len - len, "    %lld.%06lld +%lldus %s #%u\n",
+                        (long long) (e->timestamp / 1000000000),
+                        (long long) ((e->timestamp % 1000000000) / 1000),
+                        (long long) (last ? (e->timestamp - last) / 1000 : 0),
+                        name, e->sync_id);
+        last = e->timestamp;
+    }
+    return len < buf_len ? len : buf_len - 1;
+}
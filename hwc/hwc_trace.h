@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HWC_TRACE__
+#define __HWC_TRACE__
+
+#include <stdint.h>
+#include <hardware/hwcomposer.h>
+#include <utils/Timers.h>
+
+/* per-frame composition events */
+enum hwc_trace_event {
+    HWC_TRACE_PREPARE_BEGIN = 0,
+    HWC_TRACE_PREPARE_END,
+    HWC_TRACE_BLIT_BEGIN,
+    HWC_TRACE_BLIT_END,
+    HWC_TRACE_POST2_SUBMIT,
+    HWC_TRACE_POST2_RETURN,
+    HWC_TRACE_VSYNC,
+    HWC_TRACE_NUM_EVENTS,
+};
+
+void init_hwc_trace();
+
+/*
+ * Record an event in the timeline ring.  A timestamp of 0 means now.  Safe to
+ * call from any thread without holding hwc_dev->lock.
+ */
+void hwc_trace(enum hwc_trace_event event, uint32_t sync_id, nsecs_t timestamp);
+
+/*
+ * Tag the layer buffers on the shared frame timeline (see frame_trace.h):
+ * where prepare() sent each one, and which ones went out with Post2.
+ */
+void hwc_trace_layers(hwc_display_contents_1_t *list);
+void hwc_trace_posted(buffer_handle_t *buffers, uint32_t num);
+
+/* print the most recent events, returns the number of characters written */
+int dump_hwc_trace(char *buf, int buf_len);
+
+#endif
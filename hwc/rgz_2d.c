@@ -66,19 +66,22 @@ static int rgz_handle_to_stride(IMG_native_handle_t *h);
 #define IS_BVCMD(params) (params->op == RGZ_OUT_BVCMD_REGION || params->op == RGZ_OUT_BVCMD_PAINT)
 
 #define RECT_INTERSECTS(a, b) (((a).bottom > (b).top) && ((a).top < (b).bottom) && ((a).right > (b).left) && ((a).left < (b).right))
+#define RECT_TOUCHES(a, b) (((a).bottom >= (b).top) && ((a).top <= (b).bottom) && ((a).right >= (b).left) && ((a).left <= (b).right))
+#define RECT_AREA(r) ((unsigned int)(WIDTH(r) * HEIGHT(r)))
 
 /* Buffer indexes used to distinguish background and layers with the clear fb hint */
 #define RGZ_BACKGROUND_BUFFIDX -2
 #define RGZ_CLEARHINT_BUFFIDX -1
 
 struct rgz_blts {
-    struct rgz_blt_entry bvcmds[RGZ_MAX_BLITS];
+    struct rgz_blt_entry *bvcmds;
     int idx;
+    int max;
 };
 
 
 static int rgz_hwc_layer_blit(rgz_out_params_t *params, rgz_layer_t *rgz_layer);
-static void rgz_blts_init(struct rgz_blts *blts);
+static void rgz_blts_init(struct rgz_blts *blts, struct rgz_blt_entry *cmdp, int cmdlen);
 static void rgz_blts_free(struct rgz_blts *blts);
 static struct rgz_blt_entry* rgz_blts_get(struct rgz_blts *blts, rgz_out_params_t *params);
 static int rgz_blts_bvdirect(rgz_t* rgz, struct rgz_blts *blts, rgz_out_params_t *params);
@@ -90,6 +93,19 @@ static int rgz_hwc_scaled(hwc_layer_1_t *layer);
 
 int debug = 0;
 struct rgz_blts blts;
+/*
+ * Preallocated storage for the per-frame regionizer data. Nothing on the
+ * composition path allocates, each frame just starts over from the beginning
+ * of the arena.
+ */
+static struct rgz_arena {
+    /* Used when the caller does not supply a command buffer */
+    struct rgz_blt_entry bvcmds[RGZ_MAX_BLITS];
+    /* There can't be more hregions than unique top/bottom edges */
+    blit_hregion_t hregions[RGZ_SUBREGIONMAX];
+    int blits_hwm;
+    int hregions_hwm;
+} arena;
 /* Represents a screen sized background layer */
 static hwc_layer_1_t bg_layer;
 
@@ -255,7 +271,7 @@ static int rgz_out_bvdirect_paint(rgz_t *rgz, rgz_out_params_t *params)
     int i;
     (void)rgz;
 
-    rgz_blts_init(&blts);
+    rgz_blts_init(&blts, NULL, 0);
 
     /* Begin from index 1 to remove the background layer from the output */
     rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
@@ -738,7 +754,7 @@ static int rgz_out_bvcmd_paint(rgz_t *rgz, rgz_out_params_t *params)
     int i, j;
     params->data.bvc.out_blits = 0;
     params->data.bvc.out_nhndls = 0;
-    rgz_blts_init(&blts);
+    rgz_blts_init(&blts, params->data.bvc.cmdp, params->data.bvc.cmdlen);
     rgz_out_clrdst(params, NULL);
 
     /* Begin from index 1 to remove the background layer from the output */
@@ -784,7 +800,7 @@ static int rgz_out_bvcmd_paint(rgz_t *rgz, rgz_out_params_t *params)
     params->data.bvc.cmdp = blts.bvcmds;
     params->data.bvc.cmdlen = blts.idx;
 
-    if (params->data.bvc.out_blits >= RGZ_MAX_BLITS) {
+    if (params->data.bvc.out_blits >= blts.max) {
         rv = -1;
     // rgz_blts_free(&blts); // FIXME
     }
@@ -813,45 +829,53 @@ static float getscaleh(hwc_layer_1_t *layer)
     return ((float)HEIGHT(layer->displayFrame)) / (float)h;
 }
 
+static int rgz_cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
 /*
- * Simple bubble sort on an array, ascending order
+ * Sort an array of edges in ascending order and leave only unique values,
+ * returns the number of unique edges
  */
-static void rgz_bsort(int *a, int len)
-{
-    int i, j;
-    for (i = 0; i < len; i++) {
-        for (j = 0; j < i; j++) {
-            if (a[i] < a[j]) {
-                int temp = a[i];
-                a[i] = a[j];
-                a[j] = temp;
-            }
-        }
+static int rgz_sort_edges(int *a, int len)
+{
+    int i, unique;
+    if (len <= 1)
+        return len;
+    qsort(a, len, sizeof(*a), rgz_cmp_int);
+    for (i = 1, unique = 1; i < len; i++) {
+        if (a[i] != a[unique - 1])
+            a[unique++] = a[i];
     }
+    return unique;
 }
 
 /*
- * Leave only unique numbers in a sorted array
+ * Index of the first edge in a sorted array which is not lower than value,
+ * len if there is none
  */
-static int rgz_bunique(int *a, int len)
-{
-    int unique = 1;
-    int base = 0;
-    while (base + 1 < len) {
-        if (a[base] == a[base + 1]) {
-            int skip = 1;
-            while (base + skip < len && a[base] == a[base + skip])
-                skip++;
-            if (base + skip == len)
-                break;
-            int i;
-            for (i = 0; i < skip - 1; i++)
-                a[base + 1 + i] = a[base + skip];
-        }
-        unique++;
-        base++;
+static int rgz_lower_edge(int *a, int len, int value)
+{
+    int lo = 0, hi = len;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (a[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    return unique;
+    return lo;
+}
+
+/*
+ * Range [*first, *last) of the intervals between consecutive sorted edges
+ * which overlap [start, end)
+ */
+static void rgz_edge_span(int *edges, int nedges, int start, int end, int *first, int *last)
+{
+    *first = max(rgz_lower_edge(edges, nedges, start + 1) - 1, 0);
+    *last = min(rgz_lower_edge(edges, nedges, end), nedges - 1);
 }
 
 static void rgz_gen_blitregions(rgz_t *rgz, blit_hregion_t *hregion, int screen_width)
@@ -866,7 +890,7 @@ static void rgz_gen_blitregions(rgz_t *rgz, blit_hregion_t *hregion, int screen_
 
     int offsets[RGZ_SUBREGIONMAX];
     int noffsets=0;
-    int l, r;
+    int l, r, d;
 
     /*
      * Add damaged region, then all layers. We are guaranteed to not go outside
@@ -881,21 +905,41 @@ static void rgz_gen_blitregions(rgz_t *rgz, blit_hregion_t *hregion, int screen_
         offsets[noffsets++] = max(0, layer->displayFrame.left);
         offsets[noffsets++] = min(layer->displayFrame.right, screen_width);
     }
-    rgz_bsort(offsets, noffsets);
-    noffsets = rgz_bunique(offsets, noffsets);
+
+    /*
+     * Split on the individual damaged rectangles as long as there is room,
+     * a subregion partially covered by damage is still redrawn as a whole
+     */
+    for (d = 0; rgz->ndamaged > 1 && d < rgz->ndamaged; d++) {
+        blit_rect_t *damage = &rgz->damaged_rects[d];
+        if (noffsets + 2 > RGZ_SUBREGIONMAX)
+            break;
+        if (!RECT_INTERSECTS(*damage, hregion->rect))
+            continue;
+        offsets[noffsets++] = damage->left;
+        offsets[noffsets++] = damage->right;
+    }
+    noffsets = rgz_sort_edges(offsets, noffsets);
     hregion->nsubregions = noffsets - 1;
-    bzero(hregion->blitrects, sizeof(hregion->blitrects));
-    for (r = 0; r + 1 < noffsets; r++) {
-        blit_rect_t subregion;
-        subregion.top = hregion->rect.top;
-        subregion.bottom = hregion->rect.bottom;
-        subregion.left = offsets[r];
-        subregion.right = offsets[r+1];
-
-        ALOGD_IF(debug, "                sub l %d r %d",
-            subregion.left, subregion.right);
-        for (l = 0; l < hregion->nlayers; l++) {
-            hwc_layer_1_t *layer = &hregion->rgz_layers[l]->hwc_layer;
+
+    /*
+     * Every layer in the hregion covers it vertically, so walk each layer
+     * only across the subregions between its left and right edges
+     */
+    for (l = 0; l < hregion->nlayers; l++) {
+        hwc_layer_1_t *layer = &hregion->rgz_layers[l]->hwc_layer;
+        int first, last;
+
+        bzero(hregion->blitrects[l], sizeof(blit_rect_t) * hregion->nsubregions);
+        rgz_edge_span(offsets, noffsets, layer->displayFrame.left,
+            layer->displayFrame.right, &first, &last);
+        for (r = first; r < last; r++) {
+            blit_rect_t subregion;
+            subregion.top = hregion->rect.top;
+            subregion.bottom = hregion->rect.bottom;
+            subregion.left = offsets[r];
+            subregion.right = offsets[r+1];
+
             if (RECT_INTERSECTS(subregion, layer->displayFrame)) {
 
                 hregion->blitrects[l][r] = subregion;
@@ -959,8 +1003,6 @@ static int rgz_in_valid_hwc_layer(hwc_layer_1_t *layer)
 static void rgz_delete_region_data(rgz_t *rgz){
     if (!rgz)
         return;
-    if (rgz->hregions)
-        free(rgz->hregions);
     rgz->hregions = NULL;
     rgz->nhregions = 0;
     rgz->state &= ~RGZ_REGION_DATA;
@@ -977,9 +1019,62 @@ static rgz_fb_state_t* get_next_fb_state(rgz_t *rgz)
     return &rgz->fb_states[rgz->fb_state_idx];
 }
 
-static void rgz_add_to_damaged_area(rgz_in_params_t *params, rgz_layer_t *rgz_layer,
-    blit_rect_t *damaged_area)
+/*
+ * Add a rectangle to the damage list, folding in any rectangle it overlaps or
+ * touches. When the list is full the rectangle is merged with the entry that
+ * grows the least so two small updates far apart (e.g. a cursor and a clock)
+ * don't turn into a redraw of everything in between.
+ */
+static void rgz_add_damaged_rect(rgz_t *rgz, blit_rect_t *rect)
+{
+    blit_rect_t u = *rect;
+    int i = 0;
+
+    while (i < rgz->ndamaged) {
+        blit_rect_t *d = &rgz->damaged_rects[i];
+        if (RECT_TOUCHES(*d, u)) {
+            u.left = min(u.left, d->left);
+            u.top = min(u.top, d->top);
+            u.right = max(u.right, d->right);
+            u.bottom = max(u.bottom, d->bottom);
+            /* Drop the entry and rescan, the union may touch others now */
+            *d = rgz->damaged_rects[--rgz->ndamaged];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+
+    if (rgz->ndamaged == RGZ_MAX_DAMAGE_RECTS) {
+        unsigned int best_growth = ~0U;
+        int best = 0;
+        for (i = 0; i < rgz->ndamaged; i++) {
+            blit_rect_t *d = &rgz->damaged_rects[i];
+            blit_rect_t m;
+            m.left = min(u.left, d->left);
+            m.top = min(u.top, d->top);
+            m.right = max(u.right, d->right);
+            m.bottom = max(u.bottom, d->bottom);
+            unsigned int growth = RECT_AREA(m) - RECT_AREA(*d);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = i;
+            }
+        }
+        blit_rect_t *d = &rgz->damaged_rects[best];
+        u.left = min(u.left, d->left);
+        u.top = min(u.top, d->top);
+        u.right = max(u.right, d->right);
+        u.bottom = max(u.bottom, d->bottom);
+        *d = rgz->damaged_rects[--rgz->ndamaged];
+    }
+
+    rgz->damaged_rects[rgz->ndamaged++] = u;
+}
+
+static void rgz_add_to_damaged_area(rgz_t *rgz, rgz_in_params_t *params, rgz_layer_t *rgz_layer)
 {
+    blit_rect_t *damaged_area = &rgz->damaged_area;
     struct bvsurfgeom *screen_geom = params->data.hwc.dstgeom;
     hwc_layer_1_t *layer = &rgz_layer->hwc_layer;
 
@@ -1000,6 +1095,8 @@ static void rgz_add_to_damaged_area(rgz_in_params_t *params, rgz_layer_t *rgz_la
     layer_rect.right = min(screen_rect.right, layer_rect.right);
     layer_rect.bottom = min(screen_rect.bottom, layer_rect.bottom);
 
+    rgz_add_damaged_rect(rgz, &layer_rect);
+
     /* Then add the rectangle to the damage area */
     if (empty_rect(damaged_area)) {
         /* Adding for the first time */
@@ -1092,6 +1189,7 @@ static void rgz_handle_dirty_region(rgz_t *rgz, rgz_in_params_t *params,
 {
     /* Reset damaged area */
     bzero(&rgz->damaged_area, sizeof(rgz->damaged_area));
+    rgz->ndamaged = 0;
 
     int i;
     rgz_fb_state_t *cur_fb_state = &rgz->cur_fb_state;
@@ -1124,7 +1222,7 @@ static void rgz_handle_dirty_region(rgz_t *rgz, rgz_in_params_t *params,
 
         /* If the layer is new, redraw the layer area */
         if (!prev_rgz_layer) {
-            rgz_add_to_damaged_area(params, cur_rgz_layer, &rgz->damaged_area);
+            rgz_add_to_damaged_area(rgz, params, cur_rgz_layer);
             continue;
         }
 
@@ -1144,13 +1242,13 @@ static void rgz_handle_dirty_region(rgz_t *rgz, rgz_in_params_t *params,
                  * this layer was in the target frame and force to draw the new layer
                  * location.
                  */
-                rgz_add_to_damaged_area(params, cur_rgz_layer, &rgz->damaged_area);
-                rgz_add_to_damaged_area(params, target_rgz_layer, &rgz->damaged_area);
+                rgz_add_to_damaged_area(rgz, params, cur_rgz_layer);
+                rgz_add_to_damaged_area(rgz, params, target_rgz_layer);
                 cur_rgz_layer->dirty_count = RGZ_NUM_FB;
             }
         } else {
             /* If the layer is not in the target just draw it's new location */
-            rgz_add_to_damaged_area(params, cur_rgz_layer, &rgz->damaged_area);
+            rgz_add_to_damaged_area(rgz, params, cur_rgz_layer);
         }
     }
 
@@ -1169,7 +1267,7 @@ static void rgz_handle_dirty_region(rgz_t *rgz, rgz_in_params_t *params,
             continue;
 
         /* The target layer is not present in the current frame, redraw its area */
-        rgz_add_to_damaged_area(params, target_rgz_layer, &rgz->damaged_area);
+        rgz_add_to_damaged_area(rgz, params, target_rgz_layer);
     }
 }
 
@@ -1313,20 +1411,26 @@ static int rgz_in_hwc(rgz_in_params_t *p, rgz_t *rgz)
         yentries[ylen++] = min(layer->displayFrame.bottom, screen_height);
         dispw = dispw > layer->displayFrame.right ? dispw : layer->displayFrame.right;
     }
-    rgz_bsort(yentries, ylen);
-    ylen = rgz_bunique(yentries, ylen);
+
+    /* Add the individual damaged rectangles if they fit, see rgz_gen_blitregions */
+    for (i = 0; rgz->ndamaged > 1 && i < rgz->ndamaged; i++) {
+        if (ylen + 2 > RGZ_SUBREGIONMAX)
+            break;
+        yentries[ylen++] = rgz->damaged_rects[i].top;
+        yentries[ylen++] = rgz->damaged_rects[i].bottom;
+    }
+    ylen = rgz_sort_edges(yentries, ylen);
 
     /* at this point we have an array of horizontal regions */
     rgz->nhregions = ylen - 1;
 
-    blit_hregion_t *hregions = calloc(rgz->nhregions, sizeof(blit_hregion_t));
-    if (!hregions) {
-        OUTE("Unable to allocate memory for hregions");
-        return -1;
-    }
+    /* The region tables are reused from frame to frame */
+    blit_hregion_t *hregions = arena.hregions;
     rgz->hregions = hregions;
+    if (rgz->nhregions > arena.hregions_hwm)
+        arena.hregions_hwm = rgz->nhregions;
 
-    ALOGD_IF(debug, "Allocated %d regions (sz = %d), layerno = %d", rgz->nhregions,
+    ALOGD_IF(debug, "Using %d regions (sz = %d), layerno = %d", rgz->nhregions,
         rgz->nhregions * sizeof(blit_hregion_t), cur_fb_state->rgz_layerno);
 
     for (i = 0; i < rgz->nhregions; i++) {
@@ -1336,8 +1440,19 @@ static int rgz_in_hwc(rgz_in_params_t *p, rgz_t *rgz)
         hregions[i].rect.left = 0;
         hregions[i].rect.right = dispw > screen_width ? screen_width : dispw;
         hregions[i].nlayers = 0;
-        for (j = 0; j < cur_fb_state->rgz_layerno; j++) {
-            hwc_layer_1_t *layer = &cur_fb_state->rgz_layers[j].hwc_layer;
+    }
+
+    /*
+     * Sweep the layers in z-order and add each one only to the hregions
+     * between its top and bottom edges, this keeps the per hregion layer
+     * lists in z-order as well
+     */
+    for (j = 0; j < cur_fb_state->rgz_layerno; j++) {
+        hwc_layer_1_t *layer = &cur_fb_state->rgz_layers[j].hwc_layer;
+        int first, last;
+        rgz_edge_span(yentries, ylen, layer->displayFrame.top,
+            layer->displayFrame.bottom, &first, &last);
+        for (i = first; i < last; i++) {
             if (RECT_INTERSECTS(hregions[i].rect, layer->displayFrame)) {
                 int l = hregions[i].nlayers++;
                 hregions[i].rgz_layers[l] = &cur_fb_state->rgz_layers[j];
@@ -1567,8 +1682,18 @@ static void rgz_batch_entry(struct rgz_blt_entry* e, unsigned int flag, unsigned
     e->bp.batchflags |= set;
 }
 
-static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_params_t *params,
-    blit_rect_t *damaged_area)
+static int rgz_subregion_damaged(rgz_t *rgz, blit_rect_t *subregion_rect)
+{
+    int i;
+    for (i = 0; i < rgz->ndamaged; i++) {
+        if (RECT_INTERSECTS(rgz->damaged_rects[i], *subregion_rect))
+            return 1;
+    }
+    return 0;
+}
+
+static int rgz_hwc_subregion_blit(rgz_t *rgz, blit_hregion_t *hregion, int sidx,
+    rgz_out_params_t *params)
 {
     int lix;
     int ldepth = get_layer_ops(hregion, sidx, &lix);
@@ -1583,7 +1708,7 @@ static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_par
     /* Determine if this region is dirty */
     int dirty = 0;
     blit_rect_t *subregion_rect = &hregion->blitrects[lix][sidx];
-    if (RECT_INTERSECTS(*damaged_area, *subregion_rect)) {
+    if (rgz_subregion_damaged(rgz, subregion_rect)) {
         /* The subregion intersects the damaged area, draw unconditionally */
         dirty = 1;
     } else {
@@ -1598,8 +1723,12 @@ static int rgz_hwc_subregion_blit(blit_hregion_t *hregion, int sidx, rgz_out_par
             dirtylix = get_layer_ops_next(hregion, sidx, dirtylix);
         }
     }
-    if (!dirty)
+    if (!dirty) {
+        /* The target framebuffer already holds this subregion */
+        if (IS_BVCMD(params))
+            params->data.bvc.out_saved_pixels += RECT_AREA(*subregion_rect);
         return 0;
+    }
 
     /* Check if the bottom layer is the background */
     if (hregion->rgz_layers[lix]->buffidx == RGZ_BACKGROUND_BUFFIDX) {
@@ -1742,22 +1871,36 @@ struct bvsurfgeom gscrngeom = {
     .structsize = sizeof(struct bvsurfgeom), .format = OCDFMT_UNKNOWN
 };
 
-static void rgz_blts_init(struct rgz_blts *blts)
+/*
+ * Blits are generated straight into the caller's command buffer when one is
+ * given, so the batch does not need to be copied into the composition data.
+ * Entries are cleared as they are handed out rather than all up front.
+ */
+static void rgz_blts_init(struct rgz_blts *blts, struct rgz_blt_entry *cmdp, int cmdlen)
 {
-    bzero(blts, sizeof(*blts));
+    if (cmdp && cmdlen > 0) {
+        blts->bvcmds = cmdp;
+        blts->max = min(cmdlen, RGZ_MAX_BLITS);
+    } else {
+        blts->bvcmds = arena.bvcmds;
+        blts->max = RGZ_MAX_BLITS;
+    }
+    blts->idx = 0;
 }
 
 static void rgz_blts_free(struct rgz_blts *blts)
 {
-    /* TODO ??? maybe we should dynamically allocate this */
-    rgz_blts_init(blts);
+    rgz_blts_init(blts, NULL, 0);
 }
 
 static struct rgz_blt_entry* rgz_blts_get(struct rgz_blts *blts, rgz_out_params_t *params)
 {
     struct rgz_blt_entry *ne;
-    if (blts->idx < RGZ_MAX_BLITS) {
+    if (blts->idx < blts->max) {
         ne = &blts->bvcmds[blts->idx++];
+        bzero(ne, sizeof(*ne));
+        if (blts->idx > arena.blits_hwm)
+            arena.blits_hwm = blts->idx;
         if (IS_BVCMD(params))
             params->data.bvc.out_blits++;
     } else {
@@ -1797,11 +1940,13 @@ static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
         return -1;
     }
 
-    rgz_blts_init(&blts);
-    ALOGD_IF(debug, "rgz_out_region:");
-
-    if (IS_BVCMD(params))
+    if (IS_BVCMD(params)) {
+        rgz_blts_init(&blts, params->data.bvc.cmdp, params->data.bvc.cmdlen);
         params->data.bvc.out_blits = 0;
+        params->data.bvc.out_saved_pixels = 0;
+    } else
+        rgz_blts_init(&blts, NULL, 0);
+    ALOGD_IF(debug, "rgz_out_region:");
 
     int i;
     for (i = 0; i < rgz->nhregions; i++) {
@@ -1817,7 +1962,7 @@ static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
         }
         for (s = 0; s < hregion->nsubregions; s++) {
             ALOGD_IF(debug, "h[%d] -> [%d]", i, s);
-            if (rgz_hwc_subregion_blit(hregion, s, params, &rgz->damaged_area))
+            if (rgz_hwc_subregion_blit(rgz, hregion, s, params))
                 return -1;
         }
     }
@@ -1848,7 +1993,7 @@ static int rgz_out_region(rgz_t *rgz, rgz_out_params_t *params)
          * composition data structure ourselves */
         params->data.bvc.cmdp = blts.bvcmds;
         params->data.bvc.cmdlen = blts.idx;
-        if (params->data.bvc.out_blits >= RGZ_MAX_BLITS)
+        if (params->data.bvc.out_blits >= blts.max)
             rv = -1;
         //rgz_blts_free(&blts);
     } else {
@@ -1968,12 +2113,16 @@ int rgz_in(rgz_in_params_t *p, rgz_t *rgz)
     return rv;
 }
 
+void rgz_get_arena_usage(int *blits, int *hregions)
+{
+    *blits = arena.blits_hwm;
+    *hregions = arena.hregions_hwm;
+}
+
 void rgz_release(rgz_t *rgz)
 {
     if (!rgz)
         return;
-    if (rgz->hregions)
-        free(rgz->hregions);
     bzero(rgz, sizeof(*rgz));
 }
 
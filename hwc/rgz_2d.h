@@ -34,6 +34,12 @@
 /* Number of framebuffers to track */
 #define RGZ_NUM_FB 2
 
+/*
+ * Maximum number of separate damaged rectangles tracked per frame, further
+ * damage is merged into the closest rectangle
+ */
+#define RGZ_MAX_DAMAGE_RECTS 4
+
 /*
  * Regionizer data
  *
@@ -112,6 +118,12 @@ int rgz_in(rgz_in_params_t *param, rgz_t *rgz);
  */
 void rgz_release(rgz_t *rgz);
 
+/*
+ * Report the high-water mark of the preallocated blit and hregion storage,
+ * the capacities are RGZ_MAX_BLITS and RGZ_SUBREGIONMAX
+ */
+void rgz_get_arena_usage(int *blits, int *hregions);
+
 /*
  * Regionizer output operations
  */
@@ -123,6 +135,7 @@ struct rgz_out_bvcmd {
     buffer_handle_t out_hndls[RGZ_INPUT_MAXLAYERS]; /* OUTPUT */
     int out_nhndls; /* OUTPUT */
     int out_blits; /* OUTPUT */
+    unsigned int out_saved_pixels; /* OUTPUT */
 };
 
 struct rgz_out_svg {
@@ -173,19 +186,26 @@ typedef struct rgz_out_params {
  * rgz_out_params_t:
  *
  * op                   RGZ_OUT_BVCMD_PAINT
- * data.bvc.cmdp        Pointer to buffer with cmd data
- * data.bvc.cmdlen      length of cmdp
+ * data.bvc.cmdp        Pointer to buffer with cmd data. If set on input the
+ *                      blits are generated into this buffer, otherwise an
+ *                      internal buffer is used. Points to the blits on output
+ * data.bvc.cmdlen      length of cmdp, on output the number of blits
  * data.bvc.dstgeom     bltsville struct describing the destination geometry
  * data.bvc.noblend     Test option to disable blending
  * data.bvc.out_hndls   Array of buffer handles (OUTPUT)
  * data.bvc.out_nhndls  Number of buffer handles (OUTPUT)
  * data.bvc.out_blits   Number of blits (OUTPUT)
+ * data.bvc.out_saved_pixels Pixels left untouched in the framebuffer since
+ *                      they are unchanged from the previous composition
+ *                      (OUTPUT, region mode only)
  */
 #define RGZ_OUT_BVCMD_PAINT 1
 
 /*
  * This commands generates bltsville command data structures for HWC which will
- * render via regions. This will involve a complete redraw of the screen.
+ * render via regions. Only the subregions which intersect the damaged
+ * rectangles or contain a layer with new content are redrawn, the rest of the
+ * target framebuffer is reused as is.
  *
  * See RGZ_OUT_BVCMD_PAINT
  */
@@ -300,7 +320,9 @@ struct rgz {
     rgz_fb_state_t cur_fb_state;
     int fb_state_idx; /* Target framebuffer index. Points to the fb where the blits will be applied to */
     rgz_fb_state_t fb_states[RGZ_NUM_FB]; /* Storage for previous framebuffer geometry states */
-    blit_rect_t damaged_area; /* Area of the screen which will be redrawn unconditionally */
+    blit_rect_t damaged_area; /* Bounding box of the damaged rectangles */
+    blit_rect_t damaged_rects[RGZ_MAX_DAMAGE_RECTS]; /* Areas of the screen which will be redrawn unconditionally */
+    int ndamaged;
 };
 
 #endif /* __RGZ_2D__ */
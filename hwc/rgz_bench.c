@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays layer lists recorded by the HWC (see debug.hwc.record) through the
+ * regionizer and reports the time spent in rgz_in/rgz_out and the blits
+ * generated, so composition performance can be compared between builds.
+ *
+ * usage: rgz_bench <recording> [iterations] [region|paint]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <hardware/hwcomposer.h>
+
+#include "hwc_dev.h"
+#include "hwc_record.h"
+
+#define MAX_HANDLES 256
+
+struct frame {
+    struct hwc_record_frame hdr;
+    hwc_layer_1_t layers[MAX_HWC_LAYERS];
+    hwc_layer_extended_t extlayers[MAX_HWC_LAYERS];
+};
+
+static struct {
+    uint64_t id;
+    IMG_native_handle_t handle;
+} handles[MAX_HANDLES];
+static int nhandles;
+
+static struct rgz_blt_entry blts[RGZ_MAX_BLITS];
+
+static int64_t now_ns(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (int64_t)tp.tv_sec * 1000000000 + tp.tv_nsec;
+}
+
+/* The same recorded buffer maps to the same fake handle so dirty tracking works */
+static IMG_native_handle_t *get_handle(struct hwc_record_layer *r)
+{
+    int i;
+
+    if (!r->handle_id)
+        return NULL;
+    for (i = 0; i < nhandles; i++) {
+        if (handles[i].id == r->handle_id)
+            break;
+    }
+    if (i == nhandles) {
+        if (nhandles == MAX_HANDLES)
+            return NULL;
+        nhandles++;
+    }
+    handles[i].id = r->handle_id;
+    handles[i].handle.iFormat = r->format;
+    handles[i].handle.iWidth = r->width;
+    handles[i].handle.iHeight = r->height;
+    handles[i].handle.usage = r->usage;
+    return &handles[i].handle;
+}
+
+static void set_rect(hwc_rect_t *dst, int32_t src[4])
+{
+    dst->left = src[0];
+    dst->top = src[1];
+    dst->right = src[2];
+    dst->bottom = src[3];
+}
+
+static int load_frames(const char *path, struct frame **framesp)
+{
+    FILE *f = fopen(path, "rb");
+    struct hwc_record_header header;
+    struct frame *frames = NULL;
+    int nframes = 0, size = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != HWC_RECORD_MAGIC || header.version != HWC_RECORD_VERSION) {
+        fprintf(stderr, "%s: not a hwc recording\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    for (;;) {
+        struct hwc_record_frame hdr;
+        uint32_t i;
+
+        if (fread(&hdr, sizeof(hdr), 1, f) != 1)
+            break;
+        if (hdr.magic != HWC_RECORD_FRAME_MAGIC || hdr.num_layers > MAX_HWC_LAYERS) {
+            fprintf(stderr, "%s: corrupt frame %d\n", path, nframes);
+            break;
+        }
+        if (nframes == size) {
+            size = size ? size * 2 : 64;
+            frames = realloc(frames, size * sizeof(*frames));
+            if (!frames) {
+                fprintf(stderr, "out of memory\n");
+                nframes = 0;
+                break;
+            }
+        }
+
+        struct frame *fr = &frames[nframes];
+        memset(fr, 0, sizeof(*fr));
+        fr->hdr = hdr;
+        for (i = 0; i < hdr.num_layers; i++) {
+            struct hwc_record_layer r;
+            hwc_layer_1_t *l = &fr->layers[i];
+            if (fread(&r, sizeof(r), 1, f) != 1)
+                break;
+            l->compositionType = r.composition_type;
+            l->hints = r.hints;
+            l->flags = r.flags;
+            l->transform = r.transform;
+            l->blending = r.blending;
+            set_rect(&l->sourceCrop, r.source_crop);
+            set_rect(&l->displayFrame, r.display_frame);
+            l->handle = (buffer_handle_t)get_handle(&r);
+            fr->extlayers[i].idx = i;
+            fr->extlayers[i].identity = r.identity;
+        }
+        if (i != hdr.num_layers)
+            break;
+        nframes++;
+    }
+
+    fclose(f);
+    *framesp = frames;
+    return nframes;
+}
+
+static int cmp_ns(const void *a, const void *b)
+{
+    int64_t d = *(const int64_t *)a - *(const int64_t *)b;
+    return d < 0 ? -1 : d > 0;
+}
+
+static void report(const char *stage, int64_t *samples, int n)
+{
+    if (!n)
+        return;
+    qsort(samples, n, sizeof(*samples), cmp_ns);
+    printf("%-8s p50 %7.1fus  p90 %7.1fus  p99 %7.1fus  max %7.1fus\n", stage,
+           samples[n / 2] / 1000., samples[n * 9 / 10] / 1000.,
+           samples[n * 99 / 100] / 1000., samples[n - 1] / 1000.);
+}
+
+int main(int argc, char **argv)
+{
+    struct frame *frames;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+    int paint = argc > 3 && !strcmp(argv[3], "paint");
+    int i, j, n = 0, failed = 0;
+    long long total_blits = 0;
+    rgz_t rgz;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <recording> [iterations] [region|paint]\n", argv[0]);
+        return 1;
+    }
+
+    int nframes = load_frames(argv[1], &frames);
+    if (nframes <= 0)
+        return 1;
+    if (iterations <= 0)
+        iterations = 1;
+
+    int64_t *in_ns = calloc(nframes * iterations, sizeof(int64_t));
+    int64_t *out_ns = calloc(nframes * iterations, sizeof(int64_t));
+    if (!in_ns || !out_ns) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    memset(&rgz, 0, sizeof(rgz));
+    for (i = 0; i < iterations; i++) {
+        for (j = 0; j < nframes; j++) {
+            struct frame *fr = &frames[j];
+            struct bvsurfgeom geom = {
+                .structsize = sizeof(struct bvsurfgeom),
+                .format = fr->hdr.dst_format,
+                .width = fr->hdr.dst_width,
+                .height = fr->hdr.dst_height,
+                .virtstride = fr->hdr.dst_stride,
+            };
+            rgz_in_params_t in = {
+                .op = paint ? RGZ_IN_HWCCHK : RGZ_IN_HWC,
+                .data = {
+                    .hwc = {
+                        .dstgeom = &geom,
+                        .layers = fr->layers,
+                        .extlayers = fr->extlayers,
+                        .layerno = fr->hdr.num_layers,
+                    }
+                }
+            };
+            rgz_out_params_t out = {
+                .op = paint ? RGZ_OUT_BVCMD_PAINT : RGZ_OUT_BVCMD_REGION,
+                .data = {
+                    .bvc = {
+                        .cmdp = blts,
+                        .cmdlen = RGZ_MAX_BLITS,
+                        .dstgeom = &geom,
+                    }
+                }
+            };
+
+            int64_t t0 = now_ns();
+            if (rgz_in(&in, &rgz) != RGZ_ALL) {
+                rgz_release(&rgz);
+                failed++;
+                continue;
+            }
+            int64_t t1 = now_ns();
+            int rv = rgz_out(&rgz, &out);
+            int64_t t2 = now_ns();
+            if (rv) {
+                rgz_release(&rgz);
+                failed++;
+                continue;
+            }
+
+            in_ns[n] = t1 - t0;
+            out_ns[n] = t2 - t1;
+            total_blits += out.data.bvc.out_blits;
+            n++;
+        }
+    }
+
+    printf("%d frames x %d iterations, %d regionized, %d rejected\n",
+           nframes, iterations, n, failed);
+    report("rgz_in", in_ns, n);
+    report("rgz_out", out_ns, n);
+    if (n)
+        printf("blits    %.1f per frame\n", (double)total_blits / n);
+
+    free(in_ns);
+    free(out_ns);
+    free(frames);
+    return 0;
+}
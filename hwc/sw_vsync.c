@@ -27,6 +27,7 @@
 #include <utils/Timers.h>
 
 #include "hwc_dev.h"
+#include "hwc_trace.h"
 
 static pthread_t vsync_thread;
 static pthread_mutex_t vsync_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -34,53 +35,67 @@ static pthread_cond_t vsync_cond;
 static bool vsync_loop_active = false;
 
 nsecs_t vsync_rate;
+static int vsync_mode_rate;       /* refresh rate of the current display mode, 0 if unknown */
+static nsecs_t vsync_hw_timestamp; /* last hardware vsync timestamp to lock the phase to */
 
-static struct timespec diff(struct timespec start, struct timespec end)
+static nsecs_t now_ns(void)
 {
-    struct timespec temp;
-    if ((end.tv_nsec - start.tv_nsec) < 0) {
-        temp.tv_sec = end.tv_sec-start.tv_sec - 1;
-        temp.tv_nsec = 1000000000 + end.tv_nsec-start.tv_nsec;
-    } else {
-        temp.tv_sec = end.tv_sec - start.tv_sec;
-        temp.tv_nsec = end.tv_nsec - start.tv_nsec;
-    }
-    return temp;
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return ((nsecs_t)tp.tv_sec * 1000000000) + tp.tv_nsec;
+}
+
+/* Sleep until an absolute CLOCK_MONOTONIC time so the wakeups can't drift */
+static void sleep_until(nsecs_t when)
+{
+    struct timespec tp;
+    tp.tv_sec = when / 1000000000;
+    tp.tv_nsec = when % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tp, NULL) == EINTR)
+        ;
 }
 
 static void *vsync_loop(void *data)
 {
-    struct timespec tp, tp_next, tp_sleep;
-    nsecs_t now = 0, period = vsync_rate, next_vsync = 0, next_fake_vsync = 0, sleep = 0;
+    nsecs_t now = 0, period = vsync_rate, phase = 0, next_vsync = 0;
     omap_hwc_device_t *hwc_dev = (omap_hwc_device_t *)data;
-    tp_sleep.tv_sec = tp_sleep.tv_nsec = 0;
-    bool reset_timers = true;
+    bool active;
 
     setpriority(PRIO_PROCESS, 0, HAL_PRIORITY_URGENT_DISPLAY);
 
     for (;;) {
+        /* Don't wake up at all while nobody is listening */
         pthread_mutex_lock(&vsync_mutex);
-        period = vsync_rate; /* re-read rate */
         while (!vsync_loop_active) {
             pthread_cond_wait(&vsync_cond, &vsync_mutex);
         }
+        period = vsync_rate; /* re-read rate */
+        if (vsync_hw_timestamp) {
+            /* Re-lock the phase to the display whenever it tells us */
+            phase = vsync_hw_timestamp;
+            vsync_hw_timestamp = 0;
+        }
         pthread_mutex_unlock(&vsync_mutex);
 
-        clock_gettime(CLOCK_MONOTONIC, &tp);
-        now = (tp.tv_sec * 1000000000) + tp.tv_nsec;
-        next_vsync = next_fake_vsync;
-        sleep = next_vsync - now;
-        if (sleep < 0) {
-            /* we missed, find where the next vsync should be */
-            sleep = (period - ((now - next_vsync) % period));
-            next_vsync = now + sleep;
-        }
-        next_fake_vsync = next_vsync + period;
-        tp_next.tv_sec = (next_vsync / 1000000000);
-        tp_next.tv_nsec = (next_vsync % 1000000000);
-        tp_sleep = diff(tp, tp_next);
+        /*
+         * Next vsync is the first multiple of the period from the phase
+         * reference which is still ahead of us. This also takes care of
+         * missed vsyncs and of period changes without accumulating error.
+         */
+        now = now_ns();
+        if (!phase)
+            phase = now;
+        next_vsync = phase + ((now - phase) / period + 1) * period;
 
-        nanosleep(&tp_sleep, NULL);
+        sleep_until(next_vsync);
+
+        pthread_mutex_lock(&vsync_mutex);
+        active = vsync_loop_active;
+        pthread_mutex_unlock(&vsync_mutex);
+        if (!active)
+            continue;
+
+        hwc_trace(HWC_TRACE_VSYNC, 0, next_vsync);
         if (hwc_dev->procs && hwc_dev->procs->vsync) {
             hwc_dev->procs->vsync(hwc_dev->procs, 0, next_vsync);
         }
@@ -119,7 +134,7 @@ void start_sw_vsync()
     property_get("persist.hwc.sw_vsync_rate", refresh_rate, "60");
 
     pthread_mutex_lock(&vsync_mutex);
-    int rate = atoi(refresh_rate);
+    int rate = vsync_mode_rate ? : atoi(refresh_rate);
     if (rate <= 0)
         rate = 60;
     vsync_rate = 1000000000 / rate;
@@ -143,3 +158,19 @@ void stop_sw_vsync()
     pthread_mutex_unlock(&vsync_mutex);
     pthread_cond_signal(&vsync_cond);
 }
+
+void set_sw_vsync_rate(int refresh)
+{
+    pthread_mutex_lock(&vsync_mutex);
+    vsync_mode_rate = refresh > 0 ? refresh : 0;
+    if (vsync_mode_rate)
+        vsync_rate = 1000000000 / vsync_mode_rate;
+    pthread_mutex_unlock(&vsync_mutex);
+}
+
+void sync_sw_vsync(nsecs_t timestamp)
+{
+    pthread_mutex_lock(&vsync_mutex);
+    vsync_hw_timestamp = timestamp;
+    pthread_mutex_unlock(&vsync_mutex);
+}
@@ -21,5 +21,9 @@ bool use_sw_vsync();
 void init_sw_vsync(omap_hwc_device_t *hwc_dev);
 void start_sw_vsync();
 void stop_sw_vsync();
+/* Use the refresh rate of the current display mode, 0 to go back to the default */
+void set_sw_vsync_rate(int refresh);
+/* Lock the s/w vsync phase to a hardware vsync timestamp */
+void sync_sw_vsync(nsecs_t timestamp);
 
 #endif
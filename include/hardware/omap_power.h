@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2013 Texas Instruments
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_INCLUDE_HARDWARE_OMAP_POWER_H
+#define ANDROID_INCLUDE_HARDWARE_OMAP_POWER_H
+
+#include <hardware/power.h>
+
+/*
+ * Hints understood by the OMAP power HAL on top of the framework's ones,
+ * for vendor code calling power_module_t::powerHint() directly. data is an
+ * int: non zero (or no data) starts the profile, 0 ends it.
+ */
+#define POWER_HINT_OMAP_LAUNCH  ((power_hint_t) 0x100)
+#define POWER_HINT_OMAP_KIOSK   ((power_hint_t) 0x101)
+
+#endif
@@ -44,6 +44,59 @@ int ion_flush_cached(int fd, struct ion_handle *handle, size_t length,
 int ion_inval_cached(int fd, struct ion_handle *handle, size_t length,
             unsigned char *ptr);
 
+/* Cache maintenance on part of a mapping, ptr is where the buffer is mapped */
+struct ion_cache_range {
+        struct ion_handle *handle;
+        unsigned char *ptr;
+        size_t offset;
+        size_t length;
+};
+
+int ion_flush_cached_range(int fd, struct ion_handle *handle,
+            unsigned char *ptr, size_t offset, size_t length);
+int ion_inval_cached_range(int fd, struct ion_handle *handle,
+            unsigned char *ptr, size_t offset, size_t length);
+/* rows of width bytes, stride apart, starting offset bytes into the mapping */
+int ion_flush_cached_2d(int fd, struct ion_handle *handle, unsigned char *ptr,
+            size_t stride, size_t offset, size_t width, size_t rows);
+int ion_inval_cached_2d(int fd, struct ion_handle *handle, unsigned char *ptr,
+            size_t stride, size_t offset, size_t width, size_t rows);
+/* ranges may be in any order and on different handles */
+int ion_flush_cached_ranges(int fd, const struct ion_cache_range *ranges,
+            int count);
+int ion_inval_cached_ranges(int fd, const struct ion_cache_range *ranges,
+            int count);
+
+/*
+ * Allocate count buffers of one geometry. Buffers released with
+ * ion_free_batch() are kept for reuse by the next batch of the same
+ * geometry, flags and heap; ion_cache_flush() (and ion_close()) gives
+ * them back to the kernel. A batch either fully succeeds or allocates
+ * nothing.
+ */
+int ion_alloc_batch(int fd, size_t len, size_t align, unsigned int flags,
+                    struct ion_handle **handles, int count);
+int ion_alloc_tiler_batch(int fd, size_t w, size_t h, int fmt,
+                          unsigned int flags, struct ion_handle **handles,
+                          size_t *stride, int count);
+int ion_free_batch(int fd, struct ion_handle **handles, int count);
+void ion_cache_flush(int fd);
+
+/*
+ * fd-first buffers: the allocation is returned as a shareable fd only.
+ * ion_import_map() imports and maps a shared fd, reusing the handle and
+ * mapping when the same buffer comes back; release with ion_unmap_import()
+ * rather than ion_free()/munmap().
+ */
+int ion_alloc_fd(int fd, size_t len, size_t align, unsigned int flags,
+                 int *share_fd);
+int ion_alloc_tiler_fd(int fd, size_t w, size_t h, int fmt, unsigned int flags,
+                       int *share_fd, size_t *stride);
+int ion_import_map(int fd, int share_fd, size_t length, int prot,
+                   struct ion_handle **handle, unsigned char **ptr);
+int ion_unmap_import(int fd, struct ion_handle *handle, unsigned char *ptr,
+                     size_t length);
+
 __END_DECLS
 
 #endif /* __TI_ION_H */
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FRAME_TRACE_H__
+#define __FRAME_TRACE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cutils/trace.h>
+
+#include "hal_public.h"
+
+/*
+ * Frame timeline shared by the camera HAL and hwc.
+ *
+ * A frame is named after the gralloc buffer carrying it: the kernel stamp
+ * in IMG_native_handle_t is the same in every process the handle is passed
+ * to, so anyone holding the buffer can tag it without passing anything
+ * extra along. Each stage is a zero length systrace slice named
+ *
+ *     frame:<id>:<stage>
+ *
+ * so searching a capture for "frame:<id>" lines up one buffer's trip from
+ * the camera fill through composition to the DSS post, across processes
+ * and trace tags. Ids repeat as buffers are recycled, the order of the
+ * stages tells the frames apart.
+ */
+
+/* camera HAL */
+#define FRAME_TRACE_CAM_FILL    "cam-fill"      /* preview buffer back from Ducati */
+#define FRAME_TRACE_CAM_POST    "cam-post"      /* queued to the preview window */
+/* hwc */
+#define FRAME_TRACE_HWC_OVL     "hwc-ovl"       /* prepare() put it on an overlay */
+#define FRAME_TRACE_HWC_GL      "hwc-gl"        /* prepare() left it to SGX */
+#define FRAME_TRACE_HWC_POST    "hwc-post"      /* handed to DSS by Post2 */
+
+static inline uint32_t frame_trace_id(const IMG_native_handle_t *handle)
+{
+    return handle ? (uint32_t)(handle->ui64Stamp ^ (handle->ui64Stamp >> 32)) : 0;
+}
+
+static inline void frame_trace(uint64_t tag, const char *stage, const IMG_native_handle_t *handle)
+{
+    char name[40];
+
+    if (!handle || !atrace_is_tag_enabled(tag))
+        return;
+
+    snprintf(name, sizeof(name), "frame:%08x:%s", frame_trace_id(handle), stage);
+    atrace_begin(tag, name);
+    atrace_end(tag);
+}
+
+#endif
@@ -19,7 +19,9 @@
  */
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -29,6 +31,9 @@
 
 #include "ion.h"
 
+static void ion_cache_forget(int fd, struct ion_handle *handle);
+static void ion_import_flush(int fd);
+
 int ion_open()
 {
         int fd = open("/dev/ion", O_RDWR);
@@ -39,6 +44,8 @@ int ion_open()
 
 int ion_close(int fd)
 {
+        ion_cache_flush(fd);
+        ion_import_flush(fd);
         return close(fd);
 }
 
@@ -96,7 +103,7 @@ int ion_alloc_tiler(int fd, size_t w, size_t h, int fmt, unsigned int flags,
         return ret;
 }
 
-int ion_free(int fd, struct ion_handle *handle)
+static int ion_free_handle(int fd, struct ion_handle *handle)
 {
         struct ion_handle_data data = {
                 .handle = handle,
@@ -104,6 +111,13 @@ int ion_free(int fd, struct ion_handle *handle)
         return ion_ioctl(fd, ION_IOC_FREE, &data);
 }
 
+int ion_free(int fd, struct ion_handle *handle)
+{
+        /* the handle value may come back from the kernel for another buffer */
+        ion_cache_forget(fd, handle);
+        return ion_free_handle(fd, handle);
+}
+
 int ion_map(int fd, struct ion_handle *handle, size_t length, int prot,
             int flags, off_t offset, unsigned char **ptr, int *map_fd)
 {
@@ -199,3 +213,648 @@ int ion_inval_cached(int fd, struct ion_handle *handle, size_t length,
         };
         return ion_ioctl(fd, ION_IOC_INVAL_CACHED, &data);
 }
+
+/*
+ * Cache maintenance on parts of a buffer. The kernel walks every line of
+ * the range it is given, so sparse regions (TILER rows are far narrower
+ * than their stride) are sent as separate ranges, unless the gap between
+ * two of them is small enough that walking it costs less than another
+ * ioctl. A gap is never invalidated: a merged invalidate is issued as a
+ * flush, which is the same thing for clean lines and keeps dirty CPU
+ * data in the gap.
+ */
+#define ION_CACHE_MERGE_GAP 2048
+
+enum {
+        ION_CACHE_OP_FLUSH,
+        ION_CACHE_OP_INVAL,
+};
+
+static int ion_cache_op(int fd, int op, struct ion_handle *handle,
+                        unsigned char *ptr, size_t length)
+{
+        if (op == ION_CACHE_OP_FLUSH)
+                return ion_flush_cached(fd, handle, length, ptr);
+        return ion_inval_cached(fd, handle, length, ptr);
+}
+
+int ion_flush_cached_range(int fd, struct ion_handle *handle,
+                           unsigned char *ptr, size_t offset, size_t length)
+{
+        return ion_flush_cached(fd, handle, length, ptr + offset);
+}
+
+int ion_inval_cached_range(int fd, struct ion_handle *handle,
+                           unsigned char *ptr, size_t offset, size_t length)
+{
+        return ion_inval_cached(fd, handle, length, ptr + offset);
+}
+
+static int ion_cache_op_2d(int fd, int op, struct ion_handle *handle,
+                           unsigned char *ptr, size_t stride, size_t offset,
+                           size_t width, size_t rows)
+{
+        size_t row;
+        int ret;
+
+        if (!rows || !width)
+                return 0;
+        if (rows == 1 || width >= stride)
+                return ion_cache_op(fd, op, handle, ptr + offset,
+                                    (rows - 1) * stride + width);
+        if (stride - width <= ION_CACHE_MERGE_GAP)
+                return ion_cache_op(fd, ION_CACHE_OP_FLUSH, handle,
+                                    ptr + offset, (rows - 1) * stride + width);
+
+        for (row = 0; row < rows; row++) {
+                ret = ion_cache_op(fd, op, handle, ptr + offset + row * stride,
+                                   width);
+                if (ret < 0)
+                        return ret;
+        }
+        return 0;
+}
+
+int ion_flush_cached_2d(int fd, struct ion_handle *handle, unsigned char *ptr,
+                        size_t stride, size_t offset, size_t width, size_t rows)
+{
+        return ion_cache_op_2d(fd, ION_CACHE_OP_FLUSH, handle, ptr, stride,
+                               offset, width, rows);
+}
+
+int ion_inval_cached_2d(int fd, struct ion_handle *handle, unsigned char *ptr,
+                        size_t stride, size_t offset, size_t width, size_t rows)
+{
+        return ion_cache_op_2d(fd, ION_CACHE_OP_INVAL, handle, ptr, stride,
+                               offset, width, rows);
+}
+
+static int ion_cache_range_cmp(const void *a, const void *b)
+{
+        const struct ion_cache_range *x = a, *y = b;
+        unsigned long xs = (unsigned long)x->ptr + x->offset;
+        unsigned long ys = (unsigned long)y->ptr + y->offset;
+
+        if (x->handle != y->handle)
+                return ((unsigned long)x->handle < (unsigned long)y->handle) ? -1 : 1;
+        return (xs > ys) - (xs < ys);
+}
+
+/*
+ * There is no multi-range ioctl, so the list is sorted and coalesced into
+ * as few ioctls as the gaps allow.
+ */
+static int ion_cache_op_ranges(int fd, int op,
+                               const struct ion_cache_range *ranges, int count)
+{
+        struct ion_cache_range *sorted;
+        unsigned long start, end;
+        int i, span_op, ret = 0;
+
+        if (count <= 0)
+                return 0;
+        if (count == 1)
+                return ion_cache_op(fd, op, ranges[0].handle,
+                                    ranges[0].ptr + ranges[0].offset,
+                                    ranges[0].length);
+
+        sorted = malloc(count * sizeof(*sorted));
+        if (!sorted)
+                return -ENOMEM;
+        memcpy(sorted, ranges, count * sizeof(*sorted));
+        qsort(sorted, count, sizeof(*sorted), ion_cache_range_cmp);
+
+        start = (unsigned long)sorted[0].ptr + sorted[0].offset;
+        end = start + sorted[0].length;
+        span_op = op;
+        for (i = 1; i <= count; i++) {
+                unsigned long s = 0, e = 0;
+
+                if (i < count) {
+                        s = (unsigned long)sorted[i].ptr + sorted[i].offset;
+                        e = s + sorted[i].length;
+                        if (sorted[i].handle == sorted[i - 1].handle &&
+                            s <= end + ION_CACHE_MERGE_GAP) {
+                                if (s > end)
+                                        span_op = ION_CACHE_OP_FLUSH;
+                                if (e > end)
+                                        end = e;
+                                continue;
+                        }
+                }
+
+                ret = ion_cache_op(fd, span_op, sorted[i - 1].handle,
+                                   (unsigned char *)start, end - start);
+                if (ret < 0)
+                        break;
+                start = s;
+                end = e;
+                span_op = op;
+        }
+
+        free(sorted);
+        return ret;
+}
+
+int ion_flush_cached_ranges(int fd, const struct ion_cache_range *ranges,
+                            int count)
+{
+        return ion_cache_op_ranges(fd, ION_CACHE_OP_FLUSH, ranges, count);
+}
+
+int ion_inval_cached_ranges(int fd, const struct ion_cache_range *ranges,
+                            int count)
+{
+        return ion_cache_op_ranges(fd, ION_CACHE_OP_INVAL, ranges, count);
+}
+
+/*
+ * Importer side cache. Share fds are anonymous inodes, so fstat() cannot
+ * tell two buffers apart; the import ioctl can, as it hands back the
+ * client's existing handle when the buffer is already imported. The extra
+ * reference it takes is dropped again and the entry's mapping is reused.
+ * Entries stay mapped for a while after their last user is gone, so a
+ * buffer cycling between two processes is mapped only once; the mapping
+ * holds the buffer, so its handle cannot be recycled while cached.
+ */
+#define ION_IMPORT_ENTRIES      32
+#define ION_IMPORT_MAX_IDLE     8
+
+struct ion_import_entry {
+        int fd;                 /* -1 when the slot is unused */
+        struct ion_handle *handle;
+        unsigned char *ptr;
+        size_t length;
+        int prot;
+        int refs;
+        unsigned int age;       /* when it went idle, for eviction */
+};
+
+static struct ion_import_entry ion_imports[ION_IMPORT_ENTRIES];
+static unsigned int ion_import_clock;
+
+/*
+ * Handles allocated through the batch calls are remembered with their
+ * geometry, and ion_free_batch() parks them instead of freeing them so the
+ * next batch of the same geometry is served without an ioctl. Parked
+ * buffers keep whatever they last held. Handles belong to one ion client,
+ * so entries are keyed by fd and dropped by ion_close().
+ */
+#define ION_CACHE_ENTRIES       64
+#define ION_CACHE_MAX_PARKED    16
+#define ION_CACHE_MAX_BYTES     (32 * 1024 * 1024)
+
+struct ion_cache_entry {
+        int fd;                 /* -1 when the slot is unused */
+        int tiler;
+        size_t w;               /* len for linear buffers */
+        size_t h;               /* align for linear buffers */
+        int fmt;
+        unsigned int flags;
+        size_t stride;
+        size_t bytes;
+        struct ion_handle *handle;
+        int parked;
+        unsigned int age;       /* when it was parked, for eviction */
+};
+
+static pthread_mutex_t ion_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ion_cache_entry ion_cache[ION_CACHE_ENTRIES];
+static int ion_cache_ready;
+static unsigned int ion_cache_clock;
+static int ion_cache_parked;
+static size_t ion_cache_parked_bytes;
+
+/* must be called with ion_cache_lock held */
+static void ion_cache_init(void)
+{
+        int i;
+
+        if (ion_cache_ready)
+                return;
+        for (i = 0; i < ION_CACHE_ENTRIES; i++)
+                ion_cache[i].fd = -1;
+        for (i = 0; i < ION_IMPORT_ENTRIES; i++)
+                ion_imports[i].fd = -1;
+        ion_cache_ready = 1;
+}
+
+/* must be called with ion_cache_lock held */
+static struct ion_handle *ion_cache_take(int fd, int tiler, size_t w, size_t h,
+                                         int fmt, unsigned int flags,
+                                         size_t *stride)
+{
+        int i;
+
+        for (i = 0; i < ION_CACHE_ENTRIES; i++) {
+                struct ion_cache_entry *e = &ion_cache[i];
+
+                if (e->fd != fd || !e->parked || e->tiler != tiler ||
+                    e->w != w || e->h != h || e->fmt != fmt || e->flags != flags)
+                        continue;
+                e->parked = 0;
+                ion_cache_parked--;
+                ion_cache_parked_bytes -= e->bytes;
+                if (stride)
+                        *stride = e->stride;
+                return e->handle;
+        }
+        return NULL;
+}
+
+/* must be called with ion_cache_lock held, returns 0 if there was no room */
+static int ion_cache_track(int fd, int tiler, size_t w, size_t h, int fmt,
+                           unsigned int flags, size_t stride,
+                           struct ion_handle *handle)
+{
+        int i;
+
+        for (i = 0; i < ION_CACHE_ENTRIES; i++) {
+                struct ion_cache_entry *e = &ion_cache[i];
+
+                if (e->fd >= 0)
+                        continue;
+                e->fd = fd;
+                e->tiler = tiler;
+                e->w = w;
+                e->h = h;
+                e->fmt = fmt;
+                e->flags = flags;
+                e->stride = stride;
+                e->bytes = tiler ? stride * h : w;
+                e->handle = handle;
+                e->parked = 0;
+                return 1;
+        }
+        return 0;
+}
+
+/* must be called with ion_cache_lock held */
+static void ion_cache_release(struct ion_cache_entry *e)
+{
+        if (e->parked) {
+                ion_cache_parked--;
+                ion_cache_parked_bytes -= e->bytes;
+        }
+        e->fd = -1;
+        e->handle = NULL;
+        e->parked = 0;
+}
+
+/* must be called with ion_cache_lock held */
+static void ion_cache_evict(void)
+{
+        while (ion_cache_parked > ION_CACHE_MAX_PARKED ||
+               ion_cache_parked_bytes > ION_CACHE_MAX_BYTES) {
+                struct ion_cache_entry *oldest = NULL;
+                int i;
+
+                for (i = 0; i < ION_CACHE_ENTRIES; i++) {
+                        struct ion_cache_entry *e = &ion_cache[i];
+
+                        if (e->fd >= 0 && e->parked &&
+                            (!oldest || (int)(e->age - oldest->age) < 0))
+                                oldest = e;
+                }
+                if (!oldest)
+                        break;
+                ion_free_handle(oldest->fd, oldest->handle);
+                ion_cache_release(oldest);
+        }
+}
+
+static int ion_alloc_batch_common(int fd, int tiler, size_t w, size_t h,
+                                  int fmt, unsigned int flags,
+                                  struct ion_handle **handles, size_t *stride,
+                                  int count)
+{
+        int i, ret = 0;
+        size_t s = 0;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < count; i++) {
+                handles[i] = ion_cache_take(fd, tiler, w, h, fmt, flags, &s);
+                if (handles[i])
+                        continue;
+
+                if (tiler)
+                        ret = ion_alloc_tiler(fd, w, h, fmt, flags, &handles[i], &s);
+                else
+                        ret = ion_alloc(fd, w, h, flags, &handles[i]);
+                if (ret < 0)
+                        break;
+                if (!ion_cache_track(fd, tiler, w, h, fmt, flags, s, handles[i]))
+                        ALOGW("ion cache full, handle %p won't be recycled\n",
+                              handles[i]);
+        }
+
+        if (ret < 0) {
+                /*
+                 * all or nothing: whatever was obtained is freed, parking it
+                 * would keep buffers alive that the caller never got
+                 */
+                for (; i >= 0; i--) {
+                        int j;
+
+                        if (!handles[i])
+                                continue;
+                        for (j = 0; j < ION_CACHE_ENTRIES; j++) {
+                                if (ion_cache[j].fd == fd &&
+                                    ion_cache[j].handle == handles[i]) {
+                                        ion_cache_release(&ion_cache[j]);
+                                        break;
+                                }
+                        }
+                        ion_free_handle(fd, handles[i]);
+                        handles[i] = NULL;
+                }
+                pthread_mutex_unlock(&ion_cache_lock);
+                return ret;
+        }
+        pthread_mutex_unlock(&ion_cache_lock);
+
+        if (stride)
+                *stride = s;
+        return 0;
+}
+
+int ion_alloc_batch(int fd, size_t len, size_t align, unsigned int flags,
+                    struct ion_handle **handles, int count)
+{
+        return ion_alloc_batch_common(fd, 0, len, align, 0, flags, handles,
+                                      NULL, count);
+}
+
+int ion_alloc_tiler_batch(int fd, size_t w, size_t h, int fmt,
+                          unsigned int flags, struct ion_handle **handles,
+                          size_t *stride, int count)
+{
+        return ion_alloc_batch_common(fd, 1, w, h, fmt, flags, handles,
+                                      stride, count);
+}
+
+int ion_free_batch(int fd, struct ion_handle **handles, int count)
+{
+        int i, j, ret = 0;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < count; i++) {
+                struct ion_cache_entry *e = NULL;
+
+                if (!handles[i])
+                        continue;
+                for (j = 0; j < ION_CACHE_ENTRIES; j++) {
+                        if (ion_cache[j].fd == fd &&
+                            ion_cache[j].handle == handles[i]) {
+                                e = &ion_cache[j];
+                                break;
+                        }
+                }
+                if (!e || e->parked) {
+                        /* not from a batch call, or freed twice */
+                        int err = e ? -EINVAL : ion_free_handle(fd, handles[i]);
+                        if (err < 0)
+                                ret = err;
+                        continue;
+                }
+                e->parked = 1;
+                e->age = ion_cache_clock++;
+                ion_cache_parked++;
+                ion_cache_parked_bytes += e->bytes;
+        }
+        ion_cache_evict();
+        pthread_mutex_unlock(&ion_cache_lock);
+
+        return ret;
+}
+
+void ion_cache_flush(int fd)
+{
+        int i;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < ION_CACHE_ENTRIES; i++) {
+                struct ion_cache_entry *e = &ion_cache[i];
+
+                if (e->fd != fd)
+                        continue;
+                if (e->parked)
+                        ion_free_handle(fd, e->handle);
+                ion_cache_release(e);
+        }
+        pthread_mutex_unlock(&ion_cache_lock);
+}
+
+static void ion_cache_forget(int fd, struct ion_handle *handle)
+{
+        int i;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < ION_CACHE_ENTRIES; i++) {
+                if (ion_cache[i].fd == fd && ion_cache[i].handle == handle) {
+                        ion_cache_release(&ion_cache[i]);
+                        break;
+                }
+        }
+        pthread_mutex_unlock(&ion_cache_lock);
+}
+
+/*
+ * fd-first buffers: the shared fd is the buffer and the allocating
+ * client drops its handle straight away, so handing a buffer to another
+ * process is just passing the fd.
+ */
+int ion_alloc_fd(int fd, size_t len, size_t align, unsigned int flags,
+                 int *share_fd)
+{
+        struct ion_handle *handle;
+        int ret;
+
+        ret = ion_alloc(fd, len, align, flags, &handle);
+        if (ret < 0)
+                return ret;
+        ret = ion_share(fd, handle, share_fd);
+        ion_free_handle(fd, handle);
+        return ret;
+}
+
+int ion_alloc_tiler_fd(int fd, size_t w, size_t h, int fmt, unsigned int flags,
+                       int *share_fd, size_t *stride)
+{
+        struct ion_handle *handle;
+        int ret;
+
+        ret = ion_alloc_tiler(fd, w, h, fmt, flags, &handle, stride);
+        if (ret < 0)
+                return ret;
+        ret = ion_share(fd, handle, share_fd);
+        ion_free_handle(fd, handle);
+        return ret;
+}
+
+
+/* must be called with ion_cache_lock held */
+static void ion_import_release(struct ion_import_entry *e)
+{
+        munmap(e->ptr, e->length);
+        ion_free_handle(e->fd, e->handle);
+        e->fd = -1;
+}
+
+/* must be called with ion_cache_lock held */
+static void ion_import_evict(void)
+{
+        struct ion_import_entry *oldest;
+        int i, idle;
+
+        for (;;) {
+                oldest = NULL;
+                idle = 0;
+                for (i = 0; i < ION_IMPORT_ENTRIES; i++) {
+                        struct ion_import_entry *e = &ion_imports[i];
+
+                        if (e->fd < 0 || e->refs)
+                                continue;
+                        idle++;
+                        if (!oldest || (int)(e->age - oldest->age) < 0)
+                                oldest = e;
+                }
+                if (idle <= ION_IMPORT_MAX_IDLE)
+                        return;
+                ion_import_release(oldest);
+        }
+}
+
+int ion_import_map(int fd, int share_fd, size_t length, int prot,
+                   struct ion_handle **handle, unsigned char **ptr)
+{
+        struct ion_import_entry *e, *slot = NULL, *idle = NULL;
+        struct ion_handle *h;
+        unsigned char *p;
+        int i, ret;
+
+        ret = ion_import(fd, share_fd, &h);
+        if (ret < 0)
+                return ret;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < ION_IMPORT_ENTRIES; i++) {
+                e = &ion_imports[i];
+                if (e->fd == fd && e->handle == h)
+                        break;
+        }
+
+        if (i < ION_IMPORT_ENTRIES) {
+                /* the import took another reference on the same handle */
+                ion_free_handle(fd, h);
+                if (length <= e->length && !(prot & ~e->prot)) {
+                        e->refs++;
+                        *handle = h;
+                        *ptr = e->ptr;
+                        pthread_mutex_unlock(&ion_cache_lock);
+                        return 0;
+                }
+                if (e->refs) {
+                        pthread_mutex_unlock(&ion_cache_lock);
+                        ALOGE("import of %p already mapped with another "
+                              "length or protection\n", h);
+                        return -EBUSY;
+                }
+                /* idle and too small, map it again below */
+                munmap(e->ptr, e->length);
+                e->fd = -1;
+        }
+
+        p = mmap(NULL, length, prot, MAP_SHARED, share_fd, 0);
+        if (p == MAP_FAILED) {
+                ret = -errno;
+                pthread_mutex_unlock(&ion_cache_lock);
+                ALOGE("mmap failed: %s\n", strerror(-ret));
+                ion_free_handle(fd, h);
+                return ret;
+        }
+
+        for (i = 0; i < ION_IMPORT_ENTRIES; i++) {
+                e = &ion_imports[i];
+                if (e->fd < 0) {
+                        slot = e;
+                        break;
+                }
+                if (!e->refs && (!idle || (int)(e->age - idle->age) < 0))
+                        idle = e;
+        }
+        if (!slot && idle) {
+                ion_import_release(idle);
+                slot = idle;
+        }
+
+        if (slot) {
+                slot->fd = fd;
+                slot->handle = h;
+                slot->ptr = p;
+                slot->length = length;
+                slot->prot = prot;
+                slot->refs = 1;
+        } else {
+                ALOGW("import cache full, %p is not cached\n", h);
+        }
+        pthread_mutex_unlock(&ion_cache_lock);
+
+        *handle = h;
+        *ptr = p;
+        return 0;
+}
+
+int ion_unmap_import(int fd, struct ion_handle *handle, unsigned char *ptr,
+                     size_t length)
+{
+        int i;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < ION_IMPORT_ENTRIES; i++) {
+                struct ion_import_entry *e = &ion_imports[i];
+
+                if (e->fd != fd || e->handle != handle)
+                        continue;
+                if (e->refs && !--e->refs) {
+                        e->age = ion_import_clock++;
+                        ion_import_evict();
+                }
+                pthread_mutex_unlock(&ion_cache_lock);
+                return 0;
+        }
+        pthread_mutex_unlock(&ion_cache_lock);
+
+        /* not cached, undo ion_import_map() directly */
+        munmap(ptr, length);
+        return ion_free_handle(fd, handle);
+}
+
+static void ion_import_flush(int fd)
+{
+        int i;
+
+        pthread_mutex_lock(&ion_cache_lock);
+        ion_cache_init();
+        for (i = 0; i < ION_IMPORT_ENTRIES; i++) {
+                struct ion_import_entry *e = &ion_imports[i];
+
+                if (e->fd != fd)
+                        continue;
+                if (e->refs) {
+                        /* still in use, the mapping stays with its user */
+                        ALOGW("closing client with %p still imported\n",
+                              e->handle);
+                        e->fd = -1;
+                        continue;
+                }
+                ion_import_release(e);
+        }
+        pthread_mutex_unlock(&ion_cache_lock);
+}
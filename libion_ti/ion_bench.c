@@ -0,0 +1,529 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark for the ION Memory Allocator module
+ *
+ * latency : alloc/map/share/free latency percentiles for a linear heap
+ *           and every TILER_PIXEL_FMT_* container
+ * storm   : the same allocator hammered from several threads with a mix
+ *           of camera, video and hwc buffer geometries
+ * frag    : allocation churn over time, probing after each interval how
+ *           tall a buffer of a given width the TILER 8-bit container still
+ *           takes
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ion.h"
+
+#define MAX_THREADS 16
+#define STORM_LIVE_BUFFERS 8
+#define FRAG_LIVE_BUFFERS 64
+#define FRAG_PROBE_MAX_HEIGHT 8192
+
+size_t len = 1024*1024, align = 0;
+int alloc_flags = 0;
+size_t width = 1920, height = 1080;
+int iterations = 200;
+int threads = 4;
+int frag_seconds = 30;
+int frag_interval = 1;
+size_t probe_width = 1920;
+
+struct geometry {
+	const char *name;
+	int tiler;
+	size_t w, h;
+	int fmt;
+};
+
+static const char *fmt_names[] = { "8bit", "16bit", "32bit", "page" };
+
+/* what the camera, video decoder and hwc actually ask for */
+static const struct geometry storm_mix[] = {
+	{ "1080p Y",        1, 1920, 1080, TILER_PIXEL_FMT_8BIT },
+	{ "1080p UV",       1,  960,  540, TILER_PIXEL_FMT_16BIT },
+	{ "720p Y",         1, 1280,  720, TILER_PIXEL_FMT_8BIT },
+	{ "720p UV",        1,  640,  360, TILER_PIXEL_FMT_16BIT },
+	{ "fb 32bit",       1, 1280,  800, TILER_PIXEL_FMT_32BIT },
+	{ "jpeg 2MB",       1, 2*1024*1024, 1, TILER_PIXEL_FMT_PAGE },
+	{ "metadata 64KB",  0, 64*1024, 0, 0 },
+};
+#define STORM_MIX_SIZE (sizeof(storm_mix) / sizeof(storm_mix[0]))
+
+struct latency {
+	unsigned int count;
+	unsigned int size;
+	unsigned int *us;
+	unsigned int failures;
+};
+
+static int64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void latency_add(struct latency *l, int64_t us)
+{
+	if (l->count == l->size) {
+		unsigned int size = l->size ? l->size * 2 : 256;
+		unsigned int *p = realloc(l->us, size * sizeof(*p));
+
+		if (!p)
+			return;
+		l->us = p;
+		l->size = size;
+	}
+	l->us[l->count++] = (unsigned int)us;
+}
+
+static void latency_merge(struct latency *dst, const struct latency *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < src->count; i++)
+		latency_add(dst, src->us[i]);
+	dst->failures += src->failures;
+}
+
+static void latency_free(struct latency *l)
+{
+	free(l->us);
+	memset(l, 0, sizeof(*l));
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void latency_report(const char *config, const char *op,
+			   struct latency *l)
+{
+	unsigned int n = l->count;
+
+	if (!n) {
+		printf("%-22s %-6s no samples, %u failures\n", config, op,
+		       l->failures);
+		return;
+	}
+
+	qsort(l->us, n, sizeof(*l->us), cmp_uint);
+	printf("%-22s %-6s n %5u  min %6u  p50 %6u  p90 %6u  p99 %6u  "
+	       "max %6u us  fail %u\n", config, op, n, l->us[0],
+	       l->us[n / 2], l->us[n * 90 / 100], l->us[n * 99 / 100],
+	       l->us[n - 1], l->failures);
+}
+
+static int alloc_geometry(int fd, const struct geometry *g,
+			  struct ion_handle **handle, size_t *bytes)
+{
+	size_t stride;
+	int ret;
+
+	if (g->tiler) {
+		ret = ion_alloc_tiler(fd, g->w, g->h, g->fmt, alloc_flags,
+				      handle, &stride);
+		*bytes = stride * g->h;
+	} else {
+		ret = ion_alloc(fd, g->w, align, alloc_flags, handle);
+		*bytes = g->w;
+	}
+	return ret;
+}
+
+/*
+ * Latency of each step of a buffer's life, one geometry at a time so
+ * the heaps don't interfere with each other.
+ */
+static void latency_test_geometry(int fd, const struct geometry *g)
+{
+	struct latency alloc = { 0 }, map = { 0 }, share = { 0 }, fr = { 0 };
+	int i;
+
+	for (i = 0; i < iterations; i++) {
+		struct ion_handle *handle;
+		unsigned char *ptr;
+		size_t bytes;
+		int map_fd, share_fd;
+		int64_t t;
+
+		t = now_us();
+		if (alloc_geometry(fd, g, &handle, &bytes)) {
+			alloc.failures++;
+			continue;
+		}
+		latency_add(&alloc, now_us() - t);
+
+		t = now_us();
+		if (ion_map(fd, handle, bytes, PROT_READ | PROT_WRITE,
+			    MAP_SHARED, 0, &ptr, &map_fd) == 0) {
+			munmap(ptr, bytes);
+			close(map_fd);
+			latency_add(&map, now_us() - t);
+		} else
+			map.failures++;
+
+		t = now_us();
+		if (ion_share(fd, handle, &share_fd) == 0) {
+			close(share_fd);
+			latency_add(&share, now_us() - t);
+		} else
+			share.failures++;
+
+		t = now_us();
+		if (ion_free(fd, handle) == 0)
+			latency_add(&fr, now_us() - t);
+		else
+			fr.failures++;
+	}
+
+	latency_report(g->name, "alloc", &alloc);
+	latency_report(g->name, "map", &map);
+	latency_report(g->name, "share", &share);
+	latency_report(g->name, "free", &fr);
+
+	latency_free(&alloc);
+	latency_free(&map);
+	latency_free(&share);
+	latency_free(&fr);
+}
+
+static int latency_test(void)
+{
+	struct geometry g;
+	char names[TILER_PIXEL_FMT_MAX + 1][32];
+	int fd, fmt;
+
+	fd = ion_open();
+	if (fd < 0)
+		return fd;
+
+	printf("\n== latency, %d iterations per config ==\n", iterations);
+
+	g.name = "linear";
+	g.tiler = 0;
+	g.w = len;
+	g.h = 0;
+	g.fmt = 0;
+	latency_test_geometry(fd, &g);
+
+	for (fmt = TILER_PIXEL_FMT_MIN; fmt <= TILER_PIXEL_FMT_MAX; fmt++) {
+		g.tiler = 1;
+		g.fmt = fmt;
+		if (fmt == TILER_PIXEL_FMT_PAGE) {
+			/* 1D: width is the size in bytes */
+			g.w = len;
+			g.h = 1;
+			snprintf(names[fmt], sizeof(names[fmt]), "tiler %s %u",
+				 fmt_names[fmt], len);
+		} else {
+			g.w = width;
+			g.h = height;
+			snprintf(names[fmt], sizeof(names[fmt]), "tiler %s %ux%u",
+				 fmt_names[fmt], width, height);
+		}
+		g.name = names[fmt];
+		latency_test_geometry(fd, &g);
+	}
+
+	ion_close(fd);
+	return 0;
+}
+
+struct storm_thread {
+	pthread_t thread;
+	unsigned int seed;
+	struct latency alloc;
+	struct latency fr;
+};
+
+/* Keeps up to STORM_LIVE_BUFFERS buffers, randomly allocating or freeing */
+static void *storm_thread_loop(void *arg)
+{
+	struct storm_thread *st = arg;
+	struct ion_handle *live[STORM_LIVE_BUFFERS] = { NULL };
+	int fd, i, slot;
+
+	fd = ion_open();
+	if (fd < 0)
+		return NULL;
+
+	for (i = 0; i < iterations; i++) {
+		int64_t t;
+
+		slot = rand_r(&st->seed) % STORM_LIVE_BUFFERS;
+		t = now_us();
+		if (live[slot]) {
+			if (ion_free(fd, live[slot]) == 0)
+				latency_add(&st->fr, now_us() - t);
+			else
+				st->fr.failures++;
+			live[slot] = NULL;
+		} else {
+			const struct geometry *g =
+				&storm_mix[rand_r(&st->seed) % STORM_MIX_SIZE];
+			size_t bytes;
+
+			if (alloc_geometry(fd, g, &live[slot], &bytes) == 0)
+				latency_add(&st->alloc, now_us() - t);
+			else {
+				st->alloc.failures++;
+				live[slot] = NULL;
+			}
+		}
+	}
+
+	for (slot = 0; slot < STORM_LIVE_BUFFERS; slot++)
+		if (live[slot])
+			ion_free(fd, live[slot]);
+	ion_close(fd);
+	return NULL;
+}
+
+static int storm_test(void)
+{
+	struct storm_thread st[MAX_THREADS];
+	struct latency alloc = { 0 }, fr = { 0 };
+	char name[32];
+	int64_t t;
+	int i;
+
+	memset(st, 0, sizeof(st));
+	printf("\n== storm, %d threads x %d operations ==\n", threads,
+	       iterations);
+
+	t = now_us();
+	for (i = 0; i < threads; i++) {
+		st[i].seed = i + 1;
+		if (pthread_create(&st[i].thread, NULL, storm_thread_loop,
+				   &st[i])) {
+			printf("%s(): FAILED to create thread %d\n", __func__, i);
+			threads = i;
+			break;
+		}
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join(st[i].thread, NULL);
+		latency_merge(&alloc, &st[i].alloc);
+		latency_merge(&fr, &st[i].fr);
+		latency_free(&st[i].alloc);
+		latency_free(&st[i].fr);
+	}
+	t = now_us() - t;
+
+	snprintf(name, sizeof(name), "mix x%d threads", threads);
+	latency_report(name, "alloc", &alloc);
+	latency_report(name, "free", &fr);
+	printf("%-22s %u ops/s\n", name, t ?
+	       (unsigned int)((alloc.count + fr.count) * 1000000LL / t) : 0);
+
+	latency_free(&alloc);
+	latency_free(&fr);
+	return 0;
+}
+
+/* Tallest probe_width x h 8-bit TILER buffer that currently fits */
+static size_t frag_probe(int fd)
+{
+	size_t lo = 0, hi = FRAG_PROBE_MAX_HEIGHT;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi + 1) / 2;
+		struct ion_handle *handle;
+		size_t stride;
+
+		if (ion_alloc_tiler(fd, probe_width, mid, TILER_PIXEL_FMT_8BIT,
+				    alloc_flags, &handle, &stride) == 0) {
+			ion_free(fd, handle);
+			lo = mid;
+		} else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+static int frag_test(void)
+{
+	struct ion_handle *live[FRAG_LIVE_BUFFERS] = { NULL };
+	size_t live_bytes[FRAG_LIVE_BUFFERS];
+	size_t held = 0, baseline;
+	unsigned int seed = 1, failures = 0;
+	int64_t start, next;
+	int fd, slot, nlive = 0;
+
+	fd = ion_open();
+	if (fd < 0)
+		return fd;
+
+	baseline = frag_probe(fd);
+	printf("\n== fragmentation, %ds churn, %u-wide 8bit probe ==\n",
+	       frag_seconds, probe_width);
+	printf("%6s %6s %10s %8s %6s %8s\n", "t(s)", "live", "held(KB)",
+	       "probe", "%base", "failures");
+	printf("%6d %6d %10u %8u %6u %8u\n", 0, 0, 0, baseline, 100, 0);
+
+	start = now_us();
+	next = start + frag_interval * 1000000LL;
+	while (now_us() - start < frag_seconds * 1000000LL) {
+		slot = rand_r(&seed) % FRAG_LIVE_BUFFERS;
+		if (live[slot]) {
+			ion_free(fd, live[slot]);
+			live[slot] = NULL;
+			held -= live_bytes[slot];
+			nlive--;
+		} else {
+			const struct geometry *g =
+				&storm_mix[rand_r(&seed) % STORM_MIX_SIZE];
+
+			if (alloc_geometry(fd, g, &live[slot], &live_bytes[slot]) == 0) {
+				held += live_bytes[slot];
+				nlive++;
+			} else {
+				live[slot] = NULL;
+				failures++;
+			}
+		}
+
+		if (now_us() >= next) {
+			size_t probe = frag_probe(fd);
+
+			printf("%6lld %6d %10u %8u %6u %8u\n",
+			       (long long)((now_us() - start) / 1000000), nlive,
+			       held / 1024, probe,
+			       baseline ? probe * 100 / baseline : 0, failures);
+			next += frag_interval * 1000000LL;
+		}
+	}
+
+	for (slot = 0; slot < FRAG_LIVE_BUFFERS; slot++)
+		if (live[slot])
+			ion_free(fd, live[slot]);
+	printf("after release: probe %u (baseline %u)\n", frag_probe(fd),
+	       baseline);
+
+	ion_close(fd);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	int c;
+	int run_latency = 0, run_storm = 0, run_frag = 0;
+
+	while (1) {
+		static struct option opts[] = {
+			{"latency", no_argument, 0, 'L'},
+			{"storm", no_argument, 0, 'S'},
+			{"frag", required_argument, 0, 'F'},
+			{"alloc_flags", required_argument, 0, 'f'},
+			{"len", required_argument, 0, 'l'},
+			{"align", required_argument, 0, 'g'},
+			{"width", required_argument, 0, 'w'},
+			{"height", required_argument, 0, 'h'},
+			{"iteration", required_argument, 0, 'i'},
+			{"threads", required_argument, 0, 'j'},
+			{"interval", required_argument, 0, 'I'},
+			{"probe_width", required_argument, 0, 'P'},
+			{0, 0, 0, 0},
+		};
+		int i = 0;
+		c = getopt_long(argc, argv, "LSF:f:l:g:w:h:i:j:I:P:", opts, &i);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'L':
+			run_latency = 1;
+			break;
+		case 'S':
+			run_storm = 1;
+			break;
+		case 'F':
+			run_frag = 1;
+			frag_seconds = atoi(optarg);
+			break;
+		case 'f':
+			alloc_flags = atol(optarg);
+			break;
+		case 'l':
+			len = atol(optarg);
+			break;
+		case 'g':
+			align = atol(optarg);
+			break;
+		case 'w':
+			width = atol(optarg);
+			break;
+		case 'h':
+			height = atol(optarg);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			if (threads < 1)
+				threads = 1;
+			if (threads > MAX_THREADS)
+				threads = MAX_THREADS;
+			break;
+		case 'I':
+			frag_interval = atoi(optarg);
+			if (frag_interval < 1)
+				frag_interval = 1;
+			break;
+		case 'P':
+			probe_width = atol(optarg);
+			break;
+		}
+	}
+
+	if (!run_latency && !run_storm && !run_frag) {
+		printf("usage: %s [--latency] [--storm] [--frag <seconds>]\n"
+		       "  [--iteration n] [--threads n] [--len bytes] [--align n]\n"
+		       "  [--width w] [--height h] [--alloc_flags heap_mask]\n"
+		       "  [--interval s] [--probe_width w]\n", argv[0]);
+		return 1;
+	}
+
+	printf("len %u, width %u, height %u, align %u, alloc_flags %d\n",
+	       len, width, height, align, alloc_flags);
+
+	if (run_latency)
+		latency_test();
+	if (run_storm)
+		storm_test();
+	if (run_frag)
+		frag_test();
+
+	return 0;
+}
@@ -14,34 +14,108 @@
  * limitations under the License.
  */
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #define LOG_TAG "TI OMAP PowerHAL"
 #include <utils/Log.h>
 
 #include <hardware/hardware.h>
 #include <hardware/power.h>
+#include <hardware/omap_power.h>
 
 #define CPUFREQ_INTERACTIVE "/sys/devices/system/cpu/cpufreq/interactive/"
 #define CPUFREQ_CPU0 "/sys/devices/system/cpu/cpu0/cpufreq/"
 #define BOOSTPULSE_PATH (CPUFREQ_INTERACTIVE "boostpulse")
+#define BOOSTPULSE_DURATION_PATH (CPUFREQ_INTERACTIVE "boostpulse_duration")
+#define CPU_ONLINE_PATH "/sys/devices/system/cpu/cpu%d/online"
+#define SGXFREQ "/sys/devices/platform/omap/pvrsrvkm.0/sgxfreq/"
+#define SGXFREQ_GOVERNOR_PATH (SGXFREQ "governor")
+#define SGXFREQ_BOOST_PATH (SGXFREQ "boost_pulse")
+#define SGX_BOOST_DEFAULT_MS 100
+#define POWER_CONFIG_PATH "/system/etc/power_profiles.conf"
 
 #define MAX_FREQ_NUMBER 10
 #define NOM_FREQ_INDEX 2
+#define MAX_CPUS 4
+#define MAX_TUNABLES 16
+#define MAX_SYSFS_NODES 8
+
+/*
+ * Interactive governor tunables written at init, the [governor] section of
+ * the config file overrides or adds to these. "nom" and "max" stand for
+ * the nominal and highest available frequencies.
+ */
+struct governor_tunable {
+    char name[32];
+    char value[16];
+};
+
+static struct governor_tunable tunables[MAX_TUNABLES] = {
+    { "timer_rate", "20000" },
+    { "min_sample_time", "60000" },
+    { "hispeed_freq", "nom" },
+    { "go_hispeed_load", "50" },
+    { "above_hispeed_delay", "100000" },
+};
+static int tunable_num = 5;
+
+/*
+ * What a hint does, one [section] of the config file each. boost_ms is
+ * used when the hint carries no duration, 0 leaving the governor's own
+ * boostpulse_duration; min_cpus is the number of CPUs put online first.
+ *
+ * Sustained profiles are switched on and off by their hint (data is an
+ * int, 0 to end, no data to start) and hold the CPU frequency limits, the
+ * SGX governor and the number of online CPUs while active. Several may be
+ * active at once, the first one in the table is applied. Empty strings and
+ * zero CPU counts leave the default.
+ */
+struct hint_profile {
+    const char *name;
+    power_hint_t hint;
+    int sustained;
+    int boost_ms;
+    int max_boost_ms;
+    int min_cpus;
+    int max_cpus;
+    char min_freq[16];
+    char max_freq[16];
+    char gpu_governor[16];
+};
+
+static struct hint_profile hint_profiles[] = {
+    { "launch", POWER_HINT_OMAP_LAUNCH, 1, 0, 0, 2, 0, "max", "", "activeidle" },
+    { "camera", POWER_HINT_VIDEO_ENCODE, 1, 0, 0, 2, 0, "nom", "", "activeidle" },
+    { "video", POWER_HINT_VIDEO_DECODE, 1, 0, 0, 2, 0, "", "", "" },
+    { "kiosk", POWER_HINT_OMAP_KIOSK, 1, 0, 0, 0, 1, "", "nom", "on3demand" },
+    { "interaction", POWER_HINT_INTERACTION, 0, 0, 2000, 2, 0, "", "", "" },
+};
+
+#define HINT_PROFILE_NUM (int)(sizeof(hint_profiles) / sizeof(hint_profiles[0]))
 
 static int freq_num;
 static char *freq_list[MAX_FREQ_NUMBER];
 static char *max_freq, *nom_freq;
 char current_max_freq[10];
+static char default_min_freq[16];      /* floor found at init, restored by the default profile */
+static char default_gpu_governor[16];
 
 struct omap_power_module {
     struct power_module base;
     pthread_mutex_t lock;
     int boostpulse_fd;
     int boostpulse_warned;
+    int boost_duration_ms;      /* last written to boostpulse_duration */
+    unsigned int active_profiles;       /* bit per hint_profiles entry */
+    const struct hint_profile *applied;
+    unsigned int cpus_offlined;         /* bit per CPU taken down by a profile */
+    int interactive;
     int inited;
 };
 
@@ -65,10 +139,74 @@ static int str_to_tokens(char *str, char **token, int max_token_idx) {
     return token_idx;
 }
 
+/*
+ * Nodes written on the screen on and hint paths are kept open, and
+ * remember the last value read or written so an unchanged value is not
+ * written again. Only nodes this HAL owns belong here, another writer
+ * would make the remembered value stale.
+ */
+struct sysfs_node {
+    const char *path;
+    int fd;
+    char value[32];
+};
+
+static struct sysfs_node sysfs_nodes[MAX_SYSFS_NODES];
+static int sysfs_node_num;
+
+static struct sysfs_node *sysfs_node_find(const char *path) {
+    int i;
+
+    for (i = 0; i < sysfs_node_num; i++) {
+        if (!strcmp(sysfs_nodes[i].path, path))
+            return &sysfs_nodes[i];
+    }
+    return NULL;
+}
+
+static void sysfs_node_open(const char *path) {
+    struct sysfs_node *node;
+    char buf[80];
+    int fd;
+
+    if (sysfs_node_find(path) || sysfs_node_num == MAX_SYSFS_NODES)
+        return;
+
+    fd = open(path, O_RDWR);
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", path, buf);
+        return;
+    }
+
+    node = &sysfs_nodes[sysfs_node_num++];
+    node->path = path;
+    node->fd = fd;
+    node->value[0] = '\0';
+}
+
 static void sysfs_write(char *path, char *s) {
     char buf[80];
     int len;
-    int fd = open(path, O_WRONLY);
+    int fd;
+    struct sysfs_node *node = sysfs_node_find(path);
+
+    if (node) {
+        if (node->value[0] && !strcmp(node->value, s))
+            return;
+
+        len = pwrite(node->fd, s, strlen(s), 0);
+        if (len < 0) {
+            strerror_r(errno, buf, sizeof(buf));
+            ALOGE("Error writing to %s: %s\n", path, buf);
+            node->value[0] = '\0';
+        } else {
+            strlcpy(node->value, s, sizeof(node->value));
+        }
+        return;
+    }
+
+    fd = open(path, O_WRONLY);
 
     if (fd < 0) {
         strerror_r(errno, buf, sizeof(buf));
@@ -90,10 +228,27 @@ static int sysfs_read(char *path, char *s, int s_size) {
     int len, i;
     int fd;
 
+    struct sysfs_node *node;
+
     if (!path || !s || !s_size) {
         return -1;
     }
 
+    node = sysfs_node_find(path);
+    if (node) {
+        len = pread(node->fd, s, s_size - 1, 0);
+        if (len < 0) {
+            strerror_r(errno, buf, sizeof(buf));
+            ALOGE("Error reading from %s: %s\n", path, buf);
+            node->value[0] = '\0';
+            return len;
+        }
+        s[len] = '\0';
+        strlcpy(node->value, s, sizeof(node->value));
+        node->value[strcspn(node->value, "\n")] = '\0';
+        return len;
+    }
+
     fd = open(path, O_RDONLY);
     if (fd < 0) {
         strerror_r(errno, buf, sizeof(buf));
@@ -113,16 +268,132 @@ static int sysfs_read(char *path, char *s, int s_size) {
     return len;
 }
 
+static struct hint_profile *find_hint_profile(const char *name, power_hint_t hint) {
+    int i;
+
+    for (i = 0; i < HINT_PROFILE_NUM; i++) {
+        if (name ? !strcmp(hint_profiles[i].name, name) : hint_profiles[i].hint == hint)
+            return &hint_profiles[i];
+    }
+    return NULL;
+}
+
+static void set_tunable(const char *name, const char *value) {
+    int i;
+
+    for (i = 0; i < tunable_num; i++) {
+        if (!strcmp(tunables[i].name, name))
+            break;
+    }
+    if (i == MAX_TUNABLES) {
+        ALOGE("Too many governor tunables, ignoring %s\n", name);
+        return;
+    }
+    if (i == tunable_num)
+        tunable_num++;
+    strlcpy(tunables[i].name, name, sizeof(tunables[i].name));
+    strlcpy(tunables[i].value, value, sizeof(tunables[i].value));
+}
+
+/*
+ * Config file format:
+ *
+ *   # comment
+ *   [governor]
+ *   go_hispeed_load 85
+ *   [interaction]
+ *   boost_ms 500
+ *   min_cpus 2
+ *
+ * A missing file leaves the built-in defaults.
+ */
+static void load_config(const char *path) {
+    char line[128], section[32] = "";
+    char *key, *value, *pos;
+    struct hint_profile *profile;
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        ALOGI("No %s, using default profiles\n", path);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        if ((pos = strchr(line, '#')))
+            *pos = '\0';
+        key = strtok_r(line, " \t\r\n", &pos);
+        if (!key)
+            continue;
+
+        if (key[0] == '[') {
+            strlcpy(section, key + 1, sizeof(section));
+            if ((pos = strchr(section, ']')))
+                *pos = '\0';
+            continue;
+        }
+
+        value = strtok_r(NULL, " \t\r\n", &pos);
+        if (!value) {
+            ALOGE("%s: no value for %s\n", path, key);
+            continue;
+        }
+
+        if (!strcmp(section, "governor")) {
+            set_tunable(key, value);
+            continue;
+        }
+
+        profile = find_hint_profile(section, 0);
+        if (!profile) {
+            ALOGE("%s: unknown section [%s]\n", path, section);
+        } else if (!strcmp(key, "boost_ms")) {
+            profile->boost_ms = atoi(value);
+        } else if (!strcmp(key, "max_boost_ms")) {
+            profile->max_boost_ms = atoi(value);
+        } else if (!strcmp(key, "min_cpus")) {
+            profile->min_cpus = atoi(value);
+        } else if (!strcmp(key, "max_cpus")) {
+            profile->max_cpus = atoi(value);
+        } else if (!strcmp(key, "min_freq")) {
+            strlcpy(profile->min_freq, value, sizeof(profile->min_freq));
+        } else if (!strcmp(key, "max_freq")) {
+            strlcpy(profile->max_freq, value, sizeof(profile->max_freq));
+        } else if (!strcmp(key, "gpu_governor")) {
+            strlcpy(profile->gpu_governor, value, sizeof(profile->gpu_governor));
+        } else {
+            ALOGE("%s: unknown key %s in [%s]\n", path, key, section);
+        }
+    }
+
+    fclose(f);
+}
+
 static void omap_power_init(struct power_module *module) {
     struct omap_power_module *omap_device = (struct omap_power_module *) module;
     int tmp;
     char freq_buf[MAX_FREQ_NUMBER*10];
+    char min_freq_buf[16];
+    char path[80];
+    const char *value;
+    int i;
 
     tmp = sysfs_read(CPUFREQ_CPU0 "scaling_available_frequencies", freq_buf, sizeof(freq_buf));
     if (tmp <= 0) {
         return;
     }
 
+    /* init scripts and the user set the cpufreq limits too, so those are not kept open */
+    sysfs_node_open(BOOSTPULSE_DURATION_PATH);
+    if (!access(SGXFREQ_GOVERNOR_PATH, W_OK))
+        sysfs_node_open(SGXFREQ_GOVERNOR_PATH);
+    if (!access(SGXFREQ_BOOST_PATH, W_OK))
+        sysfs_node_open(SGXFREQ_BOOST_PATH);
+
+    if (sysfs_read(CPUFREQ_CPU0 "scaling_min_freq", min_freq_buf, sizeof(min_freq_buf)) > 0) {
+        min_freq_buf[strcspn(min_freq_buf, "\n")] = '\0';
+        strlcpy(default_min_freq, min_freq_buf, sizeof(default_min_freq));
+    }
+
     tmp = sysfs_read(CPUFREQ_CPU0 "scaling_max_freq", current_max_freq, sizeof(current_max_freq));
     if (tmp <= 0) {
         ALOGE("Error reading scaling_max_freq\n");
@@ -137,16 +408,31 @@ static void omap_power_init(struct power_module *module) {
     tmp = (NOM_FREQ_INDEX > freq_num) ? freq_num : NOM_FREQ_INDEX;
     nom_freq = freq_list[tmp - 1];
 
-    sysfs_write(CPUFREQ_INTERACTIVE "timer_rate", "20000");
-    sysfs_write(CPUFREQ_INTERACTIVE "min_sample_time","60000");
-    sysfs_write(CPUFREQ_INTERACTIVE "hispeed_freq", nom_freq);
-    sysfs_write(CPUFREQ_INTERACTIVE "go_hispeed_load", "50");
-    sysfs_write(CPUFREQ_INTERACTIVE "above_hispeed_delay", "100000");
+    load_config(POWER_CONFIG_PATH);
+
+    for (i = 0; i < tunable_num; i++) {
+        value = tunables[i].value;
+        if (!strcmp(value, "nom"))
+            value = nom_freq;
+        else if (!strcmp(value, "max"))
+            value = max_freq;
+        snprintf(path, sizeof(path), CPUFREQ_INTERACTIVE "%s", tunables[i].name);
+        sysfs_write(path, (char *) value);
+    }
+
+    if (sysfs_read(SGXFREQ_GOVERNOR_PATH, default_gpu_governor,
+                   sizeof(default_gpu_governor)) > 0) {
+        default_gpu_governor[strcspn(default_gpu_governor, "\n")] = '\0';
+    }
 
     ALOGI("Initialized successfully");
+    omap_device->interactive = 1;
     omap_device->inited = 1;
 }
 
+static void apply_profile(struct omap_power_module *omap_device);
+static void online_cpus(int min_cpus);
+
 static int boostpulse_open(struct omap_power_module *omap_device) {
     char buf[80];
 
@@ -175,6 +461,9 @@ static void omap_power_set_interactive(struct power_module *module, int on) {
     if (!omap_device->inited)
         return;
 
+    pthread_mutex_lock(&omap_device->lock);
+    omap_device->interactive = on;
+
     /*
      * Lower maximum frequency when screen is off.  CPU 0 and 1 share a
      * cpufreq policy.
@@ -182,40 +471,210 @@ static void omap_power_set_interactive(struct power_module *module, int on) {
 
     // sysfs_write(CPUFREQ_CPU0 "scaling_max_freq", on ? max_freq : nom_freq);
     if (on) {
-        sysfs_write(CPUFREQ_CPU0 "scaling_max_freq", (strlen(current_max_freq) > 0) ? current_max_freq : max_freq);
+        /* a profile ceiling is put back by apply_profile() */
+        omap_device->applied = NULL;
+        apply_profile(omap_device);
     } else {
-        tmp = sysfs_read(CPUFREQ_CPU0 "scaling_max_freq", current_max_freq, sizeof(current_max_freq));
-        if (tmp <= 0) {
-            ALOGE("Error reading scaling_max_freq\n");
+        /* remember the user's ceiling, not one a profile put there */
+        if (!omap_device->applied || !omap_device->applied->max_freq[0]) {
+            tmp = sysfs_read(CPUFREQ_CPU0 "scaling_max_freq", current_max_freq, sizeof(current_max_freq));
+            if (tmp <= 0) {
+                ALOGE("Error reading scaling_max_freq\n");
+            }
         }
         sysfs_write(CPUFREQ_CPU0 "scaling_max_freq", nom_freq);
     }
+    pthread_mutex_unlock(&omap_device->lock);
 }
 
-static void omap_power_hint(struct power_module *module, power_hint_t hint, void *data) {
-    struct omap_power_module *omap_device = (struct omap_power_module *) module;
+/*
+ * Bring CPUs online up to the profile's floor, so a boost is not spent
+ * waiting for a core to come up. They are left online afterwards, taking
+ * them down again is up to whoever put them down.
+ */
+static void online_cpus(int min_cpus) {
+    char path[64], state[4];
+    int cpu;
+
+    if (min_cpus > MAX_CPUS)
+        min_cpus = MAX_CPUS;
+
+    for (cpu = 1; cpu < min_cpus; cpu++) {
+        snprintf(path, sizeof(path), CPU_ONLINE_PATH, cpu);
+        if (access(path, W_OK))
+            break;
+        if (sysfs_read(path, state, sizeof(state)) > 0 && state[0] == '0')
+            sysfs_write(path, "1");
+    }
+}
+
+static const char *resolve_freq(const char *value) {
+    if (!strcmp(value, "nom"))
+        return nom_freq;
+    if (!strcmp(value, "max"))
+        return max_freq;
+    return value;
+}
+
+/*
+ * Take CPUs above max_cpus down, and bring back the ones a previous
+ * profile took down when the limit is lifted.
+ */
+static void limit_cpus(struct omap_power_module *omap_device, int max_cpus) {
+    char path[64], state[4];
+    int cpu;
+
+    for (cpu = 1; cpu < MAX_CPUS; cpu++) {
+        snprintf(path, sizeof(path), CPU_ONLINE_PATH, cpu);
+        if (access(path, W_OK))
+            break;
+
+        if (max_cpus > 0 && cpu >= max_cpus) {
+            if (sysfs_read(path, state, sizeof(state)) > 0 && state[0] == '1') {
+                sysfs_write(path, "0");
+                omap_device->cpus_offlined |= 1 << cpu;
+            }
+        } else if (omap_device->cpus_offlined & (1 << cpu)) {
+            sysfs_write(path, "1");
+            omap_device->cpus_offlined &= ~(1 << cpu);
+        }
+    }
+}
+
+/* must be called with omap_device->lock held */
+static void apply_profile(struct omap_power_module *omap_device) {
+    const struct hint_profile *profile = NULL;
+    const char *value, *min;
+    char cur_min[16];
+    int i;
+
+    for (i = 0; i < HINT_PROFILE_NUM; i++) {
+        if (omap_device->active_profiles & (1 << i)) {
+            profile = &hint_profiles[i];
+            break;
+        }
+    }
+
+    if (profile == omap_device->applied && profile)
+        return;
+
+    ALOGI("Applying %s power profile\n", profile ? profile->name : "default");
+
+    if (profile && profile->min_freq[0])
+        min = resolve_freq(profile->min_freq);
+    else
+        min = default_min_freq[0] ? default_min_freq : freq_list[0];
+
+    /* screen off keeps its own ceiling */
+    if (omap_device->interactive) {
+        if (profile && profile->max_freq[0])
+            value = resolve_freq(profile->max_freq);
+        else
+            value = (strlen(current_max_freq) > 0) ? current_max_freq : max_freq;
+
+        /* the kernel refuses a ceiling below the floor, so order the writes */
+        if ((sysfs_read(CPUFREQ_CPU0 "scaling_min_freq", cur_min, sizeof(cur_min)) > 0) &&
+                (atoi(value) < atoi(cur_min))) {
+            sysfs_write(CPUFREQ_CPU0 "scaling_min_freq", (char *) min);
+            sysfs_write(CPUFREQ_CPU0 "scaling_max_freq", (char *) value);
+        } else {
+            sysfs_write(CPUFREQ_CPU0 "scaling_max_freq", (char *) value);
+            sysfs_write(CPUFREQ_CPU0 "scaling_min_freq", (char *) min);
+        }
+    } else {
+        sysfs_write(CPUFREQ_CPU0 "scaling_min_freq", (char *) min);
+    }
+
+    value = (profile && profile->gpu_governor[0]) ? profile->gpu_governor : default_gpu_governor;
+    if (value[0] && !access(SGXFREQ_GOVERNOR_PATH, W_OK))
+        sysfs_write(SGXFREQ_GOVERNOR_PATH, (char *) value);
+
+    limit_cpus(omap_device, profile ? profile->max_cpus : 0);
+    if (profile)
+        online_cpus(profile->min_cpus);
+
+    omap_device->applied = profile;
+}
+
+static void set_profile(struct omap_power_module *omap_device,
+                        const struct hint_profile *profile, int on) {
+    unsigned int bit = 1 << (profile - hint_profiles);
+
+    pthread_mutex_lock(&omap_device->lock);
+    if (on)
+        omap_device->active_profiles |= bit;
+    else
+        omap_device->active_profiles &= ~bit;
+    apply_profile(omap_device);
+    pthread_mutex_unlock(&omap_device->lock);
+}
+
+static void sgx_boost_pulse(char *ms) {
+    struct sysfs_node *node = sysfs_node_find(SGXFREQ_BOOST_PATH);
+
+    if (!node)
+        return;
+    node->value[0] = '\0';
+    sysfs_write(SGXFREQ_BOOST_PATH, ms);
+}
+
+static void boost(struct omap_power_module *omap_device,
+                  const struct hint_profile *profile, int duration_ms) {
     char buf[80];
     int len;
 
-    if (!omap_device->inited)
+    if (duration_ms <= 0)
+        duration_ms = profile->boost_ms;
+    if (profile->max_boost_ms > 0 && duration_ms > profile->max_boost_ms)
+        duration_ms = profile->max_boost_ms;
+
+    online_cpus(profile->min_cpus);
+
+    /*
+     * The first frames after a touch are drawn before the GPU governor has
+     * seen any load, hold its floor up for them too. A pulse is a write
+     * every time, so keep it off the remembered value path.
+     */
+    snprintf(buf, sizeof(buf), "%d", duration_ms > 0 ? duration_ms : SGX_BOOST_DEFAULT_MS);
+    sgx_boost_pulse(buf);
+
+    if (boostpulse_open(omap_device) < 0)
         return;
 
-    switch (hint) {
-    case POWER_HINT_INTERACTION:
-        if (boostpulse_open(omap_device) >= 0) {
-            len = write(omap_device->boostpulse_fd, "1", 1);
+    pthread_mutex_lock(&omap_device->lock);
+    if (duration_ms > 0 && duration_ms != omap_device->boost_duration_ms) {
+        snprintf(buf, sizeof(buf), "%d", duration_ms * 1000);
+        sysfs_write(BOOSTPULSE_DURATION_PATH, buf);
+        omap_device->boost_duration_ms = duration_ms;
+    }
+    pthread_mutex_unlock(&omap_device->lock);
 
-            if (len < 0) {
-                strerror_r(errno, buf, sizeof(buf));
-                ALOGE("Error writing to %s: %s\n", BOOSTPULSE_PATH, buf);
-            }
-        }
-        break;
+    len = write(omap_device->boostpulse_fd, "1", 1);
+    if (len < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to %s: %s\n", BOOSTPULSE_PATH, buf);
+    }
+}
+
+static void omap_power_hint(struct power_module *module, power_hint_t hint, void *data) {
+    struct omap_power_module *omap_device = (struct omap_power_module *) module;
+    const struct hint_profile *profile;
 
+    if (!omap_device->inited)
+        return;
+
+    switch (hint) {
     case POWER_HINT_VSYNC:
         break;
 
     default:
+        profile = find_hint_profile(NULL, hint);
+        if (!profile)
+            break;
+        if (profile->sustained)
+            set_profile(omap_device, profile, data ? *(int *) data : 1);
+        else    /* data, when given, is the expected duration in ms */
+            boost(omap_device, profile, data ? *(int *) data : 0);
         break;
     }
 }
@@ -244,4 +703,7 @@ struct omap_power_module HAL_MODULE_INFO_SYM = {
     .lock = PTHREAD_MUTEX_INITIALIZER,
     .boostpulse_fd = -1,
     .boostpulse_warned = 0,
+    .boost_duration_ms = 0,
+    .active_profiles = 0,
+    .applied = NULL,
 };
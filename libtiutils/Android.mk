@@ -42,6 +42,11 @@ ifdef TI_UTILS_MESSAGE_QUEUE_DEBUG_ENABLED
     LOCAL_CFLAGS += -DMSGQ_DEBUG
 endif
 
+ifdef TI_UTILS_MESSAGE_QUEUE_TRACE
+    # Trace every get() and put() in systrace
+    LOCAL_CFLAGS += -DTI_UTILS_TRACE_ZONES=TI_UTILS_TRACE_ZONE_MSGQ
+endif
+
 ifdef TI_UTILS_MESSAGE_QUEUE_DEBUG_FUNCTION_NAMES
     # Enable function enter/exit logging
     LOCAL_CFLAGS += -DTI_UTILS_FUNCTION_LOGGER_ENABLE
@@ -51,3 +56,14 @@ LOCAL_MODULE:= libtiutils_custom
 LOCAL_MODULE_TAGS:= optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+
+# Message round-trip latency benchmark
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := MessageQueue_bench.cpp
+LOCAL_C_INCLUDES += frameworks/native/include
+LOCAL_SHARED_LIBRARIES := libtiutils_custom libutils libcutils
+LOCAL_CFLAGS += -fno-short-enums $(ANDROID_API_CFLAGS)
+LOCAL_MODULE := msgqueue_bench
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
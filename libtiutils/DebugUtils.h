@@ -18,6 +18,7 @@
 #define DEBUG_UTILS_H
 
 #include <android/log.h>
+#include <cutils/trace.h>
 #include <utils/threads.h>
 #include <utils/Vector.h>
 
@@ -123,6 +124,44 @@ private:
 
 
 
+// Systrace begin/end for one scope. Constructed only where the zone is
+// compiled in, and then costs the atrace tag check when tracing is off.
+template <bool Enabled>
+class ScopedTrace
+{
+public:
+    ScopedTrace(const char *) {}
+};
+
+#ifdef ATRACE_TAG_CAMERA
+template <>
+class ScopedTrace<true>
+{
+public:
+    ScopedTrace(const char * name);
+    ~ScopedTrace();
+
+private:
+    const bool mActive;
+};
+#endif
+
+
+
+
+// trace zones, built in when set in TI_UTILS_TRACE_ZONES
+#define TI_UTILS_TRACE_ZONE_HAL     (1 << 0)
+#define TI_UTILS_TRACE_ZONE_ADAPTER (1 << 1)
+#define TI_UTILS_TRACE_ZONE_DISPLAY (1 << 2)
+#define TI_UTILS_TRACE_ZONE_MSGQ    (1 << 3)
+
+#ifndef TI_UTILS_TRACE_ZONES
+#   define TI_UTILS_TRACE_ZONES 0
+#endif
+
+#define TI_TRACE_NAME(zone, name) Ti::ScopedTrace<((zone) & TI_UTILS_TRACE_ZONES) != 0> __trace_instance(name);
+#define TI_TRACE_CALL(zone) TI_TRACE_NAME(zone, __FUNCTION__)
+
 #ifdef TI_UTILS_FUNCTION_LOGGER_ENABLE
 #   define LOG_FUNCTION_NAME Ti::FunctionLogger __function_logger_instance(__FILE__, __LINE__, __FUNCTION__);
 #   define LOG_FUNCTION_NAME_EXIT __function_logger_instance.setExitLine(__LINE__);
@@ -371,6 +410,23 @@ inline FunctionLogger::~FunctionLogger()
 }
 
 
+#ifdef ATRACE_TAG_CAMERA
+inline ScopedTrace<true>::ScopedTrace(const char * const name) :
+    mActive(atrace_is_tag_enabled(ATRACE_TAG_CAMERA))
+{
+    if ( mActive )
+        atrace_begin(ATRACE_TAG_CAMERA, name);
+}
+
+
+inline ScopedTrace<true>::~ScopedTrace()
+{
+    if ( mActive )
+        atrace_end(ATRACE_TAG_CAMERA);
+}
+#endif
+
+
 inline void FunctionLogger::setExitLine(const int line)
 {
     if ( mExitLine != -1 )
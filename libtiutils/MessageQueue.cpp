@@ -16,11 +16,17 @@
 
 
 #include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/types.h>
 #include <sys/poll.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 #include <utils/Errors.h>
+#include <utils/Timers.h>
 
 
 
@@ -32,6 +38,30 @@
 namespace Ti {
 namespace Utils {
 
+///Ring size each lane starts with, it doubles up to CAPACITY when needed
+#define MSGQ_INITIAL_SIZE 32
+
+///A thread sleeping in waitForMsg(), woken by put() on any of its queues.
+///put() flags it while holding the queue lock but issues the futex wake only
+///after dropping it, so the woken thread does not run straight into that
+///lock. A late wake only ever hits the futex word, never its memory.
+struct MessageQueue::Waiter
+{
+    Waiter() : woken(0) {}
+
+    volatile int32_t woken;
+};
+
+static void futexWait(volatile int32_t *addr, int32_t value, const struct timespec *timeout)
+{
+    syscall(__NR_futex, addr, FUTEX_WAIT, value, timeout, NULL, 0);
+}
+
+static void futexWake(volatile int32_t *addr)
+{
+    syscall(__NR_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
 /**
    @brief Constructor for the message queue class
 
@@ -39,27 +69,48 @@ namespace Utils {
    @return none
  */
 MessageQueue::MessageQueue()
+    : mHasMsg(false)
+    , mCount(0)
+    , mWaiter(NULL)
+    , mDoorbell(false)
+    , mRung(false)
 {
     LOG_FUNCTION_NAME;
 
-    int fds[2] = {-1,-1};
-    android::status_t stat;
-
-    stat = pipe(fds);
+    int fd = eventfd(0, EFD_NONBLOCK);
 
-    if ( 0 > stat )
+    if ( 0 <= fd )
         {
-        MSGQ_LOGEB("Error while openning pipe: %s", strerror(stat) );
-        this->fd_read = 0;
-        this->fd_write = 0;
-        mHasMsg = false;
+        this->fd_read = fd;
+        this->fd_write = fd;
         }
     else
         {
-        this->fd_read = fds[0];
-        this->fd_write = fds[1];
+        ///Kernels without eventfd get a pipe as doorbell instead
+        int fds[2] = {-1,-1};
+
+        if ( 0 > pipe(fds) )
+            {
+            MSGQ_LOGEB("Error while openning pipe: %s", strerror(errno) );
+            this->fd_read = 0;
+            this->fd_write = 0;
+            }
+        else
+            {
+            fcntl(fds[0], F_SETFL, O_NONBLOCK);
+            this->fd_read = fds[0];
+            this->fd_write = fds[1];
+            }
+        }
+
+    for ( int i = 0; i < PRIORITY_COUNT; i++ )
+        {
+        Lane &lane = mLanes[i];
 
-        mHasMsg = false;
+        lane.ring = new Message[MSGQ_INITIAL_SIZE];
+        lane.size = lane.ring ? MSGQ_INITIAL_SIZE : 0;
+        lane.head = 0;
+        lane.count = 0;
         }
 
     LOG_FUNCTION_NAME_EXIT;
@@ -80,26 +131,137 @@ MessageQueue::~MessageQueue()
         close(this->fd_read);
         }
 
-    if(this->fd_write >= 0)
+    if((this->fd_write >= 0) && (this->fd_write != this->fd_read))
         {
         close(this->fd_write);
         }
 
+    for ( int i = 0; i < PRIORITY_COUNT; i++ )
+        {
+        delete [] mLanes[i].ring;
+        }
+
     LOG_FUNCTION_NAME_EXIT;
 }
 
 /**
-   @brief Get a message from the queue
+   @brief Make the input descriptor readable, called with mLock held
+
+   @param none
+   @return none
+ */
+void MessageQueue::ringDoorbell()
+{
+    uint64_t one = 1;
+
+    if ( !mDoorbell || mRung )
+        {
+        return;
+        }
+
+    if ( write(this->fd_write, &one, (this->fd_write == this->fd_read) ? sizeof(one) : 1) < 0 )
+        {
+        MSGQ_LOGEB("doorbell write() error: %s", strerror(errno));
+        return;
+        }
+
+    mRung = true;
+}
+
+/**
+   @brief Make the input descriptor unreadable again, called with mLock held
+
+   @param none
+   @return none
+ */
+void MessageQueue::drainDoorbell()
+{
+    uint64_t value;
+
+    if ( !mDoorbell || !mRung )
+        {
+        return;
+        }
+
+    ///The doorbell is rung at most once, a single read clears it
+    if ( read(this->fd_read, &value, (this->fd_write == this->fd_read) ? sizeof(value) : 1) < 0 )
+        {
+        if ( EAGAIN != errno )
+            {
+            MSGQ_LOGEB("doorbell read() error: %s", strerror(errno));
+            }
+        }
+
+    mRung = false;
+}
+
+/**
+   @brief Start keeping the input descriptor in sync with the ring
+
+   @param none
+   @return none
+ */
+void MessageQueue::enableDoorbell()
+{
+    android::AutoMutex lock(mLock);
+
+    if ( !mDoorbell )
+        {
+        mDoorbell = true;
+        if ( 0 != mCount )
+            {
+            ringDoorbell();
+            }
+        }
+}
+
+/**
+   @brief Double the ring of a lane, called with mLock held when it is full
+
+   @param lane The full lane
+   @return true If there is room for another message
+ */
+bool MessageQueue::grow(Lane &lane)
+{
+    if ( lane.size >= CAPACITY )
+        {
+        return false;
+        }
+
+    unsigned int size = lane.size ? lane.size * 2 : MSGQ_INITIAL_SIZE;
+    Message *ring = new Message[size];
+
+    if ( !ring )
+        {
+        return false;
+        }
+
+    for ( unsigned int i = 0; i < lane.count; i++ )
+        {
+        ring[i] = lane.ring[(lane.head + i) % lane.size];
+        }
+
+    delete [] lane.ring;
+    lane.ring = ring;
+    lane.size = size;
+    lane.head = 0;
+
+    return true;
+}
+
+/**
+   @brief Get a message from the queue. Blocks while the queue is empty.
+          The oldest message of the highest priority lane is returned.
 
    @param msg Message structure to hold the message to be retrieved
    @return android::NO_ERROR On success
    @return android::BAD_VALUE if the message pointer is NULL
    @return android::NO_INIT If the file read descriptor is not set
-   @return android::UNKNOWN_ERROR if the read operation fromthe file read descriptor fails
  */
 android::status_t MessageQueue::get(Message* msg)
 {
     LOG_FUNCTION_NAME;
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_MSGQ);
 
     if(!msg)
         {
@@ -115,24 +277,34 @@ android::status_t MessageQueue::get(Message* msg)
         return android::NO_INIT;
         }
 
-    char* p = (char*) msg;
-    size_t read_bytes = 0;
+    {
+    android::AutoMutex lock(mLock);
 
-    while( read_bytes  < sizeof(*msg) )
+    while ( 0 == mCount )
         {
-        int err = read(this->fd_read, p, sizeof(*msg) - read_bytes);
+        mNotEmpty.wait(mLock);
+        }
 
-        if( err < 0 )
-            {
-            MSGQ_LOGEB("read() error: %s", strerror(errno));
-            return android::UNKNOWN_ERROR;
-            }
-        else
-            {
-            read_bytes += err;
-            }
+    Lane *lane = mLanes;
+    while ( 0 == lane->count )
+        {
+        lane++;
         }
 
+    *msg = lane->ring[lane->head];
+    lane->head = (lane->head + 1) % lane->size;
+    lane->count--;
+    mCount--;
+
+    if ( 0 == mCount )
+        {
+        drainDoorbell();
+        }
+
+    ///Writers may be blocked on another lane, wake them all
+    mNotFull.broadcast();
+    }
+
     MSGQ_LOGDB("MQ.get(%d,%p,%p,%p,%p)", msg->command, msg->arg1,msg->arg2,msg->arg3,msg->arg4);
 
     mHasMsg = false;
@@ -151,6 +323,11 @@ android::status_t MessageQueue::get(Message* msg)
 
 int MessageQueue::getInFd()
 {
+    if ( this->fd_read )
+        {
+        enableDoorbell();
+        }
+
     return this->fd_read;
 }
 
@@ -176,21 +353,19 @@ void MessageQueue::setInFd(int fd)
 }
 
 /**
-   @brief Queue a message
+   @brief Queue a message. Blocks while its lane is full.
 
    @param msg Message structure to hold the message to be retrieved
+   @param priority Lane to queue the message in
    @return android::NO_ERROR On success
    @return android::BAD_VALUE if the message pointer is NULL
    @return android::NO_INIT If the file write descriptor is not set
-   @return android::UNKNOWN_ERROR if the write operation fromthe file write descriptor fails
  */
 
-android::status_t MessageQueue::put(Message* msg)
+android::status_t MessageQueue::put(Message* msg, Priority priority)
 {
     LOG_FUNCTION_NAME;
-
-    char* p = (char*) msg;
-    size_t bytes = 0;
+    TI_TRACE_CALL(TI_UTILS_TRACE_ZONE_MSGQ);
 
     if(!msg)
         {
@@ -206,23 +381,47 @@ android::status_t MessageQueue::put(Message* msg)
         return android::NO_INIT;
         }
 
+    if ( (0 > priority) || (PRIORITY_COUNT <= priority) )
+        {
+        MSGQ_LOGEB("invalid message priority %d", priority);
+        LOG_FUNCTION_NAME_EXIT;
+        return android::BAD_VALUE;
+        }
 
     MSGQ_LOGDB("MQ.put(%d,%p,%p,%p,%p)", msg->command, msg->arg1,msg->arg2,msg->arg3,msg->arg4);
 
-    while( bytes  < sizeof(msg) )
+    Waiter *waiter = NULL;
+
+    {
+    android::AutoMutex lock(mLock);
+
+    Lane &lane = mLanes[priority];
+
+    while ( (lane.count == lane.size) && !grow(lane) )
         {
-        int err = write(this->fd_write, p, sizeof(*msg) - bytes);
+        mNotFull.wait(mLock);
+        }
 
-        if( err < 0 )
-            {
-            MSGQ_LOGEB("write() error: %s", strerror(errno));
-            LOG_FUNCTION_NAME_EXIT;
-            return android::UNKNOWN_ERROR;
-            }
-        else
-            {
-            bytes += err;
-            }
+    lane.ring[(lane.head + lane.count) % lane.size] = *msg;
+    lane.count++;
+    mCount++;
+
+    if ( 1 == mCount )
+        {
+        ringDoorbell();
+        }
+
+    mNotEmpty.signal();
+
+    if ( mWaiter && __sync_bool_compare_and_swap(&mWaiter->woken, 0, 1) )
+        {
+        waiter = mWaiter;
+        }
+    }
+
+    if ( waiter )
+        {
+        futexWake(&waiter->woken);
         }
 
     MSGQ_LOGDA("MessageQueue::put EXIT");
@@ -243,12 +442,6 @@ bool MessageQueue::isEmpty()
 {
     LOG_FUNCTION_NAME;
 
-    struct pollfd pfd;
-
-    pfd.fd = this->fd_read;
-    pfd.events = POLLIN;
-    pfd.revents = 0;
-
     if(!this->fd_read)
         {
         MSGQ_LOGEA("read descriptor not initialized for message queue");
@@ -256,22 +449,7 @@ bool MessageQueue::isEmpty()
         return android::NO_INIT;
         }
 
-
-    if( -1 == poll(&pfd,1,0) )
-        {
-        MSGQ_LOGEB("poll() error: %s", strerror(errno));
-        LOG_FUNCTION_NAME_EXIT;
-        return false;
-        }
-
-    if(pfd.revents & POLLIN)
-        {
-        mHasMsg = true;
-        }
-    else
-        {
-        mHasMsg = false;
-        }
+    mHasMsg = ( 0 != mCount );
 
     LOG_FUNCTION_NAME_EXIT;
     return !mHasMsg;
@@ -288,12 +466,23 @@ void MessageQueue::clear()
         return;
         }
 
-    Message msg;
-    while(!isEmpty())
+    android::AutoMutex lock(mLock);
+
+    if ( 0 != mCount )
         {
-        get(&msg);
+        for ( int i = 0; i < PRIORITY_COUNT; i++ )
+            {
+            mLanes[i].head = 0;
+            mLanes[i].count = 0;
+            }
+        mCount = 0;
+        drainDoorbell();
+        mNotFull.broadcast();
         }
 
+    mHasMsg = false;
+
+    LOG_FUNCTION_NAME_EXIT;
 }
 
 
@@ -308,6 +497,74 @@ void MessageQueue::setMsg(bool hasMsg)
     mHasMsg = hasMsg;
     }
 
+/**
+   @brief Register a thread sleeping in waitForMsg() with this queue
+
+   @param waiter The sleeping thread
+   @return true If registered, false if another thread already waits here
+ */
+bool MessageQueue::addWaiter(Waiter *waiter)
+{
+    android::AutoMutex lock(mLock);
+
+    if ( mWaiter )
+        {
+        return false;
+        }
+
+    mWaiter = waiter;
+
+    return true;
+}
+
+void MessageQueue::removeWaiter(Waiter *waiter)
+{
+    android::AutoMutex lock(mLock);
+
+    if ( mWaiter == waiter )
+        {
+        mWaiter = NULL;
+        }
+}
+
+/**
+   @brief Wait on the doorbells of the queues, used when more than one
+          thread waits on the same queue
+
+   @param queues Queues to wait on
+   @param n Number of queues
+   @param timeout The timeout value (in milli secs)
+   @return Number of queues with messages, 0 on timeout or a negative error
+ */
+int MessageQueue::pollForMsg(MessageQueue **queues, int n, int timeout)
+{
+    struct pollfd pfd[3];
+
+    for ( int i = 0; i < n; i++ )
+        {
+        queues[i]->enableDoorbell();
+        pfd[i].fd = queues[i]->fd_read;
+        pfd[i].events = POLLIN;
+        pfd[i].revents = 0;
+        }
+
+    int ret = poll(pfd, n, timeout);
+    if ( 0 >= ret )
+        {
+        return ret;
+        }
+
+    for ( int i = 0; i < n; i++ )
+        {
+        if (pfd[i].revents & POLLIN)
+            {
+            queues[i]->setMsg(true);
+            }
+        }
+
+    return ret;
+}
+
 
 /**
    @briefWait for message in maximum three different queues with a timeout
@@ -315,8 +572,9 @@ void MessageQueue::setMsg(bool hasMsg)
    @param queue1 First queue. At least this should be set to a valid queue pointer
    @param queue2 Second queue. Optional.
    @param queue3 Third queue. Optional.
-   @param timeout The timeout value (in micro secs) to wait for a message in any of the queues
-   @return android::NO_ERROR On success
+   @param timeout The timeout value (in milli secs) to wait for a message in
+                  any of the queues, negative to wait forever
+   @return Number of queues with messages, 0 on timeout
    @return android::BAD_VALUE If queue1 is NULL
    @return android::NO_INIT If the file read descriptor of any of the provided queues is not set
  */
@@ -324,8 +582,10 @@ android::status_t MessageQueue::waitForMsg(MessageQueue *queue1, MessageQueue *q
     {
     LOG_FUNCTION_NAME;
 
-    int n =1;
-    struct pollfd pfd[3];
+    MessageQueue *queues[3];
+    MessageQueue *candidates[3] = { queue1, queue2, queue3 };
+    int n = 0;
+    int ret = 0;
 
     if(!queue1)
         {
@@ -334,80 +594,100 @@ android::status_t MessageQueue::waitForMsg(MessageQueue *queue1, MessageQueue *q
         return android::BAD_VALUE;
         }
 
-    pfd[0].fd = queue1->getInFd();
-    if(!pfd[0].fd)
+    for ( int i = 0; i < 3; i++ )
         {
-        MSGQ_LOGEA("read descriptor not initialized for message queue1");
-        LOG_FUNCTION_NAME_EXIT;
-        return android::NO_INIT;
-        }
-    pfd[0].events = POLLIN;
-    pfd[0].revents = 0;
-    if(queue2)
-        {
-        MSGQ_LOGDA("queue2 not-null");
-        pfd[1].fd = queue2->getInFd();
-        if(!pfd[1].fd)
+        if ( !candidates[i] )
             {
-            MSGQ_LOGEA("read descriptor not initialized for message queue2");
-            LOG_FUNCTION_NAME_EXIT;
-            return android::NO_INIT;
+            continue;
             }
 
-        pfd[1].events = POLLIN;
-        pfd[1].revents = 0;
-        n++;
-        }
-
-    if(queue3)
-        {
-        MSGQ_LOGDA("queue3 not-null");
-        pfd[2].fd = queue3->getInFd();
-        if(!pfd[2].fd)
+        if ( !candidates[i]->fd_read )
             {
-            MSGQ_LOGEA("read descriptor not initialized for message queue3");
+            MSGQ_LOGEB("read descriptor not initialized for message queue%d", i + 1);
             LOG_FUNCTION_NAME_EXIT;
             return android::NO_INIT;
             }
 
-        pfd[2].events = POLLIN;
-        pfd[2].revents = 0;
-        n++;
+        queues[n++] = candidates[i];
         }
 
+    Waiter waiter;
+    int registered = 0;
+    bool shared = false;
 
-    int ret = poll(pfd, n, timeout);
-    if(ret==0)
+    for ( ; registered < n; registered++ )
         {
-        LOG_FUNCTION_NAME_EXIT;
-        return ret;
+        if ( !queues[registered]->addWaiter(&waiter) )
+            {
+            shared = true;
+            break;
+            }
         }
 
-    if(ret<android::NO_ERROR)
+    if ( !shared )
         {
-        MSGQ_LOGEB("Message queue returned error %d", ret);
-        LOG_FUNCTION_NAME_EXIT;
-        return ret;
-        }
+        nsecs_t deadline = 0;
 
-    if (pfd[0].revents & POLLIN)
-        {
-        queue1->setMsg(true);
-        }
+        if ( 0 < timeout )
+            {
+            deadline = systemTime(SYSTEM_TIME_MONOTONIC) + milliseconds_to_nanoseconds(timeout);
+            }
 
-    if(queue2)
-        {
-        if (pfd[1].revents & POLLIN)
+        for ( ;; )
             {
-            queue2->setMsg(true);
+            ret = 0;
+            for ( int i = 0; i < n; i++ )
+                {
+                if ( !queues[i]->isEmpty() )
+                    {
+                    ret++;
+                    }
+                }
+
+            if ( ret || (0 == timeout) )
+                {
+                break;
+                }
+
+            if ( 0 > timeout )
+                {
+                futexWait(&waiter.woken, 0, NULL);
+                }
+            else
+                {
+                nsecs_t left = deadline - systemTime(SYSTEM_TIME_MONOTONIC);
+                struct timespec ts;
+
+                if ( 0 >= left )
+                    {
+                    timeout = 0;
+                    continue;
+                    }
+
+                ts.tv_sec = left / 1000000000LL;
+                ts.tv_nsec = left % 1000000000LL;
+                futexWait(&waiter.woken, 0, &ts);
+                }
+
+            ///The message may already be gone to another reader, re-arm and check again.
+            ///The re-arm store must be visible before mCount is read locklessly, or a
+            ///put() in between is missed and the futex wait never returns
+            waiter.woken = 0;
+            __sync_synchronize();
             }
         }
 
-    if(queue3)
+    for ( int i = 0; i < registered; i++ )
+        {
+        queues[i]->removeWaiter(&waiter);
+        }
+
+    if ( shared )
         {
-        if (pfd[2].revents & POLLIN)
+        ret = pollForMsg(queues, n, timeout);
+        if ( ret < android::NO_ERROR )
             {
-            queue3->setMsg(true);
+            MSGQ_LOGEB("Message queue returned error %d", ret);
             }
         }
 
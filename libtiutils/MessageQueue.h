@@ -21,6 +21,7 @@
 
 #include "DebugUtils.h"
 #include <stdint.h>
+#include <utils/threads.h>
 
 #ifdef MSGQ_DEBUG
 #   define MSGQ_LOGDA DBGUTILS_LOGDA
@@ -48,10 +49,29 @@ struct Message
 };
 
 ///Message queue implementation
+///Messages are kept in a bounded in-memory ring and waitForMsg() sleeps on
+///a condition the queues signal directly. The input file descriptor is a
+///doorbell kept readable while the ring holds messages, for code that wants
+///to poll it together with other descriptors; it is only maintained once
+///getInFd() has been called.
+///Each queue has a few priority lanes, get() always takes the oldest message
+///of the highest non-empty lane so control messages do not wait behind a
+///backlog of frames.
 class MessageQueue
 {
 public:
 
+    ///Number of messages the ring can grow to before put() blocks, a bit
+    ///more than what the pipe this replaced could buffer
+    enum { CAPACITY = 2048 };
+
+    ///Priority lanes, a lower value is served first
+    enum Priority {
+        PRIORITY_HIGH = 0,
+        PRIORITY_NORMAL,
+        PRIORITY_COUNT
+    };
+
     MessageQueue();
     ~MessageQueue();
 
@@ -65,7 +85,7 @@ public:
     void setInFd(int fd);
 
     ///Queue a message
-    android::status_t put(Message*);
+    android::status_t put(Message*, Priority priority = PRIORITY_NORMAL);
 
     ///Returns if the message queue is empty or not
     bool isEmpty();
@@ -84,9 +104,37 @@ public:
     }
 
 private:
+    struct Waiter;
+
+    ///Ring of messages of a single priority
+    struct Lane
+    {
+        Message *ring;
+        unsigned int size;
+        unsigned int head;
+        unsigned int count;
+    };
+
+    void ringDoorbell();
+    void drainDoorbell();
+    void enableDoorbell();
+    bool grow(Lane &lane);
+    bool addWaiter(Waiter *waiter);
+    void removeWaiter(Waiter *waiter);
+    static int pollForMsg(MessageQueue **queues, int n, int timeout);
+
     int fd_read;
     int fd_write;
     bool mHasMsg;
+
+    android::Mutex mLock;
+    android::Condition mNotEmpty;
+    android::Condition mNotFull;
+    Lane mLanes[PRIORITY_COUNT];
+    volatile unsigned int mCount;   ///Messages in all lanes
+    Waiter *mWaiter;        ///Thread sleeping in waitForMsg() on this queue
+    bool mDoorbell;         ///Input descriptor is kept in sync with the ring
+    bool mRung;             ///Input descriptor is currently readable
 };
 
 } // namespace Utils
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures MessageQueue round-trip latency between two threads and the
+ * cost of queueing a burst of messages.
+ *
+ * usage: msgqueue_bench [iterations]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "MessageQueue.h"
+
+using Ti::Utils::Message;
+using Ti::Utils::MessageQueue;
+
+static MessageQueue gPing;
+static MessageQueue gPong;
+
+static double nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+///Echoes every ping back, the way a HAL worker thread waits for commands
+static void *echoThread(void *)
+{
+    Message msg;
+
+    for ( ;; ) {
+        MessageQueue::waitForMsg(&gPing, NULL, NULL, -1);
+        gPing.get(&msg);
+        gPong.put(&msg);
+        if ( 0 == msg.command ) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+    int burst = MessageQueue::CAPACITY / 2;
+    double *samples;
+    pthread_t thread;
+    Message msg;
+
+    if ( iterations <= 0 ) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    samples = (double *) malloc(iterations * sizeof(double));
+    if ( !samples ) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    pthread_create(&thread, NULL, echoThread, NULL);
+
+    for ( int i = 0; i < iterations; i++ ) {
+        double start = nowUs();
+
+        msg.command = 1;
+        msg.id = i;
+        gPing.put(&msg);
+        MessageQueue::waitForMsg(&gPong, NULL, NULL, -1);
+        gPong.get(&msg);
+        samples[i] = nowUs() - start;
+
+        if ( msg.id != i ) {
+            fprintf(stderr, "out of order reply %lld, expected %d\n", (long long) msg.id, i);
+            return 1;
+        }
+    }
+
+    msg.command = 0;
+    gPing.put(&msg);
+    gPong.get(&msg);
+    pthread_join(thread, NULL);
+
+    qsort(samples, iterations, sizeof(double), compareDouble);
+    printf("round trip over %d iterations: median %.1fus p99 %.1fus max %.1fus\n",
+           iterations, samples[iterations / 2], samples[iterations * 99 / 100],
+           samples[iterations - 1]);
+
+    double start = nowUs();
+    for ( int i = 0; i < burst; i++ ) {
+        msg.id = i;
+        gPing.put(&msg);
+    }
+    double queued = nowUs();
+    for ( int i = 0; i < burst; i++ ) {
+        gPing.get(&msg);
+        if ( msg.id != i ) {
+            fprintf(stderr, "burst out of order %lld, expected %d\n", (long long) msg.id, i);
+            return 1;
+        }
+    }
+    printf("burst of %d: put %.2fus/msg get %.2fus/msg, empty after: %s\n",
+           burst, (queued - start) / burst, (nowUs() - queued) / burst,
+           gPing.isEmpty() ? "yes" : "NO");
+
+    free(samples);
+    return 0;
+}
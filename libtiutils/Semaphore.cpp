@@ -18,12 +18,52 @@
 
 #include "Semaphore.h"
 #include "ErrorUtils.h"
+#include "DebugUtils.h"
 #include <utils/Log.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <time.h>
 
 namespace Ti {
 namespace Utils {
 
+///Spin budget bounds, in TryWait() attempts
+#define SEM_SPIN_MIN 16
+#define SEM_SPIN_MAX 2048
+#define SEM_SPIN_DEFAULT 256
+
+static int64_t monotonicNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+///Spinning only helps when the signalling thread can run meanwhile
+static bool spinAllowed()
+{
+    static int cpus = 0;
+
+    if ( 0 == cpus )
+        {
+        cpus = sysconf(_SC_NPROCESSORS_CONF);
+        }
+
+    return 1 < cpus;
+}
+
+static inline void cpuRelax()
+{
+#if defined(__arm__) && defined(__ARM_ARCH_7A__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
 /**
    @brief Constructor for the semaphore class
 
@@ -31,9 +71,12 @@ namespace Utils {
    @return none
  */
 Semaphore::Semaphore()
+    : mCreated(false)
+    , mCount(0)
+    , mWaiters(0)
+    , mSpin(SEM_SPIN_DEFAULT)
 {
-    ///Initialize the semaphore to NULL
-    mSemaphore = NULL;
+    memset(&mStats, 0, sizeof(mStats));
 }
 
 /**
@@ -61,13 +104,9 @@ status_t Semaphore::Release()
     int status = 0;
 
     ///Destroy only if the semaphore has been created
-    if(mSemaphore)
+    if(mCreated)
         {
-        status = sem_destroy(mSemaphore);
-
-        free(mSemaphore);
-
-        mSemaphore = NULL;
+        mCreated = false;
         }
 
     ///Initialize the semaphore and return the status
@@ -80,7 +119,6 @@ status_t Semaphore::Release()
 
    @param count >=0
    @return NO_ERROR On Success
-   @return NO_MEMORY If unable to allocate memory for the semaphore
    @return BAD_VALUE If an invalid count value is passed (<0)
    @return One of the android error codes based on semaphore initialization
  */
@@ -101,18 +139,149 @@ status_t Semaphore::Create(int count)
         return ret;
         }
 
-    ///allocate memory for the semaphore
-    mSemaphore = (sem_t*)malloc(sizeof(sem_t)) ;
+    mCount = count;
+    mCreated = true;
+
+    return NO_ERROR;
+
+}
+
+/**
+   @brief Take the semaphore if its count is positive, never blocks
+
+   @param none
+   @return true If the count was decremented
+ */
+bool Semaphore::TryWait()
+{
+    int32_t count = mCount;
 
-    ///if memory is unavailable, return error
-    if(!mSemaphore)
+    while ( 0 < count )
         {
-        return NO_MEMORY;
+        int32_t prev = __sync_val_compare_and_swap(&mCount, count, count - 1);
+
+        if ( prev == count )
+            {
+            return true;
+            }
+
+        count = prev;
         }
 
-    ///Initialize the semaphore and return the status
-    return ErrorUtils::posixToAndroidError(sem_init(mSemaphore, 0x00, count));
+    return false;
+}
+
+/**
+   @brief Record one finished wait
+
+   @param waited Time spent waiting in nanoseconds
+   @param spun Whether the wait was satisfied while spinning
+   @param blocked Whether the waiter slept in the kernel
+   @param timedOut Whether the wait expired
+   @return none
+ */
+void Semaphore::Account(int64_t waited, bool spun, bool blocked, bool timedOut)
+{
+    android::AutoMutex lock(mStatsLock);
+
+    mStats.waits++;
+    mStats.totalWait += waited;
+
+    if ( waited > mStats.maxWait )
+        {
+        mStats.maxWait = waited;
+        }
+
+    if ( spun )
+        {
+        mStats.spinHits++;
+        }
+
+    if ( blocked )
+        {
+        mStats.blocks++;
+        }
 
+    if ( timedOut )
+        {
+        mStats.timeouts++;
+        }
+}
+
+/**
+   @brief Spin, then sleep on the futex until the count can be taken
+
+   @param timeoutMicroSecs The timeout period in micro seconds, negative to wait forever
+   @return NO_ERROR On success
+   @return TIMED_OUT If the timeout expired first
+ */
+status_t Semaphore::WaitFor(int timeoutMicroSecs)
+{
+    if ( TryWait() )
+        {
+        Account(0, false, false, false);
+        return NO_ERROR;
+        }
+
+    int64_t start = monotonicNs();
+    int32_t spin = spinAllowed() ? mSpin : 0;
+
+    for ( int32_t i = 0; i < spin; i++ )
+        {
+        cpuRelax();
+
+        if ( TryWait() )
+            {
+            ///Paid off, allow a little more spinning next time
+            if ( mSpin < SEM_SPIN_MAX )
+                {
+                mSpin = spin + spin / 8 + 1;
+                }
+
+            Account(monotonicNs() - start, true, false, false);
+            return NO_ERROR;
+            }
+        }
+
+    if ( spin && (mSpin > SEM_SPIN_MIN) )
+        {
+        mSpin = spin - spin / 4;
+        }
+
+    int64_t deadline = start + (int64_t) timeoutMicroSecs * 1000LL;
+    status_t ret = NO_ERROR;
+
+    __sync_fetch_and_add(&mWaiters, 1);
+
+    while ( !TryWait() )
+        {
+        struct timespec ts;
+        struct timespec *timeout = NULL;
+
+        if ( 0 <= timeoutMicroSecs )
+            {
+            int64_t left = deadline - monotonicNs();
+
+            if ( 0 >= left )
+                {
+                ret = TIMED_OUT;
+                break;
+                }
+
+            ts.tv_sec = left / 1000000000LL;
+            ts.tv_nsec = left % 1000000000LL;
+            timeout = &ts;
+            }
+
+        ///Returns straight away if a Signal() raised the count in the meantime
+        syscall(__NR_futex, &mCount, FUTEX_WAIT, 0, timeout, NULL, 0);
+        }
+
+    __sync_fetch_and_sub(&mWaiters, 1);
+
+    Account(monotonicNs() - start, false, true, TIMED_OUT == ret);
+
+    return ret;
 }
 
 /**
@@ -126,13 +295,13 @@ status_t Semaphore::Create(int count)
 status_t Semaphore::Wait()
 {
     ///semaphore should have been created first
-    if(!mSemaphore)
+    if(!mCreated)
         {
         return BAD_VALUE;
         }
 
     ///Wait and return the status after signalling
-    return ErrorUtils::posixToAndroidError(sem_wait(mSemaphore));
+    return WaitFor(-1);
 
 
 }
@@ -150,13 +319,20 @@ status_t Semaphore::Wait()
 status_t Semaphore::Signal()
 {
     ///semaphore should have been created first
-    if(!mSemaphore)
+    if(!mCreated)
         {
         return BAD_VALUE;
         }
 
-    ///Post to the semaphore
-    return ErrorUtils::posixToAndroidError(sem_post(mSemaphore));
+    ///Post to the semaphore, waiters only sleep after announcing themselves
+    __sync_fetch_and_add(&mCount, 1);
+
+    if ( 0 < mWaiters )
+        {
+        syscall(__NR_futex, &mCount, FUTEX_WAKE, 1, NULL, NULL, 0);
+        }
+
+    return NO_ERROR;
 
 }
 
@@ -168,18 +344,13 @@ status_t Semaphore::Signal()
  */
 int Semaphore::Count()
 {
-    int val;
-
     ///semaphore should have been created first
-    if(!mSemaphore)
+    if(!mCreated)
         {
         return BAD_VALUE;
         }
 
-    ///get the value of the semaphore
-    sem_getvalue(mSemaphore, &val);
-
-    return val;
+    return mCount;
 }
 
 /**
@@ -188,45 +359,69 @@ int Semaphore::Count()
      @param timeoutMicroSecs The timeout period in micro seconds
      @return BAD_VALUE if the semaphore is not initialized
      @return NO_ERROR On success
-     @return One of the android error codes based on semaphore wait operation
+     @return TIMED_OUT If the timeout expired before the semaphore was signalled
    */
 
 status_t Semaphore::WaitTimeout(int timeoutMicroSecs)
 {
     status_t ret = NO_ERROR;
 
-    struct timespec timeSpec;
-    struct timeval currentTime;
-
     ///semaphore should have been created first
-    if( NULL == mSemaphore)
+    if( !mCreated )
         {
         ret = BAD_VALUE;
         }
 
     if ( NO_ERROR == ret )
         {
-
-        ///setup the timeout values - timeout is specified in seconds and nanoseconds
-        gettimeofday(&currentTime, NULL);
-        timeSpec.tv_sec = currentTime.tv_sec;
-        timeSpec.tv_nsec = currentTime.tv_usec * 1000;
-        timeSpec.tv_sec += ( timeoutMicroSecs / 1000000 );
-        timeSpec.tv_nsec += ( timeoutMicroSecs % 1000000) * 1000;
-
         ///Wait for the timeout or signal and return the result based on whichever event occurred first
-        ret = sem_timedwait(mSemaphore, &timeSpec);
+        ret = WaitFor(( 0 > timeoutMicroSecs ) ? 0 : timeoutMicroSecs);
         }
 
-    if ( NO_ERROR != ret )
+    if ( TIMED_OUT == ret )
       {
-        Signal();
-        Create(0);
+        ///Drop whatever arrives late, the next command starts from zero
+        mCount = 0;
       }
 
     return ret;
 }
 
+/**
+   @brief Copy of the wait statistics gathered since construction
+
+   @param stats Filled with the statistics
+   @return none
+ */
+void Semaphore::GetStats(Stats &stats)
+{
+    android::AutoMutex lock(mStatsLock);
+
+    stats = mStats;
+}
+
+/**
+   @brief Log the wait statistics under the given name
+
+   @param name Name of the semaphore in the log
+   @return none
+ */
+void Semaphore::DumpStats(const char *name)
+{
+    Stats stats;
+
+    GetStats(stats);
+
+    if ( 0 == stats.waits )
+        {
+        return;
+        }
+
+    DBGUTILS_LOGDB("%s: %u waits, %u spun, %u blocked, %u timed out, avg %lld us, max %lld us",
+                   name, stats.waits, stats.spinHits, stats.blocks, stats.timeouts,
+                   stats.totalWait / stats.waits / 1000, stats.maxWait / 1000);
+}
+
 
 } // namespace Utils
 } // namespace Ti
@@ -17,7 +17,8 @@
 
 
 #include <utils/Errors.h>
-#include <semaphore.h>
+#include <utils/threads.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -29,10 +30,25 @@
 namespace Ti {
 namespace Utils {
 
+///Counting semaphore on a futex word
+///Waiters spin briefly before sleeping in the kernel, OMX callbacks usually
+///signal within a few microseconds of the command being sent. The spin budget
+///adapts to how often spinning pays off on each semaphore.
 class Semaphore
 {
 public:
 
+    ///Wait statistics, times in nanoseconds
+    struct Stats
+    {
+        uint32_t waits;     ///Completed Wait()/WaitTimeout() calls
+        uint32_t spinHits;  ///Waits satisfied while spinning
+        uint32_t blocks;    ///Waits that slept in the kernel
+        uint32_t timeouts;  ///WaitTimeout() calls that expired
+        int64_t totalWait;
+        int64_t maxWait;
+    };
+
     Semaphore();
     ~Semaphore();
 
@@ -54,10 +70,27 @@ public:
     ///Wait operation with a timeout
     status_t WaitTimeout(int timeoutMicroSecs);
 
+    ///Copy of the wait statistics gathered since construction
+    void GetStats(Stats &stats);
+
+    ///Log the wait statistics under the given name
+    void DumpStats(const char *name);
+
 private:
-    sem_t *mSemaphore;
+    bool TryWait();
+    status_t WaitFor(int timeoutMicroSecs);
+    void Account(int64_t waited, bool spun, bool blocked, bool timedOut);
+
+    bool mCreated;
+    volatile int32_t mCount;
+    volatile int32_t mWaiters;
+    volatile int32_t mSpin;     ///Current spin budget, in TryWait() attempts
+
+    android::Mutex mStatsLock;
+    Stats mStats;
 
 };
 
 } // namespace Utils
 } // namespace Ti
+
@@ -450,7 +450,16 @@ ifeq ($(call kernel-version-at-least,3,0),true)
 PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK ?= 1
 endif
 endif
+# Pages kept zeroed by a background thread for PVRSRV_MEM_ZERO allocations
+PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES ?= 1024
+ifneq ($(PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES),0)
+include ../kernel_version.mk
+ifeq ($(call kernel-version-at-least,3,0),true)
+PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK ?= 1
+endif
+endif
 $(eval $(call KernelConfigC,PVR_LINUX_MEM_AREA_POOL_MAX_PAGES,$(PVR_LINUX_MEM_AREA_POOL_MAX_PAGES)))
+$(eval $(call KernelConfigC,PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES,$(PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES)))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_MEM_AREA_USE_VMAP,))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK,))
 
@@ -501,6 +510,7 @@ $(eval $(call TunableBothConfigC,FPGA,))
 $(eval $(call TunableBothConfigC,PDUMP,))
 $(eval $(call TunableBothConfigC,NO_HARDWARE,))
 $(eval $(call TunableBothConfigC,PDUMP_DEBUG_OUTFILES,))
+$(eval $(call TunableKernelConfigC,PDUMP_STREAM_BUFFER_PAGES,))
 $(eval $(call TunableBothConfigC,PVRSRV_USSE_EDM_STATUS_DEBUG,))
 $(eval $(call TunableBothConfigC,SGX_DISABLE_VISTEST_SUPPORT,))
 $(eval $(call TunableBothConfigC,PVRSRV_RESET_ON_HWTIMEOUT,))
@@ -519,11 +529,13 @@ $(eval $(call TunableBothConfigC,SUPPORT_NV12_FROM_2_HWADDRS,))
 $(eval $(call TunableKernelConfigC,SUPPORT_LINUX_X86_WRITECOMBINE,1))
 $(eval $(call TunableKernelConfigC,SUPPORT_LINUX_X86_PAT,1))
 $(eval $(call TunableKernelConfigC,SGX_DYNAMIC_TIMING_INFO,))
+$(eval $(call TunableKernelConfigC,DEBUG_BRIDGE_LOCK_STATS,))
 $(eval $(call TunableKernelConfigC,SYS_SGX_ACTIVE_POWER_LATENCY_MS,))
 $(eval $(call TunableKernelConfigC,SYS_CUSTOM_POWERLOCK_WRAP,))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_USING_WORKQUEUES,))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_MISR_USING_WORKQUEUE,))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_MISR_USING_PRIVATE_WORKQUEUE,))
+$(eval $(call TunableKernelConfigC,PVR_LINUX_MISR_USING_KTHREAD,))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_TIMERS_USING_WORKQUEUES,))
 $(eval $(call TunableKernelConfigC,PVR_LINUX_TIMERS_USING_SHARED_WORKQUEUE,))
 $(eval $(call TunableKernelConfigC,LDM_PLATFORM,))
@@ -534,7 +546,13 @@ $(eval $(call TunableKernelConfigC,LDM_PCI,))
 $(eval $(call TunableKernelConfigC,PVRSRV_DUMP_MK_TRACE,))
 $(eval $(call TunableKernelConfigC,PVRSRV_DUMP_KERNEL_CCB,))
 $(eval $(call TunableKernelConfigC,PVRSRV_REFCOUNT_DEBUG,))
+$(eval $(call TunableKernelConfigC,PVRSRV_REFCOUNT_STATS,))
 $(eval $(call TunableKernelConfigC,PVRSRV_MMU_MAKE_READWRITE_ON_DEMAND,))
+$(eval $(call TunableKernelConfigC,PVRSRV_BM_CACHE_MAX_BYTES,8388608))
+$(eval $(call TunableKernelConfigC,PVRSRV_BM_CACHE_MAX_AGE_MS,))
+$(eval $(call TunableKernelConfigC,PVRSRV_EVENT_OBJECT_SPIN_US,))
+$(eval $(call TunableKernelConfigC,SGX_KICK_STATS,))
+$(eval $(call TunableKernelConfigC,SGX_HWPERF_PROC,))
 $(eval $(call TunableKernelConfigC,HYBRID_SHARED_PB_SIZE,))
 $(eval $(call TunableKernelConfigC,SUPPORT_LARGE_GENERAL_HEAP,))
 $(eval $(call TunableKernelConfigC,TTRACE,))
@@ -0,0 +1,174 @@
+/*************************************************************************/ /*!
+@Title          ION/gralloc buffer class driver structures and prototypes
+@Copyright      Copyright (c) Imagination Technologies Ltd. All Rights Reserved
+@License        Dual MIT/GPLv2
+
+The contents of this file are subject to the MIT license as set out below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+Alternatively, the contents of this file may be used under the terms of
+the GNU General Public License Version 2 ("GPL") in which case the provisions
+of GPL are applicable instead of those above.
+
+If you wish to allow use of your version of this file only under the terms of
+GPL, and not to allow others to use your version of this file under the terms
+of the MIT license, indicate your decision by deleting the provisions above
+and replace them with the notice and other provisions required by GPL as set
+out in the file called "GPL-COPYING" included in this distribution. If you do
+not delete the provisions above, a recipient may use your version of this file
+under the terms of either the MIT license or GPL.
+
+This License is also included in this distribution in the file called
+"MIT-COPYING".
+
+EXCEPT AS OTHERWISE STATED IN A NEGOTIATED AGREEMENT: (A) THE SOFTWARE IS
+PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT; AND (B) IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/ /**************************************************************************/
+
+/**************************************************************************
+ A buffer class device whose buffers are ION or gralloc buffers handed in
+ from user space, so camera or decoder frames can be sampled by SGX where
+ they are (IMG_texture_stream) instead of being copied into a texture.
+
+ The producer (camera HAL, decoder) opens /dev/bcion and sets the buffer
+ list once, passing one fd per buffer: an ION share fd or the fd of a
+ gralloc buffer. The driver takes its own reference and builds the page
+ list; nothing is copied or remapped. Services opens the device when the
+ first GL stream binds it and sees the list fixed from then on.
+
+ The only per frame handoff is the sync object services gives each
+ buffer: before writing a new frame into a buffer the producer asks
+ whether SGX has finished reading it (BCIO_ION_BUFFER_IDLE).
+ **************************************************************************/
+
+#ifndef __BC_ION_H__
+#define __BC_ION_H__
+
+#include <linux/ioctl.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BC_ION_MAX_BUFFERS	16
+#define BC_ION_MAX_PLANES	2	/* NV12 from the tiler is a Y and a UV handle */
+
+#define BC_ION_DEVICE_NAME	"bcion"
+
+/*
+	User space interface, shared with the producers.
+*/
+typedef struct BC_ION_IOCTL_BUFFERS_TAG
+{
+	unsigned int	ui32Count;
+	unsigned int	ui32Width;
+	unsigned int	ui32Height;
+	unsigned int	ui32ByteStride;			/* of the first plane */
+	unsigned int	ui32PixelFormat;		/* PVRSRV_PIXEL_FORMAT */
+	int				aiFd[BC_ION_MAX_BUFFERS];
+} BC_ION_IOCTL_BUFFERS;
+
+typedef struct BC_ION_IOCTL_IDLE_TAG
+{
+	unsigned int	ui32Index;
+	unsigned int	ui32Idle;				/* out: SGX has no read pending */
+} BC_ION_IOCTL_IDLE;
+
+#define BCIO_ION_SET_BUFFERS		_IOW('B', 0x40, BC_ION_IOCTL_BUFFERS)
+#define BCIO_ION_RELEASE_BUFFERS	_IO('B', 0x41)
+#define BCIO_ION_BUFFER_IDLE		_IOWR('B', 0x42, BC_ION_IOCTL_IDLE)
+
+#if defined(__KERNEL__)
+
+extern IMG_BOOL IMG_IMPORT PVRGetBufferClassJTable(PVRSRV_BC_BUFFER2SRV_KMJTABLE *psJTable);
+
+typedef void *       BC_HANDLE;
+
+typedef struct BC_ION_BUFFER_TAG
+{
+	/* one entry per page, all planes one after the other */
+	IMG_SYS_PHYADDR				*psSysAddr;
+	IMG_UINT32					ui32ByteSize;
+
+	/* the references that keep the pages, see bc_ion_linux.c */
+	BC_HANDLE					hImport;
+
+	PVRSRV_SYNC_DATA			*psSyncData;
+} BC_ION_BUFFER;
+
+/* kernel device information structure */
+typedef struct BC_ION_DEVINFO_TAG
+{
+	IMG_UINT32					ui32DeviceID;
+
+	BUFFER_INFO					sBufferInfo;
+	BC_ION_BUFFER				asBuffer[BC_ION_MAX_BUFFERS];
+
+	/* services opens, the buffer list cannot change while non zero */
+	IMG_UINT32					ui32RefCount;
+
+	/* jump table into PVR services */
+	PVRSRV_BC_BUFFER2SRV_KMJTABLE	sPVRJTable;
+
+	/* jump table into BC */
+	PVRSRV_BC_SRV2BUFFER_KMJTABLE	sBCJTable;
+} BC_ION_DEVINFO;
+
+typedef enum _BC_ERROR_
+{
+	BC_OK								=  0,
+	BC_ERROR_GENERIC					=  1,
+	BC_ERROR_OUT_OF_MEMORY				=  2,
+	BC_ERROR_INVALID_PARAMS				=  3,
+	BC_ERROR_INIT_FAILURE				=  4,
+	BC_ERROR_BUSY						=  5,
+	BC_ERROR_DEVICE_REGISTER_FAILED		=  6
+} BC_ERROR;
+
+#ifndef UNREFERENCED_PARAMETER
+#define	UNREFERENCED_PARAMETER(param) (param) = (param)
+#endif
+
+BC_ERROR BCIonInit(void);
+BC_ERROR BCIonDeinit(void);
+
+BC_ERROR BCIonSetBuffers(const BC_ION_IOCTL_BUFFERS *psBuffers);
+BC_ERROR BCIonReleaseBuffers(void);
+BC_ERROR BCIonBufferIdle(IMG_UINT32 ui32Index, IMG_BOOL *pbIdle);
+
+/* OS Specific APIs */
+void BCIonLock(void);
+void BCIonUnlock(void);
+
+BC_ERROR BCIonImport(int iFd, BC_HANDLE *phImport,
+					 IMG_SYS_PHYADDR **ppsSysAddr, IMG_UINT32 *pui32ByteSize);
+void BCIonUnimport(BC_HANDLE hImport, IMG_SYS_PHYADDR *psSysAddr);
+
+void *AllocKernelMem(unsigned long ulSize);
+void FreeKernelMem  (void *pvMem);
+
+#endif /* __KERNEL__ */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __BC_ION_H__ */
+
+/******************************************************************************
+ End of file (bc_ion.h)
+******************************************************************************/
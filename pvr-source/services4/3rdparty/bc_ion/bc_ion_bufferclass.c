@@ -0,0 +1,369 @@
+/*************************************************************************/ /*!
+@Title          ION/gralloc buffer class driver, services interface
+@Copyright      Copyright (c) Imagination Technologies Ltd. All Rights Reserved
+@License        Dual MIT/GPLv2
+
+The contents of this file are subject to the MIT license as set out below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+Alternatively, the contents of this file may be used under the terms of
+the GNU General Public License Version 2 ("GPL") in which case the provisions
+of GPL are applicable instead of those above.
+
+If you wish to allow use of your version of this file only under the terms of
+GPL, and not to allow others to use your version of this file under the terms
+of the MIT license, indicate your decision by deleting the provisions above
+and replace them with the notice and other provisions required by GPL as set
+out in the file called "GPL-COPYING" included in this distribution. If you do
+not delete the provisions above, a recipient may use your version of this file
+under the terms of either the MIT license or GPL.
+
+This License is also included in this distribution in the file called
+"MIT-COPYING".
+
+EXCEPT AS OTHERWISE STATED IN A NEGOTIATED AGREEMENT: (A) THE SOFTWARE IS
+PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT; AND (B) IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/ /**************************************************************************/
+
+#if defined(__linux__)
+#include <linux/string.h>
+#else
+#include <string.h>
+#endif
+
+#include "img_defs.h"
+#include "servicesext.h"
+#include "kernelbuffer.h"
+#include "bc_ion.h"
+
+static BC_ION_DEVINFO *gpsDevInfo;
+
+/*
+	Services calls below come with the bridge lock held; BCIonLock only
+	orders them against the producer's ioctls.
+*/
+static PVRSRV_ERROR OpenBCDevice(IMG_UINT32 ui32DeviceID, IMG_HANDLE *phDevice)
+{
+	BC_ION_DEVINFO *psDevInfo = gpsDevInfo;
+	PVRSRV_ERROR eError = PVRSRV_OK;
+
+	UNREFERENCED_PARAMETER(ui32DeviceID);
+
+	BCIonLock();
+	if (psDevInfo->sBufferInfo.ui32BufferCount == 0)
+	{
+		/* GL would see a stream with no buffers until it is reopened */
+		eError = PVRSRV_ERROR_INVALID_DEVICE;
+	}
+	else
+	{
+		psDevInfo->ui32RefCount++;
+		*phDevice = (IMG_HANDLE)psDevInfo;
+	}
+	BCIonUnlock();
+
+	return eError;
+}
+
+static PVRSRV_ERROR CloseBCDevice(IMG_UINT32 ui32DeviceID, IMG_HANDLE hDevice)
+{
+	BC_ION_DEVINFO *psDevInfo = (BC_ION_DEVINFO *)hDevice;
+	IMG_UINT32 i;
+
+	UNREFERENCED_PARAMETER(ui32DeviceID);
+
+	BCIonLock();
+	if (psDevInfo->ui32RefCount != 0 && --psDevInfo->ui32RefCount == 0)
+	{
+		/* the sync objects go with services' per device buffers */
+		for (i = 0; i < BC_ION_MAX_BUFFERS; i++)
+		{
+			psDevInfo->asBuffer[i].psSyncData = IMG_NULL;
+		}
+	}
+	BCIonUnlock();
+
+	return PVRSRV_OK;
+}
+
+static PVRSRV_ERROR GetBCInfo(IMG_HANDLE hDevice, BUFFER_INFO *psBCInfo)
+{
+	BC_ION_DEVINFO *psDevInfo = (BC_ION_DEVINFO *)hDevice;
+
+	if (!hDevice || !psBCInfo)
+	{
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+
+	*psBCInfo = psDevInfo->sBufferInfo;
+
+	return PVRSRV_OK;
+}
+
+static PVRSRV_ERROR GetBCBuffer(IMG_HANDLE hDevice,
+								IMG_UINT32 ui32BufferNumber,
+								PVRSRV_SYNC_DATA *psSyncData,
+								IMG_HANDLE *phBuffer)
+{
+	BC_ION_DEVINFO *psDevInfo = (BC_ION_DEVINFO *)hDevice;
+
+	if (!hDevice || !phBuffer ||
+		ui32BufferNumber >= psDevInfo->sBufferInfo.ui32BufferCount)
+	{
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+
+	BCIonLock();
+	psDevInfo->asBuffer[ui32BufferNumber].psSyncData = psSyncData;
+	BCIonUnlock();
+
+	*phBuffer = (IMG_HANDLE)&psDevInfo->asBuffer[ui32BufferNumber];
+
+	return PVRSRV_OK;
+}
+
+static PVRSRV_ERROR GetBCBufferAddr(IMG_HANDLE         hDevice,
+									IMG_HANDLE         hBuffer,
+									IMG_SYS_PHYADDR  **ppsSysAddr,
+									IMG_SIZE_T        *pui32ByteSize,
+									IMG_VOID         **ppvCpuVAddr,
+									IMG_HANDLE        *phOSMapInfo,
+									IMG_BOOL          *pbIsContiguous,
+									IMG_UINT32        *pui32TilingStride)
+{
+	BC_ION_BUFFER *psBuffer = (BC_ION_BUFFER *)hBuffer;
+
+	if (!hDevice || !hBuffer || !ppsSysAddr || !pui32ByteSize)
+	{
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+
+	*ppsSysAddr = psBuffer->psSysAddr;
+	*pui32ByteSize = (IMG_SIZE_T)psBuffer->ui32ByteSize;
+
+	/* SGX only, the producer has its own mapping if it needs one */
+	*ppvCpuVAddr = IMG_NULL;
+	*phOSMapInfo = IMG_NULL;
+	*pbIsContiguous = IMG_FALSE;
+	UNREFERENCED_PARAMETER(pui32TilingStride);
+
+	return PVRSRV_OK;
+}
+
+static void FreeBuffers(BC_ION_BUFFER *psBuffers, IMG_UINT32 ui32Count)
+{
+	IMG_UINT32 i;
+
+	for (i = 0; i < ui32Count; i++)
+	{
+		BCIonUnimport(psBuffers[i].hImport, psBuffers[i].psSysAddr);
+		psBuffers[i].hImport = IMG_NULL;
+		psBuffers[i].psSysAddr = IMG_NULL;
+		psBuffers[i].ui32ByteSize = 0;
+	}
+}
+
+/*
+	Replaces the buffer list. Refused while services has the device open:
+	it read the count at open and keeps a sync object per buffer.
+
+	Importing a gralloc buffer takes the bridge lock, which services holds
+	when it calls in here, so the imports happen before BCIonLock and the
+	lists are only swapped under it.
+*/
+BC_ERROR BCIonSetBuffers(const BC_ION_IOCTL_BUFFERS *psBuffers)
+{
+	BC_ION_DEVINFO *psDevInfo = gpsDevInfo;
+	BC_ION_BUFFER asNew[BC_ION_MAX_BUFFERS];
+	BC_ION_BUFFER asOld[BC_ION_MAX_BUFFERS];
+	IMG_UINT32 ui32OldCount;
+	BC_ERROR eError = BC_OK;
+	IMG_UINT32 i;
+
+	if (psBuffers->ui32Count == 0 || psBuffers->ui32Count > BC_ION_MAX_BUFFERS ||
+		psBuffers->ui32Width == 0 || psBuffers->ui32Height == 0 ||
+		psBuffers->ui32ByteStride == 0)
+	{
+		return BC_ERROR_INVALID_PARAMS;
+	}
+
+	memset(asNew, 0, sizeof(asNew));
+
+	for (i = 0; i < psBuffers->ui32Count; i++)
+	{
+		eError = BCIonImport(psBuffers->aiFd[i], &asNew[i].hImport,
+							 &asNew[i].psSysAddr, &asNew[i].ui32ByteSize);
+		if (eError != BC_OK)
+		{
+			break;
+		}
+
+		if (asNew[i].ui32ByteSize < psBuffers->ui32ByteStride * psBuffers->ui32Height)
+		{
+			i++;
+			eError = BC_ERROR_INVALID_PARAMS;
+			break;
+		}
+	}
+
+	if (eError != BC_OK)
+	{
+		FreeBuffers(asNew, i);
+		return eError;
+	}
+
+	BCIonLock();
+
+	if (psDevInfo->ui32RefCount != 0)
+	{
+		BCIonUnlock();
+		FreeBuffers(asNew, psBuffers->ui32Count);
+		return BC_ERROR_BUSY;
+	}
+
+	ui32OldCount = psDevInfo->sBufferInfo.ui32BufferCount;
+	memcpy(asOld, psDevInfo->asBuffer, sizeof(asOld));
+	memcpy(psDevInfo->asBuffer, asNew, sizeof(asNew));
+
+	psDevInfo->sBufferInfo.ui32BufferCount = psBuffers->ui32Count;
+	psDevInfo->sBufferInfo.pixelformat = (PVRSRV_PIXEL_FORMAT)psBuffers->ui32PixelFormat;
+	psDevInfo->sBufferInfo.ui32Width = psBuffers->ui32Width;
+	psDevInfo->sBufferInfo.ui32Height = psBuffers->ui32Height;
+	psDevInfo->sBufferInfo.ui32ByteStride = psBuffers->ui32ByteStride;
+
+	BCIonUnlock();
+
+	FreeBuffers(asOld, ui32OldCount);
+
+	return BC_OK;
+}
+
+BC_ERROR BCIonReleaseBuffers(void)
+{
+	BC_ION_DEVINFO *psDevInfo = gpsDevInfo;
+	BC_ION_BUFFER asOld[BC_ION_MAX_BUFFERS];
+	IMG_UINT32 ui32OldCount;
+
+	BCIonLock();
+	if (psDevInfo->ui32RefCount != 0)
+	{
+		BCIonUnlock();
+		return BC_ERROR_BUSY;
+	}
+
+	ui32OldCount = psDevInfo->sBufferInfo.ui32BufferCount;
+	memcpy(asOld, psDevInfo->asBuffer, sizeof(asOld));
+	memset(psDevInfo->asBuffer, 0, sizeof(psDevInfo->asBuffer));
+	psDevInfo->sBufferInfo.ui32BufferCount = 0;
+	BCIonUnlock();
+
+	FreeBuffers(asOld, ui32OldCount);
+
+	return BC_OK;
+}
+
+/*
+	The buffer may be written again once SGX has done every read queued
+	on it. A buffer services never asked for has no sync object and is
+	always idle.
+*/
+BC_ERROR BCIonBufferIdle(IMG_UINT32 ui32Index, IMG_BOOL *pbIdle)
+{
+	BC_ION_DEVINFO *psDevInfo = gpsDevInfo;
+	PVRSRV_SYNC_DATA *psSyncData;
+	BC_ERROR eError = BC_OK;
+
+	BCIonLock();
+	if (ui32Index >= psDevInfo->sBufferInfo.ui32BufferCount)
+	{
+		eError = BC_ERROR_INVALID_PARAMS;
+	}
+	else
+	{
+		psSyncData = psDevInfo->asBuffer[ui32Index].psSyncData;
+		*pbIdle = (psSyncData == IMG_NULL) ||
+				  (psSyncData->ui32ReadOpsComplete == psSyncData->ui32ReadOpsPending);
+	}
+	BCIonUnlock();
+
+	return eError;
+}
+
+BC_ERROR BCIonInit(void)
+{
+	BC_ION_DEVINFO *psDevInfo;
+
+	psDevInfo = (BC_ION_DEVINFO *)AllocKernelMem(sizeof(*psDevInfo));
+	if (!psDevInfo)
+	{
+		return BC_ERROR_OUT_OF_MEMORY;
+	}
+	memset(psDevInfo, 0, sizeof(*psDevInfo));
+
+	/* services is already loaded, the table is reached by linkage */
+	if (!PVRGetBufferClassJTable(&psDevInfo->sPVRJTable))
+	{
+		FreeKernelMem(psDevInfo);
+		return BC_ERROR_INIT_FAILURE;
+	}
+
+	strncpy(psDevInfo->sBufferInfo.szDeviceName, BC_ION_DEVICE_NAME, MAX_BUFFER_DEVICE_NAME_SIZE);
+
+	psDevInfo->sBCJTable.ui32TableSize = sizeof(PVRSRV_BC_SRV2BUFFER_KMJTABLE);
+	psDevInfo->sBCJTable.pfnOpenBCDevice = OpenBCDevice;
+	psDevInfo->sBCJTable.pfnCloseBCDevice = CloseBCDevice;
+	psDevInfo->sBCJTable.pfnGetBCInfo = GetBCInfo;
+	psDevInfo->sBCJTable.pfnGetBCBuffer = GetBCBuffer;
+	psDevInfo->sBCJTable.pfnGetBufferAddr = GetBCBufferAddr;
+
+	if (psDevInfo->sPVRJTable.pfnPVRSRVRegisterBCDevice(&psDevInfo->sBCJTable,
+														&psDevInfo->ui32DeviceID) != PVRSRV_OK)
+	{
+		FreeKernelMem(psDevInfo);
+		return BC_ERROR_DEVICE_REGISTER_FAILED;
+	}
+	psDevInfo->sBufferInfo.ui32BufferDeviceID = psDevInfo->ui32DeviceID;
+
+	gpsDevInfo = psDevInfo;
+
+	return BC_OK;
+}
+
+BC_ERROR BCIonDeinit(void)
+{
+	BC_ION_DEVINFO *psDevInfo = gpsDevInfo;
+
+	if (psDevInfo == IMG_NULL)
+	{
+		return BC_ERROR_GENERIC;
+	}
+
+	if (psDevInfo->sPVRJTable.pfnPVRSRVRemoveBCDevice(psDevInfo->ui32DeviceID) != PVRSRV_OK)
+	{
+		return BC_ERROR_GENERIC;
+	}
+
+	FreeBuffers(psDevInfo->asBuffer, psDevInfo->sBufferInfo.ui32BufferCount);
+	FreeKernelMem(psDevInfo);
+	gpsDevInfo = IMG_NULL;
+
+	return BC_OK;
+}
+
+/******************************************************************************
+ End of file (bc_ion_bufferclass.c)
+******************************************************************************/
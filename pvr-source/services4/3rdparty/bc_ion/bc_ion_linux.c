@@ -0,0 +1,362 @@
+/*************************************************************************/ /*!
+@Title          ION/gralloc buffer class driver, Linux specific
+@Copyright      Copyright (c) Imagination Technologies Ltd. All Rights Reserved
+@License        Dual MIT/GPLv2
+
+The contents of this file are subject to the MIT license as set out below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+Alternatively, the contents of this file may be used under the terms of
+the GNU General Public License Version 2 ("GPL") in which case the provisions
+of GPL are applicable instead of those above.
+
+If you wish to allow use of your version of this file only under the terms of
+GPL, and not to allow others to use your version of this file under the terms
+of the MIT license, indicate your decision by deleting the provisions above
+and replace them with the notice and other provisions required by GPL as set
+out in the file called "GPL-COPYING" included in this distribution. If you do
+not delete the provisions above, a recipient may use your version of this file
+under the terms of either the MIT license or GPL.
+
+This License is also included in this distribution in the file called
+"MIT-COPYING".
+
+EXCEPT AS OTHERWISE STATED IN A NEGOTIATED AGREEMENT: (A) THE SOFTWARE IS
+PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT; AND (B) IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/ /**************************************************************************/
+
+#include <linux/version.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/scatterlist.h>
+#include <linux/uaccess.h>
+#include <linux/ion.h>
+#if defined(CONFIG_ION_OMAP)
+#include <linux/omap_ion.h>
+#else
+#error bc_ion needs the OMAP ION client exported by pvrsrvkm
+#endif
+
+#include "img_defs.h"
+#include "servicesext.h"
+#include "kernelbuffer.h"
+#include "bc_ion.h"
+#include "pvrmodule.h"
+
+#define DRVNAME "bcion"
+
+MODULE_SUPPORTED_DEVICE(DRVNAME);
+
+/* srvkm's client, and its export of a gralloc buffer fd to ION handles */
+extern struct ion_client *gpsIONClient;
+extern int PVRSRVExportFDToIONHandles(int fd, struct ion_client **client,
+									  struct ion_handle **handles,
+									  unsigned int *num_handles);
+
+static DEFINE_MUTEX(sBCIonMutex);
+
+/*
+	What keeps one buffer's pages alive: either our own ION handle, or a
+	reference on the gralloc buffer's file, whose handles srvkm owns.
+*/
+typedef struct BC_ION_IMPORT_TAG
+{
+	struct ion_handle	*psIonHandle;
+	struct file			*psFile;
+} BC_ION_IMPORT;
+
+void BCIonLock(void)
+{
+	mutex_lock(&sBCIonMutex);
+}
+
+void BCIonUnlock(void)
+{
+	mutex_unlock(&sBCIonMutex);
+}
+
+void *AllocKernelMem(unsigned long ulSize)
+{
+	return kmalloc(ulSize, GFP_KERNEL);
+}
+
+void FreeKernelMem(void *pvMem)
+{
+	kfree(pvMem);
+}
+
+/* Appends the pages of one ION handle to pasSysAddr, returns the count or -1 */
+static int AddHandlePages(struct ion_handle *psHandle, IMG_SYS_PHYADDR *pasSysAddr,
+						  IMG_UINT32 ui32Free)
+{
+	struct scatterlist *psSG;
+	IMG_UINT32 ui32Count = 0;
+	IMG_UINT32 j;
+
+#if defined(CONFIG_ION_OMAP)
+	{
+		u32 *pu32Pages;
+		int iNumPages;
+
+		/* 2D tiler buffers, as gralloc allocates NV12 */
+		if (omap_tiler_pages(gpsIONClient, psHandle, &iNumPages, &pu32Pages) == 0)
+		{
+			if (iNumPages <= 0 || (IMG_UINT32)iNumPages > ui32Free)
+			{
+				return -1;
+			}
+			for (j = 0; j < (IMG_UINT32)iNumPages; j++)
+			{
+				pasSysAddr[j].uiAddr = pu32Pages[j];
+			}
+			return iNumPages;
+		}
+	}
+#endif
+
+	psSG = ion_map_dma(gpsIONClient, psHandle);
+	if (IS_ERR_OR_NULL(psSG))
+	{
+		return -1;
+	}
+
+	for (; psSG; psSG = sg_next(psSG))
+	{
+		for (j = 0; j < psSG->length; j += PAGE_SIZE)
+		{
+			if (ui32Count == ui32Free)
+			{
+				ion_unmap_dma(gpsIONClient, psHandle);
+				return -1;
+			}
+			pasSysAddr[ui32Count++].uiAddr = sg_phys(psSG) + j;
+		}
+	}
+
+	/* the reference we hold keeps the pages, not the DMA mapping */
+	ion_unmap_dma(gpsIONClient, psHandle);
+
+	return (int)ui32Count;
+}
+
+/*
+	iFd is an ION share fd or a gralloc buffer fd. ion_import_fd rejects
+	anything that is not an ION fd, so it is tried first; srvkm's export
+	is only asked about fds it may own.
+*/
+BC_ERROR BCIonImport(int iFd, BC_HANDLE *phImport,
+					 IMG_SYS_PHYADDR **ppsSysAddr, IMG_UINT32 *pui32ByteSize)
+{
+	struct ion_handle *apsHandles[BC_ION_MAX_PLANES];
+	unsigned int uiNumHandles = BC_ION_MAX_PLANES;
+	BC_ION_IMPORT *psImport;
+	IMG_SYS_PHYADDR *pasSysAddr = IMG_NULL;
+	IMG_UINT32 ui32Pages = 0;
+	IMG_UINT32 ui32MaxPages = 0;
+	unsigned int i;
+	int iPages;
+
+	psImport = kzalloc(sizeof(*psImport), GFP_KERNEL);
+	if (!psImport)
+	{
+		return BC_ERROR_OUT_OF_MEMORY;
+	}
+
+	psImport->psIonHandle = ion_import_fd(gpsIONClient, iFd);
+	if (!IS_ERR_OR_NULL(psImport->psIonHandle))
+	{
+		apsHandles[0] = psImport->psIonHandle;
+		uiNumHandles = 1;
+	}
+	else
+	{
+		psImport->psIonHandle = NULL;
+
+		psImport->psFile = fget(iFd);
+		if (!psImport->psFile)
+		{
+			goto ExitFree;
+		}
+		if (PVRSRVExportFDToIONHandles(iFd, NULL, apsHandles, &uiNumHandles) != 0)
+		{
+			goto ExitFree;
+		}
+	}
+
+	for (i = 0; i < uiNumHandles; i++)
+	{
+		ui32MaxPages += PAGE_ALIGN(apsHandles[i]->buffer->size) >> PAGE_SHIFT;
+	}
+
+	pasSysAddr = vmalloc(sizeof(IMG_SYS_PHYADDR) * ui32MaxPages);
+	if (!pasSysAddr)
+	{
+		goto ExitFree;
+	}
+
+	for (i = 0; i < uiNumHandles; i++)
+	{
+		iPages = AddHandlePages(apsHandles[i], &pasSysAddr[ui32Pages], ui32MaxPages - ui32Pages);
+		if (iPages < 0)
+		{
+			printk(KERN_WARNING DRVNAME ": can't get the pages of fd %d plane %u\n", iFd, i);
+			goto ExitFree;
+		}
+		ui32Pages += (IMG_UINT32)iPages;
+	}
+
+	*phImport = (BC_HANDLE)psImport;
+	*ppsSysAddr = pasSysAddr;
+	*pui32ByteSize = ui32Pages << PAGE_SHIFT;
+
+	return BC_OK;
+
+ExitFree:
+	BCIonUnimport((BC_HANDLE)psImport, pasSysAddr);
+	return BC_ERROR_INVALID_PARAMS;
+}
+
+void BCIonUnimport(BC_HANDLE hImport, IMG_SYS_PHYADDR *psSysAddr)
+{
+	BC_ION_IMPORT *psImport = (BC_ION_IMPORT *)hImport;
+
+	if (psSysAddr)
+	{
+		vfree(psSysAddr);
+	}
+
+	if (!psImport)
+	{
+		return;
+	}
+
+	if (psImport->psIonHandle)
+	{
+		ion_free(gpsIONClient, psImport->psIonHandle);
+	}
+	if (psImport->psFile)
+	{
+		fput(psImport->psFile);
+	}
+	kfree(psImport);
+}
+
+static long BCIonIoctl(struct file *psFile, unsigned int uiCmd, unsigned long ulArg)
+{
+	void __user *pvArg = (void __user *)ulArg;
+
+	UNREFERENCED_PARAMETER(psFile);
+
+	switch (uiCmd)
+	{
+		case BCIO_ION_SET_BUFFERS:
+		{
+			BC_ION_IOCTL_BUFFERS sBuffers;
+			BC_ERROR eError;
+
+			if (copy_from_user(&sBuffers, pvArg, sizeof(sBuffers)))
+			{
+				return -EFAULT;
+			}
+
+			eError = BCIonSetBuffers(&sBuffers);
+			if (eError == BC_ERROR_BUSY)
+			{
+				return -EBUSY;
+			}
+			return (eError == BC_OK) ? 0 : -EINVAL;
+		}
+
+		case BCIO_ION_RELEASE_BUFFERS:
+			return (BCIonReleaseBuffers() == BC_OK) ? 0 : -EBUSY;
+
+		case BCIO_ION_BUFFER_IDLE:
+		{
+			BC_ION_IOCTL_IDLE sIdle;
+			IMG_BOOL bIdle;
+
+			if (copy_from_user(&sIdle, pvArg, sizeof(sIdle)))
+			{
+				return -EFAULT;
+			}
+			if (BCIonBufferIdle(sIdle.ui32Index, &bIdle) != BC_OK)
+			{
+				return -EINVAL;
+			}
+			sIdle.ui32Idle = bIdle ? 1 : 0;
+			if (copy_to_user(pvArg, &sIdle, sizeof(sIdle)))
+			{
+				return -EFAULT;
+			}
+			return 0;
+		}
+
+		default:
+			return -ENOTTY;
+	}
+}
+
+static const struct file_operations sBCIonFops =
+{
+	.owner			= THIS_MODULE,
+	.unlocked_ioctl	= BCIonIoctl,
+};
+
+static struct miscdevice sBCIonMiscDev =
+{
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= DRVNAME,
+	.fops	= &sBCIonFops,
+};
+
+static int __init BC_ION_Init(void)
+{
+	int iError;
+
+	if (BCIonInit() != BC_OK)
+	{
+		printk(KERN_WARNING DRVNAME ": can't register the buffer class device\n");
+		return -ENODEV;
+	}
+
+	iError = misc_register(&sBCIonMiscDev);
+	if (iError != 0)
+	{
+		(void)BCIonDeinit();
+		return iError;
+	}
+
+	return 0;
+}
+
+static void __exit BC_ION_Cleanup(void)
+{
+	misc_deregister(&sBCIonMiscDev);
+
+	if (BCIonDeinit() != BC_OK)
+	{
+		printk(KERN_INFO DRVNAME ": BC_ION_Cleanup: can't deinit device\n");
+	}
+}
+
+module_init(BC_ION_Init);
+module_exit(BC_ION_Cleanup);
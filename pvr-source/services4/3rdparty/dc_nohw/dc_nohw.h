@@ -276,6 +276,9 @@ void FreeKernelMem  (void *pvMem);
 
 DC_ERROR GetLibFuncAddr (DC_HANDLE hExtDrv, char *szFunctionName, PFN_DC_GET_PVRJTABLE *ppfnFuncTable);
 
+/* completes a flip at once or at the next synthetic vsync, see dc_nohw_linux.c */
+IMG_BOOL QueueFlipComplete(DC_NOHW_DEVINFO *psDevInfo, IMG_HANDLE hCmdCookie);
+
 #if defined(__cplusplus)
 }
 #endif
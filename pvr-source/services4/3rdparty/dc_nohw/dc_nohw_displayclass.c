@@ -643,10 +643,8 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE	hCmdCookie,
 		return (IMG_FALSE);
 	}
 
-	/* call command complete Callback */
-	psDevInfo->sPVRJTable.pfnPVRSRVCmdComplete(hCmdCookie, IMG_FALSE);
-
-	return (IMG_TRUE);
+	/* call command complete Callback, now or at the synthetic vsync */
+	return QueueFlipComplete(psDevInfo, hCmdCookie);
 }
 
 
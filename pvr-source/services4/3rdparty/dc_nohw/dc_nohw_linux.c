@@ -78,6 +78,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #if defined(SUPPORT_DRI_DRM)
 #include <drm/drmP.h>
@@ -167,6 +174,159 @@ IMG_BOOL GetBufferDimensions(IMG_UINT32 *pui32Width, IMG_UINT32 *pui32Height, PV
 }
 #endif	/* defined(DC_NOHW_GET_BUFFER_DIMENSIONS) */
 
+/*
+ Benchmark display: with refresh set, flips complete one at a time on a
+ synthetic vsync of that rate; at 0 they complete as soon as they are
+ processed, so nothing but SGX and services limits the frame rate.
+ Completion times of the last flips are in /proc/dcnohw_flips.
+*/
+static unsigned long refresh = 0;
+module_param(refresh, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(refresh, "Synthetic refresh rate in Hz (default 0, complete flips at once)");
+
+#define DC_NOHW_FLIP_HISTORY	64
+
+typedef struct DC_NOHW_FLIP_WORK_TAG
+{
+	struct work_struct	sWork;
+	DC_NOHW_DEVINFO		*psDevInfo;
+	IMG_HANDLE			hCmdCookie;
+} DC_NOHW_FLIP_WORK;
+
+static struct workqueue_struct *psFlipWorkQueue;
+static ktime_t sLastVSync;
+
+static DEFINE_SPINLOCK(sFlipHistoryLock);
+static unsigned long ulFlipCount;
+static u64 aui64FlipTimeUs[DC_NOHW_FLIP_HISTORY];
+
+static void FlipCompleted(DC_NOHW_DEVINFO *psDevInfo, IMG_HANDLE hCmdCookie,
+						  IMG_BOOL bScheduleMISR)
+{
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&sFlipHistoryLock, ulFlags);
+	aui64FlipTimeUs[ulFlipCount % DC_NOHW_FLIP_HISTORY] = ktime_to_us(ktime_get());
+	ulFlipCount++;
+	spin_unlock_irqrestore(&sFlipHistoryLock, ulFlags);
+
+	psDevInfo->sPVRJTable.pfnPVRSRVCmdComplete(hCmdCookie, bScheduleMISR);
+}
+
+static void FlipWorkHandler(struct work_struct *psWork)
+{
+	DC_NOHW_FLIP_WORK *psFlipWork = container_of(psWork, DC_NOHW_FLIP_WORK, sWork);
+	unsigned long ulRefresh = refresh;
+
+	if (ulRefresh != 0)
+	{
+		s64 i64Period = NSEC_PER_SEC / ulRefresh;
+		ktime_t sNow = ktime_get();
+		s64 i64SinceLast = ktime_to_ns(ktime_sub(sNow, sLastVSync));
+		ktime_t sNext;
+
+		/* The next vsync after now, keeping the phase of the last one */
+		sNext = ktime_add_ns(sLastVSync, (div64_s64(i64SinceLast, i64Period) + 1) * i64Period);
+
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout(&sNext, HRTIMER_MODE_ABS);
+		sLastVSync = sNext;
+	}
+
+	FlipCompleted(psFlipWork->psDevInfo, psFlipWork->hCmdCookie, IMG_TRUE);
+	kfree(psFlipWork);
+}
+
+IMG_BOOL QueueFlipComplete(DC_NOHW_DEVINFO *psDevInfo, IMG_HANDLE hCmdCookie)
+{
+	DC_NOHW_FLIP_WORK *psFlipWork;
+
+	if (refresh == 0)
+	{
+		FlipCompleted(psDevInfo, hCmdCookie, IMG_FALSE);
+		return IMG_TRUE;
+	}
+
+	/* May be called from the services MISR */
+	psFlipWork = kmalloc(sizeof(*psFlipWork), GFP_ATOMIC);
+	if (psFlipWork == NULL)
+	{
+		return IMG_FALSE;
+	}
+
+	INIT_WORK(&psFlipWork->sWork, FlipWorkHandler);
+	psFlipWork->psDevInfo = psDevInfo;
+	psFlipWork->hCmdCookie = hCmdCookie;
+	queue_work(psFlipWorkQueue, &psFlipWork->sWork);
+
+	return IMG_TRUE;
+}
+
+static int FlipHistoryShow(struct seq_file *sfile, void *pvData)
+{
+	u64 aui64Times[DC_NOHW_FLIP_HISTORY];
+	unsigned long ulCount, ulFirst, i;
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&sFlipHistoryLock, ulFlags);
+	ulCount = ulFlipCount;
+	memcpy(aui64Times, aui64FlipTimeUs, sizeof(aui64Times));
+	spin_unlock_irqrestore(&sFlipHistoryLock, ulFlags);
+
+	ulFirst = (ulCount > DC_NOHW_FLIP_HISTORY) ? ulCount - DC_NOHW_FLIP_HISTORY : 0;
+
+	seq_printf(sfile, "refresh %lu Hz, %lu flips\n", refresh, ulCount);
+	seq_printf(sfile, "flip\ttime (us)\tdelta (us)\n");
+	for (i = ulFirst; i < ulCount; i++)
+	{
+		u64 ui64Time = aui64Times[i % DC_NOHW_FLIP_HISTORY];
+		u64 ui64Delta = (i > ulFirst) ? ui64Time - aui64Times[(i - 1) % DC_NOHW_FLIP_HISTORY] : 0;
+
+		seq_printf(sfile, "%lu\t%llu\t%llu\n", i,
+				   (unsigned long long)ui64Time, (unsigned long long)ui64Delta);
+	}
+
+	return 0;
+}
+
+static int FlipHistoryOpen(struct inode *psInode, struct file *psFile)
+{
+	return single_open(psFile, FlipHistoryShow, NULL);
+}
+
+static const struct file_operations sFlipHistoryFops = {
+	.owner		= THIS_MODULE,
+	.open		= FlipHistoryOpen,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int FlipBenchInit(void)
+{
+	psFlipWorkQueue = create_singlethread_workqueue(DRVNAME);
+	if (psFlipWorkQueue == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	sLastVSync = ktime_get();
+
+	if (proc_create("dcnohw_flips", S_IRUGO, NULL, &sFlipHistoryFops) == NULL)
+	{
+		printk(KERN_WARNING DRVNAME ": Couldn't create /proc/dcnohw_flips\n");
+	}
+
+	return 0;
+}
+
+static void FlipBenchDeinit(void)
+{
+	remove_proc_entry("dcnohw_flips", NULL);
+	destroy_workqueue(psFlipWorkQueue);
+	psFlipWorkQueue = NULL;
+}
+
 /*****************************************************************************
  Function Name:	DC_NOHW_Init
  Description  :	Insert the driver into the kernel.
@@ -182,8 +342,16 @@ int PVR_DRM_MAKENAME(DISPLAY_CONTROLLER, _Init)(struct drm_device unref__ *dev)
 static int __init DC_NOHW_Init(void)
 #endif
 {
+	int iError = FlipBenchInit();
+
+	if (iError != 0)
+	{
+		return iError;
+	}
+
 	if(Init() != DC_OK)
 	{
+		FlipBenchDeinit();
 		return -ENODEV;
 	}
 
@@ -205,10 +373,15 @@ void PVR_DRM_MAKENAME(DISPLAY_CONTROLLER, _Cleanup)(struct drm_device unref__ *d
 static void __exit DC_NOHW_Cleanup(void)
 #endif
 {
+	/* let queued flips complete while services can still take them */
+	flush_workqueue(psFlipWorkQueue);
+
 	if(Deinit() != DC_OK)
 	{
 		printk (KERN_INFO DRVNAME ": DC_NOHW_Cleanup: can't deinit device\n");
 	}
+
+	FlipBenchDeinit();
 } /*DC_NOHW_Cleanup*/
 
 
@@ -96,6 +96,9 @@ typedef struct OMAPLFB_BUFFER_TAG
 
 	OMAPLFB_HANDLE      		hCmdComplete;
 	unsigned long    		ulSwapInterval;
+
+	/* Time (us) the flip was queued, for the flip latency stats */
+	unsigned long			ulQueueTimeUs;
 } OMAPLFB_BUFFER;
 
 /* OMAPLFB swapchain structure */
@@ -125,6 +128,19 @@ typedef struct OMAPLFB_SWAPCHAIN_TAG
 	/* Previous number of blank events */
 	int				iBlankEvents;
 
+	/*
+	 * Flips queued on the work queue and not yet handled. A flip
+	 * with a zero swap interval that already has another one behind
+	 * it is completed without being displayed.
+	 */
+	OMAPLFB_ATOMIC_INT		sPendingFlips;
+
+	/* Flip statistics, only touched by the swap handler */
+	unsigned long			ulFlips;
+	unsigned long			ulDroppedFlips;
+	unsigned long			ulFlipLatencyTotalUs;
+	unsigned long			ulFlipLatencyMaxUs;
+
 	/* Framebuffer Device ID for messages (e.g. printk) */
 	unsigned int            	uiFBDevID;
 } OMAPLFB_SWAPCHAIN;
@@ -308,6 +324,9 @@ void OMAPLFBAtomicIntDeInit(OMAPLFB_ATOMIC_INT *psAtomic);
 void OMAPLFBAtomicIntSet(OMAPLFB_ATOMIC_INT *psAtomic, int iVal);
 int OMAPLFBAtomicIntRead(OMAPLFB_ATOMIC_INT *psAtomic);
 void OMAPLFBAtomicIntInc(OMAPLFB_ATOMIC_INT *psAtomic);
+void OMAPLFBAtomicIntDec(OMAPLFB_ATOMIC_INT *psAtomic);
+unsigned long OMAPLFBClockus(void);
+unsigned OMAPLFBMaxQueuedFlips(void);
 
 #if defined(DEBUG)
 void OMAPLFBPrintInfo(OMAPLFB_DEVINFO *psDevInfo);
@@ -585,6 +585,7 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 	psSwapChain->psBuffer = psBuffer;
 	psSwapChain->bNotVSynced = OMAPLFB_TRUE;
 	psSwapChain->uiFBDevID = psDevInfo->uiFBDevID;
+	OMAPLFBAtomicIntInit(&psSwapChain->sPendingFlips, 0);
 
 	/* Link the buffers */
 	for(i=0; i<ui32BufferCount-1; i++)
@@ -701,6 +702,14 @@ static PVRSRV_ERROR DestroyDCSwapChain(IMG_HANDLE hDevice,
 	/* The swap queue is flushed before being destroyed */
 	OMAPLFBDestroySwapQueue(psSwapChain);
 
+	DEBUG_PRINTK((KERN_INFO DRIVER_PREFIX
+		": %s: Device %u: %lu flips (%lu dropped), latency avg %luus max %luus\n",
+		__FUNCTION__, psDevInfo->uiFBDevID,
+		psSwapChain->ulFlips, psSwapChain->ulDroppedFlips,
+		psSwapChain->ulFlips ? psSwapChain->ulFlipLatencyTotalUs / psSwapChain->ulFlips : 0,
+		psSwapChain->ulFlipLatencyMaxUs));
+	OMAPLFBAtomicIntDeInit(&psSwapChain->sPendingFlips);
+
 	eError = OMAPLFBDisableLFBEventNotification(psDevInfo);
 	if (eError != OMAPLFB_OK)
 	{
@@ -902,6 +911,24 @@ void OMAPLFBSwapHandler(OMAPLFB_BUFFER *psBuffer)
 	OMAPLFB_DEVINFO *psDevInfo = psBuffer->psDevInfo;
 	OMAPLFB_SWAPCHAIN *psSwapChain = psDevInfo->psSwapChain;
 	OMAPLFB_BOOL bPreviouslyNotVSynced;
+	unsigned long ulLatencyUs;
+	unsigned uMaxQueued = OMAPLFBMaxQueuedFlips();
+	int iPending = OMAPLFBAtomicIntRead(&psSwapChain->sPendingFlips);
+
+	/*
+	 * Without a swap interval the newest buffer wins; don't pan to one
+	 * that a later flip will replace before it is ever scanned out.
+	 * With max_queued_flips set, a client that has got that far ahead
+	 * of the display has its older frames skipped the same way, so what
+	 * is shown stays close to what was last rendered. The frame that is
+	 * shown still waits for vsync, so this does not tear.
+	 */
+	if ((psBuffer->ulSwapInterval == 0 && iPending > 1) ||
+		(uMaxQueued != 0 && iPending > (int)uMaxQueued))
+	{
+		psSwapChain->ulDroppedFlips++;
+		goto Complete;
+	}
 
 #if defined(SUPPORT_DRI_DRM)
 	if (!OMAPLFBAtomicBoolRead(&psDevInfo->sLeaveVT))
@@ -946,6 +973,16 @@ void OMAPLFBSwapHandler(OMAPLFB_BUFFER *psBuffer)
 		}
 	}
 
+	ulLatencyUs = OMAPLFBClockus() - psBuffer->ulQueueTimeUs;
+	psSwapChain->ulFlips++;
+	psSwapChain->ulFlipLatencyTotalUs += ulLatencyUs;
+	if (ulLatencyUs > psSwapChain->ulFlipLatencyMaxUs)
+	{
+		psSwapChain->ulFlipLatencyMaxUs = ulLatencyUs;
+	}
+
+Complete:
+	OMAPLFBAtomicIntDec(&psSwapChain->sPendingFlips);
 	psDevInfo->sPVRJTable.pfnPVRSRVCmdComplete((IMG_HANDLE)psBuffer->hCmdComplete, IMG_TRUE);
 }
 
@@ -1002,6 +1039,8 @@ static IMG_BOOL ProcessFlipV1(IMG_HANDLE hCmdCookie,
 		else
 #endif /* defined(CONFIG_DSSCOMP) */
 		{
+			psBuffer->ulQueueTimeUs = OMAPLFBClockus();
+			OMAPLFBAtomicIntInc(&psSwapChain->sPendingFlips);
 			OMAPLFBQueueBufferForSwap(psSwapChain, psBuffer);
 		}
 	}
@@ -87,6 +87,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/hardirq.h>
 #include <linux/mutex.h>
 #include <linux/workqueue.h>
+#include <linux/ktime.h>
 #include <linux/fb.h>
 #include <linux/console.h>
 #include <linux/omapfb.h>
@@ -150,6 +151,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 MODULE_SUPPORTED_DEVICE(DEVNAME);
 
+static unsigned int max_queued_flips;
+module_param(max_queued_flips, uint, 0644);
+MODULE_PARM_DESC(max_queued_flips, "Flips queued behind the display beyond which the older ones are skipped (default 0, never skip)");
+
 #if !defined(PVR_OMAPLFB_DRM_FB)
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,34))
 #define OMAP_DSS_DRIVER(drv, dev) struct omap_dss_driver *drv = (dev) != NULL ? (dev)->driver : NULL
@@ -235,6 +240,22 @@ void OMAPLFBAtomicIntInc(OMAPLFB_ATOMIC_INT *psAtomic)
 	atomic_inc(psAtomic);
 }
 
+void OMAPLFBAtomicIntDec(OMAPLFB_ATOMIC_INT *psAtomic)
+{
+	atomic_dec(psAtomic);
+}
+
+unsigned OMAPLFBMaxQueuedFlips(void)
+{
+	return max_queued_flips;
+}
+
+/* Monotonic time in microseconds, only meaningful as a difference */
+unsigned long OMAPLFBClockus(void)
+{
+	return (unsigned long)ktime_to_us(ktime_get());
+}
+
 OMAPLFB_ERROR OMAPLFBGetLibFuncAddr (char *szFunctionName, PFN_DC_GET_PVRJTABLE *ppfnFuncTable)
 {
 	if(strcmp("PVRGetDisplayClassJTable", szFunctionName) != 0)
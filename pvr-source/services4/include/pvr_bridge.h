@@ -274,8 +274,13 @@ extern "C" {
 #define PVRSRV_BRIDGE_FREE_SYNC_INFO            PVRSRV_IOWR(PVRSRV_BRIDGE_SYNC_OPS_CMD_FIRST+9)
 #define PVRSRV_BRIDGE_SYNC_OPS_CMD_LAST			(PVRSRV_BRIDGE_SYNC_OPS_CMD_FIRST+9)
 
+/* Batch: uses the index that was left unused here, so device IDs don't move */
+#define PVRSRV_BRIDGE_BATCH_CMD_FIRST			(PVRSRV_BRIDGE_SYNC_OPS_CMD_LAST+1)
+#define PVRSRV_BRIDGE_BATCH						PVRSRV_IOWR(PVRSRV_BRIDGE_BATCH_CMD_FIRST+0)
+#define PVRSRV_BRIDGE_BATCH_CMD_LAST			(PVRSRV_BRIDGE_BATCH_CMD_FIRST+0)
+
 /* For sgx_bridge.h (msvdx_bridge.h should probably use these defines too) */
-#define PVRSRV_BRIDGE_LAST_NON_DEVICE_CMD		(PVRSRV_BRIDGE_SYNC_OPS_CMD_LAST+1)
+#define PVRSRV_BRIDGE_LAST_NON_DEVICE_CMD		(PVRSRV_BRIDGE_BATCH_CMD_LAST)
 
 
 /******************************************************************************
@@ -2243,6 +2248,41 @@ typedef struct PVRSRV_BRIDGE_OUT_MULTI_MANAGE_DEV_MEM_TAG
 	PVRSRV_MANAGE_DEV_MEM_RESPONSE sMemResponse[PVRSRV_MULTI_MANAGE_DEV_MEM_MAX_DIRECT_SIZE];
 }PVRSRV_BRIDGE_OUT_MULTI_MANAGE_DEV_MEM;
 
+/******************************************************************************
+ *	batch
+ *
+ *	Runs up to PVRSRV_BRIDGE_BATCH_MAX_ENTRIES bridge calls in order under one
+ *	bridge lock acquisition. Each entry is dispatched as if it were its own
+ *	ioctl, so its out structure carries its eError as usual. i32Result gets
+ *	the dispatch result (0 or a negative errno) and the batch stops at the
+ *	first entry that fails to dispatch. Calls that open or close the
+ *	connection, or are tied to the file descriptor, can't be batched.
+ *****************************************************************************/
+#define PVRSRV_BRIDGE_BATCH_MAX_ENTRIES		32
+
+typedef struct PVRSRV_BRIDGE_BATCH_ENTRY_TAG
+{
+	IMG_UINT32		ui32BridgeID;		/*!< PVRSRV_BRIDGE_* of the call */
+	IMG_VOID		*pvParamIn;
+	IMG_UINT32		ui32InBufferSize;
+	IMG_VOID		*pvParamOut;
+	IMG_UINT32		ui32OutBufferSize;
+	IMG_INT32		i32Result;			/*!< written back by the kernel */
+}PVRSRV_BRIDGE_BATCH_ENTRY;
+
+typedef struct PVRSRV_BRIDGE_IN_BATCH_TAG
+{
+	IMG_UINT32					ui32BridgeFlags; /* Must be first member of structure */
+	IMG_UINT32					ui32NumEntries;
+	PVRSRV_BRIDGE_BATCH_ENTRY	*psEntries;
+}PVRSRV_BRIDGE_IN_BATCH;
+
+typedef struct PVRSRV_BRIDGE_OUT_BATCH_TAG
+{
+	PVRSRV_ERROR	eError;
+	IMG_UINT32		ui32NumProcessed;	/*!< entries dispatched, including a failed last one */
+}PVRSRV_BRIDGE_OUT_BATCH;
+
 #if defined (__cplusplus)
 }
 #endif
@@ -170,7 +170,12 @@ PVRSRV_ERROR PVRSRVMapIonHandleKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
 								  PVRSRV_KERNEL_MEM_INFO **ppsKernelMemInfo);
 
 IMG_IMPORT
-PVRSRV_ERROR IMG_CALLCONV PVRSRVUnmapIonHandleKM(PVRSRV_KERNEL_MEM_INFO *psMemInfo);
+PVRSRV_ERROR IMG_CALLCONV PVRSRVUnmapIonHandleKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
+												 PVRSRV_KERNEL_MEM_INFO *psMemInfo);
+
+IMG_IMPORT
+IMG_VOID PVRSRVFlushIonCacheKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
+							   IMG_HANDLE hDevMemContext);
 #endif /* SUPPORT_ION */
 
 IMG_IMPORT
@@ -341,6 +346,8 @@ IMG_IMPORT
 IMG_VOID IMG_CALLCONV PVRSRVAcquireSyncInfoKM(PVRSRV_KERNEL_SYNC_INFO	*psKernelSyncInfo);
 IMG_IMPORT
 IMG_VOID IMG_CALLCONV PVRSRVReleaseSyncInfoKM(PVRSRV_KERNEL_SYNC_INFO	*psKernelSyncInfo);
+IMG_IMPORT
+IMG_VOID IMG_CALLCONV PVRSRVFreeSyncInfoPoolKM(IMG_HANDLE			hSyncDevMemHeap);
 
 IMG_IMPORT
 #if defined (SUPPORT_SID_INTERFACE)
@@ -198,6 +198,9 @@ typedef struct _PVRSRV_KERNEL_SYNC_INFO_
 
 	/* Unique ID of the sync object */
 	IMG_UINT32		ui32UID;
+
+	/* Heap the sync data came from, to recycle it for the same device */
+	IMG_HANDLE		hSyncDevMemHeap;
 } PVRSRV_KERNEL_SYNC_INFO;
 
 /*!
@@ -306,6 +309,12 @@ typedef struct _PVRSRV_QUEUE_INFO_
 	IMG_HANDLE			hMemBlock[2];
 
 	struct _PVRSRV_QUEUE_INFO_ *psNextKM;		/*!< The next queue in the system */
+
+	PVRSRV_SYNC_DATA	*psBlockedSyncData;		/*!< Sync the command at ui32BlockedReadOffset is waiting on, or NULL */
+	IMG_SIZE_T			ui32BlockedReadOffset;	/*!< Read offset of the blocked command */
+	IMG_UINT32			ui32BlockedWriteOpsComplete;	/*!< psBlockedSyncData counters when it was last checked */
+	IMG_UINT32			ui32BlockedReadOpsComplete;
+	IMG_UINT32			ui32BlockedDispatchCount;	/*!< Commands dispatched by then, see CheckIfSyncIsQueued */
 }PVRSRV_QUEUE_INFO;
 
 
@@ -391,6 +391,11 @@ PVRSRVDestroyDeviceMemContextBW(IMG_UINT32 ui32BridgeID,
 		return 0;
 	}
 
+#if defined(SUPPORT_ION)
+	/* Parked ION imports would otherwise keep the context's heaps busy */
+	PVRSRVFlushIonCacheKM(psPerProc, hDevMemContextInt);
+#endif
+
 	psRetOUT->eError =
 		PVRSRVDestroyDeviceMemContextKM(hDevCookieInt, hDevMemContextInt, &bDestroyed);
 
@@ -1999,7 +2004,7 @@ PVRSRVUnmapIonHandleBW(IMG_UINT32 ui32BridgeID,
 		return 0;
 	}
 
-	psUnmapIonOUT->eError = PVRSRVUnmapIonHandleKM(pvKernelMemInfo);
+	psUnmapIonOUT->eError = PVRSRVUnmapIonHandleKM(psPerProc, pvKernelMemInfo);
 
 	if(psUnmapIonOUT->eError != PVRSRV_OK)
 	{
@@ -5049,6 +5054,107 @@ PVRSRVSyncOpsFlushToDeltaBW(IMG_UINT32                                         u
 }
 
 
+/* Calls the OS layer checks or follows up on, or that change the connection */
+static IMG_BOOL
+BatchEntryAllowed(IMG_UINT32 ui32BridgeID)
+{
+	switch(ui32BridgeID)
+	{
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_CONNECT_SERVICES):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_DISCONNECT_SERVICES):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_INITSRV_CONNECT):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_INITSRV_DISCONNECT):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_MAP_DEV_MEMORY):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_MAP_DEV_MEMORY_2):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_EXPORT_DEVICEMEM_2):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_MAP_DEVICECLASS_MEMORY):
+		case PVRSRV_GET_BRIDGE_ID(PVRSRV_BRIDGE_BATCH):
+			return IMG_FALSE;
+		default:
+			return IMG_TRUE;
+	}
+}
+
+static IMG_INT
+PVRSRVBatchBW(IMG_UINT32					ui32BridgeID,
+			  PVRSRV_BRIDGE_IN_BATCH		*psBatchIN,
+			  PVRSRV_BRIDGE_OUT_BATCH		*psBatchOUT,
+			  PVRSRV_PER_PROCESS_DATA		*psPerProc)
+{
+	/*
+	 * psBatchIN and psBatchOUT are in the bridge buffers, which every entry
+	 * dispatched below reuses: take what is needed from the in structure
+	 * now and fill in the out structure last.
+	 */
+	PVRSRV_BRIDGE_BATCH_ENTRY *psEntriesUM = psBatchIN->psEntries;
+	IMG_UINT32 ui32NumEntries = psBatchIN->ui32NumEntries;
+	IMG_UINT32 ui32NumProcessed = 0;
+	PVRSRV_ERROR eError = PVRSRV_OK;
+	IMG_UINT32 i;
+
+	PVRSRV_BRIDGE_ASSERT_CMD(ui32BridgeID, PVRSRV_BRIDGE_BATCH);
+
+	if(ui32NumEntries > PVRSRV_BRIDGE_BATCH_MAX_ENTRIES)
+	{
+		psBatchOUT->eError = PVRSRV_ERROR_INVALID_PARAMS;
+		psBatchOUT->ui32NumProcessed = 0;
+		return 0;
+	}
+
+	for(i = 0; i < ui32NumEntries; i++)
+	{
+		PVRSRV_BRIDGE_BATCH_ENTRY sEntry;
+		PVRSRV_BRIDGE_PACKAGE sPackage;
+
+		if(CopyFromUserWrapper(psPerProc, ui32BridgeID, &sEntry,
+							   &psEntriesUM[i], sizeof(sEntry)) != PVRSRV_OK)
+		{
+			eError = PVRSRV_ERROR_INVALID_PARAMS;
+			break;
+		}
+
+		if(BatchEntryAllowed(PVRSRV_GET_BRIDGE_ID(sEntry.ui32BridgeID)))
+		{
+			OSMemSet(&sPackage, 0, sizeof(sPackage));
+			sPackage.ui32BridgeID = PVRSRV_GET_BRIDGE_ID(sEntry.ui32BridgeID);
+			sPackage.ui32Size = sizeof(sPackage);
+			sPackage.pvParamIn = sEntry.pvParamIn;
+			sPackage.ui32InBufferSize = sEntry.ui32InBufferSize;
+			sPackage.pvParamOut = sEntry.pvParamOut;
+			sPackage.ui32OutBufferSize = sEntry.ui32OutBufferSize;
+
+			sEntry.i32Result = BridgedDispatchKM(psPerProc, &sPackage);
+		}
+		else
+		{
+			PVR_DPF((PVR_DBG_ERROR, "PVRSRVBatchBW: bridge call %u can't be batched",
+					 PVRSRV_GET_BRIDGE_ID(sEntry.ui32BridgeID)));
+			sEntry.i32Result = -EINVAL;
+		}
+
+		if(CopyToUserWrapper(psPerProc, ui32BridgeID, &psEntriesUM[i].i32Result,
+							 &sEntry.i32Result, sizeof(sEntry.i32Result)) != PVRSRV_OK)
+		{
+			eError = PVRSRV_ERROR_INVALID_PARAMS;
+			break;
+		}
+
+		ui32NumProcessed++;
+
+		if(sEntry.i32Result != 0)
+		{
+			eError = PVRSRV_ERROR_BRIDGE_CALL_FAILED;
+			break;
+		}
+	}
+
+	psBatchOUT->eError = eError;
+	psBatchOUT->ui32NumProcessed = ui32NumProcessed;
+
+	return 0;
+}
+
+
 static PVRSRV_ERROR
 FreeSyncInfoCallback(IMG_PVOID	pvParam,
                      IMG_UINT32 ui32Param,
@@ -5335,6 +5441,20 @@ CommonBridgeInit(IMG_VOID)
 	SetDispatchTableEntry(PVRSRV_BRIDGE_ALLOC_SYNC_INFO, PVRSRVAllocSyncInfoBW);
 	SetDispatchTableEntry(PVRSRV_BRIDGE_FREE_SYNC_INFO, PVRSRVFreeSyncInfoBW);
 
+	SetDispatchTableEntry(PVRSRV_BRIDGE_BATCH, PVRSRVBatchBW);
+
+#if !defined(PDUMP)
+	/*
+	 * Clients poll these while waiting on a sync object; they only read the
+	 * handle base and the sync counters. With PDUMP they write the pdump
+	 * stream, so they stay exclusive there.
+	 */
+	SetDispatchTableSharedLock(PVRSRV_BRIDGE_SYNC_OPS_TAKE_TOKEN);
+	SetDispatchTableSharedLock(PVRSRV_BRIDGE_SYNC_OPS_FLUSH_TO_TOKEN);
+	SetDispatchTableSharedLock(PVRSRV_BRIDGE_SYNC_OPS_FLUSH_TO_MOD_OBJ);
+	SetDispatchTableSharedLock(PVRSRV_BRIDGE_SYNC_OPS_FLUSH_TO_DELTA);
+#endif
+
 #if defined (SUPPORT_SGX)
 	SetSGXDispatchTableEntry();
 #endif
@@ -5368,6 +5488,16 @@ CommonBridgeInit(IMG_VOID)
 	return PVRSRV_OK;
 }
 
+IMG_BOOL BridgedDispatchIsShared(IMG_UINT32 ui32BridgeID)
+{
+	if(ui32BridgeID >= (BRIDGE_DISPATCH_TABLE_ENTRY_COUNT))
+	{
+		return IMG_FALSE;
+	}
+
+	return (g_BridgeDispatchTable[ui32BridgeID].ui32Flags & PVRSRV_BRIDGE_FLAG_SHARED_LOCK) ? IMG_TRUE : IMG_FALSE;
+}
+
 IMG_INT BridgedDispatchKM(PVRSRV_PER_PROCESS_DATA * psPerProc,
 					  PVRSRV_BRIDGE_PACKAGE   * psBridgePackageKM)
 {
@@ -5376,6 +5506,11 @@ IMG_INT BridgedDispatchKM(PVRSRV_PER_PROCESS_DATA * psPerProc,
 	BridgeWrapperFunction pfBridgeHandler;
 	IMG_UINT32   ui32BridgeID = psBridgePackageKM->ui32BridgeID;
 	IMG_INT      err          = -EFAULT;
+#if defined(__linux__)
+	/* Shared calls can run concurrently, so they can't use the static buffers */
+	IMG_UINT32	 aui32SharedIn[PVRSRV_BRIDGE_SHARED_MAX_SIZE / sizeof(IMG_UINT32)];
+	IMG_UINT32	 aui32SharedOut[PVRSRV_BRIDGE_SHARED_MAX_SIZE / sizeof(IMG_UINT32)];
+#endif
 
 #if defined(DEBUG_TRACE_BRIDGE_KM)
 	PVR_DPF((PVR_DBG_ERROR, "%s: %s",
@@ -5433,15 +5568,29 @@ IMG_INT BridgedDispatchKM(PVRSRV_PER_PROCESS_DATA * psPerProc,
 
 		SysAcquireData(&psSysData);
 
-		/* We have already set up some static buffers to store our ioctl data... */
-		psBridgeIn = ((ENV_DATA *)psSysData->pvEnvSpecificData)->pvBridgeData;
-		psBridgeOut = (IMG_PVOID)((IMG_PBYTE)psBridgeIn + PVRSRV_MAX_BRIDGE_IN_SIZE);
+		if(BridgedDispatchIsShared(ui32BridgeID))
+		{
+			psBridgeIn = aui32SharedIn;
+			psBridgeOut = aui32SharedOut;
 
-		/* check we are not using a bigger bridge than allocated */
-		if((psBridgePackageKM->ui32InBufferSize > PVRSRV_MAX_BRIDGE_IN_SIZE) || 
-			(psBridgePackageKM->ui32OutBufferSize > PVRSRV_MAX_BRIDGE_OUT_SIZE))
+			if((psBridgePackageKM->ui32InBufferSize > sizeof(aui32SharedIn)) ||
+				(psBridgePackageKM->ui32OutBufferSize > sizeof(aui32SharedOut)))
+			{
+				goto return_fault;
+			}
+		}
+		else
 		{
-			goto return_fault;
+			/* We have already set up some static buffers to store our ioctl data... */
+			psBridgeIn = ((ENV_DATA *)psSysData->pvEnvSpecificData)->pvBridgeData;
+			psBridgeOut = (IMG_PVOID)((IMG_PBYTE)psBridgeIn + PVRSRV_MAX_BRIDGE_IN_SIZE);
+
+			/* check we are not using a bigger bridge than allocated */
+			if((psBridgePackageKM->ui32InBufferSize > PVRSRV_MAX_BRIDGE_IN_SIZE) || 
+				(psBridgePackageKM->ui32OutBufferSize > PVRSRV_MAX_BRIDGE_OUT_SIZE))
+			{
+				goto return_fault;
+			}
 		}
 
 
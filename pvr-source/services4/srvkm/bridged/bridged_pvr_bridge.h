@@ -175,6 +175,7 @@ typedef struct _PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY
 {
 	BridgeWrapperFunction pfFunction; /*!< The wrapper function that validates the ioctl
 										arguments before calling into srvkm proper */
+	IMG_UINT32 ui32Flags; /*!< PVRSRV_BRIDGE_FLAG_* */
 #if defined(DEBUG_BRIDGE_KM)
 	const IMG_CHAR *pszIOCName; /*!< Name of the ioctl: e.g. "PVRSRV_BRIDGE_CONNECT_SERVICES" */
 	const IMG_CHAR *pszFunctionName; /*!< Name of the wrapper function: e.g. "PVRSRVConnectBW" */
@@ -184,6 +185,13 @@ typedef struct _PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY
 	IMG_UINT32 ui32CopyToUserTotalBytes; /*!< The total number of bytes copied from
 										   userspace within this ioctl */
 #endif
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	IMG_UINT32 ui32LockCount; /*!< Calls timed since the stats were last reset */
+	IMG_UINT64 ui64LockWaitTotalNs; /*!< Time spent waiting for the bridge lock */
+	IMG_UINT64 ui64LockWaitMaxNs;
+	IMG_UINT64 ui64LockHoldTotalNs; /*!< Time the bridge lock was held for */
+	IMG_UINT64 ui64LockHoldMaxNs;
+#endif
 }PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY;
 
 #if defined(SUPPORT_VGX) || defined(SUPPORT_MSVDX)
@@ -219,6 +227,22 @@ _SetDispatchTableEntry(IMG_UINT32 ui32Index,
 
 #define DISPATCH_TABLE_GAP_THRESHOLD 5
 
+/*
+ * The wrapper only looks up handles and reads sync objects, so the OS layer
+ * may run it concurrently with other such calls instead of under the
+ * exclusive bridge lock. Its in and out structures must fit in
+ * PVRSRV_BRIDGE_SHARED_MAX_SIZE.
+ */
+#define PVRSRV_BRIDGE_FLAG_SHARED_LOCK	(1U << 0)
+
+#define PVRSRV_BRIDGE_SHARED_MAX_SIZE	64
+
+#define SetDispatchTableSharedLock(ui32Index) \
+	(g_BridgeDispatchTable[PVRSRV_GET_BRIDGE_ID(ui32Index)].ui32Flags |= PVRSRV_BRIDGE_FLAG_SHARED_LOCK)
+
+IMG_BOOL
+BridgedDispatchIsShared(IMG_UINT32 ui32BridgeID);
+
 #if defined(DEBUG)
 #define PVRSRV_BRIDGE_ASSERT_CMD(X, Y) PVR_ASSERT(X == PVRSRV_GET_BRIDGE_ID(Y))
 #else
@@ -69,6 +69,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "buffer_manager.h"
 #include "pdump_km.h"
 
+/* Dst sync handle arrays up to this size are copied onto the stack in DoKick */
+#define SGX_DOKICK_LOCAL_DST_SYNCS	16
+
 static IMG_INT
 SGXGetClientInfoBW(IMG_UINT32 ui32BridgeID,
 				   PVRSRV_BRIDGE_IN_GETCLIENTINFO *psGetClientInfoIN,
@@ -199,6 +202,11 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 	IMG_HANDLE	ahSyncInfoHandles[16];
 #else
 	IMG_HANDLE *phKernelSyncInfoHandles = IMG_NULL;
+	/* Most kicks have few dst syncs, keep those off the heap */
+	IMG_HANDLE	ahKernelSyncInfoHandles[SGX_DOKICK_LOCAL_DST_SYNCS];
+#endif
+#if defined(SGX_KICK_STATS)
+	IMG_UINT32 ui32KickStartus = OSClockus();
 #endif
 
 	PVRSRV_BRIDGE_ASSERT_CMD(ui32BridgeID, PVRSRV_BRIDGE_SGX_DOKICK);
@@ -516,6 +524,7 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 			return -EFAULT;
 		}
 
+#if defined (SUPPORT_SID_INTERFACE)
 		psRetOUT->eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
 										ui32NumDstSyncs * sizeof(IMG_HANDLE),
 										(IMG_VOID **)&phKernelSyncInfoHandles,
@@ -526,12 +535,25 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 			return 0;
 		}
 
-#if defined (SUPPORT_SID_INTERFACE)
 		sCCBKickKM.pahDstSyncHandles = phKernelSyncInfoHandles;
 #else
+		if (ui32NumDstSyncs > SGX_DOKICK_LOCAL_DST_SYNCS)
+		{
+			psRetOUT->eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+											ui32NumDstSyncs * sizeof(IMG_HANDLE),
+											(IMG_VOID **)&phKernelSyncInfoHandles,
+											0,
+											"Array of Synchronization Info Handles");
+			if (psRetOUT->eError != PVRSRV_OK)
+			{
+				return 0;
+			}
+		}
+
 		if(CopyFromUserWrapper(psPerProc,
 							ui32BridgeID,
-							phKernelSyncInfoHandles,
+							(phKernelSyncInfoHandles != IMG_NULL) ?
+								phKernelSyncInfoHandles : ahKernelSyncInfoHandles,
 							psDoKickIN->sCCBKick.pahDstSyncHandles,
 							ui32NumDstSyncs * sizeof(IMG_HANDLE)) != PVRSRV_OK)
 		{
@@ -540,7 +562,8 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 		}
 
 		/* Set sCCBKick.pahDstSyncHandles to point to the local memory */
-		psDoKickIN->sCCBKick.pahDstSyncHandles = phKernelSyncInfoHandles;
+		psDoKickIN->sCCBKick.pahDstSyncHandles = (phKernelSyncInfoHandles != IMG_NULL) ?
+													phKernelSyncInfoHandles : ahKernelSyncInfoHandles;
 #endif
 
 		for( i = 0; i < ui32NumDstSyncs; i++)
@@ -606,6 +629,25 @@ SGXDoKickBW(IMG_UINT32 ui32BridgeID,
 #else
 					&psDoKickIN->sCCBKick);
 #endif
+	if (psRetOUT->eError == PVRSRV_OK)
+	{
+		psPerProc->ui32KickCount++;
+	}
+
+#if defined(SGX_KICK_STATS)
+	{
+		PVRSRV_SGXDEV_INFO *psDevInfo = (PVRSRV_SGXDEV_INFO *)((PVRSRV_DEVICE_NODE *)hDevCookieInt)->pvDevice;
+		IMG_UINT32 ui32Kickus = OSClockus() - ui32KickStartus;
+
+		/* Serialised by the bridge lock */
+		psDevInfo->ui32KickCount++;
+		psDevInfo->ui32KickTotalus += ui32Kickus;
+		if (ui32Kickus > psDevInfo->ui32KickMaxus)
+		{
+			psDevInfo->ui32KickMaxus = ui32Kickus;
+		}
+	}
+#endif
 
 PVRSRV_BRIDGE_SGX_DOKICK_RETURN_RESULT:
 
@@ -798,6 +840,10 @@ SGXSubmitTransferBW(IMG_UINT32 ui32BridgeID,
 #else
 	psRetOUT->eError = SGXSubmitTransferKM(hDevCookieInt, psKick);
 #endif
+	if (psRetOUT->eError == PVRSRV_OK)
+	{
+		psPerProc->ui32TransferKickCount++;
+	}
 
 	return 0;
 }
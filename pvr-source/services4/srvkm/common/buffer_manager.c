@@ -49,6 +49,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "pdump_km.h"
 #include "lists.h"
 
+/* Largest transient mapping ZeroBuf makes of physically contiguous pages */
+#define ZERO_BUF_MAX_MAP_PAGES	64
+
 static IMG_BOOL
 ZeroBuf(BM_BUF *pBuf, BM_MAPPING *pMapping, IMG_SIZE_T ui32Bytes, IMG_UINT32 ui32Flags);
 static IMG_VOID
@@ -283,7 +286,16 @@ AllocMemory (BM_CONTEXT			*pBMContext,
 		 * will have a physical address, else 0 */
 		pBuf->CpuPAddr.uiAddr = pMapping->CpuPAddr.uiAddr + uOffset;
 
-		if(uFlags & PVRSRV_MEM_ZERO)
+		/*
+		 * The first buffer from a freshly imported span gets fresh pages,
+		 * which are already zero if the OS zeroed them.  Anything later
+		 * from the span may be reusing memory, so it is zeroed here.
+		 */
+		if(pMapping->bZeroed)
+		{
+			pMapping->bZeroed = IMG_FALSE;
+		}
+		else if(uFlags & PVRSRV_MEM_ZERO)
 		{
 			if(!ZeroBuf(pBuf, pMapping, uSize, psBMHeap->ui32Attribs | uFlags))
 			{
@@ -664,8 +676,8 @@ ZeroBuf(BM_BUF *pBuf, BM_MAPPING *pMapping, IMG_SIZE_T ui32Bytes, IMG_UINT32 ui3
 		IMG_SIZE_T ui32CurrentOffset = 0;
 		IMG_CPU_PHYADDR CpuPAddr;
 
-		/* Walk through the pBuf one page at a time and use
-		 * transient mappings to zero the memory */
+		/* Walk through the pBuf and use transient mappings to zero the
+		 * memory, one per physically contiguous run of pages */
 
 		PVR_ASSERT(pBuf->hOSMemHandle);
 
@@ -681,6 +693,23 @@ ZeroBuf(BM_BUF *pBuf, BM_MAPPING *pMapping, IMG_SIZE_T ui32Bytes, IMG_UINT32 ui3
 				ui32BlockBytes =
 					MIN(ui32BytesRemaining, (IMG_UINT32)(HOST_PAGEALIGN(CpuPAddr.uiAddr) - CpuPAddr.uiAddr));
 			}
+			else
+			{
+				/* Each mapping costs a page table update and a TLB flush on
+				 * unmap, so take in the pages that follow on physically. */
+				while((ui32BlockBytes < ui32BytesRemaining)
+					&& (ui32BlockBytes < ZERO_BUF_MAX_MAP_PAGES * HOST_PAGESIZE()))
+				{
+					IMG_CPU_PHYADDR NextCpuPAddr =
+						OSMemHandleToCpuPAddr(pBuf->hOSMemHandle, ui32CurrentOffset + ui32BlockBytes);
+
+					if(NextCpuPAddr.uiAddr != CpuPAddr.uiAddr + ui32BlockBytes)
+					{
+						break;
+					}
+					ui32BlockBytes += MIN(ui32BytesRemaining - ui32BlockBytes, HOST_PAGESIZE());
+				}
+			}
 
 			pvCpuVAddr = OSMapPhysToLin(CpuPAddr,
 										ui32BlockBytes,
@@ -859,6 +888,439 @@ FreeBuf (BM_BUF *pBuf, IMG_UINT32 ui32Flags, IMG_BOOL bFromAllocator)
 	}
 }
 
+/* statistics summed over every BM context, updated under the bridge lock */
+static BM_CACHE_STATS gsBMCacheStats;
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheClass
+
+	@Description	Size class of a cached buffer
+
+	@Input      uSize - BM_Alloc size
+
+	@Return 	class index
+
+ *****************************************************************************/
+static IMG_UINT32
+BM_CacheClass (IMG_SIZE_T uSize)
+{
+	IMG_SIZE_T uPages = uSize / HOST_PAGESIZE();
+	IMG_UINT32 ui32Class = 0;
+
+	while (uPages > 1 && ui32Class < BM_CACHE_CLASSES - 1)
+	{
+		uPages >>= 1;
+		ui32Class++;
+	}
+	return ui32Class;
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheFlagsCanCache
+
+	@Description	Whether allocations with these flags from this heap may
+				be kept in the buffer cache. Only private RAM backed
+				allocations going through the import arena qualify.
+
+	@Input      psBMHeap - BM heap
+	@Input      uFlags - BM_Alloc flags
+
+	@Return 	IMG_TRUE if cacheable
+
+ *****************************************************************************/
+static IMG_BOOL
+BM_CacheFlagsCanCache (BM_HEAP *psBMHeap, IMG_UINT32 uFlags)
+{
+#if defined(PDUMP)
+	/* a reused buffer would not be in the capture */
+	PVR_UNREFERENCED_PARAMETER(psBMHeap);
+	PVR_UNREFERENCED_PARAMETER(uFlags);
+	return IMG_FALSE;
+#else
+	if (PVRSRV_BM_CACHE_MAX_BYTES == 0)
+	{
+		return IMG_FALSE;
+	}
+
+	/* shared heaps are visible to other processes */
+	if (psBMHeap->sDevArena.DevMemHeapType != DEVICE_MEMORY_HEAP_PERCONTEXT)
+	{
+		return IMG_FALSE;
+	}
+
+	if (!(uFlags & PVRSRV_MEM_RAM_BACKED_ALLOCATION) ||
+		(uFlags & (PVRSRV_MEM_USER_SUPPLIED_DEVVADDR |
+				   PVRSRV_MEM_SPARSE |
+				   PVRSRV_HAP_GPU_PAGEABLE |
+				   PVRSRV_MEM_XPROC |
+				   PVRSRV_MEM_ION)))
+	{
+		return IMG_FALSE;
+	}
+
+	return IMG_TRUE;
+#endif
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheUnlink
+
+	@Description	Take a buffer off its context's cache list
+
+	@Input      pBMContext - BM context
+	@Input      pBuf - cached buffer
+
+	@Return 	None.
+
+ *****************************************************************************/
+static IMG_VOID
+BM_CacheUnlink (BM_CONTEXT *pBMContext, BM_BUF *pBuf)
+{
+	IMG_UINT32 ui32Class = BM_CacheClass(pBuf->uAllocSize);
+
+	if (pBuf->psCachePrev != IMG_NULL)
+	{
+		pBuf->psCachePrev->psCacheNext = pBuf->psCacheNext;
+	}
+	else
+	{
+		pBMContext->apsCacheHead[ui32Class] = pBuf->psCacheNext;
+	}
+
+	if (pBuf->psCacheNext != IMG_NULL)
+	{
+		pBuf->psCacheNext->psCachePrev = pBuf->psCachePrev;
+	}
+	else
+	{
+		pBMContext->apsCacheTail[ui32Class] = pBuf->psCachePrev;
+	}
+
+	pBuf->psCacheNext = IMG_NULL;
+	pBuf->psCachePrev = IMG_NULL;
+
+	pBMContext->uCacheBytes -= pBuf->uAllocSize;
+	gsBMCacheStats.uBytes -= pBuf->uAllocSize;
+	gsBMCacheStats.ui32Buffers--;
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheEvict
+
+	@Description	Free a cached buffer for real
+
+	@Input      pBMContext - BM context
+	@Input      pBuf - cached buffer
+	@Input      pui32Counter - statistic counting the reason
+
+	@Return 	None.
+
+ *****************************************************************************/
+static IMG_VOID
+BM_CacheEvict (BM_CONTEXT *pBMContext, BM_BUF *pBuf, IMG_UINT32 *pui32Counter)
+{
+	BM_CacheUnlink(pBMContext, pBuf);
+	(*pui32Counter)++;
+	FreeBuf(pBuf, pBuf->ui32CacheFreeFlags, IMG_TRUE);
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheOldest
+
+	@Description	Least recently freed buffer in a context's cache
+
+	@Input      pBMContext - BM context
+
+	@Return 	cached buffer or IMG_NULL
+
+ *****************************************************************************/
+static BM_BUF *
+BM_CacheOldest (BM_CONTEXT *pBMContext)
+{
+	IMG_UINT32 ui32Now = OSClockus();
+	BM_BUF *pOldest = IMG_NULL;
+	IMG_UINT32 i;
+
+	for (i = 0; i < BM_CACHE_CLASSES; i++)
+	{
+		BM_BUF *pBuf = pBMContext->apsCacheTail[i];
+
+		if (pBuf != IMG_NULL &&
+			(pOldest == IMG_NULL ||
+			 ui32Now - pBuf->ui32CacheTime > ui32Now - pOldest->ui32CacheTime))
+		{
+			pOldest = pBuf;
+		}
+	}
+	return pOldest;
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheTrim
+
+	@Description	Free the buffers that aged out of a context's cache, then
+				the oldest ones until the cache fits in its budget
+
+	@Input      pBMContext - BM context
+
+	@Return 	None.
+
+ *****************************************************************************/
+static IMG_VOID
+BM_CacheTrim (BM_CONTEXT *pBMContext)
+{
+	IMG_UINT32 ui32Now = OSClockus();
+	IMG_UINT32 i;
+
+	for (i = 0; i < BM_CACHE_CLASSES; i++)
+	{
+		while (pBMContext->apsCacheTail[i] != IMG_NULL &&
+			   ui32Now - pBMContext->apsCacheTail[i]->ui32CacheTime >
+					PVRSRV_BM_CACHE_MAX_AGE_MS * 1000)
+		{
+			BM_CacheEvict(pBMContext, pBMContext->apsCacheTail[i],
+						  &gsBMCacheStats.ui32EvictAge);
+		}
+	}
+
+	while (pBMContext->uCacheBytes > PVRSRV_BM_CACHE_MAX_BYTES)
+	{
+		BM_CacheEvict(pBMContext, BM_CacheOldest(pBMContext),
+					  &gsBMCacheStats.ui32EvictBudget);
+	}
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheInsert
+
+	@Description	Keep a buffer whose last reference went in the cache
+				instead of freeing it
+
+	@Input      pBuf - buffer
+	@Input      ui32Flags - BM_Free flags, used when the buffer is freed
+
+	@Return 	IMG_TRUE if the buffer was cached, else it must be freed
+
+ *****************************************************************************/
+static IMG_BOOL
+BM_CacheInsert (BM_BUF *pBuf, IMG_UINT32 ui32Flags)
+{
+	BM_MAPPING *pMapping = pBuf->pMapping;
+	BM_CONTEXT *pBMContext;
+	IMG_UINT32 ui32Class;
+
+	/* uAllocSize is only set for BM_Alloc buffers that can be cached */
+	if (pBuf->uAllocSize == 0 ||
+		pBuf->ui32ExportCount != 0 ||
+		pBuf->uAllocSize > PVRSRV_BM_CACHE_MAX_BYTES / 4 ||
+		(pMapping->eCpuMemoryOrigin != hm_env &&
+		 pMapping->eCpuMemoryOrigin != hm_contiguous))
+	{
+		return IMG_FALSE;
+	}
+
+	pBMContext = pMapping->pBMHeap->pBMContext;
+	ui32Class = BM_CacheClass(pBuf->uAllocSize);
+
+	pBuf->ui32CacheFreeFlags = ui32Flags;
+	pBuf->ui32CacheTime = OSClockus();
+	pBuf->psCachePrev = IMG_NULL;
+	pBuf->psCacheNext = pBMContext->apsCacheHead[ui32Class];
+	if (pBuf->psCacheNext != IMG_NULL)
+	{
+		pBuf->psCacheNext->psCachePrev = pBuf;
+	}
+	else
+	{
+		pBMContext->apsCacheTail[ui32Class] = pBuf;
+	}
+	pBMContext->apsCacheHead[ui32Class] = pBuf;
+
+	pBMContext->uCacheBytes += pBuf->uAllocSize;
+	gsBMCacheStats.uBytes += pBuf->uAllocSize;
+	gsBMCacheStats.ui32Buffers++;
+	gsBMCacheStats.ui32Inserts++;
+
+	BM_CacheTrim(pBMContext);
+
+	return IMG_TRUE;
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheAlloc
+
+	@Description	Take a buffer matching a BM_Alloc request from the cache
+
+	@Input      psBMHeap - BM heap
+	@Input      uSize - requested buffer size in bytes.
+	@Input      uFlags - property flags for the buffer.
+	@Input      uDevVAddrAlignment - required device virtual address
+					 alignment, a power of 2.
+
+	@Return 	buffer, or IMG_NULL on a miss
+
+ *****************************************************************************/
+static BM_BUF *
+BM_CacheAlloc (BM_HEAP *psBMHeap,
+			   IMG_SIZE_T uSize,
+			   IMG_UINT32 uFlags,
+			   IMG_UINT32 uDevVAddrAlignment)
+{
+	BM_CONTEXT *pBMContext = psBMHeap->pBMContext;
+	BM_BUF *pBuf;
+
+	BM_CacheTrim(pBMContext);
+
+	for (pBuf = pBMContext->apsCacheHead[BM_CacheClass(uSize)];
+		 pBuf != IMG_NULL;
+		 pBuf = pBuf->psCacheNext)
+	{
+		if (pBuf->pMapping->pBMHeap == psBMHeap &&
+			pBuf->uAllocSize == uSize &&
+			pBuf->ui32AllocFlags == uFlags &&
+			(pBuf->DevVAddr.uiAddr & (uDevVAddrAlignment - 1)) == 0)
+		{
+			break;
+		}
+	}
+
+	if (pBuf == IMG_NULL)
+	{
+		gsBMCacheStats.ui32Misses++;
+		return IMG_NULL;
+	}
+
+	BM_CacheUnlink(pBMContext, pBuf);
+
+	if (uFlags & PVRSRV_MEM_ZERO)
+	{
+		if (!ZeroBuf(pBuf, pBuf->pMapping, uSize, psBMHeap->ui32Attribs | uFlags))
+		{
+			FreeBuf(pBuf, pBuf->ui32CacheFreeFlags, IMG_TRUE);
+			gsBMCacheStats.ui32Misses++;
+			return IMG_NULL;
+		}
+	}
+
+	gsBMCacheStats.ui32Hits++;
+	return pBuf;
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheFlush
+
+	@Description	Free every cached buffer of a context, or of one of its
+				heaps
+
+	@Input      pBMContext - BM context
+	@Input      psBMHeap - heap, or IMG_NULL for the whole context
+
+	@Return 	None.
+
+ *****************************************************************************/
+static IMG_VOID
+BM_CacheFlush (BM_CONTEXT *pBMContext, BM_HEAP *psBMHeap)
+{
+	IMG_UINT32 i;
+
+	for (i = 0; i < BM_CACHE_CLASSES; i++)
+	{
+		BM_BUF *pBuf = pBMContext->apsCacheHead[i];
+
+		while (pBuf != IMG_NULL)
+		{
+			BM_BUF *pNext = pBuf->psCacheNext;
+
+			if (psBMHeap == IMG_NULL || pBuf->pMapping->pBMHeap == psBMHeap)
+			{
+				BM_CacheEvict(pBMContext, pBuf, &gsBMCacheStats.ui32EvictFlush);
+			}
+			pBuf = pNext;
+		}
+	}
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheShrink
+
+	@Description	Free up to ui32Pages pages of cached buffers, oldest
+				first in each context.
+
+	@Input      ui32Pages - pages to free, 0 only counts
+
+	@Return 	pages still cached
+
+ *****************************************************************************/
+IMG_UINT32
+BM_CacheShrink (IMG_UINT32 ui32Pages)
+{
+	SYS_DATA *psSysData;
+	PVRSRV_DEVICE_NODE *psDeviceNode;
+	IMG_SIZE_T uTarget = (IMG_SIZE_T)ui32Pages * HOST_PAGESIZE();
+
+	SysAcquireData(&psSysData);
+
+	for (psDeviceNode = psSysData->psDeviceNodeList;
+		 psDeviceNode != IMG_NULL && uTarget != 0;
+		 psDeviceNode = psDeviceNode->psNext)
+	{
+		BM_CONTEXT *pBMContext;
+
+		for (pBMContext = psDeviceNode->sDevMemoryInfo.pBMContext;
+			 pBMContext != IMG_NULL && uTarget != 0;
+			 pBMContext = pBMContext->psNext)
+		{
+			while (pBMContext->uCacheBytes != 0 && uTarget != 0)
+			{
+				BM_BUF *pBuf = BM_CacheOldest(pBMContext);
+
+				uTarget -= MIN(uTarget, pBuf->uAllocSize);
+				BM_CacheEvict(pBMContext, pBuf, &gsBMCacheStats.ui32EvictShrink);
+			}
+		}
+	}
+
+	return (IMG_UINT32)(gsBMCacheStats.uBytes / HOST_PAGESIZE());
+}
+
+/*!
+******************************************************************************
+
+	@Function	BM_CacheGetStats
+
+	@Description	Buffer cache statistics, summed over all BM contexts
+
+	@Output     psStats - statistics
+
+	@Return 	None.
+
+ *****************************************************************************/
+IMG_VOID
+BM_CacheGetStats (BM_CACHE_STATS *psStats)
+{
+	*psStats = gsBMCacheStats;
+}
+
 /*!
 ******************************************************************************
 
@@ -936,6 +1398,9 @@ BM_DestroyContext(IMG_HANDLE	hBMContext,
 		return PVRSRV_OK;
 	}
 
+	/* cached buffers still hold their RA allocations */
+	BM_CacheFlush(pBMContext, IMG_NULL);
+
 	/*
 		Check whether there is a bug in the client which brought it here before
 		all the allocations have been freed.
@@ -1043,6 +1508,9 @@ static PVRSRV_ERROR BM_DestroyContextCallBack(IMG_PVOID   pvParam,
 	*/
 	psDeviceNode = pBMContext->psDeviceNode;
 
+	/* resman may get here without BM_DestroyContext */
+	BM_CacheFlush(pBMContext, IMG_NULL);
+
 	/*
 		Free the import arenas and heaps
 	*/
@@ -1463,6 +1931,8 @@ BM_DestroyHeap (IMG_HANDLE hDevMemHeap)
 
 	if(psBMHeap)
 	{
+		BM_CacheFlush(psBMHeap->pBMContext, psBMHeap);
+
 		/* Free up the import arenas */
 		if(psBMHeap->ui32Attribs
 		&	(PVRSRV_BACKINGSTORE_SYSMEM_NONCONTIG
@@ -1560,6 +2030,8 @@ BM_Alloc (  IMG_HANDLE			hDevMemHeap,
 	BM_HEAP *psBMHeap;
 	SYS_DATA *psSysData;
 	IMG_UINT32 uFlags;
+	IMG_BOOL bCacheable;
+	IMG_BOOL bAllocated;
 
 	if (pui32Flags == IMG_NULL)
 	{
@@ -1584,40 +2056,76 @@ BM_Alloc (  IMG_HANDLE			hDevMemHeap,
 		uDevVAddrAlignment = 1;
 	}
 
-	/*
-	 * Allocate something in which to record the allocation's details.
-	 */
-	if (OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-				   sizeof (BM_BUF),
-				   (IMG_PVOID *)&pBuf, IMG_NULL,
-				   "Buffer Manager buffer") != PVRSRV_OK)
+	bCacheable = (ui32PrivDataLength == 0) && BM_CacheFlagsCanCache(psBMHeap, uFlags);
+
+	pBuf = IMG_NULL;
+	if (bCacheable)
 	{
-		PVR_DPF((PVR_DBG_ERROR, "BM_Alloc: BM_Buf alloc FAILED"));
-		return IMG_FALSE;
+		pBuf = BM_CacheAlloc(psBMHeap, uSize, uFlags, uDevVAddrAlignment);
 	}
-	OSMemSet(pBuf, 0, sizeof (BM_BUF));
 
-	/*
-	 * Allocate the memory itself now.
-	 */
-	if (AllocMemory(pBMContext,
-					psBMHeap,
-					psDevVAddr,
-					uSize,
-					uFlags,
-					uDevVAddrAlignment,
-					pvPrivData,
-					ui32PrivDataLength,
-					ui32ChunkSize,
-					ui32NumVirtChunks,
-					ui32NumPhysChunks,
-					pabMapChunk,
-					pBuf) != IMG_TRUE)
+	if (pBuf == IMG_NULL)
 	{
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof (BM_BUF), pBuf, IMG_NULL);
-		/* not nulling pointer, out of scope */
-		PVR_DPF((PVR_DBG_ERROR, "BM_Alloc: AllocMemory FAILED"));
-		return IMG_FALSE;
+		/*
+		 * Allocate something in which to record the allocation's details.
+		 */
+		if (OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+					   sizeof (BM_BUF),
+					   (IMG_PVOID *)&pBuf, IMG_NULL,
+					   "Buffer Manager buffer") != PVRSRV_OK)
+		{
+			PVR_DPF((PVR_DBG_ERROR, "BM_Alloc: BM_Buf alloc FAILED"));
+			return IMG_FALSE;
+		}
+		OSMemSet(pBuf, 0, sizeof (BM_BUF));
+
+		/*
+		 * Allocate the memory itself now. If that fails, what the cache
+		 * holds may be what is missing: free it and try once more.
+		 */
+		bAllocated = AllocMemory(pBMContext,
+									  psBMHeap,
+									  psDevVAddr,
+									  uSize,
+									  uFlags,
+									  uDevVAddrAlignment,
+									  pvPrivData,
+									  ui32PrivDataLength,
+									  ui32ChunkSize,
+									  ui32NumVirtChunks,
+									  ui32NumPhysChunks,
+									  pabMapChunk,
+									  pBuf);
+		if (!bAllocated && pBMContext->uCacheBytes != 0)
+		{
+			BM_CacheFlush(pBMContext, IMG_NULL);
+			OSMemSet(pBuf, 0, sizeof (BM_BUF));
+			bAllocated = AllocMemory(pBMContext,
+										  psBMHeap,
+										  psDevVAddr,
+										  uSize,
+										  uFlags,
+										  uDevVAddrAlignment,
+										  pvPrivData,
+										  ui32PrivDataLength,
+										  ui32ChunkSize,
+										  ui32NumVirtChunks,
+										  ui32NumPhysChunks,
+										  pabMapChunk,
+										  pBuf);
+		}
+
+		if (bAllocated != IMG_TRUE)
+		{
+			OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof (BM_BUF), pBuf, IMG_NULL);
+			/* not nulling pointer, out of scope */
+			PVR_DPF((PVR_DBG_ERROR, "BM_Alloc: AllocMemory FAILED"));
+			return IMG_FALSE;
+		}
+
+		/* only set for buffers BM_Free may cache */
+		pBuf->uAllocSize = bCacheable ? uSize : 0;
+		pBuf->ui32AllocFlags = uFlags;
 	}
 
 	PVR_DPF ((PVR_DBG_MESSAGE,
@@ -1984,7 +2492,10 @@ BM_Free (BM_HANDLE hBuf,
 
 			HASH_Remove (pBuf->pMapping->pBMHeap->pBMContext->pBufferHash,	(IMG_UINTPTR_T)sHashAddr.uiAddr);
 		}
-		FreeBuf (pBuf, ui32Flags, IMG_TRUE);
+		if (!BM_CacheInsert(pBuf, ui32Flags))
+		{
+			FreeBuf (pBuf, ui32Flags, IMG_TRUE);
+		}
 	}
 }
 
@@ -2891,6 +3402,7 @@ BM_ImportMemory (IMG_VOID *pH,
 	}
 	pMapping->pBMHeap = pBMHeap;
 	pMapping->ui32Flags = uFlags;
+	pMapping->bZeroed = IMG_FALSE;
 
 	/*
 	 * If anyone want's to know, pass back the actual size of our allocation.
@@ -3048,6 +3560,9 @@ BM_ImportMemory (IMG_VOID *pH,
 			ui32Attribs &= ~PVRSRV_MEM_ALLOCATENONCACHEDMEM;
 			ui32Attribs |= (pMapping->ui32Flags & PVRSRV_MEM_ALLOCATENONCACHEDMEM);
 		}		
+
+		/* Ask for pre-zeroed pages, saving ZeroBuf the work if the OS has them */
+		ui32Attribs |= (pMapping->ui32Flags & PVRSRV_MEM_ZERO);
 		
 		/* allocate pages from the OS RAM */
 		if (OSAllocPages(ui32Attribs,
@@ -3067,6 +3582,8 @@ BM_ImportMemory (IMG_VOID *pH,
 
 		/* specify how page addresses are derived */
 		pMapping->eCpuMemoryOrigin = hm_env;
+		pMapping->bZeroed = (ui32Attribs & PVRSRV_MEM_ZERO) &&
+							OSMemHandleIsZeroed(pMapping->hOSMemHandle);
 	}
 	else if(pBMHeap->ui32Attribs & PVRSRV_BACKINGSTORE_LOCALMEM_CONTIG)
 	{
@@ -100,6 +100,9 @@ typedef struct PVRSRV_DC_SWAPCHAIN_TAG
 #if !defined(SUPPORT_DC_CMDCOMPLETE_WHEN_NO_LONGER_DISPLAYED)
 	PVRSRV_KERNEL_SYNC_INFO				**ppsLastSyncInfos;
 	IMG_UINT32							ui32LastNumSyncInfos;
+	/* flip sync list scratch, kept so a steady flip rate does not allocate */
+	PVRSRV_KERNEL_SYNC_INFO				**ppsCompiledSyncInfos;
+	IMG_UINT32							ui32CompiledSyncInfosSize;
 #endif /* !defined(SUPPORT_DC_CMDCOMPLETE_WHEN_NO_LONGER_DISPLAYED) */
 	struct PVRSRV_DISPLAYCLASS_INFO_TAG *psDCInfo;
 	struct PVRSRV_DC_SWAPCHAIN_TAG		*psNext;
@@ -1170,6 +1173,11 @@ static PVRSRV_ERROR DestroyDCSwapChain(PVRSRV_DC_SWAPCHAIN *psSwapChain)
 		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(PVRSRV_KERNEL_SYNC_INFO *) * psSwapChain->ui32LastNumSyncInfos,
 					psSwapChain->ppsLastSyncInfos, IMG_NULL);
 	}
+	if (psSwapChain->ppsCompiledSyncInfos)
+	{
+		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(PVRSRV_KERNEL_SYNC_INFO *) * psSwapChain->ui32CompiledSyncInfosSize,
+					psSwapChain->ppsCompiledSyncInfos, IMG_NULL);
+	}
 #endif /* !defined(SUPPORT_DC_CMDCOMPLETE_WHEN_NO_LONGER_DISPLAYED) */
 
 	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(PVRSRV_DC_SWAPCHAIN), psSwapChain, IMG_NULL);
@@ -1809,11 +1817,15 @@ Exit:
 	return eError;
 }
 
+/*
+	Per flip callback data. The meminfo list handed to the display driver
+	follows the structure in the same allocation.
+*/
 typedef struct _CALLBACK_DATA_
 {
 	IMG_PVOID	pvPrivData;
 	IMG_UINT32	ui32PrivDataLength;
-	IMG_PVOID	ppvMemInfos;
+	IMG_PVOID	*ppvMemInfos;
 	IMG_UINT32	ui32NumMemInfos;
 } CALLBACK_DATA;
 
@@ -1824,9 +1836,8 @@ static IMG_VOID FreePrivateData(IMG_HANDLE hCallbackData)
 	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, psCallbackData->ui32PrivDataLength,
 			  psCallbackData->pvPrivData, IMG_NULL);
 	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
-			  sizeof(IMG_VOID *) * psCallbackData->ui32NumMemInfos,
-			  psCallbackData->ppvMemInfos, IMG_NULL);
-	OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(CALLBACK_DATA), hCallbackData, IMG_NULL);
+			  sizeof(CALLBACK_DATA) + sizeof(IMG_VOID *) * psCallbackData->ui32NumMemInfos,
+			  hCallbackData, IMG_NULL);
 }
 
 IMG_EXPORT
@@ -1870,7 +1881,7 @@ PVRSRV_ERROR PVRSRVSwapToDCBuffer2KM(IMG_HANDLE	hDeviceKM,
 	}
 
 	eError = OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-					  sizeof(CALLBACK_DATA),
+					  sizeof(CALLBACK_DATA) + sizeof(IMG_VOID *) * ui32NumMemSyncInfos,
 					  (IMG_VOID **)&psCallbackData, IMG_NULL,
 					  "PVRSRVSwapToDCBuffer2KM callback data");
 	if (eError != PVRSRV_OK)
@@ -1881,16 +1892,7 @@ PVRSRV_ERROR PVRSRVSwapToDCBuffer2KM(IMG_HANDLE	hDeviceKM,
 	psCallbackData->pvPrivData = pvPrivData;
 	psCallbackData->ui32PrivDataLength = ui32PrivDataLength;
 
-	if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-				  sizeof(IMG_VOID *) * ui32NumMemSyncInfos,
-				  (IMG_VOID **)&ppvMemInfos, IMG_NULL,
-				  "Swap Command Meminfos") != PVRSRV_OK)
-	{
-		PVR_DPF((PVR_DBG_ERROR,"PVRSRVSwapToDCBuffer2KM: Failed to allocate space for meminfo list"));
-		psCallbackData->ppvMemInfos = IMG_NULL;
-		goto Exit;
-	}
-
+	ppvMemInfos = (IMG_PVOID *)(psCallbackData + 1);
 	for(i = 0; i < ui32NumMemSyncInfos; i++)
 	{
 		ppvMemInfos[i] = ppsMemInfos[i];
@@ -1922,15 +1924,30 @@ PVRSRV_ERROR PVRSRVSwapToDCBuffer2KM(IMG_HANDLE	hDeviceKM,
 
 		ui32NumCompiledSyncInfos = ui32NumMemSyncInfos + ui32NumUniqueSyncInfos;
 
-		if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-					  sizeof(PVRSRV_KERNEL_SYNC_INFO *) * ui32NumCompiledSyncInfos,
-					  (IMG_VOID **)&ppsCompiledSyncInfos, IMG_NULL,
-					  "Compiled syncinfos") != PVRSRV_OK)
+		if (psSwapChain->ui32CompiledSyncInfosSize < ui32NumCompiledSyncInfos)
 		{
-			PVR_DPF((PVR_DBG_ERROR,"PVRSRVSwapToDCBuffer2KM: Failed to allocate space for meminfo list"));
-			goto Exit;
+			if (psSwapChain->ppsCompiledSyncInfos)
+			{
+				OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
+						  sizeof(PVRSRV_KERNEL_SYNC_INFO *) * psSwapChain->ui32CompiledSyncInfosSize,
+						  psSwapChain->ppsCompiledSyncInfos, IMG_NULL);
+				psSwapChain->ppsCompiledSyncInfos = IMG_NULL;
+				psSwapChain->ui32CompiledSyncInfosSize = 0;
+			}
+
+			if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+						  sizeof(PVRSRV_KERNEL_SYNC_INFO *) * ui32NumCompiledSyncInfos,
+						  (IMG_VOID **)&psSwapChain->ppsCompiledSyncInfos, IMG_NULL,
+						  "Compiled syncinfos") != PVRSRV_OK)
+			{
+				PVR_DPF((PVR_DBG_ERROR,"PVRSRVSwapToDCBuffer2KM: Failed to allocate space for meminfo list"));
+				eError = PVRSRV_ERROR_OUT_OF_MEMORY;
+				goto Exit;
+			}
+			psSwapChain->ui32CompiledSyncInfosSize = ui32NumCompiledSyncInfos;
 		}
-				
+		ppsCompiledSyncInfos = psSwapChain->ppsCompiledSyncInfos;
+
 		OSMemCopy(ppsCompiledSyncInfos, ppsSyncInfos, sizeof(PVRSRV_KERNEL_SYNC_INFO *) * ui32NumMemSyncInfos);
 		for(j = 0, i = ui32NumMemSyncInfos; j < psSwapChain->ui32LastNumSyncInfos; j++)
 		{
@@ -1961,13 +1978,6 @@ PVRSRV_ERROR PVRSRVSwapToDCBuffer2KM(IMG_HANDLE	hDeviceKM,
 									FreePrivateData,
 									psCallbackData);
 
-	if (ppsCompiledSyncInfos != ppsSyncInfos)
-	{
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
-			  sizeof(PVRSRV_KERNEL_SYNC_INFO *) * ui32NumCompiledSyncInfos,
-			  (IMG_VOID *)ppsCompiledSyncInfos,
-			  IMG_NULL);
-	}
 	if(eError != PVRSRV_OK)
 	{
 		PVR_DPF((PVR_DBG_ERROR,"PVRSRVSwapToDCBuffer2KM: Failed to get space in queue"));
@@ -2075,13 +2085,9 @@ PVRSRV_ERROR PVRSRVSwapToDCBuffer2KM(IMG_HANDLE	hDeviceKM,
 Exit:
 	if (psCallbackData)
 	{
-		if(psCallbackData->ppvMemInfos)
-		{
-			OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
-					  sizeof(IMG_VOID *) * psCallbackData->ui32NumMemInfos,
-					  psCallbackData->ppvMemInfos, IMG_NULL);
-		}
-		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(CALLBACK_DATA), psCallbackData, IMG_NULL);
+		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
+				  sizeof(CALLBACK_DATA) + sizeof(IMG_VOID *) * ui32NumMemSyncInfos,
+				  psCallbackData, IMG_NULL);
 	}
 	if(eError == PVRSRV_ERROR_CANNOT_GET_QUEUE_SPACE)
 	{
@@ -98,6 +98,32 @@ typedef struct _PVRSRV_DC_MAPINFO_
 
 static IMG_UINT32 g_ui32SyncUID = 0;
 
+/*
+	Released sync infos are kept here with their sync data still allocated,
+	so the next PVRSRVAllocSyncInfoKM for the same heap is a few stores.
+	Releases also come from command completion outside the bridge lock
+	(display flip callbacks), so the pool has its own lock.
+*/
+#define SYNC_INFO_POOL_SIZE	64
+
+static PVRSRV_KERNEL_SYNC_INFO *g_apsSyncInfoPool[SYNC_INFO_POOL_SIZE];
+static IMG_UINT32 g_ui32SyncInfoPoolCount = 0;
+
+#if defined(__linux__)
+#include <linux/spinlock.h>
+static DEFINE_SPINLOCK(gsSyncInfoPoolLock);
+#define SYNC_INFO_POOL_LOCK() \
+	{ \
+		unsigned long ulPoolFlags; \
+		spin_lock_irqsave(&gsSyncInfoPoolLock, ulPoolFlags);
+#define SYNC_INFO_POOL_UNLOCK() \
+		spin_unlock_irqrestore(&gsSyncInfoPoolLock, ulPoolFlags); \
+	}
+#else
+#define SYNC_INFO_POOL_LOCK()	{
+#define SYNC_INFO_POOL_UNLOCK()	}
+#endif
+
 /*!
 ******************************************************************************
 
@@ -671,26 +697,21 @@ static PVRSRV_ERROR FreeDeviceMem(PVRSRV_KERNEL_MEM_INFO *psMemInfo)
 /*!
 ******************************************************************************
 
- @Function	PVRSRVAllocSyncInfoKM
+ @Function	AllocSyncInfo
 
  @Description
 
- Allocates a sync info
+ Allocates a sync info and its sync data in the given heap
 
  @Return   PVRSRV_ERROR :
 
 ******************************************************************************/
-IMG_EXPORT
-PVRSRV_ERROR IMG_CALLCONV PVRSRVAllocSyncInfoKM(IMG_HANDLE					hDevCookie,
-												IMG_HANDLE					hDevMemContext,
-												PVRSRV_KERNEL_SYNC_INFO		**ppsKernelSyncInfo)
+static PVRSRV_ERROR AllocSyncInfo(IMG_HANDLE				hDevCookie,
+								  IMG_HANDLE				hSyncDevMemHeap,
+								  PVRSRV_KERNEL_SYNC_INFO	**ppsKernelSyncInfo)
 {
-	IMG_HANDLE hSyncDevMemHeap;
-	DEVICE_MEMORY_INFO *psDevMemoryInfo;
-	BM_CONTEXT *pBMContext;
 	PVRSRV_ERROR eError;
 	PVRSRV_KERNEL_SYNC_INFO	*psKernelSyncInfo;
-	PVRSRV_SYNC_DATA *psSyncData;
 
 	eError = OSAllocMem(PVRSRV_PAGEABLE_SELECT,
 						sizeof(PVRSRV_KERNEL_SYNC_INFO),
@@ -709,14 +730,6 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVAllocSyncInfoKM(IMG_HANDLE					hDevCookie,
 		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(PVRSRV_KERNEL_SYNC_INFO), psKernelSyncInfo, IMG_NULL);
 		return PVRSRV_ERROR_OUT_OF_MEMORY;
 	}
-	
-
-	/* Get the devnode from the devheap */
-	pBMContext = (BM_CONTEXT*)hDevMemContext;
-	psDevMemoryInfo = &pBMContext->psDeviceNode->sDevMemoryInfo;
-
-	/* and choose a heap for the syncinfo */
-	hSyncDevMemHeap = psDevMemoryInfo->psDeviceMemoryHeap[psDevMemoryInfo->ui32SyncHeapID].hDevMemHeap;
 
 	/*
 		Cache consistent flag would be unnecessary if the heap attributes were
@@ -742,6 +755,90 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVAllocSyncInfoKM(IMG_HANDLE					hDevCookie,
 		return PVRSRV_ERROR_OUT_OF_MEMORY;
 	}
 
+	psKernelSyncInfo->hSyncDevMemHeap = hSyncDevMemHeap;
+	psKernelSyncInfo->sWriteOpsCompleteDevVAddr.uiAddr = psKernelSyncInfo->psSyncDataMemInfoKM->sDevVAddr.uiAddr + offsetof(PVRSRV_SYNC_DATA, ui32WriteOpsComplete);
+	psKernelSyncInfo->sReadOpsCompleteDevVAddr.uiAddr = psKernelSyncInfo->psSyncDataMemInfoKM->sDevVAddr.uiAddr + offsetof(PVRSRV_SYNC_DATA, ui32ReadOpsComplete);
+	psKernelSyncInfo->sReadOps2CompleteDevVAddr.uiAddr = psKernelSyncInfo->psSyncDataMemInfoKM->sDevVAddr.uiAddr + offsetof(PVRSRV_SYNC_DATA, ui32ReadOps2Complete);
+
+	/* syncinfo meminfo has no syncinfo! */
+	psKernelSyncInfo->psSyncDataMemInfoKM->psKernelSyncInfo = IMG_NULL;
+
+	*ppsKernelSyncInfo = psKernelSyncInfo;
+
+	return PVRSRV_OK;
+}
+
+static IMG_VOID FreeSyncInfo(PVRSRV_KERNEL_SYNC_INFO *psKernelSyncInfo)
+{
+	FreeDeviceMem(psKernelSyncInfo->psSyncDataMemInfoKM);
+
+	/* Catch anyone who is trying to access the freed structure */
+	psKernelSyncInfo->psSyncDataMemInfoKM = IMG_NULL;
+	psKernelSyncInfo->psSyncData = IMG_NULL;
+	OSAtomicFree(psKernelSyncInfo->pvRefCount);
+	(IMG_VOID)OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(PVRSRV_KERNEL_SYNC_INFO), psKernelSyncInfo, IMG_NULL);
+	/*not nulling pointer, copy on stack*/
+}
+
+/*!
+******************************************************************************
+
+ @Function	PVRSRVAllocSyncInfoKM
+
+ @Description
+
+ Allocates a sync info, reusing a released one from the same heap if any
+
+ @Return   PVRSRV_ERROR :
+
+******************************************************************************/
+IMG_EXPORT
+PVRSRV_ERROR IMG_CALLCONV PVRSRVAllocSyncInfoKM(IMG_HANDLE					hDevCookie,
+												IMG_HANDLE					hDevMemContext,
+												PVRSRV_KERNEL_SYNC_INFO		**ppsKernelSyncInfo)
+{
+	IMG_HANDLE hSyncDevMemHeap;
+	DEVICE_MEMORY_INFO *psDevMemoryInfo;
+	BM_CONTEXT *pBMContext;
+	PVRSRV_ERROR eError;
+	PVRSRV_KERNEL_SYNC_INFO	*psKernelSyncInfo = IMG_NULL;
+	PVRSRV_SYNC_DATA *psSyncData;
+	IMG_UINT32 i;
+
+	/* Get the devnode from the devheap */
+	pBMContext = (BM_CONTEXT*)hDevMemContext;
+	psDevMemoryInfo = &pBMContext->psDeviceNode->sDevMemoryInfo;
+
+	/* and choose a heap for the syncinfo */
+	hSyncDevMemHeap = psDevMemoryInfo->psDeviceMemoryHeap[psDevMemoryInfo->ui32SyncHeapID].hDevMemHeap;
+
+	/* Most recently released first, its sync data is likely still cached */
+	SYNC_INFO_POOL_LOCK();
+	for (i = g_ui32SyncInfoPoolCount; i > 0; i--)
+	{
+		if (g_apsSyncInfoPool[i - 1]->hSyncDevMemHeap == hSyncDevMemHeap)
+		{
+			psKernelSyncInfo = g_apsSyncInfoPool[i - 1];
+			g_apsSyncInfoPool[i - 1] = g_apsSyncInfoPool[--g_ui32SyncInfoPoolCount];
+			break;
+		}
+	}
+	SYNC_INFO_POOL_UNLOCK();
+
+	if (psKernelSyncInfo != IMG_NULL)
+	{
+		psKernelSyncInfo->hResItem = IMG_NULL;
+	}
+
+	if (psKernelSyncInfo == IMG_NULL)
+	{
+		eError = AllocSyncInfo(hDevCookie, hSyncDevMemHeap, &psKernelSyncInfo);
+		if (eError != PVRSRV_OK)
+		{
+			return eError;
+		}
+	}
+
 	/* init sync data */
 	psKernelSyncInfo->psSyncData = psKernelSyncInfo->psSyncDataMemInfoKM->pvLinAddrKM;
 	psSyncData = psKernelSyncInfo->psSyncData;
@@ -766,15 +863,10 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVAllocSyncInfoKM(IMG_HANDLE					hDevCookie,
 			MAKEUNIQUETAG(psKernelSyncInfo->psSyncDataMemInfoKM));
 #endif
 
-	psKernelSyncInfo->sWriteOpsCompleteDevVAddr.uiAddr = psKernelSyncInfo->psSyncDataMemInfoKM->sDevVAddr.uiAddr + offsetof(PVRSRV_SYNC_DATA, ui32WriteOpsComplete);
-	psKernelSyncInfo->sReadOpsCompleteDevVAddr.uiAddr = psKernelSyncInfo->psSyncDataMemInfoKM->sDevVAddr.uiAddr + offsetof(PVRSRV_SYNC_DATA, ui32ReadOpsComplete);
-	psKernelSyncInfo->sReadOps2CompleteDevVAddr.uiAddr = psKernelSyncInfo->psSyncDataMemInfoKM->sDevVAddr.uiAddr + offsetof(PVRSRV_SYNC_DATA, ui32ReadOps2Complete);
 	psKernelSyncInfo->ui32UID = g_ui32SyncUID++;
 
-	/* syncinfo meminfo has no syncinfo! */
-	psKernelSyncInfo->psSyncDataMemInfoKM->psKernelSyncInfo = IMG_NULL;
-
 	OSAtomicInc(psKernelSyncInfo->pvRefCount);
+	PVRSRVRefCountStatInc(PVRSRV_REFCOUNT_STAT_SYNCINFO);
 
 	/* return result */
 	*ppsKernelSyncInfo = psKernelSyncInfo;
@@ -805,17 +897,67 @@ IMG_VOID IMG_CALLCONV PVRSRVReleaseSyncInfoKM(PVRSRV_KERNEL_SYNC_INFO	*psKernelS
 {
 	if (OSAtomicDecAndTest(psKernelSyncInfo->pvRefCount))
 	{
-		FreeDeviceMem(psKernelSyncInfo->psSyncDataMemInfoKM);
-	
-		/* Catch anyone who is trying to access the freed structure */
-		psKernelSyncInfo->psSyncDataMemInfoKM = IMG_NULL;
-		psKernelSyncInfo->psSyncData = IMG_NULL;
-		OSAtomicFree(psKernelSyncInfo->pvRefCount);
-		(IMG_VOID)OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(PVRSRV_KERNEL_SYNC_INFO), psKernelSyncInfo, IMG_NULL);
-		/*not nulling pointer, copy on stack*/
+		IMG_BOOL bPooled = IMG_FALSE;
+
+		PVRSRVRefCountStatDec(PVRSRV_REFCOUNT_STAT_SYNCINFO);
+
+		SYNC_INFO_POOL_LOCK();
+		if (g_ui32SyncInfoPoolCount < SYNC_INFO_POOL_SIZE)
+		{
+			g_apsSyncInfoPool[g_ui32SyncInfoPoolCount++] = psKernelSyncInfo;
+			bPooled = IMG_TRUE;
+		}
+		SYNC_INFO_POOL_UNLOCK();
+
+		if (!bPooled)
+		{
+			FreeSyncInfo(psKernelSyncInfo);
+		}
 	}
 }
 
+/*!
+******************************************************************************
+
+ @Function	PVRSRVFreeSyncInfoPoolKM
+
+ @Description
+
+ Frees the released sync infos kept for a heap, before the heap goes away
+
+ @Input	   hSyncDevMemHeap : heap the sync data was allocated from
+
+******************************************************************************/
+IMG_EXPORT
+IMG_VOID IMG_CALLCONV PVRSRVFreeSyncInfoPoolKM(IMG_HANDLE hSyncDevMemHeap)
+{
+	PVRSRV_KERNEL_SYNC_INFO *psKernelSyncInfo;
+	IMG_UINT32 i;
+
+	/* FreeSyncInfo can sleep, so take them out one at a time */
+	do
+	{
+		psKernelSyncInfo = IMG_NULL;
+
+		SYNC_INFO_POOL_LOCK();
+		for (i = 0; i < g_ui32SyncInfoPoolCount; i++)
+		{
+			if (g_apsSyncInfoPool[i]->hSyncDevMemHeap == hSyncDevMemHeap)
+			{
+				psKernelSyncInfo = g_apsSyncInfoPool[i];
+				g_apsSyncInfoPool[i] = g_apsSyncInfoPool[--g_ui32SyncInfoPoolCount];
+				break;
+			}
+		}
+		SYNC_INFO_POOL_UNLOCK();
+
+		if (psKernelSyncInfo != IMG_NULL)
+		{
+			FreeSyncInfo(psKernelSyncInfo);
+		}
+	} while (psKernelSyncInfo != IMG_NULL);
+}
+
 /*!
 ******************************************************************************
 
@@ -929,6 +1071,12 @@ PVRSRV_ERROR FreeMemCallBackCommon(PVRSRV_KERNEL_MEM_INFO *psMemInfo,
 			case PVRSRV_MEMTYPE_ION:
 				freeExternal(psMemInfo);
 			case PVRSRV_MEMTYPE_DEVICE:
+				/* page list built for PVRSRVMapDeviceMemoryKM */
+				if (psMemInfo->sMemBlk.psIntSysPAddr)
+				{
+					OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(IMG_SYS_PHYADDR), psMemInfo->sMemBlk.psIntSysPAddr, IMG_NULL);
+					psMemInfo->sMemBlk.psIntSysPAddr = IMG_NULL;
+				}
 			case PVRSRV_MEMTYPE_DEVICECLASS:
 				if (psMemInfo->psKernelSyncInfo)
 				{
@@ -1315,6 +1463,194 @@ static PVRSRV_ERROR IonUnmapCallback(IMG_PVOID  pvParam,
 	return FreeMemCallBackCommon(psMemInfo, ui32Param, PVRSRV_FREE_CALLBACK_ORIGIN_ALLOCATOR);
 }
 
+/*
+	Each process remembers its ION imports. A buffer the client unmaps
+	stays imported and wrapped, so binding it again (video and camera
+	buffers cycle through a small pool) skips the import, the MMU wrap
+	and the sync object allocation. Entries are kept least recently used
+	first and parked ones are freed when the cache is full, or when they
+	hold more than PVRSRV_ION_CACHE_MAX_PARKED_BYTES between them.
+*/
+
+/*!
+******************************************************************************
+
+ @Function	IonCacheRemove
+
+ @Description
+
+ Drops an entry from the ION import cache without freeing its meminfo
+
+ @Input	   psPerProc : PerProcess data
+ @Input    ui32Index : Cache entry
+
+ @Return   IMG_VOID
+
+******************************************************************************/
+static IMG_VOID IonCacheRemove(PVRSRV_PER_PROCESS_DATA *psPerProc,
+							   IMG_UINT32 ui32Index)
+{
+	IMG_UINT32 i;
+
+	for (i = ui32Index + 1; i < psPerProc->ui32IonCacheCount; i++)
+	{
+		psPerProc->asIonCache[i - 1] = psPerProc->asIonCache[i];
+	}
+	psPerProc->ui32IonCacheCount--;
+}
+
+/*!
+******************************************************************************
+
+ @Function	IonCacheTouch
+
+ @Description
+
+ Moves an ION import cache entry to the most recently used end
+
+ @Input	   psPerProc : PerProcess data
+ @Input    ui32Index : Cache entry
+
+ @Return   IMG_UINT32 : New index of the entry
+
+******************************************************************************/
+static IMG_UINT32 IonCacheTouch(PVRSRV_PER_PROCESS_DATA *psPerProc,
+								IMG_UINT32 ui32Index)
+{
+	PVRSRV_ION_CACHE_ENTRY sEntry = psPerProc->asIonCache[ui32Index];
+
+	IonCacheRemove(psPerProc, ui32Index);
+	psPerProc->asIonCache[psPerProc->ui32IonCacheCount] = sEntry;
+
+	return psPerProc->ui32IonCacheCount++;
+}
+
+/*!
+******************************************************************************
+
+ @Function	IonCacheEvict
+
+ @Description
+
+ Drops a parked ION import cache entry and frees its meminfo
+
+ @Input	   psPerProc : PerProcess data
+ @Input    ui32Index : Cache entry
+
+ @Return   IMG_VOID
+
+******************************************************************************/
+static IMG_VOID IonCacheEvict(PVRSRV_PER_PROCESS_DATA *psPerProc,
+							  IMG_UINT32 ui32Index)
+{
+	PVRSRV_KERNEL_MEM_INFO *psMemInfo = psPerProc->asIonCache[ui32Index].psMemInfo;
+
+	PVR_ASSERT(!psPerProc->asIonCache[ui32Index].bInUse);
+
+	psPerProc->ui32IonCacheParkedBytes -= psPerProc->asIonCache[ui32Index].ui32Size;
+	IonCacheRemove(psPerProc, ui32Index);
+	if (ResManFreeResByPtr(psMemInfo->sMemBlk.hResItem, CLEANUP_WITH_POLL) != PVRSRV_OK)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "%s: Failed to free cached ion mapping", __FUNCTION__));
+	}
+}
+
+/*!
+******************************************************************************
+
+ @Function	IonCacheInsert
+
+ @Description
+
+ Remembers a new ION import as in use. Nothing is remembered when every
+ entry is in use.
+
+ @Input	   psPerProc : PerProcess data
+ @Input    hBufferID : ION buffer identity
+ @Input    hDevMemContext : Device memory context cookie
+ @Input    ui32Flags : Mapping flags as requested
+ @Input    ui32Size : Mapping size
+ @Input    psMemInfo : Kernel meminfo of the import
+
+ @Return   IMG_VOID
+
+******************************************************************************/
+static IMG_VOID IonCacheInsert(PVRSRV_PER_PROCESS_DATA *psPerProc,
+							   IMG_HANDLE hBufferID,
+							   IMG_HANDLE hDevMemContext,
+							   IMG_UINT32 ui32Flags,
+							   IMG_UINT32 ui32Size,
+							   PVRSRV_KERNEL_MEM_INFO *psMemInfo)
+{
+	PVRSRV_ION_CACHE_ENTRY *psEntry;
+	IMG_UINT32 i;
+
+	if (psPerProc->ui32IonCacheCount == PVRSRV_ION_CACHE_SIZE)
+	{
+		for (i = 0; i < PVRSRV_ION_CACHE_SIZE; i++)
+		{
+			if (!psPerProc->asIonCache[i].bInUse)
+			{
+				IonCacheEvict(psPerProc, i);
+				break;
+			}
+		}
+
+		if (i == PVRSRV_ION_CACHE_SIZE)
+		{
+			return;
+		}
+	}
+
+	psEntry = &psPerProc->asIonCache[psPerProc->ui32IonCacheCount++];
+	psEntry->hBufferID = hBufferID;
+	psEntry->hDevMemContext = hDevMemContext;
+	psEntry->ui32Flags = ui32Flags;
+	psEntry->ui32Size = ui32Size;
+	psEntry->psMemInfo = psMemInfo;
+	psEntry->bInUse = IMG_TRUE;
+}
+
+/*!
+******************************************************************************
+
+ @Function	PVRSRVFlushIonCacheKM
+
+ @Description
+
+ Frees the parked ION imports of a device memory context and forgets the
+ ones in use, which are then freed on unmap as usual
+
+ @Input	   psPerProc : PerProcess data
+ @Input    hDevMemContext : Device memory context cookie
+
+ @Return   IMG_VOID
+
+******************************************************************************/
+IMG_EXPORT
+IMG_VOID PVRSRVFlushIonCacheKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
+							   IMG_HANDLE hDevMemContext)
+{
+	IMG_UINT32 i;
+
+	for (i = psPerProc->ui32IonCacheCount; i > 0; i--)
+	{
+		if (psPerProc->asIonCache[i - 1].hDevMemContext != hDevMemContext)
+		{
+			continue;
+		}
+
+		if (psPerProc->asIonCache[i - 1].bInUse)
+		{
+			IonCacheRemove(psPerProc, i - 1);
+		}
+		else
+		{
+			IonCacheEvict(psPerProc, i - 1);
+		}
+	}
+}
+
 /*!
 ******************************************************************************
 
@@ -1322,7 +1658,9 @@ static PVRSRV_ERROR IonUnmapCallback(IMG_PVOID  pvParam,
 
  @Description
 
- Map an ION buffer into the specified device memory context
+ Map an ION buffer into the specified device memory context. A buffer
+ this process unmapped earlier with the same attributes is handed back
+ from the ION import cache.
 
  @Input	   psPerProc : PerProcess data
  @Input    hDevCookie : Device node cookie
@@ -1354,6 +1692,8 @@ PVRSRV_ERROR PVRSRVMapIonHandleKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
 	PVRSRV_ERROR eError;
 	IMG_HANDLE hDevMemHeap = IMG_NULL;
 	IMG_HANDLE hPriv;
+	IMG_HANDLE hBufferID;
+	IMG_UINT32 ui32CacheFlags = ui32Flags;
 	BM_HANDLE hBuffer;
 	IMG_UINT32 ui32HeapCount;
 	IMG_UINT32 ui32PageCount;
@@ -1369,6 +1709,32 @@ PVRSRV_ERROR PVRSRVMapIonHandleKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
 
 	psDeviceNode = (PVRSRV_DEVICE_NODE *)hDevCookie;
 
+	if (IonGetBufferID(psPerProcEnv->psIONClient, hIon, &hBufferID) == PVRSRV_OK)
+	{
+		/* Most recently used first, the same buffer tends to come straight back */
+		for (i = psPerProc->ui32IonCacheCount; i > 0; i--)
+		{
+			PVRSRV_ION_CACHE_ENTRY *psEntry = &psPerProc->asIonCache[i - 1];
+
+			if (!psEntry->bInUse
+				&& (psEntry->hBufferID == hBufferID)
+				&& (psEntry->hDevMemContext == hDevMemContext)
+				&& (psEntry->ui32Flags == ui32CacheFlags)
+				&& (psEntry->ui32Size == ui32Size))
+			{
+				psEntry = &psPerProc->asIonCache[IonCacheTouch(psPerProc, i - 1)];
+				psEntry->bInUse = IMG_TRUE;
+				psPerProc->ui32IonCacheParkedBytes -= psEntry->ui32Size;
+				*ppsKernelMemInfo = psEntry->psMemInfo;
+				return PVRSRV_OK;
+			}
+		}
+	}
+	else
+	{
+		hBufferID = IMG_NULL;
+	}
+
 	if(OSAllocMem(PVRSRV_PAGEABLE_SELECT,
 					sizeof(PVRSRV_KERNEL_MEM_INFO),
 					(IMG_VOID **)&psNewKernelMemInfo, IMG_NULL,
@@ -1487,6 +1853,12 @@ PVRSRV_ERROR PVRSRVMapIonHandleKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
 
 	psNewKernelMemInfo->memType = PVRSRV_MEMTYPE_ION;
 
+	if (hBufferID != IMG_NULL)
+	{
+		IonCacheInsert(psPerProc, hBufferID, hDevMemContext, ui32CacheFlags,
+					   ui32Size, psNewKernelMemInfo);
+	}
+
 	*ppsKernelMemInfo = psNewKernelMemInfo;
 	return PVRSRV_OK;
 
@@ -1519,21 +1891,51 @@ exitFailedHeap:
 
  @Description
 
- Frees an ion buffer mapped with PVRSRVMapIonHandleKM, including the mem_info structure
+ Frees an ion buffer mapped with PVRSRVMapIonHandleKM, including the mem_info structure.
+ Buffers held in the ION import cache are parked there instead.
 
+ @Input	   psPerProc : PerProcess data
  @Input	   psMemInfo :
 
  @Return   PVRSRV_ERROR  :
 
 ******************************************************************************/
 IMG_EXPORT
-PVRSRV_ERROR IMG_CALLCONV PVRSRVUnmapIonHandleKM(PVRSRV_KERNEL_MEM_INFO *psMemInfo)
+PVRSRV_ERROR IMG_CALLCONV PVRSRVUnmapIonHandleKM(PVRSRV_PER_PROCESS_DATA *psPerProc,
+												 PVRSRV_KERNEL_MEM_INFO *psMemInfo)
 {
+	IMG_UINT32 i, j;
+
 	if (!psMemInfo)
 	{
 		return PVRSRV_ERROR_INVALID_PARAMS;
 	}
 
+	for (i = 0; i < psPerProc->ui32IonCacheCount; i++)
+	{
+		if (psPerProc->asIonCache[i].psMemInfo == psMemInfo)
+		{
+			PVRSRV_ION_CACHE_ENTRY *psEntry = &psPerProc->asIonCache[IonCacheTouch(psPerProc, i)];
+
+			psEntry->bInUse = IMG_FALSE;
+			psPerProc->ui32IonCacheParkedBytes += psEntry->ui32Size;
+
+			/* Free the oldest parked imports until back under the bound */
+			j = 0;
+			while ((psPerProc->ui32IonCacheParkedBytes > PVRSRV_ION_CACHE_MAX_PARKED_BYTES)
+				   && (j < psPerProc->ui32IonCacheCount))
+			{
+				if (psPerProc->asIonCache[j].bInUse)
+				{
+					j++;
+					continue;
+				}
+				IonCacheEvict(psPerProc, j);
+			}
+			return PVRSRV_OK;
+		}
+	}
+
 	return ResManFreeResByPtr(psMemInfo->sMemBlk.hResItem, CLEANUP_WITH_POLL);
 }
 #endif	/* SUPPORT_ION */
@@ -2035,6 +2437,7 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVMapDeviceMemoryKM(PVRSRV_PER_PROCESS_DATA	*psPer
 	PVRSRV_DEVICE_NODE			*psDeviceNode;
 	IMG_VOID 					*pvPageAlignedCPUVAddr;
 	RESMAN_MAP_DEVICE_MEM_DATA	*psMapData = IMG_NULL;
+	IMG_BOOL					bSharePageList;
 
 	/* check params */
 	if(!psSrcMemInfo || !hDstDevMemHeap || !ppsDstMemInfo)
@@ -2051,33 +2454,58 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVMapDeviceMemoryKM(PVRSRV_PER_PROCESS_DATA	*psPer
 	pvPageAlignedCPUVAddr = (IMG_VOID *)((IMG_UINTPTR_T)psSrcMemInfo->pvLinAddrKM - uPageOffset);
 
 	/*
-		allocate array of SysPAddr to hold SRC allocation page addresses
+		The page list of a source whose pages cannot move is kept in the
+		source and shared by all its mappings, so it is only built for the
+		first one. The reference on the source taken below keeps the list
+		alive until this mapping has gone. Pageable and sparse sources get
+		a private list every time.
 	*/
-	if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
-					uPageCount*sizeof(IMG_SYS_PHYADDR),
-					(IMG_VOID **)&psSysPAddr, IMG_NULL,
-					"Array of Page Addresses") != PVRSRV_OK)
-	{
-		PVR_DPF((PVR_DBG_ERROR,"PVRSRVMapDeviceMemoryKM: Failed to alloc memory for block"));
-		return PVRSRV_ERROR_OUT_OF_MEMORY;
-	}
+	bSharePageList = ((psSrcMemInfo->memType == PVRSRV_MEMTYPE_DEVICE)
+					  || (psSrcMemInfo->memType == PVRSRV_MEMTYPE_WRAPPED)
+					  || (psSrcMemInfo->memType == PVRSRV_MEMTYPE_ION))
+					 && !(psSrcMemInfo->ui32Flags & (PVRSRV_HAP_GPU_PAGEABLE | PVRSRV_MEM_SPARSE));
 
 	psBuf = psSrcMemInfo->sMemBlk.hBuffer;
 
 	/* get the device node */
 	psDeviceNode = psBuf->pMapping->pBMHeap->pBMContext->psDeviceNode;
 
-	/* build a list of physical page addresses */
-	sDevVAddr.uiAddr = psSrcMemInfo->sDevVAddr.uiAddr - IMG_CAST_TO_DEVVADDR_UINT(uPageOffset);
-	for(i=0; i<uPageCount; i++)
+	if (bSharePageList && psSrcMemInfo->sMemBlk.psIntSysPAddr)
+	{
+		psSysPAddr = psSrcMemInfo->sMemBlk.psIntSysPAddr;
+	}
+	else
 	{
-		BM_GetPhysPageAddr(psSrcMemInfo, sDevVAddr, &sDevPAddr);
+		/*
+			allocate array of SysPAddr to hold SRC allocation page addresses
+		*/
+		if(OSAllocMem(PVRSRV_OS_PAGEABLE_HEAP,
+						uPageCount*sizeof(IMG_SYS_PHYADDR),
+						(IMG_VOID **)&psSysPAddr, IMG_NULL,
+						"Array of Page Addresses") != PVRSRV_OK)
+		{
+			PVR_DPF((PVR_DBG_ERROR,"PVRSRVMapDeviceMemoryKM: Failed to alloc memory for block"));
+			return PVRSRV_ERROR_OUT_OF_MEMORY;
+		}
+
+		/* build a list of physical page addresses */
+		sDevVAddr.uiAddr = psSrcMemInfo->sDevVAddr.uiAddr - IMG_CAST_TO_DEVVADDR_UINT(uPageOffset);
+		for(i=0; i<uPageCount; i++)
+		{
+			BM_GetPhysPageAddr(psSrcMemInfo, sDevVAddr, &sDevPAddr);
 
-		/* save the address */
-		psSysPAddr[i] = SysDevPAddrToSysPAddr (psDeviceNode->sDevId.eDeviceType, sDevPAddr);
+			/* save the address */
+			psSysPAddr[i] = SysDevPAddrToSysPAddr (psDeviceNode->sDevId.eDeviceType, sDevPAddr);
 
-		/* advance the DevVaddr one page */
-		sDevVAddr.uiAddr += IMG_CAST_TO_DEVVADDR_UINT(ui32HostPageSize);
+			/* advance the DevVaddr one page */
+			sDevVAddr.uiAddr += IMG_CAST_TO_DEVVADDR_UINT(ui32HostPageSize);
+		}
+
+		/* from now on the source frees it */
+		if (bSharePageList)
+		{
+			psSrcMemInfo->sMemBlk.psIntSysPAddr = psSysPAddr;
+		}
 	}
 
 	/* allocate the resman map data */
@@ -2129,8 +2557,8 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVMapDeviceMemoryKM(PVRSRV_PER_PROCESS_DATA	*psPer
 	/* Convert from BM_HANDLE to external IMG_HANDLE */
 	psMemBlock->hBuffer = (IMG_HANDLE)hBuffer;
 
-	/* Store page list */
-	psMemBlock->psIntSysPAddr = psSysPAddr;
+	/* Store page list, unless the source owns it */
+	psMemBlock->psIntSysPAddr = bSharePageList ? IMG_NULL : psSysPAddr;
 
 	/* patch up the CPU VAddr into the meminfo */
 	psMemInfo->pvLinAddrKM = psSrcMemInfo->pvLinAddrKM;
@@ -2140,6 +2568,16 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVMapDeviceMemoryKM(PVRSRV_PER_PROCESS_DATA	*psPer
 	psMemInfo->uAllocSize = psSrcMemInfo->uAllocSize;
 	psMemInfo->psKernelSyncInfo = psSrcMemInfo->psKernelSyncInfo;
 
+#if defined(CONFIG_GCBV)
+	/*
+	 * Share the GC MMU mapping of the source. It is only unmapped when
+	 * the source meminfo is freed, which the reference taken below holds
+	 * off until this mapping has gone, and the unmap path of a mapped
+	 * meminfo (FreeDeviceMem) never touches it.
+	 */
+	psMemInfo->bvmap_handle = psSrcMemInfo->bvmap_handle;
+#endif
+
 	/* reference the same ksi that the original meminfo referenced */
 	if(psMemInfo->psKernelSyncInfo)
 	{
@@ -2181,7 +2619,7 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVMapDeviceMemoryKM(PVRSRV_PER_PROCESS_DATA	*psPer
 
 ErrorExit:
 
-	if(psSysPAddr)
+	if(psSysPAddr && !bSharePageList)
 	{
 		/* Free the page address list */
 		OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP, sizeof(IMG_SYS_PHYADDR), psSysPAddr, IMG_NULL);
@@ -77,13 +77,24 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define	INDEX_IS_VALID(psBase, i) ((i) < (psBase)->ui32TotalHandCount)
 
+/*
+ * A handle is its array index plus one, with the generation of the handle
+ * structure above the index bits. The generation is bumped each time the
+ * structure is allocated, so a stale handle whose structure has since been
+ * reused is rejected rather than resolving to the new resource. The
+ * generation is kept to 7 bits so handles stay within DEFAULT_MAX_HANDLE.
+ */
+#define	HANDLE_INDEX_BITS	24
+#define	HANDLE_INDEX_MASK	((1U << HANDLE_INDEX_BITS) - 1)
+#define	HANDLE_GEN_MASK		0x7fU
+
 /* Valid handles are never NULL, but handle array indices are based from 0 */
 #if defined (SUPPORT_SID_INTERFACE)
-#define	INDEX_TO_HANDLE(i) ((IMG_SID)((i) + 1))
-#define	HANDLE_TO_INDEX(h) ((IMG_UINT32)(h) - 1)
+#define	MAKE_HANDLE(i, g) ((IMG_SID)((((IMG_UINT32)(g) & HANDLE_GEN_MASK) << HANDLE_INDEX_BITS) | ((i) + 1)))
+#define	HANDLE_TO_INDEX(h) ((((IMG_UINT32)(h)) & HANDLE_INDEX_MASK) - 1)
 #else
-#define	INDEX_TO_HANDLE(i) ((IMG_HANDLE)((IMG_UINTPTR_T)(i) + 1))
-#define	HANDLE_TO_INDEX(h) ((IMG_UINT32)(IMG_UINTPTR_T)(h) - 1)
+#define	MAKE_HANDLE(i, g) ((IMG_HANDLE)(IMG_UINTPTR_T)((((IMG_UINT32)(g) & HANDLE_GEN_MASK) << HANDLE_INDEX_BITS) | ((i) + 1)))
+#define	HANDLE_TO_INDEX(h) ((((IMG_UINT32)(IMG_UINTPTR_T)(h)) & HANDLE_INDEX_MASK) - 1)
 
 #endif
 
@@ -101,13 +112,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define	HANDLE_TO_HANDLE_STRUCT_PTR(psBase, h) (INDEX_TO_HANDLE_STRUCT_PTR(psBase, HANDLE_TO_INDEX(h)))
 
 #define	HANDLE_PTR_TO_INDEX(psHandle) ((psHandle)->ui32Index)
-#define	HANDLE_PTR_TO_HANDLE(psHandle) INDEX_TO_HANDLE(HANDLE_PTR_TO_INDEX(psHandle))
+#define	HANDLE_PTR_TO_HANDLE(psHandle) MAKE_HANDLE(HANDLE_PTR_TO_INDEX(psHandle), (psHandle)->ui32Generation)
 
 #define	ROUND_DOWN_TO_MULTIPLE_OF_BLOCK_SIZE(a) (HANDLE_BLOCK_MASK & (a))
 #define	ROUND_UP_TO_MULTIPLE_OF_BLOCK_SIZE(a) ROUND_DOWN_TO_MULTIPLE_OF_BLOCK_SIZE((a) + HANDLE_BLOCK_SIZE - 1)
 
 #define	DEFAULT_MAX_HANDLE		0x7fffffffu
-#define	DEFAULT_MAX_INDEX_PLUS_ONE	ROUND_DOWN_TO_MULTIPLE_OF_BLOCK_SIZE(DEFAULT_MAX_HANDLE)
+#define	DEFAULT_MAX_INDEX_PLUS_ONE	ROUND_DOWN_TO_MULTIPLE_OF_BLOCK_SIZE(HANDLE_INDEX_MASK)
 
 #define	HANDLES_BATCHED(psBase) ((psBase)->ui32HandBatchSize != 0)
 
@@ -195,6 +206,9 @@ struct sHandle
 	/* Index of this handle in the handle array */
 	IMG_UINT32 ui32Index;
 
+	/* Generation, part of the handle value; see HANDLE_GEN_MASK */
+	IMG_UINT32 ui32Generation;
+
 	/* List head for subhandles of this handle */
 	struct sHandleList sChildren;
 
@@ -230,6 +244,9 @@ struct _PVRSRV_HANDLE_BASE_
 	/* Pointer to array of pointers to handle structures */
 	struct sHandleIndex *psHandleArray;
 
+	/* Number of index structures allocated in psHandleArray */
+	IMG_UINT32 ui32HandleArrayCapacity;
+
 	/*
 	 * Pointer to handle hash table.
 	 * The hash table is used to do reverse lookups, converting data
@@ -354,7 +371,7 @@ IMG_VOID InitParentList(struct sHandle *psHandle)
 {
 	IMG_UINT32 ui32Parent = HANDLE_PTR_TO_INDEX(psHandle);
 
-	HandleListInit(ui32Parent, &psHandle->sChildren, INDEX_TO_HANDLE(ui32Parent));
+	HandleListInit(ui32Parent, &psHandle->sChildren, HANDLE_PTR_TO_HANDLE(psHandle));
 }
 
 /*!
@@ -532,17 +549,20 @@ IMG_VOID HandleListInsertBefore(PVRSRV_HANDLE_BASE *psBase, IMG_UINT32 ui32InsIn
 {
 	/* PRQA S 3305 7 */ /*override stricter alignment warning */
 	struct sHandleList *psPrevIns = LIST_PTR_FROM_INDEX_AND_OFFSET(psBase, psIns->ui32Prev, ui32ParentIndex, uiParentOffset, uiEntryOffset);
+	/* PRQA S 3305 1 */ /*override stricter alignment warning */
+	struct sHandleList *psParentHead = LIST_PTR_FROM_INDEX_AND_OFFSET(psBase, ui32ParentIndex, ui32ParentIndex, uiParentOffset, uiParentOffset);
 
 	PVR_ASSERT(psEntry->hParent == IMG_NULL);
 	PVR_ASSERT(ui32InsIndex == psPrevIns->ui32Next);
-	PVR_ASSERT(LIST_PTR_FROM_INDEX_AND_OFFSET(psBase, ui32ParentIndex, ui32ParentIndex, uiParentOffset, uiParentOffset)->hParent == INDEX_TO_HANDLE(ui32ParentIndex));
+	PVR_ASSERT(HANDLE_TO_INDEX(psParentHead->hParent) == ui32ParentIndex);
 
 	psEntry->ui32Prev = psIns->ui32Prev;
 	psIns->ui32Prev = ui32EntryIndex;
 	psEntry->ui32Next = ui32InsIndex;
 	psPrevIns->ui32Next = ui32EntryIndex;
 
-	psEntry->hParent = INDEX_TO_HANDLE(ui32ParentIndex);
+	/* The list head's parent field is the parent's handle, generation included */
+	psEntry->hParent = psParentHead->hParent;
 }
 
 /*!
@@ -763,6 +783,17 @@ PVRSRV_ERROR GetHandleStructure(PVRSRV_HANDLE_BASE *psBase, struct sHandle **pps
 		return PVRSRV_ERROR_HANDLE_TYPE_MISMATCH;
 	}
 
+	/* The structure may have been freed and reused since the handle was issued */
+	if (HANDLE_PTR_TO_HANDLE(psHandle) != hHandle)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "GetHandleStructure: Stale handle (index: %u, generation %u != %u)", ui32Index,
+				 ((IMG_UINT32)(IMG_UINTPTR_T)hHandle >> HANDLE_INDEX_BITS), psHandle->ui32Generation & HANDLE_GEN_MASK));
+#if defined (SUPPORT_SID_INTERFACE)
+		PVR_DBG_BREAK
+#endif
+		return PVRSRV_ERROR_HANDLE_NOT_ALLOCATED;
+	}
+
 	/* Return the handle structure */
 	*ppsHandle = psHandle;
 
@@ -848,8 +879,10 @@ PVRSRV_ERROR ReallocHandleArray(PVRSRV_HANDLE_BASE *psBase, IMG_UINT32 ui32NewCo
 	struct sHandleIndex *psOldArray = psBase->psHandleArray;
 	IMG_HANDLE hOldArrayBlockAlloc = psBase->hArrayBlockAlloc;
 	IMG_UINT32 ui32OldCount = psBase->ui32TotalHandCount;
+	IMG_UINT32 ui32OldCapacity = psBase->ui32HandleArrayCapacity;
 	struct sHandleIndex *psNewArray = IMG_NULL;
 	IMG_HANDLE hNewArrayBlockAlloc = IMG_NULL;
+	IMG_UINT32 ui32NewCapacity = 0;
 	PVRSRV_ERROR eError;
 	PVRSRV_ERROR eReturn = PVRSRV_OK;
 	IMG_UINT32 ui32Index;
@@ -874,11 +907,24 @@ PVRSRV_ERROR ReallocHandleArray(PVRSRV_HANDLE_BASE *psBase, IMG_UINT32 ui32NewCo
 		return PVRSRV_ERROR_INVALID_PARAMS;
 	}
 
-	if (ui32NewCount != 0)
+	/*
+	 * The handle array grows by doubling, so that adding one block
+	 * at a time doesn't copy the whole array on every allocation, and
+	 * is kept when it already has room for the new count.
+	 */
+	if (ui32NewCount != 0 && HANDLE_ARRAY_SIZE(ui32NewCount) <= ui32OldCapacity)
 	{
+		psNewArray = psOldArray;
+		hNewArrayBlockAlloc = hOldArrayBlockAlloc;
+		ui32NewCapacity = ui32OldCapacity;
+	}
+	else if (ui32NewCount != 0)
+	{
+		ui32NewCapacity = MAX(HANDLE_ARRAY_SIZE(ui32NewCount), ui32OldCapacity * 2);
+
 		/* Allocate new handle array */
 		eError = OSAllocMem(PVRSRV_OS_NON_PAGEABLE_HEAP,
-			HANDLE_ARRAY_SIZE(ui32NewCount) * sizeof(struct sHandleIndex),
+			ui32NewCapacity * sizeof(struct sHandleIndex),
 			(IMG_VOID **)&psNewArray,
 			&hNewArrayBlockAlloc,
 			"Memory Area");
@@ -945,6 +991,7 @@ PVRSRV_ERROR ReallocHandleArray(PVRSRV_HANDLE_BASE *psBase, IMG_UINT32 ui32NewCo
 
 
 				psHandle->ui32Index = ui32SubIndex + ui32Index;
+				psHandle->ui32Generation = 0;
 				psHandle->eType = PVRSRV_HANDLE_TYPE_NONE;
 				psHandle->eInternalFlag = INTERNAL_HANDLE_FLAG_NONE;
 				psHandle->ui32NextIndexPlusOne  = 0;
@@ -966,11 +1013,11 @@ PVRSRV_ERROR ReallocHandleArray(PVRSRV_HANDLE_BASE *psBase, IMG_UINT32 ui32NewCo
 	}
 #endif
 
-	if (psOldArray != IMG_NULL)
+	if (psOldArray != IMG_NULL && psOldArray != psNewArray)
 	{
 		/* Free old handle array */
 		eError = OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
-			HANDLE_ARRAY_SIZE(ui32OldCount) * sizeof(struct sHandleIndex),
+			ui32OldCapacity * sizeof(struct sHandleIndex),
 			psOldArray,
 			hOldArrayBlockAlloc);
 		if (eError != PVRSRV_OK)
@@ -981,6 +1028,7 @@ PVRSRV_ERROR ReallocHandleArray(PVRSRV_HANDLE_BASE *psBase, IMG_UINT32 ui32NewCo
 
 	psBase->psHandleArray = psNewArray;
 	psBase->hArrayBlockAlloc = hNewArrayBlockAlloc;
+	psBase->ui32HandleArrayCapacity = ui32NewCapacity;
 	psBase->ui32TotalHandCount = ui32NewCount;
 
 	if (ui32NewCount > ui32OldCount)
@@ -1061,14 +1109,17 @@ error:
 			}
 		}
 
-		/* Free new handle array */
-		eError = OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
-			HANDLE_ARRAY_SIZE(ui32NewCount) * sizeof(struct sHandleIndex),
-			psNewArray,
-			hNewArrayBlockAlloc);
-		if (eError != PVRSRV_OK)
+		/* Free new handle array, unless the old one was kept */
+		if (psNewArray != psOldArray)
 		{
-			PVR_DPF((PVR_DBG_ERROR, "ReallocHandleArray: Couldn't free new handle array (%d)", eError));
+			eError = OSFreeMem(PVRSRV_OS_PAGEABLE_HEAP,
+				ui32NewCapacity * sizeof(struct sHandleIndex),
+				psNewArray,
+				hNewArrayBlockAlloc);
+			if (eError != PVRSRV_OK)
+			{
+				PVR_DPF((PVR_DBG_ERROR, "ReallocHandleArray: Couldn't free new handle array (%d)", eError));
+			}
 		}
 	}
 
@@ -1135,7 +1186,7 @@ static PVRSRV_ERROR FreeHandle(PVRSRV_HANDLE_BASE *psBase, struct sHandle *psHan
 #endif
 
 		PVR_ASSERT(hHandle != IMG_NULL);
-		PVR_ASSERT(hHandle == INDEX_TO_HANDLE(ui32Index));
+		PVR_ASSERT(hHandle == HANDLE_PTR_TO_HANDLE(psHandle));
 		PVR_UNREFERENCED_PARAMETER(hHandle);
 	}
 
@@ -1542,14 +1593,18 @@ static PVRSRV_ERROR AllocHandle(PVRSRV_HANDLE_BASE *psBase, IMG_HANDLE *phHandle
 					break;
 				}
 			}
+
+			/* Stop at the first block with room, not the last */
+			break;
 		}
 		psBase->ui32FirstFreeIndex = 0;
 		PVR_ASSERT(ui32NewIndex < psBase->ui32TotalHandCount);
 	}
 	PVR_ASSERT(psNewHandle != IMG_NULL);
 
-	/* Handle to be returned to client */
-	hHandle = INDEX_TO_HANDLE(ui32NewIndex);
+	/* Handle to be returned to client, not valid for earlier users of the structure */
+	psNewHandle->ui32Generation = (psNewHandle->ui32Generation + 1) & HANDLE_GEN_MASK;
+	hHandle = HANDLE_PTR_TO_HANDLE(psNewHandle);
 
 	/*
 	 * If a data pointer can be associated with multiple handles, we
@@ -2176,8 +2231,33 @@ PVRSRV_ERROR PVRSRVReleaseHandle(PVRSRV_HANDLE_BASE *psBase, IMG_HANDLE hHandle,
 	}
 
 	eError = FreeHandle(psBase, psHandle);
+	if (eError != PVRSRV_OK)
+	{
+		return eError;
+	}
 
-	return eError;
+	/*
+	 * Handles are allocated from the front of a purging base, so once
+	 * the load drops the tail empties out. Give it back when at least
+	 * half the table is free and the last block is, the same halving
+	 * PVRSRVPurgeHandles applies, so a process hovering around a block
+	 * boundary does not free and reallocate it on every call. Live
+	 * handles are never moved, so their values stay valid.
+	 */
+	if (psBase->bPurgingEnabled && !HANDLES_BATCHED(psBase) &&
+		psBase->ui32TotalHandCount > HANDLE_BLOCK_SIZE &&
+		psBase->ui32FreeHandCount >= psBase->ui32TotalHandCount / 2 &&
+		INDEX_TO_FREE_HAND_BLOCK_COUNT(psBase, psBase->ui32TotalHandCount - 1) == HANDLE_BLOCK_SIZE)
+	{
+		eError = PVRSRVPurgeHandles(psBase);
+		if (eError != PVRSRV_OK)
+		{
+			/* The handle itself was released; keep the larger table */
+			PVR_DPF((PVR_DBG_WARNING, "PVRSRVReleaseHandle: Purge failed (%d)", eError));
+		}
+	}
+
+	return PVRSRV_OK;
 }
 
 /*!
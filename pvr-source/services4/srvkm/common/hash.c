@@ -2,11 +2,13 @@
 @Title          Self scaling hash tables.
 @Copyright      Copyright (c) Imagination Technologies Ltd. All Rights Reserved
 @Description
-   Implements simple self scaling hash tables. Hash collisions are
-   handled by chaining entries together. Hash tables are increased in
-   size when they become more than (50%?) full and decreased in size
-   when less than (25%?) full. Hash tables are never decreased below
-   their initial size.
+   Implements self scaling hash tables. Entries are held inline in an
+   open addressed table and collisions are resolved by linear probing.
+   Tables are grown when more than 50% of the slots are in use or
+   deleted, and shrunk when less than 12.5% are in use, but never
+   below their initial size. Resizing is incremental: the old table is
+   drained a few slots at a time by later inserts and removes, with
+   lookups searching both tables meanwhile.
 @License        Dual MIT/GPLv2
 
 The contents of this file are subject to the MIT license as set out below.
@@ -54,17 +56,42 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define PRIVATE_MAX(a,b) ((a)>(b)?(a):(b))
 
-#define	KEY_TO_INDEX(pHash, key, uSize) \
-	((pHash)->pfnHashFunc((pHash)->uKeySize, (key), (uSize)) % (uSize))
+/* Smallest table, in slots; table sizes are always a power of two */
+#define HASH_MIN_SIZE		8
+
+/*
+ * Old table slots moved to the new table by each insert or remove while
+ * a rehash is in progress. A shrink can be due again after removing
+ * 1/16 of the old table's size in entries, so visiting more than 16
+ * slots per operation drains the old table before the next resize.
+ */
+#define HASH_MIGRATE_STEP	32
 
 #define	KEY_COMPARE(pHash, pKey1, pKey2) \
 	((pHash)->pfnKeyComp((pHash)->uKeySize, (pKey1), (pKey2)))
 
-/* Each entry in a hash table is placed into a bucket */
-struct _BUCKET_
+#define	SLOT_AT(pHash, psTable, uIndex) \
+	((SLOT *)((psTable)->pui8Slots + (IMG_SIZE_T)(uIndex) * (pHash)->uSlotSize))
+
+#define	ROTL32(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+
+/* Slot states, empty slots are zero filled */
+#define SLOT_EMPTY		0
+#define SLOT_USED		1
+#define SLOT_DELETED	2
+
+/*
+ * Each entry is held inline in a slot of the table array. Collisions are
+ * resolved by linear probing, so a lookup touches consecutive slots
+ * rather than following a chain of separately allocated buckets.
+ */
+struct _SLOT_
 {
-	/* the next bucket on the same chain */
-	struct _BUCKET_ *pNext;
+	/* SLOT_EMPTY, SLOT_USED or SLOT_DELETED */
+	IMG_UINT32 uState;
+
+	/* mixed hash of the key, compared before the key itself */
+	IMG_UINT32 uHash;
 
 	/* entry value */
 	IMG_UINTPTR_T v;
@@ -72,16 +99,34 @@ struct _BUCKET_
 	/* entry key */
 	IMG_UINTPTR_T k[];		/* PRQA S 0642 */ /* override dynamic array declaration warning */
 };
-typedef struct _BUCKET_ BUCKET;
+typedef struct _SLOT_ SLOT;
 
-struct _HASH_TABLE_
+typedef struct _SLOT_TABLE_
 {
-	/* the hash table array */
-	BUCKET **ppBucketTable;
+	/* uSize slots of HASH_TABLE.uSlotSize bytes each */
+	IMG_UINT8 *pui8Slots;
 
-	/* current size of the hash table */
+	/* number of slots, a power of two, or 0 when not allocated */
 	IMG_UINT32 uSize;
 
+	/* number of SLOT_USED slots */
+	IMG_UINT32 uUsed;
+
+	/* number of SLOT_DELETED slots */
+	IMG_UINT32 uDeleted;
+} SLOT_TABLE;
+
+struct _HASH_TABLE_
+{
+	/* the table new entries are inserted into */
+	SLOT_TABLE sTable;
+
+	/* the table being drained into sTable by an incremental rehash */
+	SLOT_TABLE sOldTable;
+
+	/* next slot of sOldTable to move */
+	IMG_UINT32 uMigrateIndex;
+
 	/* number of entries currently in the hash table */
 	IMG_UINT32 uCount;
 
@@ -91,6 +136,12 @@ struct _HASH_TABLE_
 	/* size of key in bytes */
 	IMG_UINT32 uKeySize;
 
+	/* size of a slot, including the key, in bytes */
+	IMG_UINT32 uSlotSize;
+
+	/* non-zero while HASH_Iterate is walking the tables */
+	IMG_UINT32 uIterating;
+
 	/* hash function */
 	HASH_FUNC *pfnHashFunc;
 
@@ -98,6 +149,54 @@ struct _HASH_TABLE_
 	HASH_KEY_COMP *pfnKeyComp;
 };
 
+/*!
+******************************************************************************
+	@Function   	_HashCombine
+
+	@Description    Mix one 32 bit word into a running hash (MurmurHash3
+                    block step).
+
+	@Input          uHash - the running hash.
+	@Input          uWord - the word to add.
+
+	@Return 	    the new running hash.
+******************************************************************************/
+static INLINE IMG_UINT32
+_HashCombine (IMG_UINT32 uHash, IMG_UINT32 uWord)
+{
+	uWord *= 0xcc9e2d51U;
+	uWord = ROTL32(uWord, 15);
+	uWord *= 0x1b873593U;
+
+	uHash ^= uWord;
+	uHash = ROTL32(uHash, 13);
+	return uHash * 5 + 0xe6546b64U;
+}
+
+/*!
+******************************************************************************
+	@Function   	_HashFinal
+
+	@Description    Avalanche a hash value (MurmurHash3 finaliser), so the
+                    low bits used to index the table depend on every bit
+                    of the key.
+
+	@Input          uHash - the hash value.
+
+	@Return 	    the mixed hash value.
+******************************************************************************/
+static INLINE IMG_UINT32
+_HashFinal (IMG_UINT32 uHash)
+{
+	uHash ^= uHash >> 16;
+	uHash *= 0x85ebca6bU;
+	uHash ^= uHash >> 13;
+	uHash *= 0xc2b2ae35U;
+	uHash ^= uHash >> 16;
+
+	return uHash;
+}
+
 /*!
 ******************************************************************************
 	@Function   	HASH_Func_Default
@@ -125,21 +224,17 @@ HASH_Func_Default (IMG_SIZE_T uKeySize, IMG_VOID *pKey, IMG_UINT32 uHashTabLen)
 
 	for (ui = 0; ui < uKeyLen; ui++)
 	{
-		IMG_UINT32 uHashPart = (IMG_UINT32)*p++;
-
-		uHashPart += (uHashPart << 12);
-		uHashPart ^= (uHashPart >> 22);
-		uHashPart += (uHashPart << 4);
-		uHashPart ^= (uHashPart >> 9);
-		uHashPart += (uHashPart << 10);
-		uHashPart ^= (uHashPart >> 2);
-		uHashPart += (uHashPart << 7);
-		uHashPart ^= (uHashPart >> 12);
-
-		uHashKey += uHashPart;
+		IMG_UINTPTR_T uKeyPart = *p++;
+
+		uHashKey = _HashCombine(uHashKey, (IMG_UINT32)uKeyPart);
+		if (sizeof(IMG_UINTPTR_T) > sizeof(IMG_UINT32))
+		{
+			/* Pointers on 64 bit kernels differ in the upper half too */
+			uHashKey = _HashCombine(uHashKey, (IMG_UINT32)((IMG_UINT64)uKeyPart >> 32));
+		}
 	}
 
-	return uHashKey;
+	return _HashFinal(uHashKey ^ (IMG_UINT32)uKeySize);
 }
 
 /*!
@@ -175,86 +270,299 @@ HASH_Key_Comp_Default (IMG_SIZE_T uKeySize, IMG_VOID *pKey1, IMG_VOID *pKey2)
 
 /*!
 ******************************************************************************
-	@Function   	_ChainInsert
+	@Function   	_KeyHash
 
-	@Description    Insert a bucket into the appropriate hash table chain.
+	@Description    Hash a key with the table's hash function. A caller
+                    supplied hash is mixed again, so a weak one still
+                    spreads over the low bits used as the slot index. The
+                    table length passed to the hash function is the
+                    minimum size, as the stored hash must not depend on
+                    the current size.
 
-	@Input          pBucket - the bucket
-	@Input          ppBucketTable - the hash table
-	@Input          uSize - the size of the hash table
-    
-	@Return         PVRSRV_ERROR
+	@Input          pHash - the hash table.
+	@Input          pKey - pointer to the key.
+
+	@Return         the hash stored in the key's slot.
 ******************************************************************************/
-static PVRSRV_ERROR
-_ChainInsert (HASH_TABLE *pHash, BUCKET *pBucket, BUCKET **ppBucketTable, IMG_UINT32 uSize)
+static INLINE IMG_UINT32
+_KeyHash (HASH_TABLE *pHash, IMG_VOID *pKey)
 {
-	IMG_UINT32 uIndex;
+	IMG_UINT32 uHash = pHash->pfnHashFunc(pHash->uKeySize, pKey, pHash->uMinimumSize);
 
-	PVR_ASSERT (pBucket != IMG_NULL);
-	PVR_ASSERT (ppBucketTable != IMG_NULL);
-	PVR_ASSERT (uSize != 0);
+	return (pHash->pfnHashFunc == &HASH_Func_Default) ? uHash : _HashFinal(uHash);
+}
+
+/*!
+******************************************************************************
+	@Function   	_TableAlloc
+
+	@Description    Allocate an empty slot table.
+
+	@Input          pHash - the hash table.
+	@Input          psTable - the slot table to fill in.
+	@Input          uSize - number of slots, a power of two.
 
-	if ((pBucket == IMG_NULL) || (ppBucketTable == IMG_NULL) || (uSize == 0))
+	@Return         IMG_TRUE Success
+	            	IMG_FALSE Failed
+******************************************************************************/
+static IMG_BOOL
+_TableAlloc (HASH_TABLE *pHash, SLOT_TABLE *psTable, IMG_UINT32 uSize)
+{
+	if (OSAllocMem(PVRSRV_PAGEABLE_SELECT,
+				   (IMG_SIZE_T)uSize * pHash->uSlotSize,
+				   (IMG_PVOID *)&psTable->pui8Slots, IMG_NULL,
+				   "Hash Table Slots") != PVRSRV_OK)
 	{
-		PVR_DPF((PVR_DBG_ERROR, "_ChainInsert: invalid parameter"));
-		return PVRSRV_ERROR_INVALID_PARAMS;
+		return IMG_FALSE;
 	}
 
-	uIndex = KEY_TO_INDEX(pHash, pBucket->k, uSize);	/* PRQA S 0432,0541 */ /* ignore dynamic array warning */
-	pBucket->pNext = ppBucketTable[uIndex];
-	ppBucketTable[uIndex] = pBucket;
+	OSMemSet(psTable->pui8Slots, 0, (IMG_SIZE_T)uSize * pHash->uSlotSize);
+	psTable->uSize = uSize;
+	psTable->uUsed = 0;
+	psTable->uDeleted = 0;
 
-	return PVRSRV_OK;
+	return IMG_TRUE;
 }
 
 /*!
 ******************************************************************************
-	@Function   	_Rehash
+	@Function   	_TableFree
 
-	@Description   	Iterate over every entry in an old hash table and
-                    rehash into the new table.
+	@Description    Free a slot table's slots, leaving it unallocated.
+
+	@Input          pHash - the hash table.
+	@Input          psTable - the slot table.
 
-	@Input          ppOldTable - the old hash table
-	@Input          uOldSize - the size of the old hash table
-	@Input          ppNewTable - the new hash table
-	@Input          uNewSize - the size of the new hash table
-    
 	@Return         None
 ******************************************************************************/
-static PVRSRV_ERROR
-_Rehash (HASH_TABLE *pHash,
-	 BUCKET **ppOldTable, IMG_UINT32 uOldSize,
-         BUCKET **ppNewTable, IMG_UINT32 uNewSize)
+static IMG_VOID
+_TableFree (HASH_TABLE *pHash, SLOT_TABLE *psTable)
 {
-	IMG_UINT32 uIndex;
-	for (uIndex=0; uIndex< uOldSize; uIndex++)
-    {
-		BUCKET *pBucket;
-		pBucket = ppOldTable[uIndex];
-		while (pBucket != IMG_NULL)
+	if (psTable->uSize != 0)
+	{
+		OSFreeMem(PVRSRV_PAGEABLE_SELECT,
+				  (IMG_SIZE_T)psTable->uSize * pHash->uSlotSize,
+				  psTable->pui8Slots, IMG_NULL);
+	}
+
+	psTable->pui8Slots = IMG_NULL;
+	psTable->uSize = 0;
+	psTable->uUsed = 0;
+	psTable->uDeleted = 0;
+}
+
+/*!
+******************************************************************************
+	@Function   	_TableFind
+
+	@Description    Find the slot holding a key.
+
+	@Input          pHash - the hash table.
+	@Input          psTable - the slot table to search.
+	@Input          pKey - pointer to the key.
+	@Input          uHash - the key's hash.
+	@Output         puIndex - the slot's index.
+
+	@Return         the slot, or IMG_NULL if the key is not in the table.
+******************************************************************************/
+static SLOT *
+_TableFind (HASH_TABLE *pHash, SLOT_TABLE *psTable, IMG_VOID *pKey, IMG_UINT32 uHash, IMG_UINT32 *puIndex)
+{
+	IMG_UINT32 uMask = psTable->uSize - 1;
+	IMG_UINT32 uIndex = uHash & uMask;
+	IMG_UINT32 uProbe;
+
+	for (uProbe = 0; uProbe < psTable->uSize; uProbe++)
+	{
+		SLOT *pSlot = SLOT_AT(pHash, psTable, uIndex);
+
+		if (pSlot->uState == SLOT_EMPTY)
 		{
-			PVRSRV_ERROR eError;
-			BUCKET *pNextBucket = pBucket->pNext;
-			eError = _ChainInsert (pHash, pBucket, ppNewTable, uNewSize);
-			if (eError != PVRSRV_OK)
+			break;
+		}
+
+		/* PRQA S 0432,0541 1 */ /* ignore warning about dynamic array k */
+		if (pSlot->uState == SLOT_USED && pSlot->uHash == uHash &&
+			KEY_COMPARE(pHash, pSlot->k, pKey))
+		{
+			*puIndex = uIndex;
+			return pSlot;
+		}
+
+		uIndex = (uIndex + 1) & uMask;
+	}
+
+	return IMG_NULL;
+}
+
+/*!
+******************************************************************************
+	@Function   	_TablePlace
+
+	@Description    Claim a free slot for a new entry with the given hash.
+                    The caller fills in the value and key.
+
+	@Input          pHash - the hash table.
+	@Input          psTable - the slot table.
+	@Input          uHash - the key's hash.
+
+	@Return         the slot, or IMG_NULL if the table is full.
+******************************************************************************/
+static SLOT *
+_TablePlace (HASH_TABLE *pHash, SLOT_TABLE *psTable, IMG_UINT32 uHash)
+{
+	IMG_UINT32 uMask = psTable->uSize - 1;
+	IMG_UINT32 uIndex = uHash & uMask;
+	IMG_UINT32 uProbe;
+
+	for (uProbe = 0; uProbe < psTable->uSize; uProbe++)
+	{
+		SLOT *pSlot = SLOT_AT(pHash, psTable, uIndex);
+
+		if (pSlot->uState != SLOT_USED)
+		{
+			if (pSlot->uState == SLOT_DELETED)
 			{
-				PVR_DPF((PVR_DBG_ERROR, "_Rehash: call to _ChainInsert failed"));
-				return eError;
+				psTable->uDeleted--;
 			}
-			pBucket = pNextBucket;
+			pSlot->uState = SLOT_USED;
+			pSlot->uHash = uHash;
+			psTable->uUsed++;
+			return pSlot;
 		}
-    }
-	return PVRSRV_OK;
+
+		uIndex = (uIndex + 1) & uMask;
+	}
+
+	return IMG_NULL;
+}
+
+/*!
+******************************************************************************
+	@Function   	_TableErase
+
+	@Description    Remove the entry in a slot. Later entries of the probe
+                    run are shifted back into the hole, so no deleted
+                    marker is left behind. Entries must not move under
+                    HASH_Iterate or in a table being drained, as the walk
+                    could then miss them, so there the slot is marked
+                    deleted instead.
+
+	@Input          pHash - the hash table.
+	@Input          psTable - the slot table.
+	@Input          uIndex - the slot's index.
+
+	@Return         None
+******************************************************************************/
+static IMG_VOID
+_TableErase (HASH_TABLE *pHash, SLOT_TABLE *psTable, IMG_UINT32 uIndex)
+{
+	IMG_UINT32 uMask = psTable->uSize - 1;
+	IMG_UINT32 uHole = uIndex;
+
+	psTable->uUsed--;
+
+	if (pHash->uIterating != 0 || psTable == &pHash->sOldTable)
+	{
+		SLOT_AT(pHash, psTable, uIndex)->uState = SLOT_DELETED;
+		psTable->uDeleted++;
+		return;
+	}
+
+	for (;;)
+	{
+		SLOT *pNext;
+		IMG_UINT32 uHome;
+
+		uIndex = (uIndex + 1) & uMask;
+		pNext = SLOT_AT(pHash, psTable, uIndex);
+		if (pNext->uState == SLOT_EMPTY)
+		{
+			break;
+		}
+
+		/*
+		 * An entry can fill the hole unless its home slot lies
+		 * cyclically after the hole, up to the entry itself.
+		 * Deleted markers carry no entry and always move.
+		 */
+		uHome = pNext->uHash & uMask;
+		if (pNext->uState == SLOT_USED &&
+			((uIndex - uHome) & uMask) < ((uIndex - uHole) & uMask))
+		{
+			continue;
+		}
+
+		OSMemCopy(SLOT_AT(pHash, psTable, uHole), pNext, pHash->uSlotSize);
+		uHole = uIndex;
+	}
+
+	SLOT_AT(pHash, psTable, uHole)->uState = SLOT_EMPTY;
+}
+
+/*!
+******************************************************************************
+	@Function   	_Migrate
+
+	@Description    Move entries from the old table of an incremental
+                    rehash into the current one, freeing the old table
+                    once it has been drained.
+
+	@Input          pHash - the hash table.
+	@Input          uSlots - number of old table slots to visit.
+
+	@Return         None
+******************************************************************************/
+static IMG_VOID
+_Migrate (HASH_TABLE *pHash, IMG_UINT32 uSlots)
+{
+	SLOT_TABLE *psOld = &pHash->sOldTable;
+
+	while (psOld->uSize != 0 && uSlots != 0)
+	{
+		SLOT *pOldSlot = SLOT_AT(pHash, psOld, pHash->uMigrateIndex);
+
+		if (pOldSlot->uState == SLOT_USED)
+		{
+			SLOT *pNewSlot = _TablePlace(pHash, &pHash->sTable, pOldSlot->uHash);
+
+			if (pNewSlot == IMG_NULL)
+			{
+				/* Lookups still search the old table, try again later */
+				PVR_DPF((PVR_DBG_ERROR, "_Migrate: hash table full"));
+				return;
+			}
+
+			pNewSlot->v = pOldSlot->v;
+			/* PRQA S 0432,0541 1 */ /* ignore warning about dynamic array k */
+			OSMemCopy(pNewSlot->k, pOldSlot->k, pHash->uKeySize);
+
+			/* keep the old probe runs intact for the entries still there */
+			pOldSlot->uState = SLOT_DELETED;
+			psOld->uUsed--;
+			psOld->uDeleted++;
+		}
+
+		uSlots--;
+		if (++pHash->uMigrateIndex == psOld->uSize)
+		{
+			PVR_ASSERT(psOld->uUsed == 0);
+			_TableFree(pHash, psOld);
+		}
+	}
 }
 
 /*!
 ******************************************************************************
 	@Function   	_Resize
 
-	@Description    Attempt to resize a hash table, failure to allocate a
-                    new larger hash table is not considered a hard failure.
-                    We simply continue and allow the table to fill up, the
-	            	effect is to allow hash chains to become longer.
+	@Description    Start an incremental rehash into a table of a new
+                    size, which may equal the current size to clear out
+                    deleted slots. Any rehash already in progress is
+                    completed first. Failure to allocate the new table is
+                    not considered a hard failure, we simply continue
+                    with the current one and allow probe sequences to
+                    become longer.
 
 	@Input          pHash - Hash table to resize.
     @Input          uNewSize - Required table size.
@@ -264,38 +572,34 @@ _Rehash (HASH_TABLE *pHash,
 static IMG_BOOL
 _Resize (HASH_TABLE *pHash, IMG_UINT32 uNewSize)
 {
-	if (uNewSize != pHash->uSize)
-    {
-		BUCKET **ppNewTable;
-        IMG_UINT32 uIndex;
+	SLOT_TABLE sNewTable;
 
-		PVR_DPF ((PVR_DBG_MESSAGE,
-                  "HASH_Resize: oldsize=0x%x  newsize=0x%x  count=0x%x",
-				pHash->uSize, uNewSize, pHash->uCount));
+	_Migrate(pHash, pHash->sOldTable.uSize);
+	if (pHash->sOldTable.uSize != 0)
+	{
+		return IMG_FALSE;
+	}
 
-		OSAllocMem(PVRSRV_PAGEABLE_SELECT,
-                      sizeof (BUCKET *) * uNewSize,
-                      (IMG_PVOID*)&ppNewTable, IMG_NULL,
-					  "Hash Table Buckets");
-		if (ppNewTable == IMG_NULL)
-            return IMG_FALSE;
+	PVR_DPF ((PVR_DBG_MESSAGE,
+              "HASH_Resize: oldsize=0x%x  newsize=0x%x  count=0x%x",
+			pHash->sTable.uSize, uNewSize, pHash->uCount));
 
-        for (uIndex=0; uIndex<uNewSize; uIndex++)
-            ppNewTable[uIndex] = IMG_NULL;
+	if (!_TableAlloc(pHash, &sNewTable, uNewSize))
+	{
+		return IMG_FALSE;
+	}
 
-        if (_Rehash (pHash, pHash->ppBucketTable, pHash->uSize, ppNewTable, uNewSize) != PVRSRV_OK)
-		{
-			return IMG_FALSE;
-		}
+	pHash->sOldTable = pHash->sTable;
+	pHash->sTable = sNewTable;
+	pHash->uMigrateIndex = 0;
 
-        OSFreeMem (PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET *)*pHash->uSize, pHash->ppBucketTable, IMG_NULL);
-        /*not nulling pointer, being reassigned just below*/
-        pHash->ppBucketTable = ppNewTable;
-        pHash->uSize = uNewSize;
-    }
-    return IMG_TRUE;
-}
+	if (pHash->sOldTable.uUsed == 0)
+	{
+		_TableFree(pHash, &pHash->sOldTable);
+	}
 
+	return IMG_TRUE;
+}
 
 /*!
 ******************************************************************************
@@ -317,7 +621,7 @@ _Resize (HASH_TABLE *pHash, IMG_UINT32 uNewSize)
 HASH_TABLE * HASH_Create_Extended (IMG_UINT32 uInitialLen, IMG_SIZE_T uKeySize, HASH_FUNC *pfnHashFunc, HASH_KEY_COMP *pfnKeyComp)
 {
 	HASH_TABLE *pHash;
-	IMG_UINT32 uIndex;
+	IMG_UINT32 uSize;
 
 	PVR_DPF ((PVR_DBG_MESSAGE, "HASH_Create_Extended: InitialSize=0x%x", uInitialLen));
 
@@ -329,27 +633,24 @@ HASH_TABLE * HASH_Create_Extended (IMG_UINT32 uInitialLen, IMG_SIZE_T uKeySize,
 		return IMG_NULL;
 	}
 
-	pHash->uCount = 0;
-	pHash->uSize = uInitialLen;
-	pHash->uMinimumSize = uInitialLen;
+	for (uSize = HASH_MIN_SIZE; uSize < uInitialLen; uSize <<= 1)
+		;
+
+	OSMemSet(pHash, 0, sizeof(HASH_TABLE));
+	pHash->uMinimumSize = uSize;
 	pHash->uKeySize = (IMG_UINT32)uKeySize;
+	pHash->uSlotSize = (IMG_UINT32)((sizeof(SLOT) + uKeySize + sizeof(IMG_UINTPTR_T) - 1) &
+									~(sizeof(IMG_UINTPTR_T) - 1));
 	pHash->pfnHashFunc = pfnHashFunc;
 	pHash->pfnKeyComp = pfnKeyComp;
 
-	OSAllocMem(PVRSRV_PAGEABLE_SELECT,
-                  sizeof (BUCKET *) * pHash->uSize,
-                  (IMG_PVOID*)&pHash->ppBucketTable, IMG_NULL,
-				  "Hash Table Buckets");
-
-	if (pHash->ppBucketTable == IMG_NULL)
+	if (!_TableAlloc(pHash, &pHash->sTable, uSize))
     {
 		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(HASH_TABLE), pHash, IMG_NULL);
 		/*not nulling pointer, out of scope*/
 		return IMG_NULL;
     }
 
-	for (uIndex=0; uIndex<pHash->uSize; uIndex++)
-		pHash->ppBucketTable[uIndex] = IMG_NULL;
 	return pHash;
 }
 
@@ -398,8 +699,8 @@ HASH_Delete (HASH_TABLE *pHash)
 			PVR_DPF ((PVR_DBG_ERROR, "HASH_Delete: leak detected in hash table!"));
 			PVR_DPF ((PVR_DBG_ERROR, "Likely Cause: client drivers not freeing alocations before destroying devmemcontext"));
 		}
-		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET *)*pHash->uSize, pHash->ppBucketTable, IMG_NULL);
-		pHash->ppBucketTable = IMG_NULL;
+		_TableFree(pHash, &pHash->sOldTable);
+		_TableFree(pHash, &pHash->sTable);
 		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(HASH_TABLE), pHash, IMG_NULL);
 		/*not nulling pointer, copy on stack*/
     }
@@ -422,7 +723,8 @@ HASH_Delete (HASH_TABLE *pHash)
 IMG_BOOL
 HASH_Insert_Extended (HASH_TABLE *pHash, IMG_VOID *pKey, IMG_UINTPTR_T v)
 {
-	BUCKET *pBucket;
+	SLOT *pSlot;
+	IMG_UINT32 uHash;
 
 	PVR_DPF ((PVR_DBG_MESSAGE,
               "HASH_Insert_Extended: Hash=0x%08x, pKey=0x%08x, v=0x%x",
@@ -436,37 +738,38 @@ HASH_Insert_Extended (HASH_TABLE *pHash, IMG_VOID *pKey, IMG_UINTPTR_T v)
 		return IMG_FALSE;
 	}
 
-	if(OSAllocMem(PVRSRV_PAGEABLE_SELECT,
-					sizeof(BUCKET) + pHash->uKeySize,
-					(IMG_VOID **)&pBucket, IMG_NULL,
-					"Hash Table entry") != PVRSRV_OK)
+	uHash = _KeyHash(pHash, pKey);
+
+	if (pHash->uIterating == 0)
 	{
-		return IMG_FALSE;
+		_Migrate(pHash, HASH_MIGRATE_STEP);
 	}
 
-	pBucket->v = v;
-	/* PRQA S 0432,0541 1 */ /* ignore warning about dynamic array k (linux)*/
-	OSMemCopy(pBucket->k, pKey, pHash->uKeySize);
-	if (_ChainInsert (pHash, pBucket, pHash->ppBucketTable, pHash->uSize) != PVRSRV_OK)
+	pSlot = _TablePlace(pHash, &pHash->sTable, uHash);
+	if (pSlot == IMG_NULL)
 	{
-		OSFreeMem(PVRSRV_PAGEABLE_SELECT,
-				  sizeof(BUCKET) + pHash->uKeySize,
-				  pBucket, IMG_NULL);
+		PVR_DPF((PVR_DBG_ERROR, "HASH_Insert_Extended: hash table full"));
 		return IMG_FALSE;
 	}
 
+	pSlot->v = v;
+	/* PRQA S 0432,0541 1 */ /* ignore warning about dynamic array k (linux)*/
+	OSMemCopy(pSlot->k, pKey, pHash->uKeySize);
+
 	pHash->uCount++;
 
 	/* check if we need to think about re-balencing */
-	if (pHash->uCount << 1 > pHash->uSize)
+	if (pHash->uIterating == 0 &&
+		(pHash->sTable.uUsed + pHash->sTable.uDeleted) << 1 > pHash->sTable.uSize)
     {
-        /* Ignore the return code from _Resize because the hash table is
-           still in a valid state and although not ideally sized, it is still
-           functional */
-        _Resize (pHash, pHash->uSize << 1);
+        /* Grow if the table is mostly live entries, else just clear out
+           the deleted slots left by HASH_Iterate. Ignore the return code
+           from _Resize because the hash table is still in a valid state
+           and although not ideally sized, it is still functional */
+        _Resize (pHash, (pHash->uCount << 2 > pHash->sTable.uSize) ?
+				 pHash->sTable.uSize << 1 : pHash->sTable.uSize);
     }
 
-
 	return IMG_TRUE;
 }
 
@@ -510,8 +813,11 @@ HASH_Insert (HASH_TABLE *pHash, IMG_UINTPTR_T k, IMG_UINTPTR_T v)
 IMG_UINTPTR_T
 HASH_Remove_Extended(HASH_TABLE *pHash, IMG_VOID *pKey)
 {
-	BUCKET **ppBucket;
+	SLOT_TABLE *psTable;
+	SLOT *pSlot;
+	IMG_UINT32 uHash;
 	IMG_UINT32 uIndex;
+	IMG_UINTPTR_T v;
 
 	PVR_DPF ((PVR_DBG_MESSAGE, "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x",
 			(IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey));
@@ -524,44 +830,50 @@ HASH_Remove_Extended(HASH_TABLE *pHash, IMG_VOID *pKey)
 		return 0;
 	}
 
-	uIndex = KEY_TO_INDEX(pHash, pKey, pHash->uSize);
+	uHash = _KeyHash(pHash, pKey);
 
-	for (ppBucket = &(pHash->ppBucketTable[uIndex]); *ppBucket != IMG_NULL; ppBucket = &((*ppBucket)->pNext))
+	psTable = &pHash->sTable;
+	pSlot = _TableFind(pHash, psTable, pKey, uHash, &uIndex);
+	if (pSlot == IMG_NULL && pHash->sOldTable.uSize != 0)
 	{
-		/* PRQA S 0432,0541 1 */ /* ignore warning about dynamic array k */
-		if (KEY_COMPARE(pHash, (*ppBucket)->k, pKey))
+		psTable = &pHash->sOldTable;
+		pSlot = _TableFind(pHash, psTable, pKey, uHash, &uIndex);
+	}
+
+	if (pSlot == IMG_NULL)
+	{
+		PVR_DPF ((PVR_DBG_MESSAGE,
+				  "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x0 !!!!",
+				  (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey));
+		return 0;
+	}
+
+	v = pSlot->v;
+	_TableErase(pHash, psTable, uIndex);
+	pHash->uCount--;
+
+	/* Don't move entries under HASH_Iterate, its callback may remove them */
+	if (pHash->uIterating == 0)
+	{
+		_Migrate(pHash, HASH_MIGRATE_STEP);
+
+		/* check if we need to think about re-balencing */
+		if (pHash->sTable.uSize > (pHash->uCount << 3) &&
+			pHash->sTable.uSize > pHash->uMinimumSize)
 		{
-			BUCKET *pBucket = *ppBucket;
-			IMG_UINTPTR_T v = pBucket->v;
-			(*ppBucket) = pBucket->pNext;
-
-			OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(BUCKET) + pHash->uKeySize, pBucket, IMG_NULL);
-			/*not nulling original pointer, already overwritten*/
-
-			pHash->uCount--;
-
-			/* check if we need to think about re-balencing */
-			if (pHash->uSize > (pHash->uCount << 2) &&
-                pHash->uSize > pHash->uMinimumSize)
-            {
-                /* Ignore the return code from _Resize because the
-                   hash table is still in a valid state and although
-                   not ideally sized, it is still functional */
-				_Resize (pHash,
-                         PRIVATE_MAX (pHash->uSize >> 1,
-                                      pHash->uMinimumSize));
-            }
-
-			PVR_DPF ((PVR_DBG_MESSAGE,
-                      "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x%x",
-                      (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
-			return v;
+			/* Ignore the return code from _Resize because the
+			   hash table is still in a valid state and although
+			   not ideally sized, it is still functional */
+			_Resize (pHash,
+					 PRIVATE_MAX (pHash->sTable.uSize >> 1,
+								  pHash->uMinimumSize));
 		}
 	}
+
 	PVR_DPF ((PVR_DBG_MESSAGE,
-              "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x0 !!!!",
-              (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey));
-	return 0;
+			  "HASH_Remove_Extended: Hash=0x%x, pKey=0x%x = 0x%x",
+			  (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
+	return v;
 }
 
 /*!
@@ -591,7 +903,9 @@ HASH_Remove (HASH_TABLE *pHash, IMG_UINTPTR_T k)
 	@Function   	HASH_Retrieve_Extended
 
 	@Description    Retrieve a value from a hash table created with
-                    HASH_Create_Extended.
+                    HASH_Create_Extended. The table is not modified, so
+                    concurrent retrieves are safe when inserts and
+                    removes are excluded.
 
 	@Input          pHash - the hash table.
 	@Input          pKey - pointer to the key.
@@ -602,7 +916,8 @@ HASH_Remove (HASH_TABLE *pHash, IMG_UINTPTR_T k)
 IMG_UINTPTR_T
 HASH_Retrieve_Extended (HASH_TABLE *pHash, IMG_VOID *pKey)
 {
-	BUCKET **ppBucket;
+	SLOT *pSlot;
+	IMG_UINT32 uHash;
 	IMG_UINT32 uIndex;
 
 	PVR_DPF ((PVR_DBG_MESSAGE, "HASH_Retrieve_Extended: Hash=0x%x, pKey=0x%x",
@@ -616,21 +931,20 @@ HASH_Retrieve_Extended (HASH_TABLE *pHash, IMG_VOID *pKey)
 		return 0;
 	}
 
-	uIndex = KEY_TO_INDEX(pHash, pKey, pHash->uSize);
+	uHash = _KeyHash(pHash, pKey);
 
-	for (ppBucket = &(pHash->ppBucketTable[uIndex]); *ppBucket != IMG_NULL; ppBucket = &((*ppBucket)->pNext))
+	pSlot = _TableFind(pHash, &pHash->sTable, pKey, uHash, &uIndex);
+	if (pSlot == IMG_NULL && pHash->sOldTable.uSize != 0)
 	{
-		/* PRQA S 0432,0541 1 */ /* ignore warning about dynamic array k */
-		if (KEY_COMPARE(pHash, (*ppBucket)->k, pKey))
-		{
-			BUCKET *pBucket = *ppBucket;
-			IMG_UINTPTR_T v = pBucket->v;
+		pSlot = _TableFind(pHash, &pHash->sOldTable, pKey, uHash, &uIndex);
+	}
 
-			PVR_DPF ((PVR_DBG_MESSAGE,
-                      "HASH_Retrieve: Hash=0x%x, pKey=0x%x = 0x%x",
-                      (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, v));
-			return v;
-		}
+	if (pSlot != IMG_NULL)
+	{
+		PVR_DPF ((PVR_DBG_MESSAGE,
+                  "HASH_Retrieve: Hash=0x%x, pKey=0x%x = 0x%x",
+                  (IMG_UINTPTR_T)pHash, (IMG_UINTPTR_T)pKey, pSlot->v));
+		return pSlot->v;
 	}
 	PVR_DPF ((PVR_DBG_MESSAGE,
               "HASH_Retrieve: Hash=0x%x, pKey=0x%x = 0x0 !!!!",
@@ -662,7 +976,8 @@ HASH_Retrieve (HASH_TABLE *pHash, IMG_UINTPTR_T k)
 ******************************************************************************
 	@Function   	HASH_Iterate
 
-	@Description    Iterate over every entry in the hash table
+	@Description    Iterate over every entry in the hash table. The
+                    callback may remove the entry it was passed.
 
 	@Input          pHash - the old hash table
 	@Input          pfnCallback - the size of the old hash table
@@ -672,26 +987,40 @@ HASH_Retrieve (HASH_TABLE *pHash, IMG_UINTPTR_T k)
 PVRSRV_ERROR
 HASH_Iterate(HASH_TABLE *pHash, HASH_pfnCallback pfnCallback)
 {
-	IMG_UINT32 uIndex;
-	for (uIndex=0; uIndex < pHash->uSize; uIndex++)
+	SLOT_TABLE *apsTables[2];
+	PVRSRV_ERROR eError = PVRSRV_OK;
+	IMG_UINT32 uTable;
+
+	apsTables[0] = &pHash->sTable;
+	apsTables[1] = &pHash->sOldTable;
+
+	pHash->uIterating++;
+
+	for (uTable = 0; uTable < 2 && eError == PVRSRV_OK; uTable++)
 	{
-		BUCKET *pBucket;
-		pBucket = pHash->ppBucketTable[uIndex];
-		while (pBucket != IMG_NULL)
+		SLOT_TABLE *psTable = apsTables[uTable];
+		IMG_UINT32 uIndex;
+
+		for (uIndex = 0; uIndex < psTable->uSize; uIndex++)
 		{
-			PVRSRV_ERROR eError;
-			BUCKET *pNextBucket = pBucket->pNext;
-			
-			eError = pfnCallback((IMG_UINTPTR_T) ((IMG_VOID *) *(pBucket->k)), (IMG_UINTPTR_T) pBucket->v);
+			SLOT *pSlot = SLOT_AT(pHash, psTable, uIndex);
+
+			if (pSlot->uState != SLOT_USED)
+			{
+				continue;
+			}
+
+			eError = pfnCallback((IMG_UINTPTR_T) ((IMG_VOID *) *(pSlot->k)), (IMG_UINTPTR_T) pSlot->v);
 
 			/* The callback might want us to break out early */
 			if (eError != PVRSRV_OK)
-				return eError;
-
-			pBucket = pNextBucket;
+				break;
 		}
 	}
-	return PVRSRV_OK;
+
+	pHash->uIterating--;
+
+	return eError;
 }
 
 #ifdef HASH_TRACE
@@ -709,30 +1038,32 @@ HASH_Iterate(HASH_TABLE *pHash, HASH_pfnCallback pfnCallback)
 IMG_VOID
 HASH_Dump (HASH_TABLE *pHash)
 {
+	SLOT_TABLE *psTable;
 	IMG_UINT32 uIndex;
-	IMG_UINT32 uMaxLength=0;
-	IMG_UINT32 uEmptyCount=0;
+	IMG_UINT32 uMaxProbe=0;
+	IMG_UINT32 uTotalProbe=0;
 
 	PVR_ASSERT (pHash != IMG_NULL);
-	for (uIndex=0; uIndex<pHash->uSize; uIndex++)
+	psTable = &pHash->sTable;
+	for (uIndex=0; uIndex<psTable->uSize; uIndex++)
 	{
-		BUCKET *pBucket;
-		IMG_UINT32 uLength = 0;
-		if (pHash->ppBucketTable[uIndex] == IMG_NULL)
-		{
-			uEmptyCount++;
-		}
-		for (pBucket=pHash->ppBucketTable[uIndex];
-				pBucket != IMG_NULL;
-				pBucket = pBucket->pNext)
+		SLOT *pSlot = SLOT_AT(pHash, psTable, uIndex);
+		IMG_UINT32 uProbe;
+
+		if (pSlot->uState != SLOT_USED)
 		{
-			uLength++;
+			continue;
 		}
-		uMaxLength = PRIVATE_MAX (uMaxLength, uLength);
+
+		/* distance from the slot the entry hashes to */
+		uProbe = (uIndex - pSlot->uHash) & (psTable->uSize - 1);
+		uTotalProbe += uProbe;
+		uMaxProbe = PRIVATE_MAX (uMaxProbe, uProbe);
 	}
 
-	PVR_TRACE(("hash table: uMinimumSize=%d  size=%d  count=%d",
-			pHash->uMinimumSize, pHash->uSize, pHash->uCount));
-	PVR_TRACE(("  empty=%d  max=%d", uEmptyCount, uMaxLength));
+	PVR_TRACE(("hash table: uMinimumSize=%d  size=%d  count=%d  oldsize=%d",
+			pHash->uMinimumSize, psTable->uSize, pHash->uCount, pHash->sOldTable.uSize));
+	PVR_TRACE(("  used=%d  deleted=%d  max probe=%d  total probe=%d",
+			psTable->uUsed, psTable->uDeleted, uMaxProbe, uTotalProbe));
 }
 #endif
@@ -262,6 +262,18 @@ PVRSRV_ERROR PVRSRVPerProcessDataConnect(IMG_UINT32	ui32PID, IMG_UINT32 ui32Flag
 			PVR_DPF((PVR_DBG_ERROR, "PVRSRVPerProcessDataConnect: Couldn't set handle options (%d)", eError));
 			goto failure;
 		}
+
+		/*
+			Long lived processes (the compositor, system server) would
+			otherwise keep their handle table at its peak size, with
+			their live handles spread over all of it.
+		*/
+		eError = PVRSRVEnableHandlePurging(psPerProc->psHandleBase);
+		if (eError != PVRSRV_OK)
+		{
+			PVR_DPF((PVR_DBG_ERROR, "PVRSRVPerProcessDataConnect: Couldn't enable handle purging (%d)", eError));
+			goto failure;
+		}
 		
 		/* Create a resource manager context for the process */
 		eError = PVRSRVResManConnect(psPerProc, &psPerProc->hResManContext);
@@ -920,6 +920,16 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVDeinitialiseDevice(IMG_UINT32 ui32DevIndex)
 		return eError;
 	}
 
+	/*
+		Free the recycled sync infos while their heap still exists.
+	*/
+	if (psDeviceNode->sDevMemoryInfo.psDeviceMemoryHeap != IMG_NULL)
+	{
+		DEVICE_MEMORY_INFO *psDevMemoryInfo = &psDeviceNode->sDevMemoryInfo;
+
+		PVRSRVFreeSyncInfoPoolKM(psDevMemoryInfo->psDeviceMemoryHeap[psDevMemoryInfo->ui32SyncHeapID].hDevMemHeap);
+	}
+
 	/*
 		De-init the device.
 	*/
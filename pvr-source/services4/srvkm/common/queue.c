@@ -365,6 +365,30 @@ static IMG_SIZE_T NearestPower2(IMG_SIZE_T ui32Value)
 }
 
 
+/*!
+******************************************************************************
+
+ @Function	QueueRunDeferredPass
+
+ @Description	Schedules the queue pass PVRSRVProcessQueues handed over while
+				the caller held sQProcessResource. Call after unlocking,
+				including on error paths.
+
+ @Input		psSysData :
+
+******************************************************************************/
+static IMG_VOID QueueRunDeferredPass(SYS_DATA *psSysData)
+{
+	/* Don't let the flag read move ahead of the unlock store */
+	OSMemoryBarrier();
+
+	if (psSysData->bQProcessPending && (psSysData->psQueueList != IMG_NULL))
+	{
+		OSScheduleMISR(psSysData);
+	}
+}
+
+
 /*!
 ******************************************************************************
 
@@ -455,12 +479,16 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVCreateCommandQueueKM(IMG_SIZE_T ui32QueueSize,
 		goto ErrorExit;
 	}
 
+	QueueRunDeferredPass(psSysData);
+
 	*ppsQueueInfo = psQueueInfo;
 
 	return PVRSRV_OK;
 
 ErrorExit:
 
+	QueueRunDeferredPass(psSysData);
+
 	if(psQueueInfo)
 	{
 		if(psQueueInfo->pvLinQueueKM)
@@ -606,6 +634,8 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVDestroyCommandQueueKM(PVRSRV_QUEUE_INFO *psQueue
 
 ErrorExit:
 
+	QueueRunDeferredPass(psSysData);
+
 	return eError;
 }
 
@@ -852,6 +882,68 @@ PVRSRV_ERROR IMG_CALLCONV PVRSRVSubmitCommandKM(PVRSRV_QUEUE_INFO *psQueue,
 	return PVRSRV_OK;
 }
 
+/*
+	Commands handed to their device's command processor so far. A source sync
+	can be satisfied by a command in flight (CheckIfSyncIsQueued), so a
+	blocked command is only known to still be blocked while this is unchanged.
+*/
+static IMG_UINT32 gui32QueueDispatchCount = 0;
+
+/*!
+******************************************************************************
+
+ @Function	QueueRecordBlockingSync
+
+ @Description	Remember the sync object the queue's head command failed on,
+				with the counter values it was checked against.
+
+ @Input		psQueue : queue holding the command, or IMG_NULL
+ @Input		psSyncData : sync data of the failing sync object
+ @Input		ui32WriteOpsComplete : write ops complete value checked
+ @Input		ui32ReadOpsComplete : read ops complete value checked
+
+******************************************************************************/
+static INLINE
+IMG_VOID QueueRecordBlockingSync(PVRSRV_QUEUE_INFO	*psQueue,
+								 PVRSRV_SYNC_DATA	*psSyncData,
+								 IMG_UINT32			ui32WriteOpsComplete,
+								 IMG_UINT32			ui32ReadOpsComplete)
+{
+	if (psQueue != IMG_NULL)
+	{
+		psQueue->psBlockedSyncData = psSyncData;
+		psQueue->ui32BlockedReadOffset = psQueue->ui32ReadOffset;
+		psQueue->ui32BlockedWriteOpsComplete = ui32WriteOpsComplete;
+		psQueue->ui32BlockedReadOpsComplete = ui32ReadOpsComplete;
+		psQueue->ui32BlockedDispatchCount = gui32QueueDispatchCount;
+	}
+}
+
+/*!
+******************************************************************************
+
+ @Function	QueueStillBlocked
+
+ @Description	Whether the queue's head command is the one that last failed
+				its sync check, and nothing it was waiting on has moved since.
+
+ @Input		psQueue : queue to check
+
+ @Return	IMG_TRUE if the command cannot be ready yet
+
+******************************************************************************/
+static INLINE
+IMG_BOOL QueueStillBlocked(PVRSRV_QUEUE_INFO *psQueue)
+{
+	PVRSRV_SYNC_DATA *psSyncData = psQueue->psBlockedSyncData;
+
+	return (IMG_BOOL)((psSyncData != IMG_NULL)
+			&& (psQueue->ui32BlockedReadOffset == psQueue->ui32ReadOffset)
+			&& (psQueue->ui32BlockedDispatchCount == gui32QueueDispatchCount)
+			&& (psSyncData->ui32WriteOpsComplete == psQueue->ui32BlockedWriteOpsComplete)
+			&& (psSyncData->ui32ReadOps2Complete == psQueue->ui32BlockedReadOpsComplete));
+}
+
 /*!
 ******************************************************************************
 
@@ -918,6 +1010,8 @@ PVRSRV_ERROR CheckIfSyncIsQueued(PVRSRV_SYNC_OBJECT *psSync, COMMAND_COMPLETE_DA
  @Input		psSysData : system data
  @Input		psCommand : PVRSRV_COMMAND structure
  @Input		bFlush : Check for stale dependencies (only used for HW recovery)
+ @Input		psQueue : queue holding psCommand; the sync object it fails
+					  on, if any, is recorded there
 
  @Return	PVRSRV_ERROR
 
@@ -925,7 +1019,8 @@ PVRSRV_ERROR CheckIfSyncIsQueued(PVRSRV_SYNC_OBJECT *psSync, COMMAND_COMPLETE_DA
 static
 PVRSRV_ERROR PVRSRVProcessCommand(SYS_DATA			*psSysData,
 								  PVRSRV_COMMAND	*psCommand,
-								  IMG_BOOL			bFlush)
+								  IMG_BOOL			bFlush,
+								  PVRSRV_QUEUE_INFO	*psQueue)
 {
 	PVRSRV_SYNC_OBJECT		*psWalkerObj;
 	PVRSRV_SYNC_OBJECT		*psEndObj;
@@ -954,6 +1049,7 @@ PVRSRV_ERROR PVRSRVProcessCommand(SYS_DATA			*psSysData,
 				!SYNCOPS_STALE(ui32WriteOpsComplete, psWalkerObj->ui32WriteOpsPending) ||
 				!SYNCOPS_STALE(ui32ReadOpsComplete, psWalkerObj->ui32ReadOps2Pending))
 			{
+				QueueRecordBlockingSync(psQueue, psSyncData, ui32WriteOpsComplete, ui32ReadOpsComplete);
 				return PVRSRV_ERROR_FAILED_DEPENDENCIES;
 			}
 		}
@@ -1002,7 +1098,10 @@ PVRSRV_ERROR PVRSRVProcessCommand(SYS_DATA			*psSysData,
 					}
 				}
 				if (!bFound)
+				{
+					QueueRecordBlockingSync(psQueue, psSyncData, ui32WriteOpsComplete, ui32ReadOpsComplete);
 					return PVRSRV_ERROR_FAILED_DEPENDENCIES;
+				}
 			}
 		}
 		psWalkerObj++;
@@ -1088,6 +1187,7 @@ PVRSRV_ERROR PVRSRVProcessCommand(SYS_DATA			*psSysData,
 	{
 		/* Increment the CCB offset */
 		psDeviceCommandData[psCommand->CommandType].ui32CCBOffset = (ui32CCBOffset + 1) % DC_NUM_COMMANDS_PER_TYPE;
+		gui32QueueDispatchCount++;
 	}
 
 	return eError;
@@ -1110,6 +1210,11 @@ static IMG_VOID PVRSRVProcessQueues_ForEachCb(PVRSRV_DEVICE_NODE *psDeviceNode)
 
  @Description	Tries to process a command from each Q
 
+				If another caller is already processing the queues, a
+				non-flushing call does not wait for it: it marks the queues
+				as needing another pass and returns, and the caller holding
+				the lock makes that pass before it lets go.
+
  @input ui32CallerID - used to distinguish between async ISR/DPC type calls
  						the synchronous services driver
  @input	bFlush - flush commands with stale dependencies (only used for HW recovery)
@@ -1131,16 +1236,29 @@ PVRSRV_ERROR PVRSRVProcessQueues(IMG_BOOL	bFlush)
 	/* Ensure we don't corrupt queue list, by blocking access. This is required for OSs where
 	    multiple ISR threads may exist simultaneously (eg WinXP DPC routines)
 	*/
-	while (OSLockResource(&psSysData->sQProcessResource, ISR_ID) != PVRSRV_OK)
+Retry:
+	if (OSLockResource(&psSysData->sQProcessResource, ISR_ID) != PVRSRV_OK)
 	{
-		OSWaitus(1);
-	};
-	
-	psQueue = psSysData->psQueueList;
-
-	if(!psQueue)
-	{
-		PVR_DPF((PVR_DBG_MESSAGE,"No Queues installed - cannot process commands"));
+		if (bFlush)
+		{
+			/* The flush has to happen in this pass, so wait our turn */
+			while (OSLockResource(&psSysData->sQProcessResource, ISR_ID) != PVRSRV_OK)
+			{
+				OSWaitus(1);
+			}
+		}
+		else
+		{
+			/*
+				Hand the pass to the holder. Try once more after setting the
+				flag, in case the holder checked it and let go in between.
+			*/
+			psSysData->bQProcessPending = IMG_TRUE;
+			if (OSLockResource(&psSysData->sQProcessResource, ISR_ID) != PVRSRV_OK)
+			{
+				return PVRSRV_OK;
+			}
+		}
 	}
 
 	if (bFlush)
@@ -1148,23 +1266,42 @@ PVRSRV_ERROR PVRSRVProcessQueues(IMG_BOOL	bFlush)
 		PVRSRVSetDCState(DC_STATE_FLUSH_COMMANDS);
 	}
 
-	while (psQueue)
+	do
 	{
-		while (psQueue->ui32ReadOffset != psQueue->ui32WriteOffset)
+		psSysData->bQProcessPending = IMG_FALSE;
+
+		psQueue = psSysData->psQueueList;
+
+		if(!psQueue)
 		{
-			psCommand = (PVRSRV_COMMAND*)((IMG_UINTPTR_T)psQueue->pvLinQueueKM + psQueue->ui32ReadOffset);
+			PVR_DPF((PVR_DBG_MESSAGE,"No Queues installed - cannot process commands"));
+		}
 
-			if (PVRSRVProcessCommand(psSysData, psCommand, bFlush) == PVRSRV_OK)
+		while (psQueue)
+		{
+			while (psQueue->ui32ReadOffset != psQueue->ui32WriteOffset)
 			{
-				/* processed cmd so update queue */
-				UPDATE_QUEUE_ROFF(psQueue, psCommand->uCmdSize)
-				continue;
-			}
+				/* Don't re-walk the syncs of a command nothing has happened to */
+				if (!bFlush && QueueStillBlocked(psQueue))
+				{
+					break;
+				}
 
-			break;
+				psCommand = (PVRSRV_COMMAND*)((IMG_UINTPTR_T)psQueue->pvLinQueueKM + psQueue->ui32ReadOffset);
+
+				psQueue->psBlockedSyncData = IMG_NULL;
+				if (PVRSRVProcessCommand(psSysData, psCommand, bFlush, psQueue) == PVRSRV_OK)
+				{
+					/* processed cmd so update queue */
+					UPDATE_QUEUE_ROFF(psQueue, psCommand->uCmdSize)
+					continue;
+				}
+
+				break;
+			}
+			psQueue = psQueue->psNextKM;
 		}
-		psQueue = psQueue->psNextKM;
-	}
+	} while (psSysData->bQProcessPending);
 
 	if (bFlush)
 	{
@@ -1177,6 +1314,18 @@ PVRSRV_ERROR PVRSRVProcessQueues(IMG_BOOL	bFlush)
 
 	OSUnlockResource(&psSysData->sQProcessResource, ISR_ID);
 
+	/*
+		Someone handed us a pass after the last check. The barrier keeps
+		the flag read behind the unlock store, else their retry can fail
+		against our lock while we still read the flag as clear.
+	*/
+	OSMemoryBarrier();
+	if (psSysData->bQProcessPending)
+	{
+		bFlush = IMG_FALSE;
+		goto Retry;
+	}
+
 	return PVRSRV_OK;
 }
 
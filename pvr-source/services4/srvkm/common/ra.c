@@ -19,13 +19,16 @@
   coallesced to avoid fragmentation.
  
   For allocation, all 'free' segments are kept on lists of 'free'
-  segments in a table index by pvr_log2(segment size). ie Each table index
-  n holds 'free' segments in the size range 2**(n-1) -> 2**n.
+  segments in a two level segregated fit table. The first level is
+  indexed by pvr_log2(segment size), the second splits each power of 2
+  range into RA_SL_COUNT equal parts. Bitmaps of the non-empty lists
+  give the first list able to satisfy a request in constant time.
  
-  Allocation policy is based on an *almost* best fit
-  stratedy. Choosing any segment from the appropriate table entry
-  guarantees that we choose a segment which is with a power of 2 of
-  the size we are allocating.
+  Allocation policy is a good fit strategy. The search starts at the
+  list after the one holding the requested size, where every segment
+  is big enough, so the first segment taken fits unless alignment or
+  import flags rule it out. The requested size's own list is searched
+  last.
  
   Allocated segments are inserted into a self scaling hash table which
   maps the base resource of the span to the relevant boundary
@@ -202,12 +205,20 @@ struct _RA_ARENA_
 	 * import alloc and free hooks */
 	IMG_VOID *pImportHandle;
 
-	/* head of list of free boundary tags for indexed by pvr_log2 of the
-	   boundary tag size */
+	/* head of list of free boundary tags, indexed by pvr_log2 of the
+	   boundary tag size and by the RA_SL_LOG2 bits below the top one */
 #define FREE_TABLE_LIMIT 32
+#define RA_SL_LOG2 3
+#define RA_SL_COUNT (1U << RA_SL_LOG2)
 
-	/* power-of-two table of free lists */
-	BT *aHeadFree [FREE_TABLE_LIMIT];
+	/* two level table of free lists */
+	BT *aHeadFree [FREE_TABLE_LIMIT][RA_SL_COUNT];
+
+	/* bit n set if aHeadFree[n] has a non-empty list */
+	IMG_UINT32 uFreeFLBitmap;
+
+	/* bit n of entry m set if aHeadFree[m][n] is non-empty */
+	IMG_UINT32 auFreeSLBitmap [FREE_TABLE_LIMIT];
 
 	/* resource ordered segment list */
 	BT *pHeadSegment;
@@ -225,6 +236,9 @@ struct _RA_ARENA_
 
 	struct proc_dir_entry* pProcInfo;
 	struct proc_dir_entry* pProcSegs;
+#ifdef RA_STATS
+	struct proc_dir_entry* pProcStats;
+#endif
 
 	IMG_BOOL bInitProcEntry;
 
@@ -268,6 +282,11 @@ static void* RA_ProcSeqOff2ElementInfo(struct seq_file * sfile, loff_t off);
 static void RA_ProcSeqShowRegs(struct seq_file *sfile, void* el);
 static void* RA_ProcSeqOff2ElementRegs(struct seq_file * sfile, loff_t off);
 
+#ifdef RA_STATS
+static void RA_ProcSeqShowStats(struct seq_file *sfile, void* el);
+static void* RA_ProcSeqOff2ElementStats(struct seq_file * sfile, loff_t off);
+#endif
+
 #if defined(CONFIG_PVR_PROC_FS_HEAP_ALLOC_DEBUG)
 static int RA_ProcSetAllocFailThreshold(struct file *file, const char __user *buffer, unsigned long count, void *data);
 static void*   RA_ProcSeqOff2AllocFailThreshold(struct seq_file * sfile, loff_t off);
@@ -363,6 +382,293 @@ pvr_log2 (IMG_SIZE_T n)
 	return l;
 }
 
+/*!
+******************************************************************************
+	@Function       _FindFirstSet
+
+	@Description    Index of the least significant set bit
+
+	@Input          ui32Bits - non-zero bitmap
+
+	@Return         bit index
+******************************************************************************/
+static INLINE IMG_UINT32
+_FindFirstSet (IMG_UINT32 ui32Bits)
+{
+#if defined(__GNUC__)
+	return (IMG_UINT32)__builtin_ctz(ui32Bits);
+#else
+	IMG_UINT32 l = 0;
+	while ((ui32Bits & 1) == 0)
+	{
+		ui32Bits >>= 1;
+		l++;
+	}
+	return l;
+#endif
+}
+
+/*!
+******************************************************************************
+	@Function       _FreeListIndex
+
+	@Description    Computes the free table list holding segments of a size
+
+	@Input          uSize - segment size, non-zero
+	@Output         puFL - first level index
+	@Output         puSL - second level index
+
+	@Return         None
+******************************************************************************/
+static IMG_VOID
+_FreeListIndex (IMG_SIZE_T uSize, IMG_UINT32 *puFL, IMG_UINT32 *puSL)
+{
+	IMG_UINT32 uFL = pvr_log2 (uSize);
+
+	if (uFL >= FREE_TABLE_LIMIT)
+	{
+		/* everything from 2**FREE_TABLE_LIMIT up shares the last list */
+		*puFL = FREE_TABLE_LIMIT - 1;
+		*puSL = RA_SL_COUNT - 1;
+		return;
+	}
+
+	*puFL = uFL;
+	if (uFL >= RA_SL_LOG2)
+		*puSL = (IMG_UINT32)(uSize >> (uFL - RA_SL_LOG2)) & (RA_SL_COUNT - 1);
+	else
+		*puSL = (IMG_UINT32)(uSize << (RA_SL_LOG2 - uFL)) & (RA_SL_COUNT - 1);
+}
+
+/*!
+******************************************************************************
+	@Function       _FreeListFirst
+
+	@Description    Find the first non-empty free list at or after a
+                    position in the free table
+
+	@Input          pArena - the arena.
+	@Modified       puFL - first level index
+	@Modified       puSL - second level index
+
+	@Return         IMG_TRUE if a list was found
+******************************************************************************/
+static IMG_BOOL
+_FreeListFirst (RA_ARENA *pArena, IMG_UINT32 *puFL, IMG_UINT32 *puSL)
+{
+	IMG_UINT32 uFL = *puFL;
+	IMG_UINT32 uBits = 0;
+
+	if (*puSL < RA_SL_COUNT)
+		uBits = pArena->auFreeSLBitmap[uFL] & (~0U << *puSL);
+
+	if (uBits == 0)
+	{
+		if (uFL + 1 >= FREE_TABLE_LIMIT)
+			return IMG_FALSE;
+
+		uBits = pArena->uFreeFLBitmap & (~0U << (uFL + 1));
+		if (uBits == 0)
+			return IMG_FALSE;
+
+		uFL = _FindFirstSet (uBits);
+		uBits = pArena->auFreeSLBitmap[uFL];
+	}
+
+	*puFL = uFL;
+	*puSL = _FindFirstSet (uBits);
+	return IMG_TRUE;
+}
+
+#ifdef RA_STATS
+/*!
+******************************************************************************
+	@Function       _LargestFreeSegment
+
+	@Description    Size of the largest free segment. Only the highest
+                    non-empty free list is walked.
+
+	@Input          pArena - the arena.
+
+	@Return         segment size, 0 when nothing is free
+******************************************************************************/
+static IMG_SIZE_T
+_LargestFreeSegment (RA_ARENA *pArena)
+{
+	IMG_UINT32 uFL, uSL;
+	IMG_SIZE_T uLargest = 0;
+	BT *pBT;
+
+	if (pArena->uFreeFLBitmap == 0)
+		return 0;
+
+	uFL = pvr_log2 (pArena->uFreeFLBitmap);
+	uSL = pvr_log2 (pArena->auFreeSLBitmap[uFL]);
+	for (pBT=pArena->aHeadFree[uFL][uSL]; pBT!=IMG_NULL; pBT=pBT->pNextFree)
+	{
+		if (pBT->uSize > uLargest)
+			uLargest = pBT->uSize;
+	}
+	return uLargest;
+}
+
+/*!
+******************************************************************************
+	@Function       _FreeSegmentStats
+
+	@Description    Walk the free lists for the free segment distribution
+
+	@Input          pArena - the arena.
+	@Output         auHist - free segments by pvr_log2 of their size
+	@Output         puCount - number of free segments
+	@Output         puTotal - total free resource
+	@Output         puLargest - largest free segment
+
+	@Return         None
+******************************************************************************/
+static IMG_VOID
+_FreeSegmentStats (RA_ARENA *pArena,
+				   IMG_UINT32 auHist[FREE_TABLE_LIMIT],
+				   IMG_UINT32 *puCount,
+				   IMG_SIZE_T *puTotal,
+				   IMG_SIZE_T *puLargest)
+{
+	IMG_UINT32 uFL, uSL;
+	BT *pBT;
+
+	OSMemSet (auHist, 0, FREE_TABLE_LIMIT * sizeof(auHist[0]));
+	*puCount = 0;
+	*puTotal = 0;
+	*puLargest = 0;
+
+	for (uFL=0; uFL<FREE_TABLE_LIMIT; uFL++)
+	{
+		for (uSL=0; uSL<RA_SL_COUNT; uSL++)
+		{
+			for (pBT=pArena->aHeadFree[uFL][uSL]; pBT!=IMG_NULL; pBT=pBT->pNextFree)
+			{
+				(*puCount)++;
+				*puTotal += pBT->uSize;
+				if (pBT->uSize > *puLargest)
+					*puLargest = pBT->uSize;
+				auHist[uFL]++;
+			}
+		}
+	}
+}
+
+/*!
+******************************************************************************
+	@Function       _FragmentationPercent
+
+	@Description    Share of the free resource outside the largest free
+                    segment, i.e. unusable by one allocation of everything
+                    that is free
+
+	@Input          uTotal - total free resource
+	@Input          uLargest - largest free segment
+
+	@Return         percentage
+******************************************************************************/
+static IMG_UINT32
+_FragmentationPercent (IMG_SIZE_T uTotal, IMG_SIZE_T uLargest)
+{
+	/* scale down to keep the product in 32 bits, avoiding a 64 bit
+	   divide */
+	while (uTotal >= (1U << 24))
+	{
+		uTotal >>= 1;
+		uLargest >>= 1;
+	}
+	if (uTotal == 0)
+		return 0;
+
+	return 100 - (IMG_UINT32)(uLargest * 100 / uTotal);
+}
+
+/*!
+******************************************************************************
+	@Function       _AllocTimePercentile
+
+	@Description    Upper bound of the RA_Alloc time histogram bucket
+                    holding a percentile
+
+	@Input          pStats - arena statistics
+	@Input          uPercent - percentile
+
+	@Return         time in us, 0 with no samples
+******************************************************************************/
+static IMG_UINT32
+_AllocTimePercentile (RA_STATISTICS *pStats, IMG_UINT32 uPercent)
+{
+	IMG_UINT32 uTotal = 0, uSeen = 0, uTarget, i;
+
+	for (i=0; i<RA_STATS_TIME_BUCKETS; i++)
+		uTotal += pStats->auAllocTimeHist[i];
+	if (uTotal == 0)
+		return 0;
+
+	/* rank of the sample, rounded up, without overflowing uTotal * 100 */
+	uTarget = (uTotal / 100) * uPercent + ((uTotal % 100) * uPercent + 99) / 100;
+
+	for (i=0; i<RA_STATS_TIME_BUCKETS - 1; i++)
+	{
+		uSeen += pStats->auAllocTimeHist[i];
+		if (uSeen >= uTarget)
+			return 1U << i;
+	}
+	return pStats->uAllocTimeMax;
+}
+
+/*!
+******************************************************************************
+	@Function       _AllocStatsUpdate
+
+	@Description    Record one RA_Alloc call in the arena statistics
+
+	@Input          pArena - the arena.
+	@Input          uSize - the allocation size.
+	@Input          bResult - whether the allocation succeeded
+	@Input          ui32StartUs - OSClockus() when the call started
+
+	@Return         None
+******************************************************************************/
+static IMG_VOID
+_AllocStatsUpdate (RA_ARENA *pArena, IMG_SIZE_T uSize, IMG_BOOL bResult,
+				   IMG_UINT32 ui32StartUs)
+{
+	RA_STATISTICS *pStats = &pArena->sStatistics;
+	IMG_UINT32 ui32Us = OSClockus() - ui32StartUs;
+	IMG_UINT32 uBucket;
+
+	uBucket = (ui32Us == 0) ? 0 : pvr_log2 (ui32Us) + 1;
+	if (uBucket >= RA_STATS_TIME_BUCKETS)
+		uBucket = RA_STATS_TIME_BUCKETS - 1;
+	pStats->auAllocTimeHist[uBucket]++;
+	if (ui32Us > pStats->uAllocTimeMax)
+		pStats->uAllocTimeMax = ui32Us;
+
+	if (bResult)
+	{
+		IMG_SIZE_T uLargest = _LargestFreeSegment (pArena);
+
+		uBucket = pvr_log2 (uSize);
+		if (uBucket >= RA_STATS_SIZE_BUCKETS)
+			uBucket = RA_STATS_SIZE_BUCKETS - 1;
+		pStats->auAllocSizeHist[uBucket]++;
+		if (uLargest < pStats->uLargestFreeLow)
+		{
+			pStats->uLargestFreeLow = uLargest;
+			pStats->uLargestFreeLowAlloc = pStats->uCumulativeAllocs;
+		}
+	}
+	else
+	{
+		pStats->uFailedAllocCount++;
+	}
+}
+#endif
+
 /*!
 ******************************************************************************
 	@Function       _SegmentListInsertAfter
@@ -580,14 +886,16 @@ _SegmentSplit (RA_ARENA *pArena, BT *pBT, IMG_SIZE_T uSize)
 static IMG_VOID
 _FreeListInsert (RA_ARENA *pArena, BT *pBT)
 {
-	IMG_UINT32 uIndex;
-	uIndex = pvr_log2 (pBT->uSize);
+	IMG_UINT32 uFL, uSL;
+	_FreeListIndex (pBT->uSize, &uFL, &uSL);
 	pBT->type = btt_free;
-	pBT->pNextFree = pArena->aHeadFree [uIndex];
+	pBT->pNextFree = pArena->aHeadFree [uFL][uSL];
 	pBT->pPrevFree = IMG_NULL;
-	if (pArena->aHeadFree[uIndex] != IMG_NULL)
-		pArena->aHeadFree[uIndex]->pPrevFree = pBT;
-	pArena->aHeadFree [uIndex] = pBT;
+	if (pArena->aHeadFree[uFL][uSL] != IMG_NULL)
+		pArena->aHeadFree[uFL][uSL]->pPrevFree = pBT;
+	pArena->aHeadFree [uFL][uSL] = pBT;
+	pArena->auFreeSLBitmap[uFL] |= 1U << uSL;
+	pArena->uFreeFLBitmap |= 1U << uFL;
 }
 
 /*!
@@ -605,14 +913,21 @@ _FreeListInsert (RA_ARENA *pArena, BT *pBT)
 static IMG_VOID
 _FreeListRemove (RA_ARENA *pArena, BT *pBT)
 {
-	IMG_UINT32 uIndex;
-	uIndex = pvr_log2 (pBT->uSize);
+	IMG_UINT32 uFL, uSL;
+	_FreeListIndex (pBT->uSize, &uFL, &uSL);
 	if (pBT->pNextFree != IMG_NULL)
 		pBT->pNextFree->pPrevFree = pBT->pPrevFree;
 	if (pBT->pPrevFree == IMG_NULL)
-		pArena->aHeadFree[uIndex] = pBT->pNextFree;
+		pArena->aHeadFree[uFL][uSL] = pBT->pNextFree;
 	else
 		pBT->pPrevFree->pNextFree = pBT->pNextFree;
+
+	if (pArena->aHeadFree[uFL][uSL] == IMG_NULL)
+	{
+		pArena->auFreeSLBitmap[uFL] &= ~(1U << uSL);
+		if (pArena->auFreeSLBitmap[uFL] == 0)
+			pArena->uFreeFLBitmap &= ~(1U << uFL);
+	}
 }
 
 /*!
@@ -975,6 +1290,62 @@ _FreeBT (RA_ARENA *pArena, BT *pBT, IMG_BOOL bFreeBackingStore)
 }
 
 
+/*!
+******************************************************************************
+	@Function       _FreeListFit
+
+	@Description    Find the first segment on a free list able to hold an
+                    allocation.
+
+	@Input          pBT - head of the free list.
+	@Input          uSize - the requested allocation size.
+	@Input          uFlags - allocation flags
+	@Input          uAlignment - required uAlignment, or 0
+	@Input          uAlignmentOffset - already reduced modulo uAlignment
+	@Output         pAlignedBase - aligned base within the segment found
+
+	@Return         segment found or IMG_NULL
+******************************************************************************/
+static BT *
+_FreeListFit (BT *pBT,
+			  IMG_SIZE_T uSize,
+			  IMG_UINT32 uFlags,
+			  IMG_UINT32 uAlignment,
+			  IMG_UINT32 uAlignmentOffset,
+			  IMG_UINTPTR_T *pAlignedBase)
+{
+	while (pBT!=IMG_NULL)
+	{
+		IMG_UINTPTR_T aligned_base;
+
+		if (uAlignment>1)
+			aligned_base = (pBT->base + uAlignmentOffset + uAlignment - 1) / uAlignment * uAlignment - uAlignmentOffset;
+		else
+			aligned_base = pBT->base;
+		PVR_DPF ((PVR_DBG_MESSAGE,
+				  "RA_AttemptAllocAligned: pBT-base=0x%x "
+				  "pBT-size=0x%x alignedbase=0x%x size=0x%x",
+				pBT->base, pBT->uSize, aligned_base, uSize));
+
+		if (pBT->base + pBT->uSize >= aligned_base + uSize)
+		{
+			if(!pBT->psMapping || pBT->psMapping->ui32Flags == uFlags)
+			{
+				*pAlignedBase = aligned_base;
+				return pBT;
+			}
+			else
+			{
+				PVR_DPF ((PVR_DBG_MESSAGE,
+						"AttemptAllocAligned: mismatch in flags. Import has %x, request was %x", pBT->psMapping->ui32Flags, uFlags));
+			}
+		}
+		pBT = pBT->pNextFree;
+	}
+
+	return IMG_NULL;
+}
+
 /*!
 ******************************************************************************
 	@Function       _AttemptAllocAligned
@@ -1002,7 +1373,12 @@ _AttemptAllocAligned (RA_ARENA *pArena,
 					  IMG_UINT32 uAlignmentOffset,
 					  IMG_UINTPTR_T *base)
 {
-	IMG_UINT32 uIndex;
+	IMG_UINT32 uFL, uSL;
+	IMG_UINT32 uOwnFL, uOwnSL;
+	IMG_UINTPTR_T aligned_base = 0;
+	IMG_BOOL bOwnListSearched;
+	BT *pBT;
+
 	PVR_ASSERT (pArena!=IMG_NULL);
 	if (pArena == IMG_NULL)
 	{
@@ -1013,137 +1389,122 @@ _AttemptAllocAligned (RA_ARENA *pArena,
 	if (uAlignment>1)
 		uAlignmentOffset %= uAlignment;
 
-	/* search for a near fit free boundary tag, start looking at the
-	   pvr_log2 free table for our required size and work on up the
-	   table. */
-	uIndex = pvr_log2 (uSize);
-
-	while (uIndex < FREE_TABLE_LIMIT && pArena->aHeadFree[uIndex]==IMG_NULL)
-		uIndex++;
+	/* every segment on the lists after the one holding uSize is big
+	   enough, so start there and only fall back to uSize's own list,
+	   whose segments may be smaller than the request, at the end. A
+	   list starting exactly at uSize can be taken as is. */
+	_FreeListIndex (uSize, &uOwnFL, &uOwnSL);
+	uFL = uOwnFL;
+	uSL = uOwnSL;
+	bOwnListSearched = IMG_TRUE;
+	if (pvr_log2 (uSize) >= FREE_TABLE_LIMIT ||
+		(uFL >= RA_SL_LOG2 && (uSize & ((1U << (uFL - RA_SL_LOG2)) - 1)) != 0))
+	{
+		uSL++;
+		bOwnListSearched = IMG_FALSE;
+	}
 
-	while (uIndex < FREE_TABLE_LIMIT)
+	pBT = IMG_NULL;
+	while (_FreeListFirst (pArena, &uFL, &uSL))
 	{
-		if (pArena->aHeadFree[uIndex]!=IMG_NULL)
-		{
-			/* we have a cached free boundary tag */
-			BT *pBT;
+		pBT = _FreeListFit (pArena->aHeadFree[uFL][uSL], uSize, uFlags,
+							uAlignment, uAlignmentOffset, &aligned_base);
+		if (pBT != IMG_NULL)
+			break;
+		uSL++;
+	}
 
-			pBT = pArena->aHeadFree [uIndex];
-			while (pBT!=IMG_NULL)
-			{
-				IMG_UINTPTR_T aligned_base;
+	if (pBT == IMG_NULL && !bOwnListSearched)
+	{
+		pBT = _FreeListFit (pArena->aHeadFree[uOwnFL][uOwnSL], uSize, uFlags,
+							uAlignment, uAlignmentOffset, &aligned_base);
+	}
 
-				if (uAlignment>1)
-					aligned_base = (pBT->base + uAlignmentOffset + uAlignment - 1) / uAlignment * uAlignment - uAlignmentOffset;
-				else
-					aligned_base = pBT->base;
-				PVR_DPF ((PVR_DBG_MESSAGE,
-						  "RA_AttemptAllocAligned: pBT-base=0x%x "
-						  "pBT-size=0x%x alignedbase=0x%x size=0x%x",
-						pBT->base, pBT->uSize, aligned_base, uSize));
+	if (pBT == IMG_NULL)
+	return IMG_FALSE;
 
-				if (pBT->base + pBT->uSize >= aligned_base + uSize)
-				{
-					if(!pBT->psMapping || pBT->psMapping->ui32Flags == uFlags)
-					{
-						_FreeListRemove (pArena, pBT);
+	_FreeListRemove (pArena, pBT);
 
-						PVR_ASSERT (pBT->type == btt_free);
+	PVR_ASSERT (pBT->type == btt_free);
 
 #ifdef RA_STATS
-						pArena->sStatistics.uLiveSegmentCount++;
-						pArena->sStatistics.uFreeSegmentCount--;
-						pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
+	pArena->sStatistics.uLiveSegmentCount++;
+	pArena->sStatistics.uFreeSegmentCount--;
+	pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
 #endif
 
-						/* with uAlignment we might need to discard the front of this segment */
-						if (aligned_base > pBT->base)
-						{
-							BT *pNeighbour;
-							pNeighbour = _SegmentSplit (pArena, pBT, (IMG_SIZE_T)(aligned_base - pBT->base));
-							/* partition the buffer, create a new boundary tag */
-							if (pNeighbour==IMG_NULL)
-							{
-								PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Front split failed"));
-								/* Put pBT back in the list */
-								_FreeListInsert (pArena, pBT);
-								return IMG_FALSE;
-							}
-
-							_FreeListInsert (pArena, pBT);
+	/* with uAlignment we might need to discard the front of this segment */
+	if (aligned_base > pBT->base)
+	{
+		BT *pNeighbour;
+		pNeighbour = _SegmentSplit (pArena, pBT, (IMG_SIZE_T)(aligned_base - pBT->base));
+		/* partition the buffer, create a new boundary tag */
+		if (pNeighbour==IMG_NULL)
+		{
+			PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Front split failed"));
+			/* Put pBT back in the list */
+			_FreeListInsert (pArena, pBT);
+			return IMG_FALSE;
+		}
+
+		_FreeListInsert (pArena, pBT);
 	#ifdef RA_STATS
-							pArena->sStatistics.uFreeSegmentCount++;
-							pArena->sStatistics.uFreeResourceCount+=pBT->uSize;
+		pArena->sStatistics.uFreeSegmentCount++;
+		pArena->sStatistics.uFreeResourceCount+=pBT->uSize;
 	#endif
-							pBT = pNeighbour;
-						}
-
-						/* the segment might be too big, if so, discard the back of the segment */
-						if (pBT->uSize > uSize)
-						{
-							BT *pNeighbour;
-							pNeighbour = _SegmentSplit (pArena, pBT, uSize);
-							/* partition the buffer, create a new boundary tag */
-							if (pNeighbour==IMG_NULL)
-							{
-								PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Back split failed"));
-								/* Put pBT back in the list */
-								_FreeListInsert (pArena, pBT);
-								return IMG_FALSE;
-							}
-
-							_FreeListInsert (pArena, pNeighbour);
+		pBT = pNeighbour;
+	}
+
+	/* the segment might be too big, if so, discard the back of the segment */
+	if (pBT->uSize > uSize)
+	{
+		BT *pNeighbour;
+		pNeighbour = _SegmentSplit (pArena, pBT, uSize);
+		/* partition the buffer, create a new boundary tag */
+		if (pNeighbour==IMG_NULL)
+		{
+			PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Back split failed"));
+			/* Put pBT back in the list */
+			_FreeListInsert (pArena, pBT);
+			return IMG_FALSE;
+		}
+
+		_FreeListInsert (pArena, pNeighbour);
 	#ifdef RA_STATS
-							pArena->sStatistics.uFreeSegmentCount++;
-							pArena->sStatistics.uFreeResourceCount+=pNeighbour->uSize;
+		pArena->sStatistics.uFreeSegmentCount++;
+		pArena->sStatistics.uFreeResourceCount+=pNeighbour->uSize;
 	#endif
-						}
+	}
 
-						pBT->type = btt_live;
+	pBT->type = btt_live;
 
 #if defined(VALIDATE_ARENA_TEST)
-						if (pBT->eResourceType == IMPORTED_RESOURCE_TYPE)
-						{
-							pBT->eResourceSpan = IMPORTED_RESOURCE_SPAN_LIVE;
-						}
-						else if (pBT->eResourceType == NON_IMPORTED_RESOURCE_TYPE)
-						{
-							pBT->eResourceSpan = RESOURCE_SPAN_LIVE;
-						}
-						else
-						{
-							PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned ERROR: pBT->eResourceType unrecognized"));
-							PVR_DBG_BREAK;
-						}
+	if (pBT->eResourceType == IMPORTED_RESOURCE_TYPE)
+	{
+		pBT->eResourceSpan = IMPORTED_RESOURCE_SPAN_LIVE;
+	}
+	else if (pBT->eResourceType == NON_IMPORTED_RESOURCE_TYPE)
+	{
+		pBT->eResourceSpan = RESOURCE_SPAN_LIVE;
+	}
+	else
+	{
+		PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned ERROR: pBT->eResourceType unrecognized"));
+		PVR_DBG_BREAK;
+	}
 #endif
-						if (!HASH_Insert (pArena->pSegmentHash, pBT->base, (IMG_UINTPTR_T) pBT))
-						{
-							_FreeBT (pArena, pBT, IMG_FALSE);
-							return IMG_FALSE;
-						}
-
-						if (ppsMapping!=IMG_NULL)
-							*ppsMapping = pBT->psMapping;
-
-						*base = pBT->base;
-
-						return IMG_TRUE;
-					}
-					else
-					{
-						PVR_DPF ((PVR_DBG_MESSAGE,
-								"AttemptAllocAligned: mismatch in flags. Import has %x, request was %x", pBT->psMapping->ui32Flags, uFlags));
+	if (!HASH_Insert (pArena->pSegmentHash, pBT->base, (IMG_UINTPTR_T) pBT))
+	{
+		_FreeBT (pArena, pBT, IMG_FALSE);
+		return IMG_FALSE;
+	}
 
-					}
-				}
-				pBT = pBT->pNextFree;
-			}
+	if (ppsMapping!=IMG_NULL)
+		*ppsMapping = pBT->psMapping;
 
-		}
-		uIndex++;
-	}
+	*base = pBT->base;
 
-	return IMG_FALSE;
+	return IMG_TRUE;
 }
 
 
@@ -1181,7 +1542,6 @@ RA_Create (IMG_CHAR *name,
 {
 	RA_ARENA *pArena;
 	BT *pBT;
-	IMG_INT i;
 
 	PVR_DPF ((PVR_DBG_MESSAGE,
 			  "RA_Create: name='%s', base=0x%x, uSize=0x%x, alloc=0x%x, free=0x%x",
@@ -1201,14 +1561,16 @@ RA_Create (IMG_CHAR *name,
 	pArena->pImportFree = imp_free;
 	pArena->pBackingStoreFree = backingstore_free;
 	pArena->pImportHandle = pImportHandle;
-	for (i=0; i<FREE_TABLE_LIMIT; i++)
-		pArena->aHeadFree[i] = IMG_NULL;
+	OSMemSet (pArena->aHeadFree, 0, sizeof(pArena->aHeadFree));
+	OSMemSet (pArena->auFreeSLBitmap, 0, sizeof(pArena->auFreeSLBitmap));
+	pArena->uFreeFLBitmap = 0;
 	pArena->pHeadSegment = IMG_NULL;
 	pArena->pTailSegment = IMG_NULL;
 	pArena->uQuantum = uQuantum;
 
 #ifdef RA_STATS
 	OSMemSet(&pArena->sStatistics, 0x00, sizeof(pArena->sStatistics));
+	pArena->sStatistics.uLargestFreeLow = ~(IMG_SIZE_T)0;
 #endif
 
 #if defined(CONFIG_PROC_FS) && defined(CONFIG_PVR_PROC_FS)
@@ -1254,6 +1616,20 @@ RA_Create (IMG_CHAR *name,
 			PVR_DPF((PVR_DBG_ERROR, "RA_Create: couldn't create ra_segs proc entry for arena %s", pArena->name));
 		}
 
+#ifdef RA_STATS
+		ret = snprintf(szProcSegsName, sizeof(szProcSegsName), "ra_stats_%s", pArena->name);
+		if (ret > 0 && ret < sizeof(szProcSegsName))
+		{
+			pArena->pProcStats = pfnCreateProcEntrySeq(ReplaceSpaces(szProcSegsName), pArena, NULL,
+											 RA_ProcSeqShowStats, RA_ProcSeqOff2ElementStats, NULL, NULL);
+		}
+		else
+		{
+			pArena->pProcStats = 0;
+			PVR_DPF((PVR_DBG_ERROR, "RA_Create: couldn't create ra_stats proc entry for arena %s", pArena->name));
+		}
+#endif
+
 #if defined(CONFIG_PVR_PROC_FS_HEAP_ALLOC_DEBUG)
 		pArena->uAllocFailThreshold = ~0;
 		pArena->uAllocFailMask = ~0;
@@ -1316,8 +1692,6 @@ arena_fail:
 IMG_VOID
 RA_Delete (RA_ARENA *pArena)
 {
-	IMG_UINT32 uIndex;
-
 	PVR_ASSERT(pArena != IMG_NULL);
 
 	if (pArena == IMG_NULL)
@@ -1329,8 +1703,9 @@ RA_Delete (RA_ARENA *pArena)
 	PVR_DPF ((PVR_DBG_MESSAGE,
 			  "RA_Delete: name='%s'", pArena->name));
 
-	for (uIndex=0; uIndex<FREE_TABLE_LIMIT; uIndex++)
-		pArena->aHeadFree[uIndex] = IMG_NULL;
+	OSMemSet (pArena->aHeadFree, 0, sizeof(pArena->aHeadFree));
+	OSMemSet (pArena->auFreeSLBitmap, 0, sizeof(pArena->auFreeSLBitmap));
+	pArena->uFreeFLBitmap = 0;
 
 	while (pArena->pHeadSegment != IMG_NULL)
 	{
@@ -1366,6 +1741,13 @@ RA_Delete (RA_ARENA *pArena)
 			pfnRemoveProcEntrySeq( pArena->pProcSegs );
 		}
 
+#ifdef RA_STATS
+		if (pArena->pProcStats != 0)
+		{
+			pfnRemoveProcEntrySeq( pArena->pProcStats );
+		}
+#endif
+
 #if defined(CONFIG_PVR_PROC_FS_HEAP_ALLOC_DEBUG)
 		if(pArena->pProcAllocFailThreshold != 0)
 		{
@@ -1482,6 +1864,9 @@ RA_Alloc (RA_ARENA *pArena,
 	IMG_BOOL bResult = IMG_FALSE;
 	IMG_BOOL bTestAllocFail = IMG_FALSE;
 	IMG_SIZE_T uSize = uRequestSize;
+#ifdef RA_STATS
+	IMG_UINT32 ui32StartUs = OSClockus();
+#endif
 
 	PVR_ASSERT (pArena!=IMG_NULL);
 
@@ -1580,6 +1965,10 @@ RA_Alloc (RA_ARENA *pArena,
 		#endif
 	}
 
+#ifdef RA_STATS
+	_AllocStatsUpdate (pArena, uSize, bResult, ui32StartUs);
+#endif
+
 	PVR_DPF((PVR_DBG_MESSAGE,
 		"RA_Alloc: arena=%s, size=0x%x(0x%x), alignment=0x%x, "\
 			"offset=0x%x, result=%d",
@@ -2035,6 +2424,35 @@ static PVRSRV_ERROR RA_DumpHeapInfo(RA_ARENA *pArena, IMG_UINT32 ui32DebugLevel)
 
 	PVR_LOG(( "export count\t\t%u", pArena->sStatistics.uExportCount));
 
+	{
+		IMG_UINT32 auFreeHist[FREE_TABLE_LIMIT];
+		IMG_UINT32 uFreeCount;
+		IMG_SIZE_T uFreeTotal;
+		IMG_SIZE_T uFreeLargest;
+		IMG_UINT32 uFL;
+
+		_FreeSegmentStats (pArena, auFreeHist, &uFreeCount, &uFreeTotal, &uFreeLargest);
+
+		PVR_LOG(( "largest free segment\t%u (0x%x)",
+								(IMG_UINT)uFreeLargest, (IMG_UINT)uFreeLargest));
+		PVR_LOG(( "fragmentation\t\t%u%% over %u free segments",
+								_FragmentationPercent (uFreeTotal, uFreeLargest), uFreeCount));
+
+		for (uFL=0; uFL<FREE_TABLE_LIMIT; uFL++)
+		{
+			if (auFreeHist[uFL] != 0)
+			{
+				PVR_LOG(( "\tfree segments >= 0x%08x: %u",
+								1U << uFL, auFreeHist[uFL]));
+			}
+		}
+
+		PVR_LOG(( "alloc time p50/p99/max\t%u/%u/%u us",
+								_AllocTimePercentile (&pArena->sStatistics, 50),
+								_AllocTimePercentile (&pArena->sStatistics, 99),
+								pArena->sStatistics.uAllocTimeMax));
+	}
+
 	PVR_LOG(( "  segment Chain:"));
 
 	if (pArena->pHeadSegment != IMG_NULL &&
@@ -2256,6 +2674,77 @@ static void* RA_ProcSeqOff2ElementInfo(struct seq_file * sfile, loff_t off)
 	return 0;
 }
 
+#ifdef RA_STATS
+static void RA_ProcSeqShowStats(struct seq_file *sfile, void* el)
+{
+	PVR_PROC_SEQ_HANDLERS *handlers = (PVR_PROC_SEQ_HANDLERS*)sfile->private;
+	RA_ARENA *pArena = (RA_ARENA *)handlers->data;
+	RA_STATISTICS *pStats = &pArena->sStatistics;
+	IMG_UINT32 auFreeHist[FREE_TABLE_LIMIT];
+	IMG_UINT32 uFreeCount;
+	IMG_SIZE_T uFreeTotal;
+	IMG_SIZE_T uFreeLargest;
+	IMG_UINT32 i;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	_FreeSegmentStats (pArena, auFreeHist, &uFreeCount, &uFreeTotal, &uFreeLargest);
+
+	seq_printf(sfile, "Arena \"%s\"\n", pArena->name);
+	seq_printf(sfile, "total allocs\t\t%u\n", pStats->uCumulativeAllocs);
+	seq_printf(sfile, "failed allocs\t\t%u\n", pStats->uFailedAllocCount);
+	seq_printf(sfile, "free resource count\t%u (0x%x)\n",
+			   (IMG_UINT)uFreeTotal, (IMG_UINT)uFreeTotal);
+	seq_printf(sfile, "largest free segment\t%u (0x%x)\n",
+			   (IMG_UINT)uFreeLargest, (IMG_UINT)uFreeLargest);
+	if (pStats->uLargestFreeLow != ~(IMG_SIZE_T)0)
+	{
+		seq_printf(sfile, "largest free low\t%u (0x%x) at alloc %u\n",
+				   (IMG_UINT)pStats->uLargestFreeLow, (IMG_UINT)pStats->uLargestFreeLow,
+				   pStats->uLargestFreeLowAlloc);
+	}
+	seq_printf(sfile, "fragmentation\t\t%u%%\n",
+			   _FragmentationPercent (uFreeTotal, uFreeLargest));
+
+	seq_printf(sfile, "alloc time p50/p90/p99/max\t%u/%u/%u/%u us\n",
+			   _AllocTimePercentile (pStats, 50),
+			   _AllocTimePercentile (pStats, 90),
+			   _AllocTimePercentile (pStats, 99),
+			   pStats->uAllocTimeMax);
+
+	seq_printf(sfile, "Size       Allocs     Free\n");
+	for (i=0; i<FREE_TABLE_LIMIT; i++)
+	{
+		if (pStats->auAllocSizeHist[i] != 0 || auFreeHist[i] != 0)
+		{
+			seq_printf(sfile, "%08x %8u %8u\n",
+					   1U << i, pStats->auAllocSizeHist[i], auFreeHist[i]);
+		}
+	}
+
+	seq_printf(sfile, "Time (us)  Allocs\n");
+	for (i=0; i<RA_STATS_TIME_BUCKETS; i++)
+	{
+		if (pStats->auAllocTimeHist[i] == 0)
+			continue;
+		if (i < RA_STATS_TIME_BUCKETS - 1)
+			seq_printf(sfile, "<%-8u %8u\n", 1U << i, pStats->auAllocTimeHist[i]);
+		else
+			seq_printf(sfile, ">=%-7u %8u\n", 1U << (i - 1), pStats->auAllocTimeHist[i]);
+	}
+}
+
+static void* RA_ProcSeqOff2ElementStats(struct seq_file * sfile, loff_t off)
+{
+	PVR_UNREFERENCED_PARAMETER(sfile);
+
+	if(off == 0)
+		return (void*)1;
+
+	return 0;
+}
+#endif
+
 static void RA_ProcSeqShowRegs(struct seq_file *sfile, void* el)
 {
 	PVR_PROC_SEQ_HANDLERS *handlers = (PVR_PROC_SEQ_HANDLERS*)sfile->private;
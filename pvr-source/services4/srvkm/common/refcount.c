@@ -231,6 +231,7 @@ void PVRSRVKernelMemInfoIncRef2(const IMG_CHAR *pszFile, IMG_INT iLine,
 
 skip:
 	psKernelMemInfo->ui32RefCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_MEMINFO, psKernelMemInfo->ui32RefCount);
 }
 
 IMG_INTERNAL
@@ -263,6 +264,7 @@ void PVRSRVKernelMemInfoDecRef2(const IMG_CHAR *pszFile, IMG_INT iLine,
 
 skip:
 	psKernelMemInfo->ui32RefCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_MEMINFO, psKernelMemInfo->ui32RefCount);
 }
 
 IMG_INTERNAL
@@ -294,6 +296,7 @@ void PVRSRVBMBufIncRef2(const IMG_CHAR *pszFile, IMG_INT iLine, BM_BUF *pBuf)
 
 skip:
 	pBuf->ui32RefCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_BM_BUF, pBuf->ui32RefCount);
 }
 
 IMG_INTERNAL
@@ -325,6 +328,7 @@ void PVRSRVBMBufDecRef2(const IMG_CHAR *pszFile, IMG_INT iLine, BM_BUF *pBuf)
 
 skip:
 	pBuf->ui32RefCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_BM_BUF, pBuf->ui32RefCount);
 }
 
 IMG_INTERNAL
@@ -356,6 +360,7 @@ void PVRSRVBMBufIncExport2(const IMG_CHAR *pszFile, IMG_INT iLine, BM_BUF *pBuf)
 
 skip:
 	pBuf->ui32ExportCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_BM_BUF_EXPORT, pBuf->ui32ExportCount);
 }
 
 IMG_INTERNAL
@@ -387,6 +392,7 @@ void PVRSRVBMBufDecExport2(const IMG_CHAR *pszFile, IMG_INT iLine, BM_BUF *pBuf)
 
 skip:
 	pBuf->ui32ExportCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_BM_BUF_EXPORT, pBuf->ui32ExportCount);
 }
 
 IMG_INTERNAL
@@ -485,6 +491,7 @@ void PVRSRVOffsetStructIncRef2(const IMG_CHAR *pszFile, IMG_INT iLine,
 
 skip:
 	psOffsetStruct->ui32RefCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_MMAP_OFFSET, psOffsetStruct->ui32RefCount);
 }
 
 IMG_INTERNAL
@@ -517,6 +524,7 @@ void PVRSRVOffsetStructDecRef2(const IMG_CHAR *pszFile, IMG_INT iLine,
 
 skip:
 	psOffsetStruct->ui32RefCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_MMAP_OFFSET, psOffsetStruct->ui32RefCount);
 }
 
 IMG_INTERNAL
@@ -549,6 +557,7 @@ void PVRSRVOffsetStructIncMapped2(const IMG_CHAR *pszFile, IMG_INT iLine,
 
 skip:
 	psOffsetStruct->ui32Mapped++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_MMAP_MAPPED, psOffsetStruct->ui32Mapped);
 }
 
 IMG_INTERNAL
@@ -581,8 +590,65 @@ void PVRSRVOffsetStructDecMapped2(const IMG_CHAR *pszFile, IMG_INT iLine,
 
 skip:
 	psOffsetStruct->ui32Mapped--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_MMAP_MAPPED, psOffsetStruct->ui32Mapped);
 }
 
 #endif /* defined(__linux__) */
 
 #endif /* defined(PVRSRV_REFCOUNT_DEBUG) */
+
+#if defined(PVRSRV_REFCOUNT_STATS)
+
+#if !defined(PVRSRV_REFCOUNT_DEBUG)
+#include "services_headers.h"
+#endif
+
+#if defined(__linux__)
+#include <asm/atomic.h>
+static atomic_t gasRefCountLive[PVRSRV_REFCOUNT_STAT_COUNT];
+#define PVRSRV_REFCOUNT_LIVE_INC(i)		atomic_inc(&gasRefCountLive[i])
+#define PVRSRV_REFCOUNT_LIVE_DEC(i)		atomic_dec(&gasRefCountLive[i])
+#define PVRSRV_REFCOUNT_LIVE_READ(i)	((IMG_UINT32)atomic_read(&gasRefCountLive[i]))
+#else
+/* Only counted under the bridge lock elsewhere; sync infos may be off */
+static IMG_UINT32 gaui32RefCountLive[PVRSRV_REFCOUNT_STAT_COUNT];
+#define PVRSRV_REFCOUNT_LIVE_INC(i)		(gaui32RefCountLive[i]++)
+#define PVRSRV_REFCOUNT_LIVE_DEC(i)		(gaui32RefCountLive[i]--)
+#define PVRSRV_REFCOUNT_LIVE_READ(i)	(gaui32RefCountLive[i])
+#endif
+
+static const IMG_CHAR *gapszRefCountStatName[PVRSRV_REFCOUNT_STAT_COUNT] =
+{
+	"syncinfo",
+	"meminfo",
+	"bm_buf",
+	"bm_buf_export",
+	"mmap_offset",
+	"mmap_mapped",
+};
+
+IMG_INTERNAL
+IMG_VOID PVRSRVRefCountStatInc(PVRSRV_REFCOUNT_STAT eStat)
+{
+	PVRSRV_REFCOUNT_LIVE_INC(eStat);
+}
+
+IMG_INTERNAL
+IMG_VOID PVRSRVRefCountStatDec(PVRSRV_REFCOUNT_STAT eStat)
+{
+	PVRSRV_REFCOUNT_LIVE_DEC(eStat);
+}
+
+IMG_INTERNAL
+const IMG_CHAR *PVRSRVRefCountStatName(PVRSRV_REFCOUNT_STAT eStat)
+{
+	return gapszRefCountStatName[eStat];
+}
+
+IMG_INTERNAL
+IMG_UINT32 PVRSRVRefCountStatRead(PVRSRV_REFCOUNT_STAT eStat)
+{
+	return PVRSRV_REFCOUNT_LIVE_READ(eStat);
+}
+
+#endif /* defined(PVRSRV_REFCOUNT_STATS) */
@@ -96,6 +96,19 @@ static DECLARE_MUTEX(lock);
 
 #define RESMAN_SIGNATURE 0x12345678
 
+/*
+ * Longest time a process teardown frees resources before letting other
+ * bridge callers in.
+ */
+#define RESMAN_DISCONNECT_YIELD_US	2000
+
+/*
+ * Set on an item while its free callback runs. Callbacks can drop the
+ * bridge lock (SGX clean-up waits do), so another thread may find the item
+ * before it is unlinked; it must not run the callback a second time.
+ */
+#define RESMAN_ITEM_FLAG_FREEING	0x00000001
+
 /******************************************************************************
  * resman structures
  *****************************************************************************/
@@ -132,6 +145,9 @@ typedef struct _RESMAN_CONTEXT_
 
 	RESMAN_ITEM					*psResItemList;/*!< res item list for context */
 
+	IMG_BOOL					bDisconnecting;/*!< freeing everything for a process exit */
+	IMG_UINT32					ui32LastYieldus;/*!< when the teardown last gave up the bridge lock */
+
 } RESMAN_CONTEXT;
 
 
@@ -284,6 +300,7 @@ PVRSRV_ERROR PVRSRVResManConnect(IMG_HANDLE			hPerProc,
 #endif /* DEBUG */
 	psResManContext->psResItemList	= IMG_NULL;
 	psResManContext->psPerProc = hPerProc;
+	psResManContext->bDisconnecting = IMG_FALSE;
 
 	/* Insert new context struct after the dummy first entry */
 	List_RESMAN_CONTEXT_Insert(&gpsResList->psContextList, psResManContext);
@@ -329,6 +346,9 @@ IMG_VOID PVRSRVResManDisconnect(PRESMAN_CONTEXT psResManContext,
 
 	if (!bKernelContext)
 	{
+		psResManContext->bDisconnecting = IMG_TRUE;
+		psResManContext->ui32LastYieldus = OSClockus();
+
 		/* OS specific User-mode Mappings: */
 		FreeResourceByCriteria(psResManContext, RESMAN_CRITERIA_RESTYPE, RESMAN_TYPE_OS_USERMODE_MAPPING, 0, 0, IMG_TRUE);
 
@@ -515,6 +535,11 @@ PVRSRV_ERROR ResManFreeResByPtr(RESMAN_ITEM	*psResItem, IMG_BOOL bForceCleanup)
 
 	/*Free resource*/
 	eError = FreeResourceByPtr(psResItem, IMG_TRUE, bForceCleanup);
+	if (eError == PVRSRV_ERROR_RETRY)
+	{
+		/* The caller retries through the bridge; let it back in */
+		psResItem->ui32Flags &= ~RESMAN_ITEM_FLAG_FREEING;
+	}
 
 	/*Check resource list*/
 	VALIDATERESLIST();
@@ -764,6 +789,14 @@ static PVRSRV_ERROR FreeResourceByPtr(RESMAN_ITEM	*psItem,
 			(IMG_UINTPTR_T)psItem->pvParam, psItem->ui32Param,
 			(IMG_UINTPTR_T)psItem->pfnFreeResource, psItem->ui32Flags));
 
+	if (psItem->ui32Flags & RESMAN_ITEM_FLAG_FREEING)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "FreeResourceByPtr: psItem=%08X is already being freed",
+				(IMG_UINTPTR_T)psItem));
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+	psItem->ui32Flags |= RESMAN_ITEM_FLAG_FREEING;
+
 	/* Release resource list sync object just in case the free routine calls the resource manager */
 	RELEASE_SYNC_OBJ;
 
@@ -780,6 +813,10 @@ static PVRSRV_ERROR FreeResourceByPtr(RESMAN_ITEM	*psItem,
 	/* Acquire resource list sync object */
 	ACQUIRE_SYNC_OBJ;
 
+	/*
+		On RETRY the item stays marked until the caller either retries it
+		or hands it back, so nobody else starts on it in between.
+	*/
 	if (eError != PVRSRV_ERROR_RETRY)
 	{
 		/* Remove this item from the resource list */
@@ -887,6 +924,21 @@ static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psResManContext,
 						 				ui32Param)) != IMG_NULL
 		  	&& eError == PVRSRV_OK)
 	{
+		if (psCurItem->ui32Flags & RESMAN_ITEM_FLAG_FREEING)
+		{
+			/*
+				Another thread is in this item's callback with the bridge
+				lock dropped. Wait for it to unlink the item (or give up on
+				it) rather than freeing it twice.
+			*/
+			RELEASE_SYNC_OBJ;
+			OSReleaseBridgeLock();
+			OSSleepms(1);
+			OSReacquireBridgeLock();
+			ACQUIRE_SYNC_OBJ;
+			continue;
+		}
+
 		do
 		{
 			eError = FreeResourceByPtr(psCurItem, bExecuteCallback, CLEANUP_WITH_POLL);
@@ -898,6 +950,22 @@ static PVRSRV_ERROR FreeResourceByCriteria(PRESMAN_CONTEXT	psResManContext,
 				OSSleepms(MAX_CLEANUP_TIME_WAIT_US/1000);
 				OSReacquireBridgeLock();
 				ACQUIRE_SYNC_OBJ;
+				psResManContext->ui32LastYieldus = OSClockus();
+				psCurItem->ui32Flags &= ~RESMAN_ITEM_FLAG_FREEING;
+			}
+			else if (psResManContext->bDisconnecting &&
+					 (OSClockus() - psResManContext->ui32LastYieldus) > RESMAN_DISCONNECT_YIELD_US)
+			{
+				/*
+					A big process can take a long time to tear down; don't
+					keep the display and other clients out for all of it.
+				*/
+				RELEASE_SYNC_OBJ;
+				OSReleaseBridgeLock();
+				OSReleaseThreadQuanta();
+				OSReacquireBridgeLock();
+				ACQUIRE_SYNC_OBJ;
+				psResManContext->ui32LastYieldus = OSClockus();
 			}
 		} while (eError == PVRSRV_ERROR_RETRY);
 	}
@@ -43,6 +43,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "services_headers.h"
 #include "ttrace.h"
 
+#if defined(__linux__) && defined(__KERNEL__)
+#include "proc.h"
+#endif
+
 #if defined(PVRSRV_NEED_PVR_DPF)
 #define CHECKSIZE(n,m) \
 	if ((n & m) != n) \
@@ -66,6 +70,18 @@ typedef struct
 	IMG_UINT8	ui8Data[0];
 } sTimeTraceBuffer;
 
+/*
+	Most items in a row come from the same process, so keep the last buffer
+	found to skip the hash lookup on every trace point.
+*/
+static IMG_UINT32 g_ui32LastPID = 0xFFFFFFFFU;
+static sTimeTraceBuffer *g_psLastBuffer = IMG_NULL;
+
+#if defined(__linux__) && defined(__KERNEL__)
+static struct proc_dir_entry *g_psProcTimeTrace = IMG_NULL;
+static IMG_VOID PVRSRVTimeTraceCreateProc(IMG_VOID);
+#endif
+
 /*!
 ******************************************************************************
 
@@ -111,7 +127,16 @@ PVRSRVTimeTraceAllocItem(IMG_UINT32 **pui32Item, IMG_UINT32 ui32Size)
 {
 	IMG_UINT32 ui32PID = OSGetCurrentProcessIDKM();
 	IMG_UINT32 ui32AllocOffset;
-	sTimeTraceBuffer *psBuffer = (sTimeTraceBuffer *) HASH_Retrieve(g_psBufferTable, (IMG_UINTPTR_T) ui32PID);
+	sTimeTraceBuffer *psBuffer;
+
+	if (ui32PID == g_ui32LastPID)
+	{
+		psBuffer = g_psLastBuffer;
+	}
+	else
+	{
+		psBuffer = (sTimeTraceBuffer *) HASH_Retrieve(g_psBufferTable, (IMG_UINTPTR_T) ui32PID);
+	}
 
 	/* The caller only asks for extra data space */
 	ui32Size += PVRSRV_TRACE_ITEM_SIZE;
@@ -141,6 +166,9 @@ PVRSRVTimeTraceAllocItem(IMG_UINT32 **pui32Item, IMG_UINT32 ui32Size)
 		}
 	}
 
+	g_ui32LastPID = ui32PID;
+	g_psLastBuffer = psBuffer;
+
 	/* Can't allocate more then buffer size */
 	if (ui32Size >= TIME_TRACE_BUFFER_SIZE)
 	{
@@ -256,6 +284,11 @@ PVRSRV_ERROR PVRSRVTimeTraceBufferDestroy(IMG_UINT32 ui32PID)
 	psBuffer = (sTimeTraceBuffer *) HASH_Retrieve(g_psBufferTable, (IMG_UINTPTR_T) ui32PID);
 	if (psBuffer)
 	{
+		if (psBuffer == g_psLastBuffer)
+		{
+			g_ui32LastPID = 0xFFFFFFFFU;
+			g_psLastBuffer = IMG_NULL;
+		}
 		OSFreeMem(PVRSRV_PAGEABLE_SELECT, sizeof(sTimeTraceBuffer) + TIME_TRACE_BUFFER_SIZE,
 				psBuffer, NULL);
 		HASH_Remove(g_psBufferTable, (IMG_UINTPTR_T) ui32PID);
@@ -299,6 +332,10 @@ PVRSRV_ERROR PVRSRVTimeTraceInit(IMG_VOID)
 		PVR_DPF((PVR_DBG_ERROR, "PVRSRVTimeTraceInit: Error creating timer"));
 		return PVRSRV_ERROR_INIT_FAILURE;
 	}
+
+#if defined(__linux__) && defined(__KERNEL__)
+	PVRSRVTimeTraceCreateProc();
+#endif
 	return PVRSRV_OK;
 }
 
@@ -325,6 +362,13 @@ static PVRSRV_ERROR _PVRSRVTimeTraceBufferDestroy(IMG_UINTPTR_T hKey, IMG_UINTPT
 ******************************************************************************/
 IMG_VOID PVRSRVTimeTraceDeinit(IMG_VOID)
 {
+#if defined(__linux__) && defined(__KERNEL__)
+	if (g_psProcTimeTrace)
+	{
+		RemoveProcEntrySeq(g_psProcTimeTrace);
+		g_psProcTimeTrace = IMG_NULL;
+	}
+#endif
 	PVRSRVTimeTraceBufferDestroy(KERNEL_ID);
 	/* Free any buffers the where created at alloc item time */
 	HASH_Iterate(g_psBufferTable, _PVRSRVTimeTraceBufferDestroy);
@@ -594,4 +638,76 @@ IMG_VOID PVRSRVDumpTimeTraceBuffers(IMG_VOID)
 	HASH_Iterate(g_psBufferTable, PVRSRVDumpTimeTraceBuffer);
 }
 
+#if defined(__linux__) && defined(__KERNEL__)
+
+/*
+	/proc/pvr/ttrace returns the trace buffers in binary, oldest item first.
+	Each buffer is a record of two IMG_UINT32s, the PID and the byte count,
+	followed by that many bytes of trace items as PVRSRVTimeTraceAllocItem
+	wrote them, padding items included.
+*/
+static struct seq_file *g_psTimeTraceSeqFile;
+
+static PVRSRV_ERROR PVRSRVTimeTraceWriteBuffer(IMG_UINTPTR_T hKey, IMG_UINTPTR_T hData)
+{
+	sTimeTraceBuffer *psBuffer = (sTimeTraceBuffer *) hData;
+	IMG_UINT32 aui32Record[2];
+	IMG_UINT32 ui32ToEnd = TIME_TRACE_BUFFER_SIZE - psBuffer->ui32Roff;
+
+	aui32Record[0] = (IMG_UINT32) hKey;
+	aui32Record[1] = psBuffer->ui32ByteCount;
+	seq_write(g_psTimeTraceSeqFile, aui32Record, sizeof(aui32Record));
+
+	if (psBuffer->ui32ByteCount <= ui32ToEnd)
+	{
+		seq_write(g_psTimeTraceSeqFile, &psBuffer->ui8Data[psBuffer->ui32Roff],
+				  psBuffer->ui32ByteCount);
+	}
+	else
+	{
+		seq_write(g_psTimeTraceSeqFile, &psBuffer->ui8Data[psBuffer->ui32Roff], ui32ToEnd);
+		seq_write(g_psTimeTraceSeqFile, &psBuffer->ui8Data[0],
+				  psBuffer->ui32ByteCount - ui32ToEnd);
+	}
+
+	return PVRSRV_OK;
+}
+
+static void PVRSRVTimeTraceProcShow(struct seq_file *sfile, void *el)
+{
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	g_psTimeTraceSeqFile = sfile;
+	HASH_Iterate(g_psBufferTable, PVRSRVTimeTraceWriteBuffer);
+}
+
+static void PVRSRVTimeTraceProcStartstop(struct seq_file *sfile, IMG_BOOL start)
+{
+	PVR_UNREFERENCED_PARAMETER(sfile);
+
+	/* Buffers are created and destroyed under the bridge lock. */
+	if (start)
+	{
+		OSReacquireBridgeLock();
+	}
+	else
+	{
+		OSReleaseBridgeLock();
+	}
+}
+
+static IMG_VOID PVRSRVTimeTraceCreateProc(IMG_VOID)
+{
+	g_psProcTimeTrace = CreateProcReadEntrySeq("ttrace", NULL, NULL,
+											   PVRSRVTimeTraceProcShow,
+											   ProcSeq1ElementOff2Element,
+											   PVRSRVTimeTraceProcStartstop);
+	if (!g_psProcTimeTrace)
+	{
+		PVR_DPF((PVR_DBG_WARNING, "PVRSRVTimeTraceInit: Error creating ttrace proc entry"));
+	}
+}
+
+#endif /* __linux__ && __KERNEL__ */
+
 #endif /* TTRACE */
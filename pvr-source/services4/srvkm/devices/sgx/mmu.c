@@ -785,6 +785,138 @@ static IMG_BOOL BRN31620FreePageTable(MMU_HEAP *psMMUHeap, IMG_UINT32 ui32PDInde
 }
 #endif
 
+/*!
+******************************************************************************
+	FUNCTION:   _MMUPoolAllocPage
+
+	PURPOSE:    Get a 4K write combined page for a PD or PT, from the device's
+	            pool when it has one, otherwise from the OS
+
+	PARAMETERS: In:  psDevInfo - device info
+	            Out: ppvCpuVAddr - kernel virtual address of the page
+	            Out: phOSMemHandle - OS handle of the page
+	RETURNS:    PVRSRV_OK or error
+******************************************************************************/
+static PVRSRV_ERROR
+_MMUPoolAllocPage (PVRSRV_SGXDEV_INFO *psDevInfo,
+				   IMG_VOID **ppvCpuVAddr,
+				   IMG_HANDLE *phOSMemHandle)
+{
+	if (psDevInfo->ui32MMUPagePoolCount != 0)
+	{
+		psDevInfo->ui32MMUPagePoolCount--;
+		*ppvCpuVAddr = psDevInfo->apvMMUPagePoolCpuVAddr[psDevInfo->ui32MMUPagePoolCount];
+		*phOSMemHandle = psDevInfo->ahMMUPagePoolOSMemHandle[psDevInfo->ui32MMUPagePoolCount];
+		return PVRSRV_OK;
+	}
+
+	return OSAllocPages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
+						SGX_MMU_PAGE_SIZE,
+						SGX_MMU_PAGE_SIZE,
+						IMG_NULL,
+						0,
+						IMG_NULL,
+						ppvCpuVAddr,
+						phOSMemHandle);
+}
+
+
+/*!
+******************************************************************************
+	FUNCTION:   _MMUPoolFreePage
+
+	PURPOSE:    Give back a page from _MMUPoolAllocPage. It keeps its write
+	            combined mapping in the pool, so the next context or heap
+	            does not pay for the page attribute change again. Callers
+	            initialise the whole page when they take it.
+
+	PARAMETERS: In:  psDevInfo - device info
+	            In:  pvCpuVAddr - kernel virtual address of the page
+	            In:  hOSMemHandle - OS handle of the page
+	RETURNS:    None
+******************************************************************************/
+static IMG_VOID
+_MMUPoolFreePage (PVRSRV_SGXDEV_INFO *psDevInfo,
+				  IMG_VOID *pvCpuVAddr,
+				  IMG_HANDLE hOSMemHandle)
+{
+	if (psDevInfo->bMMUPagePoolActive &&
+		(psDevInfo->ui32MMUPagePoolCount < SGX_MMU_PAGE_POOL_SIZE))
+	{
+		psDevInfo->apvMMUPagePoolCpuVAddr[psDevInfo->ui32MMUPagePoolCount] = pvCpuVAddr;
+		psDevInfo->ahMMUPagePoolOSMemHandle[psDevInfo->ui32MMUPagePoolCount] = hOSMemHandle;
+		psDevInfo->ui32MMUPagePoolCount++;
+		return;
+	}
+
+	OSFreePages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
+				SGX_MMU_PAGE_SIZE,
+				pvCpuVAddr,
+				hOSMemHandle);
+}
+
+
+/*!
+******************************************************************************
+	FUNCTION:   MMU_PagePoolInit
+
+	PURPOSE:    Start keeping freed PD/PT pages and allocate the first few
+
+	PARAMETERS: In:  psDevInfo - device info
+	RETURNS:    None
+******************************************************************************/
+IMG_VOID
+MMU_PagePoolInit (PVRSRV_SGXDEV_INFO *psDevInfo)
+{
+	while (psDevInfo->ui32MMUPagePoolCount < SGX_MMU_PAGE_POOL_PREFILL)
+	{
+		IMG_UINT32 i = psDevInfo->ui32MMUPagePoolCount;
+
+		/* A short pool is only slower, not an error */
+		if (OSAllocPages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
+						 SGX_MMU_PAGE_SIZE,
+						 SGX_MMU_PAGE_SIZE,
+						 IMG_NULL,
+						 0,
+						 IMG_NULL,
+						 &psDevInfo->apvMMUPagePoolCpuVAddr[i],
+						 &psDevInfo->ahMMUPagePoolOSMemHandle[i]) != PVRSRV_OK)
+		{
+			break;
+		}
+		psDevInfo->ui32MMUPagePoolCount++;
+	}
+
+	psDevInfo->bMMUPagePoolActive = IMG_TRUE;
+}
+
+
+/*!
+******************************************************************************
+	FUNCTION:   MMU_PagePoolDeinit
+
+	PURPOSE:    Free the pooled PD/PT pages. Pages freed after this go
+	            straight back to the OS.
+
+	PARAMETERS: In:  psDevInfo - device info
+	RETURNS:    None
+******************************************************************************/
+IMG_VOID
+MMU_PagePoolDeinit (PVRSRV_SGXDEV_INFO *psDevInfo)
+{
+	psDevInfo->bMMUPagePoolActive = IMG_FALSE;
+
+	while (psDevInfo->ui32MMUPagePoolCount != 0)
+	{
+		psDevInfo->ui32MMUPagePoolCount--;
+		OSFreePages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
+					SGX_MMU_PAGE_SIZE,
+					psDevInfo->apvMMUPagePoolCpuVAddr[psDevInfo->ui32MMUPagePoolCount],
+					psDevInfo->ahMMUPagePoolOSMemHandle[psDevInfo->ui32MMUPagePoolCount]);
+	}
+}
+
+
 /*!
 ******************************************************************************
 	FUNCTION:   _AllocPageTableMemory
@@ -811,15 +943,27 @@ _AllocPageTableMemory (MMU_HEAP *pMMUHeap,
 	*/
 	if(pMMUHeap->psDevArena->psDeviceMemoryHeapInfo->psLocalDevMemArena == IMG_NULL)
 	{
+		PVRSRV_ERROR eError;
+
 		//FIXME: replace with an RA, this allocator only handles 4k allocs
-		if (OSAllocPages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
-						 pMMUHeap->ui32PTSize,
-						 SGX_MMU_PAGE_SIZE,//FIXME: assume 4K page size for now (wastes memory for smaller pagetables
-						 IMG_NULL,
-						 0,
-						 IMG_NULL,
-						 (IMG_VOID **)&psPTInfoList->PTPageCpuVAddr,
-						 &psPTInfoList->hPTPageOSMemHandle) != PVRSRV_OK)
+		if (pMMUHeap->ui32PTSize == SGX_MMU_PAGE_SIZE)
+		{
+			eError = _MMUPoolAllocPage(pMMUHeap->psMMUContext->psDevInfo,
+									   (IMG_VOID **)&psPTInfoList->PTPageCpuVAddr,
+									   &psPTInfoList->hPTPageOSMemHandle);
+		}
+		else
+		{
+			eError = OSAllocPages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
+								  pMMUHeap->ui32PTSize,
+								  SGX_MMU_PAGE_SIZE,//FIXME: assume 4K page size for now (wastes memory for smaller pagetables
+								  IMG_NULL,
+								  0,
+								  IMG_NULL,
+								  (IMG_VOID **)&psPTInfoList->PTPageCpuVAddr,
+								  &psPTInfoList->hPTPageOSMemHandle);
+		}
+		if (eError != PVRSRV_OK)
 		{
 			PVR_DPF((PVR_DBG_ERROR, "_AllocPageTableMemory: ERROR call to OSAllocPages failed"));
 			return IMG_FALSE;
@@ -961,10 +1105,19 @@ _FreePageTableMemory (MMU_HEAP *pMMUHeap, MMU_PT_INFO *psPTInfoList)
 		MakeKernelPageReadWrite(psPTInfoList->PTPageCpuVAddr);
 
 		//FIXME: replace with an RA, this allocator only handles 4k allocs
-		OSFreePages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
-					  pMMUHeap->ui32PTSize,
-					  psPTInfoList->PTPageCpuVAddr,
-					  psPTInfoList->hPTPageOSMemHandle);
+		if (pMMUHeap->ui32PTSize == SGX_MMU_PAGE_SIZE)
+		{
+			_MMUPoolFreePage(pMMUHeap->psMMUContext->psDevInfo,
+							 psPTInfoList->PTPageCpuVAddr,
+							 psPTInfoList->hPTPageOSMemHandle);
+		}
+		else
+		{
+			OSFreePages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
+						  pMMUHeap->ui32PTSize,
+						  psPTInfoList->PTPageCpuVAddr,
+						  psPTInfoList->hPTPageOSMemHandle);
+		}
 	}
 	else
 	{
@@ -1282,8 +1435,8 @@ _DeferredAllocPagetables(MMU_HEAP *pMMUHeap, IMG_DEV_VIRTADDR DevVAddr, IMG_UINT
 	MMU_PT_INFO **ppsPTInfoList;
 	SYS_DATA *psSysData;
 	IMG_DEV_VIRTADDR sHighDevVAddr;
-#if defined(FIX_HW_BRN_31620)
 	IMG_BOOL bFlushSystemCache = IMG_FALSE;
+#if defined(FIX_HW_BRN_31620)
 	IMG_BOOL bSharedPT = IMG_FALSE;
 	IMG_DEV_VIRTADDR sDevVAddrRequestStart;
 	IMG_DEV_VIRTADDR sDevVAddrRequestEnd;
@@ -1440,8 +1593,8 @@ _DeferredAllocPagetables(MMU_HEAP *pMMUHeap, IMG_DEV_VIRTADDR DevVAddr, IMG_UINT
 				PVR_DPF((PVR_DBG_ERROR, "_DeferredAllocPagetables: ERROR call to _AllocPageTableMemory failed"));
 				return IMG_FALSE;
 			}
-#if defined(FIX_HW_BRN_31620)
 			bFlushSystemCache = IMG_TRUE;
+#if defined(FIX_HW_BRN_31620)
 			/* Bump up the page table count if required */
 			{
 				IMG_UINT32 ui32PD;
@@ -1556,16 +1709,19 @@ _DeferredAllocPagetables(MMU_HEAP *pMMUHeap, IMG_DEV_VIRTADDR DevVAddr, IMG_UINT
 	}
 
 	#if defined(SGX_FEATURE_SYSTEM_CACHE)
-	#if defined(FIX_HW_BRN_31620)
-	/* This function might not allocate any new PT's so check before flushing */
+	/*
+		This function might not allocate any new PT's so check before flushing;
+		allocations landing in existing PTs leave the SLC alone, and the
+		request is only picked up by the next kick anyway.
+	*/
 	if (bFlushSystemCache)
 	{
-	#endif
-
-	MMU_InvalidateSystemLevelCache(pMMUHeap->psMMUContext->psDevInfo);
+		MMU_InvalidateSystemLevelCache(pMMUHeap->psMMUContext->psDevInfo);
+	}
+	#else
+	PVR_UNREFERENCED_PARAMETER(bFlushSystemCache);
 	#endif /* SGX_FEATURE_SYSTEM_CACHE */
 	#if defined(FIX_HW_BRN_31620)
-	}
 
 	/* Handle the last 4MB roll over */
 	sHighDevVAddr.uiAddr = sHighDevVAddr.uiAddr - 1;
@@ -1760,14 +1916,7 @@ MMU_Initialise (PVRSRV_DEVICE_NODE *psDeviceNode, MMU_CONTEXT **ppsMMUContext, I
 	/* allocate 4k page directory page for the new context */
 	if(psDeviceNode->psLocalDevMemArena == IMG_NULL)
 	{
-		if (OSAllocPages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
-						 SGX_MMU_PAGE_SIZE,
-						 SGX_MMU_PAGE_SIZE,
-						 IMG_NULL,
-						 0,
-						 IMG_NULL,
-						 &pvPDCpuVAddr,
-						 &hPDOSMemHandle) != PVRSRV_OK)
+		if (_MMUPoolAllocPage(psDevInfo, &pvPDCpuVAddr, &hPDOSMemHandle) != PVRSRV_OK)
 		{
 			PVR_DPF((PVR_DBG_ERROR, "MMU_Initialise: ERROR call to OSAllocPages failed"));
 			return PVRSRV_ERROR_FAILED_TO_ALLOC_PAGES;
@@ -2415,10 +2564,9 @@ MMU_Finalise (MMU_CONTEXT *psMMUContext)
 		PVRSRV_SGXDEV_INFO *psDevInfo = (PVRSRV_SGXDEV_INFO*)psMMUContext->psDevInfo;
 #endif
 		MakeKernelPageReadWrite(psMMUContext->pvPDCpuVAddr);
-		OSFreePages(PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_KERNEL_ONLY,
-						SGX_MMU_PAGE_SIZE,
-						psMMUContext->pvPDCpuVAddr,
-						psMMUContext->hPDOSMemHandle);
+		_MMUPoolFreePage(psMMUContext->psDevInfo,
+						 psMMUContext->pvPDCpuVAddr,
+						 psMMUContext->hPDOSMemHandle);
 
 #if defined(FIX_HW_BRN_31620)
 		/* If this is the _last_ MMU context it must be the uKernel */
@@ -2676,7 +2824,8 @@ MMU_UnmapPagesAndFreePTs (MMU_HEAP *psMMUHeap,
 						  IMG_HANDLE hUniqueTag)
 {
 	IMG_DEV_VIRTADDR	sTmpDevVAddr;
-	IMG_UINT32			i;
+	IMG_UINT32			i, j;
+	IMG_UINT32			ui32Count;
 	IMG_UINT32			ui32PDIndex;
 	IMG_UINT32			ui32PTIndex;
 	IMG_UINT32			*pui32Tmp;
@@ -2688,7 +2837,7 @@ MMU_UnmapPagesAndFreePTs (MMU_HEAP *psMMUHeap,
 	/* setup tmp devvaddr to base of allocation */
 	sTmpDevVAddr = sDevVAddr;
 
-	for(i=0; i<ui32PageCount; i++)
+	for(i=0; i<ui32PageCount; i+=ui32Count)
 	{
 		MMU_PT_INFO **ppsPTInfoList;
 
@@ -2698,42 +2847,51 @@ MMU_UnmapPagesAndFreePTs (MMU_HEAP *psMMUHeap,
 		/* and advance to the first PT info list */
 		ppsPTInfoList = &psMMUHeap->psMMUContext->apsPTInfoList[ui32PDIndex];
 
-		{
-			/* find the index/offset of the first PT in the first PT page */
-			ui32PTIndex = (sTmpDevVAddr.uiAddr & psMMUHeap->ui32PTMask) >> psMMUHeap->ui32PTShift;
+		/* find the index/offset of the first PT in the first PT page */
+		ui32PTIndex = (sTmpDevVAddr.uiAddr & psMMUHeap->ui32PTMask) >> psMMUHeap->ui32PTShift;
 
-			/* Is the PT page valid? */
-			if (!ppsPTInfoList[0])
-			{
-				/*
-					With sparse mappings we expect that the PT could be freed
-					before we reach the end of it as the unmapped pages don't
-					bump ui32ValidPTECount so it can reach zero before we reach
-					the end of the PT.
-				*/
-				if (!psMMUHeap->bHasSparseMappings)
-				{
-					PVR_DPF((PVR_DBG_MESSAGE, "MMU_UnmapPagesAndFreePTs: Invalid PT for alloc at VAddr:0x%08X (VaddrIni:0x%08X AllocPage:%u) PDIdx:%u PTIdx:%u",sTmpDevVAddr.uiAddr, sDevVAddr.uiAddr,i, ui32PDIndex, ui32PTIndex ));
-				}
+		/* the part of the range that falls in this page table */
+		ui32Count = psMMUHeap->ui32PTNumEntriesUsable - ui32PTIndex;
+		if (ui32Count > ui32PageCount - i)
+		{
+			ui32Count = ui32PageCount - i;
+		}
 
-				/* advance the sTmpDevVAddr by one page */
-				sTmpDevVAddr.uiAddr += psMMUHeap->ui32DataPageSize;
+		/* advance the sTmpDevVAddr past this page table's part of the range */
+		sTmpDevVAddr.uiAddr += ui32Count * psMMUHeap->ui32DataPageSize;
 
-				/* Try to unmap the remaining allocation pages */
-				continue;
+		/* Is the PT page valid? */
+		if (!ppsPTInfoList[0])
+		{
+			/*
+				With sparse mappings we expect that the PT could be freed
+				before we reach the end of it as the unmapped pages don't
+				bump ui32ValidPTECount so it can reach zero before we reach
+				the end of the PT.
+			*/
+			if (!psMMUHeap->bHasSparseMappings)
+			{
+				PVR_DPF((PVR_DBG_MESSAGE, "MMU_UnmapPagesAndFreePTs: Invalid PT for alloc at VAddr:0x%08X (VaddrIni:0x%08X AllocPage:%u) PDIdx:%u PTIdx:%u",sTmpDevVAddr.uiAddr - ui32Count * psMMUHeap->ui32DataPageSize, sDevVAddr.uiAddr,i, ui32PDIndex, ui32PTIndex ));
 			}
 
-			/* setup pointer to the first entry in the PT page */
-			pui32Tmp = (IMG_UINT32*)ppsPTInfoList[0]->PTPageCpuVAddr;
+			/* Try to unmap the remaining allocation pages */
+			continue;
+		}
 
-			/* Is PTPageCpuVAddr valid ? */
-			if (!pui32Tmp)
-			{
-				continue;
-			}
+		/* setup pointer to the first entry in the PT page */
+		pui32Tmp = (IMG_UINT32*)ppsPTInfoList[0]->PTPageCpuVAddr;
 
-			CheckPT(ppsPTInfoList[0]);
+		/* Is PTPageCpuVAddr valid ? */
+		if (!pui32Tmp)
+		{
+			continue;
+		}
+
+		CheckPT(ppsPTInfoList[0]);
 
+		MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
+		for (j=0; j<ui32Count; j++, ui32PTIndex++)
+		{
 			/* Decrement the valid page count only if the current page is valid*/
 			if (pui32Tmp[ui32PTIndex] & SGX_MMU_PTE_VALID)
 			{
@@ -2743,13 +2901,12 @@ MMU_UnmapPagesAndFreePTs (MMU_HEAP *psMMUHeap,
 			{
 				if (!psMMUHeap->bHasSparseMappings)
 				{
-					PVR_DPF((PVR_DBG_MESSAGE, "MMU_UnmapPagesAndFreePTs: Page is already invalid for alloc at VAddr:0x%08X (VAddrIni:0x%08X AllocPage:%u) PDIdx:%u PTIdx:%u",sTmpDevVAddr.uiAddr, sDevVAddr.uiAddr,i, ui32PDIndex, ui32PTIndex ));
+					PVR_DPF((PVR_DBG_MESSAGE, "MMU_UnmapPagesAndFreePTs: Page is already invalid for alloc at VAddr:0x%08X (VAddrIni:0x%08X AllocPage:%u) PDIdx:%u PTIdx:%u",sDevVAddr.uiAddr + (i + j) * psMMUHeap->ui32DataPageSize, sDevVAddr.uiAddr,i + j, ui32PDIndex, ui32PTIndex ));
 				}
 			}
 
 			/* The page table count should not go below zero */
 			PVR_ASSERT((IMG_INT32)ppsPTInfoList[0]->ui32ValidPTECount >= 0);
-			MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
 #if defined(SUPPORT_SGX_MMU_DUMMY_PAGE)
 			/* point the PT entry to the dummy data page */
 			pui32Tmp[ui32PTIndex] = (psMMUHeap->psMMUContext->psDevInfo->sDummyDataDevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
@@ -2762,15 +2919,15 @@ MMU_UnmapPagesAndFreePTs (MMU_HEAP *psMMUHeap,
 			pui32Tmp[ui32PTIndex] = 0;
 #endif
 #endif
-			MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
-			CheckPT(ppsPTInfoList[0]);
 		}
+		MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
+		CheckPT(ppsPTInfoList[0]);
 
 		/*
-			Free a page table if we can.
+			Free the page table if we can. The count never goes back up
+			while unmapping, so checking once per page table is enough.
 		*/
-		if (ppsPTInfoList[0] && (ppsPTInfoList[0]->ui32ValidPTECount == 0)
-			)
+		if (ppsPTInfoList[0]->ui32ValidPTECount == 0)
 		{
 #if defined(FIX_HW_BRN_31620)
 			if (BRN31620FreePageTable(psMMUHeap, ui32PDIndex) == IMG_TRUE)
@@ -2782,9 +2939,6 @@ MMU_UnmapPagesAndFreePTs (MMU_HEAP *psMMUHeap,
 			bInvalidateDirectoryCache = IMG_TRUE;
 #endif
 		}
-
-		/* advance the sTmpDevVAddr by one page */
-		sTmpDevVAddr.uiAddr += psMMUHeap->ui32DataPageSize;
 	}
 
 	if(bInvalidateDirectoryCache)
@@ -3375,23 +3529,32 @@ MMU_PDumpPageTables	(MMU_HEAP *pMMUHeap,
 
 /*!
 ******************************************************************************
-	FUNCTION:   MMU_MapPage
+	FUNCTION:   MMU_MapPageRun
 
-	PURPOSE:    Create a mapping for one page at a specified virtual address.
+	PURPOSE:    Create mappings for a run of pages at a specified virtual
+	            address. The PTEs falling in each page table are written in
+	            one pass, with the page table made writable once.
 
 	PARAMETERS: In:  pMMUHeap - the mmu.
-	            In:  DevVAddr - the device virtual address.
-	            In:  DevPAddr - the device physical address of the page to map.
+	            In:  DevVAddr - the device virtual address of the first page.
+	            In:  DevPAddr - the device physical address of the first page.
+	            In:  ui32PageCount - number of pages in the run.
+	            In:  ui32PAdvance - physical address step between pages
+	                 (0 maps every page onto DevPAddr).
 	            In:  ui32MemFlags - BM r/w/cache flags
 	RETURNS:    None
 ******************************************************************************/
 static IMG_VOID
-MMU_MapPage (MMU_HEAP *pMMUHeap,
-			 IMG_DEV_VIRTADDR DevVAddr,
-			 IMG_DEV_PHYADDR DevPAddr,
-			 IMG_UINT32 ui32MemFlags)
+MMU_MapPageRun (MMU_HEAP *pMMUHeap,
+				IMG_DEV_VIRTADDR DevVAddr,
+				IMG_DEV_PHYADDR DevPAddr,
+				IMG_UINT32 ui32PageCount,
+				IMG_UINT32 ui32PAdvance,
+				IMG_UINT32 ui32MemFlags)
 {
 	IMG_UINT32 ui32Index;
+	IMG_UINT32 ui32Count;
+	IMG_UINT32 i;
 	IMG_UINT32 *pui32Tmp;
 	IMG_UINT32 ui32MMUFlags = 0;
 	MMU_PT_INFO **ppsPTInfoList;
@@ -3433,63 +3596,105 @@ MMU_MapPage (MMU_HEAP *pMMUHeap,
 #endif
 
 	/*
-		we receive a device physical address for the page that is to be mapped
-		and a device virtual address representing where it should be mapped to
+		we receive a device physical address for the first page that is to
+		be mapped and a device virtual address representing where it should
+		be mapped to
 	*/
+	while (ui32PageCount != 0)
+	{
+		/* find the index/offset in PD entries  */
+		ui32Index = DevVAddr.uiAddr >> pMMUHeap->ui32PDShift;
 
-	/* find the index/offset in PD entries  */
-	ui32Index = DevVAddr.uiAddr >> pMMUHeap->ui32PDShift;
+		/* and advance to the first PT info list */
+		ppsPTInfoList = &pMMUHeap->psMMUContext->apsPTInfoList[ui32Index];
 
-	/* and advance to the first PT info list */
-	ppsPTInfoList = &pMMUHeap->psMMUContext->apsPTInfoList[ui32Index];
+		CheckPT(ppsPTInfoList[0]);
 
-	CheckPT(ppsPTInfoList[0]);
+		/* find the index/offset of the first PT in the first PT page */
+		ui32Index = (DevVAddr.uiAddr & pMMUHeap->ui32PTMask) >> pMMUHeap->ui32PTShift;
 
-	/* find the index/offset of the first PT in the first PT page */
-	ui32Index = (DevVAddr.uiAddr & pMMUHeap->ui32PTMask) >> pMMUHeap->ui32PTShift;
+		/* the part of the run that falls in this page table */
+		ui32Count = pMMUHeap->ui32PTNumEntriesUsable - ui32Index;
+		if (ui32Count > ui32PageCount)
+		{
+			ui32Count = ui32PageCount;
+		}
 
-	/* setup pointer to the first entry in the PT page */
-	pui32Tmp = (IMG_UINT32*)ppsPTInfoList[0]->PTPageCpuVAddr;
+		/* setup pointer to the first entry in the PT page */
+		pui32Tmp = (IMG_UINT32*)ppsPTInfoList[0]->PTPageCpuVAddr;
 
 #if !defined(SUPPORT_SGX_MMU_DUMMY_PAGE)
-	{
-		IMG_UINT32 uTmp = pui32Tmp[ui32Index];
-		
-		/* Is the current page already valid? (should not be unless it was allocated and not deallocated) */
+		for (i = 0; i < ui32Count; i++)
+		{
+			IMG_UINT32 uTmp = pui32Tmp[ui32Index + i];
+			IMG_UINT32 ui32VAddr = DevVAddr.uiAddr + i * pMMUHeap->ui32DataPageSize;
+
+			/* Is the current page already valid? (should not be unless it was allocated and not deallocated) */
 #if defined(FIX_HW_BRN_31620)
-		if ((uTmp & SGX_MMU_PTE_VALID) && ((DevVAddr.uiAddr & BRN31620_PDE_CACHE_FILL_MASK) != BRN31620_DUMMY_PAGE_OFFSET))
+			if ((uTmp & SGX_MMU_PTE_VALID) && ((ui32VAddr & BRN31620_PDE_CACHE_FILL_MASK) != BRN31620_DUMMY_PAGE_OFFSET))
 #else
- 		if ((uTmp & SGX_MMU_PTE_VALID) != 0)
+			if ((uTmp & SGX_MMU_PTE_VALID) != 0)
 #endif
 
-		{
-			PVR_DPF((PVR_DBG_ERROR, "MMU_MapPage: Page is already valid for alloc at VAddr:0x%08X PDIdx:%u PTIdx:%u",
-									DevVAddr.uiAddr,
-									DevVAddr.uiAddr >> pMMUHeap->ui32PDShift,
-									ui32Index ));
-			PVR_DPF((PVR_DBG_ERROR, "MMU_MapPage: Page table entry value: 0x%08X", uTmp));
-			PVR_DPF((PVR_DBG_ERROR, "MMU_MapPage: Physical page to map: 0x%08X", DevPAddr.uiAddr));
+			{
+				PVR_DPF((PVR_DBG_ERROR, "MMU_MapPage: Page is already valid for alloc at VAddr:0x%08X PDIdx:%u PTIdx:%u",
+										ui32VAddr,
+										ui32VAddr >> pMMUHeap->ui32PDShift,
+										ui32Index + i));
+				PVR_DPF((PVR_DBG_ERROR, "MMU_MapPage: Page table entry value: 0x%08X", uTmp));
+				PVR_DPF((PVR_DBG_ERROR, "MMU_MapPage: Physical page to map: 0x%08X", DevPAddr.uiAddr + i * ui32PAdvance));
 #if PT_DUMP
-			DumpPT(ppsPTInfoList[0]);
+				DumpPT(ppsPTInfoList[0]);
 #endif
-		}
+			}
 #if !defined(FIX_HW_BRN_31620)
-		PVR_ASSERT((uTmp & SGX_MMU_PTE_VALID) == 0);
+			PVR_ASSERT((uTmp & SGX_MMU_PTE_VALID) == 0);
 #endif
-	}
+			PVR_UNREFERENCED_PARAMETER(ui32VAddr);
+		}
 #endif
 
-	/* One more valid entry in the page table. */
-	ppsPTInfoList[0]->ui32ValidPTECount++;
-
-	MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
-	/* map in the physical page */
-	pui32Tmp[ui32Index] = ((DevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
-						& ((~pMMUHeap->ui32DataPageMask)>>SGX_MMU_PTE_ADDR_ALIGNSHIFT))
-						| SGX_MMU_PTE_VALID
-						| ui32MMUFlags;
-	MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
-	CheckPT(ppsPTInfoList[0]);
+		/* More valid entries in the page table. */
+		ppsPTInfoList[0]->ui32ValidPTECount += ui32Count;
+
+		MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
+		/* map in the physical pages */
+		for (i = 0; i < ui32Count; i++)
+		{
+			pui32Tmp[ui32Index + i] = ((DevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
+									& ((~pMMUHeap->ui32DataPageMask)>>SGX_MMU_PTE_ADDR_ALIGNSHIFT))
+									| SGX_MMU_PTE_VALID
+									| ui32MMUFlags;
+			DevPAddr.uiAddr += ui32PAdvance;
+		}
+		MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
+		CheckPT(ppsPTInfoList[0]);
+
+		DevVAddr.uiAddr += ui32Count * pMMUHeap->ui32DataPageSize;
+		ui32PageCount -= ui32Count;
+	}
+}
+
+
+/*!
+******************************************************************************
+	FUNCTION:   MMU_MapPage
+
+	PURPOSE:    Create a mapping for one page at a specified virtual address.
+
+	PARAMETERS: In:  pMMUHeap - the mmu.
+	            In:  DevVAddr - the device virtual address.
+	            In:  DevPAddr - the device physical address of the page to map.
+	            In:  ui32MemFlags - BM r/w/cache flags
+	RETURNS:    None
+******************************************************************************/
+static INLINE IMG_VOID
+MMU_MapPage (MMU_HEAP *pMMUHeap,
+			 IMG_DEV_VIRTADDR DevVAddr,
+			 IMG_DEV_PHYADDR DevPAddr,
+			 IMG_UINT32 ui32MemFlags)
+{
+	MMU_MapPageRun(pMMUHeap, DevVAddr, DevPAddr, 1, 0, ui32MemFlags);
 }
 
 
@@ -3520,7 +3725,7 @@ MMU_MapScatter (MMU_HEAP *pMMUHeap,
 #if defined(PDUMP)
 	IMG_DEV_VIRTADDR MapBaseDevVAddr;
 #endif /*PDUMP*/
-	IMG_UINT32 uCount, i;
+	IMG_UINT32 ui32PageCount, ui32Run, i;
 	IMG_DEV_PHYADDR DevPAddr;
 
 	PVR_ASSERT (pMMUHeap != IMG_NULL);
@@ -3531,24 +3736,34 @@ MMU_MapScatter (MMU_HEAP *pMMUHeap,
 	PVR_UNREFERENCED_PARAMETER(hUniqueTag);
 #endif /*PDUMP*/
 
-	for (i=0, uCount=0; uCount<uSize; i++, uCount+=pMMUHeap->ui32DataPageSize)
+	ui32PageCount = (IMG_UINT32)((uSize + pMMUHeap->ui32DataPageSize - 1) >> pMMUHeap->ui32PTShift);
+
+	for (i=0; i<ui32PageCount; i+=ui32Run)
 	{
 		IMG_SYS_PHYADDR sSysAddr;
 
 		sSysAddr = psSysAddr[i];
 
-
 		/* check the physical alignment of the memory to map */
 		PVR_ASSERT((sSysAddr.uiAddr & pMMUHeap->ui32DataPageMask) == 0);
 
-		DevPAddr = SysSysPAddrToDevPAddr(PVRSRV_DEVICE_TYPE_SGX, sSysAddr);
+		/* map physically contiguous pages as one run */
+		for (ui32Run=1; i+ui32Run<ui32PageCount; ui32Run++)
+		{
+			if (psSysAddr[i+ui32Run].uiAddr != sSysAddr.uiAddr + ui32Run * pMMUHeap->ui32DataPageSize)
+			{
+				break;
+			}
+		}
 
-		MMU_MapPage (pMMUHeap, DevVAddr, DevPAddr, ui32MemFlags);
-		DevVAddr.uiAddr += pMMUHeap->ui32DataPageSize;
+		DevPAddr = SysSysPAddrToDevPAddr(PVRSRV_DEVICE_TYPE_SGX, sSysAddr);
 
 		PVR_DPF ((PVR_DBG_MESSAGE,
-				 "MMU_MapScatter: devVAddr=%08X, SysAddr=%08X, size=0x%x/0x%x",
-				  DevVAddr.uiAddr, sSysAddr.uiAddr, uCount, uSize));
+				 "MMU_MapScatter: devVAddr=%08X, SysAddr=%08X, pages=%u",
+				  DevVAddr.uiAddr, sSysAddr.uiAddr, ui32Run));
+
+		MMU_MapPageRun (pMMUHeap, DevVAddr, DevPAddr, ui32Run, pMMUHeap->ui32DataPageSize, ui32MemFlags);
+		DevVAddr.uiAddr += ui32Run * pMMUHeap->ui32DataPageSize;
 	}
 
 #if defined(PDUMP)
@@ -3584,8 +3799,6 @@ MMU_MapPages (MMU_HEAP *pMMUHeap,
 #if defined(PDUMP)
 	IMG_DEV_VIRTADDR MapBaseDevVAddr;
 #endif /*PDUMP*/
-	IMG_UINT32 uCount;
-	IMG_UINT32 ui32VAdvance;
 	IMG_UINT32 ui32PAdvance;
 
 	PVR_ASSERT (pMMUHeap != IMG_NULL);
@@ -3597,8 +3810,7 @@ MMU_MapPages (MMU_HEAP *pMMUHeap,
 								SysPAddr.uiAddr,
 								uSize));
 
-	/* set the virtual and physical advance */
-	ui32VAdvance = pMMUHeap->ui32DataPageSize;
+	/* set the physical advance */
 	ui32PAdvance = pMMUHeap->ui32DataPageSize;
 
 #if defined(PDUMP)
@@ -3621,12 +3833,9 @@ MMU_MapPages (MMU_HEAP *pMMUHeap,
 		ui32PAdvance = 0;
 	}
 
-	for (uCount=0; uCount<uSize; uCount+=ui32VAdvance)
-	{
-		MMU_MapPage (pMMUHeap, DevVAddr, DevPAddr, ui32MemFlags);
-		DevVAddr.uiAddr += ui32VAdvance;
-		DevPAddr.uiAddr += ui32PAdvance;
-	}
+	MMU_MapPageRun (pMMUHeap, DevVAddr, DevPAddr,
+					(IMG_UINT32)((uSize + pMMUHeap->ui32DataPageSize - 1) >> pMMUHeap->ui32PTShift),
+					ui32PAdvance, ui32MemFlags);
 
 #if defined(PDUMP)
 	MMU_PDumpPageTables (pMMUHeap, MapBaseDevVAddr, uSize, IMG_FALSE, hUniqueTag);
@@ -3986,7 +4195,8 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 {
 	IMG_UINT32			uPageSize = psMMUHeap->ui32DataPageSize;
 	IMG_DEV_VIRTADDR	sTmpDevVAddr;
-	IMG_UINT32			i;
+	IMG_UINT32			i, j;
+	IMG_UINT32			ui32Count;
 	IMG_UINT32			ui32PDIndex;
 	IMG_UINT32			ui32PTIndex;
 	IMG_UINT32			*pui32Tmp;
@@ -3998,7 +4208,7 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 	/* setup tmp devvaddr to base of allocation */
 	sTmpDevVAddr = sDevVAddr;
 
-	for(i=0; i<ui32PageCount; i++)
+	for(i=0; i<ui32PageCount; i+=ui32Count)
 	{
 		MMU_PT_INFO **ppsPTInfoList;
 
@@ -4011,6 +4221,13 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 		/* find the index/offset of the first PT in the first PT page */
 		ui32PTIndex = (sTmpDevVAddr.uiAddr & psMMUHeap->ui32PTMask) >> psMMUHeap->ui32PTShift;
 
+		/* the part of the range that falls in this page table */
+		ui32Count = psMMUHeap->ui32PTNumEntriesUsable - ui32PTIndex;
+		if (ui32Count > ui32PageCount - i)
+		{
+			ui32Count = ui32PageCount - i;
+		}
+
 		/* Is the PT page valid? */
 		if ((!ppsPTInfoList[0]) && (!psMMUHeap->bHasSparseMappings))
 		{
@@ -4021,8 +4238,8 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 									ui32PDIndex,
 									ui32PTIndex));
 
-			/* advance the sTmpDevVAddr by one page */
-			sTmpDevVAddr.uiAddr += uPageSize;
+			/* advance the sTmpDevVAddr past this page table */
+			sTmpDevVAddr.uiAddr += ui32Count * uPageSize;
 
 			/* Try to unmap the remaining allocation pages */
 			continue;
@@ -4033,44 +4250,47 @@ MMU_UnmapPages (MMU_HEAP *psMMUHeap,
 		/* setup pointer to the first entry in the PT page */
 		pui32Tmp = (IMG_UINT32*)ppsPTInfoList[0]->PTPageCpuVAddr;
 
-		/* Decrement the valid page count only if the current page is valid*/
-		if (pui32Tmp[ui32PTIndex] & SGX_MMU_PTE_VALID)
-		{
-			ppsPTInfoList[0]->ui32ValidPTECount--;
-		}
-		else
+		MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
+		for (j=0; j<ui32Count; j++, ui32PTIndex++)
 		{
-			PVR_DPF((PVR_DBG_ERROR, "MMU_UnmapPages: Page is already invalid for alloc at VAddr:0x%08X (VAddrIni:0x%08X AllocPage:%u) PDIdx:%u PTIdx:%u",
-									sTmpDevVAddr.uiAddr,
-									sDevVAddr.uiAddr,
-									i,
-									ui32PDIndex,
-									ui32PTIndex));
-			PVR_DPF((PVR_DBG_ERROR, "MMU_UnmapPages: Page table entry value: 0x%08X", pui32Tmp[ui32PTIndex]));
-		}
+			/* Decrement the valid page count only if the current page is valid*/
+			if (pui32Tmp[ui32PTIndex] & SGX_MMU_PTE_VALID)
+			{
+				ppsPTInfoList[0]->ui32ValidPTECount--;
+			}
+			else
+			{
+				PVR_DPF((PVR_DBG_ERROR, "MMU_UnmapPages: Page is already invalid for alloc at VAddr:0x%08X (VAddrIni:0x%08X AllocPage:%u) PDIdx:%u PTIdx:%u",
+										sTmpDevVAddr.uiAddr + j * uPageSize,
+										sDevVAddr.uiAddr,
+										i + j,
+										ui32PDIndex,
+										ui32PTIndex));
+				PVR_DPF((PVR_DBG_ERROR, "MMU_UnmapPages: Page table entry value: 0x%08X", pui32Tmp[ui32PTIndex]));
+			}
 
-		/* The page table count should not go below zero */
-		PVR_ASSERT((IMG_INT32)ppsPTInfoList[0]->ui32ValidPTECount >= 0);
+			/* The page table count should not go below zero */
+			PVR_ASSERT((IMG_INT32)ppsPTInfoList[0]->ui32ValidPTECount >= 0);
 
-		MakeKernelPageReadWrite(ppsPTInfoList[0]->PTPageCpuVAddr);
 #if defined(SUPPORT_SGX_MMU_DUMMY_PAGE)
-		/* point the PT entry to the dummy data page */
-		pui32Tmp[ui32PTIndex] = (psMMUHeap->psMMUContext->psDevInfo->sDummyDataDevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
-								| SGX_MMU_PTE_VALID;
+			/* point the PT entry to the dummy data page */
+			pui32Tmp[ui32PTIndex] = (psMMUHeap->psMMUContext->psDevInfo->sDummyDataDevPAddr.uiAddr>>SGX_MMU_PTE_ADDR_ALIGNSHIFT)
+									| SGX_MMU_PTE_VALID;
 #else
-		/* invalidate entry */
+			/* invalidate entry */
 #if defined(FIX_HW_BRN_31620)
-		BRN31620InvalidatePageTableEntry(psMMUHeap->psMMUContext, ui32PDIndex, ui32PTIndex, &pui32Tmp[ui32PTIndex]);
+			BRN31620InvalidatePageTableEntry(psMMUHeap->psMMUContext, ui32PDIndex, ui32PTIndex, &pui32Tmp[ui32PTIndex]);
 #else
-		pui32Tmp[ui32PTIndex] = 0;
+			pui32Tmp[ui32PTIndex] = 0;
 #endif
 #endif
+		}
 		MakeKernelPageReadOnly(ppsPTInfoList[0]->PTPageCpuVAddr);
 
 		CheckPT(ppsPTInfoList[0]);
 
-		/* advance the sTmpDevVAddr by one page */
-		sTmpDevVAddr.uiAddr += uPageSize;
+		/* advance the sTmpDevVAddr past the pages unmapped */
+		sTmpDevVAddr.uiAddr += ui32Count * uPageSize;
 	}
 
 	MMU_InvalidatePageTableCache(psMMUHeap->psMMUContext->psDevInfo);
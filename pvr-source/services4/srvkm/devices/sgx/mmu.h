@@ -397,6 +397,28 @@ DisableHostAccess (MMU_CONTEXT *psMMUContext);
 ******************************************************************************/
 IMG_VOID MMU_InvalidateDirectoryCache(PVRSRV_SGXDEV_INFO *psDevInfo);
 
+/*
+******************************************************************************
+	FUNCTION:   MMU_PagePoolInit
+
+	PURPOSE:    Start pooling PD/PT pages and allocate the first few.
+
+	PARAMETERS: In:  psDevInfo - device info
+	RETURNS:
+******************************************************************************/
+IMG_VOID MMU_PagePoolInit(PVRSRV_SGXDEV_INFO *psDevInfo);
+
+/*
+******************************************************************************
+	FUNCTION:   MMU_PagePoolDeinit
+
+	PURPOSE:    Free the pooled PD/PT pages.
+
+	PARAMETERS: In:  psDevInfo - device info
+	RETURNS:
+******************************************************************************/
+IMG_VOID MMU_PagePoolDeinit(PVRSRV_SGXDEV_INFO *psDevInfo);
+
 /*
 ******************************************************************************
 	FUNCTION:   MMU_BIFResetPDAlloc
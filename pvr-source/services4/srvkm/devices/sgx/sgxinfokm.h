@@ -65,6 +65,32 @@ extern "C" {
 */
 #define SGX_PDUMPREG_NAME		"SGXREG"
 
+/*
+	Number of MMU page directory/table pages kept for reuse, and how many of
+	them are allocated up front at device init
+*/
+#if !defined(SGX_MMU_PAGE_POOL_SIZE)
+#define SGX_MMU_PAGE_POOL_SIZE		32
+#endif
+#if !defined(SGX_MMU_PAGE_POOL_PREFILL)
+#define SGX_MMU_PAGE_POOL_PREFILL	8
+#endif
+
+/*
+	Active power management: the idle latency is doubled, up to
+	1 << SGX_APM_LATENCY_MAX_SHIFT times the system value, each time SGX is
+	woken within SGX_APM_EARLY_WAKE_FACTOR latencies of an APM power down,
+	and halved again after a wake-up that is SGX_APM_LATE_WAKE_FACTOR
+	system latencies late.
+*/
+#define SGX_APM_LATENCY_MAX_SHIFT	3
+#define SGX_APM_EARLY_WAKE_FACTOR	4
+#define SGX_APM_LATE_WAKE_FACTOR	64
+
+/* Power-up latency histogram, bucket upper bounds in us (last is open) */
+#define SGX_POWERUP_HIST_BUCKETS	8
+#define SGX_POWERUP_HIST_BOUNDS		{ 100, 250, 500, 1000, 2500, 5000, 10000 }
+
 /****************************************************************************/
 /* kernel only structures: 													*/
 /****************************************************************************/
@@ -122,6 +148,13 @@ typedef struct _PVRSRV_SGXDEV_INFO_
 	IMG_UINT32				ui32CoreClockSpeed;
 	IMG_UINT32				ui32uKernelTimerClock;
 	IMG_BOOL				bSGXIdle;
+	IMG_BOOL				bAPMPoweredOff;			/*!< last power down came from APM */
+	IMG_UINT32				ui32APMPowerOffus;		/*!< OSClockus() at that power down */
+	IMG_UINT32				ui32APMLatencyShift;	/*!< APM latency = system latency << shift */
+	IMG_UINT32				ui32APMLatencyms;		/*!< APM latency currently programmed */
+	IMG_UINT32				ui32PowerUpStartus;		/*!< OSClockus() at the start of power up */
+	IMG_UINT32				aui32PowerUpHist[SGX_POWERUP_HIST_BUCKETS];	/*!< power up latency histogram */
+	IMG_UINT32				ui32PowerUpMaxus;		/*!< longest power up */
 
 	PVRSRV_STUB_PBDESC		*psStubPBDescListKM;
 
@@ -143,6 +176,14 @@ typedef struct _PVRSRV_SGXDEV_INFO_
 #endif /* PDUMP */
  	PVRSRV_KERNEL_MEM_INFO	*psKernelSGXMiscMemInfo;	/*!< kernel mode linear address of SGX misc info buffer */
 	IMG_UINT32				aui32HostKickAddr[SGXMKIF_CMD_MAX];		/*!< ukernel host kick offests */
+	IMG_UINT32				ui32KernelCCBFullCount;	/*!< submissions that found the kernel CCB full */
+	IMG_UINT32				ui32KernelCCBFullWaitus;	/*!< total time those waited for a slot */
+	IMG_BOOL				bCleanupInProgress;		/*!< a clean-up owns ui32CleanupStatus */
+#if defined(SGX_KICK_STATS)
+	IMG_UINT32				ui32KickCount;			/*!< TA kicks submitted through the bridge */
+	IMG_UINT32				ui32KickTotalus;		/*!< total CPU time spent in those kicks */
+	IMG_UINT32				ui32KickMaxus;			/*!< longest single kick */
+#endif
 #if defined(SGX_SUPPORT_HWPROFILING)
 	PPVRSRV_KERNEL_MEM_INFO psKernelHWProfilingMemInfo;
 #endif
@@ -206,6 +247,12 @@ typedef struct _PVRSRV_SGXDEV_INFO_
 	IMG_UINT32				*pui32BIFResetPD;
 	IMG_UINT32				*pui32BIFResetPT;
 
+	/* Write combined PD/PT pages kept for reuse across MMU contexts */
+	IMG_BOOL				bMMUPagePoolActive;
+	IMG_UINT32				ui32MMUPagePoolCount;
+	IMG_VOID				*apvMMUPagePoolCpuVAddr[SGX_MMU_PAGE_POOL_SIZE];
+	IMG_HANDLE				ahMMUPagePoolOSMemHandle[SGX_MMU_PAGE_POOL_SIZE];
+
 
 #if defined(SUPPORT_HW_RECOVERY)
 	/* Timeout callback handle */
@@ -217,6 +264,15 @@ typedef struct _PVRSRV_SGXDEV_INFO_
 	/* Number of SGX resets */
 	IMG_UINT32				ui32NumResets;
 
+	/* Hardware recovery statistics, times in us */
+	IMG_UINT32				ui32HWRCount;
+	IMG_UINT32				ui32HWRDumpsSkipped;
+	IMG_UINT32				ui32HWRLastDumpClock;	/* OSClockus() of the last full dump */
+	IMG_UINT32				ui32HWRLastDumpUs;
+	IMG_UINT32				ui32HWRLastResetUs;
+	IMG_UINT32				ui32HWRLastTotalUs;
+	IMG_UINT32				ui32HWRMaxTotalUs;
+
 	/* host control */
 	PVRSRV_KERNEL_MEM_INFO			*psKernelSGXHostCtlMemInfo;
 	SGXMKIF_HOST_CTL				*psSGXHostCtl;
@@ -334,9 +334,28 @@ static PVRSRV_ERROR SGXRunScript(PVRSRV_SGXDEV_INFO *psDevInfo, SGX_INIT_COMMAND
 		{
 			case SGX_INIT_OP_WRITE_HW_REG:
 			{
+#if defined(PDUMP)
 				OSWriteHWReg(psDevInfo->pvRegsBaseKM, psComm->sWriteHWReg.ui32Offset, psComm->sWriteHWReg.ui32Value);
 				PDUMPCOMMENT("SGXRunScript: Write HW reg operation");
 				PDUMPREG(SGX_PDUMPREG_NAME, psComm->sWriteHWReg.ui32Offset, psComm->sWriteHWReg.ui32Value);
+#else
+				/*
+					Scripts are mostly runs of writes: issue the whole run
+					and pay for one barrier instead of one per register.
+				*/
+				for (;;)
+				{
+					OSWriteHWRegRelaxed(psDevInfo->pvRegsBaseKM, psComm->sWriteHWReg.ui32Offset, psComm->sWriteHWReg.ui32Value);
+					if (ui32PC + 1 >= ui32NumInitCommands ||
+						psComm[1].eOp != SGX_INIT_OP_WRITE_HW_REG)
+					{
+						break;
+					}
+					ui32PC++;
+					psComm++;
+				}
+				OSWriteMemoryBarrier();
+#endif
 				break;
 			}
 			case SGX_INIT_OP_READ_HW_REG:
@@ -828,6 +847,11 @@ static PVRSRV_ERROR DevInitSGXPart1 (IMG_VOID *pvDeviceNode)
 		return eError;
 	}
 
+	if (psDeviceNode->psLocalDevMemArena == IMG_NULL)
+	{
+		MMU_PagePoolInit(psDevInfo);
+	}
+
 	return PVRSRV_OK;
 }
 
@@ -882,6 +906,193 @@ PVRSRV_ERROR SGXGetInfoForSrvinitKM(IMG_HANDLE hDevHandle, SGX_BRIDGE_INFO_FOR_S
 	return eError;
 }
 
+#if defined(SGX_HWPERF_PROC) && defined(__linux__) && defined(__KERNEL__)
+
+#include "proc.h"
+
+/*
+	/proc/pvr/sgx_hwperf drains the HWPerf circular buffer, one line per
+	entry, so a profiler can re-read it while SGXSetHWPerfStatus has
+	graphics events on and get a timeline of TA/3D starts and ends per
+	process. An entry is only consumed once seq_file asks for the one after
+	it, so entries that did not fit in a read are not lost. The count is
+	global: only one reader at a time, and the SGXReadHWPerfCB bridge call
+	competes for the same entries.
+*/
+static struct proc_dir_entry *g_psProcHWPerf = IMG_NULL;
+static IMG_UINT32 g_ui32ProcHWPerfConsumed;
+
+static SGXMKIF_HWPERF_CB *SGXProcHWPerfCB(struct seq_file *sfile)
+{
+	PVRSRV_DEVICE_NODE	*psDeviceNode = ((PVR_PROC_SEQ_HANDLERS *)sfile->private)->data;
+	PVRSRV_SGXDEV_INFO	*psDevInfo = psDeviceNode->pvDevice;
+
+	return psDevInfo->psKernelHWPerfCBMemInfo->pvLinAddrKM;
+}
+
+static void ProcSeqStartstopHWPerf(struct seq_file *sfile, IMG_BOOL start)
+{
+	PVR_UNREFERENCED_PARAMETER(sfile);
+
+	/* Serialise the read offset with the bridge call. */
+	if (start)
+	{
+		OSReacquireBridgeLock();
+	}
+	else
+	{
+		OSReleaseBridgeLock();
+	}
+}
+
+static void* ProcSeqOff2ElementHWPerf(struct seq_file *sfile, loff_t off)
+{
+	SGXMKIF_HWPERF_CB	*psHWPerfCB = SGXProcHWPerfCB(sfile);
+
+	if (!off)
+	{
+		g_ui32ProcHWPerfConsumed = 0;
+		return PVR_PROC_SEQ_START_TOKEN;
+	}
+
+	/* Everything before element off has been shown. */
+	while (g_ui32ProcHWPerfConsumed < off - 1 &&
+		   psHWPerfCB->ui32Woff != psHWPerfCB->ui32Roff)
+	{
+		psHWPerfCB->ui32Roff = (psHWPerfCB->ui32Roff + 1) & (SGXMKIF_HWPERF_CB_SIZE - 1);
+		g_ui32ProcHWPerfConsumed++;
+	}
+	/* The bridge call may have taken the rest. */
+	g_ui32ProcHWPerfConsumed = (IMG_UINT32)(off - 1);
+
+	if (psHWPerfCB->ui32Woff == psHWPerfCB->ui32Roff)
+	{
+		return IMG_NULL;
+	}
+
+	return &psHWPerfCB->psHWPerfCBData[psHWPerfCB->ui32Roff];
+}
+
+static void* ProcSeqNextHWPerf(struct seq_file *sfile, void* el, loff_t off)
+{
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	return ProcSeqOff2ElementHWPerf(sfile, off);
+}
+
+static void ProcSeqShowHWPerf(struct seq_file *sfile, void* el)
+{
+	PVRSRV_DEVICE_NODE		*psDeviceNode = ((PVR_PROC_SEQ_HANDLERS *)sfile->private)->data;
+	PVRSRV_SGXDEV_INFO		*psDevInfo = psDeviceNode->pvDevice;
+	SGXMKIF_HWPERF_CB_ENTRY	*psEntry = el;
+
+	if (el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile, "clock %uHz host %uus\n"
+						  "pid      frame    type       ordinal  info       clocksx16\n",
+				   psDevInfo->ui32CoreClockSpeed, OSClockus());
+		return;
+	}
+
+	seq_printf(sfile, "%-8u %-8u 0x%08x %-8u 0x%08x %u\n",
+			   psEntry->ui32PID,
+			   psEntry->ui32FrameNo,
+			   psEntry->ui32Type,
+			   psEntry->ui32Ordinal,
+			   psEntry->ui32Info,
+			   SGXConvertTimeStamp(psDevInfo, psEntry->ui32TimeWraps, psEntry->ui32Time));
+}
+
+static IMG_VOID SGXCreateProcHWPerf(PVRSRV_DEVICE_NODE *psDeviceNode)
+{
+	if (g_psProcHWPerf == IMG_NULL)
+	{
+		g_psProcHWPerf = CreateProcReadEntrySeq("sgx_hwperf",
+												psDeviceNode,
+												ProcSeqNextHWPerf,
+												ProcSeqShowHWPerf,
+												ProcSeqOff2ElementHWPerf,
+												ProcSeqStartstopHWPerf);
+		if (g_psProcHWPerf == IMG_NULL)
+		{
+			PVR_DPF((PVR_DBG_WARNING, "SGXCreateProcHWPerf: failed to create sgx_hwperf"));
+		}
+	}
+}
+
+static IMG_VOID SGXRemoveProcHWPerf(IMG_VOID)
+{
+	if (g_psProcHWPerf != IMG_NULL)
+	{
+		RemoveProcEntrySeq(g_psProcHWPerf);
+		g_psProcHWPerf = IMG_NULL;
+	}
+}
+
+#endif /* SGX_HWPERF_PROC && __linux__ && __KERNEL__ */
+
+#if defined(__linux__) && defined(__KERNEL__)
+
+#include "proc.h"
+
+/*
+	/proc/pvr/sgx_recovery shows how many hardware recoveries there were
+	and how long the last one stalled the GPU: debug dump, reset and
+	re-initialisation, and the whole time the power lock was held.
+*/
+static struct proc_dir_entry *g_psProcRecovery = IMG_NULL;
+
+static void ProcSeqShowRecovery(struct seq_file *sfile, void* el)
+{
+	PVRSRV_DEVICE_NODE	*psDeviceNode = ((PVR_PROC_SEQ_HANDLERS *)sfile->private)->data;
+	PVRSRV_SGXDEV_INFO	*psDevInfo = psDeviceNode->pvDevice;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	seq_printf(sfile, "recoveries %u\n"
+					  "dumps skipped %u\n"
+					  "host detected lockups %u\n"
+					  "last dump %uus\n"
+					  "last reset %uus\n"
+					  "last total %uus\n"
+					  "max total %uus\n",
+			   psDevInfo->ui32HWRCount,
+			   psDevInfo->ui32HWRDumpsSkipped,
+			   psDevInfo->psSGXHostCtl->ui32HostDetectedLockups,
+			   psDevInfo->ui32HWRLastDumpUs,
+			   psDevInfo->ui32HWRLastResetUs,
+			   psDevInfo->ui32HWRLastTotalUs,
+			   psDevInfo->ui32HWRMaxTotalUs);
+}
+
+static IMG_VOID SGXCreateProcRecovery(PVRSRV_DEVICE_NODE *psDeviceNode)
+{
+	if (g_psProcRecovery == IMG_NULL)
+	{
+		g_psProcRecovery = CreateProcReadEntrySeq("sgx_recovery",
+												  psDeviceNode,
+												  NULL,
+												  ProcSeqShowRecovery,
+												  ProcSeq1ElementOff2Element,
+												  NULL);
+		if (g_psProcRecovery == IMG_NULL)
+		{
+			PVR_DPF((PVR_DBG_WARNING, "SGXCreateProcRecovery: failed to create sgx_recovery"));
+		}
+	}
+}
+
+static IMG_VOID SGXRemoveProcRecovery(IMG_VOID)
+{
+	if (g_psProcRecovery != IMG_NULL)
+	{
+		RemoveProcEntrySeq(g_psProcRecovery);
+		g_psProcRecovery = IMG_NULL;
+	}
+}
+
+#endif /* __linux__ && __KERNEL__ */
+
 /*!
 *******************************************************************************
 
@@ -1025,6 +1236,14 @@ PVRSRV_ERROR DevInitSGXPart2KM (PVRSRV_PER_PROCESS_DATA *psPerProc,
 	PDUMPCOMMENT("Initialise Kernel CCB Event Kicker");
 	PDUMPMEM(IMG_NULL, psDevInfo->psKernelCCBEventKickerMemInfo, 0, sizeof(*psDevInfo->pui32KernelCCBEventKicker), PDUMP_FLAGS_CONTINUOUS, MAKEUNIQUETAG(psDevInfo->psKernelCCBEventKickerMemInfo));
 
+#if defined(SGX_HWPERF_PROC) && defined(__linux__) && defined(__KERNEL__)
+	SGXCreateProcHWPerf(psDeviceNode);
+#endif
+#if defined(__linux__) && defined(__KERNEL__)
+	SGXCreateProcClients();
+	SGXCreateProcRecovery(psDeviceNode);
+#endif
+
 	return PVRSRV_OK;
 
 failed_init_dev_info:
@@ -1061,6 +1280,14 @@ static PVRSRV_ERROR DevDeInitSGX (IMG_VOID *pvDeviceNode)
 		return PVRSRV_OK;
 	}
 
+#if defined(SGX_HWPERF_PROC) && defined(__linux__) && defined(__KERNEL__)
+	SGXRemoveProcHWPerf();
+#endif
+#if defined(__linux__) && defined(__KERNEL__)
+	SGXRemoveProcClients();
+	SGXRemoveProcRecovery();
+#endif
+
 #if defined(SUPPORT_HW_RECOVERY)
 	if (psDevInfo->hTimer)
 	{
@@ -1086,6 +1313,8 @@ static PVRSRV_ERROR DevDeInitSGX (IMG_VOID *pvDeviceNode)
 
 	MMU_BIFResetPDFree(psDevInfo);
 
+	MMU_PagePoolDeinit(psDevInfo);
+
 	/*
 		DeinitDevInfo the DevInfo
 	*/
@@ -1278,6 +1507,24 @@ IMG_VOID SGXDumpDebugInfo (PVRSRV_SGXDEV_INFO	*psDevInfo,
 
 	PVR_LOG(("SGX debug (%s)", PVRVERSION_STRING));
 
+	PVR_LOG(("SGX kernel CCB full: %u times, %uus waited",
+			 psDevInfo->ui32KernelCCBFullCount,
+			 psDevInfo->ui32KernelCCBFullWaitus));
+
+	PVR_LOG(("SGX APM latency %ums, power ups max %uus, hist %u %u %u %u %u %u %u %u",
+			 psDevInfo->ui32APMLatencyms, psDevInfo->ui32PowerUpMaxus,
+			 psDevInfo->aui32PowerUpHist[0], psDevInfo->aui32PowerUpHist[1],
+			 psDevInfo->aui32PowerUpHist[2], psDevInfo->aui32PowerUpHist[3],
+			 psDevInfo->aui32PowerUpHist[4], psDevInfo->aui32PowerUpHist[5],
+			 psDevInfo->aui32PowerUpHist[6], psDevInfo->aui32PowerUpHist[7]));
+
+#if defined(SGX_KICK_STATS)
+	PVR_LOG(("SGX kicks: %u, avg %uus, max %uus",
+			 psDevInfo->ui32KickCount,
+			 psDevInfo->ui32KickCount ? psDevInfo->ui32KickTotalus / psDevInfo->ui32KickCount : 0,
+			 psDevInfo->ui32KickMaxus));
+#endif
+
 	if (bDumpSGXRegs)
 	{
 		PVR_DPF((PVR_DBG_ERROR,"SGX Register Base Address (Linear):   0x%08X", (IMG_UINTPTR_T)psDevInfo->pvRegsBaseKM));
@@ -1558,6 +1805,15 @@ IMG_VOID SGXDumpDebugInfo (PVRSRV_SGXDEV_INFO	*psDevInfo,
 
 
 #if defined(SYS_USING_INTERRUPTS) || defined(SUPPORT_HW_RECOVERY)
+/*
+	The full debug dump goes to the kernel log a line at a time and takes
+	longer than the reset itself. After one, recoveries within this period
+	only log a line so clients are not held behind the console.
+*/
+#if !defined(SYS_SGX_HWRECOVERY_DUMP_PERIOD)
+#define SYS_SGX_HWRECOVERY_DUMP_PERIOD	60000000 /* 60 seconds */
+#endif
+
 /*!
 *******************************************************************************
 
@@ -1584,6 +1840,8 @@ IMG_VOID HWRecoveryResetSGX (PVRSRV_DEVICE_NODE *psDeviceNode,
 	PVRSRV_ERROR		eError;
 	PVRSRV_SGXDEV_INFO	*psDevInfo = (PVRSRV_SGXDEV_INFO*)psDeviceNode->pvDevice;
 	SGXMKIF_HOST_CTL	*psSGXHostCtl = (SGXMKIF_HOST_CTL *)psDevInfo->psSGXHostCtl;
+	IMG_UINT32			ui32StartClock;
+	IMG_UINT32			ui32ResetClock;
 	
 #if defined(SUPPORT_HWRECOVERY_TRACE_LIMIT)	
 	static IMG_UINT32	ui32Clockinus = 0;
@@ -1613,6 +1871,8 @@ IMG_VOID HWRecoveryResetSGX (PVRSRV_DEVICE_NODE *psDeviceNode,
 	psSGXHostCtl->ui32InterruptClearFlags |= PVRSRV_USSE_EDM_INTERRUPT_HWR;
 
 	PVR_LOG(("HWRecoveryResetSGX: SGX Hardware Recovery triggered"));
+
+	ui32StartClock = OSClockus();
 	
 #if defined(SUPPORT_HWRECOVERY_TRACE_LIMIT)	
 /*
@@ -1633,18 +1893,40 @@ IMG_VOID HWRecoveryResetSGX (PVRSRV_DEVICE_NODE *psDeviceNode,
 		ui32HWRecoveryCount = 0;
 	}
 #else	
-	SGXDumpDebugInfo(psDeviceNode->pvDevice, IMG_TRUE);
+	if ((psDevInfo->ui32HWRCount == 0) ||
+		((ui32StartClock - psDevInfo->ui32HWRLastDumpClock) >= SYS_SGX_HWRECOVERY_DUMP_PERIOD))
+	{
+		SGXDumpDebugInfo(psDeviceNode->pvDevice, IMG_TRUE);
+		psDevInfo->ui32HWRLastDumpClock = ui32StartClock;
+	}
+	else
+	{
+		PVR_LOG(("HWRecoveryResetSGX: debug dump skipped, last one %uus ago (KCCB WO:0x%X RO:0x%X)",
+				ui32StartClock - psDevInfo->ui32HWRLastDumpClock,
+				psDevInfo->psKernelCCBCtl->ui32WriteOffset,
+				psDevInfo->psKernelCCBCtl->ui32ReadOffset));
+		psDevInfo->ui32HWRDumpsSkipped++;
+	}
 #endif
 	
 	/* Suspend pdumping. */
 	PDUMPSUSPEND();
 
-	/* Reset and re-initialise SGX. */
+	/*
+		Reset and re-initialise SGX. Only the registers and the microkernel
+		are restarted: the kernel CCB, the host control and the MMU page
+		directories stay in memory, and the microkernel's own recovery
+		fails the render or transfer that hung and carries on with the
+		other contexts' queued work.
+	*/
+	ui32ResetClock = OSClockus();
 	eError = SGXInitialise(psDevInfo, IMG_TRUE);
 	if (eError != PVRSRV_OK)
 	{
 		PVR_DPF((PVR_DBG_ERROR,"HWRecoveryResetSGX: SGXInitialise failed (%d)", eError));
 	}
+	psDevInfo->ui32HWRLastResetUs = OSClockus() - ui32ResetClock;
+	psDevInfo->ui32HWRLastDumpUs = ui32ResetClock - ui32StartClock;
 
 	/* Resume pdumping. */
 	PDUMPRESUME();
@@ -1658,6 +1940,16 @@ IMG_VOID HWRecoveryResetSGX (PVRSRV_DEVICE_NODE *psDeviceNode,
 
 	/* Flush any old commands from the queues. */
 	PVRSRVProcessQueues(IMG_TRUE);
+
+	psDevInfo->ui32HWRLastTotalUs = OSClockus() - ui32StartClock;
+	if (psDevInfo->ui32HWRLastTotalUs > psDevInfo->ui32HWRMaxTotalUs)
+	{
+		psDevInfo->ui32HWRMaxTotalUs = psDevInfo->ui32HWRLastTotalUs;
+	}
+	psDevInfo->ui32HWRCount++;
+
+	PVR_LOG(("HWRecoveryResetSGX: recovered in %uus (reset %uus)",
+			psDevInfo->ui32HWRLastTotalUs, psDevInfo->ui32HWRLastResetUs));
 }
 #endif /* #if defined(SYS_USING_INTERRUPTS) || defined(SUPPORT_HW_RECOVERY) */
 
@@ -169,8 +169,10 @@ static PVRSRV_ERROR SGXUpdateTimingInfo(PVRSRV_DEVICE_NODE	*psDeviceNode)
 
 	if (psSGXTimingInfo->bEnableActivePM)
 	{
+		psDevInfo->ui32APMLatencyms =
+			psSGXTimingInfo->ui32ActivePowManLatencyms << psDevInfo->ui32APMLatencyShift;
 		ui32ActivePowManSampleRate =
-			psSGXTimingInfo->ui32uKernelFreq * psSGXTimingInfo->ui32ActivePowManLatencyms / 1000;
+			psSGXTimingInfo->ui32uKernelFreq * psDevInfo->ui32APMLatencyms / 1000;
 		/*
 			ui32ActivePowerCounter has the value 0 when SGX is not idle.
 			When SGX becomes idle, the value of ui32ActivePowerCounter is changed from 0 to ui32ActivePowManSampleRate.
@@ -183,6 +185,7 @@ static PVRSRV_ERROR SGXUpdateTimingInfo(PVRSRV_DEVICE_NODE	*psDeviceNode)
 	}
 	else
 	{
+		psDevInfo->ui32APMLatencyms = 0;
 		ui32ActivePowManSampleRate = 0;
 	}
 
@@ -277,6 +280,91 @@ static IMG_VOID SGXPollForClockGating (PVRSRV_SGXDEV_INFO	*psDevInfo,
 }
 
 
+/*!
+******************************************************************************
+
+ @Function	SGXAdaptActivePowerLatency
+
+ @Description
+
+	Called when SGX is powered up from off. If the last power down was
+	requested by the microkernel's active power management and SGX is needed
+	again soon after, the power down cost more than it saved, so lengthen the
+	idle latency; shorten it again once wake-ups come late.
+	SGXUpdateTimingInfo programs the result.
+
+ @Input	   psDevInfo : SGX Device Info
+
+ @Return   IMG_VOID :
+
+******************************************************************************/
+static IMG_VOID SGXAdaptActivePowerLatency(PVRSRV_SGXDEV_INFO	*psDevInfo)
+{
+	IMG_UINT32	ui32Offus;
+	IMG_UINT32	ui32BaseLatencyms;
+
+	if (!psDevInfo->bAPMPoweredOff || psDevInfo->ui32APMLatencyms == 0)
+	{
+		return;
+	}
+	psDevInfo->bAPMPoweredOff = IMG_FALSE;
+
+	ui32Offus = psDevInfo->ui32PowerUpStartus - psDevInfo->ui32APMPowerOffus;
+	ui32BaseLatencyms = psDevInfo->ui32APMLatencyms >> psDevInfo->ui32APMLatencyShift;
+
+	if (ui32Offus < psDevInfo->ui32APMLatencyms * 1000 * SGX_APM_EARLY_WAKE_FACTOR)
+	{
+		if (psDevInfo->ui32APMLatencyShift < SGX_APM_LATENCY_MAX_SHIFT)
+		{
+			psDevInfo->ui32APMLatencyShift++;
+		}
+	}
+	else if (ui32Offus > ui32BaseLatencyms * 1000 * SGX_APM_LATE_WAKE_FACTOR)
+	{
+		if (psDevInfo->ui32APMLatencyShift > 0)
+		{
+			psDevInfo->ui32APMLatencyShift--;
+		}
+	}
+}
+
+
+/*!
+******************************************************************************
+
+ @Function	SGXRecordPowerUp
+
+ @Description
+
+	Accounts the time since SGXPrePowerState started the power up from off.
+
+ @Input	   psDevInfo : SGX Device Info
+
+ @Return   IMG_VOID :
+
+******************************************************************************/
+static IMG_VOID SGXRecordPowerUp(PVRSRV_SGXDEV_INFO	*psDevInfo)
+{
+	static const IMG_UINT32	aui32Bounds[SGX_POWERUP_HIST_BUCKETS - 1] = SGX_POWERUP_HIST_BOUNDS;
+	IMG_UINT32	ui32Powerupus = OSClockus() - psDevInfo->ui32PowerUpStartus;
+	IMG_UINT32	i;
+
+	for (i = 0; i < SGX_POWERUP_HIST_BUCKETS - 1; i++)
+	{
+		if (ui32Powerupus < aui32Bounds[i])
+		{
+			break;
+		}
+	}
+	psDevInfo->aui32PowerUpHist[i]++;
+
+	if (ui32Powerupus > psDevInfo->ui32PowerUpMaxus)
+	{
+		psDevInfo->ui32PowerUpMaxus = ui32Powerupus;
+	}
+}
+
+
 /*!
 ******************************************************************************
 
@@ -297,6 +385,16 @@ PVRSRV_ERROR SGXPrePowerState (IMG_HANDLE				hDevHandle,
 							   PVRSRV_DEV_POWER_STATE	eNewPowerState,
 							   PVRSRV_DEV_POWER_STATE	eCurrentPowerState)
 {
+	if ((eNewPowerState == PVRSRV_DEV_POWER_STATE_ON) &&
+		(eCurrentPowerState == PVRSRV_DEV_POWER_STATE_OFF))
+	{
+		PVRSRV_DEVICE_NODE	*psDeviceNode = hDevHandle;
+		PVRSRV_SGXDEV_INFO	*psDevInfo = psDeviceNode->pvDevice;
+
+		/* Time the whole power up, including the system clock enable. */
+		psDevInfo->ui32PowerUpStartus = OSClockus();
+	}
+
 	if ((eNewPowerState != eCurrentPowerState) &&
 		(eNewPowerState != PVRSRV_DEV_POWER_STATE_ON))
 	{
@@ -420,6 +518,9 @@ PVRSRV_ERROR SGXPrePowerState (IMG_HANDLE				hDevHandle,
 
 		if (eNewPowerState == PVRSRV_DEV_POWER_STATE_OFF)
 		{
+			/* SGXPostActivePowerEvent sets this again for an APM power down. */
+			psDevInfo->bAPMPoweredOff = IMG_FALSE;
+
 			/* Finally, de-initialise some registers. */
 			eError = SGXDeinitialise(psDevInfo);
 			if (eError != PVRSRV_OK)
@@ -478,6 +579,8 @@ PVRSRV_ERROR SGXPostPowerState (IMG_HANDLE				hDevHandle,
 				Coming up from off, re-initialise SGX.
 			*/
 
+			SGXAdaptActivePowerLatency(psDevInfo);
+
 			/*
 				Re-generate the timing data required by SGX.
 			*/
@@ -498,6 +601,8 @@ PVRSRV_ERROR SGXPostPowerState (IMG_HANDLE				hDevHandle,
 				return eError;
 			}
 			powering_down = 0;
+
+			SGXRecordPowerUp(psDevInfo);
 		}
 		else
 		{
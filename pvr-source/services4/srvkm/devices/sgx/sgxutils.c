@@ -57,6 +57,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "pvr_debug.h"
 #include "sgxutils.h"
 #include "ttrace.h"
+#include "perproc.h"
+#include "lists.h"
 
 #ifdef __linux__
 #include <linux/kernel.h>	// sprintf
@@ -98,6 +100,10 @@ static IMG_VOID SGXPostActivePowerEvent(PVRSRV_DEVICE_NODE	* psDeviceNode,
 	/* Update the counter for stats. */
 	psSGXHostCtl->ui32NumActivePowerEvents++;
 
+	/* Lets SGXPostPowerState see how long SGX stayed off. */
+	psDevInfo->bAPMPoweredOff = IMG_TRUE;
+	psDevInfo->ui32APMPowerOffus = OSClockus();
+
 	if ((psSGXHostCtl->ui32PowerStatus & PVRSRV_USSE_EDM_POWMAN_POWEROFF_RESTART_IMMEDIATE) != 0)
 	{
 		PVR_DPF((PVR_DBG_MESSAGE, "SGXPostActivePowerEvent: SGX requests immediate restart"));
@@ -225,25 +231,41 @@ IMG_VOID SGXTestActivePowerEvent (PVRSRV_DEVICE_NODE	*psDeviceNode,
 
  PURPOSE	: Attempts to obtain a slot in the Kernel CCB
 
- PARAMETERS	: psCCB - the CCB
+ PARAMETERS	: psDevInfo - device info, for the CCB full statistics
+			  psCCB - the CCB
 
  RETURNS	: Address of space if available, IMG_NULL otherwise
 ******************************************************************************/
 #ifdef INLINE_IS_PRAGMA
 #pragma inline(SGXAcquireKernelCCBSlot)
 #endif
-static INLINE SGXMKIF_COMMAND * SGXAcquireKernelCCBSlot(PVRSRV_SGX_CCB_INFO *psCCB)
+static INLINE SGXMKIF_COMMAND * SGXAcquireKernelCCBSlot(PVRSRV_SGXDEV_INFO *psDevInfo,
+														PVRSRV_SGX_CCB_INFO *psCCB)
 {
+	IMG_UINT32 ui32Startus;
+
+	/* Nearly always a slot is free, keep the clock out of that path */
+	if(((*psCCB->pui32WriteOffset + 1) & 255) != *psCCB->pui32ReadOffset)
+	{
+		return &psCCB->psCommands[*psCCB->pui32WriteOffset];
+	}
+
+	psDevInfo->ui32KernelCCBFullCount++;
+	ui32Startus = OSClockus();
+
 	LOOP_UNTIL_TIMEOUT(MAX_HW_TIME_US)
 	{
+		OSSleepms(1);
+
 		if(((*psCCB->pui32WriteOffset + 1) & 255) != *psCCB->pui32ReadOffset)
 		{
+			psDevInfo->ui32KernelCCBFullWaitus += OSClockus() - ui32Startus;
 			return &psCCB->psCommands[*psCCB->pui32WriteOffset];
 		}
-
-		OSSleepms(1);
 	} END_LOOP_UNTIL_TIMEOUT();
 
+	psDevInfo->ui32KernelCCBFullWaitus += OSClockus() - ui32Startus;
+
 	/* Time out on waiting for CCB space */
 	return IMG_NULL;
 }
@@ -440,7 +462,7 @@ PVRSRV_ERROR SGXScheduleCCBCommand(PVRSRV_DEVICE_NODE	*psDeviceNode,
 #endif /* PDUMP */
 	psKernelCCB = psDevInfo->psKernelCCBInfo;
 
-	psSGXCommand = SGXAcquireKernelCCBSlot(psKernelCCB);
+	psSGXCommand = SGXAcquireKernelCCBSlot(psDevInfo, psKernelCCB);
 
 	/* Wait for CCB space timed out */
 	if(!psSGXCommand)
@@ -830,6 +852,24 @@ PVRSRV_ERROR SGXGetInternalDevInfoKM(IMG_HANDLE hDevCookie,
 }
 
 
+/*****************************************************************************
+ FUNCTION	: SGXCleanupBridgeYield
+
+ PURPOSE	: Sleep for a poll period with the bridge lock dropped, so other
+ 				processes' bridge calls are not held up behind a clean-up.
+
+ PARAMETERS	: None
+
+ RETURNS	: None
+*****************************************************************************/
+static IMG_VOID SGXCleanupBridgeYield(IMG_VOID)
+{
+	OSReleaseBridgeLock();
+	OSSleepms(1);
+	OSReacquireBridgeLock();
+}
+
+
 /*****************************************************************************
  FUNCTION	: SGXCleanupRequest
 
@@ -855,6 +895,15 @@ PVRSRV_ERROR SGXCleanupRequest(PVRSRV_DEVICE_NODE *psDeviceNode,
 
 	SGXMKIF_COMMAND		sCommand = {0};
 
+	/*
+		ui32CleanupStatus is shared by all clean-ups, and the bridge lock is
+		dropped while one is waiting for the ukernel, so take turns.
+	*/
+	while (psDevInfo->bCleanupInProgress)
+	{
+		SGXCleanupBridgeYield();
+	}
+	psDevInfo->bCleanupInProgress = IMG_TRUE;
 
 	if (bForceCleanup != FORCE_CLEANUP)
 	{
@@ -868,17 +917,24 @@ PVRSRV_ERROR SGXCleanupRequest(PVRSRV_DEVICE_NODE *psDeviceNode,
 				PVR_DPF((PVR_DBG_ERROR,"SGXCleanupRequest: Failed to submit clean-up command"));
 				SGXDumpDebugInfo(psDevInfo, IMG_FALSE);
 				PVR_DBG_BREAK;
+				psDevInfo->bCleanupInProgress = IMG_FALSE;
 				return eError;
 		}
 		
 		/* Wait for the uKernel process the cleanup request */
 		#if !defined(NO_HARDWARE)
-		if(PollForValueKM(&psHostCtl->ui32CleanupStatus,
-						  PVRSRV_USSE_EDM_CLEANUPCMD_COMPLETE,
-						  PVRSRV_USSE_EDM_CLEANUPCMD_COMPLETE,
-						  10 * MAX_HW_TIME_US,
-						  1000,
-						  IMG_TRUE) != PVRSRV_OK)
+		eError = PVRSRV_ERROR_TIMEOUT;
+		LOOP_UNTIL_TIMEOUT(10 * MAX_HW_TIME_US)
+		{
+			if (psHostCtl->ui32CleanupStatus & PVRSRV_USSE_EDM_CLEANUPCMD_COMPLETE)
+			{
+				eError = PVRSRV_OK;
+				break;
+			}
+			SGXCleanupBridgeYield();
+		} END_LOOP_UNTIL_TIMEOUT();
+
+		if (eError != PVRSRV_OK)
 		{
 			PVR_DPF((PVR_DBG_ERROR,"SGXCleanupRequest: Wait for uKernel to clean up (%u) failed", ui32CleanupType));
 			eError = PVRSRV_ERROR_TIMEOUT;
@@ -909,6 +965,7 @@ PVRSRV_ERROR SGXCleanupRequest(PVRSRV_DEVICE_NODE *psDeviceNode,
 	
 		if (eError != PVRSRV_OK)
 		{
+			psDevInfo->bCleanupInProgress = IMG_FALSE;
 			return eError;
 		}
 	}
@@ -934,10 +991,326 @@ PVRSRV_ERROR SGXCleanupRequest(PVRSRV_DEVICE_NODE *psDeviceNode,
 #else
 	psDevInfo->ui32CacheControl |= SGXMKIF_CC_INVAL_DATA;
 #endif
+	psDevInfo->bCleanupInProgress = IMG_FALSE;
 	return eError;
 }
 
 
+/*
+	Scheduling classes. The client driver sets a context's priority through
+	SGXSet*ContextPriorityKM, naming the offset of the priority word in its
+	microcode context, which is all the kernel knows of that layout. The
+	offset and the requested value are kept with the context so the class
+	of the owning process can bound the request, and be re-applied to the
+	live contexts when the window manager moves the process to another
+	class: the compositor always runs high, foreground apps are capped at
+	medium so they never outrank it, background apps run low. Everything
+	here is serialised by the bridge lock.
+*/
+typedef struct _SGX_CONTEXT_PRIORITY_
+{
+	PVRSRV_KERNEL_MEM_INFO	*psMemInfo;
+	IMG_UINT32				ui32PID;
+	IMG_BOOL				bTransfer;
+	IMG_BOOL				bPrioritySet;
+	IMG_UINT32				ui32Offset;
+	IMG_UINT32				ui32Requested;
+	IMG_UINT32				ui32Applied;
+	struct _SGX_CONTEXT_PRIORITY_ *psNext;
+	struct _SGX_CONTEXT_PRIORITY_ **ppsThis;
+} SGX_CONTEXT_PRIORITY;
+
+static IMPLEMENT_LIST_INSERT(SGX_CONTEXT_PRIORITY)
+static IMPLEMENT_LIST_REMOVE(SGX_CONTEXT_PRIORITY)
+
+static SGX_CONTEXT_PRIORITY *g_psContextPriorities = IMG_NULL;
+
+static const IMG_CHAR *g_apszPriorityClass[SGX_PRIORITY_CLASS_COUNT] =
+{
+	"default", "compositor", "foreground", "background"
+};
+
+static IMG_UINT32 SGXClassPriority(IMG_UINT32 ui32PID, IMG_UINT32 ui32Requested)
+{
+	PVRSRV_PER_PROCESS_DATA *psPerProc = PVRSRVPerProcessData(ui32PID);
+
+	switch (psPerProc ? psPerProc->ui32PriorityClass : SGX_PRIORITY_CLASS_DEFAULT)
+	{
+		case SGX_PRIORITY_CLASS_COMPOSITOR:
+			return SGX_CONTEXT_PRIORITY_HIGH;
+		case SGX_PRIORITY_CLASS_FOREGROUND:
+			return MIN(ui32Requested, SGX_CONTEXT_PRIORITY_MEDIUM);
+		case SGX_PRIORITY_CLASS_BACKGROUND:
+			return SGX_CONTEXT_PRIORITY_LOW;
+		default:
+			return ui32Requested;
+	}
+}
+
+static PVRSRV_ERROR SGXWriteContextPriority(SGX_CONTEXT_PRIORITY *psPriority,
+											IMG_UINT32 ui32Priority,
+											IMG_UINT32 ui32OffsetOfPriorityField)
+{
+	IMG_UINT8 *pSrc;
+	IMG_UINT8 *pDst;
+	int iPtrByte;
+
+	if ((ui32OffsetOfPriorityField + sizeof(ui32Priority))
+		>= psPriority->psMemInfo->uAllocSize)
+	{
+		PVR_DPF((PVR_DBG_ERROR,
+				 "SGXWriteContextPriority: invalid %s context priority offset",
+				 psPriority->bTransfer ? "transfer" : "render"));
+
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+
+	psPriority->bPrioritySet = IMG_TRUE;
+	psPriority->ui32Offset = ui32OffsetOfPriorityField;
+	psPriority->ui32Requested = ui32Priority;
+	psPriority->ui32Applied = SGXClassPriority(psPriority->ui32PID, ui32Priority);
+
+	/*
+	   cannot be sure that offset (passed from user-land) is safe to deref
+	   as a word-ptr on current CPU arch: copy one byte at a time.
+	 */
+	pDst = (IMG_UINT8 *)psPriority->psMemInfo->pvLinAddrKM;
+	pDst += ui32OffsetOfPriorityField;
+	pSrc = (IMG_UINT8 *)&psPriority->ui32Applied;
+
+	for (iPtrByte = 0; iPtrByte < sizeof(psPriority->ui32Applied); iPtrByte++)
+	{
+		pDst[iPtrByte] = pSrc[iPtrByte];
+	}
+
+	return PVRSRV_OK;
+}
+
+static IMG_VOID SGXInitContextPriority(SGX_CONTEXT_PRIORITY *psPriority,
+									   PVRSRV_KERNEL_MEM_INFO *psMemInfo,
+									   IMG_UINT32 ui32PID,
+									   IMG_BOOL bTransfer)
+{
+	psPriority->psMemInfo = psMemInfo;
+	psPriority->ui32PID = ui32PID;
+	psPriority->bTransfer = bTransfer;
+	psPriority->bPrioritySet = IMG_FALSE;
+	List_SGX_CONTEXT_PRIORITY_Insert(&g_psContextPriorities, psPriority);
+}
+
+/*!
+******************************************************************************
+
+ @Function	SGXSetPriorityClassKM
+
+ @Description
+
+ Moves a process to another scheduling class and re-applies the class to
+ the priority of every context it has set one on.
+
+ @Input ui32PID - process ID
+ @Input ui32Class - SGX_PRIORITY_CLASS_*
+
+ @Return PVRSRV_ERROR
+
+******************************************************************************/
+PVRSRV_ERROR SGXSetPriorityClassKM(IMG_UINT32 ui32PID, IMG_UINT32 ui32Class)
+{
+	PVRSRV_PER_PROCESS_DATA *psPerProc;
+	SGX_CONTEXT_PRIORITY *psPriority;
+
+	if (ui32Class >= SGX_PRIORITY_CLASS_COUNT)
+	{
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+
+	psPerProc = PVRSRVPerProcessData(ui32PID);
+	if (psPerProc == IMG_NULL)
+	{
+		return PVRSRV_ERROR_INVALID_PARAMS;
+	}
+	psPerProc->ui32PriorityClass = ui32Class;
+
+	for (psPriority = g_psContextPriorities; psPriority; psPriority = psPriority->psNext)
+	{
+		if (psPriority->ui32PID == ui32PID && psPriority->bPrioritySet)
+		{
+			SGXWriteContextPriority(psPriority, psPriority->ui32Requested,
+									psPriority->ui32Offset);
+		}
+	}
+
+	return PVRSRV_OK;
+}
+
+#if defined(__linux__) && defined(__KERNEL__)
+
+#include "proc.h"
+#include "pvr_uaccess.h"
+
+/*
+	/proc/pvr/sgx_clients lists the HW render and transfer contexts with
+	their owner's class and kick counts. Writing "<pid> <class>" moves a
+	process to a class by name. GPU time per process is not counted here:
+	sgx_hwperf has the TA/3D start and end events per PID for that.
+*/
+static struct proc_dir_entry *g_psProcClients = IMG_NULL;
+
+static void ProcSeqStartstopClients(struct seq_file *sfile, IMG_BOOL start)
+{
+	PVR_UNREFERENCED_PARAMETER(sfile);
+
+	if (start)
+	{
+		OSReacquireBridgeLock();
+	}
+	else
+	{
+		OSReleaseBridgeLock();
+	}
+}
+
+static void* ProcSeqOff2ElementClients(struct seq_file *sfile, loff_t off)
+{
+	SGX_CONTEXT_PRIORITY *psPriority;
+
+	PVR_UNREFERENCED_PARAMETER(sfile);
+
+	if (!off)
+	{
+		return PVR_PROC_SEQ_START_TOKEN;
+	}
+
+	for (psPriority = g_psContextPriorities; psPriority && --off; psPriority = psPriority->psNext)
+	{
+	}
+
+	return psPriority;
+}
+
+static void* ProcSeqNextClients(struct seq_file *sfile, void* el, loff_t off)
+{
+	PVR_UNREFERENCED_PARAMETER(sfile);
+	PVR_UNREFERENCED_PARAMETER(off);
+
+	if (el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		return g_psContextPriorities;
+	}
+
+	return ((SGX_CONTEXT_PRIORITY *)el)->psNext;
+}
+
+static void ProcSeqShowClients(struct seq_file *sfile, void* el)
+{
+	SGX_CONTEXT_PRIORITY *psPriority = el;
+	PVRSRV_PER_PROCESS_DATA *psPerProc;
+
+	if (el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile, "pid      context  class      requested applied  kicks    transfers\n");
+		return;
+	}
+
+	psPerProc = PVRSRVPerProcessData(psPriority->ui32PID);
+	if (psPerProc == IMG_NULL)
+	{
+		return;
+	}
+
+	if (psPriority->bPrioritySet)
+	{
+		seq_printf(sfile, "%-8u %-8s %-10s %-9u %-8u %-8u %u\n",
+				   psPriority->ui32PID,
+				   psPriority->bTransfer ? "transfer" : "render",
+				   g_apszPriorityClass[psPerProc->ui32PriorityClass],
+				   psPriority->ui32Requested,
+				   psPriority->ui32Applied,
+				   psPerProc->ui32KickCount,
+				   psPerProc->ui32TransferKickCount);
+	}
+	else
+	{
+		seq_printf(sfile, "%-8u %-8s %-10s %-9s %-8s %-8u %u\n",
+				   psPriority->ui32PID,
+				   psPriority->bTransfer ? "transfer" : "render",
+				   g_apszPriorityClass[psPerProc->ui32PriorityClass],
+				   "-", "-",
+				   psPerProc->ui32KickCount,
+				   psPerProc->ui32TransferKickCount);
+	}
+}
+
+static IMG_INT ProcSetClientClass(struct file *file, const IMG_CHAR *buffer, IMG_UINT32 count, IMG_VOID *data)
+{
+	IMG_CHAR szBuf[32];
+	IMG_CHAR szClass[16];
+	IMG_UINT32 ui32PID;
+	IMG_UINT32 ui32Class;
+	PVRSRV_ERROR eError;
+
+	PVR_UNREFERENCED_PARAMETER(file);
+	PVR_UNREFERENCED_PARAMETER(data);
+
+	if (count == 0 || count >= sizeof(szBuf))
+	{
+		return -EINVAL;
+	}
+	if (pvr_copy_from_user(szBuf, (const void __user *)buffer, count))
+	{
+		return -EFAULT;
+	}
+	szBuf[count] = '\0';
+
+	if (sscanf(szBuf, "%u %15s", &ui32PID, szClass) != 2)
+	{
+		return -EINVAL;
+	}
+
+	for (ui32Class = 0; ui32Class < SGX_PRIORITY_CLASS_COUNT; ui32Class++)
+	{
+		if (strcmp(szClass, g_apszPriorityClass[ui32Class]) == 0)
+		{
+			break;
+		}
+	}
+
+	OSReacquireBridgeLock();
+	eError = SGXSetPriorityClassKM(ui32PID, ui32Class);
+	OSReleaseBridgeLock();
+
+	return (eError == PVRSRV_OK) ? (IMG_INT)count : -EINVAL;
+}
+
+IMG_VOID SGXCreateProcClients(IMG_VOID)
+{
+	if (g_psProcClients == IMG_NULL)
+	{
+		g_psProcClients = CreateProcEntrySeq("sgx_clients",
+											 IMG_NULL,
+											 ProcSeqNextClients,
+											 ProcSeqShowClients,
+											 ProcSeqOff2ElementClients,
+											 ProcSeqStartstopClients,
+											 (IMG_VOID*)ProcSetClientClass);
+		if (g_psProcClients == IMG_NULL)
+		{
+			PVR_DPF((PVR_DBG_WARNING, "SGXCreateProcClients: failed to create sgx_clients"));
+		}
+	}
+}
+
+IMG_VOID SGXRemoveProcClients(IMG_VOID)
+{
+	if (g_psProcClients != IMG_NULL)
+	{
+		RemoveProcEntrySeq(g_psProcClients);
+		g_psProcClients = IMG_NULL;
+	}
+}
+
+#endif /* __linux__ && __KERNEL__ */
+
 typedef struct _SGX_HW_RENDER_CONTEXT_CLEANUP_
 {
 	PVRSRV_DEVICE_NODE *psDeviceNode;
@@ -946,6 +1319,7 @@ typedef struct _SGX_HW_RENDER_CONTEXT_CLEANUP_
 	PRESMAN_ITEM psResItem;
 	IMG_BOOL bCleanupTimerRunning;
 	IMG_PVOID pvTimeData;
+	SGX_CONTEXT_PRIORITY sPriority;
 } SGX_HW_RENDER_CONTEXT_CLEANUP;
 
 
@@ -990,6 +1364,8 @@ static PVRSRV_ERROR SGXCleanupHWRenderContextCallback(IMG_PVOID		pvParam,
 
 	if (eError != PVRSRV_ERROR_RETRY)
 	{
+		List_SGX_CONTEXT_PRIORITY_Remove(&psCleanup->sPriority);
+
 	    /* Free the Device Mem allocated */
 	    PVRSRVFreeDeviceMemKM(psCleanup->psDeviceNode,
 	            psCleanup->psHWRenderContextMemInfo);
@@ -1013,6 +1389,7 @@ typedef struct _SGX_HW_TRANSFER_CONTEXT_CLEANUP_
 	PRESMAN_ITEM psResItem;
 	IMG_BOOL bCleanupTimerRunning;
 	IMG_PVOID pvTimeData;
+	SGX_CONTEXT_PRIORITY sPriority;
 } SGX_HW_TRANSFER_CONTEXT_CLEANUP;
 
 
@@ -1057,6 +1434,8 @@ static PVRSRV_ERROR SGXCleanupHWTransferContextCallback(IMG_PVOID	pvParam,
 
 	if (eError != PVRSRV_ERROR_RETRY)
 	{
+		List_SGX_CONTEXT_PRIORITY_Remove(&psCleanup->sPriority);
+
 	    /* Free the Device Mem allocated */
 	    PVRSRVFreeDeviceMemKM(psCleanup->psDeviceNode,
 	            psCleanup->psHWTransferContextMemInfo);
@@ -1214,6 +1593,11 @@ IMG_HANDLE SGXRegisterHWRenderContextKM(IMG_HANDLE				hDeviceNode,
 
 	psCleanup->psResItem = psResItem;
 
+	SGXInitContextPriority(&psCleanup->sPriority,
+						   psCleanup->psHWRenderContextMemInfo,
+						   psPerProc->ui32PID,
+						   IMG_FALSE);
+
 	return (IMG_HANDLE)psCleanup;
 
 /* Error exit paths */
@@ -1395,6 +1779,11 @@ IMG_HANDLE SGXRegisterHWTransferContextKM(IMG_HANDLE				hDeviceNode,
 
 	psCleanup->psResItem = psResItem;
 
+	SGXInitContextPriority(&psCleanup->sPriority,
+						   psCleanup->psHWTransferContextMemInfo,
+						   psPerProc->ui32PID,
+						   IMG_TRUE);
+
 	return (IMG_HANDLE)psCleanup;
 
 /* Error exit paths */
@@ -1441,37 +1830,15 @@ PVRSRV_ERROR SGXSetTransferContextPriorityKM(
                 IMG_UINT32 ui32OffsetOfPriorityField)
 {
 	SGX_HW_TRANSFER_CONTEXT_CLEANUP *psCleanup;
-    IMG_UINT8 *pSrc;
-    IMG_UINT8 *pDst;
-    int iPtrByte;
 	PVR_UNREFERENCED_PARAMETER(hDeviceNode);
 
     if (hHWTransferContext != IMG_NULL)
     {
         psCleanup = (SGX_HW_TRANSFER_CONTEXT_CLEANUP *)hHWTransferContext;
 
-        if ((ui32OffsetOfPriorityField + sizeof(ui32Priority)) 
-            >= psCleanup->psHWTransferContextMemInfo->uAllocSize)
-        {
-            PVR_DPF((
-                PVR_DBG_ERROR, 
-                "SGXSetTransferContextPriorityKM: invalid context prioirty offset"));
-
-            return PVRSRV_ERROR_INVALID_PARAMS;
-        }
-
-        /*
-           cannot be sure that offset (passed from user-land) is safe to deref
-           as a word-ptr on current CPU arch: copy one byte at a time.
-         */
-        pDst = (IMG_UINT8 *)psCleanup->psHWTransferContextMemInfo->pvLinAddrKM;
-        pDst += ui32OffsetOfPriorityField;
-        pSrc = (IMG_UINT8 *)&ui32Priority;
-
-        for (iPtrByte = 0; iPtrByte < sizeof(ui32Priority); iPtrByte++)
-        {
-            pDst[iPtrByte] = pSrc[iPtrByte];
-        }
+        return SGXWriteContextPriority(&psCleanup->sPriority,
+                                       ui32Priority,
+                                       ui32OffsetOfPriorityField);
     }
     return PVRSRV_OK;
 }
@@ -1484,37 +1851,15 @@ PVRSRV_ERROR SGXSetRenderContextPriorityKM(
                 IMG_UINT32 ui32OffsetOfPriorityField)
 {
 	SGX_HW_RENDER_CONTEXT_CLEANUP *psCleanup;
-    IMG_UINT8 *pSrc;
-    IMG_UINT8 *pDst;
-    int iPtrByte;
 	PVR_UNREFERENCED_PARAMETER(hDeviceNode);
 
     if (hHWRenderContext != IMG_NULL)
     {
         psCleanup = (SGX_HW_RENDER_CONTEXT_CLEANUP *)hHWRenderContext;
-        if ((ui32OffsetOfPriorityField + sizeof(ui32Priority)) 
-            >= psCleanup->psHWRenderContextMemInfo->uAllocSize)
-        {
-            PVR_DPF((
-                PVR_DBG_ERROR, 
-                "SGXSetContextPriorityKM: invalid HWRenderContext prioirty offset"));
-
-            return PVRSRV_ERROR_INVALID_PARAMS;
-        }
-
-        /*
-           cannot be sure that offset (passed from user-land) is safe to deref
-           as a word-ptr on current CPU arch: copy one byte at a time.
-         */
-        pDst = (IMG_UINT8 *)psCleanup->psHWRenderContextMemInfo->pvLinAddrKM;
-        pDst += ui32OffsetOfPriorityField;
-
-        pSrc = (IMG_UINT8 *)&ui32Priority;
-
-        for (iPtrByte = 0; iPtrByte < sizeof(ui32Priority); iPtrByte++)
-        {
-            pDst[iPtrByte] = pSrc[iPtrByte];
-        }
+
+        return SGXWriteContextPriority(&psCleanup->sPriority,
+                                       ui32Priority,
+                                       ui32OffsetOfPriorityField);
     }
     return PVRSRV_OK;
 }
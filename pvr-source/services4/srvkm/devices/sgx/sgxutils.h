@@ -123,6 +123,25 @@ PVRSRV_ERROR SGXSetTransferContextPriorityKM(IMG_HANDLE       hDeviceNode,
                                              IMG_UINT32       ui32Priority,
                                              IMG_UINT32       ui32OffsetOfPriorityField);
 
+/* Context priority words as the client driver writes them */
+#define SGX_CONTEXT_PRIORITY_LOW		0
+#define SGX_CONTEXT_PRIORITY_MEDIUM		1
+#define SGX_CONTEXT_PRIORITY_HIGH		2
+
+/* Per process scheduling classes, bounding the context priorities above */
+#define SGX_PRIORITY_CLASS_DEFAULT		0
+#define SGX_PRIORITY_CLASS_COMPOSITOR	1
+#define SGX_PRIORITY_CLASS_FOREGROUND	2
+#define SGX_PRIORITY_CLASS_BACKGROUND	3
+#define SGX_PRIORITY_CLASS_COUNT		4
+
+PVRSRV_ERROR SGXSetPriorityClassKM(IMG_UINT32 ui32PID, IMG_UINT32 ui32Class);
+
+#if defined(__linux__) && defined(__KERNEL__)
+IMG_VOID SGXCreateProcClients(IMG_VOID);
+IMG_VOID SGXRemoveProcClients(IMG_VOID);
+#endif
+
 #if defined(SGX_FEATURE_2D_HARDWARE)
 IMG_IMPORT
 IMG_HANDLE SGXRegisterHW2DContextKM(IMG_HANDLE				psDeviceNode,
@@ -48,6 +48,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #if defined(PVR_LINUX_MISR_USING_WORKQUEUE) || defined(PVR_LINUX_MISR_USING_PRIVATE_WORKQUEUE)
 #include <linux/workqueue.h>
 #endif
+#if defined(PVR_LINUX_MISR_USING_KTHREAD)
+#include <linux/sched.h>
+#include <linux/wait.h>
+#endif
 
 /* 
  *	Env data specific to linux - convenient place to put this
@@ -81,6 +85,11 @@ typedef struct _ENV_DATA_TAG
 #else
 	struct tasklet_struct	sMISRTasklet;
 #endif
+#if defined(PVR_LINUX_MISR_USING_KTHREAD)
+	struct task_struct	*psMISRThread;
+	wait_queue_head_t	sMISRWaitQueue;
+	atomic_t		sMISRPending;
+#endif
 #if defined (SUPPORT_ION)
 	IMG_HANDLE		hIonHeaps;
 	IMG_HANDLE		hIonDev;
@@ -348,8 +348,20 @@ PVRSRV_ERROR LinuxEventObjectSignal(IMG_HANDLE hOSEventObjectList)
 
 		psLinuxEventObject = (PVRSRV_LINUX_EVENT_OBJECT *)list_entry(psListEntry, PVRSRV_LINUX_EVENT_OBJECT, sList);	
 		
-		atomic_inc(&psLinuxEventObject->sTimeStamp);	
-	 	wake_up_interruptible(&psLinuxEventObject->sWait);
+		atomic_inc(&psLinuxEventObject->sTimeStamp);
+
+		/*
+		 * Only touch the wait queue of an object somebody is sleeping
+		 * on; most processes are not waiting when the MISR signals.
+		 * The barrier orders the timestamp update against the check,
+		 * pairing with the one in prepare_to_wait, so a waiter either
+		 * sees the new timestamp or is seen here.
+		 */
+		smp_mb();
+		if (waitqueue_active(&psLinuxEventObject->sWait))
+		{
+			wake_up_interruptible(&psLinuxEventObject->sWait);
+		}
 	}
 	read_unlock(&psLinuxEventObjectList->sLock);
 
@@ -381,7 +393,30 @@ PVRSRV_ERROR LinuxEventObjectWait(IMG_HANDLE hOSEventObject, IMG_UINT32 ui32MSTi
 	PVRSRV_LINUX_EVENT_OBJECT *psLinuxEventObject = (PVRSRV_LINUX_EVENT_OBJECT *) hOSEventObject;
 
 	IMG_UINT32 ui32TimeOutJiffies = msecs_to_jiffies(ui32MSTimeout);
-	
+
+#if defined(PVRSRV_EVENT_OBJECT_SPIN_US) && (PVRSRV_EVENT_OBJECT_SPIN_US > 0)
+	/*
+	 * Events often follow the wait within a few microseconds (the GPU
+	 * finishing a short job), so poll briefly before paying for a sleep
+	 * and wakeup.
+	 */
+	if ((IMG_UINT32)atomic_read(&psLinuxEventObject->sTimeStamp) == psLinuxEventObject->ui32TimeStampPrevious)
+	{
+		IMG_UINT32 i;
+
+		LinuxUnLockBridge();
+		for (i = 0; i < PVRSRV_EVENT_OBJECT_SPIN_US; i++)
+		{
+			if ((IMG_UINT32)atomic_read(&psLinuxEventObject->sTimeStamp) != psLinuxEventObject->ui32TimeStampPrevious)
+			{
+				break;
+			}
+			udelay(1);
+		}
+		LinuxLockBridge();
+	}
+#endif
+
 	do	
 	{
 		prepare_to_wait(&psLinuxEventObject->sWait, &sWait, TASK_INTERRUPTIBLE);
@@ -392,11 +427,11 @@ PVRSRV_ERROR LinuxEventObjectWait(IMG_HANDLE hOSEventObject, IMG_UINT32 ui32MSTi
 			break;
 		}
 
-		LinuxUnLockMutex(&gPVRSRVLock);		
+		LinuxUnLockBridge();
 
 		ui32TimeOutJiffies = (IMG_UINT32)schedule_timeout((IMG_INT32)ui32TimeOutJiffies);
 		
-		LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+		LinuxLockBridge();
 #if defined(DEBUG)
 		psLinuxEventObject->ui32Stats++;
 #endif			
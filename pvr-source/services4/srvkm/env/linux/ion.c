@@ -74,12 +74,20 @@ int PVRSRVExportFDToIONHandles(int fd, struct ion_client **client,
 	int ret = -EINVAL;
 
 	/* Take the bridge mutex so the handle won't be freed underneath us */
-	LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+	LinuxLockBridge();
 
 	psFile = fget(fd);
 	if(!psFile)
 		goto err_unlock;
 
+	/* Any fd can be passed in here; don't trust private_data on others */
+	if(!PVRSRVIsServicesFile(psFile))
+	{
+		PVR_DPF((PVR_DBG_ERROR, "%s: fd %d is not a services connection",
+								__func__, fd));
+		goto err_fput;
+	}
+
 	psPrivateData = psFile->private_data;
 	if(!psPrivateData)
 	{
@@ -140,7 +148,7 @@ err_fput:
 	fput(psFile);
 err_unlock:
 	/* Allow PVRSRV clients to communicate with srvkm again */
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockBridge();
 
 	return ret;
 }
@@ -290,37 +298,26 @@ PVRSRV_ERROR IonImportBufferAndAquirePhysAddr(IMG_HANDLE hIonDev,
 	}
 
 	/*
-		We do a two pass process, 1st workout how many pages there
-		are, 2nd fill in the data.
+		The scatterlist covers the whole buffer, so its size bounds the
+		page list and the list can be filled in a single walk. Entries
+		from contiguous heaps span several pages.
 	*/
-	for (i=0;i<2;i++)
+	i = PAGE_ALIGN(psIonHandle->buffer->size) >> PAGE_SHIFT;
+	pasSysPhysAddr = kmalloc(sizeof(IMG_SYS_PHYADDR) * i, GFP_KERNEL);
+	if (pasSysPhysAddr == NULL)
 	{
-		psTemp = psScatterList;
-		if (i == 1)
-		{
-			pasSysPhysAddr = kmalloc(sizeof(IMG_SYS_PHYADDR) * ui32PageCount, GFP_KERNEL);
-			if (pasSysPhysAddr == NULL)
-			{
-				eError = PVRSRV_ERROR_OUT_OF_MEMORY;
-				goto exitFailAlloc;
-			}
-			ui32PageCount = 0;	/* Reset the page count a we use if for the index */
-		}
+		eError = PVRSRV_ERROR_OUT_OF_MEMORY;
+		goto exitFailAlloc;
+	}
 
-		while(psTemp)
-		{
-			IMG_UINT32 j;
+	for (psTemp = psScatterList; psTemp && (ui32PageCount < i); psTemp = sg_next(psTemp))
+	{
+		IMG_UINT32 j;
 
-			for (j=0;j<psTemp->length;j+=PAGE_SIZE)
-			{
-				if (i == 1)
-				{
-					/* Pass 2: Get the page data */
-					pasSysPhysAddr[ui32PageCount].uiAddr = sg_phys(psTemp);
-				}
-				ui32PageCount++;
-			}
-			psTemp = sg_next(psTemp);
+		for (j = 0; (j < psTemp->length) && (ui32PageCount < i); j += PAGE_SIZE)
+		{
+			pasSysPhysAddr[ui32PageCount].uiAddr = sg_phys(psTemp) + j;
+			ui32PageCount++;
 		}
 	}
 
@@ -360,4 +357,27 @@ IMG_VOID IonUnimportBufferAndReleasePhysAddr(IMG_HANDLE hPriv)
 	ion_free(psImportData->psIonClient, psImportData->psIonHandle);
 	kfree(psImportData);
 }
+
+/*
+	Identifies the buffer behind an ION fd without mapping it. Every fd for
+	a buffer gives the same ID. Buffers still imported into this client
+	already have a handle, so importing again only takes a reference.
+*/
+PVRSRV_ERROR IonGetBufferID(IMG_HANDLE hIonDev,
+							IMG_HANDLE hIonFD,
+							IMG_HANDLE *phBufferID)
+{
+	struct ion_client *psIonClient = hIonDev;
+	struct ion_handle *psIonHandle;
+
+	psIonHandle = ion_import_fd(psIonClient, (int) hIonFD);
+	if (IS_ERR_OR_NULL(psIonHandle))
+	{
+		return PVRSRV_ERROR_BAD_MAPPING;
+	}
+
+	*phBufferID = (IMG_HANDLE) psIonHandle->buffer;
+	ion_free(psIonClient, psIonHandle);
+	return PVRSRV_OK;
+}
 #endif
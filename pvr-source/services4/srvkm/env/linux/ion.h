@@ -70,5 +70,9 @@ PVRSRV_ERROR IonImportBufferAndAquirePhysAddr(IMG_HANDLE hIonDev,
 											  IMG_HANDLE *phPriv);
 
 IMG_VOID IonUnimportBufferAndReleasePhysAddr(IMG_HANDLE hPriv);
+
+PVRSRV_ERROR IonGetBufferID(IMG_HANDLE hIonDev,
+							IMG_HANDLE hIonFD,
+							IMG_HANDLE *phBufferID);
 #endif
 #endif /* __IMG_LINUX_ION_H__ */
@@ -43,6 +43,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef __LOCK_H__
 #define __LOCK_H__
 
+#include <linux/rwsem.h>
+
 /*
  * Main driver lock, used to ensure driver code is single threaded.
  * There are some places where this lock must not be taken, such as
@@ -50,6 +52,27 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 extern PVRSRV_LINUX_MUTEX gPVRSRVLock;
 
+/*
+ * Bridge calls flagged PVRSRV_BRIDGE_FLAG_SHARED_LOCK only look up handles
+ * and read sync objects, so they run concurrently with each other holding
+ * this for read, without gPVRSRVLock. Everything else holds it for write
+ * along with gPVRSRVLock: take both through LinuxLockBridge and
+ * LinuxUnLockBridge rather than gPVRSRVLock on its own.
+ */
+extern struct rw_semaphore gPVRSRVSharedLock;
+
+static inline IMG_VOID LinuxLockBridge(IMG_VOID)
+{
+	LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+	down_write(&gPVRSRVSharedLock);
+}
+
+static inline IMG_VOID LinuxUnLockBridge(IMG_VOID)
+{
+	up_write(&gPVRSRVSharedLock);
+	LinuxUnLockMutex(&gPVRSRVLock);
+}
+
 #endif /* __LOCK_H__ */
 /*****************************************************************************
  End of file (lock.h)
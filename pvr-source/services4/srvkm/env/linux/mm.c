@@ -51,6 +51,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define PVR_LINUX_MEM_AREA_POOL_MAX_PAGES 0
 #endif
 
+#if !defined(PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES)
+#define PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES 0
+#endif
+
 #include <linux/kernel.h>
 #include <asm/atomic.h>
 #include <linux/list.h>
@@ -64,6 +68,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/slab.h>
 #include <linux/highmem.h>
 #include <linux/sched.h>
+#include <linux/percpu.h>
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+#include <linux/kthread.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#if defined(DEBUG_LINUX_MEMORY_ALLOCATIONS)
+#include <linux/hash.h>
+#endif
+#endif
 
 #if defined(PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK)
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,1,0))
@@ -98,11 +111,27 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #endif
 
 /*
- * The page pool entry count is an atomic int so that the shrinker function
- * can return it even when we can't take the lock that protects the page pool
- * list.
+ * Freed pages are pooled by type: uncached (including write-combined)
+ * pages without dirty cache lines, and cached pages.
  */
-static atomic_t g_sPagePoolEntryCount = ATOMIC_INIT(0);
+#define LINUX_PAGE_POOL_UNCACHED	0
+#define LINUX_PAGE_POOL_CACHED		1
+#define LINUX_PAGE_POOL_TYPES		2
+#define LINUX_PAGE_POOL_NONE		(-1)
+
+/*
+ * The page pool entry counts are atomic ints so that the shrinker function
+ * can return them even when we can't take the lock that protects the page
+ * pool lists.
+ */
+static atomic_t g_asPagePoolEntryCount[LINUX_PAGE_POOL_TYPES] =
+{
+	ATOMIC_INIT(0),
+	ATOMIC_INIT(0)
+};
+
+/* Likewise for the pool of pages zeroed in the background */
+static atomic_t g_sZeroPagePoolEntryCount = ATOMIC_INIT(0);
 
 #if defined(DEBUG_LINUX_MEMORY_ALLOCATIONS)
 typedef enum {
@@ -133,9 +162,10 @@ typedef struct _DEBUG_MEM_ALLOC_REC
     
     struct _DEBUG_MEM_ALLOC_REC   *psNext;
 	struct _DEBUG_MEM_ALLOC_REC   **ppsThis;
+	/* Chain in g_apsMemoryRecordHash, so frees don't walk every record */
+	struct _DEBUG_MEM_ALLOC_REC   *psHashNext;
 } DEBUG_MEM_ALLOC_REC;
 
-static IMPLEMENT_LIST_ANY_VA_2(DEBUG_MEM_ALLOC_REC, IMG_BOOL, IMG_FALSE)
 static IMPLEMENT_LIST_ANY_VA(DEBUG_MEM_ALLOC_REC)
 static IMPLEMENT_LIST_FOR_EACH(DEBUG_MEM_ALLOC_REC)
 static IMPLEMENT_LIST_INSERT(DEBUG_MEM_ALLOC_REC)
@@ -144,6 +174,23 @@ static IMPLEMENT_LIST_REMOVE(DEBUG_MEM_ALLOC_REC)
 
 static DEBUG_MEM_ALLOC_REC *g_MemoryRecords;
 
+/*
+ * g_MemoryRecords is kept for the proc listing and cleanup; lookups by
+ * (type, key) go through this table instead.
+ */
+#define DEBUG_MEM_ALLOC_HASH_BITS	10
+#define DEBUG_MEM_ALLOC_HASH_SIZE	(1 << DEBUG_MEM_ALLOC_HASH_BITS)
+
+static DEBUG_MEM_ALLOC_REC *g_apsMemoryRecordHash[DEBUG_MEM_ALLOC_HASH_SIZE];
+
+static inline IMG_UINT32
+DebugMemAllocRecordHash(DEBUG_MEM_ALLOC_TYPE eAllocType, IMG_VOID *pvKey)
+{
+	/* Keys of different types may collide (e.g. a page and its kmap) */
+	return (hash_ptr(pvKey, DEBUG_MEM_ALLOC_HASH_BITS) ^ (IMG_UINT32)eAllocType)
+			& (DEBUG_MEM_ALLOC_HASH_SIZE - 1);
+}
+
 static IMG_UINT32 g_WaterMarkData[DEBUG_MEM_ALLOC_TYPE_COUNT];
 static IMG_UINT32 g_HighWaterMarkData[DEBUG_MEM_ALLOC_TYPE_COUNT];
 
@@ -154,7 +201,9 @@ static IMG_UINT32 g_SysRAMHighWaterMark;	/* *DOES* include page pool */
 static inline IMG_UINT32
 SysRAMTrueWaterMark(void)
 {
-	return g_SysRAMWaterMark + PAGES_TO_BYTES(atomic_read(&g_sPagePoolEntryCount));
+	return g_SysRAMWaterMark + PAGES_TO_BYTES(atomic_read(&g_asPagePoolEntryCount[LINUX_PAGE_POOL_UNCACHED]) +
+											  atomic_read(&g_asPagePoolEntryCount[LINUX_PAGE_POOL_CACHED]) +
+											  atomic_read(&g_sZeroPagePoolEntryCount));
 }
 
 /* ioremap + io */
@@ -236,7 +285,11 @@ typedef	struct
 static LinuxKMemCache *g_PsLinuxMemAreaCache;
 static LinuxKMemCache *g_PsLinuxPagePoolCache;
 
-static LIST_HEAD(g_sPagePoolList);
+static struct list_head g_asPagePoolList[LINUX_PAGE_POOL_TYPES] =
+{
+	LIST_HEAD_INIT(g_asPagePoolList[LINUX_PAGE_POOL_UNCACHED]),
+	LIST_HEAD_INIT(g_asPagePoolList[LINUX_PAGE_POOL_CACHED])
+};
 static int g_iPagePoolMaxEntries;
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,15))
@@ -259,10 +312,40 @@ AreaIsUncached(IMG_UINT32 ui32AreaFlags)
 	return (ui32AreaFlags & (PVRSRV_HAP_WRITECOMBINE | PVRSRV_HAP_UNCACHED)) != 0;
 }
 
+/*
+ * Areas allocated with PVRSRV_MEM_ZERO are built from pages zeroed by the
+ * zero page pool thread (or, if the pool is empty, by the allocating
+ * thread) so that the buffer manager doesn't have to zero them again.
+ */
 static inline IMG_BOOL
-CanFreeToPool(LinuxMemArea *psLinuxMemArea)
+AreaIsZeroed(IMG_UINT32 ui32AreaFlags)
 {
-	return AreaIsUncached(psLinuxMemArea->ui32AreaFlags) && !psLinuxMemArea->bNeedsCacheInvalidate;
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+	return (ui32AreaFlags & PVRSRV_MEM_ZERO) != 0;
+#else
+	PVR_UNREFERENCED_PARAMETER(ui32AreaFlags);
+	return IMG_FALSE;
+#endif
+}
+
+/*
+ * Which page pool, if any, pages with these flags can be freed to.  An
+ * uncached page that may still have dirty cache lines can't be pooled.
+ */
+static inline IMG_INT
+PagePoolType(IMG_UINT32 ui32AreaFlags, IMG_BOOL bNeedsCacheInvalidate)
+{
+	if (!AreaIsUncached(ui32AreaFlags))
+	{
+		return LINUX_PAGE_POOL_CACHED;
+	}
+	return bNeedsCacheInvalidate ? LINUX_PAGE_POOL_NONE : LINUX_PAGE_POOL_UNCACHED;
+}
+
+static inline IMG_INT
+FreeToPoolType(LinuxMemArea *psLinuxMemArea)
+{
+	return PagePoolType(psLinuxMemArea->ui32AreaFlags, psLinuxMemArea->bNeedsCacheInvalidate);
 }
 
 IMG_VOID *
@@ -316,10 +399,19 @@ DebugMemAllocRecordAdd(DEBUG_MEM_ALLOC_TYPE eAllocType,
                        IMG_UINT32 ui32Line)
 {
     DEBUG_MEM_ALLOC_REC *psRecord;
+    IMG_UINT32 ui32Hash;
 
     LinuxLockMutex(&g_sDebugMutex);
 
     psRecord = kmalloc(sizeof(DEBUG_MEM_ALLOC_REC), GFP_KERNEL);
+    if (psRecord == IMG_NULL)
+    {
+        PVR_DPF((PVR_DBG_ERROR, "%s: couldn't allocate a record for type=%s (called from %s, line %d)",
+                 __FUNCTION__, DebugMemAllocRecordTypeToString(eAllocType),
+                 pszFileName, ui32Line));
+        LinuxUnLockMutex(&g_sDebugMutex);
+        return;
+    }
 
     psRecord->eAllocType = eAllocType;
     psRecord->pvKey = pvKey;
@@ -332,6 +424,10 @@ DebugMemAllocRecordAdd(DEBUG_MEM_ALLOC_TYPE eAllocType,
     psRecord->ui32Line = ui32Line;
     
 	List_DEBUG_MEM_ALLOC_REC_Insert(&g_MemoryRecords, psRecord);
+
+	ui32Hash = DebugMemAllocRecordHash(eAllocType, pvKey);
+	psRecord->psHashNext = g_apsMemoryRecordHash[ui32Hash];
+	g_apsMemoryRecordHash[ui32Hash] = psRecord;
     
     g_WaterMarkData[eAllocType] += ui32Bytes;
     if (g_WaterMarkData[eAllocType] > g_HighWaterMarkData[eAllocType])
@@ -368,63 +464,55 @@ DebugMemAllocRecordAdd(DEBUG_MEM_ALLOC_TYPE eAllocType,
 }
 
 
-static IMG_BOOL DebugMemAllocRecordRemove_AnyVaCb(DEBUG_MEM_ALLOC_REC *psCurrentRecord, va_list va)
+static IMG_VOID
+DebugMemAllocRecordRemove(DEBUG_MEM_ALLOC_TYPE eAllocType, IMG_VOID *pvKey, IMG_CHAR *pszFileName, IMG_UINT32 ui32Line)
 {
-	DEBUG_MEM_ALLOC_TYPE eAllocType;
-	IMG_VOID *pvKey;
-	
-	eAllocType = va_arg(va, DEBUG_MEM_ALLOC_TYPE);
-	pvKey = va_arg(va, IMG_VOID*);
+    DEBUG_MEM_ALLOC_REC **ppsLink;
+    DEBUG_MEM_ALLOC_REC *psCurrentRecord;
+
+    LinuxLockMutex(&g_sDebugMutex);
 
-	if (psCurrentRecord->eAllocType == eAllocType
-		&& psCurrentRecord->pvKey == pvKey)
+    /* Locate the corresponding allocation entry */
+	for (ppsLink = &g_apsMemoryRecordHash[DebugMemAllocRecordHash(eAllocType, pvKey)];
+		 *ppsLink != IMG_NULL;
+		 ppsLink = &(*ppsLink)->psHashNext)
 	{
-		eAllocType = psCurrentRecord->eAllocType;
-		g_WaterMarkData[eAllocType] -= psCurrentRecord->ui32Bytes;
-		
-		if (eAllocType == DEBUG_MEM_ALLOC_TYPE_KMALLOC
-		   || eAllocType == DEBUG_MEM_ALLOC_TYPE_VMALLOC
-		   || eAllocType == DEBUG_MEM_ALLOC_TYPE_ALLOC_PAGES
-		   || eAllocType == DEBUG_MEM_ALLOC_TYPE_KMEM_CACHE)
-		{
-			g_SysRAMWaterMark -= psCurrentRecord->ui32Bytes;
-		}
-		else if (eAllocType == DEBUG_MEM_ALLOC_TYPE_IOREMAP
-				|| eAllocType == DEBUG_MEM_ALLOC_TYPE_IO)
+		if ((*ppsLink)->eAllocType == eAllocType && (*ppsLink)->pvKey == pvKey)
 		{
-			g_IOMemWaterMark -= psCurrentRecord->ui32Bytes;
+			break;
 		}
-		
-		List_DEBUG_MEM_ALLOC_REC_Remove(psCurrentRecord);
-		kfree(psCurrentRecord);
-
-		return IMG_TRUE;
 	}
-	else
+
+	psCurrentRecord = *ppsLink;
+	if (psCurrentRecord == IMG_NULL)
 	{
-		return IMG_FALSE;
+		PVR_DPF((PVR_DBG_ERROR, "%s: couldn't find an entry for type=%s with pvKey=%p (called from %s, line %d\n",
+		__FUNCTION__, DebugMemAllocRecordTypeToString(eAllocType), pvKey,
+		pszFileName, ui32Line));
+		LinuxUnLockMutex(&g_sDebugMutex);
+		return;
 	}
-}
 
+	*ppsLink = psCurrentRecord->psHashNext;
 
-static IMG_VOID
-DebugMemAllocRecordRemove(DEBUG_MEM_ALLOC_TYPE eAllocType, IMG_VOID *pvKey, IMG_CHAR *pszFileName, IMG_UINT32 ui32Line)
-{
-/*    DEBUG_MEM_ALLOC_REC **ppsCurrentRecord;*/
-
-    LinuxLockMutex(&g_sDebugMutex);
+	g_WaterMarkData[eAllocType] -= psCurrentRecord->ui32Bytes;
 
-    /* Locate the corresponding allocation entry */
-	if (!List_DEBUG_MEM_ALLOC_REC_IMG_BOOL_Any_va(g_MemoryRecords,
-												DebugMemAllocRecordRemove_AnyVaCb,
-												eAllocType,
-												pvKey))
+	if (eAllocType == DEBUG_MEM_ALLOC_TYPE_KMALLOC
+	   || eAllocType == DEBUG_MEM_ALLOC_TYPE_VMALLOC
+	   || eAllocType == DEBUG_MEM_ALLOC_TYPE_ALLOC_PAGES
+	   || eAllocType == DEBUG_MEM_ALLOC_TYPE_KMEM_CACHE)
 	{
-		PVR_DPF((PVR_DBG_ERROR, "%s: couldn't find an entry for type=%s with pvKey=%p (called from %s, line %d\n",
-		__FUNCTION__, DebugMemAllocRecordTypeToString(eAllocType), pvKey,
-		pszFileName, ui32Line));
+		g_SysRAMWaterMark -= psCurrentRecord->ui32Bytes;
+	}
+	else if (eAllocType == DEBUG_MEM_ALLOC_TYPE_IOREMAP
+			|| eAllocType == DEBUG_MEM_ALLOC_TYPE_IO)
+	{
+		g_IOMemWaterMark -= psCurrentRecord->ui32Bytes;
 	}
 
+	List_DEBUG_MEM_ALLOC_REC_Remove(psCurrentRecord);
+	kfree(psCurrentRecord);
+
     LinuxUnLockMutex(&g_sDebugMutex);
 }
 
@@ -631,11 +719,11 @@ LinuxPagePoolEntryFree(LinuxPagePoolEntry *psPagePoolEntry)
 
 
 static struct page *
-AllocPageFromLinux(void)
+AllocPageFromLinux(gfp_t uGFPFlags)
 {
 	struct page *psPage;
 
-        psPage = alloc_pages(GFP_KERNEL | __GFP_HIGHMEM, 0);
+        psPage = alloc_pages(uGFPFlags, 0);
         if (!psPage)
         {
             return NULL;
@@ -707,57 +795,164 @@ PagePoolTrylock(void)
 #endif	/* (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0) */
 
 
+static inline IMG_INT
+PagePoolEntryCount(IMG_VOID)
+{
+	return atomic_read(&g_asPagePoolEntryCount[LINUX_PAGE_POOL_UNCACHED]) +
+		   atomic_read(&g_asPagePoolEntryCount[LINUX_PAGE_POOL_CACHED]);
+}
+
 static inline void
-AddEntryToPool(LinuxPagePoolEntry *psPagePoolEntry)
+AddEntryToPool(IMG_INT iPool, LinuxPagePoolEntry *psPagePoolEntry)
 {
-	list_add_tail(&psPagePoolEntry->sPagePoolItem, &g_sPagePoolList);
-	atomic_inc(&g_sPagePoolEntryCount);
+	list_add_tail(&psPagePoolEntry->sPagePoolItem, &g_asPagePoolList[iPool]);
+	atomic_inc(&g_asPagePoolEntryCount[iPool]);
 }
 
 static inline void
-RemoveEntryFromPool(LinuxPagePoolEntry *psPagePoolEntry)
+RemoveEntryFromPool(IMG_INT iPool, LinuxPagePoolEntry *psPagePoolEntry)
 {
 	list_del(&psPagePoolEntry->sPagePoolItem);
-	atomic_dec(&g_sPagePoolEntryCount);
+	atomic_dec(&g_asPagePoolEntryCount[iPool]);
 }
 
 static inline LinuxPagePoolEntry *
-RemoveFirstEntryFromPool(void)
+RemoveFirstEntryFromPool(IMG_INT iPool)
 {
 	LinuxPagePoolEntry *psPagePoolEntry;
 
-	if (list_empty(&g_sPagePoolList))
+	if (list_empty(&g_asPagePoolList[iPool]))
 	{
-		PVR_ASSERT(atomic_read(&g_sPagePoolEntryCount) == 0);
+		PVR_ASSERT(atomic_read(&g_asPagePoolEntryCount[iPool]) == 0);
 
 		return NULL;
 	}
 
-	PVR_ASSERT(atomic_read(&g_sPagePoolEntryCount) > 0);
+	PVR_ASSERT(atomic_read(&g_asPagePoolEntryCount[iPool]) > 0);
 
-	psPagePoolEntry = list_first_entry(&g_sPagePoolList, LinuxPagePoolEntry, sPagePoolItem);
+	psPagePoolEntry = list_first_entry(&g_asPagePoolList[iPool], LinuxPagePoolEntry, sPagePoolItem);
 
-	RemoveEntryFromPool(psPagePoolEntry);
+	RemoveEntryFromPool(iPool, psPagePoolEntry);
 
 	return psPagePoolEntry;
 }
 
+#if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
+/*
+ * Each CPU keeps a few pages of each pool type in front of the global
+ * pool, so that most page frees and allocations neither take the pool
+ * mutex nor allocate a pool entry.  A CPU's cache is only touched with
+ * preemption disabled, and spills half its pages to the global pool
+ * when it fills up.  These pages aren't counted in the global pool, and
+ * aren't given back by the shrinker; there are at most
+ * LINUX_PAGE_POOL_CPU_PAGES of each type per CPU.
+ */
+#define LINUX_PAGE_POOL_CPU_PAGES	16
+#define LINUX_PAGE_POOL_CPU_SPILL	(LINUX_PAGE_POOL_CPU_PAGES / 2)
+
+typedef struct
+{
+	IMG_UINT32 ui32Count;
+	struct page *apsPages[LINUX_PAGE_POOL_CPU_PAGES];
+} LinuxPagePoolCPUCache;
+
+static DEFINE_PER_CPU(LinuxPagePoolCPUCache [LINUX_PAGE_POOL_TYPES], g_asPagePoolCPUCache);
+
 static struct page *
-AllocPage(IMG_UINT32 ui32AreaFlags, IMG_BOOL *pbFromPagePool)
+PagePoolCPUCachePop(IMG_INT iPool)
 {
+	LinuxPagePoolCPUCache *psCache = &get_cpu_var(g_asPagePoolCPUCache)[iPool];
 	struct page *psPage = NULL;
 
+	/* The most recently freed page is the most likely to be cache hot */
+	if (psCache->ui32Count != 0)
+	{
+		psPage = psCache->apsPages[--psCache->ui32Count];
+	}
+
+	put_cpu_var(g_asPagePoolCPUCache);
+
+	return psPage;
+}
+
+/*
+ * Add a page to this CPU's cache.  If the cache was full, its oldest
+ * pages are moved to apsSpill and their number returned, for the caller
+ * to put in the global pool.
+ */
+static IMG_UINT32
+PagePoolCPUCachePush(IMG_INT iPool, struct page *psPage, struct page **apsSpill)
+{
+	LinuxPagePoolCPUCache *psCache = &get_cpu_var(g_asPagePoolCPUCache)[iPool];
+	IMG_UINT32 ui32Spill = 0;
+
+	if (psCache->ui32Count == LINUX_PAGE_POOL_CPU_PAGES)
+	{
+		ui32Spill = LINUX_PAGE_POOL_CPU_SPILL;
+
+		memcpy(apsSpill, psCache->apsPages, ui32Spill * sizeof(*apsSpill));
+		memmove(psCache->apsPages, &psCache->apsPages[ui32Spill],
+				(psCache->ui32Count - ui32Spill) * sizeof(*apsSpill));
+		psCache->ui32Count -= ui32Spill;
+	}
+
+	psCache->apsPages[psCache->ui32Count++] = psPage;
+
+	put_cpu_var(g_asPagePoolCPUCache);
+
+	return ui32Spill;
+}
+
+/* Only called when no other CPU can be using the pool */
+static IMG_VOID
+PagePoolCPUCacheDrain(IMG_VOID)
+{
+	IMG_INT iCPU, iPool;
+
+	for_each_possible_cpu(iCPU)
+	{
+		for (iPool = 0; iPool < LINUX_PAGE_POOL_TYPES; iPool++)
+		{
+			LinuxPagePoolCPUCache *psCache = &per_cpu(g_asPagePoolCPUCache, iCPU)[iPool];
+
+			while (psCache->ui32Count != 0)
+			{
+				FreePageToLinux(psCache->apsPages[--psCache->ui32Count]);
+			}
+		}
+	}
+}
+#endif	/* (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0) */
+
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+static struct page *TakePageFromZeroPool(IMG_VOID);
+#endif
+
+static struct page *
+AllocPage(IMG_UINT32 ui32AreaFlags, IMG_BOOL *pbFromPagePool)
+{
 	/*
-	 * Only uncached allocations can come from the page pool.
-	 * The page pool is currently used to reduce the cost of
-	 * invalidating the CPU cache when uncached memory is allocated.
+	 * Cached and uncached pages are pooled separately.  Uncached pages are
+	 * freed to the pool only when they have no dirty cache lines, so taking
+	 * one saves invalidating the CPU cache for it; a cached page may have
+	 * dirty lines, so it can only be reused for another cached allocation.
+	 * When the uncached pool is empty, pages the zero page pool thread has
+	 * already cleaned are just as good, and keep the whole area free of
+	 * a cache invalidate (and poolable again when it is freed).
 	 */
-	if (AreaIsUncached(ui32AreaFlags) && atomic_read(&g_sPagePoolEntryCount) != 0)
+	IMG_INT iPool = AreaIsUncached(ui32AreaFlags) ? LINUX_PAGE_POOL_UNCACHED : LINUX_PAGE_POOL_CACHED;
+	struct page *psPage = NULL;
+
+#if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
+	psPage = PagePoolCPUCachePop(iPool);
+#endif
+
+	if (!psPage && atomic_read(&g_asPagePoolEntryCount[iPool]) != 0)
 	{
 		LinuxPagePoolEntry *psPagePoolEntry;
 
 		PagePoolLock();
-		psPagePoolEntry = RemoveFirstEntryFromPool();
+		psPagePoolEntry = RemoveFirstEntryFromPool(iPool);
 		PagePoolUnlock();
 
 		/* List may have changed since we checked the counter */
@@ -765,13 +960,23 @@ AllocPage(IMG_UINT32 ui32AreaFlags, IMG_BOOL *pbFromPagePool)
 		{
 			psPage = psPagePoolEntry->psPage;
 			LinuxPagePoolEntryFree(psPagePoolEntry);
-			*pbFromPagePool = IMG_TRUE;
 		}
 	}
 
-	if (!psPage)
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+	if (!psPage && iPool == LINUX_PAGE_POOL_UNCACHED)
+	{
+		psPage = TakePageFromZeroPool();
+	}
+#endif
+
+	if (psPage)
+	{
+		*pbFromPagePool = IMG_TRUE;
+	}
+	else
 	{
-		psPage = AllocPageFromLinux();
+		psPage = AllocPageFromLinux(GFP_KERNEL | __GFP_HIGHMEM);
 		if (psPage)
 		{
 			*pbFromPagePool = IMG_FALSE;
@@ -783,106 +988,367 @@ AllocPage(IMG_UINT32 ui32AreaFlags, IMG_BOOL *pbFromPagePool)
 }
 
 static IMG_VOID
-FreePage(IMG_BOOL bToPagePool, struct page *psPage)
+FreePagesToGlobalPool(IMG_INT iPool, struct page **ppsPages, IMG_UINT32 ui32NumPages)
 {
-	/* Only uncached allocations can be freed to the page pool */
-	if (bToPagePool && atomic_read(&g_sPagePoolEntryCount) < g_iPagePoolMaxEntries)
+	IMG_UINT32 i;
+
+	PagePoolLock();
+
+	for (i = 0; i < ui32NumPages; i++)
 	{
-		LinuxPagePoolEntry *psPagePoolEntry = LinuxPagePoolEntryAlloc();
-		if (psPagePoolEntry)
+		if (PagePoolEntryCount() < g_iPagePoolMaxEntries)
 		{
-			psPagePoolEntry->psPage = psPage;
+			LinuxPagePoolEntry *psPagePoolEntry = LinuxPagePoolEntryAlloc();
+			if (psPagePoolEntry)
+			{
+				psPagePoolEntry->psPage = ppsPages[i];
+				AddEntryToPool(iPool, psPagePoolEntry);
+				continue;
+			}
+		}
 
-			PagePoolLock();
-			AddEntryToPool(psPagePoolEntry);
-			PagePoolUnlock();
+		FreePageToLinux(ppsPages[i]);
+	}
 
-			return;
-		}
+	PagePoolUnlock();
+}
+
+static IMG_VOID
+FreePage(IMG_INT iPool, struct page *psPage)
+{
+	if (iPool == LINUX_PAGE_POOL_NONE || g_iPagePoolMaxEntries == 0)
+	{
+		FreePageToLinux(psPage);
+		return;
 	}
 
-	FreePageToLinux(psPage);
+#if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
+	{
+		struct page *apsSpill[LINUX_PAGE_POOL_CPU_SPILL];
+		IMG_UINT32 ui32Spill = PagePoolCPUCachePush(iPool, psPage, apsSpill);
+
+		if (ui32Spill != 0)
+		{
+			FreePagesToGlobalPool(iPool, apsSpill, ui32Spill);
+		}
+	}
+#else
+	FreePagesToGlobalPool(iPool, &psPage, 1);
+#endif
 }
 
 static IMG_VOID
 FreePagePool(IMG_VOID)
 {
 	LinuxPagePoolEntry *psPagePoolEntry, *psTempPoolEntry;
+	IMG_INT iPool;
+
+#if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
+	PagePoolCPUCacheDrain();
+#endif
 
 	PagePoolLock();
 
 #if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
-	PVR_DPF((PVR_DBG_MESSAGE,"%s: Freeing %d pages from pool", __FUNCTION__, atomic_read(&g_sPagePoolEntryCount)));
+	PVR_DPF((PVR_DBG_MESSAGE,"%s: Freeing %d pages from pool", __FUNCTION__, PagePoolEntryCount()));
 #else
-	PVR_ASSERT(atomic_read(&g_sPagePoolEntryCount) == 0);
-	PVR_ASSERT(list_empty(&g_sPagePoolList));
+	PVR_ASSERT(PagePoolEntryCount() == 0);
 #endif
 
-	list_for_each_entry_safe(psPagePoolEntry, psTempPoolEntry, &g_sPagePoolList, sPagePoolItem)
+	for (iPool = 0; iPool < LINUX_PAGE_POOL_TYPES; iPool++)
 	{
-		RemoveEntryFromPool(psPagePoolEntry);
+		list_for_each_entry_safe(psPagePoolEntry, psTempPoolEntry, &g_asPagePoolList[iPool], sPagePoolItem)
+		{
+			RemoveEntryFromPool(iPool, psPagePoolEntry);
 
-		FreePageToLinux(psPagePoolEntry->psPage);
-		LinuxPagePoolEntryFree(psPagePoolEntry);
+			FreePageToLinux(psPagePoolEntry->psPage);
+			LinuxPagePoolEntryFree(psPagePoolEntry);
+		}
 	}
 
-	PVR_ASSERT(atomic_read(&g_sPagePoolEntryCount) == 0);
+	PVR_ASSERT(PagePoolEntryCount() == 0);
 
 	PagePoolUnlock();
 }
 
-#if defined(PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK)
-#if defined(PVRSRV_NEED_PVR_ASSERT)
-static struct shrinker g_sShrinker;
-#endif
+/*
+ * Zero a page through its kernel mapping, and clean the CPU cache so
+ * that the zeroes are in memory.  The page can then be used for cached,
+ * uncached or write-combined mappings without a cache invalidate.
+ */
+static IMG_VOID
+ZeroAndCleanPage(struct page *psPage)
+{
+	IMG_VOID *pvPageAddr = kmap(psPage);
 
-static int
-ShrinkPagePool(struct shrinker *psShrinker, struct shrink_control *psShrinkControl)
+	clear_page(pvPageAddr);
+	LinuxCleanCPUCachePage(psPage, pvPageAddr);
+
+	kunmap(psPage);
+}
+
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+/* The pool is refilled once it drops below half full */
+#define ZERO_PAGE_POOL_LOW_WATER (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES / 2)
+
+/* Pages in the zero page pool are linked through page->lru */
+static LIST_HEAD(g_sZeroPagePoolList);
+static DEFINE_SPINLOCK(g_sZeroPagePoolLock);
+static DECLARE_WAIT_QUEUE_HEAD(g_sZeroPagePoolWaitQueue);
+static struct task_struct *g_psZeroPagePoolThread;
+
+static struct page *
+RemoveFirstPageFromZeroPool(IMG_VOID)
 {
-	unsigned long uNumToScan = psShrinkControl->nr_to_scan;
+	struct page *psPage = NULL;
 
-	PVR_ASSERT(psShrinker == &g_sShrinker);
-	(void)psShrinker;
+	spin_lock(&g_sZeroPagePoolLock);
+	if (!list_empty(&g_sZeroPagePoolList))
+	{
+		psPage = list_first_entry(&g_sZeroPagePoolList, struct page, lru);
+		list_del(&psPage->lru);
+		atomic_dec(&g_sZeroPagePoolEntryCount);
+	}
+	spin_unlock(&g_sZeroPagePoolLock);
 
-	if (uNumToScan != 0)
+	return psPage;
+}
+
+/* Take a zeroed page, waking the pool thread once the pool runs low */
+static struct page *
+TakePageFromZeroPool(IMG_VOID)
+{
+	struct page *psPage = RemoveFirstPageFromZeroPool();
+
+	if (atomic_read(&g_sZeroPagePoolEntryCount) < ZERO_PAGE_POOL_LOW_WATER)
 	{
-		LinuxPagePoolEntry *psPagePoolEntry, *psTempPoolEntry;
+		wake_up(&g_sZeroPagePoolWaitQueue);
+	}
 
-		PVR_DPF((PVR_DBG_MESSAGE,"%s: Number to scan: %ld", __FUNCTION__, uNumToScan));
-		PVR_DPF((PVR_DBG_MESSAGE,"%s: Pages in pool before scan: %d", __FUNCTION__, atomic_read(&g_sPagePoolEntryCount)));
+	return psPage;
+}
 
-		if (!PagePoolTrylock())
+/*
+ * Free up to uNumToFree pages from the zero page pool, returning the
+ * number freed.  A count of 0 frees the whole pool.
+ */
+static unsigned long
+FreeZeroPagePool(unsigned long uNumToFree)
+{
+	unsigned long uNumFreed = 0;
+	struct page *psPage;
+
+	while ((uNumToFree == 0 || uNumFreed < uNumToFree) &&
+		   (psPage = RemoveFirstPageFromZeroPool()) != NULL)
+	{
+		FreePageToLinux(psPage);
+		uNumFreed++;
+	}
+
+	return uNumFreed;
+}
+
+/*
+ * Keeps the zero page pool topped up at the lowest priority, so the cost
+ * of zeroing new allocations is taken when the CPU would otherwise be idle
+ * rather than in the allocating (usually the application's render) thread.
+ */
+static int
+ZeroPagePoolThread(void *pvData)
+{
+	PVR_UNREFERENCED_PARAMETER(pvData);
+
+	set_user_nice(current, 19);
+
+	while (!kthread_should_stop())
+	{
+		struct page *psPage;
+
+		if (atomic_read(&g_sZeroPagePoolEntryCount) >= PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES)
 		{
-			PVR_TRACE(("%s: Couldn't get page pool lock", __FUNCTION__));
-			return -1;
+			wait_event_interruptible(g_sZeroPagePoolWaitQueue,
+									 kthread_should_stop() ||
+									 atomic_read(&g_sZeroPagePoolEntryCount) < ZERO_PAGE_POOL_LOW_WATER);
+			continue;
 		}
 
-		list_for_each_entry_safe(psPagePoolEntry, psTempPoolEntry, &g_sPagePoolList, sPagePoolItem)
+		/* Don't push the system into reclaim just to fill the pool */
+		psPage = AllocPageFromLinux(GFP_KERNEL | __GFP_HIGHMEM | __GFP_NORETRY | __GFP_NOWARN);
+		if (!psPage)
 		{
-			RemoveEntryFromPool(psPagePoolEntry);
+			schedule_timeout_interruptible(HZ);
+			continue;
+		}
 
-			FreePageToLinux(psPagePoolEntry->psPage);
-			LinuxPagePoolEntryFree(psPagePoolEntry);
+		ZeroAndCleanPage(psPage);
 
-			if (--uNumToScan == 0)
-			{
-				break;
-			}
-		}
+		spin_lock(&g_sZeroPagePoolLock);
+		list_add_tail(&psPage->lru, &g_sZeroPagePoolList);
+		atomic_inc(&g_sZeroPagePoolEntryCount);
+		spin_unlock(&g_sZeroPagePoolLock);
+
+		cond_resched();
+	}
+
+	return 0;
+}
+#endif	/* (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0) */
+
+/*
+ * Allocate a zeroed page, from the zero page pool if possible, else from
+ * the normal allocator and zeroed here.  Either way the page has no dirty
+ * cache lines, so it is reported as coming from the page pool.
+ */
+static struct page *
+AllocZeroedPage(IMG_UINT32 ui32AreaFlags, IMG_BOOL *pbFromPagePool)
+{
+	struct page *psPage;
+
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+	psPage = TakePageFromZeroPool();
+
+	if (psPage)
+	{
+		*pbFromPagePool = IMG_TRUE;
+		return psPage;
+	}
+#endif
+
+	psPage = AllocPage(ui32AreaFlags, pbFromPagePool);
+	if (psPage)
+	{
+		ZeroAndCleanPage(psPage);
+		*pbFromPagePool = IMG_TRUE;
+	}
 
-		if (list_empty(&g_sPagePoolList))
+	return psPage;
+}
+
+#if defined(PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK)
+#if defined(PVRSRV_NEED_PVR_ASSERT)
+static struct shrinker g_sShrinker;
+#endif
+
+/* Pages the shrinker could free */
+static unsigned long
+PagePoolShrinkCount(IMG_VOID)
+{
+	return PagePoolEntryCount() + atomic_read(&g_sZeroPagePoolEntryCount);
+}
+
+/*
+ * Free pages from a global page pool list, the caller holding the page
+ * pool lock.  Returns the number freed.
+ */
+static unsigned long
+PagePoolShrinkList(IMG_INT iPool, unsigned long uNumToScan)
+{
+	LinuxPagePoolEntry *psPagePoolEntry, *psTempPoolEntry;
+	unsigned long uNumFreed = 0;
+
+	list_for_each_entry_safe(psPagePoolEntry, psTempPoolEntry, &g_asPagePoolList[iPool], sPagePoolItem)
+	{
+		if (uNumFreed == uNumToScan)
 		{
-			PVR_ASSERT(atomic_read(&g_sPagePoolEntryCount) == 0);
+			break;
 		}
 
-		PagePoolUnlock();
+		RemoveEntryFromPool(iPool, psPagePoolEntry);
+
+		FreePageToLinux(psPagePoolEntry->psPage);
+		LinuxPagePoolEntryFree(psPagePoolEntry);
+
+		uNumFreed++;
+	}
+
+	if (list_empty(&g_asPagePoolList[iPool]))
+	{
+		PVR_ASSERT(atomic_read(&g_asPagePoolEntryCount[iPool]) == 0);
+	}
+
+	return uNumFreed;
+}
+
+/*
+ * Free up to uNumToScan pooled pages, cheapest to replace first: cached
+ * pages, then zeroed pages, then uncached pages (which would need a
+ * cache invalidate when they are next allocated).  Returns the number
+ * freed, or -1 if the page pool lock is busy.
+ */
+static long
+PagePoolShrinkScan(unsigned long uNumToScan)
+{
+	unsigned long uNumFreed = 0;
+
+	PVR_DPF((PVR_DBG_MESSAGE,"%s: Number to scan: %ld", __FUNCTION__, uNumToScan));
+	PVR_DPF((PVR_DBG_MESSAGE,"%s: Pages in pool before scan: %d", __FUNCTION__, PagePoolEntryCount()));
+
+	if (!PagePoolTrylock())
+	{
+		PVR_TRACE(("%s: Couldn't get page pool lock", __FUNCTION__));
+		return -1;
+	}
+
+	uNumFreed += PagePoolShrinkList(LINUX_PAGE_POOL_CACHED, uNumToScan);
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+	if (uNumFreed < uNumToScan)
+	{
+		uNumFreed += FreeZeroPagePool(uNumToScan - uNumFreed);
+	}
+#endif
+	if (uNumFreed < uNumToScan)
+	{
+		uNumFreed += PagePoolShrinkList(LINUX_PAGE_POOL_UNCACHED, uNumToScan - uNumFreed);
+	}
+
+	PagePoolUnlock();
+
+	PVR_DPF((PVR_DBG_MESSAGE,"%s: Pages in pool after scan: %d", __FUNCTION__, PagePoolEntryCount()));
+
+	return (long)uNumFreed;
+}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,12,0))
+static unsigned long
+ShrinkPagePoolCount(struct shrinker *psShrinker, struct shrink_control *psShrinkControl)
+{
+	PVR_ASSERT(psShrinker == &g_sShrinker);
+	(void)psShrinker;
+	(void)psShrinkControl;
+
+	return PagePoolShrinkCount();
+}
+
+static unsigned long
+ShrinkPagePoolScan(struct shrinker *psShrinker, struct shrink_control *psShrinkControl)
+{
+	long lNumFreed;
+
+	PVR_ASSERT(psShrinker == &g_sShrinker);
+	(void)psShrinker;
 
-		PVR_DPF((PVR_DBG_MESSAGE,"%s: Pages in pool after scan: %d", __FUNCTION__, atomic_read(&g_sPagePoolEntryCount)));
+	lNumFreed = PagePoolShrinkScan(psShrinkControl->nr_to_scan);
+
+	return (lNumFreed < 0) ? SHRINK_STOP : (unsigned long)lNumFreed;
+}
+#else
+static int
+ShrinkPagePool(struct shrinker *psShrinker, struct shrink_control *psShrinkControl)
+{
+	unsigned long uNumToScan = psShrinkControl->nr_to_scan;
+
+	PVR_ASSERT(psShrinker == &g_sShrinker);
+	(void)psShrinker;
+
+	if (uNumToScan != 0 && PagePoolShrinkScan(uNumToScan) < 0)
+	{
+		return -1;
 	}
 
-	return atomic_read(&g_sPagePoolEntryCount);
+	return (int)PagePoolShrinkCount();
 }
 #endif
+#endif
 
 static IMG_BOOL
 AllocPages(IMG_UINT32 ui32AreaFlags, struct page ***pppsPageList, IMG_HANDLE *phBlockPageList, IMG_UINT32 ui32NumPages, IMG_BOOL *pbFromPagePool)
@@ -903,7 +1369,9 @@ AllocPages(IMG_UINT32 ui32AreaFlags, struct page ***pppsPageList, IMG_HANDLE *ph
     *pbFromPagePool = IMG_TRUE;
     for(i = 0; i < (IMG_INT32)ui32NumPages; i++)
     {
-        ppsPageList[i] = AllocPage(ui32AreaFlags, &bFromPagePool);
+        ppsPageList[i] = AreaIsZeroed(ui32AreaFlags) ?
+							AllocZeroedPage(ui32AreaFlags, &bFromPagePool) :
+							AllocPage(ui32AreaFlags, &bFromPagePool);
         if (!ppsPageList[i])
         {
             goto failed_alloc_pages;
@@ -931,7 +1399,7 @@ AllocPages(IMG_UINT32 ui32AreaFlags, struct page ***pppsPageList, IMG_HANDLE *ph
 failed_alloc_pages:
     for(i--; i >= 0; i--)
     {
-        FreePage(*pbFromPagePool, ppsPageList[i]);
+        FreePage(PagePoolType(ui32AreaFlags, !*pbFromPagePool), ppsPageList[i]);
     }
     (IMG_VOID) OSFreeMem(0, sizeof(*ppsPageList) * ui32NumPages, ppsPageList, hBlockPageList);
 
@@ -941,13 +1409,13 @@ failed_page_list_alloc:
 
 
 static IMG_VOID
-FreePages(IMG_BOOL bToPagePool, struct page **ppsPageList, IMG_HANDLE hBlockPageList, IMG_UINT32 ui32NumPages)
+FreePages(IMG_INT iPool, struct page **ppsPageList, IMG_HANDLE hBlockPageList, IMG_UINT32 ui32NumPages)
 {
     IMG_INT32 i;
 
     for(i = 0; i < (IMG_INT32)ui32NumPages; i++)
     {
-        FreePage(bToPagePool, ppsPageList[i]);
+        FreePage(iPool, ppsPageList[i]);
     }
 
 #if defined(DEBUG_LINUX_MEMORY_ALLOCATIONS)
@@ -1003,9 +1471,12 @@ NewVMallocLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags)
 #if defined(PVR_LINUX_MEM_AREA_USE_VMAP)
     psLinuxMemArea->uData.sVmalloc.ppsPageList = ppsPageList;
     psLinuxMemArea->uData.sVmalloc.hBlockPageList = hBlockPageList;
+    psLinuxMemArea->bZeroed = AreaIsZeroed(ui32AreaFlags);
 #endif
     psLinuxMemArea->ui32ByteSize = ui32Bytes;
     psLinuxMemArea->ui32AreaFlags = ui32AreaFlags;
+    /* Any stale cache lines are invalidated below, pages can go to the pool */
+    psLinuxMemArea->bNeedsCacheInvalidate = IMG_FALSE;
     INIT_LIST_HEAD(&psLinuxMemArea->sMMapOffsetStructList);
 
 #if defined(DEBUG_LINUX_MEM_AREAS)
@@ -1039,7 +1510,7 @@ failed:
 #if defined(PVR_LINUX_MEM_AREA_USE_VMAP)
     if (ppsPageList)
     {
-	FreePages(bFromPagePool, ppsPageList, hBlockPageList, ui32NumPages);
+	FreePages(PagePoolType(ui32AreaFlags, !bFromPagePool), ppsPageList, hBlockPageList, ui32NumPages);
     }
 #endif
     if (psLinuxMemArea)
@@ -1078,7 +1549,7 @@ FreeVMallocLinuxMemArea(LinuxMemArea *psLinuxMemArea)
     ppsPageList = psLinuxMemArea->uData.sVmalloc.ppsPageList;
     hBlockPageList = psLinuxMemArea->uData.sVmalloc.hBlockPageList;
     
-    FreePages(CanFreeToPool(psLinuxMemArea), ppsPageList, hBlockPageList, ui32NumPages);
+    FreePages(FreeToPoolType(psLinuxMemArea), ppsPageList, hBlockPageList, ui32NumPages);
 #else
 /* PG_reserved was deprecated in linux-2.6.15 */
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,15))
@@ -1437,6 +1908,7 @@ NewAllocPagesLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags)
 
     /* We defer the cache flush to the first user mapping of this memory */
     psLinuxMemArea->bNeedsCacheInvalidate = AreaIsUncached(ui32AreaFlags) && !bFromPagePool;
+    psLinuxMemArea->bZeroed = AreaIsZeroed(ui32AreaFlags);
 
 #if defined(DEBUG_LINUX_MEM_AREAS)
     DebugLinuxMemAreaRecordAdd(psLinuxMemArea, ui32AreaFlags);
@@ -1471,7 +1943,7 @@ FreeAllocPagesLinuxMemArea(LinuxMemArea *psLinuxMemArea)
     ppsPageList = psLinuxMemArea->uData.sPageList.ppsPageList;
     hBlockPageList = psLinuxMemArea->uData.sPageList.hBlockPageList;
     
-    FreePages(CanFreeToPool(psLinuxMemArea), ppsPageList, hBlockPageList, ui32NumPages);
+    FreePages(FreeToPoolType(psLinuxMemArea), ppsPageList, hBlockPageList, ui32NumPages);
   
     LinuxMemAreaStructFree(psLinuxMemArea);
 }
@@ -1521,6 +1993,33 @@ NewIONLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags,
      * use uniformed API */
     ui32NumHandlesPerFd = ui32PrivDataLength / ui32AllocDataLen;
 
+    /* 1D planes of a multi-plane buffer are w * h bytes each (h is 1 for
+     * 1D, see the tiler API); only a lone 1D plane takes the whole size.
+     * Check they add up before allocating anything. */
+    if (ui32NumHandlesPerFd > 1)
+    {
+        IMG_UINT32 ui32NumTilerPlanes = 0;
+
+        for(i = 0; i < ui32NumHandlesPerFd; i++)
+        {
+            const struct omap_ion_tiler_alloc_data *psData =
+                (const struct omap_ion_tiler_alloc_data *)&pbPrivData[i * ui32AllocDataLen];
+
+            if (psData->fmt == TILER_PIXEL_FMT_PAGE)
+                ui32TotalPagesSizeInBytes += PAGE_ALIGN(psData->w * psData->h);
+            else
+                ui32NumTilerPlanes++;
+        }
+
+        if (!ui32NumTilerPlanes && (ui32TotalPagesSizeInBytes != ui32Bytes))
+        {
+            PVR_DPF((PVR_DBG_ERROR, "%s: 1D planes add up to %u bytes, not %u",
+                     __func__, ui32TotalPagesSizeInBytes, ui32Bytes));
+            goto err_free;
+        }
+        ui32TotalPagesSizeInBytes = 0;
+    }
+
     ui32ProcID = OSGetCurrentProcessIDKM();
 
     memset(asAllocData, 0x00, sizeof(asAllocData));
@@ -1562,9 +2061,11 @@ NewIONLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags,
 			/* 1D DMM Buffers */
 			struct scatterlist *sg, *sglist;
 			IMG_UINT32 ui32Num1dPages;
+			IMG_UINT32 ui32PlaneBytes = (ui32NumHandlesPerFd > 1) ?
+				PAGE_ALIGN(asAllocData[i].w * asAllocData[i].h) : ui32Bytes;
 
 			asAllocData[i].handle = ion_alloc (gpsIONClient,
-				ui32Bytes,
+				ui32PlaneBytes,
 				PAGE_SIZE, (1 << OMAP_ION_HEAP_SYSTEM));
 
 			if (asAllocData[i].handle == NULL)
@@ -1582,7 +2083,7 @@ NewIONLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags,
 				goto err_free;
 			}
 
-			ui32Num1dPages = (ui32Bytes >> PAGE_SHIFT);
+			ui32Num1dPages = (ui32PlaneBytes >> PAGE_SHIFT);
 			pu32PageAddrs[i] = kmalloc (sizeof(u32) * ui32Num1dPages, GFP_KERNEL);
 			if (pu32PageAddrs[i] == NULL)
 			{
@@ -1591,9 +2092,16 @@ NewIONLinuxMemArea(IMG_UINT32 ui32Bytes, IMG_UINT32 ui32AreaFlags,
 				goto err_free;
 			}
 
-			for_each_sg (sglist, sg, ui32Num1dPages, j)
+			/* an entry may span several pages */
+			j = 0;
+			for (sg = sglist; sg && (j < ui32Num1dPages); sg = sg_next(sg))
 			{
-				pu32PageAddrs[i][j] = sg_phys (sg);
+				IMG_UINT32 ui32Off;
+
+				for (ui32Off = 0; (ui32Off < sg->length) && (j < ui32Num1dPages); ui32Off += PAGE_SIZE)
+				{
+					pu32PageAddrs[i][j++] = sg_phys (sg) + ui32Off;
+				}
 			}
 
 			iNumPages[i] = ui32Num1dPages;
@@ -1912,7 +2420,13 @@ LinuxMemAreaStructAlloc(IMG_VOID)
     dump_stack();
     return psLinuxMemArea;
 #else
-    return KMemCacheAllocWrapper(g_PsLinuxMemAreaCache, GFP_KERNEL);
+    LinuxMemArea *psLinuxMemArea;
+    psLinuxMemArea = KMemCacheAllocWrapper(g_PsLinuxMemAreaCache, GFP_KERNEL);
+    if (psLinuxMemArea)
+    {
+        psLinuxMemArea->bZeroed = IMG_FALSE;
+    }
+    return psLinuxMemArea;
 #endif
 }
 
@@ -2490,8 +3004,16 @@ static void ProcSeqShowMemoryRecords(struct seq_file *sfile,void* el)
 #endif
 #if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
         seq_printf(sfile, "%-60s: %d pages\n",
-                           "Number of pages in page pool",
-                           atomic_read(&g_sPagePoolEntryCount));
+                           "Number of pages in uncached page pool",
+                           atomic_read(&g_asPagePoolEntryCount[LINUX_PAGE_POOL_UNCACHED]));
+        seq_printf(sfile, "%-60s: %d pages\n",
+                           "Number of pages in cached page pool",
+                           atomic_read(&g_asPagePoolEntryCount[LINUX_PAGE_POOL_CACHED]));
+#endif
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+        seq_printf(sfile, "%-60s: %d pages\n",
+                           "Number of pages in zero page pool",
+                           atomic_read(&g_sZeroPagePoolEntryCount));
 #endif
         seq_printf( sfile, "\n");
         seq_printf(sfile, "%-60s: %d bytes\n",
@@ -2586,7 +3108,7 @@ static void ProcSeqShowMemoryRecords(struct seq_file *sfile,void* el)
 #if (PVR_LINUX_MEM_AREA_POOL_MAX_PAGES != 0)
 		seq_printf(sfile,
                            "<watermark key=\"mr18\" description=\"page_pool_current\" bytes=\"%d\"/>\n",
-                           PAGES_TO_BYTES(atomic_read(&g_sPagePoolEntryCount)));
+                           PAGES_TO_BYTES(PagePoolEntryCount()));
 #endif
 		seq_printf(sfile, "</meminfo_header>\n");
 
@@ -2795,7 +3317,12 @@ static IMG_VOID LinuxMMCleanup_MemRecords_ForEachVa(DEBUG_MEM_ALLOC_REC *psCurre
 #if defined(PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK)
 static struct shrinker g_sShrinker =
 {
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3,12,0))
+	.count_objects = ShrinkPagePoolCount,
+	.scan_objects = ShrinkPagePoolScan,
+#else
 	.shrink = ShrinkPagePool,
+#endif
 	.seeks = DEFAULT_SEEKS
 };
 
@@ -2829,6 +3356,15 @@ LinuxMMCleanup(IMG_VOID)
 	}
 #endif
 
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+    if (g_psZeroPagePoolThread)
+    {
+        kthread_stop(g_psZeroPagePoolThread);
+        g_psZeroPagePoolThread = NULL;
+    }
+    FreeZeroPagePool(0);
+#endif
+
     /*
      * The page pool must be freed after any remaining mem areas, but before
      * the remaining memory resources.
@@ -2931,6 +3467,16 @@ LinuxMMInit(IMG_VOID)
     }
 #endif
 
+#if (PVR_LINUX_MEM_AREA_ZERO_POOL_PAGES != 0)
+    /* Not fatal, allocations then zero their pages themselves */
+    g_psZeroPagePoolThread = kthread_run(ZeroPagePoolThread, NULL, "pvr_zero_pool");
+    if (IS_ERR(g_psZeroPagePoolThread))
+    {
+        PVR_DPF((PVR_DBG_WARNING,"%s: failed to start zero page pool thread", __FUNCTION__));
+        g_psZeroPagePoolThread = NULL;
+    }
+#endif
+
 #if defined(PVR_LINUX_MEM_AREA_POOL_ALLOW_SHRINK)
 	register_shrinker(&g_sShrinker);
 	g_bShrinkerRegistered = IMG_TRUE;
@@ -187,6 +187,8 @@ struct _LinuxMemArea {
 
     IMG_BOOL bNeedsCacheInvalidate;	/* Cache should be invalidated on first map? */
 
+    IMG_BOOL bZeroed;				/* All pages were zeroed when allocated */
+
 	IMG_HANDLE hBMHandle;			/* Handle back to BM for this allocation */
 
     /* List entry for global list of areas registered for mmap */
@@ -747,5 +749,18 @@ const IMG_CHAR *LinuxMemAreaTypeToString(LINUX_MEM_AREA_TYPE eMemAreaType);
 const IMG_CHAR *HAPFlagsToString(IMG_UINT32 ui32Flags);
 #endif
 
+
+/*!
+ *******************************************************************************
+ * @brief Cleans a page's lines from the CPU caches, after the page was
+ *        written through its kernel mapping
+ *
+ * @param psPage  
+ * @param pvPageAddr  kernel virtual address of the page
+ *
+ * @return 
+ ******************************************************************************/
+IMG_VOID LinuxCleanCPUCachePage(struct page *psPage, IMG_VOID *pvPageAddr);
+
 #endif /* __IMG_LINUX_MM_H__ */
 
@@ -65,6 +65,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/sched.h>
 #include <asm/current.h>
 #endif
+#include <linux/hash.h>
 #if defined(SUPPORT_DRI_DRM)
 #include <drm/drmP.h>
 #endif
@@ -105,7 +106,29 @@ PVRSRV_LINUX_MUTEX g_sMMapMutex;
 
 static LinuxKMemCache *g_psMemmapCache = NULL;
 static LIST_HEAD(g_sMMapAreaList);
-static LIST_HEAD(g_sMMapOffsetStructList);
+
+/*
+ * Offset structures waiting for their mmap are hashed on (PID, offset),
+ * so the mmap entry point does not have to walk every pending structure
+ * in the system, and on PID alone, so a disconnecting process only visits
+ * its own.
+ */
+#define	MMAP_OFFSET_HASH_BITS	7
+#define	MMAP_PID_HASH_BITS	5
+static struct list_head g_asMMapOffsetStructHash[1 << MMAP_OFFSET_HASH_BITS];
+static struct list_head g_asMMapOffsetStructPIDHash[1 << MMAP_PID_HASH_BITS];
+
+static inline struct list_head *
+MMapOffsetHashBucket(IMG_UINT32 ui32PID, IMG_UINT32 ui32Offset)
+{
+    return &g_asMMapOffsetStructHash[hash_32(ui32Offset ^ hash_32(ui32PID, 32), MMAP_OFFSET_HASH_BITS)];
+}
+
+static inline struct list_head *
+MMapPIDHashBucket(IMG_UINT32 ui32PID)
+{
+    return &g_asMMapOffsetStructPIDHash[hash_32(ui32PID, MMAP_PID_HASH_BITS)];
+}
 #if defined(DEBUG_LINUX_MMAP_AREAS)
 static IMG_UINT32 g_ui32RegisteredAreas = 0;
 static IMG_UINT32 g_ui32TotalByteSize = 0;
@@ -323,6 +346,7 @@ DestroyOffsetStruct(PKV_OFFSET_STRUCT psOffsetStruct)
     if (psOffsetStruct->bOnMMapList)
     {
         list_del(&psOffsetStruct->sMMapItem);
+        list_del(&psOffsetStruct->sProcItem);
     }
 
 #ifdef DEBUG
@@ -507,7 +531,9 @@ PVRMMapOSMemHandleToMMapData(PVRSRV_PER_PROCESS_DATA *psPerProc,
     * Offset structures representing physical mappings are added to
     * a list, so that they can be located when the memory area is mapped.
     */
-    list_add_tail(&psOffsetStruct->sMMapItem, &g_sMMapOffsetStructList);
+    list_add_tail(&psOffsetStruct->sMMapItem,
+                  MMapOffsetHashBucket(psOffsetStruct->ui32PID, psOffsetStruct->ui32MMapOffset));
+    list_add_tail(&psOffsetStruct->sProcItem, MMapPIDHashBucket(psOffsetStruct->ui32PID));
 
     psOffsetStruct->bOnMMapList = IMG_TRUE;
 
@@ -633,7 +659,7 @@ FindOffsetStructByOffset(IMG_UINT32 ui32Offset, IMG_UINT32 ui32RealByteSize)
 #endif
     IMG_UINT32 ui32PID = OSGetCurrentProcessIDKM();
 
-    list_for_each_entry(psOffsetStruct, &g_sMMapOffsetStructList, sMMapItem)
+    list_for_each_entry(psOffsetStruct, MMapOffsetHashBucket(ui32PID, ui32Offset), sMMapItem)
     {
         if (ui32Offset == psOffsetStruct->ui32MMapOffset && ui32RealByteSize == psOffsetStruct->ui32RealByteSize && psOffsetStruct->ui32PID == ui32PID)
         {
@@ -1063,6 +1089,7 @@ PVRMMap(struct file* pFile, struct vm_area_struct* ps_vma)
     }
 
     list_del(&psOffsetStruct->sMMapItem);
+    list_del(&psOffsetStruct->sProcItem);
     psOffsetStruct->bOnMMapList = IMG_FALSE;
 
     /* Only support shared writeable mappings */
@@ -1521,7 +1548,7 @@ LinuxMMapPerProcessDisconnect(PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc)
 
     LinuxLockMutexNested(&g_sMMapMutex, PVRSRV_LOCK_CLASS_MMAP);
 
-    list_for_each_entry_safe(psOffsetStruct, psTmpOffsetStruct, &g_sMMapOffsetStructList, sMMapItem)
+    list_for_each_entry_safe(psOffsetStruct, psTmpOffsetStruct, MMapPIDHashBucket(ui32PID), sProcItem)
     {
 	if (psOffsetStruct->ui32PID == ui32PID)
 	{
@@ -1583,8 +1610,19 @@ PVRSRV_ERROR LinuxMMapPerProcessHandleOptions(PVRSRV_HANDLE_BASE *psHandleBase)
 IMG_VOID
 PVRMMapInit(IMG_VOID)
 {
+    IMG_UINT32 i;
+
     LinuxInitMutex(&g_sMMapMutex);
 
+    for (i = 0; i < ARRAY_SIZE(g_asMMapOffsetStructHash); i++)
+    {
+        INIT_LIST_HEAD(&g_asMMapOffsetStructHash[i]);
+    }
+    for (i = 0; i < ARRAY_SIZE(g_asMMapOffsetStructPIDHash); i++)
+    {
+        INIT_LIST_HEAD(&g_asMMapOffsetStructPIDHash[i]);
+    }
+
     g_psMemmapCache = KMemCacheCreateWrapper("img-mmap", sizeof(KV_OFFSET_STRUCT), 0, 0);
     if (!g_psMemmapCache)
     {
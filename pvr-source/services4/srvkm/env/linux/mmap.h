@@ -114,9 +114,12 @@ typedef struct KV_OFFSET_STRUCT_TAG
     const IMG_CHAR		*pszName;
 #endif
     
-   /* List entry field for MMap list */
+   /* List entry field for MMap list, hashed on PID and offset */
    struct list_head		sMMapItem;
 
+   /* List entry field for MMap list, hashed on PID */
+   struct list_head		sProcItem;
+
    /* List entry field for per-memory area list */
    struct list_head		sAreaItem;
 }KV_OFFSET_STRUCT, *PKV_OFFSET_STRUCT;
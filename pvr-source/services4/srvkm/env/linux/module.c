@@ -208,6 +208,7 @@ static struct file_operations pvrsrv_fops =
 #endif
 
 PVRSRV_LINUX_MUTEX gPVRSRVLock;
+DECLARE_RWSEM(gPVRSRVSharedLock);
 
 /* PID of process being released */
 IMG_UINT32 gui32ReleasePID;
@@ -482,7 +483,7 @@ PVR_MOD_STATIC void PVRSRVDriverShutdown(LDM_DEV *pDevice)
 		 * processes trying to use the driver after it has been
 		 * shutdown.
 		 */
-		LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+		LinuxLockBridge();
 
 		(void) PVRSRVSetPowerStateKM(PVRSRV_SYS_POWER_STATE_D3);
 	}
@@ -543,7 +544,7 @@ PVR_MOD_STATIC int PVRSRVDriverSuspend(LDM_DEV *pDevice, pm_message_t state)
 
 	if (!bDriverIsSuspended && !bDriverIsShutdown)
 	{
-		LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+		LinuxLockBridge();
 
 		if (PVRSRVSetPowerStateKM(PVRSRV_SYS_POWER_STATE_D3) == PVRSRV_OK)
 		{
@@ -552,7 +553,7 @@ PVR_MOD_STATIC int PVRSRVDriverSuspend(LDM_DEV *pDevice, pm_message_t state)
 		}
 		else
 		{
-			LinuxUnLockMutex(&gPVRSRVLock);
+			LinuxUnLockBridge();
 			res = -EINVAL;
 		}
 	}
@@ -603,7 +604,7 @@ PVR_MOD_STATIC int PVRSRVDriverResume(LDM_DEV *pDevice)
 		if (PVRSRVSetPowerStateKM(PVRSRV_SYS_POWER_STATE_D0) == PVRSRV_OK)
 		{
 			bDriverIsSuspended = IMG_FALSE;
-			LinuxUnLockMutex(&gPVRSRVLock);
+			LinuxUnLockBridge();
 		}
 		else
 		{
@@ -734,7 +735,7 @@ static int PVRSRVOpen(struct inode unref__ * pInode, struct file *pFile)
 	PVRSRV_ENV_PER_PROCESS_DATA *psEnvPerProc;
 #endif
 
-	LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+	LinuxLockBridge();
 
 	ui32PID = OSGetCurrentProcessIDKM();
 
@@ -764,6 +765,7 @@ static int PVRSRVOpen(struct inode unref__ * pInode, struct file *pFile)
 #else
 	psPrivateData->hKernelMemInfo = NULL;
 #endif
+	psPrivateData->psPerProc = IMG_NULL;
 #if defined(SUPPORT_DRI_DRM) && defined(PVR_SECURE_DRM_AUTH_EXPORT)
 	psPrivateData->psDRMFile = pFile;
 
@@ -774,7 +776,7 @@ static int PVRSRVOpen(struct inode unref__ * pInode, struct file *pFile)
 	PRIVATE_DATA(pFile) = psPrivateData;
 	iRet = 0;
 err_unlock:	
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockBridge();
 	return iRet;
 }
 
@@ -805,7 +807,7 @@ static int PVRSRVRelease(struct inode unref__ * pInode, struct file *pFile)
 	PVRSRV_FILE_PRIVATE_DATA *psPrivateData;
 	int err = 0;
 
-	LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+	LinuxLockBridge();
 
 #if defined(SUPPORT_DRI_DRM)
 	psPrivateData = (PVRSRV_FILE_PRIVATE_DATA *)pvPrivData;
@@ -866,7 +868,7 @@ static int PVRSRVRelease(struct inode unref__ * pInode, struct file *pFile)
 	}
 
 err_unlock:
-	LinuxUnLockMutex(&gPVRSRVLock);
+	LinuxUnLockBridge();
 #if defined(SUPPORT_DRI_DRM)
 	return;
 #else
@@ -875,6 +877,80 @@ err_unlock:
 }
 
 
+/*!
+******************************************************************************
+
+ @Function		PVRSRVIsServicesFile
+
+ @Description
+
+ Checks that a file somebody handed us by fd is an open services node, so
+ that its private_data is a PVRSRV_FILE_PRIVATE_DATA.
+
+ @input pFile - the file to check
+
+ @Return IMG_TRUE if it is.
+
+*****************************************************************************/
+IMG_BOOL PVRSRVIsServicesFile(struct file *pFile)
+{
+#if defined(SUPPORT_DRI_DRM)
+	/* private_data belongs to DRM; the per-file data hangs off drm_file */
+	PVR_UNREFERENCED_PARAMETER(pFile);
+	return IMG_FALSE;
+#else
+	return (pFile->f_op == &pvrsrv_fops) ? IMG_TRUE : IMG_FALSE;
+#endif
+}
+
+
+#if (PVRSRV_BM_CACHE_MAX_BYTES > 0) && \
+	(LINUX_VERSION_CODE >= KERNEL_VERSION(3,0,0)) && \
+	(LINUX_VERSION_CODE < KERNEL_VERSION(3,12,0))
+#define PVR_BM_CACHE_SHRINKER
+/*
+ * Under memory pressure, free buffers the buffer manager keeps for reuse.
+ * Reclaim can run from inside a bridge call, so the bridge lock is only
+ * tried.
+ */
+static int
+PVRBMCacheShrink(struct shrinker *psShrinker, struct shrink_control *psShrinkControl)
+{
+	BM_CACHE_STATS sStats;
+	int iRemaining;
+
+	(void)psShrinker;
+
+	if (psShrinkControl->nr_to_scan == 0)
+	{
+		BM_CacheGetStats(&sStats);
+		return (int)(sStats.uBytes >> PAGE_SHIFT);
+	}
+
+	if (!LinuxTryLockMutex(&gPVRSRVLock))
+	{
+		return -1;
+	}
+	if (!down_write_trylock(&gPVRSRVSharedLock))
+	{
+		LinuxUnLockMutex(&gPVRSRVLock);
+		return -1;
+	}
+
+	iRemaining = (int)BM_CacheShrink((IMG_UINT32)psShrinkControl->nr_to_scan);
+
+	LinuxUnLockBridge();
+
+	return iRemaining;
+}
+
+static struct shrinker g_sBMCacheShrinker =
+{
+	.shrink = PVRBMCacheShrink,
+	.seeks = DEFAULT_SEEKS
+};
+#endif
+
 /*!
 ******************************************************************************
 
@@ -1054,6 +1130,10 @@ static int __init PVRCore_Init(void)
 #endif /* defined(PVR_LDM_DEVICE_CLASS) */
 #endif /* !defined(SUPPORT_DRI_DRM) */
 
+#if defined(PVR_BM_CACHE_SHRINKER)
+	register_shrinker(&g_sBMCacheShrinker);
+#endif
+
 	return 0;
 
 #if !defined(SUPPORT_DRI_DRM)
@@ -1137,6 +1217,10 @@ static void __exit PVRCore_Cleanup(void)
 #endif
 	PVR_TRACE(("PVRCore_Cleanup"));
 
+#if defined(PVR_BM_CACHE_SHRINKER)
+	unregister_shrinker(&g_sBMCacheShrinker);
+#endif
+
 #if !defined(PVR_LDM_MODULE)
 	SysAcquireData(&psSysData);
 #endif
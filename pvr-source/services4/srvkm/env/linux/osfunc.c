@@ -69,6 +69,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/capability.h>
 #include <asm/uaccess.h>
 #include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#if defined(PVR_LINUX_MISR_USING_KTHREAD)
+#include <linux/kthread.h>
+#include <linux/moduleparam.h>
+#include <linux/wait.h>
+#endif
 #if defined(PVR_LINUX_MISR_USING_WORKQUEUE) || \
 	defined(PVR_LINUX_MISR_USING_PRIVATE_WORKQUEUE) || \
 	defined(PVR_LINUX_TIMERS_USING_WORKQUEUES) || \
@@ -444,6 +452,16 @@ OSMemHandleToCpuPAddr(IMG_VOID *hOSMemHandle, IMG_UINT32 ui32ByteOffset)
 }
 
 
+IMG_BOOL OSMemHandleIsZeroed(IMG_VOID *hOSMemHandle)
+{
+	LinuxMemArea *psLinuxMemArea = (LinuxMemArea *)hOSMemHandle;
+
+	PVR_ASSERT(psLinuxMemArea);
+
+	return psLinuxMemArea->bZeroed;
+}
+
+
 IMG_BOOL OSMemHandleIsPhysContig(IMG_VOID *hOSMemHandle)
 {
 	LinuxMemArea *psLinuxMemArea = (LinuxMemArea *)hOSMemHandle;
@@ -917,6 +935,171 @@ IMG_UINT32 OSGetPageSize(IMG_VOID)
 }
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,0))
+/*
+	Interrupt to MISR latency
+
+	The ISR wrappers stamp the first interrupt that schedules the MISR. The
+	MISR wrapper then measures how long the MISR took to start after it, and
+	how long PVRSRVMISR (device MISRs, queue processing and the event signal)
+	ran. Both go into power of two histograms in /proc/pvr/misr_latency.
+	MISRs scheduled from outside an interrupt only count towards the run time.
+*/
+#define PVR_MISR_HIST_BUCKETS		12	/* <16us, <32us ... <16384us, the rest */
+#define PVR_MISR_HIST_FIRST_US		16
+
+typedef struct _PVR_MISR_STATS_
+{
+	IMG_UINT64	ui64IRQTimeNs;		/* interrupt the pending MISR serves, 0 if none */
+	IMG_UINT32	ui32Runs;
+	IMG_UINT32	ui32IRQRuns;
+	IMG_UINT32	ui32MaxLatencyUs;
+	IMG_UINT32	ui32MaxRunUs;
+	IMG_UINT32	aui32LatencyHist[PVR_MISR_HIST_BUCKETS];
+	IMG_UINT32	aui32RunHist[PVR_MISR_HIST_BUCKETS];
+} PVR_MISR_STATS;
+
+static PVR_MISR_STATS gsMISRStats;
+static DEFINE_SPINLOCK(gsMISRStatsLock);
+static struct proc_dir_entry *g_psProcMISRLatency = IMG_NULL;
+
+static inline IMG_UINT64 MISRStatsNow(IMG_VOID)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+static IMG_UINT32 MISRStatsBucket(IMG_UINT32 ui32Us)
+{
+	IMG_UINT32 ui32Bucket = 0;
+
+	while ((ui32Bucket < PVR_MISR_HIST_BUCKETS - 1) &&
+		   (ui32Us >= (PVR_MISR_HIST_FIRST_US << ui32Bucket)))
+	{
+		ui32Bucket++;
+	}
+
+	return ui32Bucket;
+}
+
+/* Hard interrupt context, the ISR has just scheduled the MISR */
+static IMG_VOID MISRStatsInterrupt(IMG_UINT64 ui64Now)
+{
+	spin_lock(&gsMISRStatsLock);
+	if (gsMISRStats.ui64IRQTimeNs == 0)
+	{
+		gsMISRStats.ui64IRQTimeNs = ui64Now;
+	}
+	spin_unlock(&gsMISRStatsLock);
+}
+
+/* Runs the MISR for every OS MISR flavour, timing it */
+static IMG_VOID MISRRun(SYS_DATA *psSysData)
+{
+	IMG_UINT64 ui64Start = MISRStatsNow();
+	IMG_UINT64 ui64IRQTimeNs;
+	IMG_UINT32 ui32LatencyUs = 0;
+	IMG_UINT32 ui32RunUs;
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&gsMISRStatsLock, ulFlags);
+	ui64IRQTimeNs = gsMISRStats.ui64IRQTimeNs;
+	gsMISRStats.ui64IRQTimeNs = 0;
+	spin_unlock_irqrestore(&gsMISRStatsLock, ulFlags);
+
+	if (ui64IRQTimeNs != 0 && ui64Start > ui64IRQTimeNs)
+	{
+		ui32LatencyUs = (IMG_UINT32)div_u64(ui64Start - ui64IRQTimeNs, 1000);
+	}
+
+	PVRSRVMISR(psSysData);
+
+	ui32RunUs = (IMG_UINT32)div_u64(MISRStatsNow() - ui64Start, 1000);
+
+	spin_lock_irqsave(&gsMISRStatsLock, ulFlags);
+	gsMISRStats.ui32Runs++;
+	gsMISRStats.aui32RunHist[MISRStatsBucket(ui32RunUs)]++;
+	if (ui32RunUs > gsMISRStats.ui32MaxRunUs)
+	{
+		gsMISRStats.ui32MaxRunUs = ui32RunUs;
+	}
+	if (ui64IRQTimeNs != 0)
+	{
+		gsMISRStats.ui32IRQRuns++;
+		gsMISRStats.aui32LatencyHist[MISRStatsBucket(ui32LatencyUs)]++;
+		if (ui32LatencyUs > gsMISRStats.ui32MaxLatencyUs)
+		{
+			gsMISRStats.ui32MaxLatencyUs = ui32LatencyUs;
+		}
+	}
+	spin_unlock_irqrestore(&gsMISRStatsLock, ulFlags);
+}
+
+static void ProcSeqShowMISRLatency(struct seq_file *sfile, void* el)
+{
+	PVR_MISR_STATS sStats;
+	unsigned long ulFlags;
+	IMG_UINT32 i;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	spin_lock_irqsave(&gsMISRStatsLock, ulFlags);
+	sStats = gsMISRStats;
+	spin_unlock_irqrestore(&gsMISRStatsLock, ulFlags);
+
+	seq_printf(sfile, "runs %u (after interrupt %u)\n"
+					  "max latency %uus\n"
+					  "max run %uus\n"
+					  "%-10s %10s %10s\n",
+			   sStats.ui32Runs, sStats.ui32IRQRuns,
+			   sStats.ui32MaxLatencyUs, sStats.ui32MaxRunUs,
+			   "us", "latency", "run");
+
+	for (i = 0; i < PVR_MISR_HIST_BUCKETS; i++)
+	{
+		if (i < PVR_MISR_HIST_BUCKETS - 1)
+		{
+			seq_printf(sfile, "<%-9u", PVR_MISR_HIST_FIRST_US << i);
+		}
+		else
+		{
+			seq_printf(sfile, ">=%-8u", PVR_MISR_HIST_FIRST_US << (i - 1));
+		}
+		seq_printf(sfile, " %10u %10u\n",
+				   sStats.aui32LatencyHist[i], sStats.aui32RunHist[i]);
+	}
+}
+
+static IMG_VOID MISRStatsInit(IMG_VOID)
+{
+	unsigned long ulFlags;
+
+	spin_lock_irqsave(&gsMISRStatsLock, ulFlags);
+	memset(&gsMISRStats, 0, sizeof(gsMISRStats));
+	spin_unlock_irqrestore(&gsMISRStatsLock, ulFlags);
+
+	if (g_psProcMISRLatency == IMG_NULL)
+	{
+		g_psProcMISRLatency = CreateProcReadEntrySeq("misr_latency",
+													 NULL,
+													 NULL,
+													 ProcSeqShowMISRLatency,
+													 ProcSeq1ElementOff2Element,
+													 NULL);
+		if (g_psProcMISRLatency == IMG_NULL)
+		{
+			PVR_DPF((PVR_DBG_WARNING, "MISRStatsInit: failed to create misr_latency"));
+		}
+	}
+}
+
+static IMG_VOID MISRStatsDeinit(IMG_VOID)
+{
+	if (g_psProcMISRLatency != IMG_NULL)
+	{
+		RemoveProcEntrySeq(g_psProcMISRLatency);
+		g_psProcMISRLatency = IMG_NULL;
+	}
+}
+
 /*!
 ******************************************************************************
 
@@ -935,6 +1118,7 @@ static irqreturn_t DeviceISRWrapper(int irq, void *dev_id
 {
     PVRSRV_DEVICE_NODE *psDeviceNode;
     IMG_BOOL bStatus = IMG_FALSE;
+    IMG_UINT64 ui64Entry = MISRStatsNow();
 
     PVR_UNREFERENCED_PARAMETER(irq);
 
@@ -952,6 +1136,7 @@ static irqreturn_t DeviceISRWrapper(int irq, void *dev_id
 
     if (bStatus)
     {
+		MISRStatsInterrupt(ui64Entry);
 		OSScheduleMISR((IMG_VOID *)psDeviceNode->psSysData);
     }
 
@@ -984,6 +1169,7 @@ static irqreturn_t SystemISRWrapper(int irq, void *dev_id
 {
     SYS_DATA *psSysData;
     IMG_BOOL bStatus = IMG_FALSE;
+    IMG_UINT64 ui64Entry = MISRStatsNow();
 
     PVR_UNREFERENCED_PARAMETER(irq);
 
@@ -1001,6 +1187,7 @@ static irqreturn_t SystemISRWrapper(int irq, void *dev_id
 
     if (bStatus)
     {
+        MISRStatsInterrupt(ui64Entry);
         OSScheduleMISR((IMG_VOID *)psSysData);
     }
 
@@ -1172,6 +1359,165 @@ PVRSRV_ERROR OSUninstallSystemLISR(IMG_VOID *pvSysData)
     return PVRSRV_OK;
 }
 
+#if defined(PVR_LINUX_MISR_USING_KTHREAD)
+/*
+	The MISR runs in its own kernel thread, by default at SCHED_FIFO so that
+	completions are not held up behind other work when the CPUs are loaded.
+*/
+static unsigned int gui32MISRPriority = 1;
+module_param_named(misr_rt_priority, gui32MISRPriority, uint, 0444);
+MODULE_PARM_DESC(misr_rt_priority, "SCHED_FIFO priority of the MISR thread, 0 for SCHED_NORMAL (default 1)");
+
+/*!
+******************************************************************************
+
+ @Function		MISRThread
+
+ @Description	OS dependent MISR thread, runs the MISR each time it is woken
+
+ @Input    pvData - psSysData
+
+ @Return   0
+
+******************************************************************************/
+static int MISRThread(void *pvData)
+{
+	SYS_DATA *psSysData = (SYS_DATA *)pvData;
+	ENV_DATA *psEnvData = (ENV_DATA *)psSysData->pvEnvSpecificData;
+
+	while (!kthread_should_stop())
+	{
+		wait_event_interruptible(psEnvData->sMISRWaitQueue,
+								 atomic_read(&psEnvData->sMISRPending) ||
+								 kthread_should_stop());
+
+		if (atomic_xchg(&psEnvData->sMISRPending, 0))
+		{
+			MISRRun(psSysData);
+		}
+	}
+
+	return 0;
+}
+
+
+/*!
+******************************************************************************
+
+ @Function		OSInstallMISR
+
+ @Description	Installs an OS dependent MISR
+
+ @Input    psSysData
+
+ @Return   error status
+
+******************************************************************************/
+PVRSRV_ERROR OSInstallMISR(IMG_VOID *pvSysData)
+{
+	SYS_DATA *psSysData = (SYS_DATA*)pvSysData;
+	ENV_DATA *psEnvData = (ENV_DATA *)psSysData->pvEnvSpecificData;
+
+	if (psEnvData->bMISRInstalled)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "OSInstallMISR: An MISR has already been installed"));
+		return PVRSRV_ERROR_ISR_ALREADY_INSTALLED;
+	}
+
+	PVR_TRACE(("Installing MISR with cookie %p", pvSysData));
+
+	init_waitqueue_head(&psEnvData->sMISRWaitQueue);
+	atomic_set(&psEnvData->sMISRPending, 0);
+
+	psEnvData->psMISRThread = kthread_create(MISRThread, pvSysData, "pvr_misr");
+	if (IS_ERR(psEnvData->psMISRThread))
+	{
+		PVR_DPF((PVR_DBG_ERROR, "OSInstallMISR: kthread_create failed"));
+		psEnvData->psMISRThread = IMG_NULL;
+		return PVRSRV_ERROR_UNABLE_TO_CREATE_THREAD;
+	}
+
+	if (gui32MISRPriority != 0)
+	{
+		struct sched_param sParam;
+
+		sParam.sched_priority = min_t(unsigned int, gui32MISRPriority, MAX_USER_RT_PRIO - 1);
+		if (sched_setscheduler(psEnvData->psMISRThread, SCHED_FIFO, &sParam) != 0)
+		{
+			PVR_DPF((PVR_DBG_WARNING, "OSInstallMISR: couldn't make the MISR thread real time"));
+		}
+	}
+
+	MISRStatsInit();
+	psEnvData->bMISRInstalled = IMG_TRUE;
+
+	wake_up_process(psEnvData->psMISRThread);
+
+	return PVRSRV_OK;
+}
+
+
+/*!
+******************************************************************************
+
+ @Function		OSUninstallMISR
+
+ @Description	Uninstalls an OS dependent MISR
+
+ @Input    psSysData
+
+ @Return   error status
+
+******************************************************************************/
+PVRSRV_ERROR OSUninstallMISR(IMG_VOID *pvSysData)
+{
+	SYS_DATA *psSysData = (SYS_DATA*)pvSysData;
+	ENV_DATA *psEnvData = (ENV_DATA *)psSysData->pvEnvSpecificData;
+
+	if (!psEnvData->bMISRInstalled)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "OSUninstallMISR: No MISR has been installed"));
+		return PVRSRV_ERROR_ISR_NOT_INSTALLED;
+	}
+
+	PVR_TRACE(("Uninstalling MISR"));
+
+	psEnvData->bMISRInstalled = IMG_FALSE;
+
+	kthread_stop(psEnvData->psMISRThread);
+	psEnvData->psMISRThread = IMG_NULL;
+	MISRStatsDeinit();
+
+	return PVRSRV_OK;
+}
+
+
+/*!
+******************************************************************************
+
+ @Function		OSScheduleMISR
+
+ @Description	Schedules an OS dependent MISR
+
+ @Input    pvSysData
+
+ @Return   error status
+
+******************************************************************************/
+PVRSRV_ERROR OSScheduleMISR(IMG_VOID *pvSysData)
+{
+	SYS_DATA *psSysData = (SYS_DATA*)pvSysData;
+	ENV_DATA *psEnvData = (ENV_DATA*)psSysData->pvEnvSpecificData;
+
+	if (psEnvData->bMISRInstalled)
+	{
+		atomic_set(&psEnvData->sMISRPending, 1);
+		wake_up(&psEnvData->sMISRWaitQueue);
+	}
+
+	return PVRSRV_OK;
+}
+#else	/* defined(PVR_LINUX_MISR_USING_KTHREAD) */
 #if defined(PVR_LINUX_MISR_USING_PRIVATE_WORKQUEUE)
 /*!
 ******************************************************************************
@@ -1196,7 +1542,7 @@ static void MISRWrapper(
 	ENV_DATA *psEnvData = container_of(data, ENV_DATA, sMISRWork);
 	SYS_DATA *psSysData  = (SYS_DATA *)psEnvData->pvMISRData;
 
-	PVRSRVMISR(psSysData);
+	MISRRun(psSysData);
 }
 
 
@@ -1240,6 +1586,7 @@ PVRSRV_ERROR OSInstallMISR(IMG_VOID *pvSysData)
 				);
 
 	psEnvData->pvMISRData = pvSysData;
+	MISRStatsInit();
 	psEnvData->bMISRInstalled = IMG_TRUE;
 
 	return PVRSRV_OK;
@@ -1272,6 +1619,7 @@ PVRSRV_ERROR OSUninstallMISR(IMG_VOID *pvSysData)
 	PVR_TRACE(("Uninstalling MISR"));
 
 	destroy_workqueue(psEnvData->psWorkQueue);
+	MISRStatsDeinit();
 
 	psEnvData->bMISRInstalled = IMG_FALSE;
 
@@ -1328,7 +1676,7 @@ static void MISRWrapper(
 	ENV_DATA *psEnvData = container_of(data, ENV_DATA, sMISRWork);
 	SYS_DATA *psSysData  = (SYS_DATA *)psEnvData->pvMISRData;
 
-	PVRSRVMISR(psSysData);
+	MISRRun(psSysData);
 }
 
 
@@ -1364,6 +1712,7 @@ PVRSRV_ERROR OSInstallMISR(IMG_VOID *pvSysData)
 				);
 
 	psEnvData->pvMISRData = pvSysData;
+	MISRStatsInit();
 	psEnvData->bMISRInstalled = IMG_TRUE;
 
 	return PVRSRV_OK;
@@ -1396,6 +1745,7 @@ PVRSRV_ERROR OSUninstallMISR(IMG_VOID *pvSysData)
 	PVR_TRACE(("Uninstalling MISR"));
 
 	flush_scheduled_work();
+	MISRStatsDeinit();
 
 	psEnvData->bMISRInstalled = IMG_FALSE;
 
@@ -1449,7 +1799,7 @@ static void MISRWrapper(unsigned long data)
 
     psSysData = (SYS_DATA *)data;
     
-    PVRSRVMISR(psSysData);
+    MISRRun(psSysData);
 }
 
 
@@ -1480,6 +1830,7 @@ PVRSRV_ERROR OSInstallMISR(IMG_VOID *pvSysData)
 
     tasklet_init(&psEnvData->sMISRTasklet, MISRWrapper, (unsigned long)pvSysData);
 
+    MISRStatsInit();
     psEnvData->bMISRInstalled = IMG_TRUE;
 
     return PVRSRV_OK;
@@ -1512,6 +1863,7 @@ PVRSRV_ERROR OSUninstallMISR(IMG_VOID *pvSysData)
     PVR_TRACE(("Uninstalling MISR"));
 
     tasklet_kill(&psEnvData->sMISRTasklet);
+    MISRStatsDeinit();
 
     psEnvData->bMISRInstalled = IMG_FALSE;
 
@@ -1545,6 +1897,7 @@ PVRSRV_ERROR OSScheduleMISR(IMG_VOID *pvSysData)
 
 #endif /* #if defined(PVR_LINUX_MISR_USING_WORKQUEUE) */
 #endif /* #if defined(PVR_LINUX_MISR_USING_PRIVATE_WORKQUEUE) */
+#endif /* #if defined(PVR_LINUX_MISR_USING_KTHREAD) */
 
 #endif /* #if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20)) */
 
@@ -2196,6 +2549,15 @@ IMG_VOID OSWriteHWReg(IMG_PVOID pvLinRegBaseAddr, IMG_UINT32 ui32Offset, IMG_UIN
 #endif
 }
 
+IMG_VOID OSWriteHWRegRelaxed(IMG_PVOID pvLinRegBaseAddr, IMG_UINT32 ui32Offset, IMG_UINT32 ui32Value)
+{
+#if !defined(NO_HARDWARE) && defined(writel_relaxed)
+    writel_relaxed(ui32Value, (IMG_PBYTE)pvLinRegBaseAddr+ui32Offset);
+#else
+    OSWriteHWReg(pvLinRegBaseAddr, ui32Offset, ui32Value);
+#endif
+}
+
 #if defined(CONFIG_PCI) && (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,14))
 
 /*!
@@ -4365,6 +4727,14 @@ IMG_BOOL OSInvalidateCPUCacheRangeKM(IMG_HANDLE hOSMemHandle,
 							   x86_flush_cache_range, IMG_NULL);
 }
 
+IMG_VOID LinuxCleanCPUCachePage(struct page *psPage, IMG_VOID *pvPageAddr)
+{
+	PVR_UNREFERENCED_PARAMETER(psPage);
+
+	/* No clean feature on x86 */
+	x86_flush_cache_range(pvPageAddr, (IMG_BYTE *)pvPageAddr + PAGE_SIZE);
+}
+
 #else /* defined(__i386__) */
 
 #if defined(__arm__)
@@ -4455,6 +4825,16 @@ IMG_BOOL OSInvalidateCPUCacheRangeKM(IMG_HANDLE hOSMemHandle,
 							   pvr_dmac_inv_range, outer_inv_range);
 }
 
+IMG_VOID LinuxCleanCPUCachePage(struct page *psPage, IMG_VOID *pvPageAddr)
+{
+	pvr_dmac_clean_range(pvPageAddr, (IMG_BYTE *)pvPageAddr + PAGE_SIZE);
+#if defined(CONFIG_OUTER_CACHE)
+	outer_clean_range(page_to_phys(psPage), page_to_phys(psPage) + PAGE_SIZE);
+#else
+	PVR_UNREFERENCED_PARAMETER(psPage);
+#endif
+}
+
 #else /* defined(__arm__) */
 
 #if defined(__mips__)
@@ -4543,6 +4923,13 @@ IMG_BOOL OSInvalidateCPUCacheRangeKM(IMG_HANDLE hOSMemHandle,
 							   pvr_dma_cache_inv, IMG_NULL);
 }
 
+IMG_VOID LinuxCleanCPUCachePage(struct page *psPage, IMG_VOID *pvPageAddr)
+{
+	PVR_UNREFERENCED_PARAMETER(psPage);
+
+	pvr_dma_cache_wback(pvPageAddr, (IMG_BYTE *)pvPageAddr + PAGE_SIZE);
+}
+
 #else /* defined(__mips__) */
 
 #error "Implement CPU cache flush/clean/invalidate primitives for this CPU!"
@@ -4604,12 +4991,12 @@ IMG_UINT32 OSAtomicRead(IMG_PVOID pvRefCount)
 
 IMG_VOID OSReleaseBridgeLock(IMG_VOID)
 {
-       LinuxUnLockMutex(&gPVRSRVLock);
+       LinuxUnLockBridge();
 }
 
 IMG_VOID OSReacquireBridgeLock(IMG_VOID)
 {
-       LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+       LinuxLockBridge();
 }
 
 typedef struct _OSTime
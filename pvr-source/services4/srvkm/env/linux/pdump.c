@@ -76,6 +76,15 @@ static IMG_VOID DbgSetMarker			(PDBG_STREAM psStream, IMG_UINT32 ui32Marker);
 */
 #define MAX_FILE_SIZE	0x40000000
 
+/*
+	Initial dbgdriv buffer size of each stream, in pages. The buffer only
+	doubles once a write no longer fits, so capture of a large scene stalls
+	in DbgWrite until the client drains it; start bigger to avoid that.
+*/
+#if !defined(PDUMP_STREAM_BUFFER_PAGES)
+#define PDUMP_STREAM_BUFFER_PAGES	10
+#endif
+
 static atomic_t gsPDumpSuspended = ATOMIC_INIT(0);
 
 static PDBGKM_SERVICE_TABLE gpfnDbgDrv = IMG_NULL;
@@ -518,7 +527,7 @@ IMG_VOID PDumpInit(IMG_VOID)
 														DEBUG_CAPMODE_FRAMED,
 														DEBUG_OUTMODE_STREAMENABLE,
 														0,
-														10);
+														PDUMP_STREAM_BUFFER_PAGES);
 
 			gpfnDbgDrv->pfnSetCaptureMode(gsDBGPdumpState.psStream[i],DEBUG_CAPMODE_FRAMED,0xFFFFFFFF, 0xFFFFFFFF, 1);
 			gpfnDbgDrv->pfnSetFrame(gsDBGPdumpState.psStream[i],0);
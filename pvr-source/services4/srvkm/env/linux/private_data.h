@@ -70,6 +70,18 @@ typedef struct
 	IMG_HANDLE hKernelMemInfo;
 #endif
 
+	/*
+	 * Last kernel services handle looked up through this file, and the
+	 * opening process's per-process data it resolved to. The open holds
+	 * a reference on that data, so it lives as long as the file does.
+	 */
+#if defined (SUPPORT_SID_INTERFACE)
+	IMG_SID hKernelServices;
+#else
+	IMG_HANDLE hKernelServices;
+#endif
+	struct _PVRSRV_PER_PROCESS_DATA_ *psPerProc;
+
 #if defined(SUPPORT_DRI_DRM) && defined(PVR_SECURE_DRM_AUTH_EXPORT)
 	/* The private data is on a list in the per-process data structure */
 	struct list_head sDRMAuthListItem;
@@ -91,5 +103,10 @@ typedef struct
 }
 PVRSRV_FILE_PRIVATE_DATA;
 
+struct file;
+
+/* Is this an open services device? Only then is private_data the above. */
+IMG_BOOL PVRSRVIsServicesFile(struct file *pFile);
+
 #endif /* __INCLUDED_PRIVATE_DATA_H_ */
 
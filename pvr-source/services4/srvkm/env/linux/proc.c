@@ -71,6 +71,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "linkage.h"
 
 #include "lists.h"
+#include "buffer_manager.h"
 
 // The proc entry for our /proc/pvr directory
 static struct proc_dir_entry * dir;
@@ -104,6 +105,10 @@ static struct seq_operations pvr_proc_seq_operations =
 static struct proc_dir_entry* g_pProcQueue;
 static struct proc_dir_entry* g_pProcVersion;
 static struct proc_dir_entry* g_pProcSysNodes;
+static struct proc_dir_entry* g_pProcBMCache;
+#if defined(PVRSRV_REFCOUNT_STATS)
+static struct proc_dir_entry* g_pProcRefCounts;
+#endif
 
 #ifdef DEBUG
 static struct proc_dir_entry* g_pProcDebugLevel;
@@ -119,6 +124,11 @@ static void ProcSeqShowVersion(struct seq_file *sfile,void* el);
 static void ProcSeqShowSysNodes(struct seq_file *sfile,void* el);
 static void* ProcSeqOff2ElementSysNodes(struct seq_file * sfile, loff_t off);
 
+static void ProcSeqShowBMCache(struct seq_file *sfile,void* el);
+#if defined(PVRSRV_REFCOUNT_STATS)
+static void ProcSeqShowRefCounts(struct seq_file *sfile,void* el);
+#endif
+
 /*!
 ******************************************************************************
 
@@ -1066,14 +1076,24 @@ IMG_INT CreateProcEntries(IMG_VOID)
 	g_pProcQueue = CreateProcReadEntrySeq("queue", NULL, NULL, ProcSeqShowQueue, ProcSeqOff2ElementQueue, NULL);
 	g_pProcVersion = CreateProcReadEntrySeq("version", NULL, NULL, ProcSeqShowVersion, ProcSeq1ElementHeaderOff2Element, NULL);
 	g_pProcSysNodes = CreateProcReadEntrySeq("nodes", NULL, NULL, ProcSeqShowSysNodes, ProcSeqOff2ElementSysNodes, NULL);
+	g_pProcBMCache = CreateProcReadEntrySeq("bm_cache", NULL, NULL, ProcSeqShowBMCache, ProcSeq1ElementOff2Element, NULL);
 
-	if(!g_pProcQueue || !g_pProcVersion || !g_pProcSysNodes)
+	if(!g_pProcQueue || !g_pProcVersion || !g_pProcSysNodes || !g_pProcBMCache)
     {
         PVR_DPF((PVR_DBG_ERROR, "CreateProcEntries: couldn't make /proc/%s files", PVRProcDirRoot));
 
         return -ENOMEM;
     }
 
+#if defined(PVRSRV_REFCOUNT_STATS)
+	g_pProcRefCounts = CreateProcReadEntrySeq("refcounts", NULL, NULL, ProcSeqShowRefCounts, ProcSeq1ElementOff2Element, NULL);
+	if(!g_pProcRefCounts)
+	{
+		PVR_DPF((PVR_DBG_ERROR, "CreateProcEntries: couldn't make /proc/%s/refcounts", PVRProcDirRoot));
+
+		return -ENOMEM;
+	}
+#endif
 
 #ifdef DEBUG
 
@@ -1224,6 +1244,10 @@ IMG_VOID RemoveProcEntries(IMG_VOID)
 	RemoveProcEntrySeq(g_pProcQueue);
 	RemoveProcEntrySeq(g_pProcVersion);
 	RemoveProcEntrySeq(g_pProcSysNodes);
+	RemoveProcEntrySeq(g_pProcBMCache);
+#if defined(PVRSRV_REFCOUNT_STATS)
+	RemoveProcEntrySeq(g_pProcRefCounts);
+#endif
 
 	while (dir->subdir)
 	{
@@ -1266,6 +1290,72 @@ static void ProcSeqShowVersion(struct seq_file *sfile,void* el)
 	seq_printf( sfile, "System Version String: %s\n", pszSystemVersionString);
 }
 
+/*!
+******************************************************************************
+
+ PURPOSE	:	Print the buffer manager free buffer cache counters to
+				/proc file
+
+ PARAMETERS	:	sfile - /proc seq_file
+				el - Element to print
+*****************************************************************************/
+static void ProcSeqShowBMCache(struct seq_file *sfile,void* el)
+{
+	BM_CACHE_STATS sStats;
+	IMG_UINT32 ui32Hits, ui32Lookups;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	BM_CacheGetStats(&sStats);
+
+	/* Scale down rather than do a 64-bit divide for the percentage */
+	ui32Hits = sStats.ui32Hits;
+	ui32Lookups = sStats.ui32Hits + sStats.ui32Misses;
+	while (ui32Lookups > 0x1000000)
+	{
+		ui32Hits >>= 1;
+		ui32Lookups >>= 1;
+	}
+
+	seq_printf(sfile,
+			"Limit: %u bytes, %u ms\n"
+			"Hits: %u Misses: %u (%u%% hit)\n"
+			"Inserts: %u\n"
+			"Evictions: age %u budget %u shrink %u flush %u\n"
+			"Cached: %u buffers, %u bytes\n",
+			(IMG_UINT)PVRSRV_BM_CACHE_MAX_BYTES,
+			(IMG_UINT)PVRSRV_BM_CACHE_MAX_AGE_MS,
+			sStats.ui32Hits, sStats.ui32Misses,
+			ui32Lookups ? (ui32Hits * 100) / ui32Lookups : 0,
+			sStats.ui32Inserts,
+			sStats.ui32EvictAge, sStats.ui32EvictBudget,
+			sStats.ui32EvictShrink, sStats.ui32EvictFlush,
+			sStats.ui32Buffers, (IMG_UINT)sStats.uBytes);
+}
+
+#if defined(PVRSRV_REFCOUNT_STATS)
+/*****************************************************************************
+ PURPOSE	:	Print the number of live reference counted objects of each
+				type to /proc file
+
+ PARAMETERS	:	sfile - /proc seq_file
+				el - Element to print
+*****************************************************************************/
+static void ProcSeqShowRefCounts(struct seq_file *sfile,void* el)
+{
+	IMG_UINT32 i;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	for (i = 0; i < PVRSRV_REFCOUNT_STAT_COUNT; i++)
+	{
+		seq_printf(sfile, "%-16s %u\n",
+				   PVRSRVRefCountStatName((PVRSRV_REFCOUNT_STAT)i),
+				   PVRSRVRefCountStatRead((PVRSRV_REFCOUNT_STAT)i));
+	}
+}
+#endif
+
 /*!
 ******************************************************************************
 
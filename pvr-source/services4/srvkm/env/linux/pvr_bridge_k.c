@@ -41,11 +41,18 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */ /**************************************************************************/
 
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#endif
+
 #include "img_defs.h"
 #include "services.h"
 #include "pvr_bridge.h"
 #include "perproc.h"
 #include "mutex.h"
+#include "lock.h"
 #include "syscommon.h"
 #include "pvr_debug.h"
 #include "proc.h"
@@ -84,15 +91,59 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #if defined(DEBUG_BRIDGE_KM)
 
+/*
+ * /proc/pvr/bridge_stats and /proc/pvr/bridge_stats_bin print a snapshot
+ * of the counters, taken when a read starts at the top of the file. Only
+ * g_sBridgeStatsMutex is held while they are read, never the bridge lock,
+ * so polling them does not hold up clients. The counters are word sized
+ * and read as they are being updated, so a snapshot can be a call out
+ * between two of them.
+ *
+ * bridge_stats_bin is a BRIDGE_STATS_BIN_HEADER followed by ui32EntryCount
+ * BRIDGE_STATS_BIN_ENTRYs indexed by bridge ID, all in native byte order.
+ */
+#define BRIDGE_STATS_BIN_MAGIC	0x53425650	/* "PVBS" */
+
+typedef struct _BRIDGE_STATS_BIN_HEADER_
+{
+	IMG_UINT32 ui32Magic;
+	IMG_UINT32 ui32EntryCount;
+	PVRSRV_BRIDGE_GLOBAL_STATS sGlobalStats;
+} BRIDGE_STATS_BIN_HEADER;
+
+typedef struct _BRIDGE_STATS_BIN_ENTRY_
+{
+	IMG_UINT32 ui32CallCount;
+	IMG_UINT32 ui32CopyFromUserTotalBytes;
+	IMG_UINT32 ui32CopyToUserTotalBytes;
+} BRIDGE_STATS_BIN_ENTRY;
+
 static struct proc_dir_entry *g_ProcBridgeStats =0;
+static struct proc_dir_entry *g_ProcBridgeStatsBin;
+static PVRSRV_LINUX_MUTEX g_sBridgeStatsMutex;
+static BRIDGE_STATS_BIN_HEADER g_sBridgeStatsHeader;
+static BRIDGE_STATS_BIN_ENTRY g_asBridgeStats[BRIDGE_DISPATCH_TABLE_ENTRY_COUNT];
 static void* ProcSeqNextBridgeStats(struct seq_file *sfile,void* el,loff_t off);
 static void ProcSeqShowBridgeStats(struct seq_file *sfile,void* el);
+static void ProcSeqShowBridgeStatsBin(struct seq_file *sfile,void* el);
 static void* ProcSeqOff2ElementBridgeStats(struct seq_file * sfile, loff_t off);
 static void ProcSeqStartstopBridgeStats(struct seq_file *sfile,IMG_BOOL start);
 
 #endif
 
-extern PVRSRV_LINUX_MUTEX gPVRSRVLock;
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+
+static struct proc_dir_entry *g_ProcBridgeLockStats;
+static struct proc_dir_entry *g_ProcBridgeLockTop;
+static DEFINE_SPINLOCK(g_sBridgeLockStatsLock);
+static IMG_BOOL g_bBridgeLockStatsEnabled = IMG_TRUE;
+static void ProcSeqShowBridgeLockTop(struct seq_file *sfile,void* el);
+static void* ProcSeqNextBridgeLockStats(struct seq_file *sfile,void* el,loff_t off);
+static void ProcSeqShowBridgeLockStats(struct seq_file *sfile,void* el);
+static void* ProcSeqOff2ElementBridgeLockStats(struct seq_file * sfile, loff_t off);
+static IMG_INT ProcBridgeLockStatsReset(struct file *file, const IMG_CHAR *buffer, IMG_UINT32 count, IMG_VOID *data);
+
+#endif
 
 #if defined(SUPPORT_MEMINFO_IDS)
 static IMG_UINT64 ui64Stamp;
@@ -103,6 +154,8 @@ LinuxBridgeInit(IMG_VOID)
 {
 #if defined(DEBUG_BRIDGE_KM)
 	{
+		LinuxInitMutex(&g_sBridgeStatsMutex);
+
 		g_ProcBridgeStats = CreateProcReadEntrySeq(
 												  "bridge_stats", 
 												  NULL,
@@ -115,6 +168,42 @@ LinuxBridgeInit(IMG_VOID)
 		{
 			return PVRSRV_ERROR_OUT_OF_MEMORY;
 		}
+
+		g_ProcBridgeStatsBin = CreateProcReadEntrySeq(
+												  "bridge_stats_bin",
+												  NULL,
+												  ProcSeqNextBridgeStats,
+												  ProcSeqShowBridgeStatsBin,
+												  ProcSeqOff2ElementBridgeStats,
+												  ProcSeqStartstopBridgeStats
+												 );
+		if(!g_ProcBridgeStatsBin)
+		{
+			return PVRSRV_ERROR_OUT_OF_MEMORY;
+		}
+	}
+#endif
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	g_ProcBridgeLockStats = CreateProcEntrySeq("bridge_lock_stats",
+											   NULL,
+											   ProcSeqNextBridgeLockStats,
+											   ProcSeqShowBridgeLockStats,
+											   ProcSeqOff2ElementBridgeLockStats,
+											   NULL,
+											   (IMG_VOID*)ProcBridgeLockStatsReset);
+	if(!g_ProcBridgeLockStats)
+	{
+		return PVRSRV_ERROR_OUT_OF_MEMORY;
+	}
+	g_ProcBridgeLockTop = CreateProcReadEntrySeq("bridge_lock_top",
+												 NULL,
+												 NULL,
+												 ProcSeqShowBridgeLockTop,
+												 ProcSeq1ElementOff2Element,
+												 NULL);
+	if(!g_ProcBridgeLockTop)
+	{
+		return PVRSRV_ERROR_OUT_OF_MEMORY;
 	}
 #endif
 	return CommonBridgeInit();
@@ -124,14 +213,20 @@ IMG_VOID
 LinuxBridgeDeInit(IMG_VOID)
 {
 #if defined(DEBUG_BRIDGE_KM)
+    RemoveProcEntrySeq(g_ProcBridgeStatsBin);
     RemoveProcEntrySeq(g_ProcBridgeStats);
 #endif
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	RemoveProcEntrySeq(g_ProcBridgeLockTop);
+	RemoveProcEntrySeq(g_ProcBridgeLockStats);
+#endif
 }
 
 #if defined(DEBUG_BRIDGE_KM)
 
 /*
- * Lock MMap regions list (called on page start/stop while reading /proc/mmap)
+ * Lock the stats snapshot (called on page start/stop while reading
+ * /proc/pvr/bridge_stats or /proc/pvr/bridge_stats_bin)
  *
  * sfile : seq_file that handles /proc file
  * start : TRUE if it's start, FALSE if it's stop
@@ -141,11 +236,30 @@ static void ProcSeqStartstopBridgeStats(struct seq_file *sfile,IMG_BOOL start)
 {
 	if(start) 
 	{
-		LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+		LinuxLockMutex(&g_sBridgeStatsMutex);
 	}
 	else
 	{
-		LinuxUnLockMutex(&gPVRSRVLock);
+		LinuxUnLockMutex(&g_sBridgeStatsMutex);
+	}
+}
+
+/*
+ * Copy the bridge counters into the snapshot, with g_sBridgeStatsMutex held
+ */
+static void BridgeStatsSnapshot(void)
+{
+	IMG_UINT32 i;
+
+	g_sBridgeStatsHeader.ui32Magic = BRIDGE_STATS_BIN_MAGIC;
+	g_sBridgeStatsHeader.ui32EntryCount = BRIDGE_DISPATCH_TABLE_ENTRY_COUNT;
+	g_sBridgeStatsHeader.sGlobalStats = g_BridgeGlobalStats;
+
+	for(i = 0; i < BRIDGE_DISPATCH_TABLE_ENTRY_COUNT; i++)
+	{
+		g_asBridgeStats[i].ui32CallCount = g_BridgeDispatchTable[i].ui32CallCount;
+		g_asBridgeStats[i].ui32CopyFromUserTotalBytes = g_BridgeDispatchTable[i].ui32CopyFromUserTotalBytes;
+		g_asBridgeStats[i].ui32CopyToUserTotalBytes = g_BridgeDispatchTable[i].ui32CopyToUserTotalBytes;
 	}
 }
 
@@ -164,6 +278,7 @@ static void* ProcSeqOff2ElementBridgeStats(struct seq_file *sfile, loff_t off)
 {
 	if(!off) 
 	{
+		BridgeStatsSnapshot();
 		return PVR_PROC_SEQ_START_TOKEN;
 	}
 
@@ -173,7 +288,7 @@ static void* ProcSeqOff2ElementBridgeStats(struct seq_file *sfile, loff_t off)
 	}
 
 
-	return (void*)&g_BridgeDispatchTable[off-1];
+	return (void*)&g_asBridgeStats[off-1];
 }
 
 /*
@@ -200,7 +315,8 @@ static void* ProcSeqNextBridgeStats(struct seq_file *sfile,void* el,loff_t off)
 */
 static void ProcSeqShowBridgeStats(struct seq_file *sfile,void* el)
 {
-	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY *psEntry = (	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY*)el;
+	BRIDGE_STATS_BIN_ENTRY *psStats = (BRIDGE_STATS_BIN_ENTRY*)el;
+	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY *psEntry;
 
 	if(el == PVR_PROC_SEQ_START_TOKEN) 
 	{
@@ -210,10 +326,10 @@ static void ProcSeqShowBridgeStats(struct seq_file *sfile,void* el)
 						  "Total number of bytes copied via copy_to_user = %u\n"
 						  "Total number of bytes copied via copy_*_user = %u\n\n"
 						  "%-45s | %-40s | %10s | %20s | %10s\n",
-						  g_BridgeGlobalStats.ui32IOCTLCount,
-						  g_BridgeGlobalStats.ui32TotalCopyFromUserBytes,
-						  g_BridgeGlobalStats.ui32TotalCopyToUserBytes,
-						  g_BridgeGlobalStats.ui32TotalCopyFromUserBytes+g_BridgeGlobalStats.ui32TotalCopyToUserBytes,
+						  g_sBridgeStatsHeader.sGlobalStats.ui32IOCTLCount,
+						  g_sBridgeStatsHeader.sGlobalStats.ui32TotalCopyFromUserBytes,
+						  g_sBridgeStatsHeader.sGlobalStats.ui32TotalCopyToUserBytes,
+						  g_sBridgeStatsHeader.sGlobalStats.ui32TotalCopyFromUserBytes+g_sBridgeStatsHeader.sGlobalStats.ui32TotalCopyToUserBytes,
 						  "Bridge Name",
 						  "Wrapper Function",
 						  "Call Count",
@@ -223,17 +339,262 @@ static void ProcSeqShowBridgeStats(struct seq_file *sfile,void* el)
 		return;
 	}
 
+	psEntry = &g_BridgeDispatchTable[psStats - g_asBridgeStats];
+
 	seq_printf(sfile,
 				   "%-45s   %-40s   %-10u   %-20u   %-10u\n",
 				   psEntry->pszIOCName,
 				   psEntry->pszFunctionName,
-				   psEntry->ui32CallCount,
-				   psEntry->ui32CopyFromUserTotalBytes,
-				   psEntry->ui32CopyToUserTotalBytes);
+				   psStats->ui32CallCount,
+				   psStats->ui32CopyFromUserTotalBytes,
+				   psStats->ui32CopyToUserTotalBytes);
+}
+
+/*
+ * Show bridge stats element in binary (called when reading
+ * /proc/pvr/bridge_stats_bin)
+
+ * sfile : seq_file that handles /proc file
+ * el : actual element
+ *  
+*/
+static void ProcSeqShowBridgeStatsBin(struct seq_file *sfile,void* el)
+{
+	if(el == PVR_PROC_SEQ_START_TOKEN) 
+	{
+		seq_write(sfile, &g_sBridgeStatsHeader, sizeof(g_sBridgeStatsHeader));
+		return;
+	}
+
+	seq_write(sfile, el, sizeof(BRIDGE_STATS_BIN_ENTRY));
 }
 
 #endif /* DEBUG_BRIDGE_KM */
 
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+
+/*
+ * Per bridge ID bridge lock wait and hold times, in
+ * /proc/pvr/bridge_lock_stats. Writing anything to the file clears them.
+ *
+ * Hold time runs from taking the lock in PVRSRV_BridgeDispatchKM to
+ * dropping it there, so it includes any time a call spent in an event
+ * object wait or OSReleaseBridgeLock with the lock dropped. Calls taking
+ * the lock shared are marked with an S.
+ *
+ * Writing 0 stops the timing, 1 restarts it; either also clears the stats.
+ * /proc/pvr/bridge_lock_top ranks the BRIDGE_LOCK_TOP_N calls holding the
+ * lock for longest in total.
+ */
+#define BRIDGE_LOCK_TOP_N	10
+
+static IMG_VOID BridgeLockStatsRecord(IMG_UINT32 ui32BridgeID,
+									  ktime_t sRequested,
+									  ktime_t sAcquired,
+									  ktime_t sReleased)
+{
+	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY *psEntry;
+	IMG_UINT64 ui64WaitNs = ktime_to_ns(ktime_sub(sAcquired, sRequested));
+	IMG_UINT64 ui64HoldNs = ktime_to_ns(ktime_sub(sReleased, sAcquired));
+
+	if(ui32BridgeID >= BRIDGE_DISPATCH_TABLE_ENTRY_COUNT)
+	{
+		return;
+	}
+	psEntry = &g_BridgeDispatchTable[ui32BridgeID];
+
+	/* shared calls update these concurrently */
+	spin_lock(&g_sBridgeLockStatsLock);
+	psEntry->ui32LockCount++;
+	psEntry->ui64LockWaitTotalNs += ui64WaitNs;
+	if(ui64WaitNs > psEntry->ui64LockWaitMaxNs)
+	{
+		psEntry->ui64LockWaitMaxNs = ui64WaitNs;
+	}
+	psEntry->ui64LockHoldTotalNs += ui64HoldNs;
+	if(ui64HoldNs > psEntry->ui64LockHoldMaxNs)
+	{
+		psEntry->ui64LockHoldMaxNs = ui64HoldNs;
+	}
+	spin_unlock(&g_sBridgeLockStatsLock);
+}
+
+static IMG_INT ProcBridgeLockStatsReset(struct file *file, const IMG_CHAR *buffer, IMG_UINT32 count, IMG_VOID *data)
+{
+	IMG_UINT32 i;
+
+	IMG_CHAR cMode;
+
+	PVR_UNREFERENCED_PARAMETER(file);
+	PVR_UNREFERENCED_PARAMETER(data);
+
+	if(count > 0 && pvr_copy_from_user(&cMode, (const void __user *)buffer, 1) == 0)
+	{
+		if(cMode == '0')
+		{
+			g_bBridgeLockStatsEnabled = IMG_FALSE;
+		}
+		else if(cMode == '1')
+		{
+			g_bBridgeLockStatsEnabled = IMG_TRUE;
+		}
+	}
+
+	spin_lock(&g_sBridgeLockStatsLock);
+	for(i = 0; i < BRIDGE_DISPATCH_TABLE_ENTRY_COUNT; i++)
+	{
+		g_BridgeDispatchTable[i].ui32LockCount = 0;
+		g_BridgeDispatchTable[i].ui64LockWaitTotalNs = 0;
+		g_BridgeDispatchTable[i].ui64LockWaitMaxNs = 0;
+		g_BridgeDispatchTable[i].ui64LockHoldTotalNs = 0;
+		g_BridgeDispatchTable[i].ui64LockHoldMaxNs = 0;
+	}
+	spin_unlock(&g_sBridgeLockStatsLock);
+
+	return count;
+}
+
+static void* ProcSeqOff2ElementBridgeLockStats(struct seq_file *sfile, loff_t off)
+{
+	if(!off)
+	{
+		return PVR_PROC_SEQ_START_TOKEN;
+	}
+
+	if(off > BRIDGE_DISPATCH_TABLE_ENTRY_COUNT)
+	{
+		return (void*)0;
+	}
+
+	return (void*)&g_BridgeDispatchTable[off-1];
+}
+
+static void* ProcSeqNextBridgeLockStats(struct seq_file *sfile,void* el,loff_t off)
+{
+	return ProcSeqOff2ElementBridgeLockStats(sfile,off);
+}
+
+static void ProcSeqShowBridgeLockStats(struct seq_file *sfile,void* el)
+{
+	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY *psEntry = (PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY*)el;
+	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY sEntry;
+	IMG_UINT32 ui32BridgeID;
+
+	if(el == PVR_PROC_SEQ_START_TOKEN)
+	{
+		seq_printf(sfile,
+				   "%-4s %-45s %10s %14s %12s %14s %12s\n",
+				   "ID",
+				   "Bridge Name",
+				   "Calls",
+				   "Wait Total us",
+				   "Wait Max us",
+				   "Hold Total us",
+				   "Hold Max us");
+		return;
+	}
+
+	spin_lock(&g_sBridgeLockStatsLock);
+	sEntry = *psEntry;
+	spin_unlock(&g_sBridgeLockStatsLock);
+
+	if(!sEntry.ui32LockCount)
+	{
+		return;
+	}
+
+	ui32BridgeID = (IMG_UINT32)(psEntry - g_BridgeDispatchTable);
+	seq_printf(sfile,
+			   "%-3u%c %-45s %10u %14llu %12llu %14llu %12llu\n",
+			   ui32BridgeID,
+			   (sEntry.ui32Flags & PVRSRV_BRIDGE_FLAG_SHARED_LOCK) ? 'S' : ' ',
+#if defined(DEBUG_BRIDGE_KM)
+			   sEntry.pszIOCName,
+#else
+			   "-",
+#endif
+			   sEntry.ui32LockCount,
+			   div_u64(sEntry.ui64LockWaitTotalNs, 1000),
+			   div_u64(sEntry.ui64LockWaitMaxNs, 1000),
+			   div_u64(sEntry.ui64LockHoldTotalNs, 1000),
+			   div_u64(sEntry.ui64LockHoldMaxNs, 1000));
+}
+
+static void ProcSeqShowBridgeLockTop(struct seq_file *sfile,void* el)
+{
+	IMG_UINT32 aui32ID[BRIDGE_LOCK_TOP_N];
+	PVRSRV_BRIDGE_DISPATCH_TABLE_ENTRY asTop[BRIDGE_LOCK_TOP_N];
+	IMG_UINT64 ui64HoldAllNs = 0;
+	IMG_UINT32 ui32Found = 0;
+	IMG_UINT32 i, j;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	/* Insertion into a short sorted list, one pass over the table */
+	spin_lock(&g_sBridgeLockStatsLock);
+	for(i = 0; i < BRIDGE_DISPATCH_TABLE_ENTRY_COUNT; i++)
+	{
+		IMG_UINT64 ui64Hold = g_BridgeDispatchTable[i].ui64LockHoldTotalNs;
+
+		if(!g_BridgeDispatchTable[i].ui32LockCount)
+		{
+			continue;
+		}
+		ui64HoldAllNs += ui64Hold;
+
+		for(j = ui32Found; j > 0 && asTop[j-1].ui64LockHoldTotalNs < ui64Hold; j--)
+		{
+			if(j < BRIDGE_LOCK_TOP_N)
+			{
+				asTop[j] = asTop[j-1];
+				aui32ID[j] = aui32ID[j-1];
+			}
+		}
+		if(j < BRIDGE_LOCK_TOP_N)
+		{
+			asTop[j] = g_BridgeDispatchTable[i];
+			aui32ID[j] = i;
+			if(ui32Found < BRIDGE_LOCK_TOP_N)
+			{
+				ui32Found++;
+			}
+		}
+	}
+	spin_unlock(&g_sBridgeLockStatsLock);
+
+	seq_printf(sfile,
+			   "%-4s %-4s %-45s %10s %14s %6s %10s %12s\n",
+			   "Rank",
+			   "ID",
+			   "Bridge Name",
+			   "Calls",
+			   "Hold Total us",
+			   "Share",
+			   "Avg us",
+			   "Hold Max us");
+
+	for(i = 0; i < ui32Found; i++)
+	{
+		seq_printf(sfile,
+				   "%-4u %-3u%c %-45s %10u %14llu %5u%% %10llu %12llu\n",
+				   i + 1,
+				   aui32ID[i],
+				   (asTop[i].ui32Flags & PVRSRV_BRIDGE_FLAG_SHARED_LOCK) ? 'S' : ' ',
+#if defined(DEBUG_BRIDGE_KM)
+				   asTop[i].pszIOCName,
+#else
+				   "-",
+#endif
+				   asTop[i].ui32LockCount,
+				   div_u64(asTop[i].ui64LockHoldTotalNs, 1000),
+				   ui64HoldAllNs ? (IMG_UINT32)div64_u64(asTop[i].ui64LockHoldTotalNs * 100, ui64HoldAllNs) : 0,
+				   div_u64(div_u64(asTop[i].ui64LockHoldTotalNs, 1000), asTop[i].ui32LockCount),
+				   div_u64(asTop[i].ui64LockHoldMaxNs, 1000));
+	}
+}
+
+#endif /* DEBUG_BRIDGE_LOCK_STATS */
+
 
 #if defined(SUPPORT_DRI_DRM)
 int
@@ -252,8 +613,12 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 	IMG_UINT32 ui32PID = OSGetCurrentProcessIDKM();
 	PVRSRV_PER_PROCESS_DATA *psPerProc;
 	IMG_INT err = -EFAULT;
-
-	LinuxLockMutexNested(&gPVRSRVLock, PVRSRV_LOCK_CLASS_BRIDGE);
+	IMG_BOOL bShared;
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	ktime_t sLockRequested, sLockAcquired, sLockReleased;
+	/* sampled once, so a call that straddles a toggle has all three times or none */
+	IMG_BOOL bTimed = g_bBridgeLockStatsEnabled;
+#endif
 
 #if defined(SUPPORT_DRI_DRM)
 	psBridgePackageKM = (PVRSRV_BRIDGE_PACKAGE *)arg;
@@ -268,7 +633,7 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 		PVR_DPF((PVR_DBG_ERROR, "%s: Received invalid pointer to function arguments",
 				 __FUNCTION__));
 
-		goto unlock_and_return;
+		return err;
 	}
 	
 	/* FIXME - Currently the CopyFromUserWrapper which collects stats about
@@ -280,25 +645,70 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 					  sizeof(PVRSRV_BRIDGE_PACKAGE))
 	  != PVRSRV_OK)
 	{
-		goto unlock_and_return;
+		return err;
 	}
 #endif
 
 	cmd = psBridgePackageKM->ui32BridgeID;
+
+	/*
+	 * The package is on our stack, so it can be copied in before locking;
+	 * its bridge ID decides whether the call can share the lock.
+	 */
+	bShared = BridgedDispatchIsShared(PVRSRV_GET_BRIDGE_ID(cmd));
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	if(bTimed)
+	{
+		sLockRequested = ktime_get();
+	}
+#endif
+	if(bShared)
+	{
+		down_read(&gPVRSRVSharedLock);
+	}
+	else
+	{
+		LinuxLockBridge();
+	}
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	if(bTimed)
+	{
+		sLockAcquired = ktime_get();
+	}
+#endif
 	
 	if(cmd != PVRSRV_BRIDGE_CONNECT_SERVICES)
 	{
+		PVRSRV_FILE_PRIVATE_DATA *psPrivateData = PRIVATE_DATA(pFile);
 		PVRSRV_ERROR eError;
 
-		eError = PVRSRVLookupHandle(KERNEL_HANDLE_BASE,
-									(IMG_PVOID *)&psPerProc,
-									psBridgePackageKM->hKernelServices,
-									PVRSRV_HANDLE_TYPE_PERPROC_DATA);
-		if(eError != PVRSRV_OK)
+		if(psPrivateData->psPerProc != IMG_NULL &&
+		   psPrivateData->hKernelServices == psBridgePackageKM->hKernelServices)
 		{
-			PVR_DPF((PVR_DBG_ERROR, "%s: Invalid kernel services handle (%d)",
-					 __FUNCTION__, eError));
-			goto unlock_and_return;
+			psPerProc = psPrivateData->psPerProc;
+		}
+		else
+		{
+			eError = PVRSRVLookupHandle(KERNEL_HANDLE_BASE,
+										(IMG_PVOID *)&psPerProc,
+										psBridgePackageKM->hKernelServices,
+										PVRSRV_HANDLE_TYPE_PERPROC_DATA);
+			if(eError != PVRSRV_OK)
+			{
+				PVR_DPF((PVR_DBG_ERROR, "%s: Invalid kernel services handle (%d)",
+						 __FUNCTION__, eError));
+				goto unlock_and_return;
+			}
+
+			/*
+			 * Only the opener's data is pinned by this file. Shared
+			 * calls run concurrently, so leave the cache to the others.
+			 */
+			if(!bShared && psPerProc->ui32PID == psPrivateData->ui32OpenPID)
+			{
+				psPrivateData->hKernelServices = psBridgePackageKM->hKernelServices;
+				psPrivateData->psPerProc = psPerProc;
+			}
 		}
 
 		if(psPerProc->ui32PID != ui32PID)
@@ -519,6 +929,26 @@ PVRSRV_BridgeDispatchKM(struct file *pFile, unsigned int unref__ ioctlCmd, unsig
 	}
 
 unlock_and_return:
-	LinuxUnLockMutex(&gPVRSRVLock);
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	if(bTimed)
+	{
+		sLockReleased = ktime_get();
+	}
+#endif
+	if(bShared)
+	{
+		up_read(&gPVRSRVSharedLock);
+	}
+	else
+	{
+		LinuxUnLockBridge();
+	}
+#if defined(DEBUG_BRIDGE_LOCK_STATS)
+	if(bTimed)
+	{
+		BridgeLockStatsRecord(PVRSRV_GET_BRIDGE_ID(cmd), sLockRequested,
+							  sLockAcquired, sLockReleased);
+	}
+#endif
 	return err;
 }
@@ -102,6 +102,9 @@ struct _BM_MAPPING_
 	 * is remapped with the original alignment restrictions.
 	 */
 	IMG_UINT32			ui32DevVAddrAlignment;
+
+	/* the OS returned zeroed pages and no buffer has used them yet */
+	IMG_BOOL			bZeroed;
 };
 
 /*
@@ -120,8 +123,48 @@ typedef struct _BM_BUF_
 	BM_MAPPING			*pMapping;
 	IMG_UINT32			ui32RefCount;
 	IMG_UINT32			ui32ExportCount;
+
+	/* BM_Alloc arguments, to match the buffer on reuse from the cache */
+	IMG_SIZE_T			uAllocSize;
+	IMG_UINT32			ui32AllocFlags;
+
+	/* context buffer cache links, valid while the buffer is cached */
+	struct _BM_BUF_		*psCacheNext;
+	struct _BM_BUF_		*psCachePrev;
+	IMG_UINT32			ui32CacheFreeFlags;
+	IMG_UINT32			ui32CacheTime;
 } BM_BUF;
 
+/*
+ * Freed buffers of per context heaps are kept, still RA allocated and MMU
+ * mapped, in a per context cache for BM_Alloc calls of the same size and
+ * flags. Buffers age out after PVRSRV_BM_CACHE_MAX_AGE_MS, the cache is
+ * held to PVRSRV_BM_CACHE_MAX_BYTES per context and the OS may shrink it
+ * under memory pressure. A maximum of 0 disables the cache.
+ */
+#if !defined(PVRSRV_BM_CACHE_MAX_BYTES)
+#define PVRSRV_BM_CACHE_MAX_BYTES	0
+#endif
+#if !defined(PVRSRV_BM_CACHE_MAX_AGE_MS)
+#define PVRSRV_BM_CACHE_MAX_AGE_MS	2000
+#endif
+
+/* size classes, class n holds buffers of 2**n -> 2**(n+1) pages */
+#define BM_CACHE_CLASSES			16
+
+typedef struct _BM_CACHE_STATS_
+{
+	IMG_UINT32	ui32Hits;
+	IMG_UINT32	ui32Misses;
+	IMG_UINT32	ui32Inserts;
+	IMG_UINT32	ui32EvictAge;
+	IMG_UINT32	ui32EvictBudget;
+	IMG_UINT32	ui32EvictShrink;
+	IMG_UINT32	ui32EvictFlush;
+	IMG_UINT32	ui32Buffers;
+	IMG_SIZE_T	uBytes;
+} BM_CACHE_STATS;
+
 struct _BM_HEAP_
 {
 	IMG_UINT32				ui32Attribs;
@@ -181,6 +224,13 @@ struct _BM_CONTEXT_
 	*/
 	struct _BM_CONTEXT_ *psNext;
 	struct _BM_CONTEXT_ **ppsThis;
+
+	/*
+	 * Buffer cache, most recently freed first in each size class
+	 */
+	BM_BUF *apsCacheHead[BM_CACHE_CLASSES];
+	BM_BUF *apsCacheTail[BM_CACHE_CLASSES];
+	IMG_SIZE_T uCacheBytes;
 };
 
 /* refcount.c needs to know the internals of this structure */
@@ -553,6 +603,32 @@ IMG_VOID BM_Export(BM_HANDLE hBuf);
 **************************************************************************/
 IMG_VOID BM_FreeExport(BM_HANDLE hBuf, IMG_UINT32 ui32Flags);
 
+/*!
+******************************************************************************
+ @Function	 	BM_CacheShrink
+
+ @Description	Free up to ui32Pages pages of cached buffers, oldest first,
+				from every BM context. Must be called with the bridge lock
+				held.
+
+ @inputs        ui32Pages - pages to free, 0 only counts
+
+ @Return   		pages still cached
+**************************************************************************/
+IMG_UINT32 BM_CacheShrink(IMG_UINT32 ui32Pages);
+
+/*!
+******************************************************************************
+ @Function	 	BM_CacheGetStats
+
+ @Description	Buffer cache statistics, summed over all BM contexts
+
+ @Output        psStats - statistics
+
+ @Return   		None.
+**************************************************************************/
+IMG_VOID BM_CacheGetStats(BM_CACHE_STATS *psStats);
+
 /*!
 ******************************************************************************
  @Function	BM_MappingHandleFromBuffer
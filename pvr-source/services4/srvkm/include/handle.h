@@ -177,6 +177,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *
  * PVRSRV_ERROR PVRSRVPurgeHandles((PVRSRV_HANDLE_BASE *psBase)
  * Purge handles for a handle base that has purging enabled.
+ * PVRSRVReleaseHandle calls it once half of such a table is free.
  */
 
 #if defined (__cplusplus)
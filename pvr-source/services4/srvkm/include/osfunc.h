@@ -472,6 +472,19 @@ static INLINE IMG_CPU_PHYADDR OSMemHandleToCpuPAddr(IMG_HANDLE hOSMemHandle, IMG
 }
 #endif
 
+#if defined(__linux__)
+IMG_BOOL OSMemHandleIsZeroed(IMG_VOID *hOSMemHandle);
+#else
+#ifdef INLINE_IS_PRAGMA
+#pragma inline(OSMemHandleIsZeroed)
+#endif
+static INLINE IMG_BOOL OSMemHandleIsZeroed(IMG_HANDLE hOSMemHandle)
+{
+	PVR_UNREFERENCED_PARAMETER(hOSMemHandle);
+	return IMG_FALSE;
+}
+#endif
+
 #if defined(__linux__)
 IMG_BOOL OSMemHandleIsPhysContig(IMG_VOID *hOSMemHandle);
 #else
@@ -620,6 +633,10 @@ IMG_UINT32 OSReadHWReg(IMG_PVOID pvLinRegBaseAddr, IMG_UINT32 ui32Offset);
 #ifndef OSWriteHWReg
 IMG_VOID OSWriteHWReg(IMG_PVOID pvLinRegBaseAddr, IMG_UINT32 ui32Offset, IMG_UINT32 ui32Value);
 #endif
+/* As OSWriteHWReg, without the barrier: follow a run of these with OSWriteMemoryBarrier() */
+#ifndef OSWriteHWRegRelaxed
+IMG_VOID OSWriteHWRegRelaxed(IMG_PVOID pvLinRegBaseAddr, IMG_UINT32 ui32Offset, IMG_UINT32 ui32Value);
+#endif
 
 typedef IMG_VOID (*PFN_TIMER_FUNC)(IMG_VOID*);
 IMG_HANDLE OSAddTimer(PFN_TIMER_FUNC pfnTimerFunc, IMG_VOID *pvData, IMG_UINT32 ui32MsTimeout);
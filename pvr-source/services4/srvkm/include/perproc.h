@@ -51,6 +51,26 @@ extern "C" {
 
 #include "handle.h"
 
+#if defined(SUPPORT_ION)
+/* ION imports remembered per process for reuse by PVRSRVMapIonHandleKM */
+#define PVRSRV_ION_CACHE_SIZE	16
+/* Parked imports keep their ION buffers alive, bound what they may hold */
+#define PVRSRV_ION_CACHE_MAX_PARKED_BYTES	(16 * 1024 * 1024)
+
+typedef struct _PVRSRV_ION_CACHE_ENTRY_
+{
+	/* Lookup key */
+	IMG_HANDLE		hBufferID;
+	IMG_HANDLE		hDevMemContext;
+	IMG_UINT32		ui32Flags;
+	IMG_UINT32		ui32Size;
+
+	struct _PVRSRV_KERNEL_MEM_INFO_	*psMemInfo;
+	/* Mapped by the client, otherwise parked until reused or evicted */
+	IMG_BOOL		bInUse;
+} PVRSRV_ION_CACHE_ENTRY;
+#endif
+
 typedef struct _PVRSRV_PER_PROCESS_DATA_
 {
 	IMG_UINT32		ui32PID;
@@ -91,6 +111,17 @@ typedef struct _PVRSRV_PER_PROCESS_DATA_
 	 * this field.
 	 */
 	IMG_HANDLE		hOsPrivateData;
+	/* SGX scheduling class and kicks submitted, see sgxutils.c */
+	IMG_UINT32		ui32PriorityClass;
+	IMG_UINT32		ui32KickCount;
+	IMG_UINT32		ui32TransferKickCount;
+#if defined(SUPPORT_ION)
+	/* Least recently used first */
+	PVRSRV_ION_CACHE_ENTRY	asIonCache[PVRSRV_ION_CACHE_SIZE];
+	IMG_UINT32		ui32IonCacheCount;
+	/* Total size of the parked entries */
+	IMG_UINT32		ui32IonCacheParkedBytes;
+#endif
 } PVRSRV_PER_PROCESS_DATA;
 
 PVRSRV_PER_PROCESS_DATA *PVRSRVPerProcessData(IMG_UINT32 ui32PID);
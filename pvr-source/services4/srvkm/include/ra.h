@@ -58,6 +58,13 @@ typedef struct _BM_MAPPING_ BM_MAPPING;
 #define RA_STATS 
 
 
+/** Number of power of 2 buckets in the allocation size histogram. */
+#define RA_STATS_SIZE_BUCKETS 32
+
+/** Number of power of 2 microsecond buckets in the RA_Alloc time
+    histogram, the last one is open ended. */
+#define RA_STATS_TIME_BUCKETS 20
+
 /** Resource arena statistics. */
 struct _RA_STATISTICS_
 {
@@ -90,6 +97,19 @@ struct _RA_STATISTICS_
 
     IMG_SIZE_T uFailedAllocCount;
 
+    /** successful allocations, bucket n counts sizes in 2**n -> 2**(n+1) */
+    IMG_UINT32 auAllocSizeHist[RA_STATS_SIZE_BUCKETS];
+
+    /** RA_Alloc calls, bucket n counts calls that took under 2**n us */
+    IMG_UINT32 auAllocTimeHist[RA_STATS_TIME_BUCKETS];
+
+    /** longest RA_Alloc call in us */
+    IMG_UINT32 uAllocTimeMax;
+
+    /** lowest largest free segment seen after an allocation, and the
+        uCumulativeAllocs value when it was seen */
+    IMG_SIZE_T uLargestFreeLow;
+    IMG_SIZE_T uLargestFreeLowAlloc;
 };
 typedef struct _RA_STATISTICS_ RA_STATISTICS;
 
@@ -44,6 +44,43 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "pvr_bridge_km.h"
 
+#if defined(PVRSRV_REFCOUNT_STATS)
+
+/*
+	Live object counters, cheap enough for release builds. An object is
+	counted while its reference count is non-zero, so a counter that
+	only ever grows points at a leak of that kind of object.
+*/
+typedef enum _PVRSRV_REFCOUNT_STAT_
+{
+	PVRSRV_REFCOUNT_STAT_SYNCINFO = 0,
+	PVRSRV_REFCOUNT_STAT_MEMINFO,
+	PVRSRV_REFCOUNT_STAT_BM_BUF,
+	PVRSRV_REFCOUNT_STAT_BM_BUF_EXPORT,
+	PVRSRV_REFCOUNT_STAT_MMAP_OFFSET,
+	PVRSRV_REFCOUNT_STAT_MMAP_MAPPED,
+	PVRSRV_REFCOUNT_STAT_COUNT
+} PVRSRV_REFCOUNT_STAT;
+
+IMG_VOID PVRSRVRefCountStatInc(PVRSRV_REFCOUNT_STAT eStat);
+IMG_VOID PVRSRVRefCountStatDec(PVRSRV_REFCOUNT_STAT eStat);
+const IMG_CHAR *PVRSRVRefCountStatName(PVRSRV_REFCOUNT_STAT eStat);
+IMG_UINT32 PVRSRVRefCountStatRead(PVRSRV_REFCOUNT_STAT eStat);
+
+#define PVRSRV_REFCOUNT_STAT_ACQUIRED(eStat, ui32NewCount) \
+	do { if ((ui32NewCount) == 1) PVRSRVRefCountStatInc(eStat); } while (0)
+#define PVRSRV_REFCOUNT_STAT_RELEASED(eStat, ui32NewCount) \
+	do { if ((ui32NewCount) == 0) PVRSRVRefCountStatDec(eStat); } while (0)
+
+#else /* defined(PVRSRV_REFCOUNT_STATS) */
+
+#define PVRSRVRefCountStatInc(eStat)
+#define PVRSRVRefCountStatDec(eStat)
+#define PVRSRV_REFCOUNT_STAT_ACQUIRED(eStat, ui32NewCount)
+#define PVRSRV_REFCOUNT_STAT_RELEASED(eStat, ui32NewCount)
+
+#endif /* defined(PVRSRV_REFCOUNT_STATS) */
+
 #if defined(PVRSRV_REFCOUNT_DEBUG)
 
 void PVRSRVDumpRefCountCCB(void);
@@ -134,31 +171,37 @@ static INLINE void PVRSRVKernelSyncInfoDecRef(PVRSRV_KERNEL_SYNC_INFO *psKernelS
 static INLINE void PVRSRVKernelMemInfoIncRef(PVRSRV_KERNEL_MEM_INFO *psKernelMemInfo)
 {
 	psKernelMemInfo->ui32RefCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_MEMINFO, psKernelMemInfo->ui32RefCount);
 }
 
 static INLINE void PVRSRVKernelMemInfoDecRef(PVRSRV_KERNEL_MEM_INFO *psKernelMemInfo)
 {
 	psKernelMemInfo->ui32RefCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_MEMINFO, psKernelMemInfo->ui32RefCount);
 }
 
 static INLINE void PVRSRVBMBufIncRef(BM_BUF *pBuf)
 {
 	pBuf->ui32RefCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_BM_BUF, pBuf->ui32RefCount);
 }
 
 static INLINE void PVRSRVBMBufDecRef(BM_BUF *pBuf)
 {
 	pBuf->ui32RefCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_BM_BUF, pBuf->ui32RefCount);
 }
 
 static INLINE void PVRSRVBMBufIncExport(BM_BUF *pBuf)
 {
 	pBuf->ui32ExportCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_BM_BUF_EXPORT, pBuf->ui32ExportCount);
 }
 
 static INLINE void PVRSRVBMBufDecExport(BM_BUF *pBuf)
 {
 	pBuf->ui32ExportCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_BM_BUF_EXPORT, pBuf->ui32ExportCount);
 }
 
 static INLINE void PVRSRVBMXProcIncRef(IMG_UINT32 ui32Index)
@@ -179,21 +222,25 @@ static INLINE void PVRSRVBMXProcDecRef(IMG_UINT32 ui32Index)
 static INLINE void PVRSRVOffsetStructIncRef(PKV_OFFSET_STRUCT psOffsetStruct)
 {
 	psOffsetStruct->ui32RefCount++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_MMAP_OFFSET, psOffsetStruct->ui32RefCount);
 }
 
 static INLINE void PVRSRVOffsetStructDecRef(PKV_OFFSET_STRUCT psOffsetStruct)
 {
 	psOffsetStruct->ui32RefCount--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_MMAP_OFFSET, psOffsetStruct->ui32RefCount);
 }
 
 static INLINE void PVRSRVOffsetStructIncMapped(PKV_OFFSET_STRUCT psOffsetStruct)
 {
 	psOffsetStruct->ui32Mapped++;
+	PVRSRV_REFCOUNT_STAT_ACQUIRED(PVRSRV_REFCOUNT_STAT_MMAP_MAPPED, psOffsetStruct->ui32Mapped);
 }
 
 static INLINE void PVRSRVOffsetStructDecMapped(PKV_OFFSET_STRUCT psOffsetStruct)
 {
 	psOffsetStruct->ui32Mapped--;
+	PVRSRV_REFCOUNT_STAT_RELEASED(PVRSRV_REFCOUNT_STAT_MMAP_MAPPED, psOffsetStruct->ui32Mapped);
 }
 
 #endif /* defined(__linux__) */
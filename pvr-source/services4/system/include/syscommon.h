@@ -104,6 +104,7 @@ typedef struct _SYS_DATA_TAG_
     IMG_PVOID                   pvEnvSpecificData;      	/*!< Environment specific data */
     IMG_PVOID                   pvSysSpecificData;    	  	/*!< Unique to system, accessible at system layer only */
 	PVRSRV_RESOURCE				sQProcessResource;			/*!< Command Q processing access lock */
+	volatile IMG_BOOL			bQProcessPending;			/*!< Queues need another pass by the sQProcessResource holder */
 	IMG_VOID					*pvSOCRegsBase;				/*!< SOC registers base linear address */
     IMG_HANDLE                  hSOCTimerRegisterOSMemHandle; /*!< SOC Timer register (if present) */
 	IMG_UINT32					*pvSOCTimerRegisterKM;		/*!< SOC Timer register (if present) */
@@ -15,6 +15,7 @@
  */
 
 #include <linux/opp.h>
+#include <linux/ktime.h>
 #include <plat/gpu.h>
 #include "sgxfreq.h"
 
@@ -33,6 +34,27 @@ static struct sgxfreq_data {
 	struct sgxfreq_sgx_data sgx_data;
 	struct device *dev;
 	struct gpu_platform_data *pdata;
+	/* cpufreq-stats like, updated under freq_mutex */
+	int freq_idx;
+	u64 stat_last;			/* jiffies64 of the last change */
+	u64 *time_in_state;		/* jiffies64 per OPP */
+	unsigned int *trans_table;	/* freq_cnt * freq_cnt, [from][to] */
+	unsigned int total_trans;
+	/* floor held for a short while by sgxfreq_boost() */
+	unsigned long freq_boost;
+	bool boost_active;
+	struct delayed_work boost_work;
+	/* lowering the frequency waits for idle and trans_min_ms */
+	bool trans_pending;
+	unsigned long trans_last;	/* jiffies of the last change */
+	unsigned int trans_min_ms;
+	unsigned int trans_defer_ms;
+	unsigned int trans_deferred;
+	unsigned int trans_limited;
+	u64 trans_ns;			/* device_scale time, all changes */
+	u64 trans_max_ns;
+	unsigned int trans_last_us;
+	struct delayed_work trans_work;
 } sfd;
 
 /* Governor init/deinit functions */
@@ -44,6 +66,8 @@ int on3demand_init(void);
 int on3demand_deinit(void);
 int userspace_init(void);
 int userspace_deinit(void);
+int deadline_init(void);
+int deadline_deinit(void);
 
 
 typedef int sgxfreq_gov_init_t(void);
@@ -52,6 +76,7 @@ sgxfreq_gov_init_t *sgxfreq_gov_init[] = {
 	activeidle_init,
 	on3demand_init,
 	userspace_init,
+	deadline_init,
 	NULL,
 };
 
@@ -61,10 +86,14 @@ sgxfreq_gov_deinit_t *sgxfreq_gov_deinit[] = {
 	activeidle_deinit,
 	on3demand_deinit,
 	userspace_deinit,
+	deadline_deinit,
 	NULL,
 };
 
 #define SGXFREQ_DEFAULT_GOV_NAME "on3demand"
+#define SGXFREQ_BOOST_MAX_MS 1000
+#define SGXFREQ_DEFAULT_TRANS_MIN_MS 20
+#define SGXFREQ_DEFAULT_TRANS_DEFER_MS 100
 static unsigned long _idle_curr_time;
 static unsigned long _idle_prev_time;
 static unsigned long _active_curr_time;
@@ -167,6 +196,196 @@ static ssize_t store_governor(struct device *dev,
 		return count;
 }
 
+/* must be called with freq_mutex held */
+static void __stat_account(void)
+{
+	u64 now = get_jiffies_64();
+
+	if (sfd.time_in_state && sfd.freq_idx >= 0)
+		sfd.time_in_state[sfd.freq_idx] += now - sfd.stat_last;
+	sfd.stat_last = now;
+}
+
+static ssize_t show_time_in_state(struct device *dev,
+				  struct device_attribute *attr,
+				  char *buf)
+{
+	int i;
+	ssize_t count = 0;
+
+	if (!sfd.time_in_state)
+		return -ENODEV;
+
+	mutex_lock(&sfd.freq_mutex);
+	__stat_account();
+	for (i = 0; i < sfd.freq_cnt; i++)
+		count += sprintf(&buf[count], "%lu %llu\n", sfd.freq_list[i],
+			(unsigned long long)
+			jiffies_64_to_clock_t(sfd.time_in_state[i]));
+	mutex_unlock(&sfd.freq_mutex);
+
+	return count;
+}
+
+static ssize_t show_total_trans(struct device *dev,
+				struct device_attribute *attr,
+				char *buf)
+{
+	return sprintf(buf, "%u\n", sfd.total_trans);
+}
+
+static ssize_t show_trans_table(struct device *dev,
+				struct device_attribute *attr,
+				char *buf)
+{
+	int i, j;
+	ssize_t count = 0;
+
+	if (!sfd.trans_table)
+		return -ENODEV;
+
+	count += scnprintf(&buf[count], PAGE_SIZE - count, "   From  :    To\n");
+	count += scnprintf(&buf[count], PAGE_SIZE - count, "         : ");
+	for (i = 0; i < sfd.freq_cnt; i++)
+		count += scnprintf(&buf[count], PAGE_SIZE - count, "%10lu ",
+				   sfd.freq_list[i]);
+	count += scnprintf(&buf[count], PAGE_SIZE - count, "\n");
+
+	mutex_lock(&sfd.freq_mutex);
+	for (i = 0; i < sfd.freq_cnt; i++) {
+		count += scnprintf(&buf[count], PAGE_SIZE - count, "%c%9lu: ",
+				   (i == sfd.freq_idx) ? '*' : ' ',
+				   sfd.freq_list[i]);
+		for (j = 0; j < sfd.freq_cnt; j++)
+			count += scnprintf(&buf[count], PAGE_SIZE - count,
+					   "%10u ",
+					   sfd.trans_table[i * sfd.freq_cnt + j]);
+		count += scnprintf(&buf[count], PAGE_SIZE - count, "\n");
+	}
+	mutex_unlock(&sfd.freq_mutex);
+
+	return count;
+}
+
+/*
+ * Time spent in each governor callback, which includes the frequency
+ * change it asks for: how long a notification waits on the decision.
+ */
+static ssize_t show_governor_latency(struct device *dev,
+				     struct device_attribute *attr,
+				     char *buf)
+{
+	ssize_t count = 0;
+	struct sgxfreq_governor *t;
+
+	count += sprintf(&buf[count], "governor calls avg_us max_us\n");
+
+	mutex_lock(&sfd.gov_mutex);
+	list_for_each_entry(t, &sfd.gov_list, governor_list) {
+		if (count >= (ssize_t)PAGE_SIZE - 64)
+			break;
+		count += sprintf(&buf[count], "%s %lu %llu %llu\n", t->name,
+			t->calls,
+			t->calls ? (unsigned long long)
+				div_u64(t->call_ns, t->calls) / 1000 : 0ULL,
+			(unsigned long long)div_u64(t->max_call_ns, 1000));
+	}
+	mutex_unlock(&sfd.gov_mutex);
+
+	return count;
+}
+
+/*
+ * Cost of a frequency change as seen by the caller: device_scale covers
+ * the SGX idle and the timer re-programming in SGXPre/PostClockSpeedChange.
+ */
+static ssize_t show_trans_cost(struct device *dev,
+			       struct device_attribute *attr,
+			       char *buf)
+{
+	u64 avg_ns;
+
+	mutex_lock(&sfd.freq_mutex);
+	avg_ns = sfd.total_trans ? div_u64(sfd.trans_ns, sfd.total_trans) : 0;
+	mutex_unlock(&sfd.freq_mutex);
+
+	return sprintf(buf, "last_us %u\navg_us %llu\nmax_us %llu\n"
+		       "deferred %u\nrate_limited %u\n",
+		       sfd.trans_last_us,
+		       (unsigned long long)div_u64(avg_ns, 1000),
+		       (unsigned long long)div_u64(sfd.trans_max_ns, 1000),
+		       sfd.trans_deferred, sfd.trans_limited);
+}
+
+#define SGXFREQ_TRANS_ATTR(_name, _max)					\
+static ssize_t show_##_name(struct device *dev,				\
+	struct device_attribute *attr, char *buf)			\
+{									\
+	return sprintf(buf, "%u\n", sfd._name);				\
+}									\
+									\
+static ssize_t store_##_name(struct device *dev,			\
+	struct device_attribute *attr, const char *buf, size_t count)	\
+{									\
+	int ret;							\
+	unsigned int val;						\
+									\
+	ret = sscanf(buf, "%u", &val);					\
+	if (ret != 1 || val > (_max))					\
+		return -EINVAL;						\
+									\
+	mutex_lock(&sfd.freq_mutex);					\
+	sfd._name = val;						\
+	mutex_unlock(&sfd.freq_mutex);					\
+									\
+	return count;							\
+}									\
+static DEVICE_ATTR(_name, 0644, show_##_name, store_##_name);
+
+SGXFREQ_TRANS_ATTR(trans_min_ms, 1000)
+SGXFREQ_TRANS_ATTR(trans_defer_ms, 1000)
+
+static ssize_t show_boost_freq(struct device *dev,
+			       struct device_attribute *attr,
+			       char *buf)
+{
+	return sprintf(buf, "%lu\n", sfd.freq_boost);
+}
+
+static ssize_t store_boost_freq(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	int ret;
+	unsigned long freq;
+
+	ret = sscanf(buf, "%lu", &freq);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&sfd.freq_mutex);
+	sfd.freq_boost = sgxfreq_get_freq_ceil(freq);
+	mutex_unlock(&sfd.freq_mutex);
+
+	return count;
+}
+
+static ssize_t store_boost_pulse(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	int ret;
+	unsigned int ms;
+
+	ret = sscanf(buf, "%u", &ms);
+	if (ret != 1)
+		return -EINVAL;
+
+	sgxfreq_boost(ms);
+
+	return count;
+}
+
 static DEVICE_ATTR(frequency_list, 0444, show_frequency_list, NULL);
 static DEVICE_ATTR(frequency_request, 0444, show_frequency_request, NULL);
 static DEVICE_ATTR(frequency_limit, 0444, show_frequency_limit, NULL);
@@ -174,6 +393,13 @@ static DEVICE_ATTR(frequency, 0444, show_frequency, NULL);
 static DEVICE_ATTR(governor_list, 0444, show_governor_list, NULL);
 static DEVICE_ATTR(governor, 0644, show_governor, store_governor);
 static DEVICE_ATTR(stat, 0444, show_stat, NULL);
+static DEVICE_ATTR(boost_freq, 0644, show_boost_freq, store_boost_freq);
+static DEVICE_ATTR(boost_pulse, 0200, NULL, store_boost_pulse);
+static DEVICE_ATTR(time_in_state, 0444, show_time_in_state, NULL);
+static DEVICE_ATTR(total_trans, 0444, show_total_trans, NULL);
+static DEVICE_ATTR(trans_table, 0444, show_trans_table, NULL);
+static DEVICE_ATTR(governor_latency, 0444, show_governor_latency, NULL);
+static DEVICE_ATTR(trans_cost, 0444, show_trans_cost, NULL);
 
 static const struct attribute *sgxfreq_attributes[] = {
 	&dev_attr_frequency_list.attr,
@@ -183,24 +409,148 @@ static const struct attribute *sgxfreq_attributes[] = {
 	&dev_attr_governor_list.attr,
 	&dev_attr_governor.attr,
 	&dev_attr_stat.attr,
+	&dev_attr_boost_freq.attr,
+	&dev_attr_boost_pulse.attr,
+	&dev_attr_trans_min_ms.attr,
+	&dev_attr_trans_defer_ms.attr,
+	NULL
+};
+
+static struct attribute *sgxfreq_stats_attributes[] = {
+	&dev_attr_time_in_state.attr,
+	&dev_attr_total_trans.attr,
+	&dev_attr_trans_table.attr,
+	&dev_attr_governor_latency.attr,
+	&dev_attr_trans_cost.attr,
 	NULL
 };
 
+static struct attribute_group sgxfreq_stats_attr_group = {
+	.attrs = sgxfreq_stats_attributes,
+	.name = "stats",
+};
+
 /************************ end sysfs interface ************************/
 
-static void __set_freq(void)
+/* must be called with freq_mutex held */
+static void __scale(unsigned long freq)
 {
-	unsigned long freq;
+	ktime_t start = ktime_get();
+	u64 ns;
+	int i;
 
-	freq = min(sfd.freq_request, sfd.freq_limit);
-	if (freq != sfd.freq) {
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,4,0))
-		sfd.pdata->device_scale(sfd.dev, sfd.dev, freq);
+	sfd.pdata->device_scale(sfd.dev, sfd.dev, freq);
 #else
-		sfd.pdata->device_scale(sfd.dev, freq);
+	sfd.pdata->device_scale(sfd.dev, freq);
 #endif
-		sfd.freq = freq;
+	sfd.freq = freq;
+	sfd.trans_last = jiffies;
+	sfd.trans_pending = false;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	sfd.trans_last_us = (unsigned int)div_u64(ns, 1000);
+
+	for (i = 0; i < sfd.freq_cnt; i++)
+		if (sfd.freq_list[i] == freq)
+			break;
+	__stat_account();
+	if (sfd.trans_table && sfd.freq_idx >= 0 && i < sfd.freq_cnt) {
+		sfd.trans_table[sfd.freq_idx * sfd.freq_cnt + i]++;
+		sfd.total_trans++;
+		sfd.trans_ns += ns;
+		if (ns > sfd.trans_max_ns)
+			sfd.trans_max_ns = ns;
 	}
+	sfd.freq_idx = (i < sfd.freq_cnt) ? i : -1;
+}
+
+/*
+ * Going up and obeying the thermal limit happen at once. Going down only
+ * saves power, so it waits for the GPU to idle, where SGXPreClockSpeedChange
+ * has nothing to drain, or for trans_defer_ms under constant load, and is
+ * held back until trans_min_ms after the previous change so a governor
+ * bouncing between two OPPs does not stall the GPU every sample.
+ *
+ * must be called with freq_mutex held
+ */
+static void __set_freq(void)
+{
+	unsigned long freq;
+	unsigned long earliest;
+
+	freq = sfd.freq_request;
+	if (sfd.boost_active)
+		freq = max(freq, sfd.freq_boost);
+	freq = min(freq, sfd.freq_limit);
+
+	if (freq == sfd.freq) {
+		sfd.trans_pending = false;
+		return;
+	}
+
+	if (freq > sfd.freq || sfd.freq > sfd.freq_limit) {
+		__scale(freq);
+		return;
+	}
+
+	earliest = sfd.trans_last + msecs_to_jiffies(sfd.trans_min_ms);
+	if (time_before(jiffies, earliest)) {
+		if (!sfd.trans_pending)
+			sfd.trans_limited++;
+		sfd.trans_pending = true;
+		cancel_delayed_work(&sfd.trans_work);
+		schedule_delayed_work(&sfd.trans_work, earliest - jiffies);
+		return;
+	}
+
+	if (sfd.sgx_data.active && sfd.trans_defer_ms) {
+		if (!sfd.trans_pending) {
+			sfd.trans_deferred++;
+			schedule_delayed_work(&sfd.trans_work,
+					      msecs_to_jiffies(sfd.trans_defer_ms));
+		}
+		sfd.trans_pending = true;
+		return;
+	}
+
+	__scale(freq);
+}
+
+/* runs a lowering __set_freq held back, at idle or when its time is up */
+static void __trans_end(struct work_struct *work)
+{
+	unsigned long freq;
+
+	mutex_lock(&sfd.freq_mutex);
+	if (sfd.trans_pending) {
+		freq = sfd.freq_request;
+		if (sfd.boost_active)
+			freq = max(freq, sfd.freq_boost);
+		freq = min(freq, sfd.freq_limit);
+		if (freq != sfd.freq)
+			__scale(freq);
+		sfd.trans_pending = false;
+	}
+	mutex_unlock(&sfd.freq_mutex);
+}
+
+static void __boost_end(struct work_struct *work)
+{
+	mutex_lock(&sfd.freq_mutex);
+	sfd.boost_active = false;
+	__set_freq();
+	mutex_unlock(&sfd.freq_mutex);
+}
+
+static void __gov_call_end(struct sgxfreq_governor *gov, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	gov->calls++;
+	gov->call_ns += ns;
+	if (ns > gov->max_call_ns)
+		gov->max_call_ns = ns;
 }
 
 static struct sgxfreq_governor *__find_governor(const char *name)
@@ -313,8 +663,28 @@ int sgxfreq_init(struct device *dev)
 	}
 	rcu_read_unlock();
 
+	sfd.freq_idx = -1;
+	sfd.stat_last = get_jiffies_64();
+	sfd.time_in_state = kzalloc(sfd.freq_cnt * sizeof(u64), GFP_KERNEL);
+	sfd.trans_table = kzalloc(sfd.freq_cnt * sfd.freq_cnt *
+				  sizeof(unsigned int), GFP_KERNEL);
+	if (!sfd.time_in_state || !sfd.trans_table) {
+		kfree(sfd.time_in_state);
+		kfree(sfd.trans_table);
+		kfree(sfd.freq_list);
+		return -ENOMEM;
+	}
+
 	mutex_init(&sfd.freq_mutex);
 	sfd.freq_limit = sfd.freq_list[sfd.freq_cnt - 1];
+	sfd.freq_boost = sfd.freq_list[sfd.freq_cnt - 1];
+	sfd.boost_active = false;
+	INIT_DELAYED_WORK(&sfd.boost_work, __boost_end);
+	sfd.trans_pending = false;
+	sfd.trans_last = jiffies;
+	sfd.trans_min_ms = SGXFREQ_DEFAULT_TRANS_MIN_MS;
+	sfd.trans_defer_ms = SGXFREQ_DEFAULT_TRANS_DEFER_MS;
+	INIT_DELAYED_WORK(&sfd.trans_work, __trans_end);
 	sgxfreq_set_freq_request(sfd.freq_list[sfd.freq_cnt - 1]);
 	sfd.sgx_data.clk_on = false;
 	sfd.sgx_data.active = false;
@@ -329,6 +699,10 @@ int sgxfreq_init(struct device *dev)
 		return ret;
 	}
 
+	/* statistics are optional */
+	if (sysfs_create_group(sgxfreq_kobj, &sgxfreq_stats_attr_group))
+		pr_warn("sgxfreq: no stats in sysfs\n");
+
 #if defined(CONFIG_THERMAL_FRAMEWORK)
 	cool_init();
 #endif
@@ -353,6 +727,12 @@ int sgxfreq_deinit(void)
 
 	sgxfreq_set_governor(NULL);
 
+	cancel_delayed_work_sync(&sfd.boost_work);
+	sfd.boost_active = false;
+	cancel_delayed_work_sync(&sfd.trans_work);
+	/* the final drop to the lowest OPP is not held back */
+	sfd.trans_defer_ms = 0;
+	sfd.trans_min_ms = 0;
 	sgxfreq_set_freq_request(sfd.freq_list[0]);
 
 #if defined(CONFIG_THERMAL_FRAMEWORK)
@@ -362,9 +742,12 @@ int sgxfreq_deinit(void)
 	for (i = 0; sgxfreq_gov_deinit[i] != NULL; i++)
 		sgxfreq_gov_deinit[i]();
 
+	sysfs_remove_group(sgxfreq_kobj, &sgxfreq_stats_attr_group);
 	sysfs_remove_files(sgxfreq_kobj, sgxfreq_attributes);
 	kobject_put(sgxfreq_kobj);
 
+	kfree(sfd.trans_table);
+	kfree(sfd.time_in_state);
 	kfree(sfd.freq_list);
 
 	return 0;
@@ -410,6 +793,7 @@ int sgxfreq_set_governor(const char *name)
 	if (ret) {
 		if (sfd.gov && sfd.gov->gov_start)
 			sfd.gov->gov_start(&sfd.sgx_data);
+		mutex_unlock(&sfd.gov_mutex);
 		return -ENODEV;
 	}
 	sfd.gov = new_gov;
@@ -507,6 +891,41 @@ unsigned long sgxfreq_set_freq_limit(unsigned long freq_limit)
 	return freq_limit;
 }
 
+/*
+ * Holds the frequency at or above freq_boost for ms, whatever the
+ * governor asks, for work known to be on its way (input, composition
+ * falling back to the GPU). A new pulse restarts the window; the thermal
+ * limit still applies.
+ */
+void sgxfreq_boost(unsigned int ms)
+{
+	if (ms > SGXFREQ_BOOST_MAX_MS)
+		ms = SGXFREQ_BOOST_MAX_MS;
+
+	mutex_lock(&sfd.freq_mutex);
+	if (ms) {
+		sfd.boost_active = true;
+		__set_freq();
+	}
+	mutex_unlock(&sfd.freq_mutex);
+
+	cancel_delayed_work(&sfd.boost_work);
+	schedule_delayed_work(&sfd.boost_work, msecs_to_jiffies(ms));
+}
+
+/* average time a frequency change takes, for governors to weigh it */
+unsigned int sgxfreq_get_trans_cost_us(void)
+{
+	unsigned int us;
+
+	mutex_lock(&sfd.freq_mutex);
+	us = sfd.total_trans ?
+		(unsigned int)div_u64(div_u64(sfd.trans_ns, sfd.total_trans), 1000) : 0;
+	mutex_unlock(&sfd.freq_mutex);
+
+	return us;
+}
+
 unsigned long sgxfreq_get_total_active_time(void)
 {
 	__update_timing_info(sfd.sgx_data.active);
@@ -526,24 +945,34 @@ unsigned long sgxfreq_get_total_idle_time(void)
  */
 void sgxfreq_notif_sgx_clk_on(void)
 {
+	ktime_t start;
+
 	sfd.sgx_data.clk_on = true;
 
 	mutex_lock(&sfd.gov_mutex);
 
-	if (sfd.gov && sfd.gov->sgx_clk_on)
+	if (sfd.gov && sfd.gov->sgx_clk_on) {
+		start = ktime_get();
 		sfd.gov->sgx_clk_on();
+		__gov_call_end(sfd.gov, start);
+	}
 
 	mutex_unlock(&sfd.gov_mutex);
 }
 
 void sgxfreq_notif_sgx_clk_off(void)
 {
+	ktime_t start;
+
 	sfd.sgx_data.clk_on = false;
 
 	mutex_lock(&sfd.gov_mutex);
 
-	if (sfd.gov && sfd.gov->sgx_clk_off)
+	if (sfd.gov && sfd.gov->sgx_clk_off) {
+		start = ktime_get();
 		sfd.gov->sgx_clk_off();
+		__gov_call_end(sfd.gov, start);
+	}
 
 	mutex_unlock(&sfd.gov_mutex);
 }
@@ -551,14 +980,19 @@ void sgxfreq_notif_sgx_clk_off(void)
 
 void sgxfreq_notif_sgx_active(void)
 {
+	ktime_t start;
+
 	__update_timing_info(true);
 
 	sfd.sgx_data.active = true;
 
 	mutex_lock(&sfd.gov_mutex);
 
-	if (sfd.gov && sfd.gov->sgx_active)
+	if (sfd.gov && sfd.gov->sgx_active) {
+		start = ktime_get();
 		sfd.gov->sgx_active();
+		__gov_call_end(sfd.gov, start);
+	}
 
 	mutex_unlock(&sfd.gov_mutex);
 
@@ -566,25 +1000,41 @@ void sgxfreq_notif_sgx_active(void)
 
 void sgxfreq_notif_sgx_idle(void)
 {
+	ktime_t start;
 
 	__update_timing_info(false);
 
 	sfd.sgx_data.active = false;
 
+	/* a lowering waiting for idle goes now, outside the power lock */
+	if (sfd.trans_pending &&
+	    !time_before(jiffies, sfd.trans_last + msecs_to_jiffies(sfd.trans_min_ms))) {
+		cancel_delayed_work(&sfd.trans_work);
+		schedule_delayed_work(&sfd.trans_work, 0);
+	}
+
 	mutex_lock(&sfd.gov_mutex);
 
-	if (sfd.gov && sfd.gov->sgx_idle)
+	if (sfd.gov && sfd.gov->sgx_idle) {
+		start = ktime_get();
 		sfd.gov->sgx_idle();
+		__gov_call_end(sfd.gov, start);
+	}
 
 	mutex_unlock(&sfd.gov_mutex);
 }
 
 void sgxfreq_notif_sgx_frame_done(void)
 {
+	ktime_t start;
+
 	mutex_lock(&sfd.gov_mutex);
 
-	if (sfd.gov && sfd.gov->sgx_frame_done)
+	if (sfd.gov && sfd.gov->sgx_frame_done) {
+		start = ktime_get();
 		sfd.gov->sgx_frame_done();
+		__gov_call_end(sfd.gov, start);
+	}
 
 	mutex_unlock(&sfd.gov_mutex);
 }
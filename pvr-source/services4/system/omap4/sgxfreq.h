@@ -44,6 +44,10 @@ struct sgxfreq_governor {
 	void (*sgx_idle) (void);
 	void (*sgx_frame_done) (void);
 	struct list_head governor_list;
+	/* callback time, kept by sgxfreq */
+	unsigned long calls;
+	u64 call_ns;
+	u64 max_call_ns;
 };
 
 /* sgxfreq_init must be called before any other api */
@@ -70,6 +74,10 @@ unsigned long sgxfreq_get_freq_limit(void);
 unsigned long sgxfreq_set_freq_request(unsigned long freq_request);
 unsigned long sgxfreq_set_freq_limit(unsigned long freq_limit);
 
+void sgxfreq_boost(unsigned int ms);
+
+unsigned int sgxfreq_get_trans_cost_us(void);
+
 unsigned long sgxfreq_get_total_active_time(void);
 unsigned long sgxfreq_get_total_idle_time(void);
 
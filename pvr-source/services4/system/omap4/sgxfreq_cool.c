@@ -15,12 +15,32 @@
  */
 
 #include <linux/thermal_framework.h>
+#include <linux/workqueue.h>
+
+/*
+ * The cooling levels set the limit the cap is heading for, not the cap
+ * itself: it walks there one OPP at a time. Heating steps every
+ * COOL_STEP_DOWN_MS, or jumps half way when the level rose by more than
+ * one since the previous call (a steep temperature slope). Cooling down
+ * only releases the cap after COOL_HOLD_MS without heating, then one OPP
+ * per COOL_STEP_UP_MS, so a level toggling around a trip point does not
+ * swing the GPU between max and capped on every thermal poll.
+ */
+#define COOL_STEP_DOWN_MS	100
+#define COOL_STEP_UP_MS		1000
+#define COOL_HOLD_MS		2000
 
 static int cool_device(struct thermal_dev *dev, int cooling_level);
+static void cool_step(struct work_struct *work);
 
 static struct cool_data {
 	int freq_cnt;
 	unsigned long *freq_list;
+	int target_index;		/* limit asked for by the cooling levels */
+	int limit_index;		/* limit applied */
+	unsigned long last_heat;	/* jiffies of the last lowered target */
+	struct delayed_work work;
+	struct mutex mutex;
 } cd;
 
 static struct thermal_dev_ops cool_dev_ops = {
@@ -47,10 +67,18 @@ static unsigned int case_cooling_level;
 int cool_init(void)
 {
 	int ret;
+
+	/* cool_deinit() runs even when this fails, so set these up first */
+	mutex_init(&cd.mutex);
+	INIT_DELAYED_WORK(&cd.work, cool_step);
+
 	cd.freq_cnt = sgxfreq_get_freq_list(&cd.freq_list);
 	if (!cd.freq_cnt || !cd.freq_list)
 		return -EINVAL;
 
+	cd.target_index = cd.limit_index = cd.freq_cnt - 1;
+	cd.last_heat = jiffies;
+
 	ret = thermal_cooling_dev_register(&cool_dev);
 	if (ret)
 		return ret;
@@ -62,6 +90,52 @@ void cool_deinit(void)
 {
 	thermal_cooling_dev_unregister(&cool_dev);
 	thermal_cooling_dev_unregister(&case_cool_dev);
+	cancel_delayed_work_sync(&cd.work);
+}
+
+/* must be called with cd.mutex held */
+static void __cool_schedule(void)
+{
+	unsigned long delay;
+
+	if (cd.limit_index == cd.target_index)
+		return;
+
+	if (cd.target_index < cd.limit_index) {
+		delay = msecs_to_jiffies(COOL_STEP_DOWN_MS);
+	} else {
+		unsigned long release = cd.last_heat +
+					msecs_to_jiffies(COOL_HOLD_MS);
+
+		delay = msecs_to_jiffies(COOL_STEP_UP_MS);
+		if (time_before(jiffies + delay, release))
+			delay = release - jiffies;
+	}
+
+	schedule_delayed_work(&cd.work, delay);
+}
+
+/* must be called with cd.mutex held */
+static void __cool_apply(int index)
+{
+	cd.limit_index = index;
+	sgxfreq_set_freq_limit(cd.freq_list[index]);
+}
+
+static void cool_step(struct work_struct *work)
+{
+	mutex_lock(&cd.mutex);
+
+	if (cd.target_index < cd.limit_index) {
+		__cool_apply(cd.limit_index - 1);
+	} else if (cd.target_index > cd.limit_index &&
+		   time_after_eq(jiffies, cd.last_heat +
+				 msecs_to_jiffies(COOL_HOLD_MS))) {
+		__cool_apply(cd.limit_index + 1);
+	}
+	__cool_schedule();
+
+	mutex_unlock(&cd.mutex);
 }
 
 static int cool_device(struct thermal_dev *dev, int cooling_level)
@@ -98,7 +172,27 @@ static int cool_device(struct thermal_dev *dev, int cooling_level)
 	if (freq_limit_index < 0)
 		freq_limit_index = 0;
 
-	sgxfreq_set_freq_limit(cd.freq_list[freq_limit_index]);
+	mutex_lock(&cd.mutex);
+
+	if (freq_limit_index < cd.target_index) {
+		int steep = cd.target_index - freq_limit_index > 1;
+
+		cd.last_heat = jiffies;
+		cd.target_index = freq_limit_index;
+		/* first step right away, half the gap when heating up fast */
+		if (cd.limit_index > cd.target_index)
+			__cool_apply(steep ?
+				     cd.target_index +
+				     (cd.limit_index - cd.target_index) / 2 :
+				     cd.limit_index - 1);
+	} else {
+		cd.target_index = freq_limit_index;
+	}
+
+	cancel_delayed_work(&cd.work);
+	__cool_schedule();
+
+	mutex_unlock(&cd.mutex);
 
 	return 0;
 }
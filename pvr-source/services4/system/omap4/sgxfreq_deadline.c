@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2013 Texas Instruments, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linux/sysfs.h>
+#include <linux/jiffies.h>
+#include <linux/slab.h>
+#include "sgxfreq.h"
+
+/*
+ * Frame deadline governor.
+ *
+ * Every sample_ms the GPU busy time is divided by the frames completed to
+ * get the time one frame takes at the current OPP. Assuming that time
+ * scales with 1/freq, the lowest OPP whose predicted frame time fits in
+ * headroom percent of the frame period is requested. Going up is
+ * immediate; going down waits until down_delay samples in a row agree and
+ * the lower OPP fits with hysteresis percent to spare, so a UI hovering
+ * at an OPP edge does not bounce between two.
+ *
+ * A sample with no frame but a busy GPU (long render, first frame) goes to
+ * the highest OPP; a whole sample idle drops to the lowest one and stops
+ * sampling until the next sgx_active.
+ */
+
+static int deadline_start(struct sgxfreq_sgx_data *data);
+static void deadline_stop(void);
+static void deadline_active(void);
+static void deadline_frame_done(void);
+static void deadline_timeout(struct work_struct *work);
+
+static struct sgxfreq_governor deadline_gov = {
+	.name =	"deadline",
+	.gov_start = deadline_start,
+	.gov_stop = deadline_stop,
+	.sgx_active = deadline_active,
+	.sgx_frame_done = deadline_frame_done,
+};
+
+static struct deadline_data {
+	unsigned int frame_period_us;
+	unsigned int headroom;
+	unsigned int hysteresis;
+	unsigned int down_delay;
+	unsigned int sample_ms;
+	unsigned int frames;
+	unsigned int frame_us;		/* last per frame GPU time... */
+	unsigned long frame_freq;	/* ...at this frequency */
+	unsigned int down_cnt;
+	unsigned long sample_start;	/* jiffies */
+	unsigned long prev_total_active;
+	unsigned long prev_total_idle;
+	int freq_idx;
+	unsigned long residency_start;	/* jiffies */
+	u64 *residency_ms;		/* per OPP, while this governor ran */
+	bool polling_enabled;
+	struct delayed_work work;
+	struct mutex mutex;
+} dld;
+
+#define DEADLINE_DEFAULT_FRAME_PERIOD_US	16667
+#define DEADLINE_DEFAULT_HEADROOM		85
+#define DEADLINE_DEFAULT_HYSTERESIS		10
+#define DEADLINE_DEFAULT_DOWN_DELAY		3
+#define DEADLINE_DEFAULT_SAMPLE_MS		50
+
+/* must be called with dld.mutex held */
+static void __deadline_account(void)
+{
+	unsigned long now = jiffies;
+
+	if (dld.residency_ms && dld.freq_idx >= 0)
+		dld.residency_ms[dld.freq_idx] +=
+			jiffies_to_msecs(now - dld.residency_start);
+	dld.residency_start = now;
+}
+
+/* must be called with dld.mutex held */
+static void __deadline_set_idx(int idx)
+{
+	unsigned long *freq_list;
+
+	if (idx == dld.freq_idx)
+		return;
+
+	sgxfreq_get_freq_list(&freq_list);
+	__deadline_account();
+	dld.freq_idx = idx;
+	dld.down_cnt = 0;
+	sgxfreq_set_freq_request(freq_list[idx]);
+}
+
+/*
+ * Lowest OPP at which a frame taking frame_us at cur would fit in pct
+ * percent of the frame period.
+ */
+static int __deadline_pick(unsigned int frame_us, unsigned long cur,
+			   unsigned int pct)
+{
+	unsigned long *freq_list;
+	int i, cnt;
+	u64 budget = (u64)dld.frame_period_us * pct;
+
+	cnt = sgxfreq_get_freq_list(&freq_list);
+	for (i = 0; i < cnt - 1; i++) {
+		/* frame_us * f_cur / f_i <= period * pct / 100 */
+		if ((u64)frame_us * cur * 100 <= budget * freq_list[i])
+			return i;
+	}
+
+	return cnt - 1;
+}
+
+/* must be called with dld.mutex held */
+static void __deadline_sample(bool timeout)
+{
+	unsigned long total_active, total_idle;
+	unsigned long delta_active, delta_idle;
+	unsigned long *freq_list;
+	int up, down;
+
+	total_active = sgxfreq_get_total_active_time();
+	total_idle = sgxfreq_get_total_idle_time();
+	delta_active = __delta32(total_active, dld.prev_total_active);
+	delta_idle = __delta32(total_idle, dld.prev_total_idle);
+	dld.prev_total_active = total_active;
+	dld.prev_total_idle = total_idle;
+	dld.sample_start = jiffies;
+
+	if (!dld.frames) {
+		if (!delta_active && timeout) {
+			/* idle all sample long, park until the next job */
+			__deadline_set_idx(0);
+			dld.polling_enabled = false;
+		} else if (delta_active) {
+			/* busy without completing a frame */
+			__deadline_set_idx(sgxfreq_get_freq_list(&freq_list) - 1);
+		}
+		return;
+	}
+
+	/*
+	 * Measured at the running frequency, which the thermal limit may
+	 * hold below what was requested.
+	 */
+	dld.frame_us = (delta_active * 1000) / dld.frames;
+	dld.frame_freq = sgxfreq_get_freq();
+	dld.frames = 0;
+
+	up = __deadline_pick(dld.frame_us, dld.frame_freq, dld.headroom);
+	if (up > dld.freq_idx) {
+		__deadline_set_idx(up);
+		return;
+	}
+
+	down = __deadline_pick(dld.frame_us, dld.frame_freq,
+			       dld.headroom > dld.hysteresis ?
+			       dld.headroom - dld.hysteresis : 1);
+	if (down < dld.freq_idx) {
+		unsigned int delay = dld.down_delay;
+
+		/* a change costing over 1% of a sample must be agreed once more */
+		if (sgxfreq_get_trans_cost_us() * 100 > dld.sample_ms * 1000)
+			delay++;
+		if (++dld.down_cnt >= delay)
+			__deadline_set_idx(down);
+	} else {
+		dld.down_cnt = 0;
+	}
+}
+
+/*********************** begin sysfs interface ***********************/
+
+extern struct kobject *sgxfreq_kobj;
+
+#define DEADLINE_ATTR(_name, _min, _max)				\
+static ssize_t show_##_name(struct device *dev,				\
+	struct device_attribute *attr, char *buf)			\
+{									\
+	return sprintf(buf, "%u\n", dld._name);				\
+}									\
+									\
+static ssize_t store_##_name(struct device *dev,			\
+	struct device_attribute *attr, const char *buf, size_t count)	\
+{									\
+	int ret;							\
+	unsigned int val;						\
+									\
+	ret = sscanf(buf, "%u", &val);					\
+	if (ret != 1 || val < (_min) || val > (_max))			\
+		return -EINVAL;						\
+									\
+	mutex_lock(&dld.mutex);						\
+	dld._name = val;						\
+	dld.down_cnt = 0;						\
+	mutex_unlock(&dld.mutex);					\
+									\
+	return count;							\
+}									\
+static DEVICE_ATTR(_name, 0644, show_##_name, store_##_name);
+
+DEADLINE_ATTR(frame_period_us, 1000, 1000000)
+DEADLINE_ATTR(headroom, 10, 100)
+DEADLINE_ATTR(hysteresis, 0, 50)
+DEADLINE_ATTR(down_delay, 1, 100)
+DEADLINE_ATTR(sample_ms, 10, 1000)
+
+static ssize_t show_frame_time_us(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", dld.frame_us);
+}
+
+static ssize_t show_residency(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	unsigned long *freq_list;
+	ssize_t count = 0;
+	int i, cnt;
+
+	mutex_lock(&dld.mutex);
+	__deadline_account();
+	cnt = sgxfreq_get_freq_list(&freq_list);
+	for (i = 0; i < cnt; i++)
+		count += sprintf(&buf[count], "%lu %llu\n", freq_list[i],
+				 (unsigned long long)dld.residency_ms[i]);
+	mutex_unlock(&dld.mutex);
+
+	return count;
+}
+
+static DEVICE_ATTR(frame_time_us, 0444, show_frame_time_us, NULL);
+static DEVICE_ATTR(residency, 0444, show_residency, NULL);
+
+static struct attribute *deadline_attributes[] = {
+	&dev_attr_frame_period_us.attr,
+	&dev_attr_headroom.attr,
+	&dev_attr_hysteresis.attr,
+	&dev_attr_down_delay.attr,
+	&dev_attr_sample_ms.attr,
+	&dev_attr_frame_time_us.attr,
+	&dev_attr_residency.attr,
+	NULL
+};
+
+static struct attribute_group deadline_attr_group = {
+	.attrs = deadline_attributes,
+	.name = "deadline",
+};
+
+/************************ end sysfs interface ************************/
+
+int deadline_init(void)
+{
+	int ret;
+
+	mutex_init(&dld.mutex);
+
+	dld.frame_period_us = DEADLINE_DEFAULT_FRAME_PERIOD_US;
+	dld.headroom = DEADLINE_DEFAULT_HEADROOM;
+	dld.hysteresis = DEADLINE_DEFAULT_HYSTERESIS;
+	dld.down_delay = DEADLINE_DEFAULT_DOWN_DELAY;
+	dld.sample_ms = DEADLINE_DEFAULT_SAMPLE_MS;
+
+	ret = sgxfreq_register_governor(&deadline_gov);
+	if (ret)
+		return ret;
+
+	return 0;
+}
+
+int deadline_deinit(void)
+{
+	kfree(dld.residency_ms);
+	dld.residency_ms = NULL;
+
+	return 0;
+}
+
+static int deadline_start(struct sgxfreq_sgx_data *data)
+{
+	int ret;
+	unsigned long *freq_list;
+	int cnt = sgxfreq_get_freq_list(&freq_list);
+
+	if (!dld.residency_ms) {
+		dld.residency_ms = kzalloc(cnt * sizeof(u64), GFP_KERNEL);
+		if (!dld.residency_ms)
+			return -ENOMEM;
+	}
+
+	dld.frames = 0;
+	dld.frame_us = 0;
+	dld.down_cnt = 0;
+	dld.polling_enabled = false;
+	dld.prev_total_active = sgxfreq_get_total_active_time();
+	dld.prev_total_idle = sgxfreq_get_total_idle_time();
+	dld.residency_start = jiffies;
+	dld.freq_idx = -1;
+
+	INIT_DELAYED_WORK(&dld.work, deadline_timeout);
+
+	ret = sysfs_create_group(sgxfreq_kobj, &deadline_attr_group);
+	if (ret)
+		return ret;
+
+	mutex_lock(&dld.mutex);
+	__deadline_set_idx(data->active ? cnt - 1 : 0);
+	mutex_unlock(&dld.mutex);
+
+	return 0;
+}
+
+static void deadline_stop(void)
+{
+	cancel_delayed_work_sync(&dld.work);
+
+	mutex_lock(&dld.mutex);
+	__deadline_account();
+	dld.freq_idx = -1;
+	mutex_unlock(&dld.mutex);
+
+	sysfs_remove_group(sgxfreq_kobj, &deadline_attr_group);
+}
+
+static void deadline_active(void)
+{
+	mutex_lock(&dld.mutex);
+	if (!dld.polling_enabled) {
+		dld.polling_enabled = true;
+		dld.frames = 0;
+		dld.prev_total_active = sgxfreq_get_total_active_time();
+		dld.prev_total_idle = sgxfreq_get_total_idle_time();
+		dld.sample_start = jiffies;
+		/* restart from the last frame time's choice, not from max */
+		if (dld.frame_us)
+			__deadline_set_idx(__deadline_pick(dld.frame_us,
+					   dld.frame_freq, dld.headroom));
+		schedule_delayed_work(&dld.work,
+				      msecs_to_jiffies(dld.sample_ms));
+	}
+	mutex_unlock(&dld.mutex);
+}
+
+static void deadline_frame_done(void)
+{
+	mutex_lock(&dld.mutex);
+	dld.frames++;
+	if (dld.polling_enabled &&
+	    time_after_eq(jiffies, dld.sample_start +
+			  msecs_to_jiffies(dld.sample_ms)))
+		__deadline_sample(false);
+	mutex_unlock(&dld.mutex);
+}
+
+static void deadline_timeout(struct work_struct *work)
+{
+	mutex_lock(&dld.mutex);
+	__deadline_sample(true);
+	if (dld.polling_enabled)
+		schedule_delayed_work(&dld.work,
+				      msecs_to_jiffies(dld.sample_ms));
+	mutex_unlock(&dld.mutex);
+}
@@ -173,6 +173,11 @@ typedef struct _SYS_SPECIFIC_DATA_TAG_
 	atomic_t	sSGXClocksEnabled;
 #if defined(PVR_LINUX_USING_WORKQUEUES)
 	struct mutex	sPowerLock;
+	/* Contention on sPowerLock, the first three updated with it held */
+	IMG_UINT32	ui32PowerLockContended;
+	IMG_UINT64	ui64PowerLockWaitNs;
+	IMG_UINT64	ui64PowerLockMaxWaitNs;
+	atomic_t	sPowerLockTryFailed;
 #else
 	IMG_BOOL	bConstraintNotificationsEnabled;
 	spinlock_t	sPowerLock;
@@ -50,6 +50,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "sgxfreq_activeidle.c"
 #include "sgxfreq_on3demand.c"
 #include "sgxfreq_userspace.c"
+#include "sgxfreq_deadline.c"
 #if defined(CONFIG_THERMAL_FRAMEWORK)
 #include "sgxfreq_cool.c"
 #endif
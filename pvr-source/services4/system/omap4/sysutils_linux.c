@@ -43,6 +43,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/clk.h>
 #include <linux/err.h>
 #include <linux/hardirq.h>
+#include <linux/ktime.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
 
@@ -87,21 +88,41 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 extern struct platform_device *gpsPVRLDMDev;
 #endif
 
+/*
+ * sPowerLock is what puts kick, active power management and DVFS to sleep
+ * on each other: with it held, PVRSRVPowerLock finds the power state
+ * resource free unless interrupt context has it, so its retry loop does not
+ * spin on contention between threads.  Waits are counted for
+ * power_lock_stats.
+ */
 static PVRSRV_ERROR PowerLockWrap(SYS_SPECIFIC_DATA *psSysSpecData, IMG_BOOL bTryLock)
 {
 	if (!in_interrupt())
 	{
+		if (mutex_trylock(&psSysSpecData->sPowerLock))
+		{
+			return PVRSRV_OK;
+		}
+
 		if (bTryLock)
 		{
-			int locked = mutex_trylock(&psSysSpecData->sPowerLock);
-			if (locked == 0)
-			{
-				return PVRSRV_ERROR_RETRY;
-			}
+			atomic_inc(&psSysSpecData->sPowerLockTryFailed);
+			return PVRSRV_ERROR_RETRY;
 		}
 		else
 		{
+			ktime_t sStart = ktime_get();
+			IMG_UINT64 ui64WaitNs;
+
 			mutex_lock(&psSysSpecData->sPowerLock);
+
+			ui64WaitNs = ktime_to_ns(ktime_sub(ktime_get(), sStart));
+			psSysSpecData->ui32PowerLockContended++;
+			psSysSpecData->ui64PowerLockWaitNs += ui64WaitNs;
+			if (ui64WaitNs > psSysSpecData->ui64PowerLockMaxWaitNs)
+			{
+				psSysSpecData->ui64PowerLockMaxWaitNs = ui64WaitNs;
+			}
 		}
 	}
 
@@ -601,6 +622,7 @@ PVRSRV_ERROR EnableSystemClocks(SYS_DATA *psSysData)
 	if (!psSysSpecData->bSysClocksOneTimeInit)
 	{
 		mutex_init(&psSysSpecData->sPowerLock);
+		atomic_set(&psSysSpecData->sPowerLockTryFailed, 0);
 
 		atomic_set(&psSysSpecData->sSGXClocksEnabled, 0);
 
@@ -636,10 +658,31 @@ IMG_VOID DisableSystemClocks(SYS_DATA *psSysData)
 	ReleaseGPTimer(psSysSpecData);
 }
 
+#if defined(LDM_PLATFORM) && !defined(PVR_DRI_DRM_NOT_PCI)
+/* contended acquisitions, summed and longest wait, failed try-locks */
+static ssize_t show_power_lock_stats(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = gpsSysSpecificData;
+
+	return sprintf(buf, "contended %u\nwait_us %llu\nmax_wait_us %llu\ntry_failed %d\n",
+		       psSysSpecData->ui32PowerLockContended,
+		       (unsigned long long)div_u64(psSysSpecData->ui64PowerLockWaitNs, NSEC_PER_USEC),
+		       (unsigned long long)div_u64(psSysSpecData->ui64PowerLockMaxWaitNs, NSEC_PER_USEC),
+		       atomic_read(&psSysSpecData->sPowerLockTryFailed));
+}
+
+static DEVICE_ATTR(power_lock_stats, 0444, show_power_lock_stats, NULL);
+#endif
+
 PVRSRV_ERROR SysPMRuntimeRegister(SYS_SPECIFIC_DATA *psSysSpecificData)
 {
 #if defined(LDM_PLATFORM) && !defined(PVR_DRI_DRM_NOT_PCI)
 	pm_runtime_enable(&gpsPVRLDMDev->dev);
+	if (device_create_file(&gpsPVRLDMDev->dev, &dev_attr_power_lock_stats))
+	{
+		PVR_DPF((PVR_DBG_WARNING, "SysPMRuntimeRegister: no power_lock_stats in sysfs"));
+	}
 #endif
 #if defined(CONFIG_HAS_WAKELOCK)
 	wake_lock_init(&psSysSpecificData->wake_lock, WAKE_LOCK_SUSPEND, "pvrsrvkm");
@@ -650,6 +693,7 @@ PVRSRV_ERROR SysPMRuntimeRegister(SYS_SPECIFIC_DATA *psSysSpecificData)
 PVRSRV_ERROR SysPMRuntimeUnregister(SYS_SPECIFIC_DATA *psSysSpecificData)
 {
 #if defined(LDM_PLATFORM) && !defined(PVR_DRI_DRM_NOT_PCI)
+	device_remove_file(&gpsPVRLDMDev->dev, &dev_attr_power_lock_stats);
 	pm_runtime_disable(&gpsPVRLDMDev->dev);
 #endif
 #if defined(CONFIG_HAS_WAKELOCK)
@@ -138,6 +138,7 @@ DBGKM_SERVICE_TABLE g_sDBGKMServices =
 /* Static function declarations */
 static IMG_UINT32 DBGDrivWritePersist(PDBG_STREAM psMainStream,IMG_UINT8 * pui8InBuf,IMG_UINT32 ui32InBuffSize,IMG_UINT32 ui32Level);
 static IMG_VOID InvalidateAllStreams(IMG_VOID);
+static IMG_BOOL DBGDrivDiscardNonCapture(PDBG_STREAM psStream);
 
 /*****************************************************************************
  Code
@@ -507,6 +508,17 @@ IMG_UINT32 IMG_CALLCONV ExtDBGDrivWriteStringCM(PDBG_STREAM psStream,IMG_CHAR *
 IMG_UINT32 IMG_CALLCONV ExtDBGDrivWriteCM(PDBG_STREAM psStream,IMG_UINT8 * pui8InBuf,IMG_UINT32 ui32InBuffSize,IMG_UINT32 ui32Level)
 {
 	IMG_UINT32	ui32Ret;
+
+	/*
+		Outside the capture range every write is thrown away, so don't
+		serialise on the API mutex just to find that out. The stream is
+		the caller's own and its control block lives as long as it does;
+		a mode change racing with this only moves the cut by one write.
+	*/
+	if (psStream && DBGDrivDiscardNonCapture(psStream))
+	{
+		return(ui32InBuffSize);
+	}
 	
 	/* Aquire API Mutex */
 	HostAquireMutex(g_pvAPIMutex);
@@ -1870,12 +1882,29 @@ IMG_UINT32 IMG_CALLCONV DBGDrivWriteCM(PDBG_STREAM psStream,IMG_UINT8 * pui8InBu
 	/*
 		Only write data if debug mode adds up...
 	*/
+	if (DBGDrivDiscardNonCapture(psStream))
+	{
+		/* throw away non-capturing data */
+		return(ui32InBuffSize);
+	}
+
+	return(DBGDrivWrite2(psStream,pui8InBuf,ui32InBuffSize,ui32Level));
+}
+
+/*!****************************************************************************
+ @name		DBGDrivDiscardNonCapture
+ @brief		Whether a capture mode write to the stream falls outside the
+			frames being captured and is to be thrown away
+ @param		psStream - stream
+ @return	IMG_TRUE to discard the write
+*****************************************************************************/
+static IMG_BOOL DBGDrivDiscardNonCapture(PDBG_STREAM psStream)
+{
 	if (psStream->psCtrl->ui32CapMode & DEBUG_CAPMODE_FRAMED)
 	{
 		if	((psStream->psCtrl->ui32Flags & DEBUG_FLAGS_ENABLESAMPLE) == 0)
 		{
-			/* throw away non-capturing data */
-			return(ui32InBuffSize);
+			return(IMG_TRUE);
 		}
 	}
 	else
@@ -1884,13 +1913,12 @@ IMG_UINT32 IMG_CALLCONV DBGDrivWriteCM(PDBG_STREAM psStream,IMG_UINT8 * pui8InBu
 		{
 			if ((psStream->psCtrl->ui32Current != g_ui32HotKeyFrame) || (g_bHotKeyPressed == IMG_FALSE))
 			{
-				/* throw away non-capturing data */
-				return(ui32InBuffSize);
+				return(IMG_TRUE);
 			}
 		}
 	}
 
-	return(DBGDrivWrite2(psStream,pui8InBuf,ui32InBuffSize,ui32Level));
+	return(IMG_FALSE);
 }
 
 
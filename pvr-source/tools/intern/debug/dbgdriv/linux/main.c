@@ -47,6 +47,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <linux/list.h>
 #include <linux/init.h>
 #include <linux/vmalloc.h>
+#include <linux/mutex.h>
 #include <linux/version.h>
 
 #if defined(LDM_PLATFORM) && !defined(SUPPORT_DRI_DRM)
@@ -91,6 +92,15 @@ static struct class *psDbgDrvClass;
 
 static int AssignedMajorNumber = 0;
 
+/*
+	Staging buffer for DEBUG_SERVICE_READ, kept between reads so the
+	capture tool polling a stream does not vmalloc and vfree every chunk.
+	It only grows, and is freed when the module goes.
+*/
+static DEFINE_MUTEX(gsReadBufferLock);
+static IMG_CHAR *gpui8ReadBuffer = IMG_NULL;
+static IMG_UINT32 gui32ReadBufferSize = 0;
+
 long dbgdrv_ioctl(struct file *, unsigned int, unsigned long);
 
 static int dbgdrv_open(struct inode unref__ * pInode, struct file unref__ * pFile)
@@ -142,6 +152,9 @@ static void __exit dbgdrv_cleanup(void)
 	HostDestroyEventObjects();
 #endif
 	HostDestroyMutex(g_pvAPIMutex);
+	vfree(gpui8ReadBuffer);
+	gpui8ReadBuffer = IMG_NULL;
+	gui32ReadBufferSize = 0;
 	return;
 }
 
@@ -266,35 +279,44 @@ long dbgdrv_ioctl(struct file *file, unsigned int ioctlCmd, unsigned long arg)
 		IMG_UINT32 *pui32BytesCopied = (IMG_UINT32 *)out;
 		DBG_IN_READ *psReadInParams = (DBG_IN_READ *)in;
 		DBG_STREAM *psStream;
-		IMG_CHAR *ui8Tmp;
-
-		ui8Tmp = vmalloc(psReadInParams->ui32OutBufferSize);
 
-		if(!ui8Tmp)
+		psStream = SID2PStream(psReadInParams->hStream);
+		if(!psStream)
 		{
 			goto init_failed;
 		}
 
-		psStream = SID2PStream(psReadInParams->hStream);
-		if(!psStream)
+		mutex_lock(&gsReadBufferLock);
+
+		if(psReadInParams->ui32OutBufferSize > gui32ReadBufferSize)
 		{
-			goto init_failed;
+			IMG_CHAR *pui8NewBuffer = vmalloc(psReadInParams->ui32OutBufferSize);
+
+			if(!pui8NewBuffer)
+			{
+				mutex_unlock(&gsReadBufferLock);
+				goto init_failed;
+			}
+
+			vfree(gpui8ReadBuffer);
+			gpui8ReadBuffer = pui8NewBuffer;
+			gui32ReadBufferSize = psReadInParams->ui32OutBufferSize;
 		}
 
 		*pui32BytesCopied = ExtDBGDrivRead(psStream,
 										   psReadInParams->bReadInitBuffer,
 										   psReadInParams->ui32OutBufferSize,
-										   ui8Tmp);
+										   (IMG_UINT8 *)gpui8ReadBuffer);
 
 		if(pvr_copy_to_user(psReadInParams->u.pui8OutBuffer,
-						ui8Tmp,
+						gpui8ReadBuffer,
 						*pui32BytesCopied) != 0)
 		{
-			vfree(ui8Tmp);
+			mutex_unlock(&gsReadBufferLock);
 			goto init_failed;
 		}
 
-		vfree(ui8Tmp);
+		mutex_unlock(&gsReadBufferLock);
 	}
 	else
 	{
@@ -0,0 +1,387 @@
+/*************************************************************************/ /*!
+@Title          Host microbenchmark for the srvkm hash tables.
+@Copyright      Copyright (c) Imagination Technologies Ltd. All Rights Reserved
+@Description
+   Times HASH_Insert/HASH_Retrieve/HASH_Remove with the key patterns the
+   driver uses: page aligned device addresses (RA segment hash) and three
+   word keys (handle find-by-data), plus a steady-state churn that keeps
+   the table at a fixed size. Entries are inserted in ascending order,
+   then looked up and removed in a shuffled order. Operations are timed in batches of
+   BENCH_BATCH, and the slowest batch is reported as well as throughput,
+   as that is where a stop-the-world rehash shows.
+
+   Build on the host from the pvr-source directory with:
+
+   gcc -O2 -DLINUX -Iinclude4 -Iservices4/include -Iservices4/srvkm/include \
+       -Iservices4/system/omap4 -Iservices4/include/env/linux \
+       tools/intern/hash_bench/hash_bench.c services4/srvkm/common/hash.c \
+       -o hash_bench
+
+   and compare implementations by building against another hash.c.
+@License        Dual MIT/GPLv2
+
+The contents of this file are subject to the MIT license as set out below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+Alternatively, the contents of this file may be used under the terms of
+the GNU General Public License Version 2 ("GPL") in which case the provisions
+of GPL are applicable instead of those above.
+
+If you wish to allow use of your version of this file only under the terms of
+GPL, and not to allow others to use your version of this file under the terms
+of the MIT license, indicate your decision by deleting the provisions above
+and replace them with the notice and other provisions required by GPL as set
+out in the file called "GPL-COPYING" included in this distribution. If you do
+not delete the provisions above, a recipient may use your version of this file
+under the terms of either the MIT license or GPL.
+
+This License is also included in this distribution in the file called
+"MIT-COPYING".
+
+EXCEPT AS OTHERWISE INDICATED IN THIS LICENSE ("MIT LICENSE"), THE SOFTWARE IS
+PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT; AND (B) IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/ /**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "img_defs.h"
+#include "services.h"
+#include "hash.h"
+
+#define BENCH_PAGE_SIZE	4096
+#define BENCH_BATCH		64
+
+/* Handle style key, as HAND_KEY in handle.c */
+typedef IMG_UINTPTR_T BENCH_KEY[3];
+
+typedef struct _BENCH_STATS_
+{
+	const char *pszName;
+	IMG_UINT32 ui32Ops;
+	IMG_UINT64 ui64TotalNs;
+	IMG_UINT64 ui64MaxBatchNs;
+} BENCH_STATS;
+
+static IMG_UINT32 gui32Failures;
+
+/* Host versions of the OS services hash.c uses */
+
+PVRSRV_ERROR OSAllocMem_Impl(IMG_UINT32 ui32Flags, IMG_SIZE_T ui32Size, IMG_PVOID *ppvLinAddr, IMG_HANDLE *phBlockAlloc)
+{
+	PVR_UNREFERENCED_PARAMETER(ui32Flags);
+	PVR_UNREFERENCED_PARAMETER(phBlockAlloc);
+
+	*ppvLinAddr = malloc(ui32Size);
+	return (*ppvLinAddr != IMG_NULL) ? PVRSRV_OK : PVRSRV_ERROR_OUT_OF_MEMORY;
+}
+
+PVRSRV_ERROR OSFreeMem_Impl(IMG_UINT32 ui32Flags, IMG_SIZE_T ui32Size, IMG_PVOID pvLinAddr, IMG_HANDLE hBlockAlloc)
+{
+	PVR_UNREFERENCED_PARAMETER(ui32Flags);
+	PVR_UNREFERENCED_PARAMETER(ui32Size);
+	PVR_UNREFERENCED_PARAMETER(hBlockAlloc);
+
+	free(pvLinAddr);
+	return PVRSRV_OK;
+}
+
+IMG_VOID OSMemCopy(IMG_VOID *pvDst, IMG_VOID *pvSrc, IMG_SIZE_T ui32Size)
+{
+	memcpy(pvDst, pvSrc, ui32Size);
+}
+
+IMG_VOID OSMemSet(IMG_VOID *pvDest, IMG_UINT8 ui8Value, IMG_SIZE_T ui32Size)
+{
+	memset(pvDest, ui8Value, ui32Size);
+}
+
+static IMG_UINT64 NowNs(IMG_VOID)
+{
+	struct timespec sTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &sTs);
+	return (IMG_UINT64)sTs.tv_sec * 1000000000ULL + sTs.tv_nsec;
+}
+
+static IMG_VOID StatsStart(BENCH_STATS *psStats, const char *pszName)
+{
+	memset(psStats, 0, sizeof(*psStats));
+	psStats->pszName = pszName;
+}
+
+static IMG_VOID StatsAdd(BENCH_STATS *psStats, IMG_UINT64 ui64StartNs, IMG_UINT32 ui32Ops)
+{
+	IMG_UINT64 ui64Ns = NowNs() - ui64StartNs;
+
+	psStats->ui32Ops += ui32Ops;
+	psStats->ui64TotalNs += ui64Ns;
+	if (ui64Ns > psStats->ui64MaxBatchNs)
+	{
+		psStats->ui64MaxBatchNs = ui64Ns;
+	}
+}
+
+static IMG_VOID StatsPrint(const BENCH_STATS *psStats)
+{
+	printf("  %-14s %8u ops %7.2f Mops/s  avg %5llu ns  worst %u ops %8llu ns\n",
+		   psStats->pszName, psStats->ui32Ops,
+		   psStats->ui64TotalNs ? (psStats->ui32Ops * 1000.0) / psStats->ui64TotalNs : 0.0,
+		   (unsigned long long)(psStats->ui32Ops ? psStats->ui64TotalNs / psStats->ui32Ops : 0),
+		   BENCH_BATCH, (unsigned long long)psStats->ui64MaxBatchNs);
+}
+
+static IMG_VOID Check(IMG_BOOL bCond, const char *pszWhat, IMG_UINT32 ui32Index)
+{
+	if (!bCond)
+	{
+		if (gui32Failures++ < 10)
+		{
+			fprintf(stderr, "FAIL: %s (%u)\n", pszWhat, ui32Index);
+		}
+	}
+}
+
+/* Device addresses as the RA hands them out: page aligned and ascending */
+static IMG_UINTPTR_T AddrKey(IMG_UINT32 ui32Index)
+{
+	return (IMG_UINTPTR_T)0x10000000 + (IMG_UINTPTR_T)ui32Index * BENCH_PAGE_SIZE;
+}
+
+/* Handle style key: data pointer, handle type, parent handle */
+static IMG_VOID HandKey(BENCH_KEY aKey, IMG_UINT32 ui32Index)
+{
+	aKey[0] = (IMG_UINTPTR_T)0xc0000000 + (IMG_UINTPTR_T)ui32Index * 64;
+	aKey[1] = (IMG_UINTPTR_T)(ui32Index % 23);
+	aKey[2] = (IMG_UINTPTR_T)(ui32Index / 16 + 1);
+}
+
+/* One operation on entry ui32Index, IMG_FALSE if the result is wrong */
+typedef IMG_BOOL (*BENCH_OP)(HASH_TABLE *psHash, IMG_UINT32 ui32Index);
+
+static IMG_BOOL AddrInsert(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	return HASH_Insert(psHash, AddrKey(i), i + 1);
+}
+
+static IMG_BOOL AddrRetrieve(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	return HASH_Retrieve(psHash, AddrKey(i)) == i + 1;
+}
+
+static IMG_BOOL AddrRetrieveMiss(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	return HASH_Retrieve(psHash, AddrKey(i) + BENCH_PAGE_SIZE / 2) == 0;
+}
+
+static IMG_BOOL AddrRemove(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	return HASH_Remove(psHash, AddrKey(i)) == i + 1;
+}
+
+static IMG_BOOL HandInsert(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	BENCH_KEY aKey;
+
+	HandKey(aKey, i);
+	return HASH_Insert_Extended(psHash, aKey, i + 1);
+}
+
+static IMG_BOOL HandRetrieve(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	BENCH_KEY aKey;
+
+	HandKey(aKey, i);
+	return HASH_Retrieve_Extended(psHash, aKey) == i + 1;
+}
+
+static IMG_BOOL HandRemove(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	BENCH_KEY aKey;
+
+	HandKey(aKey, i);
+	return HASH_Remove_Extended(psHash, aKey) == i + 1;
+}
+
+/*
+ * Churn keeps gui32ChurnLive entries, each step replacing a randomly
+ * chosen one, as the RA frees segments in no particular order.
+ */
+static IMG_UINT32 gui32ChurnLive;
+static IMG_UINT32 *gpui32ChurnKeys;
+static IMG_UINT32 gui32ChurnSeed = 0x9e3779b9;
+
+static IMG_BOOL AddrChurn(HASH_TABLE *psHash, IMG_UINT32 i)
+{
+	IMG_UINT32 ui32Slot;
+	IMG_BOOL bOk;
+
+	/* xorshift32 */
+	gui32ChurnSeed ^= gui32ChurnSeed << 13;
+	gui32ChurnSeed ^= gui32ChurnSeed >> 17;
+	gui32ChurnSeed ^= gui32ChurnSeed << 5;
+	ui32Slot = gui32ChurnSeed % gui32ChurnLive;
+
+	bOk = AddrRemove(psHash, gpui32ChurnKeys[ui32Slot]);
+	gpui32ChurnKeys[ui32Slot] = i;
+
+	return AddrInsert(psHash, i) && bOk;
+}
+
+/* Shuffled entry order for the lookup and remove phases */
+static IMG_UINT32 *gpui32Order;
+
+static IMG_VOID Shuffle(IMG_UINT32 ui32Count)
+{
+	IMG_UINT32 ui32Seed = 0x2545f491;
+	IMG_UINT32 i;
+
+	gpui32Order = malloc(ui32Count * sizeof(IMG_UINT32));
+	for (i = 0; i < ui32Count; i++)
+	{
+		gpui32Order[i] = i;
+	}
+
+	for (i = ui32Count - 1; i > 0; i--)
+	{
+		IMG_UINT32 j, ui32Tmp;
+
+		/* xorshift32 */
+		ui32Seed ^= ui32Seed << 13;
+		ui32Seed ^= ui32Seed >> 17;
+		ui32Seed ^= ui32Seed << 5;
+		j = ui32Seed % (i + 1);
+
+		ui32Tmp = gpui32Order[i];
+		gpui32Order[i] = gpui32Order[j];
+		gpui32Order[j] = ui32Tmp;
+	}
+}
+
+static IMG_VOID RunPhase(const char *pszName, HASH_TABLE *psHash, BENCH_OP pfnOp,
+						 IMG_UINT32 ui32First, IMG_UINT32 ui32Count, IMG_BOOL bShuffled)
+{
+	BENCH_STATS sStats;
+	IMG_UINT32 ui32Failed = 0;
+	IMG_UINT32 i = ui32First;
+
+	StatsStart(&sStats, pszName);
+	while (i < ui32First + ui32Count)
+	{
+		IMG_UINT32 ui32End = ui32First + ui32Count;
+		IMG_UINT32 ui32Ops;
+		IMG_UINT64 ui64Start;
+
+		if (ui32End - i > BENCH_BATCH)
+		{
+			ui32End = i + BENCH_BATCH;
+		}
+		ui32Ops = ui32End - i;
+		ui64Start = NowNs();
+
+		for (; i < ui32End; i++)
+		{
+			ui32Failed += !pfnOp(psHash, bShuffled ? gpui32Order[i] : i);
+		}
+		StatsAdd(&sStats, ui64Start, ui32Ops);
+	}
+	StatsPrint(&sStats);
+
+	Check(ui32Failed == 0, pszName, ui32Failed);
+}
+
+static IMG_VOID BenchAddr(IMG_UINT32 ui32Count)
+{
+	HASH_TABLE *psHash = HASH_Create(64);
+
+	printf("address keys, %u entries\n", ui32Count);
+	RunPhase("insert", psHash, AddrInsert, 0, ui32Count, IMG_FALSE);
+	RunPhase("retrieve hit", psHash, AddrRetrieve, 0, ui32Count, IMG_TRUE);
+	RunPhase("retrieve miss", psHash, AddrRetrieveMiss, 0, ui32Count, IMG_TRUE);
+	RunPhase("remove", psHash, AddrRemove, 0, ui32Count, IMG_TRUE);
+	HASH_Delete(psHash);
+}
+
+static IMG_VOID BenchHandle(IMG_UINT32 ui32Count)
+{
+	HASH_TABLE *psHash = HASH_Create_Extended(32, sizeof(BENCH_KEY), HASH_Func_Default, HASH_Key_Comp_Default);
+
+	printf("handle keys, %u entries\n", ui32Count);
+	RunPhase("insert", psHash, HandInsert, 0, ui32Count, IMG_FALSE);
+	RunPhase("retrieve hit", psHash, HandRetrieve, 0, ui32Count, IMG_TRUE);
+	RunPhase("remove", psHash, HandRemove, 0, ui32Count, IMG_TRUE);
+	HASH_Delete(psHash);
+}
+
+static IMG_VOID BenchChurn(IMG_UINT32 ui32Live, IMG_UINT32 ui32Steps)
+{
+	HASH_TABLE *psHash = HASH_Create(64);
+	IMG_UINT32 i;
+
+	printf("churn, %u live entries\n", ui32Live);
+
+	gui32ChurnLive = ui32Live;
+	gpui32ChurnKeys = malloc(ui32Live * sizeof(IMG_UINT32));
+	for (i = 0; i < ui32Live; i++)
+	{
+		gpui32ChurnKeys[i] = i;
+		Check(AddrInsert(psHash, i), "churn fill", i);
+	}
+
+	RunPhase("remove+insert", psHash, AddrChurn, ui32Live, ui32Steps, IMG_FALSE);
+
+	for (i = 0; i < ui32Live; i++)
+	{
+		Check(AddrRemove(psHash, gpui32ChurnKeys[i]), "churn drain", gpui32ChurnKeys[i]);
+	}
+
+	free(gpui32ChurnKeys);
+	HASH_Delete(psHash);
+}
+
+int main(int argc, char **argv)
+{
+	IMG_UINT32 ui32Count = 100000;
+
+	if (argc > 1)
+	{
+		ui32Count = (IMG_UINT32)strtoul(argv[1], IMG_NULL, 0);
+	}
+
+	if (ui32Count == 0)
+	{
+		fprintf(stderr, "usage: %s [entries]\n", argv[0]);
+		return 1;
+	}
+
+	Shuffle(ui32Count);
+	BenchAddr(ui32Count);
+	BenchHandle(ui32Count);
+	BenchChurn(ui32Count / 10 ? ui32Count / 10 : 1, ui32Count * 4);
+
+	free(gpui32Order);
+
+	if (gui32Failures != 0)
+	{
+		fprintf(stderr, "%u checks failed\n", gui32Failures);
+		return 1;
+	}
+
+	return 0;
+}